@@ -0,0 +1,1579 @@
+#include "BlockCompressor.h"
+#include "../StringHelper.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace
+{
+	const uint32_t BlockRowsPerBand = 4;
+
+	// A block gathered to RGBA, row by row
+	typedef uint8_t Texels[16][4];
+
+	// Reads the 4x4 block at blockX, blockY. Texels past the edge of levels smaller than a block repeat the last row
+	// or column, which the GPU never samples
+	void GatherBlock(const uint8_t* level, uint32_t width, uint32_t height, uint32_t rowPitch, int channels, uint32_t blockX, uint32_t blockY, Texels& texels)
+	{
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			const uint8_t* row = level + static_cast<size_t>(std::min(blockY * 4 + y, height - 1)) * rowPitch;
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				const uint8_t* texel = row + static_cast<size_t>(std::min(blockX * 4 + x, width - 1)) * channels;
+				uint8_t* target = texels[y * 4 + x];
+				if (channels == 4)
+				{
+					memcpy(target, texel, 4);
+				}
+				else
+				{
+					target[0] = target[1] = target[2] = texel[0];
+					target[3] = 255;
+				}
+			}
+		}
+	}
+
+	void ScatterBlock(const Texels& texels, uint8_t* level, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t blockX, uint32_t blockY)
+	{
+		for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+		{
+			uint8_t* row = level + static_cast<size_t>(blockY * 4 + y) * rowPitch;
+			for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++)
+				memcpy(row + static_cast<size_t>(blockX * 4 + x) * 4, texels[y * 4 + x], 4);
+		}
+	}
+
+	int Clamp(int value, int low, int high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	int Square(int value)
+	{
+		return value * value;
+	}
+
+	// Widens a bits wide code to 8 bits by repeating its top bits, what the GPU does
+	int Expand(int value, int bits)
+	{
+		value <<= 8 - bits;
+		return value | (value >> bits);
+	}
+
+	// Line through points with the least squared distance to them, over channels first to first + count - 1
+	struct Line
+	{
+		float mean[4] = {};
+		float axis[4] = {}; // Unit length, 0 when every point is the same
+		float low = 0.0f; // Extent of the points along axis, from mean
+		float high = 0.0f;
+		float residual = 0.0f; // Squared distance of the points to the line, summed
+	};
+
+	Line FitLine(const float (*points)[4], const int* members, int count, int first, int channels)
+	{
+		Line line;
+		for (int i = 0; i < count; i++)
+		{
+			for (int c = first; c < first + channels; c++)
+				line.mean[c] += points[members[i]][c];
+		}
+		for (int c = first; c < first + channels; c++)
+			line.mean[c] /= count;
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < count; i++)
+		{
+			const float* point = points[members[i]];
+			for (int a = first; a < first + channels; a++)
+			{
+				for (int b = a; b < first + channels; b++)
+					covariance[a][b] += (point[a] - line.mean[a]) * (point[b] - line.mean[b]);
+			}
+		}
+		float trace = 0.0f;
+		int widest = first;
+		for (int a = first; a < first + channels; a++)
+		{
+			for (int b = first; b < a; b++)
+				covariance[a][b] = covariance[b][a];
+			trace += covariance[a][a];
+			if (covariance[a][a] > covariance[widest][widest])
+				widest = a;
+		}
+		if (trace <= 0.0f)
+			return line;
+
+		// Power iteration from the channel that varies the most converges on the principal axis in a few steps
+		float axis[4] = {};
+		for (int c = first; c < first + channels; c++)
+			axis[c] = covariance[widest][c];
+		float eigenvalue = 0.0f;
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = first; a < first + channels; a++)
+			{
+				for (int b = first; b < first + channels; b++)
+					next[a] += covariance[a][b] * axis[b];
+				length += next[a] * next[a];
+			}
+			if (length <= 0.0f)
+				break;
+			length = std::sqrt(length);
+			for (int c = first; c < first + channels; c++)
+				axis[c] = next[c] / length;
+			eigenvalue = length;
+		}
+
+		float length = 0.0f;
+		for (int c = first; c < first + channels; c++)
+			length += axis[c] * axis[c];
+		if (length <= 0.0f)
+			return line;
+		length = std::sqrt(length);
+		for (int c = first; c < first + channels; c++)
+			line.axis[c] = axis[c] / length;
+
+		line.low = std::numeric_limits<float>::max();
+		line.high = -std::numeric_limits<float>::max();
+		for (int i = 0; i < count; i++)
+		{
+			float t = 0.0f;
+			for (int c = first; c < first + channels; c++)
+				t += (points[members[i]][c] - line.mean[c]) * line.axis[c];
+			line.low = std::min(line.low, t);
+			line.high = std::max(line.high, t);
+		}
+		line.residual = std::max(0.0f, trace - eigenvalue);
+		return line;
+	}
+
+	// Sums over a set of RGBA points, enough for the spread off the line through them without visiting them again.
+	// Sums add up, so the moments of one subset are the block's minus the other subset's
+	struct Moments
+	{
+		static const int Size = 15;
+		float values[Size] = {}; // Count, the four sums, then the upper triangle of the products
+
+		static Moments Of(const float point[4])
+		{
+			Moments moments;
+			moments.values[0] = 1.0f;
+			int next = 1;
+			for (int a = 0; a < 4; a++)
+				moments.values[next++] = point[a];
+			for (int a = 0; a < 4; a++)
+			{
+				for (int b = a; b < 4; b++)
+					moments.values[next++] = point[a] * point[b];
+			}
+			return moments;
+		}
+
+		void Add(const Moments& other)
+		{
+			for (int i = 0; i < Size; i++)
+				this->values[i] += other.values[i];
+		}
+
+		Moments Subtract(const Moments& other) const
+		{
+			Moments result;
+			for (int i = 0; i < Size; i++)
+				result.values[i] = this->values[i] - other.values[i];
+			return result;
+		}
+
+		// Squared distance of the points to their principal axis, summed. Rough, but enough to rank partitions
+		float GetResidual() const
+		{
+			const float count = this->values[0];
+			if (count < 2.0f)
+				return 0.0f;
+			const float* sum = this->values + 1;
+			float covariance[4][4];
+			float trace = 0.0f;
+			int next = 5;
+			for (int a = 0; a < 4; a++)
+			{
+				for (int b = a; b < 4; b++)
+					covariance[a][b] = covariance[b][a] = this->values[next++] - sum[a] * sum[b] / count;
+				trace += covariance[a][a];
+			}
+			// Two steps of power iteration from the widest channel and the Rayleigh quotient, no square roots
+			int widest = 0;
+			for (int a = 1; a < 4; a++)
+			{
+				if (covariance[a][a] > covariance[widest][widest])
+					widest = a;
+			}
+			float first[4] = {}, second[4] = {};
+			for (int a = 0; a < 4; a++)
+			{
+				for (int b = 0; b < 4; b++)
+					first[a] += covariance[a][b] * covariance[widest][b];
+			}
+			float dot = 0.0f, length = 0.0f;
+			for (int a = 0; a < 4; a++)
+			{
+				for (int b = 0; b < 4; b++)
+					second[a] += covariance[a][b] * first[b];
+				dot += first[a] * second[a];
+				length += first[a] * first[a];
+			}
+			const float eigenvalue = length > 0.0f ? dot / length : 0.0f;
+			return std::max(0.0f, trace - eigenvalue);
+		}
+	};
+
+	void GetLinePoint(const Line& line, float t, float point[4])
+	{
+		for (int c = 0; c < 4; c++)
+			point[c] = line.mean[c] + line.axis[c] * t;
+	}
+
+	// Least squares endpoints for the chosen indices, weights[index] is how much of the first endpoint a texel with
+	// that index gets. Members with a negative weight are left out. Returns false when the indices do not pin both
+	// endpoints down, all texels on one palette entry for instance
+	bool RefineEndpoints(const float (*points)[4], const int* members, int count, int first, int channels, const uint8_t* indices, const float* weights,
+		float firstEndpoint[4], float secondEndpoint[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < count; i++)
+		{
+			const float a = weights[indices[i]];
+			if (a < 0.0f)
+				continue;
+			const float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = first; c < first + channels; c++)
+			{
+				ax[c] += a * points[members[i]][c];
+				bx[c] += b * points[members[i]][c];
+			}
+		}
+		const float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) < 1e-6f)
+			return false;
+		for (int c = first; c < first + channels; c++)
+		{
+			firstEndpoint[c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) / determinant));
+			secondEndpoint[c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) / determinant));
+		}
+		return true;
+	}
+
+	int GetIterationCount(BlockQuality quality)
+	{
+		switch (quality)
+		{
+		case BlockQuality::Fast: return 0;
+		case BlockQuality::Normal: return 2;
+		default: return 4;
+		}
+	}
+
+	// -- BC1 color blocks, shared with BC3 -- //
+
+	uint16_t ToRgb565(const float color[4])
+	{
+		int r = Clamp(static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		int g = Clamp(static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		int b = Clamp(static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return static_cast<uint16_t>(r << 11 | g << 5 | b);
+	}
+
+	void FromRgb565(uint16_t value, int color[3])
+	{
+		color[0] = Expand(value >> 11, 5);
+		color[1] = Expand(value >> 5 & 63, 6);
+		color[2] = Expand(value & 31, 5);
+	}
+
+	// BC1 has four colors when color0 > color1 and three plus transparent black otherwise. BC3 always has four
+	void BuildColorPalette(uint16_t color0, uint16_t color1, bool fourColor, int palette[4][3])
+	{
+		FromRgb565(color0, palette[0]);
+		FromRgb565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			if (fourColor)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+				palette[3][c] = 0;
+			}
+		}
+	}
+
+	struct ColorBlock
+	{
+		uint16_t color0 = 0;
+		uint16_t color1 = 0;
+		uint8_t indices[16] = {};
+		int error = std::numeric_limits<int>::max();
+	};
+
+	// Orders the endpoints for the palette size and picks the closest entry per texel. Texels below half alpha take
+	// the transparent entry when punchThrough is set, opaque ones never do
+	ColorBlock EvaluateColorBlock(const Texels& texels, uint16_t color0, uint16_t color1, bool fourColor, bool fourColorOnly, bool punchThrough)
+	{
+		ColorBlock block;
+		if (!fourColorOnly && (fourColor ? color0 < color1 : color0 > color1))
+			std::swap(color0, color1);
+		// Equal endpoints read as the three color palette in BC1, which starts the same
+		if (!fourColorOnly && color0 == color1)
+			fourColor = false;
+		block.color0 = color0;
+		block.color1 = color1;
+
+		int palette[4][3];
+		BuildColorPalette(color0, color1, fourColor || fourColorOnly, palette);
+		const int entries = fourColor || fourColorOnly ? 4 : 3;
+		block.error = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			if (punchThrough && texels[i][3] < 128)
+			{
+				block.indices[i] = 3;
+				continue;
+			}
+			int bestError = std::numeric_limits<int>::max();
+			for (int entry = 0; entry < entries; entry++)
+			{
+				int error = Square(texels[i][0] - palette[entry][0]) + Square(texels[i][1] - palette[entry][1]) + Square(texels[i][2] - palette[entry][2]);
+				if (error < bestError)
+				{
+					bestError = error;
+					block.indices[i] = static_cast<uint8_t>(entry);
+				}
+			}
+			block.error += bestError;
+		}
+		return block;
+	}
+
+	// Pairs of 5 and 6 bit endpoints whose two thirds point comes closest to each 8 bit value, for blocks of one color
+	struct SingleColorTables
+	{
+		uint8_t match5[256][2];
+		uint8_t match6[256][2];
+
+		SingleColorTables()
+		{
+			Build(5, match5);
+			Build(6, match6);
+		}
+
+		static void Build(int bits, uint8_t table[256][2])
+		{
+			const int size = 1 << bits;
+			for (int value = 0; value < 256; value++)
+			{
+				int bestError = std::numeric_limits<int>::max();
+				for (int a = 0; a < size; a++)
+				{
+					for (int b = 0; b < size; b++)
+					{
+						int point = (2 * Expand(a, bits) + Expand(b, bits) + 1) / 3;
+						int error = std::abs(point - value) * 256 + std::abs(a - b);
+						if (error < bestError)
+						{
+							bestError = error;
+							table[value][0] = static_cast<uint8_t>(a);
+							table[value][1] = static_cast<uint8_t>(b);
+						}
+					}
+				}
+			}
+		}
+	};
+
+	void WriteColorBlock(const ColorBlock& block, uint8_t* output)
+	{
+		uint32_t indices = 0;
+		for (int i = 0; i < 16; i++)
+			indices |= static_cast<uint32_t>(block.indices[i]) << (i * 2);
+		output[0] = static_cast<uint8_t>(block.color0);
+		output[1] = static_cast<uint8_t>(block.color0 >> 8);
+		output[2] = static_cast<uint8_t>(block.color1);
+		output[3] = static_cast<uint8_t>(block.color1 >> 8);
+		memcpy(output + 4, &indices, 4);
+	}
+
+	void EncodeColorBlock(const Texels& texels, bool fourColorOnly, bool punchThrough, BlockQuality quality, uint8_t* output)
+	{
+		float points[16][4];
+		int members[16];
+		int count = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+				points[i][c] = texels[i][c];
+			if (!punchThrough || texels[i][3] >= 128)
+				members[count++] = i;
+		}
+		const bool transparent = count < 16;
+		// The four color palette has no transparent entry
+		const bool fourColor = !transparent;
+		if (count == 0)
+		{
+			WriteColorBlock(EvaluateColorBlock(texels, 0, 0, false, false, true), output);
+			return;
+		}
+
+		bool solid = true;
+		for (int i = 1; i < count; i++)
+			solid = solid && memcmp(texels[members[i]], texels[members[0]], 3) == 0;
+		if (solid && fourColor)
+		{
+			// Two thirds of the way between endpoints picked per channel is closer than either endpoint alone
+			static const SingleColorTables tables;
+			const uint8_t* color = texels[members[0]];
+			uint16_t color0 = static_cast<uint16_t>(tables.match5[color[0]][0] << 11 | tables.match6[color[1]][0] << 5 | tables.match5[color[2]][0]);
+			uint16_t color1 = static_cast<uint16_t>(tables.match5[color[0]][1] << 11 | tables.match6[color[1]][1] << 5 | tables.match5[color[2]][1]);
+			ColorBlock block = EvaluateColorBlock(texels, color0, color1, true, fourColorOnly, false);
+			WriteColorBlock(block, output);
+			return;
+		}
+
+		const Line line = FitLine(points, members, count, 0, 3);
+		float first[4], second[4];
+		GetLinePoint(line, line.high, first);
+		GetLinePoint(line, line.low, second);
+
+		ColorBlock best = EvaluateColorBlock(texels, ToRgb565(first), ToRgb565(second), fourColor, fourColorOnly, punchThrough);
+		// The three color palette trades a palette entry for the exact midpoint, worth a try when searching
+		const bool tryThreeColor = !fourColorOnly && fourColor && quality == BlockQuality::High;
+		if (tryThreeColor)
+		{
+			ColorBlock block = EvaluateColorBlock(texels, ToRgb565(first), ToRgb565(second), false, false, false);
+			if (block.error < best.error)
+				best = block;
+		}
+
+		static const float FourColorWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		static const float ThreeColorWeights[4] = { 1.0f, 0.0f, 0.5f, -1.0f };
+		const int iterations = GetIterationCount(quality);
+		for (int iteration = 0; iteration < iterations && best.error > 0; iteration++)
+		{
+			// Order of the stored endpoints tells which palette the indices refer to
+			const bool bestFourColor = fourColorOnly || best.color0 > best.color1;
+			uint8_t indices[16];
+			for (int i = 0; i < count; i++)
+				indices[i] = best.indices[members[i]];
+			if (!RefineEndpoints(points, members, count, 0, 3, indices, bestFourColor ? FourColorWeights : ThreeColorWeights, first, second))
+				break;
+			ColorBlock block = EvaluateColorBlock(texels, ToRgb565(first), ToRgb565(second), bestFourColor, fourColorOnly, punchThrough);
+			if (block.error >= best.error)
+				break;
+			best = block;
+		}
+
+		if (quality == BlockQuality::High)
+		{
+			// Nudges each channel of each endpoint by one step while that lowers the error
+			static const uint16_t Steps[3] = { 1 << 11, 1 << 5, 1 };
+			static const uint16_t Masks[3] = { 31 << 11, 63 << 5, 31 };
+			for (int pass = 0; pass < 2 && best.error > 0; pass++)
+			{
+				bool improved = false;
+				for (int endpoint = 0; endpoint < 2; endpoint++)
+				{
+					for (int c = 0; c < 3; c++)
+					{
+						for (int direction = -1; direction <= 1; direction += 2)
+						{
+							uint16_t color = endpoint == 0 ? best.color0 : best.color1;
+							int channel = (color & Masks[c]) / Steps[c] + direction;
+							if (channel < 0 || channel > Masks[c] / Steps[c])
+								continue;
+							color = static_cast<uint16_t>((color & ~Masks[c]) | channel * Steps[c]);
+							const bool bestFourColor = fourColorOnly || best.color0 > best.color1;
+							ColorBlock block = endpoint == 0 ? EvaluateColorBlock(texels, color, best.color1, bestFourColor, fourColorOnly, punchThrough) :
+								EvaluateColorBlock(texels, best.color0, color, bestFourColor, fourColorOnly, punchThrough);
+							if (block.error < best.error)
+							{
+								best = block;
+								improved = true;
+							}
+						}
+					}
+				}
+				if (!improved)
+					break;
+			}
+		}
+		WriteColorBlock(best, output);
+	}
+
+	void DecodeColorBlock(const uint8_t* input, bool fourColorOnly, Texels& texels)
+	{
+		const uint16_t color0 = static_cast<uint16_t>(input[0] | input[1] << 8);
+		const uint16_t color1 = static_cast<uint16_t>(input[2] | input[3] << 8);
+		const bool fourColor = fourColorOnly || color0 > color1;
+		int palette[4][3];
+		BuildColorPalette(color0, color1, fourColor, palette);
+		uint32_t indices;
+		memcpy(&indices, input + 4, 4);
+		for (int i = 0; i < 16; i++)
+		{
+			const int index = indices >> (i * 2) & 3;
+			for (int c = 0; c < 3; c++)
+				texels[i][c] = static_cast<uint8_t>(palette[index][c]);
+			texels[i][3] = !fourColor && index == 3 ? 0 : 255;
+		}
+	}
+
+	// -- BC4 single channel blocks, shared with BC3 alpha and BC5 -- //
+
+	// Eight interpolated values when endpoint0 > endpoint1, otherwise six plus 0 and 255
+	void BuildValuePalette(int endpoint0, int endpoint1, int palette[8])
+	{
+		palette[0] = endpoint0;
+		palette[1] = endpoint1;
+		if (endpoint0 > endpoint1)
+		{
+			for (int k = 1; k < 7; k++)
+				palette[1 + k] = ((7 - k) * endpoint0 + k * endpoint1 + 3) / 7;
+		}
+		else
+		{
+			for (int k = 1; k < 5; k++)
+				palette[1 + k] = ((5 - k) * endpoint0 + k * endpoint1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	struct ValueBlock
+	{
+		int endpoint0 = 0;
+		int endpoint1 = 0;
+		uint8_t indices[16] = {};
+		int error = std::numeric_limits<int>::max();
+	};
+
+	ValueBlock EvaluateValueBlock(const uint8_t values[16], int endpoint0, int endpoint1)
+	{
+		ValueBlock block;
+		block.endpoint0 = Clamp(endpoint0, 0, 255);
+		block.endpoint1 = Clamp(endpoint1, 0, 255);
+		int palette[8];
+		BuildValuePalette(block.endpoint0, block.endpoint1, palette);
+		block.error = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int bestError = std::numeric_limits<int>::max();
+			for (int entry = 0; entry < 8; entry++)
+			{
+				int error = Square(values[i] - palette[entry]);
+				if (error < bestError)
+				{
+					bestError = error;
+					block.indices[i] = static_cast<uint8_t>(entry);
+				}
+			}
+			block.error += bestError;
+		}
+		return block;
+	}
+
+	void EncodeValueBlock(const uint8_t values[16], BlockQuality quality, uint8_t* output)
+	{
+		int low = 255, high = 0;
+		int innerLow = 255, innerHigh = 0; // Leaving out 0 and 255, which the six value palette has for free
+		for (int i = 0; i < 16; i++)
+		{
+			low = std::min(low, static_cast<int>(values[i]));
+			high = std::max(high, static_cast<int>(values[i]));
+			if (values[i] > 0 && values[i] < 255)
+			{
+				innerLow = std::min(innerLow, static_cast<int>(values[i]));
+				innerHigh = std::max(innerHigh, static_cast<int>(values[i]));
+			}
+		}
+
+		ValueBlock best = EvaluateValueBlock(values, high, low);
+		if (low == high)
+		{
+			best = EvaluateValueBlock(values, low, low);
+		}
+		else if (quality != BlockQuality::Fast)
+		{
+			if (innerLow <= innerHigh)
+			{
+				ValueBlock block = EvaluateValueBlock(values, innerLow, innerHigh);
+				if (block.error < best.error)
+					best = block;
+			}
+
+			float points[16][4];
+			int members[16];
+			for (int i = 0; i < 16; i++)
+			{
+				points[i][0] = values[i];
+				members[i] = i;
+			}
+			static const float EightValueWeights[8] = { 1.0f, 0.0f, 6.0f / 7.0f, 5.0f / 7.0f, 4.0f / 7.0f, 3.0f / 7.0f, 2.0f / 7.0f, 1.0f / 7.0f };
+			const int iterations = GetIterationCount(quality);
+			for (int iteration = 0; iteration < iterations && best.error > 0 && best.endpoint0 > best.endpoint1; iteration++)
+			{
+				float first[4], second[4];
+				if (!RefineEndpoints(points, members, 16, 0, 1, best.indices, EightValueWeights, first, second))
+					break;
+				int endpoint0 = static_cast<int>(first[0] + 0.5f);
+				int endpoint1 = static_cast<int>(second[0] + 0.5f);
+				if (endpoint0 <= endpoint1)
+					break;
+				ValueBlock block = EvaluateValueBlock(values, endpoint0, endpoint1);
+				if (block.error >= best.error)
+					break;
+				best = block;
+			}
+
+			if (quality == BlockQuality::High && best.error > 0)
+			{
+				// Every pair of endpoints within a few steps of the best, keeping the palette the best one uses
+				const int center0 = best.endpoint0, center1 = best.endpoint1;
+				const bool eightValues = center0 > center1;
+				for (int delta0 = -3; delta0 <= 3; delta0++)
+				{
+					for (int delta1 = -3; delta1 <= 3; delta1++)
+					{
+						int endpoint0 = center0 + delta0, endpoint1 = center1 + delta1;
+						if (endpoint0 < 0 || endpoint0 > 255 || endpoint1 < 0 || endpoint1 > 255 || (endpoint0 > endpoint1) != eightValues)
+							continue;
+						ValueBlock block = EvaluateValueBlock(values, endpoint0, endpoint1);
+						if (block.error < best.error)
+							best = block;
+					}
+				}
+			}
+		}
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 16; i++)
+			indices |= static_cast<uint64_t>(best.indices[i]) << (i * 3);
+		output[0] = static_cast<uint8_t>(best.endpoint0);
+		output[1] = static_cast<uint8_t>(best.endpoint1);
+		for (int i = 0; i < 6; i++)
+			output[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+
+	void DecodeValueBlock(const uint8_t* input, uint8_t values[16])
+	{
+		int palette[8];
+		BuildValuePalette(input[0], input[1], palette);
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= static_cast<uint64_t>(input[2 + i]) << (i * 8);
+		for (int i = 0; i < 16; i++)
+			values[i] = static_cast<uint8_t>(palette[indices >> (i * 3) & 7]);
+	}
+
+	// -- BC7 -- //
+
+	struct Bc7Mode
+	{
+		int subsets;
+		int partitionBits;
+		int rotationBits;
+		int indexSelectionBits;
+		int colorBits;
+		int alphaBits; // 0 for modes without alpha, which decode it as 255
+		int endpointPBits; // One extra low bit per endpoint
+		int sharedPBits; // One extra low bit per subset
+		int indexBits;
+		int secondaryIndexBits; // Modes 4 and 5 index color and alpha separately
+	};
+
+	const Bc7Mode Bc7Modes[8] =
+	{
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+	};
+
+	// Two subset partitions, bit i set when texel i is in the second subset
+	const uint16_t Bc7Partitions2[64] =
+	{
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+	};
+
+	// Texel of the second subset whose index is stored one bit shorter, its top bit is always 0
+	const uint8_t Bc7Anchors2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+		6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+	};
+
+	const int Bc7Weights2[4] = { 0, 21, 43, 64 };
+	const int Bc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const int Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	const int* GetBc7Weights(int indexBits)
+	{
+		return indexBits == 2 ? Bc7Weights2 : (indexBits == 3 ? Bc7Weights3 : Bc7Weights4);
+	}
+
+	int GetBc7Subset(const Bc7Mode& mode, int partition, int texel)
+	{
+		return mode.subsets == 2 ? Bc7Partitions2[partition] >> texel & 1 : 0;
+	}
+
+	bool IsBc7Anchor(const Bc7Mode& mode, int partition, int texel)
+	{
+		return texel == 0 || (mode.subsets == 2 && texel == Bc7Anchors2[partition]);
+	}
+
+	// Everything a BC7 block stores, endpoints without their p-bits
+	struct Bc7Block
+	{
+		int mode = 6;
+		int partition = 0;
+		int rotation = 0;
+		int indexSelection = 0;
+		int endpoints[2][2][4] = {}; // Subset, endpoint, RGBA
+		int pBits[2][2] = {}; // Subset, endpoint. Shared ones are the same for both endpoints
+		uint8_t indices[16] = {};
+		uint8_t secondaryIndices[16] = {};
+	};
+
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(uint8_t* output) : output(output) { memset(output, 0, 16); }
+
+		void Write(uint32_t value, int bits)
+		{
+			for (int i = 0; i < bits; i++, this->position++)
+			{
+				if (value >> i & 1)
+					this->output[this->position >> 3] |= static_cast<uint8_t>(1 << (this->position & 7));
+			}
+		}
+
+	private:
+		uint8_t* output;
+		int position = 0;
+	};
+
+	class BitReader
+	{
+	public:
+		explicit BitReader(const uint8_t* input) : input(input) {}
+
+		int Read(int bits)
+		{
+			int value = 0;
+			for (int i = 0; i < bits; i++, this->position++)
+				value |= (this->input[this->position >> 3] >> (this->position & 7) & 1) << i;
+			return value;
+		}
+
+	private:
+		const uint8_t* input;
+		int position = 0;
+	};
+
+	void PackBc7(const Bc7Block& block, uint8_t* output)
+	{
+		const Bc7Mode& mode = Bc7Modes[block.mode];
+		BitWriter writer(output);
+		writer.Write(1u << block.mode, block.mode + 1);
+		writer.Write(block.partition, mode.partitionBits);
+		writer.Write(block.rotation, mode.rotationBits);
+		writer.Write(block.indexSelection, mode.indexSelectionBits);
+		for (int c = 0; c < 3; c++)
+		{
+			for (int s = 0; s < mode.subsets; s++)
+			{
+				writer.Write(block.endpoints[s][0][c], mode.colorBits);
+				writer.Write(block.endpoints[s][1][c], mode.colorBits);
+			}
+		}
+		for (int s = 0; s < mode.subsets && mode.alphaBits > 0; s++)
+		{
+			writer.Write(block.endpoints[s][0][3], mode.alphaBits);
+			writer.Write(block.endpoints[s][1][3], mode.alphaBits);
+		}
+		for (int s = 0; s < mode.subsets; s++)
+		{
+			if (mode.endpointPBits)
+			{
+				writer.Write(block.pBits[s][0], 1);
+				writer.Write(block.pBits[s][1], 1);
+			}
+			else if (mode.sharedPBits)
+			{
+				writer.Write(block.pBits[s][0], 1);
+			}
+		}
+		for (int i = 0; i < 16; i++)
+			writer.Write(block.indices[i], mode.indexBits - (IsBc7Anchor(mode, block.partition, i) ? 1 : 0));
+		for (int i = 0; i < 16 && mode.secondaryIndexBits > 0; i++)
+			writer.Write(block.secondaryIndices[i], mode.secondaryIndexBits - (i == 0 ? 1 : 0));
+	}
+
+	// False for the reserved mode, and for modes 0 and 2 whose three subset partitions are not known here
+	bool UnpackBc7(const uint8_t* input, Bc7Block& block)
+	{
+		if (input[0] == 0)
+			return false;
+		block.mode = 0;
+		while (!(input[0] >> block.mode & 1))
+			block.mode++;
+		const Bc7Mode& mode = Bc7Modes[block.mode];
+		if (mode.subsets > 2)
+			return false;
+
+		BitReader reader(input);
+		reader.Read(block.mode + 1);
+		block.partition = reader.Read(mode.partitionBits);
+		block.rotation = reader.Read(mode.rotationBits);
+		block.indexSelection = reader.Read(mode.indexSelectionBits);
+		for (int c = 0; c < 3; c++)
+		{
+			for (int s = 0; s < mode.subsets; s++)
+			{
+				block.endpoints[s][0][c] = reader.Read(mode.colorBits);
+				block.endpoints[s][1][c] = reader.Read(mode.colorBits);
+			}
+		}
+		for (int s = 0; s < mode.subsets && mode.alphaBits > 0; s++)
+		{
+			block.endpoints[s][0][3] = reader.Read(mode.alphaBits);
+			block.endpoints[s][1][3] = reader.Read(mode.alphaBits);
+		}
+		for (int s = 0; s < mode.subsets; s++)
+		{
+			if (mode.endpointPBits)
+			{
+				block.pBits[s][0] = reader.Read(1);
+				block.pBits[s][1] = reader.Read(1);
+			}
+			else if (mode.sharedPBits)
+			{
+				block.pBits[s][0] = block.pBits[s][1] = reader.Read(1);
+			}
+		}
+		for (int i = 0; i < 16; i++)
+			block.indices[i] = static_cast<uint8_t>(reader.Read(mode.indexBits - (IsBc7Anchor(mode, block.partition, i) ? 1 : 0)));
+		for (int i = 0; i < 16 && mode.secondaryIndexBits > 0; i++)
+			block.secondaryIndices[i] = static_cast<uint8_t>(reader.Read(mode.secondaryIndexBits - (i == 0 ? 1 : 0)));
+		return true;
+	}
+
+	// The 8 bit value of a stored endpoint channel
+	int DecodeBc7Channel(int value, int bits, int pBit, bool hasPBit)
+	{
+		if (hasPBit)
+		{
+			value = value << 1 | pBit;
+			bits++;
+		}
+		return Expand(value, bits);
+	}
+
+	void DecodeBc7Endpoints(const Bc7Block& block, int decoded[2][2][4])
+	{
+		const Bc7Mode& mode = Bc7Modes[block.mode];
+		const bool hasPBit = mode.endpointPBits || mode.sharedPBits;
+		for (int s = 0; s < mode.subsets; s++)
+		{
+			for (int e = 0; e < 2; e++)
+			{
+				for (int c = 0; c < 3; c++)
+					decoded[s][e][c] = DecodeBc7Channel(block.endpoints[s][e][c], mode.colorBits, block.pBits[s][e], hasPBit);
+				decoded[s][e][3] = mode.alphaBits > 0 ? DecodeBc7Channel(block.endpoints[s][e][3], mode.alphaBits, block.pBits[s][e], hasPBit) : 255;
+			}
+		}
+	}
+
+	int Interpolate(int first, int second, int weight)
+	{
+		return ((64 - weight) * first + weight * second + 32) >> 6;
+	}
+
+	void DecodeBc7(const Bc7Block& block, Texels& texels)
+	{
+		const Bc7Mode& mode = Bc7Modes[block.mode];
+		int decoded[2][2][4];
+		DecodeBc7Endpoints(block, decoded);
+
+		// Modes 4 and 5 index color with one set and alpha with the other, mode 4 can swap which is which
+		const bool swapIndices = block.indexSelection != 0;
+		const int colorBits = swapIndices ? mode.secondaryIndexBits : mode.indexBits;
+		const int alphaBits = mode.secondaryIndexBits == 0 ? mode.indexBits : (swapIndices ? mode.indexBits : mode.secondaryIndexBits);
+		const int* colorWeights = GetBc7Weights(colorBits);
+		const int* alphaWeights = GetBc7Weights(alphaBits);
+		for (int i = 0; i < 16; i++)
+		{
+			const int s = GetBc7Subset(mode, block.partition, i);
+			int colorIndex = block.indices[i];
+			int alphaIndex = block.indices[i];
+			if (mode.secondaryIndexBits > 0)
+			{
+				colorIndex = swapIndices ? block.secondaryIndices[i] : block.indices[i];
+				alphaIndex = swapIndices ? block.indices[i] : block.secondaryIndices[i];
+			}
+			for (int c = 0; c < 3; c++)
+				texels[i][c] = static_cast<uint8_t>(Interpolate(decoded[s][0][c], decoded[s][1][c], colorWeights[colorIndex]));
+			texels[i][3] = static_cast<uint8_t>(Interpolate(decoded[s][0][3], decoded[s][1][3], alphaWeights[alphaIndex]));
+			if (block.rotation > 0)
+				std::swap(texels[i][3], texels[i][block.rotation - 1]);
+		}
+	}
+
+	// Endpoints of one subset over channels first to first + count - 1, with the indices of its members
+	struct Bc7Fit
+	{
+		int endpoints[2][4] = {};
+		int pBits[2] = {};
+		uint8_t indices[16] = {};
+		int error = std::numeric_limits<int>::max();
+	};
+
+	// Rounds a channel to the mode's bits, with the p-bit when the mode has them. Returns the stored value and writes
+	// what it decodes to
+	int QuantizeBc7Channel(float value, int bits, int pBit, int& decoded)
+	{
+		const int top = (1 << bits) - 1;
+		if (pBit < 0)
+		{
+			int quantized = Clamp(static_cast<int>(value * top / 255.0f + 0.5f), 0, top);
+			decoded = Expand(quantized, bits);
+			return quantized;
+		}
+		const float full = value * ((2 << bits) - 1) / 255.0f;
+		int quantized = Clamp(static_cast<int>((full - pBit) * 0.5f + 0.5f), 0, top);
+		decoded = Expand(quantized << 1 | pBit, bits + 1);
+		return quantized;
+	}
+
+	class Bc7Fitter
+	{
+	public:
+		Bc7Fitter(const Bc7Mode& mode, const float (*points)[4], const Texels& texels, int first, int channels, int indexBits)
+			: mode(mode), points(points), texels(texels), first(first), channels(channels), indexBits(indexBits) {}
+
+		Bc7Fit Fit(const int* members, int count, int iterations) const
+		{
+			const Line line = FitLine(this->points, members, count, this->first, this->channels);
+			float endpoint0[4], endpoint1[4];
+			GetLinePoint(line, line.low, endpoint0);
+			GetLinePoint(line, line.high, endpoint1);
+
+			// Shared p-bits are tried both ways, per endpoint ones are picked by what rounds closer
+			Bc7Fit best;
+			const int sharedOptions = this->mode.sharedPBits ? 2 : 1;
+			for (int shared = 0; shared < sharedOptions; shared++)
+			{
+				float target0[4], target1[4];
+				memcpy(target0, endpoint0, sizeof(target0));
+				memcpy(target1, endpoint1, sizeof(target1));
+				Bc7Fit fit = Evaluate(members, count, target0, target1, shared);
+				for (int iteration = 0; iteration < iterations && fit.error > 0; iteration++)
+				{
+					float weights[16];
+					const int* table = GetBc7Weights(this->indexBits);
+					for (int i = 0; i < (1 << this->indexBits); i++)
+						weights[i] = 1.0f - table[i] / 64.0f;
+					if (!RefineEndpoints(this->points, members, count, this->first, this->channels, fit.indices, weights, target0, target1))
+						break;
+					Bc7Fit refined = Evaluate(members, count, target0, target1, shared);
+					if (refined.error >= fit.error)
+						break;
+					fit = refined;
+				}
+				if (fit.error < best.error)
+					best = fit;
+			}
+			return best;
+		}
+
+	private:
+		Bc7Fit Evaluate(const int* members, int count, const float target0[4], const float target1[4], int sharedPBit) const
+		{
+			Bc7Fit fit;
+			int decoded[2][4] = {};
+			const float* targets[2] = { target0, target1 };
+			for (int e = 0; e < 2; e++)
+			{
+				if (this->mode.endpointPBits)
+				{
+					int bestError = std::numeric_limits<int>::max();
+					for (int p = 0; p < 2; p++)
+					{
+						int quantized[4], values[4], error = 0;
+						for (int c = this->first; c < this->first + this->channels; c++)
+						{
+							quantized[c] = QuantizeBc7Channel(targets[e][c], GetBits(c), p, values[c]);
+							error += Square(values[c] - static_cast<int>(targets[e][c] + 0.5f));
+						}
+						if (error < bestError)
+						{
+							bestError = error;
+							fit.pBits[e] = p;
+							for (int c = this->first; c < this->first + this->channels; c++)
+							{
+								fit.endpoints[e][c] = quantized[c];
+								decoded[e][c] = values[c];
+							}
+						}
+					}
+				}
+				else
+				{
+					const int p = this->mode.sharedPBits ? sharedPBit : -1;
+					fit.pBits[e] = std::max(p, 0);
+					for (int c = this->first; c < this->first + this->channels; c++)
+						fit.endpoints[e][c] = QuantizeBc7Channel(targets[e][c], GetBits(c), p, decoded[e][c]);
+				}
+			}
+
+			const int entries = 1 << this->indexBits;
+			const int* weights = GetBc7Weights(this->indexBits);
+			int palette[16][4];
+			for (int entry = 0; entry < entries; entry++)
+			{
+				for (int c = this->first; c < this->first + this->channels; c++)
+					palette[entry][c] = Interpolate(decoded[0][c], decoded[1][c], weights[entry]);
+			}
+			// The palette lies on a line, projecting onto it finds the closest entry give or take one
+			float direction[4] = {};
+			float lengthSquared = 0.0f;
+			for (int c = this->first; c < this->first + this->channels; c++)
+			{
+				direction[c] = static_cast<float>(decoded[1][c] - decoded[0][c]);
+				lengthSquared += direction[c] * direction[c];
+			}
+			const float scale = lengthSquared > 0.0f ? (entries - 1) / lengthSquared : 0.0f;
+			fit.error = 0;
+			for (int i = 0; i < count; i++)
+			{
+				const uint8_t* texel = this->texels[members[i]];
+				float t = 0.0f;
+				for (int c = this->first; c < this->first + this->channels; c++)
+					t += (texel[c] - decoded[0][c]) * direction[c];
+				const int guess = Clamp(static_cast<int>(t * scale + 0.5f), 0, entries - 1);
+				int bestError = std::numeric_limits<int>::max();
+				for (int entry = std::max(guess - 1, 0); entry <= std::min(guess + 1, entries - 1); entry++)
+				{
+					int error = 0;
+					for (int c = this->first; c < this->first + this->channels; c++)
+						error += Square(texel[c] - palette[entry][c]);
+					if (error < bestError)
+					{
+						bestError = error;
+						fit.indices[i] = static_cast<uint8_t>(entry);
+					}
+				}
+				fit.error += bestError;
+			}
+			return fit;
+		}
+
+		int GetBits(int channel) const
+		{
+			return channel < 3 ? this->mode.colorBits : this->mode.alphaBits;
+		}
+
+		const Bc7Mode& mode;
+		const float (*points)[4];
+		const Texels& texels;
+		int first;
+		int channels;
+		int indexBits;
+	};
+
+	// Keeps the top bit of the index at anchor 0 by swapping the endpoints of the subset and flipping its indices
+	void FixBc7Anchor(Bc7Block& block, uint8_t* indices, int indexBits, int subset, int anchor, int firstChannel, int channelCount)
+	{
+		const Bc7Mode& mode = Bc7Modes[block.mode];
+		const int top = (1 << indexBits) - 1;
+		if (indices[anchor] <= top >> 1)
+			return;
+		for (int c = firstChannel; c < firstChannel + channelCount; c++)
+			std::swap(block.endpoints[subset][0][c], block.endpoints[subset][1][c]);
+		if (mode.endpointPBits)
+			std::swap(block.pBits[subset][0], block.pBits[subset][1]);
+		for (int i = 0; i < 16; i++)
+		{
+			if (GetBc7Subset(mode, block.partition, i) == subset)
+				indices[i] = static_cast<uint8_t>(top - indices[i]);
+		}
+	}
+
+	struct Bc7Candidate
+	{
+		Bc7Block block;
+		int error = std::numeric_limits<int>::max();
+	};
+
+	// Modes with one index per texel: 1 and 3 for opaque blocks, 6 and 7
+	void TryBc7Mode(const Texels& texels, const float (*points)[4], int modeIndex, int partition, int iterations, Bc7Candidate& best)
+	{
+		const Bc7Mode& mode = Bc7Modes[modeIndex];
+		const int channels = mode.alphaBits > 0 ? 4 : 3;
+		Bc7Fitter fitter(mode, points, texels, 0, channels, mode.indexBits);
+		Bc7Candidate candidate;
+		candidate.block.mode = modeIndex;
+		candidate.block.partition = partition;
+		candidate.error = 0;
+		for (int s = 0; s < mode.subsets; s++)
+		{
+			int members[16];
+			int count = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				if (GetBc7Subset(mode, partition, i) == s)
+					members[count++] = i;
+			}
+			Bc7Fit fit = fitter.Fit(members, count, iterations);
+			candidate.error += fit.error;
+			if (candidate.error >= best.error)
+				return;
+			memcpy(candidate.block.endpoints[s], fit.endpoints, sizeof(fit.endpoints));
+			candidate.block.pBits[s][0] = fit.pBits[0];
+			candidate.block.pBits[s][1] = fit.pBits[1];
+			for (int i = 0; i < count; i++)
+				candidate.block.indices[members[i]] = fit.indices[i];
+		}
+		for (int s = 0; s < mode.subsets; s++)
+			FixBc7Anchor(candidate.block, candidate.block.indices, mode.indexBits, s, s == 0 ? 0 : Bc7Anchors2[partition], 0, 4);
+		best = candidate;
+	}
+
+	// Modes 4 and 5, color and alpha with their own indices. rotation swaps alpha with a color channel first so the
+	// channel that varies on its own gets the separate indices
+	void TryBc7SeparateAlphaMode(const Texels& texels, int modeIndex, int rotation, int indexSelection, int iterations, Bc7Candidate& best)
+	{
+		const Bc7Mode& mode = Bc7Modes[modeIndex];
+		Texels rotated;
+		float points[16][4];
+		int members[16];
+		for (int i = 0; i < 16; i++)
+		{
+			memcpy(rotated[i], texels[i], 4);
+			if (rotation > 0)
+				std::swap(rotated[i][3], rotated[i][rotation - 1]);
+			for (int c = 0; c < 4; c++)
+				points[i][c] = rotated[i][c];
+			members[i] = i;
+		}
+
+		const int colorBits = indexSelection ? mode.secondaryIndexBits : mode.indexBits;
+		const int alphaBits = indexSelection ? mode.indexBits : mode.secondaryIndexBits;
+		Bc7Fit color = Bc7Fitter(mode, points, rotated, 0, 3, colorBits).Fit(members, 16, iterations);
+		if (color.error >= best.error)
+			return;
+		Bc7Fit alpha = Bc7Fitter(mode, points, rotated, 3, 1, alphaBits).Fit(members, 16, iterations);
+		if (color.error + alpha.error >= best.error)
+			return;
+
+		Bc7Candidate candidate;
+		candidate.error = color.error + alpha.error;
+		Bc7Block& block = candidate.block;
+		block.mode = modeIndex;
+		block.rotation = rotation;
+		block.indexSelection = indexSelection;
+		for (int e = 0; e < 2; e++)
+		{
+			for (int c = 0; c < 3; c++)
+				block.endpoints[0][e][c] = color.endpoints[e][c];
+			block.endpoints[0][e][3] = alpha.endpoints[e][3];
+		}
+		uint8_t* colorIndices = indexSelection ? block.secondaryIndices : block.indices;
+		uint8_t* alphaIndices = indexSelection ? block.indices : block.secondaryIndices;
+		memcpy(colorIndices, color.indices, 16);
+		memcpy(alphaIndices, alpha.indices, 16);
+		FixBc7Anchor(block, colorIndices, colorBits, 0, 0, 0, 3);
+		FixBc7Anchor(block, alphaIndices, alphaBits, 0, 0, 3, 1);
+		best = candidate;
+	}
+
+	void EncodeBc7Block(const Texels& texels, BlockQuality quality, uint8_t* output)
+	{
+		float points[16][4];
+		bool opaque = true;
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+				points[i][c] = texels[i][c];
+			opaque = opaque && texels[i][3] == 255;
+		}
+
+		const int iterations = GetIterationCount(quality);
+		Bc7Candidate best;
+		TryBc7Mode(texels, points, 6, 0, iterations, best);
+		if (quality != BlockQuality::Fast && best.error > 0)
+		{
+			// Partitions ranked by how far their subsets stray from a line, only the most promising get a full fit
+			// Alpha of opaque blocks is constant and adds nothing to the spread
+			Moments texelMoments[16];
+			Moments block;
+			for (int i = 0; i < 16; i++)
+			{
+				texelMoments[i] = Moments::Of(points[i]);
+				block.Add(texelMoments[i]);
+			}
+			std::pair<float, int> ranking[64];
+			for (int partition = 0; partition < 64; partition++)
+			{
+				Moments second;
+				for (int i = 0; i < 16; i++)
+				{
+					if (Bc7Partitions2[partition] >> i & 1)
+						second.Add(texelMoments[i]);
+				}
+				ranking[partition] = std::make_pair(block.Subtract(second).GetResidual() + second.GetResidual(), partition);
+			}
+			const int candidates = quality == BlockQuality::High ? 16 : 2;
+			std::partial_sort(ranking, ranking + candidates, ranking + 64);
+
+			for (int i = 0; i < candidates && best.error > 0; i++)
+			{
+				if (opaque)
+				{
+					TryBc7Mode(texels, points, 1, ranking[i].second, iterations, best);
+					TryBc7Mode(texels, points, 3, ranking[i].second, iterations, best);
+				}
+				else
+				{
+					TryBc7Mode(texels, points, 7, ranking[i].second, iterations, best);
+				}
+			}
+
+			const int rotations = quality == BlockQuality::High ? 4 : 1;
+			for (int rotation = 0; rotation < rotations && best.error > 0; rotation++)
+			{
+				TryBc7SeparateAlphaMode(texels, 5, rotation, 0, iterations, best);
+				if (quality == BlockQuality::High)
+				{
+					TryBc7SeparateAlphaMode(texels, 4, rotation, 0, iterations, best);
+					TryBc7SeparateAlphaMode(texels, 4, rotation, 1, iterations, best);
+				}
+			}
+		}
+		PackBc7(best.block, output);
+	}
+
+	// -- Whole blocks per format -- //
+
+	void EncodeBlock(const Texels& texels, PixelFormat format, BlockQuality quality, uint8_t* output)
+	{
+		uint8_t values[16];
+		switch (format)
+		{
+		case PixelFormat::BC1_UNORM:
+			EncodeColorBlock(texels, false, true, quality, output);
+			break;
+		case PixelFormat::BC3_UNORM:
+			for (int i = 0; i < 16; i++)
+				values[i] = texels[i][3];
+			EncodeValueBlock(values, quality, output);
+			EncodeColorBlock(texels, true, false, quality, output + 8);
+			break;
+		case PixelFormat::BC4_UNORM:
+		case PixelFormat::BC5_UNORM:
+			for (int c = 0; c < (format == PixelFormat::BC5_UNORM ? 2 : 1); c++)
+			{
+				for (int i = 0; i < 16; i++)
+					values[i] = texels[i][c];
+				EncodeValueBlock(values, quality, output + c * 8);
+			}
+			break;
+		default:
+			EncodeBc7Block(texels, quality, output);
+			break;
+		}
+	}
+
+	bool DecodeBlock(const uint8_t* input, PixelFormat format, Texels& texels)
+	{
+		uint8_t values[16];
+		Bc7Block block;
+		switch (format)
+		{
+		case PixelFormat::BC1_UNORM:
+			DecodeColorBlock(input, false, texels);
+			return true;
+		case PixelFormat::BC3_UNORM:
+			DecodeColorBlock(input + 8, true, texels);
+			DecodeValueBlock(input, values);
+			for (int i = 0; i < 16; i++)
+				texels[i][3] = values[i];
+			return true;
+		case PixelFormat::BC4_UNORM:
+		case PixelFormat::BC5_UNORM:
+			memset(texels, 0, sizeof(Texels));
+			for (int c = 0; c < (format == PixelFormat::BC5_UNORM ? 2 : 1); c++)
+			{
+				DecodeValueBlock(input + c * 8, values);
+				for (int i = 0; i < 16; i++)
+					texels[i][c] = values[i];
+			}
+			for (int i = 0; i < 16; i++)
+				texels[i][3] = 255;
+			return true;
+		default:
+			if (input[0] == 0)
+			{
+				// The reserved mode decodes to transparent black
+				memset(texels, 0, sizeof(Texels));
+				return true;
+			}
+			if (!UnpackBc7(input, block))
+				return false;
+			DecodeBc7(block, texels);
+			return true;
+		}
+	}
+
+	// Decodes one level of a block compressed image into a tightly packed RGBA8 one
+	bool DecompressLevel(const ImageData& source, uint32_t level, uint8_t* output, ThreadPool& pool)
+	{
+		const ImageDescription& description = source.description;
+		const uint32_t width = description.GetLevelWidth(level);
+		const uint32_t height = description.GetLevelHeight(level);
+		const uint32_t blocksWide = (width + 3) / 4;
+		const uint32_t blocksHigh = (height + 3) / 4;
+		const uint32_t blockBytes = ImageDescription::GetBytesPerBlock(description.format);
+		const uint32_t rowPitch = description.GetLevelRowPitch(level);
+		const uint8_t* blocks = source.pixels.data() + description.GetLevelOffset(level);
+
+		std::atomic<bool> failed(false);
+		const size_t bands = (blocksHigh + BlockRowsPerBand - 1) / BlockRowsPerBand;
+		pool.ParallelFor(bands, [&](size_t band)
+		{
+			const uint32_t last = std::min(blocksHigh, static_cast<uint32_t>(band + 1) * BlockRowsPerBand);
+			for (uint32_t blockY = static_cast<uint32_t>(band) * BlockRowsPerBand; blockY < last; blockY++)
+			{
+				for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+				{
+					Texels texels;
+					if (!DecodeBlock(blocks + static_cast<size_t>(blockY) * rowPitch + static_cast<size_t>(blockX) * blockBytes, description.format, texels))
+					{
+						failed = true;
+						return;
+					}
+					ScatterBlock(texels, output, width, height, width * 4, blockX, blockY);
+				}
+			}
+		});
+		return !failed;
+	}
+}
+
+bool BlockCompressor::Compress(const ImageData& source, PixelFormat format, BlockQuality quality, ImageData& output, ThreadPool& pool)
+{
+	const ImageDescription& description = source.description;
+	if (!ImageDescription::IsBlockCompressed(format) || (description.format != PixelFormat::R8G8B8A8_UNORM && description.format != PixelFormat::R8_UNORM))
+		return false;
+	if (description.width == 0 || description.height == 0 || source.pixels.size() < description.GetSize())
+		return false;
+
+	const int channels = description.format == PixelFormat::R8_UNORM ? 1 : 4;
+	const uint32_t blockBytes = ImageDescription::GetBytesPerBlock(format);
+	ImageData compressed;
+	compressed.description = description;
+	compressed.description.format = format;
+	compressed.description.rowPitch = (description.width + 3) / 4 * blockBytes;
+	compressed.pixels.resize(static_cast<size_t>(compressed.description.GetSize()));
+
+	for (uint32_t level = 0; level < description.mipLevels; level++)
+	{
+		const uint32_t width = description.GetLevelWidth(level);
+		const uint32_t height = description.GetLevelHeight(level);
+		const uint32_t sourcePitch = description.GetLevelRowPitch(level);
+		const uint32_t blocksWide = (width + 3) / 4;
+		const uint32_t blocksHigh = (height + 3) / 4;
+		const uint32_t pitch = compressed.description.GetLevelRowPitch(level);
+		const uint8_t* texels = source.pixels.data() + description.GetLevelOffset(level);
+		uint8_t* blocks = compressed.pixels.data() + compressed.description.GetLevelOffset(level);
+
+		const size_t bands = (blocksHigh + BlockRowsPerBand - 1) / BlockRowsPerBand;
+		pool.ParallelFor(bands, [&](size_t band)
+		{
+			const uint32_t last = std::min(blocksHigh, static_cast<uint32_t>(band + 1) * BlockRowsPerBand);
+			for (uint32_t blockY = static_cast<uint32_t>(band) * BlockRowsPerBand; blockY < last; blockY++)
+			{
+				for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+				{
+					Texels block;
+					GatherBlock(texels, width, height, sourcePitch, channels, blockX, blockY, block);
+					EncodeBlock(block, format, quality, blocks + static_cast<size_t>(blockY) * pitch + static_cast<size_t>(blockX) * blockBytes);
+				}
+			}
+		});
+	}
+	output = std::move(compressed);
+	return true;
+}
+
+bool BlockCompressor::Compress(const ImageData& source, PixelFormat format, BlockQuality quality, ImageData& output)
+{
+	return Compress(source, format, quality, output, ThreadPool::GetShared());
+}
+
+bool BlockCompressor::Decompress(const ImageData& source, ImageData& output, ThreadPool& pool)
+{
+	const ImageDescription& description = source.description;
+	if (!ImageDescription::IsBlockCompressed(description.format) || source.pixels.size() < description.GetSize())
+		return false;
+
+	ImageData decompressed;
+	decompressed.description = description;
+	decompressed.description.format = PixelFormat::R8G8B8A8_UNORM;
+	decompressed.description.rowPitch = description.width * 4;
+	decompressed.pixels.resize(static_cast<size_t>(decompressed.description.GetSize()));
+	for (uint32_t level = 0; level < description.mipLevels; level++)
+	{
+		if (!DecompressLevel(source, level, decompressed.pixels.data() + decompressed.description.GetLevelOffset(level), pool))
+			return false;
+	}
+	output = std::move(decompressed);
+	return true;
+}
+
+bool BlockCompressor::Decompress(const ImageData& source, ImageData& output)
+{
+	return Decompress(source, output, ThreadPool::GetShared());
+}
+
+PixelFormat BlockCompressor::ChooseFormat(const std::string& filepath, const ImageData& image, BlockQuality quality)
+{
+	if (image.description.format == PixelFormat::R8_UNORM)
+		return PixelFormat::BC4_UNORM;
+
+	static const char* const grayMaps[] = { "roughness", "gloss", "metalness", "metallic", "ao", "cavity", "bump", "displacement", "height", "opacity", "mask" };
+	for (const std::string& word : StringHelper::GetFileNameWords(filepath))
+	{
+		if (word == "normal")
+			return PixelFormat::BC5_UNORM;
+		for (const char* name : grayMaps)
+		{
+			if (word == name)
+				return PixelFormat::BC4_UNORM;
+		}
+	}
+
+	if (quality == BlockQuality::High)
+		return PixelFormat::BC7_UNORM;
+	const ImageDescription& description = image.description;
+	for (uint32_t y = 0; y < description.height && description.format == PixelFormat::R8G8B8A8_UNORM; y++)
+	{
+		const uint8_t* row = image.pixels.data() + static_cast<size_t>(y) * description.rowPitch;
+		for (uint32_t x = 0; x < description.width; x++)
+		{
+			if (row[x * 4 + 3] != 255)
+				return PixelFormat::BC3_UNORM;
+		}
+	}
+	return PixelFormat::BC1_UNORM;
+}
+
+double BlockCompressor::ComputePsnr(const ImageData& source, const ImageData& compressed, uint32_t level)
+{
+	const ImageDescription& description = source.description;
+	if (level >= description.mipLevels || level >= compressed.description.mipLevels || compressed.description.width != description.width ||
+		compressed.description.height != description.height || (description.format != PixelFormat::R8G8B8A8_UNORM && description.format != PixelFormat::R8_UNORM))
+		return 0.0;
+
+	const uint32_t width = description.GetLevelWidth(level);
+	const uint32_t height = description.GetLevelHeight(level);
+	std::vector<uint8_t> decoded(static_cast<size_t>(width) * height * 4);
+	if (!DecompressLevel(compressed, level, decoded.data(), ThreadPool::GetShared()))
+		return 0.0;
+
+	int firstChannel = 0, lastChannel = 4;
+	switch (compressed.description.format)
+	{
+	case PixelFormat::BC1_UNORM: lastChannel = 3; break;
+	case PixelFormat::BC4_UNORM: lastChannel = 1; break;
+	case PixelFormat::BC5_UNORM: lastChannel = 2; break;
+	default: break;
+	}
+
+	const int channels = description.format == PixelFormat::R8_UNORM ? 1 : 4;
+	const uint8_t* texels = source.pixels.data() + description.GetLevelOffset(level);
+	const uint32_t pitch = description.GetLevelRowPitch(level);
+	// BC1 stores texels below half alpha as transparent black, their color does not count
+	const bool skipTransparent = compressed.description.format == PixelFormat::BC1_UNORM && channels == 4;
+	double squaredError = 0.0;
+	double samples = 0.0;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const uint8_t* texel = texels + static_cast<size_t>(y) * pitch + static_cast<size_t>(x) * channels;
+			const uint8_t* result = decoded.data() + (static_cast<size_t>(y) * width + x) * 4;
+			if (skipTransparent && texel[3] < 128)
+				continue;
+			samples += lastChannel - firstChannel;
+			for (int c = firstChannel; c < lastChannel; c++)
+			{
+				const int expected = channels == 1 ? (c < 3 ? texel[0] : 255) : texel[c];
+				squaredError += Square(expected - result[c]);
+			}
+		}
+	}
+	const double meanSquaredError = samples > 0.0 ? squaredError / samples : 0.0;
+	if (meanSquaredError <= 0.0)
+		return std::numeric_limits<double>::infinity();
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+const char* BlockCompressor::GetFormatName(PixelFormat format)
+{
+	switch (format)
+	{
+	case PixelFormat::BC1_UNORM: return "BC1";
+	case PixelFormat::BC3_UNORM: return "BC3";
+	case PixelFormat::BC4_UNORM: return "BC4";
+	case PixelFormat::BC5_UNORM: return "BC5";
+	case PixelFormat::BC7_UNORM: return "BC7";
+	case PixelFormat::R8G8B8A8_UNORM: return "RGBA8";
+	case PixelFormat::R16G16B16A16_UNORM: return "RGBA16";
+	case PixelFormat::R8_UNORM: return "R8";
+	case PixelFormat::R16_UNORM: return "R16";
+	default: return "Unknown";
+	}
+}
+
+const char* BlockCompressor::GetQualityName(BlockQuality quality)
+{
+	switch (quality)
+	{
+	case BlockQuality::Fast: return "Fast";
+	case BlockQuality::Normal: return "Normal";
+	default: return "High";
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "ImageData.h"
+#include <string>
+
+class ThreadPool;
+
+enum class BlockQuality
+{
+	Fast, // One endpoint fit per block, BC7 only tries mode 6. For quick iteration on content
+	Normal, // Refined endpoints, BC7 also tries the two subset modes on the most promising partitions
+	High, // Endpoint search, every BC7 partition estimate and rotation. For shipping builds
+};
+
+// Compresses images into the block formats GPUs sample directly, 4x4 texels per 8 or 16 byte block:
+//
+//   BC1  RGB, or RGB with cutout alpha. 4 bits per texel
+//   BC3  BC1 color with a BC4 alpha block. 8 bits per texel
+//   BC4  One channel, roughness, opacity and other gray maps. 4 bits per texel
+//   BC5  Two BC4 channels, the XY of normal maps. 8 bits per texel
+//   BC7  RGB or RGBA with eight block modes. 8 bits per texel, much closer to the source than BC1 and BC3
+//
+// Endpoints are fitted along the principal axis of the block colors and refined by least squares against the chosen
+// indices, BC7 picks the mode and partition with the least error. Rows of blocks run on the pool.
+//
+// The BC7 encoder writes modes 1, 3, 4, 5, 6 and 7. Modes 0 and 2 split blocks in three subsets and are never chosen,
+// Decompress fails on blocks that use them
+class BlockCompressor
+{
+public:
+	// Compresses every level of source, which has to be R8G8B8A8_UNORM or R8_UNORM. BC4 keeps the red channel and BC5
+	// red and green
+	static bool Compress(const ImageData& source, PixelFormat format, BlockQuality quality, ImageData& output, ThreadPool& pool);
+	static bool Compress(const ImageData& source, PixelFormat format, BlockQuality quality, ImageData& output);
+
+	// Every level back to R8G8B8A8_UNORM, channels the format does not store are 0, alpha 255
+	static bool Decompress(const ImageData& source, ImageData& output, ThreadPool& pool);
+	static bool Decompress(const ImageData& source, ImageData& output);
+
+	// Format for a texture from its naming, like MipGenerator::GetSettingsForFile: normal maps are BC5, gray data
+	// maps BC4, color BC7 at High quality and otherwise BC1, or BC3 when image has alpha
+	static PixelFormat ChooseFormat(const std::string& filepath, const ImageData& image, BlockQuality quality);
+
+	// Peak signal to noise ratio of a level of compressed against source in dB, over the channels the format stores.
+	// BC1 leaves out texels below half alpha. Higher is closer, identical images give infinity
+	static double ComputePsnr(const ImageData& source, const ImageData& compressed, uint32_t level);
+
+	static const char* GetFormatName(PixelFormat format);
+	static const char* GetQualityName(BlockQuality quality);
+};
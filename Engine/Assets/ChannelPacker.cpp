@@ -0,0 +1,566 @@
+#include "ChannelPacker.h"
+#include "ContentHash.h"
+#include "DdsFile.h"
+#include "ImageDecoder.h"
+#include "JsonReader.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "../FileHelper.h"
+#include "../StringHelper.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+const char* const PackedTextureLayout::Extension = "layout.json";
+
+namespace
+{
+	const char* const ChannelNames[] = { "r", "g", "b", "a" };
+	const uint32_t RowsPerBand = 64;
+
+	std::string JoinPath(const std::string& directory, const std::string& path)
+	{
+		return directory.empty() ? path : directory + "/" + path;
+	}
+
+	int GetChannelIndex(const std::string& name)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			if (name == ChannelNames[c])
+				return c;
+		}
+		return -1;
+	}
+
+	std::string ToLower(std::string text)
+	{
+		for (char& c : text)
+			c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+		return text;
+	}
+
+	bool IsImageFile(const std::string& name)
+	{
+		const std::string extension = ToLower(StringHelper::GetFileExtension(name));
+		return extension == "jpg" || extension == "jpeg" || extension == "png";
+	}
+
+	// "qlCc6_4K_Roughness.jpg" without the part that is map -> "qlCc6_4K". Empty if no part of the name is map
+	std::string GetPrefixWithout(const std::string& filename, const std::string& map)
+	{
+		const size_t extensionOffset = filename.find_last_of('.');
+		const std::string name = filename.substr(0, extensionOffset);
+		std::vector<std::string> parts;
+		size_t start = 0;
+		for (size_t i = 0; i <= name.size(); i++)
+		{
+			if (i == name.size() || name[i] == '_' || name[i] == '-' || name[i] == ' ')
+			{
+				if (i > start)
+					parts.push_back(name.substr(start, i - start));
+				start = i + 1;
+			}
+		}
+
+		std::string prefix;
+		bool found = false;
+		for (const std::string& part : parts)
+		{
+			if (!found && ToLower(part) == map)
+			{
+				found = true;
+				continue;
+			}
+			prefix += prefix.empty() ? part : "_" + part;
+		}
+		return found && !prefix.empty() ? prefix : std::string();
+	}
+
+	uint8_t ToByte(float value)
+	{
+		return static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, value)) * 255.0f + 0.5f);
+	}
+
+	PixelFormat ParseFormat(const std::string& name)
+	{
+		const std::string lower = ToLower(name);
+		if (lower == "bc1")
+			return PixelFormat::BC1_UNORM;
+		if (lower == "bc3")
+			return PixelFormat::BC3_UNORM;
+		if (lower == "bc4")
+			return PixelFormat::BC4_UNORM;
+		if (lower == "bc5")
+			return PixelFormat::BC5_UNORM;
+		if (lower == "bc7")
+			return PixelFormat::BC7_UNORM;
+		if (lower == "rgba8")
+			return PixelFormat::R8G8B8A8_UNORM;
+		return PixelFormat::Unknown;
+	}
+
+	bool ParseChannel(JsonReader& reader, PackedChannelSource& channel)
+	{
+		if (reader.Next() != JsonToken::ObjectStart)
+			return false;
+		return reader.ForEachMember([&]()
+		{
+			if (reader.StringEquals("map"))
+			{
+				if (!reader.NextString(channel.map))
+					return false;
+				channel.map = ToLower(channel.map);
+				return true;
+			}
+			if (reader.StringEquals("source"))
+			{
+				std::string source;
+				if (!reader.NextString(source))
+					return false;
+				channel.sourceChannel = std::max(0, GetChannelIndex(ToLower(source)));
+				return true;
+			}
+			if (reader.StringEquals("invert"))
+				return reader.NextBool(channel.invert);
+			if (reader.StringEquals("value"))
+			{
+				double value = channel.value;
+				if (!reader.NextNumber(value))
+					return false;
+				channel.value = static_cast<float>(value);
+				return true;
+			}
+			return reader.SkipValue();
+		});
+	}
+
+	bool ParseRule(JsonReader& reader, ChannelPackingRule& rule)
+	{
+		return reader.ForEachMember([&]()
+		{
+			if (reader.StringEquals("name"))
+				return reader.NextString(rule.name);
+			if (reader.StringEquals("format"))
+			{
+				std::string format;
+				if (!reader.NextString(format))
+					return false;
+				rule.format = ParseFormat(format);
+				return true;
+			}
+			if (reader.StringEquals("minimumMaps"))
+				return reader.NextUInt(rule.minimumMaps);
+			for (int c = 0; c < 4; c++)
+			{
+				if (reader.StringEquals(ChannelNames[c]))
+					return ParseChannel(reader, rule.channels[c]);
+			}
+			return reader.SkipValue();
+		});
+	}
+
+	void AppendString(std::string& json, const std::string& value)
+	{
+		json += '"';
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+				json += '\\';
+			json += c;
+		}
+		json += '"';
+	}
+
+	// "Surface" and "roughness" -> "SURFACE_ROUGHNESS"
+	std::string GetDefineName(const std::string& rule, const std::string& map)
+	{
+		std::string name = rule + "_" + map;
+		for (char& c : name)
+			c = isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(toupper(static_cast<unsigned char>(c))) : '_';
+		return name;
+	}
+}
+
+int ChannelPackingRule::GetUsedChannelCount() const
+{
+	int count = 0;
+	for (const PackedChannelSource& channel : this->channels)
+		count += channel.map.empty() ? 0 : 1;
+	return count;
+}
+
+bool ChannelPackingRules::Read(const std::string& filepath)
+{
+	MappedFile file;
+	if (!file.Open(filepath))
+		return false;
+	return Parse(reinterpret_cast<const char*>(file.Data()), file.Size(), *this);
+}
+
+bool ChannelPackingRules::Parse(const char* json, size_t size, ChannelPackingRules& rules)
+{
+	rules.rules.clear();
+	JsonReader reader(json, size);
+	if (reader.Next() != JsonToken::ObjectStart)
+		return false;
+
+	uint32_t version = 0;
+	bool parsed = reader.ForEachMember([&]()
+	{
+		if (reader.StringEquals("version"))
+			return reader.NextUInt(version);
+		if (!reader.StringEquals("rules"))
+			return reader.SkipValue();
+		if (reader.Next() != JsonToken::ArrayStart)
+			return false;
+		for (;;)
+		{
+			JsonToken token = reader.Next();
+			if (token == JsonToken::ArrayEnd)
+				return true;
+			ChannelPackingRule rule;
+			if (token != JsonToken::ObjectStart || !ParseRule(reader, rule))
+				return false;
+			if (!rule.name.empty() && rule.GetUsedChannelCount() > 0)
+				rules.rules.push_back(rule);
+		}
+	});
+	return parsed && reader.Next() == JsonToken::End && version == Version;
+}
+
+int PackedTextureLayout::FindChannel(const std::string& map) const
+{
+	for (int c = 0; c < 4; c++)
+	{
+		if (!map.empty() && this->maps[c] == map)
+			return c;
+	}
+	return -1;
+}
+
+const char* PackedTextureLayout::GetSwizzle(int channel)
+{
+	static const char* const swizzles[] = { ".r", ".g", ".b", ".a" };
+	return channel >= 0 && channel < 4 ? swizzles[channel] : "";
+}
+
+void PackedTextureLayout::GetChannelMask(const std::string& map, float mask[4]) const
+{
+	const int channel = FindChannel(map);
+	for (int c = 0; c < 4; c++)
+		mask[c] = c == channel ? 1.0f : 0.0f;
+}
+
+bool PackedTextureLayout::Read(const std::string& filepath)
+{
+	*this = PackedTextureLayout();
+	MappedFile file;
+	if (!file.Open(filepath))
+		return false;
+
+	JsonReader reader(reinterpret_cast<const char*>(file.Data()), file.Size());
+	if (reader.Next() != JsonToken::ObjectStart)
+		return false;
+
+	uint32_t version = 0;
+	uint32_t format = 0;
+	std::string hash;
+	bool parsed = reader.ForEachMember([&]()
+	{
+		if (reader.StringEquals("version"))
+			return reader.NextUInt(version);
+		if (reader.StringEquals("texture"))
+			return reader.NextString(this->texture);
+		if (reader.StringEquals("rule"))
+			return reader.NextString(this->rule);
+		if (reader.StringEquals("sourceHash"))
+			return reader.NextString(hash);
+		if (reader.StringEquals("format"))
+			return reader.NextUInt(format);
+		if (!reader.StringEquals("channels"))
+			return reader.SkipValue();
+		if (reader.Next() != JsonToken::ArrayStart)
+			return false;
+		for (;;)
+		{
+			JsonToken token = reader.Next();
+			if (token == JsonToken::ArrayEnd)
+				return true;
+			if (token != JsonToken::ObjectStart)
+				return false;
+			std::string channelName, map, source;
+			bool invert = false;
+			bool channelParsed = reader.ForEachMember([&]()
+			{
+				if (reader.StringEquals("channel"))
+					return reader.NextString(channelName);
+				if (reader.StringEquals("map"))
+					return reader.NextString(map);
+				if (reader.StringEquals("source"))
+					return reader.NextString(source);
+				if (reader.StringEquals("invert"))
+					return reader.NextBool(invert);
+				return reader.SkipValue();
+			});
+			const int channel = GetChannelIndex(channelName);
+			if (!channelParsed || channel < 0)
+				return false;
+			this->maps[channel] = map;
+			this->sources[channel] = source;
+			this->inverted[channel] = invert;
+		}
+	});
+	this->format = static_cast<PixelFormat>(format);
+	if (!ContentHash::FromHex(hash, this->sourceHash))
+		this->sourceHash = 0;
+	return parsed && reader.Next() == JsonToken::End && version == Version && !this->texture.empty();
+}
+
+bool PackedTextureLayout::Write(const std::string& filepath) const
+{
+	std::string json = "{\n\t\"version\": " + std::to_string(Version) + ",\n\t\"texture\": ";
+	AppendString(json, this->texture);
+	json += ",\n\t\"rule\": ";
+	AppendString(json, this->rule);
+	json += ",\n\t\"sourceHash\": \"" + ContentHash::ToHex(this->sourceHash) + "\",\n\t\"format\": " + std::to_string(static_cast<uint32_t>(this->format));
+	json += ",\n\t\"channels\": [";
+	bool first = true;
+	for (int c = 0; c < 4; c++)
+	{
+		if (this->maps[c].empty())
+			continue;
+		json += first ? "\n\t\t{ \"channel\": \"" : ",\n\t\t{ \"channel\": \"";
+		json += ChannelNames[c];
+		json += "\", \"map\": ";
+		AppendString(json, this->maps[c]);
+		json += ", \"source\": ";
+		AppendString(json, this->sources[c]);
+		json += this->inverted[c] ? ", \"invert\": true }" : ", \"invert\": false }";
+		first = false;
+	}
+	json += first ? "]\n}\n" : "\n\t]\n}\n";
+	return FileHelper::WriteFileAtomic(filepath, json.data(), json.size());
+}
+
+void ChannelPacker::FindGroups(const std::string& directory, const ChannelPackingRule& rule, std::vector<ChannelPackingGroup>& groups)
+{
+	groups.clear();
+	std::vector<std::string> files = FileHelper::ListFiles(directory);
+	std::sort(files.begin(), files.end());
+	for (const std::string& file : files)
+	{
+		if (!IsImageFile(file))
+			continue;
+		for (int c = 0; c < 4; c++)
+		{
+			const std::string& map = rule.channels[c].map;
+			const std::string prefix = map.empty() ? std::string() : GetPrefixWithout(file, map);
+			if (prefix.empty())
+				continue;
+
+			auto group = std::find_if(groups.begin(), groups.end(), [&](const ChannelPackingGroup& g) { return g.prefix == prefix; });
+			if (group == groups.end())
+			{
+				groups.push_back(ChannelPackingGroup());
+				group = groups.end() - 1;
+				group->directory = directory;
+				group->prefix = prefix;
+			}
+			// The first of a jpg and a png of the same map wins
+			if (group->sources[c].empty())
+			{
+				group->sources[c] = file;
+				group->mapCount++;
+			}
+		}
+	}
+
+	groups.erase(std::remove_if(groups.begin(), groups.end(), [&](const ChannelPackingGroup& g) { return g.mapCount < std::max(1u, rule.minimumMaps); }), groups.end());
+}
+
+bool ChannelPacker::Pack(const ImageData* const sources[4], const ChannelPackingRule& rule, ImageData& packed, ThreadPool& pool)
+{
+	const ImageDescription* size = nullptr;
+	for (int c = 0; c < 4; c++)
+	{
+		if (sources[c] == nullptr)
+			continue;
+		const ImageDescription& description = sources[c]->description;
+		if ((description.format != PixelFormat::R8G8B8A8_UNORM && description.format != PixelFormat::R8_UNORM) ||
+			sources[c]->pixels.size() < description.GetLevelSize(0))
+			return false;
+		if (size != nullptr && (description.width != size->width || description.height != size->height))
+			return false;
+		size = &description;
+	}
+	if (size == nullptr)
+		return false;
+
+	packed = ImageData();
+	packed.description.width = size->width;
+	packed.description.height = size->height;
+	packed.description.format = PixelFormat::R8G8B8A8_UNORM;
+	packed.description.rowPitch = size->width * 4;
+	packed.pixels.resize(static_cast<size_t>(packed.description.GetSize()));
+
+	const uint32_t width = size->width;
+	const uint32_t height = size->height;
+	const size_t bandCount = (height + RowsPerBand - 1) / RowsPerBand;
+	pool.ParallelFor(bandCount, [&](size_t band)
+	{
+		const uint32_t firstRow = static_cast<uint32_t>(band) * RowsPerBand;
+		const uint32_t lastRow = std::min(height, firstRow + RowsPerBand);
+		for (int c = 0; c < 4; c++)
+		{
+			const PackedChannelSource& channel = rule.channels[c];
+			const ImageData* source = sources[c];
+			for (uint32_t y = firstRow; y < lastRow; y++)
+			{
+				uint8_t* destination = packed.pixels.data() + static_cast<size_t>(y) * packed.description.rowPitch + c;
+				if (source == nullptr)
+				{
+					const uint8_t value = ToByte(channel.value);
+					for (uint32_t x = 0; x < width; x++)
+						destination[x * 4] = value;
+					continue;
+				}
+
+				const bool singleChannel = source->description.format == PixelFormat::R8_UNORM;
+				const uint32_t stride = singleChannel ? 1 : 4;
+				const uint8_t* row = source->pixels.data() + static_cast<size_t>(y) * source->description.rowPitch + (singleChannel ? 0 : channel.sourceChannel);
+				const uint8_t flip = channel.invert ? 255 : 0;
+				for (uint32_t x = 0; x < width; x++)
+					destination[x * 4] = row[x * stride] ^ flip;
+			}
+		}
+	});
+	return true;
+}
+
+bool ChannelPacker::Cook(const ChannelPackingGroup& group, const ChannelPackingRule& rule, const TextureCookSettings& settings, ThreadPool& pool, PackedTextureLayout& layout)
+{
+	ImageData images[4];
+	const ImageData* sources[4] = {};
+	for (int c = 0; c < 4; c++)
+	{
+		if (group.sources[c].empty())
+			continue;
+		std::vector<uint8_t> data;
+		if (!FileHelper::ReadFile(JoinPath(group.directory, group.sources[c]), data) || !ImageDecoder::Decode(data.data(), data.size(), images[c], pool))
+			return false;
+		sources[c] = &images[c];
+	}
+
+	ImageData packed;
+	if (!Pack(sources, rule, packed, pool))
+		return false;
+	for (ImageData& image : images)
+		image = ImageData();
+
+	// Every channel is data, so the mips are filtered linearly. The channel holding an opacity or mask map keeps its
+	// coverage the way that map would on its own
+	MipSettings mipSettings;
+	for (int c = 0; c < 4; c++)
+	{
+		if (!rule.channels[c].map.empty() && MipGenerator::GetSettingsForFile(rule.channels[c].map).coverageChannel >= 0 && mipSettings.coverageChannel < 0)
+			mipSettings.coverageChannel = c;
+	}
+	TextureCooker::Process(packed, mipSettings, ChooseFormat(rule, settings.quality), settings, pool);
+
+	layout = PackedTextureLayout();
+	layout.texture = group.GetPackedName(rule) + "." + Dds::Extension;
+	layout.rule = rule.name;
+	layout.format = packed.description.format;
+	if (!HashGroup(group, rule, settings, layout.sourceHash))
+		return false;
+	for (int c = 0; c < 4; c++)
+	{
+		if (group.sources[c].empty())
+			continue;
+		layout.maps[c] = rule.channels[c].map;
+		layout.sources[c] = group.sources[c];
+		layout.inverted[c] = rule.channels[c].invert;
+	}
+
+	return DdsWriter::Write(JoinPath(group.directory, layout.texture), packed) &&
+		layout.Write(JoinPath(group.directory, group.GetPackedName(rule) + "." + PackedTextureLayout::Extension));
+}
+
+bool ChannelPacker::HashGroup(const ChannelPackingGroup& group, const ChannelPackingRule& rule, const TextureCookSettings& settings, uint64_t& hash)
+{
+	std::string description = rule.name + "|" + std::to_string(static_cast<uint32_t>(rule.format)) + "|" + settings.GetName();
+	for (const PackedChannelSource& channel : rule.channels)
+	{
+		char values[64];
+		snprintf(values, sizeof(values), "|%d|%d|%.6f|", channel.sourceChannel, channel.invert ? 1 : 0, channel.value);
+		description += channel.map + values;
+	}
+	hash = ContentHash::Hash64(description);
+
+	for (int c = 0; c < 4; c++)
+	{
+		uint64_t sourceHash = 0;
+		if (!group.sources[c].empty() && !ContentHash::HashFile(JoinPath(group.directory, group.sources[c]), sourceHash))
+			return false;
+		hash = ContentHash::Hash64(&sourceHash, sizeof(sourceHash), hash);
+	}
+	return true;
+}
+
+PixelFormat ChannelPacker::ChooseFormat(const ChannelPackingRule& rule, BlockQuality quality)
+{
+	if (rule.format != PixelFormat::Unknown)
+		return rule.format;
+
+	const bool used[4] = { !rule.channels[0].map.empty(), !rule.channels[1].map.empty(), !rule.channels[2].map.empty(), !rule.channels[3].map.empty() };
+	if (!used[1] && !used[2] && !used[3])
+		return PixelFormat::BC4_UNORM;
+	if (!used[2] && !used[3])
+		return PixelFormat::BC5_UNORM;
+	if (quality == BlockQuality::High)
+		return PixelFormat::BC7_UNORM;
+	return used[3] ? PixelFormat::BC3_UNORM : PixelFormat::BC1_UNORM;
+}
+
+bool ChannelPacker::WriteShaderHeader(const std::string& filepath, const ChannelPackingRules& rules, const std::string& rulesFilepath)
+{
+	const size_t slashOffset = rulesFilepath.find_last_of("\\/");
+	const std::string rulesName = slashOffset == std::string::npos ? rulesFilepath : rulesFilepath.substr(slashOffset + 1);
+	std::string text = "// Generated from " + rulesName + " by Engine.exe -packchannels, edit the rules instead of this file\n";
+	text += "//\n// Channel of each map in the textures the rules pack, packedTexture.Sample(s, uv).SURFACE_ROUGHNESS\n";
+	text += "#ifndef CHANNEL_PACKING_HLSLI\n#define CHANNEL_PACKING_HLSLI\n";
+	for (const ChannelPackingRule& rule : rules.rules)
+	{
+		text += "\n";
+		for (int c = 0; c < 4; c++)
+		{
+			if (!rule.channels[c].map.empty())
+				text += "#define " + GetDefineName(rule.name, rule.channels[c].map) + " " + ChannelNames[c] + "\n";
+		}
+	}
+	text += "\n#endif\n";
+	return FileHelper::WriteFileAtomic(filepath, text.data(), text.size());
+}
+
+bool ChannelPacker::FindPackedMap(const std::string& mapPath, PackedTextureLayout& layout, int& channel)
+{
+	const std::string directory = StringHelper::GetDirectoryFromPath(mapPath);
+	const size_t slashOffset = mapPath.find_last_of("\\/");
+	const std::string name = slashOffset == std::string::npos ? mapPath : mapPath.substr(slashOffset + 1);
+	for (const std::string& file : FileHelper::ListFiles(directory, std::string(".") + PackedTextureLayout::Extension))
+	{
+		if (!layout.Read(JoinPath(directory, file)))
+			continue;
+		for (int c = 0; c < 4; c++)
+		{
+			if (layout.sources[c] == name && !layout.maps[c].empty())
+			{
+				channel = c;
+				return true;
+			}
+		}
+	}
+	return false;
+}
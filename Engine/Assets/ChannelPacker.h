@@ -0,0 +1,119 @@
+#pragma once
+#include "ImageData.h"
+#include "TextureCooker.h"
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Where one channel of a packed texture comes from
+struct PackedChannelSource
+{
+	std::string map; // Word in the file name of the source, like "roughness". Empty for a channel that only holds value
+	int sourceChannel = 0; // Channel of the source image to take, single channel images always give their one
+	bool invert = false; // 1 - value, to store gloss as roughness
+	float value = 0.0f; // Written where the source map is missing or unused
+};
+
+// One packed texture. Images in a folder named <prefix>_<map> are merged into <prefix>_<name>
+struct ChannelPackingRule
+{
+	std::string name;
+	PackedChannelSource channels[4]; // r, g, b, a
+	PixelFormat format = PixelFormat::Unknown; // Block format, Unknown picks one for the channels in use (see ChannelPacker::ChooseFormat)
+	uint32_t minimumMaps = 2; // Fewer maps of the rule in a folder and nothing is packed
+
+	ChannelPackingRule() { this->channels[3].value = 1.0f; }
+	int GetUsedChannelCount() const;
+};
+
+// The material rule file, a JSON list of rules:
+//
+//   { "version": 1, "rules": [ { "name": "Surface", "format": "auto",
+//     "r": { "map": "roughness", "value": 1.0 }, "g": { "map": "opacity", "value": 1.0 }, "b": { "map": "translucency" } } ] }
+//
+// A channel object takes "map", "source" ("r", "g", "b" or "a"), "invert" and "value". Channels left out hold 0, alpha
+// 1. format is "auto", "bc1", "bc3", "bc4", "bc5", "bc7" or "rgba8"
+struct ChannelPackingRules
+{
+	static const uint32_t Version = 1;
+	std::vector<ChannelPackingRule> rules;
+
+	bool Read(const std::string& filepath);
+	static bool Parse(const char* json, size_t size, ChannelPackingRules& rules);
+};
+
+// Images in one folder a rule packs together
+struct ChannelPackingGroup
+{
+	std::string directory;
+	std::string prefix; // The file name the maps share, "qlCc6_4K"
+	std::string sources[4]; // File names of the maps for r, g, b and a. Empty where the folder has none
+	uint32_t mapCount = 0;
+
+	std::string GetPackedName(const ChannelPackingRule& rule) const { return this->prefix + "_" + rule.name; }
+};
+
+// What the material system needs to sample a packed texture, written next to it as <prefix>_<name>.layout.json:
+//
+//   { "version": 1, "texture": "qlCc6_4K_Surface.dds", "rule": "Surface", "sourceHash": "<16 hex digits>", "format": 71,
+//     "channels": [ { "channel": "r", "map": "roughness", "source": "qlCc6_4K_Roughness.jpg", "invert": false }, ... ] }
+//
+// A map that is not in the list is not in the texture
+struct PackedTextureLayout
+{
+	static const uint32_t Version = 1;
+	static const char* const Extension; // "layout.json"
+
+	std::string texture; // File names are relative to the layout
+	std::string rule;
+	uint64_t sourceHash = 0; // Of the sources and the rule, see ChannelPacker::HashGroup
+	PixelFormat format = PixelFormat::Unknown;
+	std::string maps[4]; // Map held by r, g, b and a, empty for a constant
+	std::string sources[4];
+	bool inverted[4] = {};
+
+	// Channel index holding map, -1 if the texture does not have it
+	int FindChannel(const std::string& map) const;
+	// ".r" and the like, for building shader code
+	static const char* GetSwizzle(int channel);
+	// dot(sample, mask) gives the value of map, so one shader serves every layout with the mask in a constant buffer.
+	// All zero for a map the texture does not have
+	void GetChannelMask(const std::string& map, float mask[4]) const;
+
+	bool Read(const std::string& filepath);
+	bool Write(const std::string& filepath) const;
+};
+
+// Merges single channel material maps (roughness, opacity, translucency and so on) into the channels of one texture
+// at cook time, so a material samples one texture and binds one descriptor where it had one per map. Each map alone
+// would take a whole RGBA texture for one channel of data.
+//
+// The packed texture gets linear mips, with alpha coverage kept in the channel holding an opacity or mask map, and
+// is block compressed like any other cooked texture (see TextureCooker). The layout file next to it tells the material
+// system which channel holds which map, and WriteShaderHeader turns the rules into swizzle defines for the shaders
+class ChannelPacker
+{
+public:
+	// Groups of images in directory by the prefix their names share once the map word is taken out
+	static void FindGroups(const std::string& directory, const ChannelPackingRule& rule, std::vector<ChannelPackingGroup>& groups);
+
+	// Merges sources into one R8G8B8A8_UNORM image. sources[c] may be null for a channel without a map, the others
+	// have to be R8G8B8A8_UNORM or R8_UNORM and all the same size. Rows run on the pool
+	static bool Pack(const ImageData* const sources[4], const ChannelPackingRule& rule, ImageData& packed, ThreadPool& pool);
+
+	// Decodes the group, packs it and writes <prefix>_<name>.dds and its layout into the group's directory
+	static bool Cook(const ChannelPackingGroup& group, const ChannelPackingRule& rule, const TextureCookSettings& settings, ThreadPool& pool, PackedTextureLayout& layout);
+
+	// Hash of the group's source files and the rule, stored in the layout so an unchanged group is not cooked again
+	static bool HashGroup(const ChannelPackingGroup& group, const ChannelPackingRule& rule, const TextureCookSettings& settings, uint64_t& hash);
+
+	// BC4 for one channel, BC5 for red and green, BC7 at High quality, otherwise BC1, or BC3 with alpha in use
+	static PixelFormat ChooseFormat(const ChannelPackingRule& rule, BlockQuality quality);
+
+	// One "#define <RULE>_<MAP> <channel>" per packed map, so a shader writes packed.Sample(s, uv).SURFACE_ROUGHNESS
+	static bool WriteShaderHeader(const std::string& filepath, const ChannelPackingRules& rules, const std::string& rulesFilepath);
+
+	// Looks for the packed texture in mapPath's folder that holds the map, for the material system to use it instead
+	static bool FindPackedMap(const std::string& mapPath, PackedTextureLayout& layout, int& channel);
+};
@@ -0,0 +1,149 @@
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <cstring>
+
+namespace
+{
+	const uint64_t Prime1 = 11400714785074694791ull;
+	const uint64_t Prime2 = 14029467366897019727ull;
+	const uint64_t Prime3 = 1609587929392839161ull;
+	const uint64_t Prime4 = 9650029242287828579ull;
+	const uint64_t Prime5 = 2870177450012600261ull;
+
+	inline uint64_t RotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	// Unaligned little endian reads, memcpy compiles down to a plain load
+	inline uint64_t Read64(const uint8_t* data)
+	{
+		uint64_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t Read32(const uint8_t* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline uint64_t Round(uint64_t accumulator, uint64_t input)
+	{
+		accumulator += input * Prime2;
+		accumulator = RotateLeft(accumulator, 31);
+		return accumulator * Prime1;
+	}
+
+	inline uint64_t MergeRound(uint64_t accumulator, uint64_t value)
+	{
+		accumulator ^= Round(0, value);
+		return accumulator * Prime1 + Prime4;
+	}
+}
+
+uint64_t ContentHash::Hash64(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* cursor = static_cast<const uint8_t*>(data);
+	const uint8_t* end = cursor + size;
+	uint64_t hash;
+
+	if (size >= 32)
+	{
+		// Four independent lanes so the multiplies pipeline
+		uint64_t v1 = seed + Prime1 + Prime2;
+		uint64_t v2 = seed + Prime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - Prime1;
+		const uint8_t* limit = end - 32;
+		do
+		{
+			v1 = Round(v1, Read64(cursor));
+			v2 = Round(v2, Read64(cursor + 8));
+			v3 = Round(v3, Read64(cursor + 16));
+			v4 = Round(v4, Read64(cursor + 24));
+			cursor += 32;
+		} while (cursor <= limit);
+
+		hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+		hash = MergeRound(hash, v1);
+		hash = MergeRound(hash, v2);
+		hash = MergeRound(hash, v3);
+		hash = MergeRound(hash, v4);
+	}
+	else
+	{
+		hash = seed + Prime5;
+	}
+
+	hash += static_cast<uint64_t>(size);
+
+	for (; cursor + 8 <= end; cursor += 8)
+	{
+		hash ^= Round(0, Read64(cursor));
+		hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+	}
+	if (cursor + 4 <= end)
+	{
+		hash ^= static_cast<uint64_t>(Read32(cursor)) * Prime1;
+		hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+		cursor += 4;
+	}
+	for (; cursor < end; cursor++)
+	{
+		hash ^= static_cast<uint64_t>(*cursor) * Prime5;
+		hash = RotateLeft(hash, 11) * Prime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+uint64_t ContentHash::Hash64(const std::string& text, uint64_t seed)
+{
+	return Hash64(text.data(), text.size(), seed);
+}
+
+bool ContentHash::HashFile(const std::string& filepath, uint64_t& hash)
+{
+	MappedFile file;
+	if (!file.Open(filepath))
+		return false;
+	hash = Hash64(file.Data(), file.Size());
+	return true;
+}
+
+std::string ContentHash::ToHex(uint64_t hash)
+{
+	const char* const digits = "0123456789abcdef";
+	std::string hex(16, '0');
+	for (int i = 15; i >= 0; i--, hash >>= 4)
+		hex[i] = digits[hash & 0xF];
+	return hex;
+}
+
+bool ContentHash::FromHex(const std::string& hex, uint64_t& hash)
+{
+	if (hex.size() != 16)
+		return false;
+	uint64_t value = 0;
+	for (char c : hex)
+	{
+		uint64_t digit;
+		if (c >= '0' && c <= '9')
+			digit = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			digit = c - 'a' + 10;
+		else
+			return false;
+		value = value << 4 | digit;
+	}
+	hash = value;
+	return true;
+}
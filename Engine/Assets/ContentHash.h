@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Fast non-cryptographic hashing for keying caches on file contents. Hash64 is XXH64, so results match any other
+// xxHash implementation and hashes written by one machine are valid on another
+namespace ContentHash
+{
+	uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0);
+	uint64_t Hash64(const std::string& text, uint64_t seed = 0);
+
+	// Hashes the whole file through a mapping. False if it cannot be opened
+	bool HashFile(const std::string& filepath, uint64_t& hash);
+
+	// 16 lower case hex digits
+	std::string ToHex(uint64_t hash);
+	// Reads ToHex back, false for anything else
+	bool FromHex(const std::string& hex, uint64_t& hash);
+}
@@ -0,0 +1,361 @@
+#include "CookedMesh.h"
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value)
+	{
+		return (value + CookedMesh::Alignment - 1) & ~static_cast<uint64_t>(CookedMesh::Alignment - 1);
+	}
+
+	bool IsHostLittleEndian()
+	{
+		const uint16_t tag = 1;
+		return *reinterpret_cast<const uint8_t*>(&tag) == 1;
+	}
+
+	void WritePadding(std::ofstream& stream, uint64_t alignedOffset)
+	{
+		static const char zeros[CookedMesh::Alignment] = {};
+		uint64_t position = static_cast<uint64_t>(stream.tellp());
+		if (alignedOffset > position)
+			stream.write(zeros, static_cast<std::streamsize>(alignedOffset - position));
+	}
+}
+
+std::string CookedMesh::GetCookedPath(const std::string& sourceFilepath)
+{
+	size_t extensionOffset = sourceFilepath.find_last_of('.');
+	size_t slashOffset = sourceFilepath.find_last_of("\\/");
+	if (extensionOffset == std::string::npos || (slashOffset != std::string::npos && extensionOffset < slashOffset))
+		return sourceFilepath + "." + Extension;
+	return sourceFilepath.substr(0, extensionOffset + 1) + Extension;
+}
+
+bool CookedMeshWriter::Write(const std::string& filepath, const ModelData& model, const std::string& optionsKey)
+{
+	// We write the structs as they are in memory, so the host has to match the file's byte order
+	if (!IsHostLittleEndian())
+		return false;
+
+	// -- Lay out the file before writing anything -- //
+	std::vector<CookedMeshRecord> meshRecords(model.meshes.size());
+	std::vector<CookedLodRecord> lodRecords;
+	std::vector<CookedMaterialRecord> materialRecords(model.materials.size());
+	std::string stringTable;
+
+	uint64_t vertexDataSize = 0;
+	uint64_t indexDataSize = 0;
+	uint64_t normalDataSize = 0;
+	uint64_t tangentDataSize = 0;
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		const MeshData& mesh = model.meshes[i];
+		CookedMeshRecord& record = meshRecords[i];
+		memset(&record, 0, sizeof(record));
+		memcpy(record.transform, &mesh.transform, sizeof(record.transform));
+		record.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+		record.indexCount = static_cast<uint32_t>(mesh.indices.size());
+		record.materialIndex = mesh.materialIndex;
+		record.lodCount = static_cast<uint32_t>(mesh.lods.size());
+		record.firstLod = static_cast<uint32_t>(lodRecords.size());
+		for (const MeshLod& lod : mesh.lods)
+		{
+			CookedLodRecord lodRecord = {};
+			lodRecord.indexStart = record.indexCount + record.lodIndexCount;
+			lodRecord.indexCount = static_cast<uint32_t>(lod.indices.size());
+			lodRecord.error = lod.error;
+			lodRecords.push_back(lodRecord);
+			record.lodIndexCount += lodRecord.indexCount;
+		}
+
+		record.vertexOffset = vertexDataSize;
+		vertexDataSize = AlignUp(vertexDataSize + mesh.vertices.size() * sizeof(Vertex3D));
+		record.indexOffset = indexDataSize;
+		indexDataSize = AlignUp(indexDataSize + (static_cast<uint64_t>(record.indexCount) + record.lodIndexCount) * sizeof(uint32_t));
+
+		// Streams that do not cover every vertex are left out, the runtime could not use them anyway
+		if (!mesh.normals.empty() && mesh.normals.size() == mesh.vertices.size())
+		{
+			record.streams |= CookedMesh::HasNormals;
+			record.normalOffset = normalDataSize;
+			normalDataSize = AlignUp(normalDataSize + mesh.normals.size() * sizeof(DirectX::XMFLOAT3));
+		}
+		if (!mesh.tangents.empty() && mesh.tangents.size() == mesh.vertices.size())
+		{
+			record.streams |= CookedMesh::HasTangents;
+			record.tangentOffset = tangentDataSize;
+			tangentDataSize = AlignUp(tangentDataSize + mesh.tangents.size() * sizeof(DirectX::XMFLOAT4));
+		}
+	}
+
+	for (size_t i = 0; i < model.materials.size(); i++)
+	{
+		const MaterialData& material = model.materials[i];
+		CookedMaterialRecord& record = materialRecords[i];
+		record.nameOffset = static_cast<uint32_t>(stringTable.size());
+		record.nameLength = static_cast<uint32_t>(material.name.size());
+		stringTable += material.name;
+		record.diffuseTextureOffset = static_cast<uint32_t>(stringTable.size());
+		record.diffuseTextureLength = static_cast<uint32_t>(material.diffuseTexture.size());
+		stringTable += material.diffuseTexture;
+	}
+
+	CookedMeshHeader header = {};
+	header.optionsKeyOffset = static_cast<uint32_t>(stringTable.size());
+	header.optionsKeyLength = static_cast<uint32_t>(optionsKey.size());
+	stringTable += optionsKey;
+
+	header.magic = CookedMesh::Magic;
+	header.version = CookedMesh::Version;
+	header.endianTag = CookedMesh::EndianTag;
+	header.vertexStride = sizeof(Vertex3D);
+	header.indexStride = sizeof(uint32_t);
+	header.meshCount = static_cast<uint32_t>(meshRecords.size());
+	header.materialCount = static_cast<uint32_t>(materialRecords.size());
+	header.meshTableOffset = sizeof(CookedMeshHeader);
+	header.lodCount = static_cast<uint32_t>(lodRecords.size());
+	header.lodTableOffset = header.meshTableOffset + meshRecords.size() * sizeof(CookedMeshRecord);
+	header.materialTableOffset = header.lodTableOffset + lodRecords.size() * sizeof(CookedLodRecord);
+	header.stringTableOffset = header.materialTableOffset + materialRecords.size() * sizeof(CookedMaterialRecord);
+	header.stringTableSize = stringTable.size();
+	header.vertexDataOffset = AlignUp(header.stringTableOffset + header.stringTableSize);
+	header.vertexDataSize = vertexDataSize;
+	header.indexDataOffset = AlignUp(header.vertexDataOffset + vertexDataSize);
+	header.indexDataSize = indexDataSize;
+	header.normalDataOffset = AlignUp(header.indexDataOffset + indexDataSize);
+	header.normalDataSize = normalDataSize;
+	header.tangentDataOffset = AlignUp(header.normalDataOffset + normalDataSize);
+	header.tangentDataSize = tangentDataSize;
+	header.fileSize = header.tangentDataOffset + tangentDataSize;
+
+	// -- Write it out -- //
+	std::ofstream stream(filepath, std::ios::binary | std::ios::trunc);
+	if (!stream)
+		return false;
+
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!meshRecords.empty())
+		stream.write(reinterpret_cast<const char*>(meshRecords.data()), meshRecords.size() * sizeof(CookedMeshRecord));
+	if (!lodRecords.empty())
+		stream.write(reinterpret_cast<const char*>(lodRecords.data()), lodRecords.size() * sizeof(CookedLodRecord));
+	if (!materialRecords.empty())
+		stream.write(reinterpret_cast<const char*>(materialRecords.data()), materialRecords.size() * sizeof(CookedMaterialRecord));
+	stream.write(stringTable.data(), stringTable.size());
+
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		WritePadding(stream, header.vertexDataOffset + meshRecords[i].vertexOffset);
+		const std::vector<Vertex3D>& vertices = model.meshes[i].vertices;
+		if (!vertices.empty())
+			stream.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vertex3D));
+	}
+
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		WritePadding(stream, header.indexDataOffset + meshRecords[i].indexOffset);
+		const std::vector<uint32_t>& indices = model.meshes[i].indices;
+		if (!indices.empty())
+			stream.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint32_t));
+		for (const MeshLod& lod : model.meshes[i].lods)
+		{
+			if (!lod.indices.empty())
+				stream.write(reinterpret_cast<const char*>(lod.indices.data()), lod.indices.size() * sizeof(uint32_t));
+		}
+	}
+
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		if ((meshRecords[i].streams & CookedMesh::HasNormals) == 0)
+			continue;
+		WritePadding(stream, header.normalDataOffset + meshRecords[i].normalOffset);
+		const std::vector<DirectX::XMFLOAT3>& normals = model.meshes[i].normals;
+		stream.write(reinterpret_cast<const char*>(normals.data()), normals.size() * sizeof(DirectX::XMFLOAT3));
+	}
+
+	for (size_t i = 0; i < model.meshes.size(); i++)
+	{
+		if ((meshRecords[i].streams & CookedMesh::HasTangents) == 0)
+			continue;
+		WritePadding(stream, header.tangentDataOffset + meshRecords[i].tangentOffset);
+		const std::vector<DirectX::XMFLOAT4>& tangents = model.meshes[i].tangents;
+		stream.write(reinterpret_cast<const char*>(tangents.data()), tangents.size() * sizeof(DirectX::XMFLOAT4));
+	}
+	WritePadding(stream, header.fileSize);
+
+	return static_cast<bool>(stream);
+}
+
+bool CookedMeshFile::Open(const std::string& filepath)
+{
+	Close();
+
+	if (!this->file.Open(filepath))
+		return false;
+
+	if (this->file.Size() < sizeof(CookedMeshHeader))
+	{
+		Close();
+		return false;
+	}
+
+	this->header = reinterpret_cast<const CookedMeshHeader*>(this->file.Data());
+	if (!Validate())
+	{
+		Close();
+		return false;
+	}
+
+	this->meshes = reinterpret_cast<const CookedMeshRecord*>(this->file.Data() + this->header->meshTableOffset);
+	this->lods = reinterpret_cast<const CookedLodRecord*>(this->file.Data() + this->header->lodTableOffset);
+	this->materials = reinterpret_cast<const CookedMaterialRecord*>(this->file.Data() + this->header->materialTableOffset);
+	return true;
+}
+
+void CookedMeshFile::Close()
+{
+	this->file.Close();
+	this->header = nullptr;
+	this->meshes = nullptr;
+	this->lods = nullptr;
+	this->materials = nullptr;
+}
+
+bool CookedMeshFile::Validate() const
+{
+	const CookedMeshHeader& h = *this->header;
+	if (h.magic != CookedMesh::Magic || h.version != CookedMesh::Version || h.endianTag != CookedMesh::EndianTag)
+		return false;
+	if (h.vertexStride != sizeof(Vertex3D) || h.indexStride != sizeof(uint32_t))
+		return false;
+	if (h.fileSize != this->file.Size())
+		return false;
+
+	const uint64_t size = this->file.Size();
+	if (h.meshTableOffset + static_cast<uint64_t>(h.meshCount) * sizeof(CookedMeshRecord) > size ||
+		h.lodTableOffset + static_cast<uint64_t>(h.lodCount) * sizeof(CookedLodRecord) > size ||
+		h.materialTableOffset + static_cast<uint64_t>(h.materialCount) * sizeof(CookedMaterialRecord) > size ||
+		h.stringTableOffset + h.stringTableSize > size ||
+		h.vertexDataOffset + h.vertexDataSize > size ||
+		h.indexDataOffset + h.indexDataSize > size ||
+		h.normalDataOffset + h.normalDataSize > size ||
+		h.tangentDataOffset + h.tangentDataSize > size)
+		return false;
+	if (static_cast<uint64_t>(h.optionsKeyOffset) + h.optionsKeyLength > h.stringTableSize)
+		return false;
+	if (h.meshTableOffset % CookedMesh::Alignment != 0 || h.lodTableOffset % CookedMesh::Alignment != 0 || h.vertexDataOffset % CookedMesh::Alignment != 0 || h.indexDataOffset % CookedMesh::Alignment != 0 ||
+		h.normalDataOffset % CookedMesh::Alignment != 0 || h.tangentDataOffset % CookedMesh::Alignment != 0)
+		return false;
+
+	// Make sure no record can point us outside of the mapping
+	const CookedMeshRecord* records = reinterpret_cast<const CookedMeshRecord*>(this->file.Data() + h.meshTableOffset);
+	const CookedLodRecord* lodRecords = reinterpret_cast<const CookedLodRecord*>(this->file.Data() + h.lodTableOffset);
+	for (uint32_t i = 0; i < h.meshCount; i++)
+	{
+		const CookedMeshRecord& record = records[i];
+		const uint64_t streamIndexCount = static_cast<uint64_t>(record.indexCount) + record.lodIndexCount;
+		if (record.vertexOffset + static_cast<uint64_t>(record.vertexCount) * sizeof(Vertex3D) > h.vertexDataSize ||
+			record.indexOffset + streamIndexCount * sizeof(uint32_t) > h.indexDataSize)
+			return false;
+		if (h.materialCount > 0 && record.materialIndex >= h.materialCount)
+			return false;
+		if ((record.streams & CookedMesh::HasNormals) != 0 && record.normalOffset + static_cast<uint64_t>(record.vertexCount) * sizeof(DirectX::XMFLOAT3) > h.normalDataSize)
+			return false;
+		if ((record.streams & CookedMesh::HasTangents) != 0 && record.tangentOffset + static_cast<uint64_t>(record.vertexCount) * sizeof(DirectX::XMFLOAT4) > h.tangentDataSize)
+			return false;
+		if (static_cast<uint64_t>(record.firstLod) + record.lodCount > h.lodCount)
+			return false;
+		for (uint32_t lod = 0; lod < record.lodCount; lod++)
+		{
+			const CookedLodRecord& lodRecord = lodRecords[record.firstLod + lod];
+			if (lodRecord.indexStart < record.indexCount || static_cast<uint64_t>(lodRecord.indexStart) + lodRecord.indexCount > streamIndexCount)
+				return false;
+		}
+	}
+
+	const CookedMaterialRecord* materialRecords = reinterpret_cast<const CookedMaterialRecord*>(this->file.Data() + h.materialTableOffset);
+	for (uint32_t i = 0; i < h.materialCount; i++)
+	{
+		const CookedMaterialRecord& record = materialRecords[i];
+		if (static_cast<uint64_t>(record.nameOffset) + record.nameLength > h.stringTableSize ||
+			static_cast<uint64_t>(record.diffuseTextureOffset) + record.diffuseTextureLength > h.stringTableSize)
+			return false;
+	}
+	return true;
+}
+
+const Vertex3D* CookedMeshFile::GetVertices(const CookedMeshRecord& mesh) const
+{
+	return reinterpret_cast<const Vertex3D*>(this->file.Data() + this->header->vertexDataOffset + mesh.vertexOffset);
+}
+
+const uint32_t* CookedMeshFile::GetIndices(const CookedMeshRecord& mesh) const
+{
+	return reinterpret_cast<const uint32_t*>(this->file.Data() + this->header->indexDataOffset + mesh.indexOffset);
+}
+
+const DirectX::XMFLOAT3* CookedMeshFile::GetNormals(const CookedMeshRecord& mesh) const
+{
+	if ((mesh.streams & CookedMesh::HasNormals) == 0)
+		return nullptr;
+	return reinterpret_cast<const DirectX::XMFLOAT3*>(this->file.Data() + this->header->normalDataOffset + mesh.normalOffset);
+}
+
+const DirectX::XMFLOAT4* CookedMeshFile::GetTangents(const CookedMeshRecord& mesh) const
+{
+	if ((mesh.streams & CookedMesh::HasTangents) == 0)
+		return nullptr;
+	return reinterpret_cast<const DirectX::XMFLOAT4*>(this->file.Data() + this->header->tangentDataOffset + mesh.tangentOffset);
+}
+
+std::string CookedMeshFile::GetOptionsKey() const
+{
+	return GetString(this->header->optionsKeyOffset, this->header->optionsKeyLength);
+}
+
+std::string CookedMeshFile::GetString(uint32_t offset, uint32_t length) const
+{
+	const char* stringTable = reinterpret_cast<const char*>(this->file.Data() + this->header->stringTableOffset);
+	return std::string(stringTable + offset, length);
+}
+
+MaterialData CookedMeshFile::GetMaterial(uint32_t index) const
+{
+	const CookedMaterialRecord& record = this->materials[index];
+	MaterialData material;
+	material.name = GetString(record.nameOffset, record.nameLength);
+	material.diffuseTexture = GetString(record.diffuseTextureOffset, record.diffuseTextureLength);
+	return material;
+}
+
+void CookedMeshFile::ToModelData(ModelData& model) const
+{
+	model.meshes.resize(GetMeshCount());
+	for (uint32_t i = 0; i < GetMeshCount(); i++)
+	{
+		const CookedMeshRecord& record = GetMesh(i);
+		MeshData& mesh = model.meshes[i];
+		memcpy(&mesh.transform, record.transform, sizeof(record.transform));
+		mesh.materialIndex = record.materialIndex;
+		mesh.vertices.assign(GetVertices(record), GetVertices(record) + record.vertexCount);
+		mesh.indices.assign(GetIndices(record), GetIndices(record) + record.indexCount);
+		mesh.normals.clear();
+		if (GetNormals(record) != nullptr)
+			mesh.normals.assign(GetNormals(record), GetNormals(record) + record.vertexCount);
+		mesh.tangents.clear();
+		if (GetTangents(record) != nullptr)
+			mesh.tangents.assign(GetTangents(record), GetTangents(record) + record.vertexCount);
+		mesh.lods.resize(record.lodCount);
+		for (uint32_t lod = 0; lod < record.lodCount; lod++)
+		{
+			const CookedLodRecord& lodRecord = GetLod(record, lod);
+			mesh.lods[lod].indices.assign(GetIndices(record) + lodRecord.indexStart, GetIndices(record) + lodRecord.indexStart + lodRecord.indexCount);
+			mesh.lods[lod].error = lodRecord.error;
+		}
+	}
+
+	model.materials.resize(GetMaterialCount());
+	for (uint32_t i = 0; i < GetMaterialCount(); i++)
+		model.materials[i] = GetMaterial(i);
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "MeshData.h"
+#include "MappedFile.h"
+
+// Cooked mesh file (.iemesh)
+//
+// Little endian binary produced offline by the asset tool (Engine.exe -cook) so the runtime never has
+// to run Assimp. Layout, every section starts on a 16 byte boundary:
+//
+//   CookedMeshHeader
+//   CookedMeshRecord[meshCount]        per mesh transform, counts and offsets into the data blobs
+//   CookedLodRecord[lodCount]          generated LODs, each mesh owns a run of them
+//   CookedMaterialRecord[materialCount]
+//   string table                       material names, texture paths and the import options key, not null terminated
+//   vertex data                        Vertex3D[], each mesh stream 16 byte aligned
+//   index data                         uint32_t[], each mesh stream 16 byte aligned. LOD0 first, its LODs right after
+//   normal data                        XMFLOAT3[] for the meshes that have normals, each mesh stream 16 byte aligned
+//   tangent data                       XMFLOAT4[] for the meshes that have tangents, each mesh stream 16 byte aligned
+//
+// The loader maps the file and hands pointers into the mapping straight to the GPU buffer uploads. Since a mesh's
+// LODs follow LOD0 in its index stream, the whole stream goes into one index buffer as it is.
+
+namespace CookedMesh
+{
+	const uint32_t Magic = 0x434D4549; // "IEMC"
+	const uint16_t Version = 3; // 2 added the LOD table and the options key, 3 the normal and tangent streams
+	const uint16_t EndianTag = 0x0102; // Reads back as 0x0201 on a big endian host
+	const uint32_t Alignment = 16;
+	const char* const Extension = "iemesh";
+
+	// CookedMeshRecord::streams
+	const uint32_t HasNormals = 1 << 0;
+	const uint32_t HasTangents = 1 << 1;
+
+	// Path of the cooked file that sits next to a source model. "Var1_LOD0.fbx" -> "Var1_LOD0.iemesh"
+	std::string GetCookedPath(const std::string& sourceFilepath);
+}
+
+struct CookedMeshHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t endianTag;
+	uint32_t vertexStride;
+	uint32_t indexStride;
+	uint32_t meshCount;
+	uint32_t materialCount;
+	uint64_t meshTableOffset;
+	uint64_t materialTableOffset;
+	uint64_t stringTableOffset;
+	uint64_t stringTableSize;
+	uint64_t vertexDataOffset;
+	uint64_t vertexDataSize;
+	uint64_t indexDataOffset;
+	uint64_t indexDataSize;
+	uint64_t fileSize;
+	uint64_t lodTableOffset;
+	uint32_t lodCount;
+	uint32_t optionsKeyOffset; // ImportOptions::GetKey of the import that was cooked, in the string table
+	uint32_t optionsKeyLength;
+	uint32_t reserved[3];
+	uint64_t normalDataOffset;
+	uint64_t normalDataSize;
+	uint64_t tangentDataOffset;
+	uint64_t tangentDataSize;
+};
+
+struct CookedMeshRecord
+{
+	float transform[16];
+	uint64_t vertexOffset; // Bytes from the start of the vertex data
+	uint64_t indexOffset; // Bytes from the start of the index data
+	uint32_t vertexCount;
+	uint32_t indexCount; // LOD0
+	uint32_t materialIndex;
+	uint32_t lodCount; // Not counting LOD0
+	uint32_t firstLod; // Index into the LOD table
+	uint32_t lodIndexCount; // Indices of all LODs together, stored right after LOD0's
+	uint32_t streams; // CookedMesh::HasNormals and HasTangents, each has vertexCount entries
+	uint32_t reserved;
+	uint64_t normalOffset; // Bytes from the start of the normal data
+	uint64_t tangentOffset; // Bytes from the start of the tangent data
+};
+
+struct CookedLodRecord
+{
+	uint32_t indexStart; // Indices from the start of the mesh's index stream, LOD0's come first
+	uint32_t indexCount;
+	float error; // MeshLod::error
+	uint32_t reserved;
+};
+
+struct CookedMaterialRecord
+{
+	uint32_t nameOffset; // Offsets are relative to the string table
+	uint32_t nameLength;
+	uint32_t diffuseTextureOffset;
+	uint32_t diffuseTextureLength;
+};
+
+static_assert(sizeof(CookedMeshHeader) % CookedMesh::Alignment == 0, "CookedMeshHeader must keep the following sections aligned");
+static_assert(sizeof(CookedMeshRecord) % CookedMesh::Alignment == 0, "CookedMeshRecord must keep the following sections aligned");
+static_assert(sizeof(CookedLodRecord) % CookedMesh::Alignment == 0, "CookedLodRecord must keep the following sections aligned");
+static_assert(sizeof(CookedMaterialRecord) % CookedMesh::Alignment == 0, "CookedMaterialRecord must keep the following sections aligned");
+
+class CookedMeshWriter
+{
+public:
+	// optionsKey is the ImportOptions::GetKey model was imported with, Model only loads cooked files whose key matches
+	static bool Write(const std::string& filepath, const ModelData& model, const std::string& optionsKey);
+};
+
+// Read side. Keeps the file mapped for as long as the object lives, every pointer it hands out points into the mapping
+class CookedMeshFile
+{
+public:
+	bool Open(const std::string& filepath);
+	void Close();
+
+	uint32_t GetMeshCount() const { return this->header->meshCount; }
+	const CookedMeshRecord& GetMesh(uint32_t index) const { return this->meshes[index]; }
+	const Vertex3D* GetVertices(const CookedMeshRecord& mesh) const;
+	// LOD0 and then every LOD, mesh.indexCount + mesh.lodIndexCount of them
+	const uint32_t* GetIndices(const CookedMeshRecord& mesh) const;
+	// nullptr when the mesh was cooked without them
+	const DirectX::XMFLOAT3* GetNormals(const CookedMeshRecord& mesh) const;
+	const DirectX::XMFLOAT4* GetTangents(const CookedMeshRecord& mesh) const;
+	const CookedLodRecord& GetLod(const CookedMeshRecord& mesh, uint32_t lod) const { return this->lods[mesh.firstLod + lod]; }
+	std::string GetOptionsKey() const;
+
+	uint32_t GetMaterialCount() const { return this->header->materialCount; }
+	MaterialData GetMaterial(uint32_t index) const;
+
+	// Copies the whole file back into ModelData, used by tools that want to run processing passes on cooked data
+	void ToModelData(ModelData& model) const;
+
+private:
+	bool Validate() const;
+	std::string GetString(uint32_t offset, uint32_t length) const;
+
+	MappedFile file;
+	const CookedMeshHeader* header = nullptr;
+	const CookedMeshRecord* meshes = nullptr;
+	const CookedLodRecord* lods = nullptr;
+	const CookedMaterialRecord* materials = nullptr;
+};
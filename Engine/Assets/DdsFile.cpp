@@ -0,0 +1,262 @@
+#include "DdsFile.h"
+#include "../FileHelper.h"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// DdsHeader::flags
+	const uint32_t FlagCaps = 0x1;
+	const uint32_t FlagHeight = 0x2;
+	const uint32_t FlagWidth = 0x4;
+	const uint32_t FlagPitch = 0x8;
+	const uint32_t FlagPixelFormat = 0x1000;
+	const uint32_t FlagMipMapCount = 0x20000;
+	const uint32_t FlagLinearSize = 0x80000;
+	const uint32_t FlagDepth = 0x800000;
+
+	// DdsPixelFormat::flags
+	const uint32_t PixelAlpha = 0x1;
+	const uint32_t PixelFourCC = 0x4;
+	const uint32_t PixelRgb = 0x40;
+	const uint32_t PixelLuminance = 0x20000;
+
+	// DdsHeader::caps and caps2
+	const uint32_t CapsComplex = 0x8;
+	const uint32_t CapsTexture = 0x1000;
+	const uint32_t CapsMipMap = 0x400000;
+	const uint32_t Caps2CubeMap = 0x200;
+	const uint32_t Caps2Volume = 0x200000;
+
+	const uint32_t Dx10Texture2D = 3;
+	const uint32_t Dx10MiscTextureCube = 0x4;
+	const uint32_t D3dFormatA16B16G16R16 = 36; // Legacy numeric FourCC of R16G16B16A16_UNORM
+
+	uint32_t MakeFourCC(const char* text)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(text[0])) | static_cast<uint32_t>(static_cast<uint8_t>(text[1])) << 8 |
+			static_cast<uint32_t>(static_cast<uint8_t>(text[2])) << 16 | static_cast<uint32_t>(static_cast<uint8_t>(text[3])) << 24;
+	}
+
+	bool IsHostLittleEndian()
+	{
+		const uint16_t tag = 1;
+		return *reinterpret_cast<const uint8_t*>(&tag) == 1;
+	}
+
+	bool IsKnownFormat(PixelFormat format)
+	{
+		return ImageDescription::GetBytesPerPixel(format) > 0 || ImageDescription::IsBlockCompressed(format);
+	}
+
+	uint32_t GetMaxLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+		for (uint32_t size = width > height ? width : height; size > 1; size >>= 1)
+			levels++;
+		return levels;
+	}
+
+	uint32_t GetTightRowPitch(PixelFormat format, uint32_t width)
+	{
+		if (ImageDescription::IsBlockCompressed(format))
+			return (width + 3) / 4 * ImageDescription::GetBytesPerBlock(format);
+		return width * ImageDescription::GetBytesPerPixel(format);
+	}
+
+	// Fills in the legacy pixel format, false when the format needs the DX10 header
+	bool GetLegacyPixelFormat(PixelFormat format, DdsPixelFormat& pixelFormat)
+	{
+		memset(&pixelFormat, 0, sizeof(pixelFormat));
+		pixelFormat.size = sizeof(DdsPixelFormat);
+		switch (format)
+		{
+		case PixelFormat::R8G8B8A8_UNORM:
+			pixelFormat.flags = PixelRgb | PixelAlpha;
+			pixelFormat.rgbBitCount = 32;
+			pixelFormat.rBitMask = 0x000000ff;
+			pixelFormat.gBitMask = 0x0000ff00;
+			pixelFormat.bBitMask = 0x00ff0000;
+			pixelFormat.aBitMask = 0xff000000;
+			return true;
+		case PixelFormat::R16_UNORM:
+			pixelFormat.flags = PixelLuminance;
+			pixelFormat.rgbBitCount = 16;
+			pixelFormat.rBitMask = 0xffff;
+			return true;
+		case PixelFormat::R8_UNORM:
+			pixelFormat.flags = PixelLuminance;
+			pixelFormat.rgbBitCount = 8;
+			pixelFormat.rBitMask = 0xff;
+			return true;
+		case PixelFormat::BC1_UNORM: pixelFormat.flags = PixelFourCC; pixelFormat.fourCC = MakeFourCC("DXT1"); return true;
+		case PixelFormat::BC3_UNORM: pixelFormat.flags = PixelFourCC; pixelFormat.fourCC = MakeFourCC("DXT5"); return true;
+		case PixelFormat::BC4_UNORM: pixelFormat.flags = PixelFourCC; pixelFormat.fourCC = MakeFourCC("ATI1"); return true;
+		case PixelFormat::BC5_UNORM: pixelFormat.flags = PixelFourCC; pixelFormat.fourCC = MakeFourCC("ATI2"); return true;
+		default:
+			pixelFormat.flags = PixelFourCC;
+			pixelFormat.fourCC = MakeFourCC("DX10");
+			return false;
+		}
+	}
+
+	PixelFormat GetFormatFromLegacy(const DdsPixelFormat& pixelFormat)
+	{
+		if (pixelFormat.flags & PixelFourCC)
+		{
+			const uint32_t fourCC = pixelFormat.fourCC;
+			if (fourCC == MakeFourCC("DXT1"))
+				return PixelFormat::BC1_UNORM;
+			if (fourCC == MakeFourCC("DXT5"))
+				return PixelFormat::BC3_UNORM;
+			if (fourCC == MakeFourCC("ATI1") || fourCC == MakeFourCC("BC4U"))
+				return PixelFormat::BC4_UNORM;
+			if (fourCC == MakeFourCC("ATI2") || fourCC == MakeFourCC("BC5U"))
+				return PixelFormat::BC5_UNORM;
+			if (fourCC == D3dFormatA16B16G16R16)
+				return PixelFormat::R16G16B16A16_UNORM;
+			return PixelFormat::Unknown;
+		}
+
+		// Masks have to match exactly, a BGRA file is not RGBA with the channels renamed
+		if ((pixelFormat.flags & PixelRgb) && pixelFormat.rgbBitCount == 32 && pixelFormat.rBitMask == 0x000000ff && pixelFormat.gBitMask == 0x0000ff00 &&
+			pixelFormat.bBitMask == 0x00ff0000 && ((pixelFormat.flags & PixelAlpha) == 0 || pixelFormat.aBitMask == 0xff000000))
+			return PixelFormat::R8G8B8A8_UNORM;
+		if ((pixelFormat.flags & PixelLuminance) && pixelFormat.rgbBitCount == 8 && pixelFormat.rBitMask == 0xff && (pixelFormat.flags & PixelAlpha) == 0)
+			return PixelFormat::R8_UNORM;
+		if ((pixelFormat.flags & PixelLuminance) && pixelFormat.rgbBitCount == 16 && pixelFormat.rBitMask == 0xffff && (pixelFormat.flags & PixelAlpha) == 0)
+			return PixelFormat::R16_UNORM;
+		return PixelFormat::Unknown;
+	}
+}
+
+std::string Dds::GetCookedPath(const std::string& sourceFilepath)
+{
+	size_t extensionOffset = sourceFilepath.find_last_of('.');
+	size_t slashOffset = sourceFilepath.find_last_of("\\/");
+	if (extensionOffset == std::string::npos || (slashOffset != std::string::npos && extensionOffset < slashOffset))
+		return sourceFilepath + "." + Extension;
+	return sourceFilepath.substr(0, extensionOffset + 1) + Extension;
+}
+
+bool DdsWriter::Write(const std::string& filepath, const ImageData& image)
+{
+	// We write the structs as they are in memory, so the host has to match the file's byte order
+	if (!IsHostLittleEndian())
+		return false;
+
+	const ImageDescription& description = image.description;
+	if (!IsKnownFormat(description.format) || description.width == 0 || description.height == 0 || description.width > Dds::MaxDimension ||
+		description.height > Dds::MaxDimension || description.depthOrArraySize != 1 ||
+		description.mipLevels == 0 || description.mipLevels > GetMaxLevelCount(description.width, description.height) ||
+		description.rowPitch != GetTightRowPitch(description.format, description.width) || image.pixels.size() != description.GetSize())
+		return false;
+
+	const bool blockCompressed = ImageDescription::IsBlockCompressed(description.format);
+	DdsHeader header = {};
+	header.size = sizeof(DdsHeader);
+	header.flags = FlagCaps | FlagHeight | FlagWidth | FlagPixelFormat | (blockCompressed ? FlagLinearSize : FlagPitch);
+	header.height = description.height;
+	header.width = description.width;
+	header.pitchOrLinearSize = blockCompressed ? static_cast<uint32_t>(description.GetLevelSize(0)) : description.rowPitch;
+	header.mipMapCount = description.mipLevels;
+	header.caps = CapsTexture;
+	if (description.mipLevels > 1)
+	{
+		header.flags |= FlagMipMapCount;
+		header.caps |= CapsComplex | CapsMipMap;
+	}
+
+	const bool legacy = GetLegacyPixelFormat(description.format, header.pixelFormat);
+	DdsHeaderDx10 headerDx10 = {};
+	headerDx10.dxgiFormat = static_cast<uint32_t>(description.format);
+	headerDx10.resourceDimension = Dx10Texture2D;
+	headerDx10.arraySize = 1;
+
+	// Written in one go through a temporary file, a cook that dies half way must not leave a broken DDS the runtime
+	// would prefer over the source image
+	std::vector<uint8_t> file;
+	file.reserve(sizeof(Dds::Magic) + sizeof(header) + sizeof(headerDx10) + image.pixels.size());
+	const uint8_t* magic = reinterpret_cast<const uint8_t*>(&Dds::Magic);
+	file.insert(file.end(), magic, magic + sizeof(Dds::Magic));
+	file.insert(file.end(), reinterpret_cast<const uint8_t*>(&header), reinterpret_cast<const uint8_t*>(&header) + sizeof(header));
+	if (!legacy)
+		file.insert(file.end(), reinterpret_cast<const uint8_t*>(&headerDx10), reinterpret_cast<const uint8_t*>(&headerDx10) + sizeof(headerDx10));
+	file.insert(file.end(), image.pixels.begin(), image.pixels.end());
+	return FileHelper::WriteFileAtomic(filepath, file.data(), file.size());
+}
+
+bool DdsFile::ReadDescription(const uint8_t* data, size_t size, ImageDescription& description, size_t& dataOffset)
+{
+	if (!IsHostLittleEndian() || size < sizeof(uint32_t) + sizeof(DdsHeader))
+		return false;
+
+	uint32_t magic;
+	DdsHeader header;
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&header, data + sizeof(magic), sizeof(header));
+	if (magic != Dds::Magic || header.size != sizeof(DdsHeader) || header.pixelFormat.size != sizeof(DdsPixelFormat))
+		return false;
+	if ((header.caps2 & (Caps2CubeMap | Caps2Volume)) || ((header.flags & FlagDepth) && header.depth > 1))
+		return false;
+
+	dataOffset = sizeof(magic) + sizeof(header);
+	PixelFormat format;
+	if ((header.pixelFormat.flags & PixelFourCC) && header.pixelFormat.fourCC == MakeFourCC("DX10"))
+	{
+		if (size < dataOffset + sizeof(DdsHeaderDx10))
+			return false;
+		DdsHeaderDx10 headerDx10;
+		memcpy(&headerDx10, data + dataOffset, sizeof(headerDx10));
+		if (headerDx10.resourceDimension != Dx10Texture2D || headerDx10.arraySize != 1 || (headerDx10.miscFlag & Dx10MiscTextureCube))
+			return false;
+		dataOffset += sizeof(headerDx10);
+		format = static_cast<PixelFormat>(headerDx10.dxgiFormat);
+	}
+	else
+	{
+		format = GetFormatFromLegacy(header.pixelFormat);
+	}
+
+	// Writers are allowed to leave the mip count at 0 for a single level
+	const uint32_t mipLevels = header.mipMapCount > 0 ? header.mipMapCount : 1;
+	// The dimension limit also keeps the row pitch and level sizes well inside 32 bits
+	if (!IsKnownFormat(format) || header.width == 0 || header.height == 0 || header.width > Dds::MaxDimension || header.height > Dds::MaxDimension ||
+		mipLevels > GetMaxLevelCount(header.width, header.height))
+		return false;
+
+	description = ImageDescription();
+	description.width = header.width;
+	description.height = header.height;
+	description.mipLevels = static_cast<uint16_t>(mipLevels);
+	description.format = format;
+	description.rowPitch = GetTightRowPitch(format, header.width);
+	return dataOffset + description.GetSize() <= size;
+}
+
+bool DdsFile::Open(const std::string& filepath)
+{
+	Close();
+
+	size_t dataOffset;
+	if (!this->file.Open(filepath) || !ReadDescription(this->file.Data(), this->file.Size(), this->description, dataOffset))
+	{
+		Close();
+		return false;
+	}
+	this->levelData = this->file.Data() + dataOffset;
+	return true;
+}
+
+void DdsFile::Close()
+{
+	this->file.Close();
+	this->description = ImageDescription();
+	this->levelData = nullptr;
+}
+
+void DdsFile::ToImageData(ImageData& image) const
+{
+	image.description = this->description;
+	image.pixels.assign(this->levelData, this->levelData + this->description.GetSize());
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "ImageData.h"
+#include "MappedFile.h"
+#include <string>
+
+// DirectDraw Surface texture file (.dds)
+//
+// The format every texture tool reads, and the one the asset tool cooks textures into (Engine.exe -cooktextures) so
+// the runtime never decodes a JPEG. Layout:
+//
+//   "DDS "                 magic
+//   DdsHeader              124 bytes, size, mip count and a pixel format of masks or a FourCC
+//   DdsHeaderDx10          20 bytes, only when the FourCC is "DX10". Carries the DXGI_FORMAT directly
+//   level data             every level of the image, the top one first, rows tightly packed (rows of blocks for
+//                          block compressed formats). The same order as ImageData, see ImageDescription::GetLevelOffset
+//
+// BC7 and R16G16B16A16 are written with the DX10 header, the other formats with the legacy FourCC or masks older
+// tools understand. Only 2D textures in PixelFormat formats are read, cube maps, volumes and arrays are rejected.
+
+namespace Dds
+{
+	const uint32_t Magic = 0x20534444; // "DDS "
+	const char* const Extension = "dds";
+	// Widest and tallest texture D3D12 creates (D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION), files past it are rejected
+	const uint32_t MaxDimension = 16384;
+
+	// Path of the cooked file that sits next to a source image. "Catalina.jpg" -> "Catalina.dds"
+	std::string GetCookedPath(const std::string& sourceFilepath);
+}
+
+struct DdsPixelFormat
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t fourCC;
+	uint32_t rgbBitCount;
+	uint32_t rBitMask;
+	uint32_t gBitMask;
+	uint32_t bBitMask;
+	uint32_t aBitMask;
+};
+
+struct DdsHeader
+{
+	uint32_t size;
+	uint32_t flags;
+	uint32_t height;
+	uint32_t width;
+	uint32_t pitchOrLinearSize;
+	uint32_t depth;
+	uint32_t mipMapCount;
+	uint32_t reserved1[11];
+	DdsPixelFormat pixelFormat;
+	uint32_t caps;
+	uint32_t caps2;
+	uint32_t caps3;
+	uint32_t caps4;
+	uint32_t reserved2;
+};
+
+struct DdsHeaderDx10
+{
+	uint32_t dxgiFormat;
+	uint32_t resourceDimension; // 3 for D3D12_RESOURCE_DIMENSION_TEXTURE2D
+	uint32_t miscFlag;
+	uint32_t arraySize;
+	uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DdsPixelFormat) == 32, "DdsPixelFormat has to match the file layout");
+static_assert(sizeof(DdsHeader) == 124, "DdsHeader has to match the file layout");
+static_assert(sizeof(DdsHeaderDx10) == 20, "DdsHeaderDx10 has to match the file layout");
+
+class DdsWriter
+{
+public:
+	// Every level of image, which has to be in a PixelFormat other than Unknown with tightly packed rows
+	static bool Write(const std::string& filepath, const ImageData& image);
+};
+
+// Read side. Keeps the file mapped for as long as the object lives, GetLevelData points into the mapping so the
+// levels can be copied straight to where they have to go without a copy in our own heap first
+class DdsFile
+{
+public:
+	bool Open(const std::string& filepath);
+	void Close();
+
+	const ImageDescription& GetDescription() const { return this->description; }
+	const uint8_t* GetLevelData(uint32_t level) const { return this->levelData + this->description.GetLevelOffset(level); }
+
+	// Copies the whole image out, used by tools that want to run processing passes on cooked data
+	void ToImageData(ImageData& image) const;
+
+	// Reads the headers of a whole file in memory. dataOffset is where the top level starts
+	static bool ReadDescription(const uint8_t* data, size_t size, ImageDescription& description, size_t& dataOffset);
+
+private:
+	MappedFile file;
+	ImageDescription description;
+	const uint8_t* levelData = nullptr;
+};
@@ -0,0 +1,301 @@
+#include "DerivedDataCache.h"
+#include "ContentHash.h"
+#include "../FileHelper.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	// Entry file layout: DerivedDataHeader, the key (not null terminated), the payload
+	struct DerivedDataHeader
+	{
+		uint32_t magic;
+		uint16_t version;
+		uint16_t endianTag;
+		uint32_t keyLength;
+		uint32_t reserved;
+		uint64_t payloadSize;
+		uint64_t payloadHash; // ContentHash::Hash64 of the payload
+	};
+
+	const uint32_t Magic = 0x44444549; // "IEDD"
+	const uint16_t Version = 1;
+	const uint16_t EndianTag = 0x0102;
+
+	// Trimming goes a little below the limit so the next few puts do not each trigger another trim
+	const double TrimTarget = 0.9;
+}
+
+const char* const DerivedDataCache::DefaultDirectory = "DerivedDataCache";
+const char* const DerivedDataCache::Extension = ".ddc";
+
+DerivedDataCache& DerivedDataCache::GetShared()
+{
+	static DerivedDataCache cache;
+	return cache;
+}
+
+DerivedDataCache::DerivedDataCache()
+	: directory(DefaultDirectory)
+{
+}
+
+void DerivedDataCache::SetDirectory(const std::string& directory)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->directory = directory;
+	this->indexLoaded = false;
+	this->index.clear();
+	this->localSizeInBytes = 0;
+}
+
+void DerivedDataCache::SetSharedDirectory(const std::string& directory)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->sharedDirectory = directory;
+}
+
+void DerivedDataCache::SetMaxSizeInBytes(uint64_t maxSizeInBytes)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->maxSizeInBytes = maxSizeInBytes;
+}
+
+void DerivedDataCache::SetEnabled(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->enabled = enabled;
+}
+
+std::string DerivedDataCache::MakeKey(const char* type, uint32_t version, uint64_t sourceHash, const std::string& options)
+{
+	return std::string(type) + "|v" + std::to_string(version) + "|" + ContentHash::ToHex(sourceHash) + "|" + options;
+}
+
+bool DerivedDataCache::Get(const std::string& key, std::vector<uint8_t>& data)
+{
+	std::string localDirectory;
+	std::string localPath;
+	std::string sharedPath;
+	const std::string name = GetEntryName(key);
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (!this->enabled)
+			return false;
+		LoadIndex();
+		localDirectory = this->directory;
+		localPath = localDirectory + "/" + name;
+		if (!this->sharedDirectory.empty())
+			sharedPath = this->sharedDirectory + "/" + name;
+	}
+
+	bool corrupt = false;
+	if (Read(localPath, key, data, corrupt))
+	{
+		FileHelper::TouchFile(localPath);
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->statistics.hits++;
+		this->statistics.bytesRead += data.size();
+		auto it = this->index.find(name);
+		if (it != this->index.end())
+			it->second.lastUsed = FileHelper::GetLastWriteTime(localPath);
+		return true;
+	}
+	if (corrupt)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->statistics.corrupt++;
+		auto it = this->index.find(name);
+		if (it != this->index.end())
+		{
+			this->localSizeInBytes -= it->second.sizeInBytes;
+			this->index.erase(it);
+		}
+	}
+
+	bool sharedCorrupt = false;
+	if (!sharedPath.empty() && Read(sharedPath, key, data, sharedCorrupt))
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->statistics.hits++;
+			this->statistics.sharedHits++;
+			this->statistics.bytesRead += data.size();
+		}
+		// Keep a local copy, the shared folder is usually a lot slower to read from
+		Write(localDirectory, name, key, data.data(), data.size());
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (sharedCorrupt)
+		this->statistics.corrupt++;
+	this->statistics.misses++;
+	return false;
+}
+
+bool DerivedDataCache::Put(const std::string& key, const void* data, size_t size)
+{
+	std::string localDirectory;
+	std::string sharedDirectory;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (!this->enabled)
+			return false;
+		LoadIndex();
+		localDirectory = this->directory;
+		sharedDirectory = this->sharedDirectory;
+	}
+
+	const std::string name = GetEntryName(key);
+	bool written = Write(localDirectory, name, key, data, size);
+	if (!sharedDirectory.empty())
+		Write(sharedDirectory, name, key, data, size);
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (written)
+	{
+		this->statistics.puts++;
+		this->statistics.bytesWritten += size;
+	}
+	return written;
+}
+
+void DerivedDataCache::Trim(uint64_t maxSizeInBytes)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	LoadIndex();
+	TrimLocked(maxSizeInBytes);
+}
+
+DerivedDataCache::Statistics DerivedDataCache::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	LoadIndex();
+	Statistics statistics = this->statistics;
+	statistics.localSizeInBytes = this->localSizeInBytes;
+	statistics.localEntries = static_cast<uint32_t>(this->index.size());
+	return statistics;
+}
+
+void DerivedDataCache::ResetStatistics()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->statistics = Statistics();
+}
+
+std::string DerivedDataCache::GetEntryName(const std::string& key) const
+{
+	// The full key is stored in the entry and compared on read, so a collision reads as a miss and not as wrong data
+	return ContentHash::ToHex(ContentHash::Hash64(key)) + Extension;
+}
+
+bool DerivedDataCache::Read(const std::string& filepath, const std::string& key, std::vector<uint8_t>& data, bool& corrupt)
+{
+	corrupt = false;
+	std::vector<uint8_t> file;
+	if (!FileHelper::ReadFile(filepath, file))
+		return false;
+
+	DerivedDataHeader header;
+	bool valid = file.size() >= sizeof(header);
+	if (valid)
+	{
+		memcpy(&header, file.data(), sizeof(header));
+		valid = header.magic == Magic && header.version == Version && header.endianTag == EndianTag &&
+			header.keyLength <= file.size() - sizeof(header) &&
+			header.payloadSize == file.size() - sizeof(header) - header.keyLength;
+	}
+	const uint8_t* payload = valid ? file.data() + sizeof(header) + header.keyLength : nullptr;
+	valid = valid && ContentHash::Hash64(payload, static_cast<size_t>(header.payloadSize)) == header.payloadHash;
+	if (!valid)
+	{
+		corrupt = true;
+		FileHelper::RemoveFile(filepath);
+		return false;
+	}
+
+	// Intact, but written for a different key with the same name hash
+	if (header.keyLength != key.size() || memcmp(file.data() + sizeof(header), key.data(), key.size()) != 0)
+		return false;
+
+	data.assign(payload, payload + header.payloadSize);
+	return true;
+}
+
+bool DerivedDataCache::Write(const std::string& directory, const std::string& name, const std::string& key, const void* data, size_t size)
+{
+	if (!FileHelper::CreateDirectories(directory))
+		return false;
+
+	DerivedDataHeader header = {};
+	header.magic = Magic;
+	header.version = Version;
+	header.endianTag = EndianTag;
+	header.keyLength = static_cast<uint32_t>(key.size());
+	header.payloadSize = size;
+	header.payloadHash = ContentHash::Hash64(data, size);
+
+	std::vector<uint8_t> file(sizeof(header) + key.size() + size);
+	memcpy(file.data(), &header, sizeof(header));
+	memcpy(file.data() + sizeof(header), key.data(), key.size());
+	if (size > 0)
+		memcpy(file.data() + sizeof(header) + key.size(), data, size);
+
+	const std::string filepath = directory + "/" + name;
+	if (!FileHelper::WriteFileAtomic(filepath, file.data(), file.size()))
+		return false;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (directory != this->directory)
+		return true;
+
+	IndexEntry& entry = this->index[name];
+	this->localSizeInBytes -= entry.sizeInBytes;
+	entry.sizeInBytes = file.size();
+	entry.lastUsed = FileHelper::GetLastWriteTime(filepath);
+	this->localSizeInBytes += entry.sizeInBytes;
+	if (this->localSizeInBytes > this->maxSizeInBytes)
+		TrimLocked(static_cast<uint64_t>(this->maxSizeInBytes * TrimTarget));
+	return true;
+}
+
+void DerivedDataCache::LoadIndex()
+{
+	if (this->indexLoaded)
+		return;
+	this->indexLoaded = true;
+
+	for (const std::string& name : FileHelper::ListFiles(this->directory, Extension))
+	{
+		const std::string filepath = this->directory + "/" + name;
+		IndexEntry& entry = this->index[name];
+		entry.sizeInBytes = FileHelper::GetFileSize(filepath);
+		entry.lastUsed = FileHelper::GetLastWriteTime(filepath);
+		this->localSizeInBytes += entry.sizeInBytes;
+	}
+}
+
+void DerivedDataCache::TrimLocked(uint64_t maxSizeInBytes)
+{
+	if (this->localSizeInBytes <= maxSizeInBytes)
+		return;
+
+	std::vector<std::pair<uint64_t, std::string>> byAge;
+	byAge.reserve(this->index.size());
+	for (const auto& entry : this->index)
+		byAge.push_back(std::make_pair(entry.second.lastUsed, entry.first));
+	std::sort(byAge.begin(), byAge.end());
+
+	for (const auto& entry : byAge)
+	{
+		if (this->localSizeInBytes <= maxSizeInBytes)
+			break;
+		// Another process may have deleted it already, forget about it either way
+		FileHelper::RemoveFile(this->directory + "/" + entry.second);
+		this->localSizeInBytes -= this->index[entry.second].sizeInBytes;
+		this->index.erase(entry.second);
+		this->statistics.trimmed++;
+	}
+}
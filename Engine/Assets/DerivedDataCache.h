@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Content addressed store for the output of expensive asset processing (model imports, decoded textures, ...).
+//
+// Keys are built with MakeKey from a hash of the source file contents plus the producer's version and options, so an
+// entry never goes stale: editing the source, bumping the version or changing an option simply asks for a different
+// key. Entries are plain files, one per key, in a local directory and optionally a shared one (a network folder the
+// whole team points at). Lookups try local first, then shared, and copy shared hits down. Puts go to both.
+//
+// Every entry carries its key and a hash of its payload. Anything that does not check out is deleted and reported as
+// a miss, so a torn write or a bad disk costs one re-import. The local directory is trimmed least recently used first
+// once it grows past the size limit, the shared directory is never trimmed from here.
+//
+// Thread safe, the importers call it from the thread pool
+class DerivedDataCache
+{
+public:
+	struct Statistics
+	{
+		uint64_t hits = 0;
+		uint64_t sharedHits = 0; // Included in hits
+		uint64_t misses = 0;
+		uint64_t puts = 0;
+		uint64_t corrupt = 0; // Entries that failed validation and were deleted, also counted as misses
+		uint64_t trimmed = 0; // Entries deleted to stay under the size limit
+		uint64_t bytesRead = 0;
+		uint64_t bytesWritten = 0;
+		uint64_t localSizeInBytes = 0;
+		uint32_t localEntries = 0;
+
+		float GetHitRate() const { return hits + misses > 0 ? static_cast<float>(hits) / (hits + misses) : 0.0f; }
+	};
+
+	static const uint64_t DefaultMaxSizeInBytes = 4ull * 1024 * 1024 * 1024;
+	static const char* const DefaultDirectory;
+	static const char* const Extension;
+
+	static DerivedDataCache& GetShared();
+
+	DerivedDataCache();
+
+	// Set these up before the first Get or Put
+	void SetDirectory(const std::string& directory);
+	void SetSharedDirectory(const std::string& directory); // Empty to disable
+	void SetMaxSizeInBytes(uint64_t maxSizeInBytes);
+	void SetEnabled(bool enabled); // Disabled caches miss every Get and drop every Put, for benchmarking the real work
+
+	// type names the kind of data ("model", "texture"), version is bumped by its producer whenever its output changes
+	static std::string MakeKey(const char* type, uint32_t version, uint64_t sourceHash, const std::string& options);
+
+	bool Get(const std::string& key, std::vector<uint8_t>& data);
+	bool Put(const std::string& key, const void* data, size_t size);
+	bool Put(const std::string& key, const std::vector<uint8_t>& data) { return Put(key, data.data(), data.size()); }
+
+	// Deletes least recently used local entries until the local directory is at most maxSizeInBytes
+	void Trim(uint64_t maxSizeInBytes);
+
+	Statistics GetStatistics();
+	void ResetStatistics();
+
+private:
+	struct IndexEntry
+	{
+		uint64_t sizeInBytes = 0;
+		uint64_t lastUsed = 0; // Last write time of the file, Get touches it
+	};
+
+	std::string GetEntryName(const std::string& key) const;
+	// Loads and validates one entry file, deleting it if it is corrupt
+	bool Read(const std::string& filepath, const std::string& key, std::vector<uint8_t>& data, bool& corrupt);
+	bool Write(const std::string& directory, const std::string& name, const std::string& key, const void* data, size_t size);
+	// Builds the index of the local directory the first time it is needed. Called with the mutex held
+	void LoadIndex();
+	void TrimLocked(uint64_t maxSizeInBytes);
+
+	std::mutex mutex;
+	std::string directory;
+	std::string sharedDirectory;
+	uint64_t maxSizeInBytes = DefaultMaxSizeInBytes;
+	bool enabled = true;
+	bool indexLoaded = false;
+	std::unordered_map<std::string, IndexEntry> index; // Local entries by file name
+	uint64_t localSizeInBytes = 0;
+	Statistics statistics;
+};
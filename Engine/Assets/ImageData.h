@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Pixel formats the image pipeline produces. The values are the matching DXGI_FORMAT ones, so the graphics side
+// static_casts instead of translating
+enum class PixelFormat : uint32_t
+{
+	Unknown = 0,
+	R16G16B16A16_UNORM = 11,
+	R8G8B8A8_UNORM = 28,
+	R16_UNORM = 56,
+	R8_UNORM = 61,
+	BC1_UNORM = 71, // Blocks of 4x4 texels, see BlockCompressor
+	BC3_UNORM = 77,
+	BC4_UNORM = 80,
+	BC5_UNORM = 83,
+	BC7_UNORM = 98,
+};
+
+// The parts of a D3D12_RESOURCE_DESC an image file decides, headless code fills these in and Graphics turns them
+// into the real thing (CD3DX12_RESOURCE_DESC::Tex2D)
+struct ImageDescription
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint16_t depthOrArraySize = 1;
+	uint16_t mipLevels = 1;
+	PixelFormat format = PixelFormat::Unknown;
+	uint32_t rowPitch = 0; // Bytes from one row of the top level to the next, rows are tightly packed. Rows of blocks for block compressed formats
+
+	static uint32_t GetBytesPerPixel(PixelFormat format); // 0 for block compressed formats
+	static uint32_t GetBytesPerBlock(PixelFormat format); // 0 for formats that are not block compressed
+	static bool IsBlockCompressed(PixelFormat format) { return GetBytesPerBlock(format) > 0; }
+
+	// Levels follow each other without padding, every level half the size of the one above and at least 1x1.
+	// Block compressed levels take whole blocks, a 2x2 level is one block
+	uint32_t GetLevelWidth(uint32_t level) const { return this->width >> level > 0 ? this->width >> level : 1; }
+	uint32_t GetLevelHeight(uint32_t level) const { return this->height >> level > 0 ? this->height >> level : 1; }
+	uint32_t GetLevelRowCount(uint32_t level) const { return IsBlockCompressed(this->format) ? (GetLevelHeight(level) + 3) / 4 : GetLevelHeight(level); }
+	uint32_t GetLevelRowPitch(uint32_t level) const;
+	uint64_t GetLevelSize(uint32_t level) const { return static_cast<uint64_t>(GetLevelRowPitch(level)) * GetLevelRowCount(level); }
+	uint64_t GetLevelOffset(uint32_t level) const;
+	uint64_t GetSize() const { return GetLevelOffset(this->mipLevels); } // Every level
+};
+
+// CPU side copy of an image, the texture counterpart of ModelData
+struct ImageData
+{
+	ImageDescription description;
+	std::vector<uint8_t> pixels; // Every level, the top one first, see GetLevelOffset
+};
+
+inline uint32_t ImageDescription::GetBytesPerPixel(PixelFormat format)
+{
+	switch (format)
+	{
+	case PixelFormat::R16G16B16A16_UNORM: return 8;
+	case PixelFormat::R8G8B8A8_UNORM: return 4;
+	case PixelFormat::R16_UNORM: return 2;
+	case PixelFormat::R8_UNORM: return 1;
+	default: return 0;
+	}
+}
+
+inline uint32_t ImageDescription::GetBytesPerBlock(PixelFormat format)
+{
+	switch (format)
+	{
+	case PixelFormat::BC1_UNORM: return 8;
+	case PixelFormat::BC4_UNORM: return 8;
+	case PixelFormat::BC3_UNORM: return 16;
+	case PixelFormat::BC5_UNORM: return 16;
+	case PixelFormat::BC7_UNORM: return 16;
+	default: return 0;
+	}
+}
+
+inline uint32_t ImageDescription::GetLevelRowPitch(uint32_t level) const
+{
+	if (level == 0)
+		return this->rowPitch;
+	if (IsBlockCompressed(this->format))
+		return (GetLevelWidth(level) + 3) / 4 * GetBytesPerBlock(this->format);
+	return GetLevelWidth(level) * GetBytesPerPixel(this->format);
+}
+
+inline uint64_t ImageDescription::GetLevelOffset(uint32_t level) const
+{
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < level; i++)
+		offset += GetLevelSize(i);
+	return offset;
+}
@@ -0,0 +1,78 @@
+#include "ImageDecoder.h"
+#include "JpegDecoder.h"
+#include "MappedFile.h"
+#include "PngDecoder.h"
+#include "../ThreadPool.h"
+#include <cstring>
+
+ImageFileType ImageDecoder::Identify(const uint8_t* data, size_t size)
+{
+	static const uint8_t PngSignature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+		return ImageFileType::Jpeg;
+	if (size >= 8 && memcmp(data, PngSignature, 8) == 0)
+		return ImageFileType::Png;
+	return ImageFileType::Unknown;
+}
+
+bool ImageDecoder::ReadDescription(const uint8_t* data, size_t size, ImageDescription& description)
+{
+	switch (Identify(data, size))
+	{
+	case ImageFileType::Jpeg:
+		return JpegDecoder::ReadDescription(data, size, description);
+	case ImageFileType::Png:
+		return PngDecoder::ReadDescription(data, size, description);
+	default:
+		return false;
+	}
+}
+
+bool ImageDecoder::Decode(const uint8_t* data, size_t size, ImageData& image, ThreadPool& pool)
+{
+	switch (Identify(data, size))
+	{
+	case ImageFileType::Jpeg:
+		return JpegDecoder::Decode(data, size, image, pool);
+	case ImageFileType::Png:
+		return PngDecoder::Decode(data, size, image, pool);
+	default:
+		return false;
+	}
+}
+
+bool ImageDecoder::DecodeInto(const uint8_t* data, size_t size, uint8_t* destination, size_t rowPitch, ThreadPool& pool)
+{
+	switch (Identify(data, size))
+	{
+	case ImageFileType::Jpeg:
+		return JpegDecoder::DecodeInto(data, size, destination, rowPitch, pool);
+	case ImageFileType::Png:
+		return PngDecoder::DecodeInto(data, size, destination, rowPitch, pool);
+	default:
+		return false;
+	}
+}
+
+bool ImageDecoder::Decode(const uint8_t* data, size_t size, ImageData& image)
+{
+	return Decode(data, size, image, ThreadPool::GetShared());
+}
+
+bool ImageDecoder::DecodeFile(const std::string& filepath, ImageData& image)
+{
+	MappedFile file;
+	if (!file.Open(filepath))
+		return false;
+	return Decode(file.Data(), file.Size(), image);
+}
+
+bool ImageDecoder::IsSimdAvailable()
+{
+	return JpegDecoder::IsSimdAvailable();
+}
+
+void ImageDecoder::SetSimdEnabled(bool enabled)
+{
+	JpegDecoder::SetSimdEnabled(enabled);
+}
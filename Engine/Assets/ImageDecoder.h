@@ -0,0 +1,38 @@
+#pragma once
+#include "ImageData.h"
+#include <cstddef>
+#include <string>
+
+class ThreadPool;
+
+enum class ImageFileType
+{
+	Unknown,
+	Jpeg,
+	Png,
+};
+
+// Decodes the image files the engine loads textures from without WIC, so it needs no COM, runs on any thread and
+// works headless on every platform. The format is picked from the leading bytes, not the extension.
+//
+// Files this cannot read (BMP, TIFF, CMYK JPEG, ...) fail, Graphics falls back to WIC for those
+class ImageDecoder
+{
+public:
+	static ImageFileType Identify(const uint8_t* data, size_t size);
+
+	// Size and format the image decodes to, from the header alone
+	static bool ReadDescription(const uint8_t* data, size_t size, ImageDescription& description);
+
+	// The pool shares out the parallel parts of decoding, see JpegDecoder and PngDecoder
+	static bool Decode(const uint8_t* data, size_t size, ImageData& image, ThreadPool& pool);
+	static bool Decode(const uint8_t* data, size_t size, ImageData& image);
+	static bool DecodeFile(const std::string& filepath, ImageData& image);
+	// Writes the rows straight to where they have to go, rowPitch bytes apart, such as an upload buffer at the
+	// footprint UploadLayout gives or a buffer of the caller's. destination has to hold the image ReadDescription
+	// describes for the same data, rowPitch has to be at least its rowPitch
+	static bool DecodeInto(const uint8_t* data, size_t size, uint8_t* destination, size_t rowPitch, ThreadPool& pool);
+
+	static bool IsSimdAvailable();
+	static void SetSimdEnabled(bool enabled); // Benchmarking only, not thread safe
+};
@@ -0,0 +1,95 @@
+#include "IndexCompaction.h"
+#include <cstring>
+
+void IndexCompaction::NarrowTo16Bit(const uint32_t* indices, size_t indexCount, uint16_t* output)
+{
+	for (size_t i = 0; i < indexCount; i++)
+		output[i] = static_cast<uint16_t>(indices[i]);
+}
+
+size_t IndexCompaction::WriteIndexBuffer(const uint32_t* indices, size_t indexCount, size_t vertexCount, void* destination)
+{
+	if (Fits16BitIndices(vertexCount))
+		NarrowTo16Bit(indices, indexCount, static_cast<uint16_t*>(destination));
+	else
+		memcpy(destination, indices, indexCount * sizeof(uint32_t));
+	return indexCount * GetIndexStride(vertexCount);
+}
+
+size_t IndexCompaction::Split(const MeshData& mesh, std::vector<MeshData>& parts, uint32_t maxVertices)
+{
+	const size_t firstPart = parts.size();
+	const size_t triangleCount = mesh.indices.size() / 3;
+	if (triangleCount == 0 || maxVertices < 3)
+		return 0;
+
+	// remap holds the part local index of a vertex, owner says which part wrote it so nothing has to be cleared between parts
+	const uint32_t noPart = 0xFFFFFFFF;
+	const bool hasNormals = mesh.normals.size() == mesh.vertices.size();
+	const bool hasTangents = mesh.tangents.size() == mesh.vertices.size();
+	std::vector<uint32_t> remap(mesh.vertices.size());
+	std::vector<uint32_t> owner(mesh.vertices.size(), noPart);
+
+	MeshData* part = nullptr;
+	uint32_t partIndex = noPart;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* triangle = &mesh.indices[t * 3];
+
+		uint32_t newVertices = 0;
+		if (part != nullptr)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				if (owner[triangle[k]] != partIndex)
+					newVertices++;
+			}
+		}
+
+		if (part == nullptr || part->vertices.size() + newVertices > maxVertices)
+		{
+			parts.emplace_back();
+			part = &parts.back();
+			partIndex = static_cast<uint32_t>(parts.size() - firstPart - 1);
+			part->transform = mesh.transform;
+			part->materialIndex = mesh.materialIndex;
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle[k];
+			if (owner[v] != partIndex)
+			{
+				owner[v] = partIndex;
+				remap[v] = static_cast<uint32_t>(part->vertices.size());
+				part->vertices.push_back(mesh.vertices[v]);
+				if (hasNormals)
+					part->normals.push_back(mesh.normals[v]);
+				if (hasTangents)
+					part->tangents.push_back(mesh.tangents[v]);
+			}
+			part->indices.push_back(remap[v]);
+		}
+	}
+	return parts.size() - firstPart;
+}
+
+void IndexCompaction::SplitFor16BitIndices(ModelData& model)
+{
+	bool needsSplit = false;
+	for (const MeshData& mesh : model.meshes)
+		needsSplit |= !Fits16BitIndices(mesh.vertices.size());
+	if (!needsSplit)
+		return;
+
+	std::vector<MeshData> meshes;
+	meshes.reserve(model.meshes.size());
+	for (MeshData& mesh : model.meshes)
+	{
+		if (Fits16BitIndices(mesh.vertices.size()))
+			meshes.push_back(std::move(mesh));
+		else
+			Split(mesh, meshes);
+	}
+	model.meshes.swap(meshes);
+}
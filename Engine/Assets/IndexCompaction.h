@@ -0,0 +1,28 @@
+#pragma once
+#include "MeshData.h"
+
+// Helpers for storing index buffers as uint16_t (DXGI_FORMAT_R16_UINT). The pipeline keeps 32 bit indices in
+// MeshData and IndexBuffer narrows them into its upload copy (WriteIndexBuffer), any mesh with up to 65536 vertices
+// qualifies. Meshes over the limit are split into parts that each fit when ImportOptions::splitFor16BitIndices is set.
+class IndexCompaction
+{
+public:
+	static const uint32_t MaxVerticesFor16BitIndices = 65536;
+
+	static bool Fits16BitIndices(size_t vertexCount) { return vertexCount <= MaxVerticesFor16BitIndices; }
+	static uint32_t GetIndexStride(size_t vertexCount) { return Fits16BitIndices(vertexCount) ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+	// Caller has made sure every index is below 65536
+	static void NarrowTo16Bit(const uint32_t* indices, size_t indexCount, uint16_t* output);
+	// The indices of a mesh with vertexCount vertices the way its index buffer stores them, 16 bit when they fit.
+	// destination takes indexCount * GetIndexStride(vertexCount) bytes, which is what this returns
+	static size_t WriteIndexBuffer(const uint32_t* indices, size_t indexCount, size_t vertexCount, void* destination);
+
+	// Cuts the triangle list into consecutive runs that reference at most maxVertices vertices each. Triangle order
+	// is kept, so a mesh that went through the vertex cache optimizer keeps its locality. Parts get their own
+	// compact vertex array, transform and material. Returns the number of parts appended
+	static size_t Split(const MeshData& mesh, std::vector<MeshData>& parts, uint32_t maxVertices = MaxVerticesFor16BitIndices);
+
+	// Splits every mesh in the model that is over the 16 bit limit, keeps the others as they are
+	static void SplitFor16BitIndices(ModelData& model);
+};
@@ -0,0 +1,355 @@
+#include "Inflate.h"
+#include <cstring>
+
+namespace
+{
+	const int FastBits = 10;
+	const int MaxBits = 15;
+	const int MaxLengthCodes = 288;
+	const int MaxDistanceCodes = 32;
+
+	const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// Canonical Huffman code. fast holds symbol << 4 | length for every FastBits bit pattern whose code is short
+	// enough, 0 for the others, which are decoded one bit at a time from count and symbols
+	struct Huffman
+	{
+		uint16_t fast[1 << FastBits];
+		uint16_t count[MaxBits + 1];
+		uint16_t symbols[MaxLengthCodes];
+
+		bool Build(const uint8_t* lengths, int symbolCount)
+		{
+			memset(this->count, 0, sizeof(this->count));
+			for (int i = 0; i < symbolCount; i++)
+				this->count[lengths[i]]++;
+			this->count[0] = 0;
+
+			// Over subscribed sets of lengths cannot be decoded, incomplete ones only fail if a missing code shows up
+			int left = 1;
+			for (int length = 1; length <= MaxBits; length++)
+			{
+				left = (left << 1) - this->count[length];
+				if (left < 0)
+					return false;
+			}
+
+			uint16_t offsets[MaxBits + 2];
+			offsets[1] = 0;
+			for (int length = 1; length <= MaxBits; length++)
+				offsets[length + 1] = static_cast<uint16_t>(offsets[length] + this->count[length]);
+			for (int i = 0; i < symbolCount; i++)
+			{
+				if (lengths[i] != 0)
+					this->symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+			}
+
+			// Deflate sends codes starting from their most significant bit, the bit reader is least significant bit
+			// first, so table indices are the codes reversed
+			memset(this->fast, 0, sizeof(this->fast));
+			uint32_t code = 0;
+			int index = 0;
+			for (int length = 1; length <= FastBits; length++)
+			{
+				for (int i = 0; i < this->count[length]; i++, index++, code++)
+				{
+					uint32_t reversed = 0;
+					for (int bit = 0; bit < length; bit++)
+						reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+					for (uint32_t j = reversed; j < (1u << FastBits); j += 1u << length)
+						this->fast[j] = static_cast<uint16_t>(this->symbols[index] << 4 | length);
+				}
+				code <<= 1;
+			}
+			return true;
+		}
+	};
+
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* input, size_t size)
+			: input(input), size(size)
+		{
+		}
+
+		// Past the end the reader feeds zeros and counts them, Overrun tells if any were used
+		void Fill()
+		{
+			while (this->bitCount <= 56)
+			{
+				uint64_t byte = 0;
+				if (this->position < this->size)
+					byte = this->input[this->position++];
+				else
+					this->padding++;
+				this->buffer |= byte << this->bitCount;
+				this->bitCount += 8;
+			}
+		}
+
+		uint32_t Peek(int count) const { return static_cast<uint32_t>(this->buffer & ((1ull << count) - 1)); }
+
+		void Consume(int count)
+		{
+			this->buffer >>= count;
+			this->bitCount -= count;
+		}
+
+		uint32_t GetBits(int count)
+		{
+			if (this->bitCount < count)
+				Fill();
+			uint32_t value = Peek(count);
+			Consume(count);
+			return value;
+		}
+
+		int Decode(const Huffman& huffman)
+		{
+			if (this->bitCount < MaxBits)
+				Fill();
+			uint16_t entry = huffman.fast[Peek(FastBits)];
+			if (entry != 0)
+			{
+				Consume(entry & 15);
+				return entry >> 4;
+			}
+
+			// Longer codes, canonical decoding a bit at a time
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (int length = 1; length <= MaxBits; length++)
+			{
+				code |= static_cast<int>((this->buffer >> (length - 1)) & 1);
+				int count = huffman.count[length];
+				if (code - first < count)
+				{
+					Consume(length);
+					return huffman.symbols[index + code - first];
+				}
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+
+		// Stored blocks start on a byte boundary
+		void AlignToByte() { Consume(this->bitCount & 7); }
+
+		bool Overrun() const { return this->padding * 8 > static_cast<size_t>(this->bitCount); }
+
+		// Bytes the reader has taken from the input but not handed out yet go back, so the byte position is exact again
+		size_t GetBytePosition() const { return this->position + this->padding - this->bitCount / 8; }
+
+		void SetBytePosition(size_t position)
+		{
+			this->position = position;
+			this->buffer = 0;
+			this->bitCount = 0;
+			this->padding = 0;
+		}
+
+	private:
+		const uint8_t* input;
+		size_t size;
+		size_t position = 0;
+		uint64_t buffer = 0;
+		int bitCount = 0;
+		size_t padding = 0;
+	};
+
+	bool ReadDynamicCodes(BitReader& reader, Huffman& lengthCodes, Huffman& distanceCodes)
+	{
+		int lengthCount = static_cast<int>(reader.GetBits(5)) + 257;
+		int distanceCount = static_cast<int>(reader.GetBits(5)) + 1;
+		int codeLengthCount = static_cast<int>(reader.GetBits(4)) + 4;
+		if (lengthCount > 286 || distanceCount > 30)
+			return false;
+
+		uint8_t codeLengths[19] = {};
+		for (int i = 0; i < codeLengthCount; i++)
+			codeLengths[CodeLengthOrder[i]] = static_cast<uint8_t>(reader.GetBits(3));
+		Huffman codeLengthCodes;
+		if (!codeLengthCodes.Build(codeLengths, 19))
+			return false;
+
+		// Both sets of lengths come as one sequence, a repeat may run from one into the other
+		uint8_t lengths[MaxLengthCodes + MaxDistanceCodes] = {};
+		int total = lengthCount + distanceCount;
+		for (int i = 0; i < total;)
+		{
+			int symbol = reader.Decode(codeLengthCodes);
+			if (symbol < 0)
+				return false;
+			if (symbol < 16)
+			{
+				lengths[i++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+			uint8_t value = 0;
+			int repeat;
+			if (symbol == 16)
+			{
+				if (i == 0)
+					return false;
+				value = lengths[i - 1];
+				repeat = 3 + static_cast<int>(reader.GetBits(2));
+			}
+			else if (symbol == 17)
+			{
+				repeat = 3 + static_cast<int>(reader.GetBits(3));
+			}
+			else
+			{
+				repeat = 11 + static_cast<int>(reader.GetBits(7));
+			}
+			if (i + repeat > total)
+				return false;
+			memset(lengths + i, value, repeat);
+			i += repeat;
+		}
+		if (lengths[256] == 0)
+			return false; // No end of block code
+		return lengthCodes.Build(lengths, lengthCount) && distanceCodes.Build(lengths + lengthCount, distanceCount);
+	}
+
+	void BuildFixedCodes(Huffman& lengthCodes, Huffman& distanceCodes)
+	{
+		uint8_t lengths[MaxLengthCodes];
+		memset(lengths, 8, 144);
+		memset(lengths + 144, 9, 112);
+		memset(lengths + 256, 7, 24);
+		memset(lengths + 280, 8, 8);
+		lengthCodes.Build(lengths, MaxLengthCodes);
+		memset(lengths, 5, 30);
+		distanceCodes.Build(lengths, 30);
+	}
+
+	bool InflateBlock(BitReader& reader, const Huffman& lengthCodes, const Huffman& distanceCodes, uint8_t* output, size_t outputSize, size_t& written)
+	{
+		size_t position = written;
+		for (;;)
+		{
+			int symbol = reader.Decode(lengthCodes);
+			if (symbol < 0)
+				return false;
+			if (symbol < 256)
+			{
+				if (position == outputSize)
+					return false;
+				output[position++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+			if (symbol == 256)
+				break;
+
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			size_t length = LengthBase[symbol] + reader.GetBits(LengthExtra[symbol]);
+			int distanceSymbol = reader.Decode(distanceCodes);
+			if (distanceSymbol < 0 || distanceSymbol >= 30)
+				return false;
+			size_t distance = DistanceBase[distanceSymbol] + reader.GetBits(DistanceExtra[distanceSymbol]);
+			if (distance > position || length > outputSize - position)
+				return false;
+
+			// Matches may overlap what they write, a distance of one repeats a single byte
+			const uint8_t* source = output + position - distance;
+			uint8_t* destination = output + position;
+			if (distance >= length)
+			{
+				memcpy(destination, source, length);
+			}
+			else
+			{
+				for (size_t i = 0; i < length; i++)
+					destination[i] = source[i];
+			}
+			position += length;
+			if (reader.Overrun())
+				return false;
+		}
+		written = position;
+		return !reader.Overrun();
+	}
+}
+
+bool Inflate::Decompress(const uint8_t* input, size_t size, uint8_t* output, size_t outputSize)
+{
+	BitReader reader(input, size);
+	Huffman lengthCodes;
+	Huffman distanceCodes;
+	size_t written = 0;
+	bool last = false;
+	while (!last)
+	{
+		last = reader.GetBits(1) != 0;
+		uint32_t type = reader.GetBits(2);
+		if (type == 0)
+		{
+			// Stored block, a length, its complement and the bytes as they are
+			reader.AlignToByte();
+			size_t position = reader.GetBytePosition();
+			if (position + 4 > size)
+				return false;
+			size_t length = input[position] | input[position + 1] << 8;
+			size_t complement = input[position + 2] | input[position + 3] << 8;
+			position += 4;
+			if (length != (~complement & 0xFFFF) || length > size - position || length > outputSize - written)
+				return false;
+			memcpy(output + written, input + position, length);
+			written += length;
+			reader.SetBytePosition(position + length);
+			continue;
+		}
+
+		if (type == 1)
+			BuildFixedCodes(lengthCodes, distanceCodes);
+		else if (type != 2 || !ReadDynamicCodes(reader, lengthCodes, distanceCodes))
+			return false;
+		if (!InflateBlock(reader, lengthCodes, distanceCodes, output, outputSize, written))
+			return false;
+	}
+	return written == outputSize;
+}
+
+bool Inflate::DecompressZlib(const uint8_t* input, size_t size, uint8_t* output, size_t outputSize)
+{
+	// Deflate with a window of at most 32 KB and no preset dictionary, the only kind PNG allows
+	if (size < 6 || (input[0] & 15) != 8 || (input[0] >> 4) > 7 || (input[0] << 8 | input[1]) % 31 != 0 || (input[1] & 32) != 0)
+		return false;
+	if (!Decompress(input + 2, size - 6, output, outputSize))
+		return false;
+	const uint8_t* checksum = input + size - 4;
+	uint32_t expected = static_cast<uint32_t>(checksum[0]) << 24 | checksum[1] << 16 | checksum[2] << 8 | checksum[3];
+	return Adler32(output, outputSize) == expected;
+}
+
+uint32_t Inflate::Adler32(const uint8_t* data, size_t size, uint32_t adler)
+{
+	// The sums are only reduced every 5552 bytes, the most that cannot overflow 32 bits
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+	while (size > 0)
+	{
+		size_t block = size < 5552 ? size : 5552;
+		size -= block;
+		for (size_t i = 0; i < block; i++)
+		{
+			a += data[i];
+			b += a;
+		}
+		data += block;
+		a %= 65521;
+		b %= 65521;
+	}
+	return b << 16 | a;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Deflate decompression (RFC 1951) and the zlib wrapper around it (RFC 1950), the compression PNG uses. Written from
+// the specs like Lz4, so decoding images needs no extra dependency.
+//
+// Codes of up to ten bits, nearly all of them in practice, are decoded with one table lookup. The whole output has to
+// fit in the buffer given, there is no streaming, which is all PNG needs as the decoded size follows from the header
+class Inflate
+{
+public:
+	// Every read and write is bounds checked, damaged input fails instead of overrunning. Succeeds only if the stream
+	// decodes to exactly outputSize bytes
+	static bool Decompress(const uint8_t* input, size_t size, uint8_t* output, size_t outputSize);
+
+	// The same with the zlib header and Adler-32 checksum checked
+	static bool DecompressZlib(const uint8_t* input, size_t size, uint8_t* output, size_t outputSize);
+
+	static uint32_t Adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+};
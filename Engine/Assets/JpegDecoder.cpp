@@ -0,0 +1,1225 @@
+#include "JpegDecoder.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define JPEG_DECODER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	bool simdEnabled = true;
+
+	// Natural order index of the coefficient at each zigzag position. The extra entries catch run lengths that
+	// overshoot the block in corrupt files
+	const uint8_t ZigZag[64 + 16] =
+	{
+		0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+		63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+	};
+
+	const int FastBits = 9;
+	const int MaxComponents = 3;
+	const uint64_t MaxPixels = 1ull << 28;
+	const int RowsPerBand = 16;
+
+	// Canonical Huffman table (T.81 annex C). Codes of up to FastBits bits are looked up directly, longer ones are
+	// found by comparing against the largest code of each length
+	struct HuffmanTable
+	{
+		uint8_t fast[1 << FastBits]; // Index into values, 255 for codes longer than FastBits
+		uint8_t values[256];
+		uint8_t sizes[257];
+		uint32_t maxCode[18]; // Per length, left aligned to 16 bits
+		int delta[17]; // Code to values index, per length
+		bool defined = false;
+	};
+
+	struct Component
+	{
+		uint8_t id = 0;
+		int h = 1; // Sampling factors
+		int v = 1;
+		int quantizationTable = 0;
+		int dcTable = 0;
+		int acTable = 0;
+		int width = 0; // Samples the image covers, ceil(image width * h / largest h)
+		int height = 0;
+		int blocksWide = 0; // Plane size in blocks, padded to whole MCUs
+		int blocksHigh = 0;
+		std::vector<uint8_t> plane; // blocksWide * 8 samples per row
+		std::vector<int16_t> coefficients; // Progressive files only, natural order and not dequantized
+	};
+
+	// Entropy coded data, MSB first with the 0xFF00 byte stuffing removed. Stops at the first marker and feeds zeros
+	// from there, a truncated file then decodes garbage instead of running off the end
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* data, size_t position, size_t end)
+			: data(data), position(position), end(end)
+		{
+		}
+
+		int Decode(const HuffmanTable& table)
+		{
+			if (this->bits < 16)
+				Fill();
+			int k = table.fast[this->buffer >> (32 - FastBits)];
+			if (k < 255)
+			{
+				int size = table.sizes[k];
+				this->buffer <<= size;
+				this->bits -= size;
+				return table.values[k];
+			}
+
+			uint32_t top = this->buffer >> 16;
+			int length = FastBits + 1;
+			while (top >= table.maxCode[length])
+				length++;
+			if (length > 16)
+				return -1;
+			int index = static_cast<int>(this->buffer >> (32 - length)) + table.delta[length];
+			if (index < 0 || index > 255)
+				return -1;
+			this->buffer <<= length;
+			this->bits -= length;
+			return table.values[index];
+		}
+
+		// count from 1 to 16
+		uint32_t GetBits(int count)
+		{
+			if (this->bits < count)
+				Fill();
+			uint32_t value = this->buffer >> (32 - count);
+			this->buffer <<= count;
+			this->bits -= count;
+			return value;
+		}
+
+		// Magnitude category decoding (T.81 F.2.2.1), the leading bit tells the sign
+		int ReceiveExtend(int count)
+		{
+			int value = static_cast<int>(GetBits(count));
+			return value < (1 << (count - 1)) ? value - (1 << count) + 1 : value;
+		}
+
+		// Drops the padding bits and moves past the next restart marker. False if another marker or the end comes first
+		bool Restart()
+		{
+			this->buffer = 0;
+			this->bits = 0;
+			this->markerHit = false;
+			while (this->position + 1 < this->end)
+			{
+				if (this->data[this->position] == 0xFF)
+				{
+					uint8_t marker = this->data[this->position + 1];
+					if (marker >= 0xD0 && marker <= 0xD7)
+					{
+						this->position += 2;
+						return true;
+					}
+					if (marker != 0x00 && marker != 0xFF)
+						return false;
+				}
+				this->position++;
+			}
+			return false;
+		}
+
+	private:
+		void Fill()
+		{
+			while (this->bits <= 24)
+			{
+				uint32_t byte = 0;
+				if (!this->markerHit && this->position < this->end)
+				{
+					byte = this->data[this->position];
+					if (byte != 0xFF)
+					{
+						this->position++;
+					}
+					else if (this->position + 1 < this->end && this->data[this->position + 1] == 0x00)
+					{
+						this->position += 2;
+					}
+					else
+					{
+						this->markerHit = true;
+						byte = 0;
+					}
+				}
+				this->buffer |= byte << (24 - this->bits);
+				this->bits += 8;
+			}
+		}
+
+		const uint8_t* data;
+		size_t position;
+		size_t end;
+		uint32_t buffer = 0;
+		int bits = 0;
+		bool markerHit = false;
+	};
+
+	uint8_t Clamp(int value)
+	{
+		return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+
+	// Corrupt files can hold values far outside the 16 bits a valid coefficient needs, which would overflow the inverse DCT
+	int Dequantize(int value, int quantization)
+	{
+		int product = value * quantization;
+		return product < -32768 ? -32768 : (product > 32767 ? 32767 : product);
+	}
+
+	// Accurate integer inverse DCT, the LL&M algorithm libjpeg's jidctint.c uses, with 12 bits of fraction in the
+	// constants. Columns first, then rows with the +128 level shift folded into the rounding
+	const int C0_298631336 = 1223;
+	const int C0_390180644 = 1598;
+	const int C0_541196100 = 2217;
+	const int C0_765366865 = 3135;
+	const int C0_899976223 = 3686;
+	const int C1_175875602 = 4816;
+	const int C1_501321110 = 6149;
+	const int C1_847759065 = 7568;
+	const int C1_961570560 = 8035;
+	const int C2_053119869 = 8410;
+	const int C2_562915447 = 10498;
+	const int C3_072711026 = 12586;
+
+	struct Idct1D
+	{
+		int x0, x1, x2, x3, t0, t1, t2, t3;
+
+		Idct1D(int s0, int s1, int s2, int s3, int s4, int s5, int s6, int s7)
+		{
+			int p1 = (s2 + s6) * C0_541196100;
+			int e2 = p1 - s6 * C1_847759065;
+			int e3 = p1 + s2 * C0_765366865;
+			int e0 = (s0 + s4) * 4096;
+			int e1 = (s0 - s4) * 4096;
+			this->x0 = e0 + e3;
+			this->x3 = e0 - e3;
+			this->x1 = e1 + e2;
+			this->x2 = e1 - e2;
+
+			int o0 = s7;
+			int o1 = s5;
+			int o2 = s3;
+			int o3 = s1;
+			int p3 = o0 + o2;
+			int p4 = o1 + o3;
+			int q1 = o0 + o3;
+			int q2 = o1 + o2;
+			int p5 = (p3 + p4) * C1_175875602;
+			o0 *= C0_298631336;
+			o1 *= C2_053119869;
+			o2 *= C3_072711026;
+			o3 *= C1_501321110;
+			q1 = p5 - q1 * C0_899976223;
+			q2 = p5 - q2 * C2_562915447;
+			p3 *= -C1_961570560;
+			p4 *= -C0_390180644;
+			this->t3 = o3 + q1 + p4;
+			this->t2 = o2 + q2 + p3;
+			this->t1 = o1 + q2 + p4;
+			this->t0 = o0 + q1 + p3;
+		}
+	};
+
+	// The column pass of corrupt blocks can still leave values the multiplies of the row pass overflow on. Valid blocks
+	// stay far inside 16 bits there
+	int ClampWorkspace(int value)
+	{
+		return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+	}
+
+	// coefficients are dequantized, in natural order
+	void InverseDct(const int* coefficients, uint8_t* output, int stride)
+	{
+		int workspace[64];
+		for (int column = 0; column < 8; column++)
+		{
+			const int* c = coefficients + column;
+			int* w = workspace + column;
+			if (c[8] == 0 && c[16] == 0 && c[24] == 0 && c[32] == 0 && c[40] == 0 && c[48] == 0 && c[56] == 0)
+			{
+				int dc = ClampWorkspace(c[0] * 4);
+				w[0] = w[8] = w[16] = w[24] = w[32] = w[40] = w[48] = w[56] = dc;
+				continue;
+			}
+			Idct1D d(c[0], c[8], c[16], c[24], c[32], c[40], c[48], c[56]);
+			// 512 rounds away the 10 bits the column pass drops, the row pass keeps 2 extra bits of precision
+			d.x0 += 512; d.x1 += 512; d.x2 += 512; d.x3 += 512;
+			w[0] = ClampWorkspace((d.x0 + d.t3) >> 10);
+			w[56] = ClampWorkspace((d.x0 - d.t3) >> 10);
+			w[8] = ClampWorkspace((d.x1 + d.t2) >> 10);
+			w[48] = ClampWorkspace((d.x1 - d.t2) >> 10);
+			w[16] = ClampWorkspace((d.x2 + d.t1) >> 10);
+			w[40] = ClampWorkspace((d.x2 - d.t1) >> 10);
+			w[24] = ClampWorkspace((d.x3 + d.t0) >> 10);
+			w[32] = ClampWorkspace((d.x3 - d.t0) >> 10);
+		}
+
+		for (int row = 0; row < 8; row++)
+		{
+			const int* w = workspace + row * 8;
+			uint8_t* o = output + row * stride;
+			Idct1D d(w[0], w[1], w[2], w[3], w[4], w[5], w[6], w[7]);
+			const int bias = 65536 + (128 << 17);
+			d.x0 += bias; d.x1 += bias; d.x2 += bias; d.x3 += bias;
+			o[0] = Clamp((d.x0 + d.t3) >> 17);
+			o[7] = Clamp((d.x0 - d.t3) >> 17);
+			o[1] = Clamp((d.x1 + d.t2) >> 17);
+			o[6] = Clamp((d.x1 - d.t2) >> 17);
+			o[2] = Clamp((d.x2 + d.t1) >> 17);
+			o[5] = Clamp((d.x2 - d.t1) >> 17);
+			o[3] = Clamp((d.x3 + d.t0) >> 17);
+			o[4] = Clamp((d.x3 - d.t0) >> 17);
+		}
+	}
+
+	// Same result as InverseDct for a block without AC coefficients, which is most of them in smooth areas
+	void InverseDctDcOnly(int dc, uint8_t* output, int stride)
+	{
+		uint8_t value = Clamp(((dc + 4) >> 3) + 128);
+		for (int row = 0; row < 8; row++)
+			memset(output + row * stride, value, 8);
+	}
+
+	// YCbCr to RGB (JFIF), 14 bit fixed point. The SSE2 path does the same integer math
+	const int CrToR = 22970; // 1.40200
+	const int CbToG = -5638; // -0.34414
+	const int CrToG = -11700; // -0.71414
+	const int CbToB = 29032; // 1.77200
+	const int ColorShift = 14;
+
+	void ConvertYCbCrRow(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* output, int width)
+	{
+		int x = 0;
+#ifdef JPEG_DECODER_SSE2
+		if (simdEnabled)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i offset = _mm_set1_epi16(128);
+			const __m128i rFactors = _mm_set_epi16(CrToR, 0, CrToR, 0, CrToR, 0, CrToR, 0);
+			const __m128i gFactors = _mm_set_epi16(static_cast<short>(CrToG), static_cast<short>(CbToG), static_cast<short>(CrToG), static_cast<short>(CbToG),
+				static_cast<short>(CrToG), static_cast<short>(CbToG), static_cast<short>(CrToG), static_cast<short>(CbToG));
+			const __m128i bFactors = _mm_set_epi16(0, CbToB, 0, CbToB, 0, CbToB, 0, CbToB);
+			const __m128i rounding = _mm_set1_epi32(1 << (ColorShift - 1));
+			const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+
+			// (cb, cr) pairs times (a, b) factor pairs, rounded and shifted back to 16 bits
+			auto chroma = [&](__m128i pairsLow, __m128i pairsHigh, __m128i factors)
+			{
+				__m128i low = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(pairsLow, factors), rounding), ColorShift);
+				__m128i high = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(pairsHigh, factors), rounding), ColorShift);
+				return _mm_packs_epi32(low, high);
+			};
+
+			for (; x + 16 <= width; x += 16)
+			{
+				__m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+				__m128i cb8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cb + x));
+				__m128i cr8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cr + x));
+				__m128i channels[2][3];
+				for (int half = 0; half < 2; half++)
+				{
+					__m128i y16 = half == 0 ? _mm_unpacklo_epi8(y8, zero) : _mm_unpackhi_epi8(y8, zero);
+					__m128i cb16 = _mm_sub_epi16(half == 0 ? _mm_unpacklo_epi8(cb8, zero) : _mm_unpackhi_epi8(cb8, zero), offset);
+					__m128i cr16 = _mm_sub_epi16(half == 0 ? _mm_unpacklo_epi8(cr8, zero) : _mm_unpackhi_epi8(cr8, zero), offset);
+					__m128i pairsLow = _mm_unpacklo_epi16(cb16, cr16);
+					__m128i pairsHigh = _mm_unpackhi_epi16(cb16, cr16);
+					channels[half][0] = _mm_add_epi16(y16, chroma(pairsLow, pairsHigh, rFactors));
+					channels[half][1] = _mm_add_epi16(y16, chroma(pairsLow, pairsHigh, gFactors));
+					channels[half][2] = _mm_add_epi16(y16, chroma(pairsLow, pairsHigh, bFactors));
+				}
+				__m128i r = _mm_packus_epi16(channels[0][0], channels[1][0]);
+				__m128i g = _mm_packus_epi16(channels[0][1], channels[1][1]);
+				__m128i b = _mm_packus_epi16(channels[0][2], channels[1][2]);
+
+				// Interleave to RGBA
+				__m128i rg0 = _mm_unpacklo_epi8(r, g);
+				__m128i rg1 = _mm_unpackhi_epi8(r, g);
+				__m128i ba0 = _mm_unpacklo_epi8(b, alpha);
+				__m128i ba1 = _mm_unpackhi_epi8(b, alpha);
+				__m128i* out = reinterpret_cast<__m128i*>(output + x * 4);
+				_mm_storeu_si128(out + 0, _mm_unpacklo_epi16(rg0, ba0));
+				_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rg0, ba0));
+				_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rg1, ba1));
+				_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rg1, ba1));
+			}
+		}
+#endif
+		const int rounding = 1 << (ColorShift - 1);
+		for (; x < width; x++)
+		{
+			int luma = y[x];
+			int blue = cb[x] - 128;
+			int red = cr[x] - 128;
+			uint8_t* out = output + x * 4;
+			out[0] = Clamp(luma + ((red * CrToR + rounding) >> ColorShift));
+			out[1] = Clamp(luma + ((blue * CbToG + red * CrToG + rounding) >> ColorShift));
+			out[2] = Clamp(luma + ((blue * CbToB + rounding) >> ColorShift));
+			out[3] = 255;
+		}
+	}
+
+	void InterleaveRgbRow(const uint8_t* r, const uint8_t* g, const uint8_t* b, uint8_t* output, int width)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			output[x * 4 + 0] = r[x];
+			output[x * 4 + 1] = g[x];
+			output[x * 4 + 2] = b[x];
+			output[x * 4 + 3] = 255;
+		}
+	}
+
+	class Decoder
+	{
+	public:
+		Decoder(const uint8_t* data, size_t size)
+			: data(data), size(size)
+		{
+		}
+
+		// Reads markers up to the frame header, or through the whole file when image is given. With a destination the
+		// rows go there destinationPitch bytes apart and image only gets the description
+		bool Run(ImageData* image, ThreadPool* pool, uint8_t* destination = nullptr, size_t destinationPitch = 0);
+
+		void Describe(ImageDescription& description) const
+		{
+			description = ImageDescription();
+			description.width = static_cast<uint32_t>(this->width);
+			description.height = static_cast<uint32_t>(this->height);
+			description.format = this->componentCount == 1 ? PixelFormat::R8_UNORM : PixelFormat::R8G8B8A8_UNORM;
+			description.rowPitch = description.width * ImageDescription::GetBytesPerPixel(description.format);
+		}
+
+	private:
+		bool ReadSegment(const uint8_t*& segment, size_t& length);
+		bool ReadQuantizationTables();
+		bool ReadHuffmanTables();
+		bool ReadFrame(bool progressive);
+		bool ReadScan();
+		bool ReadAdobe();
+		bool ReadRestartInterval();
+
+		bool DecodeScan();
+		bool DecodeUnits(BitReader& reader, size_t first, size_t last);
+		bool DecodeBlock(BitReader& reader, Component& component, int bx, int by, int& dcPrediction, uint32_t& eobRun);
+		bool DecodeBlockBaseline(BitReader& reader, Component& component, int bx, int by, int& dcPrediction);
+		void TransformProgressive();
+		void ConvertRows(uint8_t* destination, size_t rowPitch, int firstRow, int lastRow) const;
+		void UpsampleRow(const Component& component, int y, uint8_t* output) const;
+
+		const uint8_t* data;
+		size_t size;
+		size_t position = 0;
+		ThreadPool* pool = nullptr;
+
+		uint16_t quantization[4][64] = {}; // Zigzag order
+		HuffmanTable huffman[2][4]; // DC, AC
+		Component components[MaxComponents];
+		int componentCount = 0;
+		int width = 0;
+		int height = 0;
+		int hMax = 1;
+		int vMax = 1;
+		int mcusWide = 0;
+		int mcusHigh = 0;
+		bool progressive = false;
+		bool frameRead = false;
+		int scanCount = 0;
+		int restartInterval = 0;
+		int adobeTransform = -1; // From an Adobe APP14 segment, -1 without one
+
+		// Current scan
+		int scanComponents[MaxComponents] = {};
+		int scanComponentCount = 0;
+		int spectralStart = 0;
+		int spectralEnd = 63;
+		int approximationHigh = 0;
+		int approximationLow = 0;
+	};
+
+	bool Decoder::Run(ImageData* image, ThreadPool* pool, uint8_t* destination, size_t destinationPitch)
+	{
+		this->pool = pool;
+		if (this->size < 4 || this->data[0] != 0xFF || this->data[1] != 0xD8)
+			return false;
+		this->position = 2;
+
+		for (;;)
+		{
+			// Markers may be padded with any number of 0xFF bytes
+			while (this->position < this->size && this->data[this->position] != 0xFF)
+				this->position++;
+			while (this->position < this->size && this->data[this->position] == 0xFF)
+				this->position++;
+			if (this->position >= this->size)
+				return false;
+			uint8_t marker = this->data[this->position++];
+
+			bool succeeded = true;
+			switch (marker)
+			{
+			case 0xC0: // Baseline
+			case 0xC1: // Extended sequential, Huffman coded
+			case 0xC2: // Progressive, Huffman coded
+				if (this->frameRead || !ReadFrame(marker == 0xC2))
+					return false;
+				if (image == nullptr)
+					return true;
+				break;
+			case 0xC4:
+				succeeded = ReadHuffmanTables();
+				break;
+			case 0xDB:
+				succeeded = ReadQuantizationTables();
+				break;
+			case 0xDD:
+				succeeded = ReadRestartInterval();
+				break;
+			case 0xEE:
+				succeeded = ReadAdobe();
+				break;
+			case 0xDA:
+				succeeded = this->frameRead && ReadScan() && DecodeScan();
+				break;
+			case 0xD9:
+				if (!this->frameRead || this->scanCount == 0)
+					return false;
+				if (this->progressive)
+					TransformProgressive();
+				Describe(image->description);
+				if (destination == nullptr)
+				{
+					image->pixels.resize(image->description.GetSize());
+					destination = image->pixels.data();
+					destinationPitch = image->description.rowPitch;
+				}
+				else if (destinationPitch < image->description.rowPitch)
+				{
+					return false;
+				}
+				{
+					const int bands = (this->height + RowsPerBand - 1) / RowsPerBand;
+					this->pool->ParallelFor(static_cast<size_t>(bands), [&](size_t band)
+					{
+						int first = static_cast<int>(band) * RowsPerBand;
+						ConvertRows(destination, destinationPitch, first, std::min(first + RowsPerBand, this->height));
+					});
+				}
+				return true;
+			default:
+				if ((marker >= 0xC3 && marker <= 0xCF) || marker == 0x01)
+					return false; // Lossless, hierarchical and arithmetic coded frames, and TEM
+				if (marker >= 0xD0 && marker <= 0xD8)
+					break; // Stray restart markers carry no segment
+				{
+					const uint8_t* segment;
+					size_t length;
+					succeeded = ReadSegment(segment, length);
+				}
+				break;
+			}
+			if (!succeeded)
+				return false;
+		}
+	}
+
+	bool Decoder::ReadSegment(const uint8_t*& segment, size_t& length)
+	{
+		if (this->position + 2 > this->size)
+			return false;
+		size_t total = static_cast<size_t>(this->data[this->position]) << 8 | this->data[this->position + 1];
+		if (total < 2 || this->position + total > this->size)
+			return false;
+		segment = this->data + this->position + 2;
+		length = total - 2;
+		this->position += total;
+		return true;
+	}
+
+	bool Decoder::ReadQuantizationTables()
+	{
+		const uint8_t* segment;
+		size_t length;
+		if (!ReadSegment(segment, length))
+			return false;
+		size_t offset = 0;
+		while (offset < length)
+		{
+			int precision = segment[offset] >> 4;
+			int index = segment[offset] & 15;
+			offset++;
+			size_t tableSize = precision == 0 ? 64 : 128;
+			if (precision > 1 || index > 3 || offset + tableSize > length)
+				return false;
+			for (int k = 0; k < 64; k++)
+				this->quantization[index][k] = precision == 0 ? segment[offset + k] : static_cast<uint16_t>(segment[offset + k * 2] << 8 | segment[offset + k * 2 + 1]);
+			offset += tableSize;
+		}
+		return true;
+	}
+
+	bool Decoder::ReadHuffmanTables()
+	{
+		const uint8_t* segment;
+		size_t length;
+		if (!ReadSegment(segment, length))
+			return false;
+		size_t offset = 0;
+		while (offset < length)
+		{
+			int tableClass = segment[offset] >> 4;
+			int index = segment[offset] & 15;
+			offset++;
+			if (tableClass > 1 || index > 3 || offset + 16 > length)
+				return false;
+			const uint8_t* counts = segment + offset;
+			offset += 16;
+			int total = 0;
+			for (int i = 0; i < 16; i++)
+				total += counts[i];
+			if (total > 256 || offset + total > length)
+				return false;
+
+			HuffmanTable& table = this->huffman[tableClass][index];
+			memcpy(table.values, segment + offset, total);
+			offset += total;
+
+			int k = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				for (int j = 0; j < counts[i]; j++)
+					table.sizes[k++] = static_cast<uint8_t>(i + 1);
+			}
+			table.sizes[k] = 0;
+
+			// Canonical codes: consecutive within a length, doubled when moving to the next length
+			uint16_t codes[256];
+			uint32_t code = 0;
+			k = 0;
+			for (int length = 1; length <= 16; length++)
+			{
+				table.delta[length] = k - static_cast<int>(code);
+				while (table.sizes[k] == length)
+					codes[k++] = static_cast<uint16_t>(code++);
+				if (code > (1u << length))
+					return false;
+				table.maxCode[length] = code << (16 - length);
+				code <<= 1;
+			}
+			table.maxCode[17] = 0xFFFFFFFF;
+
+			memset(table.fast, 255, sizeof(table.fast));
+			for (int i = 0; i < k; i++)
+			{
+				int size = table.sizes[i];
+				if (size > FastBits)
+					continue;
+				int first = codes[i] << (FastBits - size);
+				int count = 1 << (FastBits - size);
+				for (int j = 0; j < count; j++)
+					table.fast[first + j] = static_cast<uint8_t>(i);
+			}
+			table.defined = true;
+		}
+		return true;
+	}
+
+	bool Decoder::ReadFrame(bool progressive)
+	{
+		const uint8_t* segment;
+		size_t length;
+		if (!ReadSegment(segment, length) || length < 6)
+			return false;
+		this->progressive = progressive;
+		this->height = segment[1] << 8 | segment[2];
+		this->width = segment[3] << 8 | segment[4];
+		this->componentCount = segment[5];
+		// Only 8 bit samples, and no DNL defined heights
+		if (segment[0] != 8 || this->width == 0 || this->height == 0 || static_cast<uint64_t>(this->width) * this->height > MaxPixels)
+			return false;
+		if ((this->componentCount != 1 && this->componentCount != 3) || length < 6 + 3 * static_cast<size_t>(this->componentCount))
+			return false;
+
+		for (int i = 0; i < this->componentCount; i++)
+		{
+			Component& component = this->components[i];
+			component.id = segment[6 + i * 3];
+			component.h = segment[7 + i * 3] >> 4;
+			component.v = segment[7 + i * 3] & 15;
+			component.quantizationTable = segment[8 + i * 3];
+			if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 || component.quantizationTable > 3)
+				return false;
+			this->hMax = std::max(this->hMax, component.h);
+			this->vMax = std::max(this->vMax, component.v);
+		}
+		// A single component is never interleaved, its MCU is one block whatever the sampling factors say
+		if (this->componentCount == 1)
+		{
+			this->components[0].h = this->components[0].v = 1;
+			this->hMax = this->vMax = 1;
+		}
+
+		this->mcusWide = (this->width + 8 * this->hMax - 1) / (8 * this->hMax);
+		this->mcusHigh = (this->height + 8 * this->vMax - 1) / (8 * this->vMax);
+		for (int i = 0; i < this->componentCount; i++)
+		{
+			Component& component = this->components[i];
+			component.width = (this->width * component.h + this->hMax - 1) / this->hMax;
+			component.height = (this->height * component.v + this->vMax - 1) / this->vMax;
+			component.blocksWide = this->mcusWide * component.h;
+			component.blocksHigh = this->mcusHigh * component.v;
+		}
+		this->frameRead = true;
+		return true;
+	}
+
+	bool Decoder::ReadAdobe()
+	{
+		const uint8_t* segment;
+		size_t length;
+		if (!ReadSegment(segment, length))
+			return false;
+		if (length >= 12 && memcmp(segment, "Adobe", 5) == 0)
+			this->adobeTransform = segment[11];
+		return true;
+	}
+
+	bool Decoder::ReadRestartInterval()
+	{
+		const uint8_t* segment;
+		size_t length;
+		if (!ReadSegment(segment, length) || length < 2)
+			return false;
+		this->restartInterval = segment[0] << 8 | segment[1];
+		return true;
+	}
+
+	bool Decoder::ReadScan()
+	{
+		const uint8_t* segment;
+		size_t length;
+		if (!ReadSegment(segment, length) || length < 1)
+			return false;
+		this->scanComponentCount = segment[0];
+		if (this->scanComponentCount < 1 || this->scanComponentCount > this->componentCount || length != 4 + 2 * static_cast<size_t>(this->scanComponentCount))
+			return false;
+
+		for (int i = 0; i < this->scanComponentCount; i++)
+		{
+			uint8_t id = segment[1 + i * 2];
+			int index = 0;
+			while (index < this->componentCount && this->components[index].id != id)
+				index++;
+			if (index == this->componentCount)
+				return false;
+			Component& component = this->components[index];
+			component.dcTable = segment[2 + i * 2] >> 4;
+			component.acTable = segment[2 + i * 2] & 15;
+			if (component.dcTable > 3 || component.acTable > 3)
+				return false;
+			this->scanComponents[i] = index;
+		}
+		const uint8_t* parameters = segment + 1 + 2 * this->scanComponentCount;
+		this->spectralStart = parameters[0];
+		this->spectralEnd = parameters[1];
+		this->approximationHigh = parameters[2] >> 4;
+		this->approximationLow = parameters[2] & 15;
+
+		if (this->progressive)
+		{
+			// DC scans may be interleaved, AC scans cover one component
+			if (this->spectralStart > this->spectralEnd || this->spectralEnd > 63 || this->approximationLow > 13 ||
+				(this->spectralStart == 0 && this->spectralEnd != 0) || (this->spectralStart > 0 && this->scanComponentCount != 1))
+				return false;
+		}
+		else if (this->spectralStart != 0 || this->spectralEnd != 63 || this->approximationHigh != 0 || this->approximationLow != 0)
+		{
+			return false;
+		}
+
+		// The tables the scan uses have to be there. Refining DC scans do not use any
+		for (int i = 0; i < this->scanComponentCount; i++)
+		{
+			const Component& component = this->components[this->scanComponents[i]];
+			bool needsDc = this->spectralStart == 0 && this->approximationHigh == 0;
+			bool needsAc = this->spectralEnd > 0;
+			if ((needsDc && !this->huffman[0][component.dcTable].defined) || (needsAc && !this->huffman[1][component.acTable].defined))
+				return false;
+		}
+		return true;
+	}
+
+	bool Decoder::DecodeScan()
+	{
+		// Planes and coefficients are allocated by the first scan that needs them
+		for (int i = 0; i < this->scanComponentCount; i++)
+		{
+			Component& component = this->components[this->scanComponents[i]];
+			size_t blocks = static_cast<size_t>(component.blocksWide) * component.blocksHigh;
+			if (component.plane.empty())
+				component.plane.resize(blocks * 64);
+			if (this->progressive && component.coefficients.empty())
+				component.coefficients.resize(blocks * 64);
+		}
+		this->scanCount++;
+
+		// Where the entropy coded data ends, and where every restart interval in it starts
+		std::vector<size_t> intervalStarts(1, this->position);
+		size_t end = this->position;
+		while (end + 1 < this->size)
+		{
+			if (this->data[end] == 0xFF)
+			{
+				uint8_t marker = this->data[end + 1];
+				if (marker >= 0xD0 && marker <= 0xD7)
+				{
+					intervalStarts.push_back(end + 2);
+					end += 2;
+					continue;
+				}
+				if (marker != 0x00 && marker != 0xFF)
+					break;
+			}
+			end++;
+		}
+		if (end + 1 >= this->size)
+			end = this->size;
+
+		const size_t units = this->scanComponentCount == 1 ?
+			static_cast<size_t>((this->components[this->scanComponents[0]].width + 7) / 8) * ((this->components[this->scanComponents[0]].height + 7) / 8) :
+			static_cast<size_t>(this->mcusWide) * this->mcusHigh;
+
+		// Restart intervals of a baseline scan share nothing, so each decodes on its own worker. Progressive AC scans
+		// carry the end of band run across blocks, those stay sequential like files without restart markers
+		const size_t interval = static_cast<size_t>(this->restartInterval);
+		bool decoded = false;
+		if (!this->progressive && interval > 0 && intervalStarts.size() > 1 && intervalStarts.size() == (units + interval - 1) / interval)
+		{
+			std::atomic<bool> succeeded(true);
+			this->pool->ParallelFor(intervalStarts.size(), [&](size_t i)
+			{
+				size_t intervalEnd = i + 1 < intervalStarts.size() ? intervalStarts[i + 1] - 2 : end;
+				BitReader reader(this->data, intervalStarts[i], intervalEnd);
+				if (!DecodeUnits(reader, i * interval, std::min(units, (i + 1) * interval)))
+					succeeded.store(false, std::memory_order_relaxed);
+			});
+			decoded = succeeded.load();
+		}
+		else
+		{
+			BitReader reader(this->data, this->position, end);
+			decoded = DecodeUnits(reader, 0, units);
+		}
+		this->position = end;
+		return decoded;
+	}
+
+	bool Decoder::DecodeUnits(BitReader& reader, size_t first, size_t last)
+	{
+		int dcPredictions[MaxComponents] = {};
+		uint32_t eobRun = 0;
+		const size_t interval = static_cast<size_t>(this->restartInterval);
+		for (size_t unit = first; unit < last; unit++)
+		{
+			if (interval > 0 && unit != first && unit % interval == 0)
+			{
+				if (!reader.Restart())
+					return false;
+				memset(dcPredictions, 0, sizeof(dcPredictions));
+				eobRun = 0;
+			}
+
+			if (this->scanComponentCount == 1)
+			{
+				const int c = this->scanComponents[0];
+				Component& component = this->components[c];
+				const int blocksWide = (component.width + 7) / 8;
+				if (!DecodeBlock(reader, component, static_cast<int>(unit % blocksWide), static_cast<int>(unit / blocksWide), dcPredictions[c], eobRun))
+					return false;
+				continue;
+			}
+
+			const int mcuX = static_cast<int>(unit % this->mcusWide);
+			const int mcuY = static_cast<int>(unit / this->mcusWide);
+			for (int i = 0; i < this->scanComponentCount; i++)
+			{
+				const int c = this->scanComponents[i];
+				Component& component = this->components[c];
+				for (int y = 0; y < component.v; y++)
+				{
+					for (int x = 0; x < component.h; x++)
+					{
+						if (!DecodeBlock(reader, component, mcuX * component.h + x, mcuY * component.v + y, dcPredictions[c], eobRun))
+							return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	bool Decoder::DecodeBlockBaseline(BitReader& reader, Component& component, int bx, int by, int& dcPrediction)
+	{
+		const HuffmanTable& dcTable = this->huffman[0][component.dcTable];
+		const HuffmanTable& acTable = this->huffman[1][component.acTable];
+		const uint16_t* quantization = this->quantization[component.quantizationTable];
+
+		int coefficients[64] = {};
+		int category = reader.Decode(dcTable);
+		if (category < 0 || category > 15)
+			return false;
+		dcPrediction += category > 0 ? reader.ReceiveExtend(category) : 0;
+		coefficients[0] = Dequantize(dcPrediction, quantization[0]);
+
+		bool hasAc = false;
+		for (int k = 1; k < 64;)
+		{
+			int symbol = reader.Decode(acTable);
+			if (symbol < 0)
+				return false;
+			int run = symbol >> 4;
+			int magnitude = symbol & 15;
+			if (magnitude == 0)
+			{
+				if (run != 15)
+					break; // End of block
+				k += 16;
+				continue;
+			}
+			k += run;
+			if (k > 63)
+				return false;
+			coefficients[ZigZag[k]] = Dequantize(reader.ReceiveExtend(magnitude), quantization[k]);
+			hasAc = true;
+			k++;
+		}
+
+		uint8_t* output = component.plane.data() + (static_cast<size_t>(by) * component.blocksWide * 8 + bx) * 8;
+		if (hasAc)
+			InverseDct(coefficients, output, component.blocksWide * 8);
+		else
+			InverseDctDcOnly(coefficients[0], output, component.blocksWide * 8);
+		return true;
+	}
+
+	bool Decoder::DecodeBlock(BitReader& reader, Component& component, int bx, int by, int& dcPrediction, uint32_t& eobRun)
+	{
+		if (!this->progressive)
+			return DecodeBlockBaseline(reader, component, bx, by, dcPrediction);
+
+		// Progressive scans (T.81 G.1.2), straight into the stored coefficients
+		int16_t* block = component.coefficients.data() + (static_cast<size_t>(by) * component.blocksWide + bx) * 64;
+		const int low = this->approximationLow;
+		if (this->spectralStart == 0)
+		{
+			if (this->approximationHigh == 0)
+			{
+				int category = reader.Decode(this->huffman[0][component.dcTable]);
+				if (category < 0 || category > 15)
+					return false;
+				dcPrediction += category > 0 ? reader.ReceiveExtend(category) : 0;
+				block[0] = static_cast<int16_t>(dcPrediction * (1 << low));
+			}
+			else if (reader.GetBits(1))
+			{
+				block[0] = static_cast<int16_t>(block[0] | (1 << low));
+			}
+			return true;
+		}
+
+		const HuffmanTable& acTable = this->huffman[1][component.acTable];
+		if (this->approximationHigh == 0)
+		{
+			// First pass over a band, runs of whole blocks without coefficients are counted in eobRun
+			if (eobRun > 0)
+			{
+				eobRun--;
+				return true;
+			}
+			for (int k = this->spectralStart; k <= this->spectralEnd;)
+			{
+				int symbol = reader.Decode(acTable);
+				if (symbol < 0)
+					return false;
+				int run = symbol >> 4;
+				int magnitude = symbol & 15;
+				if (magnitude == 0)
+				{
+					if (run < 15)
+					{
+						eobRun = (1u << run) - 1;
+						if (run > 0)
+							eobRun += reader.GetBits(run);
+						break;
+					}
+					k += 16;
+					continue;
+				}
+				k += run;
+				if (k > 63)
+					return false;
+				block[ZigZag[k]] = static_cast<int16_t>(reader.ReceiveExtend(magnitude) * (1 << low));
+				k++;
+			}
+			return true;
+		}
+
+		// Refinement: one more bit for every coefficient that is already non zero, and new coefficients of +-1
+		const int bit = 1 << low;
+		auto refine = [&](int16_t& coefficient)
+		{
+			if (reader.GetBits(1) && (coefficient & bit) == 0)
+				coefficient = static_cast<int16_t>(coefficient > 0 ? coefficient + bit : coefficient - bit);
+		};
+		int k = this->spectralStart;
+		if (eobRun == 0)
+		{
+			while (k <= this->spectralEnd)
+			{
+				int symbol = reader.Decode(acTable);
+				if (symbol < 0)
+					return false;
+				int run = symbol >> 4;
+				int magnitude = symbol & 15;
+				int value = 0;
+				if (magnitude == 0)
+				{
+					if (run < 15)
+					{
+						eobRun = 1u << run;
+						if (run > 0)
+							eobRun += reader.GetBits(run);
+						break;
+					}
+				}
+				else
+				{
+					if (magnitude != 1)
+						return false;
+					value = reader.GetBits(1) ? bit : -bit;
+				}
+
+				// Skip run zero valued coefficients, refining the non zero ones passed on the way
+				while (k <= this->spectralEnd)
+				{
+					int16_t& coefficient = block[ZigZag[k++]];
+					if (coefficient != 0)
+					{
+						refine(coefficient);
+					}
+					else if (run == 0)
+					{
+						if (value != 0)
+							coefficient = static_cast<int16_t>(value);
+						break;
+					}
+					else
+					{
+						run--;
+					}
+				}
+			}
+		}
+		if (eobRun > 0)
+		{
+			// The rest of the band only refines
+			for (; k <= this->spectralEnd; k++)
+			{
+				int16_t& coefficient = block[ZigZag[k]];
+				if (coefficient != 0)
+					refine(coefficient);
+			}
+			eobRun--;
+		}
+		return true;
+	}
+
+	void Decoder::TransformProgressive()
+	{
+		for (int c = 0; c < this->componentCount; c++)
+		{
+			Component& component = this->components[c];
+			if (component.plane.empty())
+				component.plane.resize(static_cast<size_t>(component.blocksWide) * component.blocksHigh * 64, 128);
+			if (component.coefficients.empty())
+				continue;
+			const uint16_t* quantization = this->quantization[component.quantizationTable];
+			this->pool->ParallelFor(static_cast<size_t>(component.blocksHigh), [&](size_t by)
+			{
+				int coefficients[64];
+				for (int bx = 0; bx < component.blocksWide; bx++)
+				{
+					const int16_t* block = component.coefficients.data() + (by * component.blocksWide + bx) * 64;
+					bool hasAc = false;
+					for (int k = 0; k < 64; k++)
+					{
+						coefficients[ZigZag[k]] = Dequantize(block[ZigZag[k]], quantization[k]);
+						hasAc |= k > 0 && block[ZigZag[k]] != 0;
+					}
+					uint8_t* output = component.plane.data() + (by * component.blocksWide * 8 + bx) * 8;
+					if (hasAc)
+						InverseDct(coefficients, output, component.blocksWide * 8);
+					else
+						InverseDctDcOnly(coefficients[0], output, component.blocksWide * 8);
+				}
+			});
+			std::vector<int16_t>().swap(component.coefficients);
+		}
+	}
+
+	void Decoder::UpsampleRow(const Component& component, int y, uint8_t* output) const
+	{
+		const size_t stride = static_cast<size_t>(component.blocksWide) * 8;
+		const int hs = this->hMax / component.h;
+		const int vs = this->vMax / component.v;
+		const bool integral = this->hMax % component.h == 0 && this->vMax % component.v == 0;
+		const int cw = component.width;
+
+		if (integral && hs <= 2 && vs <= 2)
+		{
+			// libjpeg's "fancy" upsampling, a triangle filter centered between the samples. Each output sample is
+			// 3/4 of the nearer and 1/4 of the farther input sample in each subsampled direction
+			const int cy = y / vs;
+			const uint8_t* near = component.plane.data() + cy * stride;
+			const uint8_t* far = near;
+			if (vs == 2)
+			{
+				int farY = (y & 1) ? std::min(cy + 1, component.height - 1) : std::max(cy - 1, 0);
+				far = component.plane.data() + farY * stride;
+			}
+
+			if (hs == 1)
+			{
+				for (int x = 0; x < cw; x++)
+					output[x] = vs == 2 ? static_cast<uint8_t>((near[x] * 3 + far[x] + 2) >> 2) : near[x];
+				return;
+			}
+			if (vs == 1)
+			{
+				output[0] = near[0];
+				for (int x = 0; x < cw; x++)
+				{
+					if (x > 0)
+						output[x * 2] = static_cast<uint8_t>((near[x] * 3 + near[x - 1] + 1) >> 2);
+					output[x * 2 + 1] = x + 1 < cw ? static_cast<uint8_t>((near[x] * 3 + near[x + 1] + 2) >> 2) : near[x];
+				}
+				return;
+			}
+
+			int previous = near[0] * 3 + far[0];
+			int current = previous;
+			output[0] = static_cast<uint8_t>((current * 4 + 8) >> 4);
+			for (int x = 1; x < cw; x++)
+			{
+				int next = near[x] * 3 + far[x];
+				output[x * 2 - 1] = static_cast<uint8_t>((current * 3 + next + 7) >> 4);
+				output[x * 2] = static_cast<uint8_t>((next * 3 + current + 8) >> 4);
+				previous = current;
+				current = next;
+			}
+			output[cw * 2 - 1] = static_cast<uint8_t>((current * 4 + 7) >> 4);
+			return;
+		}
+
+		// Unusual factors (3x, 4x, non integral) replicate the nearest sample
+		const uint8_t* row = component.plane.data() + static_cast<size_t>(y * component.v / this->vMax) * stride;
+		for (int x = 0; x < this->width; x++)
+			output[x] = row[x * component.h / this->hMax];
+	}
+
+	void Decoder::ConvertRows(uint8_t* destination, size_t rowPitch, int firstRow, int lastRow) const
+	{
+		if (this->componentCount == 1)
+		{
+			const Component& component = this->components[0];
+			for (int y = firstRow; y < lastRow; y++)
+				memcpy(destination + y * rowPitch, component.plane.data() + static_cast<size_t>(y) * component.blocksWide * 8, this->width);
+			return;
+		}
+
+		// Components at full resolution are read from their planes, the others are upsampled into a scratch row
+		std::vector<uint8_t> scratch[MaxComponents];
+		for (int y = firstRow; y < lastRow; y++)
+		{
+			const uint8_t* rows[MaxComponents];
+			for (int c = 0; c < MaxComponents; c++)
+			{
+				const Component& component = this->components[c];
+				if (component.h == this->hMax && component.v == this->vMax)
+				{
+					rows[c] = component.plane.data() + static_cast<size_t>(y) * component.blocksWide * 8;
+					continue;
+				}
+				scratch[c].resize(static_cast<size_t>(component.blocksWide) * 8 * this->hMax + 16);
+				UpsampleRow(component, y, scratch[c].data());
+				rows[c] = scratch[c].data();
+			}
+
+			// Adobe transform 0, or no Adobe segment and components called R, G and B, means the file stores RGB
+			const bool rgb = this->adobeTransform == 0 ||
+				(this->adobeTransform < 0 && this->components[0].id == 'R' && this->components[1].id == 'G' && this->components[2].id == 'B');
+			uint8_t* output = destination + y * rowPitch;
+			if (rgb)
+				InterleaveRgbRow(rows[0], rows[1], rows[2], output, this->width);
+			else
+				ConvertYCbCrRow(rows[0], rows[1], rows[2], output, this->width);
+		}
+	}
+
+}
+
+bool JpegDecoder::ReadDescription(const uint8_t* data, size_t size, ImageDescription& description)
+{
+	Decoder decoder(data, size);
+	if (!decoder.Run(nullptr, nullptr))
+		return false;
+	decoder.Describe(description);
+	return true;
+}
+
+bool JpegDecoder::Decode(const uint8_t* data, size_t size, ImageData& image, ThreadPool& pool)
+{
+	Decoder decoder(data, size);
+	return decoder.Run(&image, &pool);
+}
+
+bool JpegDecoder::DecodeInto(const uint8_t* data, size_t size, uint8_t* destination, size_t rowPitch, ThreadPool& pool)
+{
+	Decoder decoder(data, size);
+	ImageData image;
+	return decoder.Run(&image, &pool, destination, rowPitch);
+}
+
+bool JpegDecoder::IsSimdAvailable()
+{
+#ifdef JPEG_DECODER_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+void JpegDecoder::SetSimdEnabled(bool enabled)
+{
+	simdEnabled = enabled;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "ImageData.h"
+#include <cstddef>
+
+class ThreadPool;
+
+// Baseline and progressive JPEG (ITU T.81, Huffman coded, 8 bit), grayscale or three component YCbCr/RGB with any
+// chroma subsampling. Lossless, hierarchical, arithmetic coded and CMYK files are rejected, see ImageDecoder.
+//
+// Decoding runs in up to three parallel passes:
+//   entropy decoding   baseline files with restart markers decode each restart interval on its own worker,
+//                      everything else decodes in one pass. Photoshop and Megascans exports put a marker after
+//                      every row of blocks
+//   inverse DCT        progressive files keep the coefficients until the last scan, then transform by block row.
+//                      Baseline blocks are transformed as soon as they are decoded
+//   color conversion   chroma upsampling (the triangle filter libjpeg uses by default) and YCbCr to RGB by bands of
+//                      rows. The conversion does 16 pixels at a time with SSE2, SetSimdEnabled(false) forces the
+//                      scalar loop, which gives identical results
+//
+// The integer inverse DCT is the accurate one libjpeg uses by default, so pixels are within a step or two of
+// libjpeg's and WIC's
+class JpegDecoder
+{
+public:
+	static bool ReadDescription(const uint8_t* data, size_t size, ImageDescription& description);
+	// Three component files decode to R8G8B8A8_UNORM with opaque alpha, grayscale ones to R8_UNORM
+	static bool Decode(const uint8_t* data, size_t size, ImageData& image, ThreadPool& pool);
+	// See ImageDecoder::DecodeInto
+	static bool DecodeInto(const uint8_t* data, size_t size, uint8_t* destination, size_t rowPitch, ThreadPool& pool);
+
+	static bool IsSimdAvailable();
+	static void SetSimdEnabled(bool enabled); // Benchmarking only, not thread safe
+};
@@ -0,0 +1,537 @@
+#include "JsonReader.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define JSON_READER_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	bool simdEnabled = true;
+
+	// Powers of ten a double holds exactly
+	const double ExactPowersOfTen[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+	const int MaxExactPower = 22;
+	const int MaxExactDigits = 15; // Any 15 digit integer is below 2^53
+
+	bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	// Characters that end the plain part of a string
+	bool IsSpecial(char c)
+	{
+		return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+	}
+
+	int HexValue(char c)
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	void AppendUtf8(std::string& output, uint32_t codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			output += static_cast<char>(codePoint);
+		}
+		else if (codePoint < 0x800)
+		{
+			output += static_cast<char>(0xC0 | (codePoint >> 6));
+			output += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			output += static_cast<char>(0xE0 | (codePoint >> 12));
+			output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			output += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			output += static_cast<char>(0xF0 | (codePoint >> 18));
+			output += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+			output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			output += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+#ifdef JSON_READER_SSE2
+	uint32_t FirstSetBit(uint32_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+	}
+#endif
+}
+
+JsonReader::JsonReader(const char* data, size_t size)
+	: data(data), size(size)
+{
+	// Skip a UTF-8 byte order mark, editors on Windows like to write one
+	if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+		this->position = 3;
+}
+
+JsonToken JsonReader::Next()
+{
+	if (this->error != nullptr)
+		return JsonToken::Error;
+
+	SkipWhitespace();
+	if (this->afterKey)
+	{
+		this->afterKey = false;
+		return ReadValue();
+	}
+	if (this->stack.empty())
+	{
+		if (!this->rootDone)
+			return ReadValue();
+		if (this->position < this->size)
+			return Fail("Unexpected data after the document");
+		return JsonToken::End;
+	}
+
+	if (this->position >= this->size)
+		return Fail("Unexpected end of input");
+	char c = this->data[this->position];
+	const bool inObject = this->stack.back() == '{';
+	if (c == (inObject ? '}' : ']'))
+	{
+		this->position++;
+		return Pop(inObject ? JsonToken::ObjectEnd : JsonToken::ArrayEnd);
+	}
+	if (this->needComma)
+	{
+		if (c != ',')
+			return Fail(inObject ? "Expected ',' or '}'" : "Expected ',' or ']'");
+		this->position++;
+		SkipWhitespace();
+		if (this->position >= this->size)
+			return Fail("Unexpected end of input");
+		c = this->data[this->position];
+	}
+	if (!inObject)
+		return ReadValue();
+
+	if (c != '"')
+		return Fail("Expected a member name");
+	if (ReadString(JsonToken::Key) == JsonToken::Error)
+		return JsonToken::Error;
+	SkipWhitespace();
+	if (this->position >= this->size || this->data[this->position] != ':')
+		return Fail("Expected ':'");
+	this->position++;
+	this->afterKey = true;
+	return JsonToken::Key;
+}
+
+bool JsonReader::StringEquals(const char* text) const
+{
+	size_t length = strlen(text);
+	return length == this->stringLength && memcmp(this->stringData, text, length) == 0;
+}
+
+bool JsonReader::SkipValue()
+{
+	JsonToken token = Next();
+	if (token == JsonToken::ObjectStart || token == JsonToken::ArrayStart)
+		return SkipContainer();
+	return token != JsonToken::Error && token != JsonToken::ObjectEnd && token != JsonToken::ArrayEnd &&
+		token != JsonToken::Key && token != JsonToken::End;
+}
+
+bool JsonReader::SkipContainer()
+{
+	const size_t depth = this->stack.size();
+	while (this->stack.size() >= depth)
+	{
+		if (depth == 0 || Next() == JsonToken::Error)
+			return false;
+	}
+	return true;
+}
+
+bool JsonReader::NextString(std::string& value)
+{
+	JsonToken token = Next();
+	if (token == JsonToken::String)
+		value.assign(this->stringData, this->stringLength);
+	else if (token == JsonToken::ObjectStart || token == JsonToken::ArrayStart)
+		return SkipContainer();
+	return token != JsonToken::Error;
+}
+
+bool JsonReader::NextNumber(double& value)
+{
+	JsonToken token = Next();
+	if (token == JsonToken::Number)
+		value = this->number;
+	else if (token == JsonToken::ObjectStart || token == JsonToken::ArrayStart)
+		return SkipContainer();
+	return token != JsonToken::Error;
+}
+
+bool JsonReader::NextUInt(uint32_t& value)
+{
+	JsonToken token = Next();
+	if (token == JsonToken::Number)
+		value = this->number <= 0.0 ? 0 : this->number >= 4294967295.0 ? 4294967295u : static_cast<uint32_t>(this->number);
+	else if (token == JsonToken::ObjectStart || token == JsonToken::ArrayStart)
+		return SkipContainer();
+	return token != JsonToken::Error;
+}
+
+bool JsonReader::NextBool(bool& value)
+{
+	JsonToken token = Next();
+	if (token == JsonToken::True || token == JsonToken::False)
+		value = token == JsonToken::True;
+	else if (token == JsonToken::ObjectStart || token == JsonToken::ArrayStart)
+		return SkipContainer();
+	return token != JsonToken::Error;
+}
+
+JsonToken JsonReader::ReadValue()
+{
+	if (this->position >= this->size)
+		return Fail("Unexpected end of input");
+
+	JsonToken token;
+	char c = this->data[this->position];
+	switch (c)
+	{
+	case '{':
+		return Push('{', JsonToken::ObjectStart);
+	case '[':
+		return Push('[', JsonToken::ArrayStart);
+	case '"':
+		token = ReadString(JsonToken::String);
+		break;
+	case 't':
+		token = ReadLiteral("true", 4, JsonToken::True);
+		break;
+	case 'f':
+		token = ReadLiteral("false", 5, JsonToken::False);
+		break;
+	case 'n':
+		token = ReadLiteral("null", 4, JsonToken::Null);
+		break;
+	default:
+		if (c != '-' && !IsDigit(c))
+			return Fail("Unexpected character");
+		token = ReadNumber();
+		break;
+	}
+
+	if (token != JsonToken::Error)
+	{
+		this->needComma = true;
+		if (this->stack.empty())
+			this->rootDone = true;
+	}
+	return token;
+}
+
+JsonToken JsonReader::ReadString(JsonToken token)
+{
+	const size_t start = ++this->position;
+	size_t i = start;
+#ifdef JSON_READER_SSE2
+	if (simdEnabled)
+	{
+		// Quotes, backslashes and control characters, the byte loop below then stops right on the first one
+		const __m128i quote = _mm_set1_epi8('"');
+		const __m128i backslash = _mm_set1_epi8('\\');
+		const __m128i lastControl = _mm_set1_epi8(0x1F);
+		while (i + 16 <= this->size)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(this->data + i));
+			__m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, quote), _mm_cmpeq_epi8(bytes, backslash)),
+				_mm_cmpeq_epi8(_mm_min_epu8(bytes, lastControl), bytes));
+			uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+			if (mask != 0)
+			{
+				i += FirstSetBit(mask);
+				break;
+			}
+			i += 16;
+		}
+	}
+#endif
+	while (i < this->size && !IsSpecial(this->data[i]))
+		i++;
+
+	if (i >= this->size)
+		return Fail("Unterminated string");
+	if (this->data[i] == '\\')
+		return ReadEscapedString(start, i, token);
+	if (this->data[i] != '"')
+	{
+		this->position = i;
+		return Fail("Control character in string");
+	}
+	this->stringData = this->data + start;
+	this->stringLength = i - start;
+	this->position = i + 1;
+	return token;
+}
+
+JsonToken JsonReader::ReadEscapedString(size_t start, size_t escape, JsonToken token)
+{
+	this->scratch.assign(this->data + start, escape - start);
+	size_t i = escape;
+	for (;;)
+	{
+		if (i >= this->size)
+			return Fail("Unterminated string");
+		char c = this->data[i];
+		if (c == '"')
+			break;
+		if (c != '\\')
+		{
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				this->position = i;
+				return Fail("Control character in string");
+			}
+			this->scratch += c;
+			i++;
+			continue;
+		}
+
+		this->position = i;
+		if (i + 1 >= this->size)
+			return Fail("Unterminated string");
+		char escaped = this->data[i + 1];
+		i += 2;
+		switch (escaped)
+		{
+		case '"': this->scratch += '"'; break;
+		case '\\': this->scratch += '\\'; break;
+		case '/': this->scratch += '/'; break;
+		case 'b': this->scratch += '\b'; break;
+		case 'f': this->scratch += '\f'; break;
+		case 'n': this->scratch += '\n'; break;
+		case 'r': this->scratch += '\r'; break;
+		case 't': this->scratch += '\t'; break;
+		case 'u':
+		{
+			// Characters outside the basic plane come as a UTF-16 surrogate pair
+			uint32_t units[2] = {};
+			size_t unitCount = 0;
+			for (;;)
+			{
+				if (i + 4 > this->size)
+					return Fail("Invalid \\u escape");
+				uint32_t unit = 0;
+				for (size_t h = 0; h < 4; h++)
+				{
+					int value = HexValue(this->data[i + h]);
+					if (value < 0)
+						return Fail("Invalid \\u escape");
+					unit = unit << 4 | static_cast<uint32_t>(value);
+				}
+				i += 4;
+				units[unitCount++] = unit;
+				if (unitCount == 2 || unit < 0xD800 || unit > 0xDBFF)
+					break;
+				if (i + 2 > this->size || this->data[i] != '\\' || this->data[i + 1] != 'u')
+					return Fail("Unpaired surrogate");
+				i += 2;
+			}
+			if (unitCount == 2)
+			{
+				if (units[1] < 0xDC00 || units[1] > 0xDFFF)
+					return Fail("Unpaired surrogate");
+				AppendUtf8(this->scratch, 0x10000 + ((units[0] - 0xD800) << 10) + (units[1] - 0xDC00));
+			}
+			else
+			{
+				if (units[0] >= 0xDC00 && units[0] <= 0xDFFF)
+					return Fail("Unpaired surrogate");
+				AppendUtf8(this->scratch, units[0]);
+			}
+			break;
+		}
+		default:
+			return Fail("Invalid escape");
+		}
+	}
+
+	this->stringData = this->scratch.data();
+	this->stringLength = this->scratch.size();
+	this->position = i + 1;
+	return token;
+}
+
+JsonToken JsonReader::ReadNumber()
+{
+	// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+	const size_t start = this->position;
+	size_t i = start;
+	const bool negative = this->data[i] == '-';
+	if (negative)
+		i++;
+	if (i >= this->size || !IsDigit(this->data[i]))
+		return Fail("Invalid number");
+
+	// Up to 19 significant digits fit the mantissa, anything longer goes to strtod below
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool truncated = false;
+	if (this->data[i] == '0')
+	{
+		i++;
+	}
+	else
+	{
+		for (; i < this->size && IsDigit(this->data[i]); i++)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(this->data[i] - '0');
+				digits++;
+			}
+			else
+			{
+				exponent++;
+				truncated = true;
+			}
+		}
+	}
+	if (i < this->size && this->data[i] == '.')
+	{
+		i++;
+		if (i >= this->size || !IsDigit(this->data[i]))
+			return Fail("Invalid number");
+		for (; i < this->size && IsDigit(this->data[i]); i++)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(this->data[i] - '0');
+				exponent--;
+				if (mantissa != 0)
+					digits++;
+			}
+			else
+			{
+				truncated = true;
+			}
+		}
+	}
+	if (i < this->size && (this->data[i] == 'e' || this->data[i] == 'E'))
+	{
+		i++;
+		bool negativeExponent = false;
+		if (i < this->size && (this->data[i] == '+' || this->data[i] == '-'))
+			negativeExponent = this->data[i++] == '-';
+		if (i >= this->size || !IsDigit(this->data[i]))
+			return Fail("Invalid number");
+		int value = 0;
+		for (; i < this->size && IsDigit(this->data[i]); i++)
+		{
+			if (value < 100000)
+				value = value * 10 + (this->data[i] - '0');
+		}
+		exponent += negativeExponent ? -value : value;
+	}
+	this->position = i;
+
+	// An integer a double holds exactly times or over an exact power of ten rounds correctly (Clinger's fast path),
+	// which covers nearly every number in real files. The rest take the slow exact route
+	if (!truncated && digits <= MaxExactDigits && exponent >= -MaxExactPower && exponent <= MaxExactPower)
+	{
+		double value = static_cast<double>(mantissa);
+		value = exponent < 0 ? value / ExactPowersOfTen[-exponent] : value * ExactPowersOfTen[exponent];
+		this->number = negative ? -value : value;
+	}
+	else
+	{
+		this->scratch.assign(this->data + start, i - start);
+		this->number = strtod(this->scratch.c_str(), nullptr);
+	}
+	return JsonToken::Number;
+}
+
+JsonToken JsonReader::ReadLiteral(const char* literal, size_t length, JsonToken token)
+{
+	if (this->size - this->position < length || memcmp(this->data + this->position, literal, length) != 0)
+		return Fail("Unexpected character");
+	this->position += length;
+	return token;
+}
+
+JsonToken JsonReader::Push(char container, JsonToken token)
+{
+	if (this->stack.size() >= MaxDepth)
+		return Fail("Nested too deeply");
+	this->stack.push_back(container);
+	this->position++;
+	this->needComma = false;
+	return token;
+}
+
+JsonToken JsonReader::Pop(JsonToken token)
+{
+	this->stack.pop_back();
+	this->needComma = true;
+	if (this->stack.empty())
+		this->rootDone = true;
+	return token;
+}
+
+void JsonReader::SkipWhitespace()
+{
+	while (this->position < this->size)
+	{
+		char c = this->data[this->position];
+		if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+			break;
+		this->position++;
+	}
+}
+
+JsonToken JsonReader::Fail(const char* message)
+{
+	if (this->error == nullptr)
+		this->error = message;
+	return JsonToken::Error;
+}
+
+bool JsonReader::IsSimdAvailable()
+{
+#ifdef JSON_READER_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+void JsonReader::SetSimdEnabled(bool enabled)
+{
+	simdEnabled = enabled;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class JsonToken
+{
+	ObjectStart,
+	ObjectEnd,
+	ArrayStart,
+	ArrayEnd,
+	Key, // Object member name, GetString holds it and the member's value comes next
+	String,
+	Number,
+	True,
+	False,
+	Null,
+	End, // The whole document has been read
+	Error,
+};
+
+// Streaming pull parser for JSON (RFC 8259). Each Next call returns the following token straight from the input,
+// nothing is built for the document as a whole, so memory stays flat however large the file is and the caller only
+// pays for the values it keeps. Skip the ones it does not want with SkipValue.
+//
+// The structure is validated as it goes, the first problem makes every later call return Error. Strings without
+// escapes point into the input and are not copied. The string scan checks 16 bytes at a time with SSE2,
+// SetSimdEnabled(false) forces the byte loop
+class JsonReader
+{
+public:
+	// data is not copied and has to outlive the reader, it does not need to be null terminated
+	JsonReader(const char* data, size_t size);
+
+	JsonToken Next();
+
+	// The value of the last Key or String token. Valid until the next call
+	const char* GetStringData() const { return this->stringData; }
+	size_t GetStringLength() const { return this->stringLength; }
+	std::string GetString() const { return std::string(this->stringData, this->stringLength); }
+	bool StringEquals(const char* text) const;
+	// The value of the last Number token
+	double GetNumber() const { return this->number; }
+
+	// Skips the value that comes next, containers included. Call it after a Key to ignore the member
+	bool SkipValue();
+	// Skips the rest of the container the last ObjectStart or ArrayStart opened
+	bool SkipContainer();
+
+	// Read the value that comes next, usually after a Key. A value of another type is skipped and leaves value as it
+	// was, so files written by older or newer tools still load. False only on Error
+	bool NextString(std::string& value);
+	bool NextNumber(double& value);
+	bool NextUInt(uint32_t& value); // Clamped to the uint32_t range
+	bool NextBool(bool& value);
+
+	// Calls parseMember after every Key of the object just opened, up to its end. parseMember has to consume the value
+	template <typename Function>
+	bool ForEachMember(Function parseMember);
+
+	size_t GetDepth() const { return this->stack.size(); }
+	// Where the reader is, or where it stopped on Error
+	size_t GetOffset() const { return this->position; }
+	const char* GetError() const { return this->error; }
+
+	static bool IsSimdAvailable();
+	static void SetSimdEnabled(bool enabled); // Benchmarking only, not thread safe
+
+private:
+	static const size_t MaxDepth = 512;
+
+	JsonToken ReadValue();
+	JsonToken ReadString(JsonToken token);
+	JsonToken ReadEscapedString(size_t start, size_t escape, JsonToken token);
+	JsonToken ReadNumber();
+	JsonToken ReadLiteral(const char* literal, size_t length, JsonToken token);
+	JsonToken Push(char container, JsonToken token);
+	JsonToken Pop(JsonToken token);
+	void SkipWhitespace();
+	JsonToken Fail(const char* message);
+
+	const char* data;
+	size_t size;
+	size_t position = 0;
+	std::vector<char> stack; // '{' or '[' for every open container
+	bool needComma = false; // A value has been read in the innermost container
+	bool afterKey = false; // A Key was returned, its value comes next
+	bool rootDone = false;
+	const char* error = nullptr;
+
+	const char* stringData = nullptr;
+	size_t stringLength = 0;
+	std::string scratch; // Decoded strings that had escapes
+	double number = 0.0;
+};
+
+template <typename Function>
+bool JsonReader::ForEachMember(Function parseMember)
+{
+	for (;;)
+	{
+		JsonToken token = Next();
+		if (token == JsonToken::ObjectEnd)
+			return true;
+		if (token != JsonToken::Key || !parseMember())
+			return false;
+	}
+}
@@ -0,0 +1,171 @@
+#include "Lz4.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const size_t MinMatch = 4;
+	const size_t LastLiterals = 5; // The format wants the last five bytes as literals
+	const size_t MatchStartLimit = 12; // and the last match to start at least twelve bytes before the end
+	const size_t MaxOffset = 65535;
+	const int HashBits = 14;
+
+	uint32_t Read32(const uint8_t* source)
+	{
+		uint32_t value;
+		memcpy(&value, source, sizeof(value));
+		return value;
+	}
+
+	uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	uint8_t* WriteLength(uint8_t* output, size_t length)
+	{
+		while (length >= 255)
+		{
+			*output++ = 255;
+			length -= 255;
+		}
+		*output++ = static_cast<uint8_t>(length);
+		return output;
+	}
+
+	// A matchLength of 0 writes the closing literals only sequence
+	uint8_t* WriteSequence(uint8_t* output, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		uint8_t* token = output++;
+		*token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+		if (literalLength >= 15)
+			output = WriteLength(output, literalLength - 15);
+		if (literalLength > 0)
+			memcpy(output, literals, literalLength);
+		output += literalLength;
+		if (matchLength == 0)
+			return output;
+
+		*output++ = static_cast<uint8_t>(offset & 0xFF);
+		*output++ = static_cast<uint8_t>(offset >> 8);
+		size_t code = matchLength - MinMatch;
+		*token |= static_cast<uint8_t>(code < 15 ? code : 15);
+		if (code >= 15)
+			output = WriteLength(output, code - 15);
+		return output;
+	}
+
+	// Lengths of 15 continue in the following bytes, each adding up to 255
+	bool ReadLength(const uint8_t* input, size_t size, size_t& position, size_t limit, size_t& length)
+	{
+		uint8_t value;
+		do
+		{
+			if (position >= size)
+				return false;
+			value = input[position++];
+			length += value;
+			if (length > limit)
+				return false;
+		} while (value == 255);
+		return true;
+	}
+}
+
+size_t Lz4::Compress(const uint8_t* input, size_t size, uint8_t* output)
+{
+	uint8_t* out = output;
+	size_t anchor = 0;
+	if (size > MatchStartLimit)
+	{
+		// Positions of the last time each hashed four byte sequence was seen. Entries start at 0 and every candidate
+		// is compared, so stale or colliding entries only cost a lookup
+		std::vector<uint32_t> table(static_cast<size_t>(1) << HashBits, 0);
+		const size_t lastMatchStart = size - MatchStartLimit;
+		const size_t lastMatchEnd = size - LastLiterals;
+		size_t position = 0;
+		while (position <= lastMatchStart)
+		{
+			uint32_t sequence = Read32(input + position);
+			uint32_t& slot = table[Hash(sequence)];
+			size_t candidate = slot;
+			slot = static_cast<uint32_t>(position);
+
+			if (candidate < position && position - candidate <= MaxOffset && Read32(input + candidate) == sequence)
+			{
+				size_t end = position + MinMatch;
+				while (end < lastMatchEnd && input[end] == input[candidate + end - position])
+					end++;
+				while (position > anchor && candidate > 0 && input[position - 1] == input[candidate - 1])
+				{
+					position--;
+					candidate--;
+				}
+				out = WriteSequence(out, input + anchor, position - anchor, position - candidate, end - position);
+				anchor = end;
+				position = end;
+			}
+			else
+			{
+				// Step further the longer nothing has matched, incompressible data goes through quickly
+				position += 1 + ((position - anchor) >> 6);
+			}
+		}
+	}
+	out = WriteSequence(out, input + anchor, size - anchor, 0, 0);
+	return static_cast<size_t>(out - output);
+}
+
+bool Lz4::Decompress(const uint8_t* input, size_t size, uint8_t* output, size_t outputSize)
+{
+	size_t in = 0;
+	size_t out = 0;
+	for (;;)
+	{
+		if (in >= size)
+			return false;
+		uint8_t token = input[in++];
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(input, size, in, size, literalLength))
+			return false;
+		if (literalLength > size - in || literalLength > outputSize - out)
+			return false;
+		if (literalLength > 0)
+			memcpy(output + out, input + in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		// The last sequence is the only one without a match
+		if (in == size)
+			break;
+
+		if (size - in < 2)
+			return false;
+		size_t offset = input[in] | (static_cast<size_t>(input[in + 1]) << 8);
+		in += 2;
+		if (offset == 0 || offset > out)
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(input, size, in, outputSize, matchLength))
+			return false;
+		matchLength += MinMatch;
+		if (matchLength > outputSize - out)
+			return false;
+
+		// A match closer than its length repeats the last offset bytes. Everything from source up to the write position
+		// already holds whole repeats, so each copy can take twice as much as the one before without overlapping
+		uint8_t* destination = output + out;
+		const uint8_t* source = destination - offset;
+		for (size_t copied = 0; copied < matchLength;)
+		{
+			size_t count = std::min(copied + offset, matchLength - copied);
+			memcpy(destination + copied, source, count);
+			copied += count;
+		}
+		out += matchLength;
+	}
+	return out == outputSize;
+}
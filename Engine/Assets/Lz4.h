@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// LZ4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md), written from the spec so there
+// is no extra dependency. Blocks are interchangeable with the reference library's LZ4_compress_default and
+// LZ4_decompress_safe.
+//
+// The compressor is the greedy single hash table kind, decompression runs at memory speed. Each call handles one
+// independent block, PakArchive uses one per chunk so any chunk can be decoded on its own
+class Lz4
+{
+public:
+	// Largest output Compress can produce for size bytes of input, incompressible data grows slightly
+	static size_t GetMaxCompressedSize(size_t size) { return size + size / 255 + 16; }
+
+	// output must hold GetMaxCompressedSize(size) bytes. Returns the compressed size
+	static size_t Compress(const uint8_t* input, size_t size, uint8_t* output);
+
+	// Every read and write is bounds checked, so damaged or hostile input fails instead of overrunning. Succeeds only
+	// if the block decodes to exactly outputSize bytes
+	static bool Decompress(const uint8_t* input, size_t size, uint8_t* output, size_t outputSize);
+};
@@ -0,0 +1,93 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filepath)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	this->fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+	this->mappingHandle = mapping;
+
+	this->data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (this->data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	this->size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	this->fileDescriptor = open(filepath.c_str(), O_RDONLY);
+	if (this->fileDescriptor < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(this->fileDescriptor, &info) != 0 || info.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, this->fileDescriptor, 0);
+	if (mapping == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+	this->data = static_cast<const uint8_t*>(mapping);
+	this->size = static_cast<size_t>(info.st_size);
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (this->data != nullptr)
+		UnmapViewOfFile(this->data);
+	if (this->mappingHandle != nullptr)
+		CloseHandle(this->mappingHandle);
+	if (this->fileHandle != nullptr)
+		CloseHandle(this->fileHandle);
+	this->mappingHandle = nullptr;
+	this->fileHandle = nullptr;
+#else
+	if (this->data != nullptr)
+		munmap(const_cast<uint8_t*>(this->data), this->size);
+	if (this->fileDescriptor >= 0)
+		close(this->fileDescriptor);
+	this->fileDescriptor = -1;
+#endif
+	this->data = nullptr;
+	this->size = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read only memory mapping of a whole file. The OS pages the data in on first touch,
+// so opening a large file is cheap and nothing is copied into our own heap
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile();
+
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+
+	bool Open(const std::string& filepath);
+	void Close();
+
+	bool IsOpen() const { return this->data != nullptr; }
+	const uint8_t* Data() const { return this->data; }
+	size_t Size() const { return this->size; }
+
+private:
+#ifdef _WIN32
+	void* fileHandle = nullptr; // HANDLE
+	void* mappingHandle = nullptr; // HANDLE
+#else
+	int fileDescriptor = -1;
+#endif
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+};
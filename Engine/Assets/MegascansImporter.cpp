@@ -0,0 +1,333 @@
+#include "MegascansImporter.h"
+#include "JsonReader.h"
+#include "MappedFile.h"
+#include "../FileHelper.h"
+#include "../StringHelper.h"
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <map>
+
+namespace
+{
+	const char* const MapNames[] =
+	{
+		"albedo", "normal", "roughness", "gloss", "specular", "metalness", "opacity",
+		"translucency", "ao", "cavity", "bump", "displacement", "fuzz",
+	};
+	static_assert(sizeof(MapNames) / sizeof(MapNames[0]) == static_cast<size_t>(MegascansMap::Count), "MapNames has to list every MegascansMap");
+
+	const size_t MapCount = static_cast<size_t>(MegascansMap::Count);
+
+	// The maps of one texture set picked for a material, see ResolveMaterials
+	struct TextureSet
+	{
+		std::string textures[MapCount];
+		uint32_t resolution = 0;
+		bool roughnessFromGloss = false;
+	};
+
+	// Calls parseObject after the ObjectStart of every object in the array that comes next. Anything else is skipped
+	template <typename Function>
+	bool ForEachObject(JsonReader& reader, Function parseObject)
+	{
+		JsonToken token = reader.Next();
+		if (token == JsonToken::ObjectStart)
+			return reader.SkipContainer();
+		if (token != JsonToken::ArrayStart)
+			return token != JsonToken::Error;
+		for (;;)
+		{
+			token = reader.Next();
+			if (token == JsonToken::ArrayEnd)
+				return true;
+			if (token == JsonToken::ObjectStart)
+			{
+				if (!parseObject())
+					return false;
+			}
+			else if (token == JsonToken::ArrayStart)
+			{
+				if (!reader.SkipContainer())
+					return false;
+			}
+			else if (token == JsonToken::Error)
+			{
+				return false;
+			}
+		}
+	}
+
+	bool ParseModels(JsonReader& reader, std::vector<MegascansModel>& models)
+	{
+		return ForEachObject(reader, [&]()
+		{
+			MegascansModel model;
+			bool parsed = reader.ForEachMember([&]()
+			{
+				if (reader.StringEquals("uri"))
+					return reader.NextString(model.uri);
+				if (reader.StringEquals("lod"))
+					return reader.NextUInt(model.lod);
+				if (reader.StringEquals("variation"))
+					return reader.NextUInt(model.variation);
+				if (reader.StringEquals("tris"))
+					return reader.NextUInt(model.triangles);
+				return reader.SkipValue();
+			});
+			if (parsed && !model.uri.empty())
+				models.push_back(std::move(model));
+			return parsed;
+		});
+	}
+
+	// "2048x2048"
+	void ParseResolution(const std::string& text, uint32_t& width, uint32_t& height)
+	{
+		uint32_t values[2] = {};
+		size_t value = 0;
+		for (char c : text)
+		{
+			if (c >= '0' && c <= '9')
+				values[value] = values[value] * 10 + static_cast<uint32_t>(c - '0');
+			else if ((c == 'x' || c == 'X') && value == 0)
+				value = 1;
+			else
+				return;
+		}
+		width = values[0];
+		height = values[1];
+	}
+
+	bool ParseTextures(JsonReader& reader, std::vector<MegascansTexture>& textures)
+	{
+		std::string type;
+		std::string resolution;
+		std::string colorSpace;
+		return ForEachObject(reader, [&]()
+		{
+			MegascansTexture texture;
+			type.clear();
+			resolution.clear();
+			colorSpace.clear();
+			bool parsed = reader.ForEachMember([&]()
+			{
+				if (reader.StringEquals("type"))
+					return reader.NextString(type);
+				if (reader.StringEquals("uri"))
+					return reader.NextString(texture.uri);
+				if (reader.StringEquals("mimeType"))
+					return reader.NextString(texture.mimeType);
+				if (reader.StringEquals("resolution"))
+					return reader.NextString(resolution);
+				if (reader.StringEquals("colorSpace"))
+					return reader.NextString(colorSpace);
+				if (reader.StringEquals("bitDepth"))
+					return reader.NextUInt(texture.bitDepth);
+				return reader.SkipValue();
+			});
+			if (!parsed)
+				return false;
+
+			// Map types this engine has no use for are left out
+			const char* const* name = std::find(std::begin(MapNames), std::end(MapNames), type);
+			if (name == std::end(MapNames) || texture.uri.empty())
+				return true;
+			texture.map = static_cast<MegascansMap>(name - std::begin(MapNames));
+			ParseResolution(resolution, texture.width, texture.height);
+			texture.sRGB = colorSpace == "sRGB";
+			textures.push_back(std::move(texture));
+			return true;
+		});
+	}
+
+	std::string JoinPath(const std::string& directory, const std::string& path)
+	{
+		return directory.empty() ? path : directory + "/" + path;
+	}
+
+	// Forward slashes, lower case and no extension, so the paths a model can be loaded by compare equal
+	std::string GetComparablePath(const std::string& path)
+	{
+		std::string comparable = path;
+		size_t extensionOffset = comparable.find_last_of('.');
+		size_t slashOffset = comparable.find_last_of("\\/");
+		if (extensionOffset != std::string::npos && (slashOffset == std::string::npos || extensionOffset > slashOffset))
+			comparable.resize(extensionOffset);
+		for (char& c : comparable)
+			c = c == '\\' ? '/' : static_cast<char>(tolower(static_cast<unsigned char>(c)));
+		return comparable;
+	}
+
+	// The texture loader reads JPEG and PNG, EXR only as a last resort
+	int GetFormatRank(const std::string& mimeType)
+	{
+		if (mimeType == "image/jpeg" || mimeType == "image/png")
+			return 0;
+		if (mimeType == "image/x-exr")
+			return 2;
+		return 1;
+	}
+
+	const MegascansTexture* PickTexture(const std::vector<MegascansTexture>& textures, MegascansMap map, const std::string& directory, const MegascansResolveSettings& settings)
+	{
+		const MegascansTexture* best = nullptr;
+		auto isBetter = [&settings](const MegascansTexture& texture, const MegascansTexture& current)
+		{
+			const bool fits = settings.maxResolution == 0 || texture.width <= settings.maxResolution;
+			const bool currentFits = settings.maxResolution == 0 || current.width <= settings.maxResolution;
+			if (fits != currentFits)
+				return fits;
+			if (texture.width != current.width)
+				return fits ? texture.width > current.width : texture.width < current.width;
+			return GetFormatRank(texture.mimeType) < GetFormatRank(current.mimeType);
+		};
+		for (const MegascansTexture& texture : textures)
+		{
+			if (texture.map != map || (best != nullptr && !isBetter(texture, *best)))
+				continue;
+			if (settings.requireFiles && !FileHelper::FileExists(JoinPath(directory, texture.uri)))
+				continue;
+			best = &texture;
+		}
+		return best;
+	}
+
+	void ResolveTextureSet(const std::vector<MegascansTexture>& textures, const std::string& directory, const MegascansResolveSettings& settings, TextureSet& set)
+	{
+		for (size_t m = 0; m < MapCount; m++)
+		{
+			const MegascansTexture* texture = PickTexture(textures, static_cast<MegascansMap>(m), directory, settings);
+			if (texture == nullptr)
+				continue;
+			set.textures[m] = JoinPath(directory, texture->uri);
+			set.resolution = std::max(set.resolution, texture->width);
+		}
+
+		std::string& roughness = set.textures[static_cast<size_t>(MegascansMap::Roughness)];
+		const std::string& gloss = set.textures[static_cast<size_t>(MegascansMap::Gloss)];
+		if (roughness.empty() && !gloss.empty())
+		{
+			roughness = gloss;
+			set.roughnessFromGloss = true;
+		}
+	}
+}
+
+bool MegascansImporter::Parse(const char* json, size_t size, MegascansAsset& asset)
+{
+	asset = MegascansAsset();
+	JsonReader reader(json, size);
+	if (reader.Next() != JsonToken::ObjectStart)
+		return false;
+
+	bool parsed = reader.ForEachMember([&]()
+	{
+		if (reader.StringEquals("id"))
+			return reader.NextString(asset.id);
+		if (reader.StringEquals("name"))
+			return reader.NextString(asset.name);
+		if (reader.StringEquals("models"))
+			return ParseModels(reader, asset.models);
+		if (reader.StringEquals("maps"))
+			return ParseTextures(reader, asset.maps);
+		if (reader.StringEquals("billboards"))
+			return ParseTextures(reader, asset.billboards);
+		return reader.SkipValue();
+	});
+	return parsed && reader.Next() == JsonToken::End;
+}
+
+bool MegascansImporter::Load(const std::string& manifestPath, MegascansAsset& asset)
+{
+	MappedFile file;
+	if (!file.Open(manifestPath))
+		return false;
+	return Parse(reinterpret_cast<const char*>(file.Data()), file.Size(), asset);
+}
+
+void MegascansImporter::ResolveMaterials(const MegascansAsset& asset, const std::string& directory, const MegascansResolveSettings& settings, std::vector<MegascansMaterial>& materials)
+{
+	materials.clear();
+
+	std::map<uint32_t, uint32_t> lastLods; // Per variation
+	std::map<uint32_t, uint32_t> lodCounts;
+	for (const MegascansModel& model : asset.models)
+	{
+		uint32_t& lastLod = lastLods[model.variation];
+		lastLod = std::max(lastLod, model.lod);
+		lodCounts[model.variation]++;
+	}
+
+	// Each set is picked once, every LOD that uses it shares the result
+	TextureSet sets[2];
+	bool resolved[2] = {};
+	for (const MegascansModel& model : asset.models)
+	{
+		MegascansMaterial material;
+		material.name = asset.id + "_Var" + std::to_string(model.variation) + "_LOD" + std::to_string(model.lod);
+		material.model = JoinPath(directory, model.uri);
+		material.variation = model.variation;
+		material.lod = model.lod;
+		material.billboard = !asset.billboards.empty() && lodCounts[model.variation] > 1 && model.lod == lastLods[model.variation];
+
+		const size_t s = material.billboard ? 1 : 0;
+		if (!resolved[s])
+		{
+			ResolveTextureSet(material.billboard ? asset.billboards : asset.maps, directory, settings, sets[s]);
+			resolved[s] = true;
+		}
+		for (size_t m = 0; m < MapCount; m++)
+			material.textures[m] = sets[s].textures[m];
+		material.resolution = sets[s].resolution;
+		material.roughnessFromGloss = sets[s].roughnessFromGloss;
+		materials.push_back(std::move(material));
+	}
+}
+
+bool MegascansImporter::FindMaterial(const std::string& modelPath, MegascansMaterial& material, const MegascansResolveSettings& settings)
+{
+	const std::string target = GetComparablePath(modelPath);
+	std::string directory = StringHelper::GetDirectoryFromPath(modelPath);
+	for (int level = 0; level < 3; level++)
+	{
+		for (const std::string& name : FileHelper::ListFiles(directory.empty() ? "." : directory, ".json"))
+		{
+			MegascansAsset asset;
+			if (!Load(JoinPath(directory, name), asset))
+				continue;
+			auto listsModel = [&](const MegascansModel& model) { return GetComparablePath(JoinPath(directory, model.uri)) == target; };
+			if (std::none_of(asset.models.begin(), asset.models.end(), listsModel))
+				continue;
+
+			std::vector<MegascansMaterial> materials;
+			ResolveMaterials(asset, directory, settings, materials);
+			for (MegascansMaterial& candidate : materials)
+			{
+				if (GetComparablePath(candidate.model) == target)
+				{
+					material = std::move(candidate);
+					return true;
+				}
+			}
+		}
+		if (directory.empty())
+			break;
+		directory = StringHelper::GetDirectoryFromPath(directory);
+	}
+	return false;
+}
+
+void MegascansImporter::FindManifests(const std::string& directory, std::vector<std::string>& manifests)
+{
+	for (const std::string& name : FileHelper::ListFiles(directory, ".json"))
+		manifests.push_back(JoinPath(directory, name));
+	for (const std::string& name : FileHelper::ListDirectories(directory))
+		FindManifests(JoinPath(directory, name), manifests);
+}
+
+const char* MegascansImporter::GetMapName(MegascansMap map)
+{
+	size_t index = static_cast<size_t>(map);
+	return index < MapCount ? MapNames[index] : "unknown";
+}
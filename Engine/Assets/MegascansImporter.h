@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Texture types a Megascans manifest lists, from the "type" of its maps
+enum class MegascansMap
+{
+	Albedo,
+	Normal,
+	Roughness,
+	Gloss, // Inverse roughness
+	Specular,
+	Metalness,
+	Opacity,
+	Translucency,
+	Ao,
+	Cavity,
+	Bump,
+	Displacement,
+	Fuzz,
+	Count,
+};
+
+struct MegascansTexture
+{
+	MegascansMap map;
+	std::string uri; // Relative to the manifest
+	std::string mimeType;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t bitDepth = 0;
+	bool sRGB = false;
+};
+
+struct MegascansModel
+{
+	std::string uri; // Relative to the manifest
+	uint32_t lod = 0;
+	uint32_t variation = 0;
+	uint32_t triangles = 0;
+};
+
+// What the engine uses out of a Megascans asset manifest (the <id>.json that comes with every download)
+struct MegascansAsset
+{
+	std::string id;
+	std::string name;
+	std::vector<MegascansModel> models;
+	std::vector<MegascansTexture> maps; // The surface textures, every map in every resolution and format
+	std::vector<MegascansTexture> billboards; // 3D plants only, the textures of the last LOD
+};
+
+// Textures resolved for one model file of an asset
+struct MegascansMaterial
+{
+	std::string name; // "<asset id>_Var<variation>_LOD<lod>"
+	std::string model; // Path of the model file
+	uint32_t variation = 0;
+	uint32_t lod = 0;
+	bool billboard = false; // Uses the billboard textures
+	bool roughnessFromGloss = false; // textures[Roughness] is a gloss map, sample it as 1 - value
+	uint32_t resolution = 0; // Widest texture picked
+	std::string textures[static_cast<size_t>(MegascansMap::Count)]; // Paths next to the manifest, empty for maps the asset does not have
+
+	const std::string& GetTexture(MegascansMap map) const { return this->textures[static_cast<size_t>(map)]; }
+};
+
+struct MegascansResolveSettings
+{
+	uint32_t maxResolution = 0; // Widest texture to use, 0 for no limit. Falls back to the narrowest above it if that is all there is
+	bool requireFiles = true; // Only pick textures that are on disk, a download usually has one resolution out of the many the manifest lists
+};
+
+// Reads Megascans manifests and turns them into materials, so downloaded assets load with their textures bound
+// without any hand wiring.
+//
+// Parse streams the manifest through JsonReader and keeps only the members above, the previews, tags, points and
+// the rest are skipped without being built, a manifest parses in tens of microseconds. ResolveMaterials then makes one
+// material per model file. Every map type gets the widest texture within maxResolution, preferring formats the
+// texture loader reads (JPEG, PNG) over EXR. 3D plants come with billboard textures for the crossed quads of their
+// last LOD, so the last LOD of each variation takes those and every other LOD takes the atlas maps
+class MegascansImporter
+{
+public:
+	static bool Parse(const char* json, size_t size, MegascansAsset& asset);
+	static bool Load(const std::string& manifestPath, MegascansAsset& asset);
+
+	// directory is the one the manifest is in, the texture and model paths are made relative to it
+	static void ResolveMaterials(const MegascansAsset& asset, const std::string& directory, const MegascansResolveSettings& settings, std::vector<MegascansMaterial>& materials);
+
+	// Looks for the manifest that lists modelPath in the model's directory and the two above it, a Megascans download
+	// keeps each variation in a folder next to the manifest. The extension is ignored, so a cooked copy finds the
+	// material of its source
+	static bool FindMaterial(const std::string& modelPath, MegascansMaterial& material, const MegascansResolveSettings& settings = MegascansResolveSettings());
+
+	// Every .json file below directory
+	static void FindManifests(const std::string& directory, std::vector<std::string>& manifests);
+
+	static const char* GetMapName(MegascansMap map);
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include "../Graphics/Vertex.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Simplified index list over the same vertices as the full detail mesh
+struct MeshLod
+{
+	std::vector<uint32_t> indices;
+	float error = 0.0f; // Simplification error relative to the mesh's bounding box diagonal
+};
+
+// CPU side copy of a mesh as it comes out of the importer, before any GPU resources exist.
+// Everything in the asset pipeline (cooking, processing passes, caching) works on these
+struct MeshData
+{
+	std::vector<Vertex3D> vertices;
+	std::vector<uint32_t> indices;
+	// Optional streams next to vertices, one entry per vertex or empty. Vertex3D stays the layout the raster
+	// pipeline draws, passes that reorder or merge vertices carry these along
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<DirectX::XMFLOAT4> tangents; // Bitangent sign in w, see TangentGenerator
+	DirectX::XMFLOAT4X4 transform; // Accumulated node transform, same layout as XMMATRIX
+	uint32_t materialIndex = 0;
+	std::vector<MeshLod> lods; // LOD1 onwards, empty unless the importer was asked to generate them
+};
+
+struct MaterialData
+{
+	std::string name;
+	std::string diffuseTexture; // Relative to the model directory, "*N" for embedded textures, empty if there is none
+};
+
+struct ModelData
+{
+	std::vector<MeshData> meshes;
+	std::vector<MaterialData> materials;
+};
@@ -0,0 +1,782 @@
+#include "MeshSimplifier.h"
+#include "VertexCacheOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t None = 0xFFFFFFFF;
+	const double BoundaryWeight = 2.0; // How strongly border and seam edges resist moving sideways
+
+	enum VertexKind : uint8_t
+	{
+		Manifold, // Interior vertex with a single uv, can collapse anywhere
+		Border, // On an open edge of the mesh, may only move along it
+		Seam, // One of two vertices at a uv seam, moves along the seam together with its partner
+		Locked, // Anything else, never moves
+	};
+
+	// Symmetric 4x4 error quadric, sum of weight * (n.p + d)^2 over the planes that were added
+	struct Quadric
+	{
+		double a00, a11, a22, a01, a02, a12;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+
+	void AddPlane(Quadric& q, double nx, double ny, double nz, double d, double weight)
+	{
+		q.a00 += weight * nx * nx;
+		q.a11 += weight * ny * ny;
+		q.a22 += weight * nz * nz;
+		q.a01 += weight * nx * ny;
+		q.a02 += weight * nx * nz;
+		q.a12 += weight * ny * nz;
+		q.b0 += weight * nx * d;
+		q.b1 += weight * ny * d;
+		q.b2 += weight * nz * d;
+		q.c += weight * d * d;
+		q.weight += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a00 += other.a00;
+		q.a11 += other.a11;
+		q.a22 += other.a22;
+		q.a01 += other.a01;
+		q.a02 += other.a02;
+		q.a12 += other.a12;
+		q.b0 += other.b0;
+		q.b1 += other.b1;
+		q.b2 += other.b2;
+		q.c += other.c;
+		q.weight += other.weight;
+	}
+
+	// Weighted mean squared distance from p to the quadric's planes
+	double Evaluate(const Quadric& q, const XMFLOAT3& p)
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double r = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z
+			+ 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+			+ 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+		return q.weight > 0.0 ? fabs(r) / q.weight : 0.0;
+	}
+
+	XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	bool IsSamePosition(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	// Vertex to triangle lists for the current index buffer, rebuilt every pass
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		void Build(const std::vector<uint32_t>& indices, size_t vertexCount)
+		{
+			this->offsets.assign(vertexCount + 1, 0);
+			for (uint32_t index : indices)
+				this->offsets[index + 1]++;
+			for (size_t v = 0; v < vertexCount; v++)
+				this->offsets[v + 1] += this->offsets[v];
+
+			this->triangles.resize(indices.size());
+			std::vector<uint32_t> fill(this->offsets.begin(), this->offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+				this->triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		// Whether some triangle has the directed edge a -> b
+		bool HasEdge(const std::vector<uint32_t>& indices, uint32_t a, uint32_t b) const
+		{
+			for (uint32_t i = this->offsets[a]; i < this->offsets[a + 1]; i++)
+			{
+				const uint32_t* triangle = &indices[this->triangles[i] * 3];
+				for (int k = 0; k < 3; k++)
+				{
+					if (triangle[k] == a && triangle[(k + 1) % 3] == b)
+						return true;
+				}
+			}
+			return false;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	class Simplifier
+	{
+	public:
+		Simplifier(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& indices)
+			: vertices(vertices), indices(indices)
+		{
+			const size_t vertexCount = vertices.size();
+
+			// Squared errors are kept relative to the bounding box so the limits do not depend on the model's units
+			XMFLOAT3 minimum = vertices.empty() ? XMFLOAT3(0.0f, 0.0f, 0.0f) : vertices[0].pos;
+			XMFLOAT3 maximum = minimum;
+			for (const Vertex3D& vertex : vertices)
+			{
+				minimum = XMFLOAT3(std::min(minimum.x, vertex.pos.x), std::min(minimum.y, vertex.pos.y), std::min(minimum.z, vertex.pos.z));
+				maximum = XMFLOAT3(std::max(maximum.x, vertex.pos.x), std::max(maximum.y, vertex.pos.y), std::max(maximum.z, vertex.pos.z));
+			}
+			XMFLOAT3 extent = Subtract(maximum, minimum);
+			double diagonal = sqrt(Dot(extent, extent));
+			this->errorScale = diagonal > 0.0 ? 1.0 / (diagonal * diagonal) : 0.0;
+
+			BuildPositionGroups();
+			this->remap.resize(vertexCount);
+			for (size_t v = 0; v < vertexCount; v++)
+				this->remap[v] = static_cast<uint32_t>(v);
+
+			this->adjacency.Build(this->indices, vertexCount);
+			FindOpenEdges();
+			ClassifyVertices();
+			BuildQuadrics();
+		}
+
+		float Run(size_t targetIndexCount, float maxError)
+		{
+			const double maxCost = static_cast<double>(maxError) * maxError;
+			double reached = 0.0;
+
+			while (this->indices.size() > targetIndexCount)
+			{
+				std::vector<Collapse> collapses;
+				GatherCollapses(collapses);
+				if (collapses.empty())
+					break;
+				std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+				size_t collapsed = ApplyCollapses(collapses, targetIndexCount / 3, maxCost, reached);
+				if (collapsed == 0)
+					break;
+
+				RemoveDegenerateTriangles();
+				this->adjacency.Build(this->indices, this->vertices.size());
+				FindOpenEdges();
+			}
+			return static_cast<float>(sqrt(reached));
+		}
+
+		const std::vector<uint32_t>& GetIndices() const { return this->indices; }
+
+	private:
+		// Vertices with identical positions are linked into a ring through wedge[], positionGroup is the first of them
+		void BuildPositionGroups()
+		{
+			const size_t vertexCount = this->vertices.size();
+			std::vector<uint32_t> order(vertexCount);
+			for (size_t v = 0; v < vertexCount; v++)
+				order[v] = static_cast<uint32_t>(v);
+			std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+			{
+				const XMFLOAT3& pa = this->vertices[a].pos;
+				const XMFLOAT3& pb = this->vertices[b].pos;
+				if (pa.x != pb.x) return pa.x < pb.x;
+				if (pa.y != pb.y) return pa.y < pb.y;
+				if (pa.z != pb.z) return pa.z < pb.z;
+				return a < b;
+			});
+
+			this->positionGroup.resize(vertexCount);
+			this->wedge.resize(vertexCount);
+			for (size_t i = 0; i < vertexCount;)
+			{
+				size_t end = i + 1;
+				while (end < vertexCount && IsSamePosition(this->vertices[order[end]].pos, this->vertices[order[i]].pos))
+					end++;
+				for (size_t k = i; k < end; k++)
+				{
+					this->positionGroup[order[k]] = order[i];
+					this->wedge[order[k]] = order[k + 1 < end ? k + 1 : i];
+				}
+				i = end;
+			}
+		}
+
+		// An edge is open when no triangle has it the other way round. Uv seams look open as well, because the
+		// triangles on the far side use the other vertex of the seam
+		void FindOpenEdges()
+		{
+			const size_t vertexCount = this->vertices.size();
+			this->openOutCount.assign(vertexCount, 0);
+			this->openInCount.assign(vertexCount, 0);
+			this->openOut.assign(vertexCount, None);
+			this->openIn.assign(vertexCount, None);
+
+			for (size_t i = 0; i < this->indices.size(); i += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t a = this->indices[i + k];
+					uint32_t b = this->indices[i + (k + 1) % 3];
+					if (!this->adjacency.HasEdge(this->indices, b, a))
+					{
+						this->openOutCount[a]++;
+						this->openOut[a] = b;
+						this->openInCount[b]++;
+						this->openIn[b] = a;
+					}
+				}
+			}
+		}
+
+		bool HasSingleOpenEdgePair(uint32_t v) const
+		{
+			return this->openOutCount[v] == 1 && this->openInCount[v] == 1;
+		}
+
+		// Done once on the source mesh. The collapse rules keep every kind valid, so it never has to be redone
+		void ClassifyVertices()
+		{
+			const size_t vertexCount = this->vertices.size();
+			this->kind.assign(vertexCount, Locked);
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				uint32_t w = this->wedge[v];
+				if (w == v)
+				{
+					if (this->openOutCount[v] == 0 && this->openInCount[v] == 0)
+						this->kind[v] = Manifold;
+					else if (HasSingleOpenEdgePair(v))
+						this->kind[v] = Border;
+				}
+				else if (this->wedge[w] == v && HasSingleOpenEdgePair(v) && HasSingleOpenEdgePair(w))
+				{
+					// A clean seam: what leaves v arrives at w from the same position and the other way round
+					if (this->positionGroup[this->openOut[v]] == this->positionGroup[this->openIn[w]] &&
+						this->positionGroup[this->openIn[v]] == this->positionGroup[this->openOut[w]])
+						this->kind[v] = Seam;
+				}
+			}
+		}
+
+		void BuildQuadrics()
+		{
+			this->quadrics.assign(this->vertices.size(), Quadric());
+			for (size_t i = 0; i < this->indices.size(); i += 3)
+			{
+				const XMFLOAT3& p0 = this->vertices[this->indices[i]].pos;
+				const XMFLOAT3& p1 = this->vertices[this->indices[i + 1]].pos;
+				const XMFLOAT3& p2 = this->vertices[this->indices[i + 2]].pos;
+				XMFLOAT3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+				double length = sqrt(Dot(normal, normal));
+				if (length <= 0.0)
+					continue;
+
+				double nx = normal.x / length, ny = normal.y / length, nz = normal.z / length;
+				double d = -(nx * p0.x + ny * p0.y + nz * p0.z);
+				double area = length * 0.5;
+				for (int k = 0; k < 3; k++)
+					AddPlane(this->quadrics[this->positionGroup[this->indices[i + k]]], nx, ny, nz, d, area);
+
+				// Open edges get a plane standing up along the edge, so moving off the border or seam costs something
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t a = this->indices[i + k];
+					uint32_t b = this->indices[i + (k + 1) % 3];
+					if (this->openOut[a] != b || this->openOutCount[a] == 0)
+						continue;
+					const XMFLOAT3& pa = this->vertices[a].pos;
+					XMFLOAT3 edge = Subtract(this->vertices[b].pos, pa);
+					XMFLOAT3 side = Cross(edge, XMFLOAT3(static_cast<float>(nx), static_cast<float>(ny), static_cast<float>(nz)));
+					double sideLength = sqrt(Dot(side, side));
+					if (sideLength <= 0.0)
+						continue;
+					double sx = side.x / sideLength, sy = side.y / sideLength, sz = side.z / sideLength;
+					double sd = -(sx * pa.x + sy * pa.y + sz * pa.z);
+					double weight = Dot(edge, edge) * BoundaryWeight;
+					AddPlane(this->quadrics[this->positionGroup[a]], sx, sy, sz, sd, weight);
+					AddPlane(this->quadrics[this->positionGroup[b]], sx, sy, sz, sd, weight);
+				}
+			}
+		}
+
+		// For a seam collapse from -> to, the vertex the seam partner of from has to go to. None if the seam does not line up
+		uint32_t GetSeamPartnerTarget(uint32_t from, uint32_t to) const
+		{
+			uint32_t fromPartner = this->wedge[from];
+			uint32_t toPartner = this->wedge[to];
+			if (toPartner == to || this->wedge[toPartner] != to)
+				return None;
+			// Walking along the seam on one side means walking the other way on the far side
+			if (this->openOut[from] == to && this->openIn[fromPartner] == toPartner)
+				return toPartner;
+			if (this->openIn[from] == to && this->openOut[fromPartner] == toPartner)
+				return toPartner;
+			return None;
+		}
+
+		bool CanCollapse(uint32_t from, uint32_t to) const
+		{
+			if (this->positionGroup[from] == this->positionGroup[to])
+				return false;
+
+			switch (this->kind[from])
+			{
+			case Manifold:
+				return true;
+			case Border:
+				// Only along the border, onto a vertex that is also on it
+				return HasSingleOpenEdgePair(from) && (this->openOut[from] == to || this->openIn[from] == to) &&
+					(this->kind[to] == Border || this->kind[to] == Locked);
+			case Seam:
+				return this->kind[to] == Seam && HasSingleOpenEdgePair(from) && HasSingleOpenEdgePair(this->wedge[from]) &&
+					(this->openOut[from] == to || this->openIn[from] == to) && GetSeamPartnerTarget(from, to) != None;
+			default:
+				return false;
+			}
+		}
+
+		double GetCost(uint32_t from, uint32_t to) const
+		{
+			return Evaluate(this->quadrics[this->positionGroup[from]], this->vertices[to].pos) * this->errorScale;
+		}
+
+		void GatherCollapses(std::vector<Collapse>& collapses) const
+		{
+			collapses.reserve(this->indices.size());
+			for (size_t i = 0; i < this->indices.size(); i += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t a = this->indices[i + k];
+					uint32_t b = this->indices[i + (k + 1) % 3];
+					// Interior edges show up once from each side, only keep one of them
+					if (a > b && this->openOut[a] != b)
+						continue;
+
+					bool forward = CanCollapse(a, b);
+					bool backward = CanCollapse(b, a);
+					if (!forward && !backward)
+						continue;
+
+					double forwardCost = forward ? GetCost(a, b) : 0.0;
+					double backwardCost = backward ? GetCost(b, a) : 0.0;
+					Collapse collapse;
+					if (forward && (!backward || forwardCost <= backwardCost))
+					{
+						collapse.from = a;
+						collapse.to = b;
+						collapse.cost = forwardCost;
+					}
+					else
+					{
+						collapse.from = b;
+						collapse.to = a;
+						collapse.cost = backwardCost;
+					}
+					collapses.push_back(collapse);
+				}
+			}
+		}
+
+		// Moving from onto to must not turn any surviving triangle around from upside down
+		bool HasTriangleFlip(uint32_t from, uint32_t to) const
+		{
+			const XMFLOAT3& target = this->vertices[to].pos;
+			for (uint32_t i = this->adjacency.offsets[from]; i < this->adjacency.offsets[from + 1]; i++)
+			{
+				const uint32_t* triangle = &this->indices[this->adjacency.triangles[i] * 3];
+				int corner = triangle[0] == from ? 0 : triangle[1] == from ? 1 : 2;
+				uint32_t b = this->remap[triangle[(corner + 1) % 3]];
+				uint32_t c = this->remap[triangle[(corner + 2) % 3]];
+				if (this->positionGroup[b] == this->positionGroup[to] || this->positionGroup[c] == this->positionGroup[to])
+					continue; // Collapses away
+
+				const XMFLOAT3& pa = this->vertices[from].pos;
+				const XMFLOAT3& pb = this->vertices[b].pos;
+				const XMFLOAT3& pc = this->vertices[c].pos;
+				XMFLOAT3 before = Cross(Subtract(pb, pa), Subtract(pc, pa));
+				XMFLOAT3 after = Cross(Subtract(pb, target), Subtract(pc, target));
+				// Turning further than about 75 degrees counts as well, a few of those in a row add up to a fold
+				float dot = Dot(before, after);
+				if (dot <= 0.0f || dot * dot < 0.0625f * Dot(before, before) * Dot(after, after))
+					return true;
+			}
+			return false;
+		}
+
+		uint32_t CountSharedTriangles(uint32_t from, uint32_t to) const
+		{
+			uint32_t count = 0;
+			for (uint32_t i = this->adjacency.offsets[from]; i < this->adjacency.offsets[from + 1]; i++)
+			{
+				const uint32_t* triangle = &this->indices[this->adjacency.triangles[i] * 3];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+					count++;
+			}
+			return count;
+		}
+
+		// The flip check looks at from's neighbours where they are now, so none of them may move again this pass
+		void LockRing(uint32_t from, std::vector<bool>& touched) const
+		{
+			for (uint32_t i = this->adjacency.offsets[from]; i < this->adjacency.offsets[from + 1]; i++)
+			{
+				const uint32_t* triangle = &this->indices[this->adjacency.triangles[i] * 3];
+				for (int k = 0; k < 3; k++)
+					touched[this->positionGroup[triangle[k]]] = true;
+			}
+		}
+
+		// Applies as many of the sorted collapses as possible. A collapse locks every position around it for the rest
+		// of the pass so the costs and flip checks stay valid
+		size_t ApplyCollapses(const std::vector<Collapse>& collapses, size_t targetTriangles, double maxCost, double& reached)
+		{
+			std::vector<bool> touched(this->vertices.size(), false);
+			size_t triangleCount = this->indices.size() / 3;
+			size_t applied = 0;
+
+			for (const Collapse& collapse : collapses)
+			{
+				if (triangleCount <= targetTriangles || collapse.cost > maxCost)
+					break;
+
+				uint32_t from = collapse.from;
+				uint32_t to = collapse.to;
+				if (touched[this->positionGroup[from]] || touched[this->positionGroup[to]])
+					continue;
+
+				uint32_t partnerFrom = None;
+				uint32_t partnerTo = None;
+				if (this->kind[from] == Seam)
+				{
+					partnerFrom = this->wedge[from];
+					partnerTo = GetSeamPartnerTarget(from, to);
+					if (HasTriangleFlip(partnerFrom, partnerTo))
+						continue;
+				}
+				if (HasTriangleFlip(from, to))
+					continue;
+
+				triangleCount -= CountSharedTriangles(from, to);
+				this->remap[from] = to;
+				if (partnerFrom != None)
+				{
+					triangleCount -= CountSharedTriangles(partnerFrom, partnerTo);
+					this->remap[partnerFrom] = partnerTo;
+				}
+
+				AddQuadric(this->quadrics[this->positionGroup[to]], this->quadrics[this->positionGroup[from]]);
+				LockRing(from, touched);
+				if (partnerFrom != None)
+					LockRing(partnerFrom, touched);
+				reached = std::max(reached, collapse.cost);
+				applied++;
+			}
+			return applied;
+		}
+
+		void RemoveDegenerateTriangles()
+		{
+			size_t write = 0;
+			for (size_t i = 0; i < this->indices.size(); i += 3)
+			{
+				uint32_t a = this->remap[this->indices[i]];
+				uint32_t b = this->remap[this->indices[i + 1]];
+				uint32_t c = this->remap[this->indices[i + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+				this->indices[write++] = a;
+				this->indices[write++] = b;
+				this->indices[write++] = c;
+			}
+			this->indices.resize(write);
+
+			// Collapsed vertices are gone for good, later passes start from an identity remap again
+			for (size_t v = 0; v < this->remap.size(); v++)
+				this->remap[v] = static_cast<uint32_t>(v);
+		}
+
+		const std::vector<Vertex3D>& vertices;
+		std::vector<uint32_t> indices;
+		double errorScale = 0.0;
+
+		std::vector<uint32_t> positionGroup;
+		std::vector<uint32_t> wedge;
+		std::vector<uint8_t> kind;
+		std::vector<Quadric> quadrics; // Indexed by position group
+		std::vector<uint32_t> remap;
+
+		Adjacency adjacency;
+		std::vector<uint32_t> openOutCount;
+		std::vector<uint32_t> openInCount;
+		std::vector<uint32_t> openOut;
+		std::vector<uint32_t> openIn;
+	};
+
+	// -- Distance measurement -- //
+
+	XMFLOAT3 ClosestPointOnTriangle(const XMFLOAT3& p, const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+	{
+		// Ericson, Real-Time Collision Detection 5.1.5
+		XMFLOAT3 ab = Subtract(b, a);
+		XMFLOAT3 ac = Subtract(c, a);
+		XMFLOAT3 ap = Subtract(p, a);
+		float d1 = Dot(ab, ap);
+		float d2 = Dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return a;
+
+		XMFLOAT3 bp = Subtract(p, b);
+		float d3 = Dot(ab, bp);
+		float d4 = Dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3)
+			return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		{
+			float v = d1 / (d1 - d3);
+			return XMFLOAT3(a.x + ab.x * v, a.y + ab.y * v, a.z + ab.z * v);
+		}
+
+		XMFLOAT3 cp = Subtract(p, c);
+		float d5 = Dot(ab, cp);
+		float d6 = Dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6)
+			return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		{
+			float w = d2 / (d2 - d6);
+			return XMFLOAT3(a.x + ac.x * w, a.y + ac.y * w, a.z + ac.z * w);
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		{
+			float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			return XMFLOAT3(b.x + (c.x - b.x) * w, b.y + (c.y - b.y) * w, b.z + (c.z - b.z) * w);
+		}
+
+		float denominator = 1.0f / (va + vb + vc);
+		float v = vb * denominator;
+		float w = vc * denominator;
+		return XMFLOAT3(a.x + ab.x * v + ac.x * w, a.y + ab.y * v + ac.y * w, a.z + ab.z * v + ac.z * w);
+	}
+
+	// Uniform grid of triangles for closest point queries
+	class TriangleGrid
+	{
+	public:
+		TriangleGrid(const std::vector<XMFLOAT3>& positions, const std::vector<uint32_t>& indices)
+			: positions(positions), indices(indices)
+		{
+			const size_t triangleCount = indices.size() / 3;
+			this->minimum = positions.empty() ? XMFLOAT3(0.0f, 0.0f, 0.0f) : positions[0];
+			XMFLOAT3 maximum = this->minimum;
+			for (const XMFLOAT3& p : positions)
+			{
+				this->minimum = XMFLOAT3(std::min(this->minimum.x, p.x), std::min(this->minimum.y, p.y), std::min(this->minimum.z, p.z));
+				maximum = XMFLOAT3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+			}
+
+			// Roughly one triangle per cell
+			XMFLOAT3 extent = Subtract(maximum, this->minimum);
+			float volume = std::max(extent.x, 1e-6f) * std::max(extent.y, 1e-6f) * std::max(extent.z, 1e-6f);
+			this->cellSize = std::max(cbrtf(volume / std::max<size_t>(triangleCount, 1)), 1e-6f);
+			this->cells[0] = std::min(std::max(static_cast<int>(extent.x / this->cellSize) + 1, 1), 256);
+			this->cells[1] = std::min(std::max(static_cast<int>(extent.y / this->cellSize) + 1, 1), 256);
+			this->cells[2] = std::min(std::max(static_cast<int>(extent.z / this->cellSize) + 1, 1), 256);
+			this->cellSize = std::max(std::max(extent.x / this->cells[0], extent.y / this->cells[1]), std::max(extent.z / this->cells[2], 1e-6f));
+
+			const size_t cellCount = static_cast<size_t>(this->cells[0]) * this->cells[1] * this->cells[2];
+			std::vector<std::pair<uint32_t, uint32_t>> entries; // cell, triangle
+			for (size_t t = 0; t < triangleCount; t++)
+			{
+				int low[3], high[3];
+				GetTriangleCells(t, low, high);
+				for (int z = low[2]; z <= high[2]; z++)
+					for (int y = low[1]; y <= high[1]; y++)
+						for (int x = low[0]; x <= high[0]; x++)
+							entries.push_back(std::make_pair(static_cast<uint32_t>(CellIndex(x, y, z)), static_cast<uint32_t>(t)));
+			}
+			std::sort(entries.begin(), entries.end());
+
+			this->cellOffsets.assign(cellCount + 1, 0);
+			this->cellTriangles.resize(entries.size());
+			for (size_t i = 0; i < entries.size(); i++)
+			{
+				this->cellOffsets[entries[i].first + 1]++;
+				this->cellTriangles[i] = entries[i].second;
+			}
+			for (size_t c = 0; c < cellCount; c++)
+				this->cellOffsets[c + 1] += this->cellOffsets[c];
+		}
+
+		// Searches outwards one shell of cells at a time until nothing closer can be left
+		float GetDistance(const XMFLOAT3& p) const
+		{
+			int center[3];
+			GetCell(p, center);
+			float best = 3.4e38f;
+			const int maxRadius = std::max(this->cells[0], std::max(this->cells[1], this->cells[2]));
+			for (int radius = 0; radius <= maxRadius; radius++)
+			{
+				for (int z = center[2] - radius; z <= center[2] + radius; z++)
+				{
+					for (int y = center[1] - radius; y <= center[1] + radius; y++)
+					{
+						for (int x = center[0] - radius; x <= center[0] + radius; x++)
+						{
+							bool shell = abs(x - center[0]) == radius || abs(y - center[1]) == radius || abs(z - center[2]) == radius;
+							if (!shell || x < 0 || y < 0 || z < 0 || x >= this->cells[0] || y >= this->cells[1] || z >= this->cells[2])
+								continue;
+							size_t cell = CellIndex(x, y, z);
+							for (uint32_t i = this->cellOffsets[cell]; i < this->cellOffsets[cell + 1]; i++)
+							{
+								uint32_t t = this->cellTriangles[i];
+								XMFLOAT3 closest = ClosestPointOnTriangle(p, this->positions[this->indices[t * 3]], this->positions[this->indices[t * 3 + 1]], this->positions[this->indices[t * 3 + 2]]);
+								XMFLOAT3 offset = Subtract(p, closest);
+								best = std::min(best, sqrtf(Dot(offset, offset)));
+							}
+						}
+					}
+				}
+				// Everything beyond this shell is at least radius cells away
+				if (best <= radius * this->cellSize)
+					break;
+			}
+			return best;
+		}
+
+	private:
+		size_t CellIndex(int x, int y, int z) const
+		{
+			return (static_cast<size_t>(z) * this->cells[1] + y) * this->cells[0] + x;
+		}
+
+		void GetCell(const XMFLOAT3& p, int* cell) const
+		{
+			const float coordinates[3] = { p.x - this->minimum.x, p.y - this->minimum.y, p.z - this->minimum.z };
+			for (int axis = 0; axis < 3; axis++)
+				cell[axis] = std::min(std::max(static_cast<int>(floorf(coordinates[axis] / this->cellSize)), 0), this->cells[axis] - 1);
+		}
+
+		void GetTriangleCells(size_t t, int* low, int* high) const
+		{
+			const XMFLOAT3& a = this->positions[this->indices[t * 3]];
+			const XMFLOAT3& b = this->positions[this->indices[t * 3 + 1]];
+			const XMFLOAT3& c = this->positions[this->indices[t * 3 + 2]];
+			GetCell(XMFLOAT3(std::min(a.x, std::min(b.x, c.x)), std::min(a.y, std::min(b.y, c.y)), std::min(a.z, std::min(b.z, c.z))), low);
+			GetCell(XMFLOAT3(std::max(a.x, std::max(b.x, c.x)), std::max(a.y, std::max(b.y, c.y)), std::max(a.z, std::max(b.z, c.z))), high);
+		}
+
+		const std::vector<XMFLOAT3>& positions;
+		const std::vector<uint32_t>& indices;
+		XMFLOAT3 minimum;
+		float cellSize;
+		int cells[3];
+		std::vector<uint32_t> cellOffsets;
+		std::vector<uint32_t> cellTriangles;
+	};
+
+	void MeasureOneWay(const std::vector<XMFLOAT3>& positions, const std::vector<uint32_t>& indices, const TriangleGrid& grid, float& maxDistance, double& sum, size_t& samples)
+	{
+		for (const XMFLOAT3& p : positions)
+		{
+			float distance = grid.GetDistance(p);
+			maxDistance = std::max(maxDistance, distance);
+			sum += distance;
+			samples++;
+		}
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const XMFLOAT3& a = positions[indices[i]];
+			const XMFLOAT3& b = positions[indices[i + 1]];
+			const XMFLOAT3& c = positions[indices[i + 2]];
+			float distance = grid.GetDistance(XMFLOAT3((a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f));
+			maxDistance = std::max(maxDistance, distance);
+			sum += distance;
+			samples++;
+		}
+	}
+}
+
+float MeshSimplifier::Simplify(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError, std::vector<uint32_t>& output)
+{
+	if (indices.size() <= targetIndexCount || vertices.empty())
+	{
+		output = indices;
+		return 0.0f;
+	}
+
+	Simplifier simplifier(vertices, indices);
+	float error = simplifier.Run(targetIndexCount, maxError);
+	output = simplifier.GetIndices();
+	return error;
+}
+
+void MeshSimplifier::GenerateLods(MeshData& mesh, const LodSettings& settings)
+{
+	// Every LOD starts over from LOD0, so the error Simplify reports is the distance from the source mesh, the one
+	// maxError and Mesh::SelectLod go by. Chained from the LOD before, the errors would add up instead
+	mesh.lods.clear();
+	const std::vector<uint32_t>* previous = &mesh.indices;
+	for (uint32_t lod = 0; lod < settings.lodCount; lod++)
+	{
+		size_t target = static_cast<size_t>(previous->size() / 3 * settings.triangleRatio) * 3;
+		MeshLod result;
+		result.error = Simplify(mesh.vertices, mesh.indices, target, settings.maxError, result.indices);
+
+		// Stop once the error limit keeps the mesh from getting meaningfully smaller
+		if (result.indices.size() >= previous->size() * 0.95f || result.indices.empty())
+			break;
+		// A coarser LOD never reports less error than a finer one, or SelectLod could prefer it
+		if (!mesh.lods.empty())
+			result.error = std::max(result.error, mesh.lods.back().error);
+
+		VertexCacheOptimizer::OptimizeIndices(result.indices, mesh.vertices.size());
+		mesh.lods.push_back(std::move(result));
+		previous = &mesh.lods.back().indices;
+	}
+}
+
+MeshSimplifier::DistanceStatistics MeshSimplifier::MeasureDistance(const std::vector<XMFLOAT3>& positionsA, const std::vector<uint32_t>& indicesA,
+	const std::vector<XMFLOAT3>& positionsB, const std::vector<uint32_t>& indicesB)
+{
+	DistanceStatistics statistics;
+	if (indicesA.size() < 3 || indicesB.size() < 3)
+		return statistics;
+
+	TriangleGrid gridA(positionsA, indicesA);
+	TriangleGrid gridB(positionsB, indicesB);
+
+	double sum = 0.0;
+	size_t samples = 0;
+	MeasureOneWay(positionsA, indicesA, gridB, statistics.maxDistance, sum, samples);
+	MeasureOneWay(positionsB, indicesB, gridA, statistics.maxDistance, sum, samples);
+	statistics.meanDistance = samples > 0 ? static_cast<float>(sum / samples) : 0.0f;
+	return statistics;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "MeshData.h"
+
+// Quadric error metric edge collapse simplification (Garland and Heckbert) that produces new index lists over
+// the mesh's existing vertices, so every LOD shares LOD0's vertex buffer.
+//
+// Collapses are half edge collapses, one vertex moves onto a neighbour, so uvs never have to be interpolated.
+// Vertices that sit on a uv seam (two vertices at one position) may only slide along the seam and take their
+// partner on the other side with them, border vertices may only slide along the border. Anything more
+// complicated than that is left where it is, which is what keeps seams and open edges intact.
+
+struct LodSettings
+{
+	uint32_t lodCount = 0; // LODs generated on top of LOD0
+	float triangleRatio = 0.5f; // Each LOD aims for this fraction of the previous one's triangles
+	float maxError = 0.02f; // Largest error allowed, relative to the mesh's bounding box diagonal
+};
+
+class MeshSimplifier
+{
+public:
+	// Simplifies towards targetIndexCount without going over maxError (relative to the bounding box diagonal).
+	// Returns the error that was reached
+	static float Simplify(const std::vector<Vertex3D>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError, std::vector<uint32_t>& output);
+
+	// Fills mesh.lods, each LOD is simplified from LOD0 towards triangleRatio of the one before it
+	static void GenerateLods(MeshData& mesh, const LodSettings& settings);
+
+	struct DistanceStatistics
+	{
+		float maxDistance = 0.0f;
+		float meanDistance = 0.0f;
+	};
+
+	// Distance from every vertex and triangle centre of one triangle soup to the closest point on the other, in both
+	// directions. The larger of the two maxima is a close estimate of the Hausdorff distance between the surfaces
+	static DistanceStatistics MeasureDistance(const std::vector<DirectX::XMFLOAT3>& positionsA, const std::vector<uint32_t>& indicesA,
+		const std::vector<DirectX::XMFLOAT3>& positionsB, const std::vector<uint32_t>& indicesB);
+};
@@ -0,0 +1,222 @@
+#include "MeshletBuilder.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint8_t NotInMeshlet = 0xFF;
+
+	XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	float Length(const XMFLOAT3& a)
+	{
+		return sqrtf(Dot(a, a));
+	}
+}
+
+void MeshletBuilder::Build(const MeshData& mesh, MeshletData& output, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	output = MeshletData();
+	const size_t triangleCount = mesh.indices.size() / 3;
+	if (triangleCount == 0 || maxVertices < 3 || maxVertices > 255 || maxTriangles == 0)
+		return;
+
+	// Worst case every triangle gets its own three vertices
+	output.meshlets.reserve(triangleCount / maxTriangles + 1);
+	output.vertexIndices.reserve(triangleCount * 3 / 2);
+	output.primitiveIndices.reserve(triangleCount * 3);
+
+	// Local index of every mesh vertex in the meshlet being built. Only the vertices of the current meshlet
+	// are ever set, so resetting them when the meshlet is closed keeps this linear
+	std::vector<uint8_t> localIndex(mesh.vertices.size(), NotInMeshlet);
+
+	Meshlet current = {};
+	auto closeMeshlet = [&]()
+	{
+		if (current.triangleCount == 0)
+			return;
+		for (uint32_t i = 0; i < current.vertexCount; i++)
+			localIndex[output.vertexIndices[current.vertexOffset + i]] = NotInMeshlet;
+		output.meshlets.push_back(current);
+		current.vertexOffset = static_cast<uint32_t>(output.vertexIndices.size());
+		current.triangleOffset = static_cast<uint32_t>(output.primitiveIndices.size() / 3);
+		current.vertexCount = 0;
+		current.triangleCount = 0;
+	};
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* triangle = &mesh.indices[t * 3];
+
+		uint32_t newVertices = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			bool duplicate = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+			if (localIndex[triangle[k]] == NotInMeshlet && !duplicate)
+				newVertices++;
+		}
+		if (current.vertexCount + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)
+			closeMeshlet();
+
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle[k];
+			if (localIndex[v] == NotInMeshlet)
+			{
+				localIndex[v] = static_cast<uint8_t>(current.vertexCount++);
+				output.vertexIndices.push_back(v);
+			}
+			output.primitiveIndices.push_back(localIndex[v]);
+		}
+		current.triangleCount++;
+	}
+	closeMeshlet();
+
+	output.bounds.resize(output.meshlets.size());
+	for (size_t i = 0; i < output.meshlets.size(); i++)
+		output.bounds[i] = ComputeBounds(mesh, output, output.meshlets[i]);
+}
+
+MeshletBounds MeshletBuilder::ComputeBounds(const MeshData& mesh, const MeshletData& output, const Meshlet& meshlet)
+{
+	MeshletBounds bounds = {};
+
+	// -- Bounding sphere, centred on the box around the vertices -- //
+	XMFLOAT3 minimum = mesh.vertices[output.vertexIndices[meshlet.vertexOffset]].pos;
+	XMFLOAT3 maximum = minimum;
+	for (uint32_t i = 1; i < meshlet.vertexCount; i++)
+	{
+		const XMFLOAT3& p = mesh.vertices[output.vertexIndices[meshlet.vertexOffset + i]].pos;
+		minimum = XMFLOAT3(fminf(minimum.x, p.x), fminf(minimum.y, p.y), fminf(minimum.z, p.z));
+		maximum = XMFLOAT3(fmaxf(maximum.x, p.x), fmaxf(maximum.y, p.y), fmaxf(maximum.z, p.z));
+	}
+	bounds.center = XMFLOAT3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f);
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+	{
+		const XMFLOAT3& p = mesh.vertices[output.vertexIndices[meshlet.vertexOffset + i]].pos;
+		bounds.radius = fmaxf(bounds.radius, Length(Subtract(p, bounds.center)));
+	}
+
+	// -- Normal cone from the face normals, culling is about where the triangles face, not the shading normals -- //
+	std::vector<XMFLOAT3> normals;
+	normals.reserve(meshlet.triangleCount);
+	XMFLOAT3 axis(0.0f, 0.0f, 0.0f);
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+	{
+		const uint8_t* triangle = &output.primitiveIndices[(meshlet.triangleOffset + t) * 3];
+		const XMFLOAT3& a = mesh.vertices[output.vertexIndices[meshlet.vertexOffset + triangle[0]]].pos;
+		const XMFLOAT3& b = mesh.vertices[output.vertexIndices[meshlet.vertexOffset + triangle[1]]].pos;
+		const XMFLOAT3& c = mesh.vertices[output.vertexIndices[meshlet.vertexOffset + triangle[2]]].pos;
+		XMFLOAT3 normal = Cross(Subtract(b, a), Subtract(c, a));
+		float length = Length(normal);
+		if (length <= 0.0f)
+			continue; // Degenerate triangles have no facing
+		normal = XMFLOAT3(normal.x / length, normal.y / length, normal.z / length);
+		normals.push_back(normal);
+		axis = XMFLOAT3(axis.x + normal.x, axis.y + normal.y, axis.z + normal.z);
+	}
+
+	float axisLength = Length(axis);
+	if (normals.empty() || axisLength <= 0.0f)
+	{
+		bounds.coneAxis = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		bounds.coneCutoff = 1.0f;
+		return bounds;
+	}
+	bounds.coneAxis = XMFLOAT3(axis.x / axisLength, axis.y / axisLength, axis.z / axisLength);
+
+	float minimumDot = 1.0f;
+	for (const XMFLOAT3& normal : normals)
+		minimumDot = fminf(minimumDot, Dot(normal, bounds.coneAxis));
+
+	// Cones of 90 degrees or wider have a triangle facing every direction
+	bounds.coneCutoff = minimumDot <= 0.0f ? 1.0f : sqrtf(1.0f - minimumDot * minimumDot);
+	return bounds;
+}
+
+bool MeshletBuilder::Validate(const MeshData& mesh, const MeshletData& meshlets, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	if (meshlets.bounds.size() != meshlets.meshlets.size())
+		return false;
+
+	size_t nextTriangle = 0;
+	for (const Meshlet& meshlet : meshlets.meshlets)
+	{
+		if (meshlet.vertexCount > maxVertices || meshlet.triangleCount > maxTriangles || meshlet.triangleCount == 0)
+			return false;
+		if (static_cast<size_t>(meshlet.vertexOffset) + meshlet.vertexCount > meshlets.vertexIndices.size() ||
+			(static_cast<size_t>(meshlet.triangleOffset) + meshlet.triangleCount) * 3 > meshlets.primitiveIndices.size())
+			return false;
+		if (meshlet.triangleOffset != nextTriangle)
+			return false;
+
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint8_t local = meshlets.primitiveIndices[(meshlet.triangleOffset + t) * 3 + k];
+				if (local >= meshlet.vertexCount)
+					return false;
+				uint32_t v = meshlets.vertexIndices[meshlet.vertexOffset + local];
+				if ((nextTriangle + t) * 3 + k >= mesh.indices.size() || v != mesh.indices[(nextTriangle + t) * 3 + k])
+					return false;
+			}
+		}
+		nextTriangle += meshlet.triangleCount;
+	}
+	return nextTriangle == mesh.indices.size() / 3;
+}
+
+MeshletBuilder::Statistics MeshletBuilder::Analyze(const MeshData& mesh, const MeshletData& meshlets, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	Statistics statistics;
+	statistics.meshletCount = static_cast<uint32_t>(meshlets.meshlets.size());
+	if (statistics.meshletCount == 0)
+		return statistics;
+
+	uint64_t vertices = 0;
+	uint64_t triangles = 0;
+	for (const Meshlet& meshlet : meshlets.meshlets)
+	{
+		vertices += meshlet.vertexCount;
+		triangles += meshlet.triangleCount;
+	}
+	statistics.triangleCount = static_cast<uint32_t>(triangles);
+	statistics.vertexFill = static_cast<float>(vertices) / (statistics.meshletCount * static_cast<float>(maxVertices));
+	statistics.triangleFill = static_cast<float>(triangles) / (statistics.meshletCount * static_cast<float>(maxTriangles));
+	statistics.vertexDuplication = mesh.vertices.empty() ? 0.0f : static_cast<float>(vertices) / mesh.vertices.size();
+
+	uint32_t cullable = 0;
+	double angleSum = 0.0;
+	for (const MeshletBounds& bounds : meshlets.bounds)
+	{
+		if (bounds.coneCutoff >= 1.0f)
+			continue;
+		cullable++;
+		angleSum += asin(bounds.coneCutoff) * 180.0 / 3.14159265358979;
+	}
+	statistics.cullableMeshlets = static_cast<float>(cullable) / statistics.meshletCount;
+	statistics.averageConeAngle = cullable > 0 ? static_cast<float>(angleSum / cullable) : 0.0f;
+	return statistics;
+}
+
+bool MeshletBuilder::IsBackfacing(const MeshletBounds& bounds, const XMFLOAT3& cameraPosition)
+{
+	// Conservative cone test against the bounding sphere, only culls when no normal in the cone can point at the camera
+	XMFLOAT3 toCenter = Subtract(bounds.center, cameraPosition);
+	return Dot(toCenter, bounds.coneAxis) >= bounds.coneCutoff * Length(toCenter) + bounds.radius;
+}
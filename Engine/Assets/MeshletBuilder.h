@@ -0,0 +1,62 @@
+#pragma once
+#include "MeshData.h"
+
+// Splits a triangle list into small clusters (meshlets) for cluster culling and, later, mesh shaders.
+// Each meshlet owns a list of unique vertices and a list of triangles that index into that list with 8 bit
+// local indices, the same layout D3D12 mesh shader samples use.
+
+struct Meshlet
+{
+	uint32_t vertexOffset; // First entry in MeshletData::vertexIndices
+	uint32_t triangleOffset; // First triangle in MeshletData::primitiveIndices, in triangles
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+};
+
+struct MeshletBounds
+{
+	DirectX::XMFLOAT3 center;
+	float radius;
+	DirectX::XMFLOAT3 coneAxis; // Average facing of the triangles
+	float coneCutoff; // Sine of the normal cone's half angle, 1 when the cone is too wide to ever cull
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds; // One per meshlet
+	std::vector<uint32_t> vertexIndices; // Into MeshData::vertices
+	std::vector<uint8_t> primitiveIndices; // Three per triangle, into the meshlet's slice of vertexIndices
+};
+
+class MeshletBuilder
+{
+public:
+	static const uint32_t MaxVertices = 64;
+	static const uint32_t MaxTriangles = 124;
+
+	struct Statistics
+	{
+		uint32_t meshletCount = 0;
+		uint32_t triangleCount = 0;
+		float vertexFill = 0.0f; // Average vertices per meshlet over maxVertices
+		float triangleFill = 0.0f; // Average triangles per meshlet over maxTriangles
+		float averageConeAngle = 0.0f; // Degrees, over meshlets whose cone can cull
+		float cullableMeshlets = 0.0f; // Fraction of meshlets whose cone is narrower than 90 degrees
+		float vertexDuplication = 0.0f; // Meshlet vertices over unique mesh vertices, shared border vertices count more than once
+	};
+
+	// Walks the triangles in order and starts a new meshlet when the next triangle would not fit. Run the
+	// vertex cache optimizer first (the importer does) so neighbouring triangles end up in the same meshlet
+	static void Build(const MeshData& mesh, MeshletData& output, uint32_t maxVertices = MaxVertices, uint32_t maxTriangles = MaxTriangles);
+
+	// Checks the limits, the index ranges and that every triangle of the mesh appears exactly once, in order
+	static bool Validate(const MeshData& mesh, const MeshletData& meshlets, uint32_t maxVertices = MaxVertices, uint32_t maxTriangles = MaxTriangles);
+	static Statistics Analyze(const MeshData& mesh, const MeshletData& meshlets, uint32_t maxVertices = MaxVertices, uint32_t maxTriangles = MaxTriangles);
+
+	// True if every triangle in the meshlet faces away from a camera at cameraPosition (model space)
+	static bool IsBackfacing(const MeshletBounds& bounds, const DirectX::XMFLOAT3& cameraPosition);
+
+private:
+	static MeshletBounds ComputeBounds(const MeshData& mesh, const MeshletData& output, const Meshlet& meshlet);
+};
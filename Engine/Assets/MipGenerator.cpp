@@ -0,0 +1,635 @@
+#include "MipGenerator.h"
+#include "../StringHelper.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	bool simdEnabled = true;
+
+	const uint32_t RowsPerBand = 32;
+	const double Pi = 3.14159265358979323846;
+
+	// Kaiser window parameters, the ones NVIDIA Texture Tools uses
+	const double KaiserWidth = 3.0;
+	const double KaiserAlpha = 4.0;
+
+	float SrgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// 8 bit code to float, the first 256 entries for linear channels and the next 256 for sRGB ones
+	const float* GetUnormToFloatTable()
+	{
+		static const std::vector<float> table = []()
+		{
+			std::vector<float> values(512);
+			for (int i = 0; i < 256; i++)
+			{
+				values[i] = i / 255.0f;
+				values[256 + i] = SrgbToLinear(i / 255.0f);
+			}
+			return values;
+		}();
+		return table.data();
+	}
+
+	// Indexed by the linear value in 16 bits, fine enough that the result is the correctly rounded 8 bit code even in
+	// the steep part of the curve near black
+	const uint8_t* GetLinearToSrgbTable()
+	{
+		static const std::vector<uint8_t> table = []()
+		{
+			std::vector<uint8_t> values(65536);
+			for (int i = 0; i < 65536; i++)
+				values[i] = static_cast<uint8_t>(LinearToSrgb(i / 65535.0f) * 255.0f + 0.5f);
+			return values;
+		}();
+		return table.data();
+	}
+
+	double Sinc(double x)
+	{
+		x *= Pi;
+		return std::fabs(x) < 1e-9 ? 1.0 : std::sin(x) / x;
+	}
+
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; k++)
+		{
+			double factor = x / (2.0 * k);
+			term *= factor * factor;
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	// Half width of the filter, in destination texels
+	double GetSupport(MipFilter filter)
+	{
+		switch (filter)
+		{
+		case MipFilter::Kaiser: return KaiserWidth;
+		case MipFilter::Lanczos: return 3.0;
+		default: return 0.5;
+		}
+	}
+
+	double EvaluateFilter(MipFilter filter, double x)
+	{
+		x = std::fabs(x);
+		if (filter == MipFilter::Kaiser)
+		{
+			if (x >= KaiserWidth)
+				return 0.0;
+			double t = x / KaiserWidth;
+			return Sinc(x) * BesselI0(KaiserAlpha * std::sqrt(1.0 - t * t)) / BesselI0(KaiserAlpha);
+		}
+		return x < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0.0;
+	}
+
+	// Filter weights along one axis. Destination texel i reads taps source texels from first[i] on, indices before 0
+	// and past the end are mapped back by the edge mode. Every texel has the same number of taps, shorter filters are
+	// padded with zero weights so the inner loops have no special cases
+	struct Axis
+	{
+		uint32_t taps = 1;
+		std::vector<int> first;
+		std::vector<float> weights;
+
+		void Build(MipFilter filter, uint32_t sourceSize, uint32_t destinationSize)
+		{
+			this->first.resize(destinationSize);
+			if (sourceSize == destinationSize)
+			{
+				// An axis that is already 1 texel wide while the other one still shrinks
+				this->taps = 1;
+				this->weights.assign(destinationSize, 1.0f);
+				for (uint32_t i = 0; i < destinationSize; i++)
+					this->first[i] = static_cast<int>(i);
+				return;
+			}
+
+			const double scale = static_cast<double>(sourceSize) / destinationSize;
+			const double radius = GetSupport(filter) * scale;
+			std::vector<std::vector<double>> texelWeights(destinationSize);
+			this->taps = 0;
+			for (uint32_t i = 0; i < destinationSize; i++)
+			{
+				const double center = (i + 0.5) * scale;
+				const int low = static_cast<int>(std::floor(center - radius));
+				const int high = static_cast<int>(std::ceil(center + radius));
+				std::vector<double>& weights = texelWeights[i];
+				double sum = 0.0;
+				for (int j = low; j < high; j++)
+				{
+					// The box filter takes the area of each source texel it covers, which handles odd sizes where a
+					// destination texel covers a texel and a half of the level above
+					double weight = filter == MipFilter::Box ?
+						std::max(0.0, std::min(j + 1.0, center + radius) - std::max(static_cast<double>(j), center - radius)) :
+						EvaluateFilter(filter, (j + 0.5 - center) / scale);
+					weights.push_back(weight);
+					sum += weight;
+				}
+				for (double& weight : weights)
+					weight /= sum;
+				this->first[i] = low;
+				this->taps = std::max(this->taps, static_cast<uint32_t>(weights.size()));
+			}
+
+			this->weights.assign(static_cast<size_t>(destinationSize) * this->taps, 0.0f);
+			for (uint32_t i = 0; i < destinationSize; i++)
+			{
+				for (size_t t = 0; t < texelWeights[i].size(); t++)
+					this->weights[i * this->taps + t] = static_cast<float>(texelWeights[i][t]);
+			}
+		}
+	};
+
+	int MapIndex(int index, int size, bool wrap)
+	{
+		if (wrap)
+			return ((index % size) + size) % size;
+		return std::min(std::max(index, 0), size - 1);
+	}
+
+	// Level being read, either the image itself or the linear float copy of the level above
+	struct Source
+	{
+		const ImageData* image = nullptr; // Top level
+		const float* linear = nullptr;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		int channels = 0;
+		bool sRGB = false;
+		int coverageChannel = -1;
+
+		bool IsSrgbChannel(int channel) const { return this->sRGB && channel < 3 && channel != this->coverageChannel; }
+
+		// Row y as linear floats, in scratch unless the level is float already
+		const float* GetRow(uint32_t y, float* scratch) const
+		{
+			const size_t count = static_cast<size_t>(this->width) * this->channels;
+			if (this->linear != nullptr)
+				return this->linear + y * count;
+
+			const uint8_t* row = this->image->pixels.data() + static_cast<size_t>(y) * this->image->description.rowPitch;
+			const PixelFormat format = this->image->description.format;
+			const int channels = this->channels;
+			if (format == PixelFormat::R8G8B8A8_UNORM || format == PixelFormat::R8_UNORM)
+			{
+				const float* tables[4];
+				for (int c = 0; c < channels; c++)
+					tables[c] = GetUnormToFloatTable() + (IsSrgbChannel(c) ? 256 : 0);
+				if (channels == 1)
+				{
+					for (size_t i = 0; i < count; i++)
+						scratch[i] = tables[0][row[i]];
+					return scratch;
+				}
+				for (size_t i = 0; i < count; i += 4)
+				{
+					scratch[i] = tables[0][row[i]];
+					scratch[i + 1] = tables[1][row[i + 1]];
+					scratch[i + 2] = tables[2][row[i + 2]];
+					scratch[i + 3] = tables[3][row[i + 3]];
+				}
+				return scratch;
+			}
+			for (size_t i = 0; i < count; i += channels)
+			{
+				for (int c = 0; c < channels; c++)
+				{
+					float value = static_cast<uint16_t>(row[(i + c) * 2] | row[(i + c) * 2 + 1] << 8) * (1.0f / 65535.0f);
+					scratch[i + c] = IsSrgbChannel(c) ? SrgbToLinear(value) : value;
+				}
+			}
+			return scratch;
+		}
+	};
+
+	// Taps that reach past the edges of the row read from edge, gathered through the edge mode
+	void FilterRowHorizontally(const float* row, uint32_t sourceWidth, bool wrap, const Axis& axis, int channels, uint32_t width, float* edge, float* output)
+	{
+		const uint32_t taps = axis.taps;
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const float* weights = axis.weights.data() + static_cast<size_t>(x) * taps;
+			const int first = axis.first[x];
+			const float* samples = row + static_cast<ptrdiff_t>(first) * channels;
+			if (first < 0 || first + static_cast<int>(taps) > static_cast<int>(sourceWidth))
+			{
+				for (uint32_t t = 0; t < taps; t++)
+					memcpy(edge + t * channels, row + static_cast<size_t>(MapIndex(first + static_cast<int>(t), static_cast<int>(sourceWidth), wrap)) * channels, channels * sizeof(float));
+				samples = edge;
+			}
+
+			uint32_t t = 0;
+#ifdef MIP_GENERATOR_SSE2
+			if (simdEnabled && channels == 4)
+			{
+				// Two sums so consecutive taps do not wait on each other
+				__m128 even = _mm_setzero_ps();
+				__m128 odd = _mm_setzero_ps();
+				for (; t + 2 <= taps; t += 2)
+				{
+					even = _mm_add_ps(even, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(samples + t * 4)));
+					odd = _mm_add_ps(odd, _mm_mul_ps(_mm_set1_ps(weights[t + 1]), _mm_loadu_ps(samples + t * 4 + 4)));
+				}
+				if (t < taps)
+					even = _mm_add_ps(even, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(samples + t * 4)));
+				_mm_storeu_ps(output + x * 4, _mm_add_ps(even, odd));
+				continue;
+			}
+			if (simdEnabled && channels == 1)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (; t + 4 <= taps; t += 4)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(weights + t), _mm_loadu_ps(samples + t)));
+				float lanes[4];
+				_mm_storeu_ps(lanes, sum);
+				float total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+				for (; t < taps; t++)
+					total += weights[t] * samples[t];
+				output[x] = total;
+				continue;
+			}
+#endif
+			for (int c = 0; c < channels; c++)
+			{
+				float total = 0.0f;
+				for (t = 0; t < taps; t++)
+					total += weights[t] * samples[t * channels + c];
+				output[x * channels + c] = total;
+			}
+		}
+	}
+
+	void FilterRowVertically(const float* const* rows, const float* weights, uint32_t taps, size_t count, float* output)
+	{
+		size_t i = 0;
+#ifdef MIP_GENERATOR_SSE2
+		if (simdEnabled)
+		{
+			// Sixteen floats at a time, four independent sums keep the adds from waiting on each other
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128 sums[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+				for (uint32_t t = 0; t < taps; t++)
+				{
+					const __m128 weight = _mm_set1_ps(weights[t]);
+					const float* source = rows[t] + i;
+					for (int k = 0; k < 4; k++)
+						sums[k] = _mm_add_ps(sums[k], _mm_mul_ps(weight, _mm_loadu_ps(source + k * 4)));
+				}
+				for (int k = 0; k < 4; k++)
+					_mm_storeu_ps(output + i + k * 4, sums[k]);
+			}
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t t = 0; t < taps; t++)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(rows[t] + i)));
+				_mm_storeu_ps(output + i, sum);
+			}
+		}
+#endif
+		for (; i < count; i++)
+		{
+			float total = 0.0f;
+			for (uint32_t t = 0; t < taps; t++)
+				total += weights[t] * rows[t][i];
+			output[i] = total;
+		}
+	}
+
+	// Filters rows first to last of the destination level
+	void FilterBand(const Source& source, const Axis& horizontal, const Axis& vertical, bool wrap, uint32_t width, uint32_t first, uint32_t last, float* destination)
+	{
+		const int channels = source.channels;
+		const size_t rowLength = static_cast<size_t>(width) * channels;
+
+		// Source rows the band reads, before the edge mode maps them into the image
+		const int sourceFirst = vertical.first[first];
+		const int sourceLast = vertical.first[last - 1] + static_cast<int>(vertical.taps);
+		std::vector<float> filtered(static_cast<size_t>(sourceLast - sourceFirst) * rowLength);
+
+		std::vector<float> scratch(static_cast<size_t>(source.width) * channels);
+		std::vector<float> edge(static_cast<size_t>(horizontal.taps) * channels);
+		for (int y = sourceFirst; y < sourceLast; y++)
+		{
+			const float* row = source.GetRow(static_cast<uint32_t>(MapIndex(y, static_cast<int>(source.height), wrap)), scratch.data());
+			FilterRowHorizontally(row, source.width, wrap, horizontal, channels, width, edge.data(), filtered.data() + (y - sourceFirst) * rowLength);
+		}
+
+		std::vector<const float*> rows(vertical.taps);
+		for (uint32_t y = first; y < last; y++)
+		{
+			for (uint32_t t = 0; t < vertical.taps; t++)
+				rows[t] = filtered.data() + (vertical.first[y] + t - sourceFirst) * rowLength;
+			FilterRowVertically(rows.data(), vertical.weights.data() + static_cast<size_t>(y) * vertical.taps, vertical.taps, rowLength, destination + y * rowLength);
+		}
+	}
+
+	// Scale for the coverage channel that makes the fraction of texels above reference come out as coverage
+	float FindCoverageScale(const float* level, size_t texels, int channels, int channel, float coverage, float reference)
+	{
+		std::vector<float> values(texels);
+		for (size_t i = 0; i < texels; i++)
+			values[i] = level[i * channels + channel];
+		const size_t target = static_cast<size_t>(coverage * texels + 0.5f);
+
+		// Any threshold from the value just below the target count to the one at it lets exactly target texels
+		// through, the scale moves the threshold there by as little as possible
+		auto descending = [](float a, float b) { return a > b; };
+		float high = std::numeric_limits<float>::max();
+		float low = 0.0f;
+		if (target > 0)
+		{
+			std::nth_element(values.begin(), values.begin() + (target - 1), values.end(), descending);
+			high = values[target - 1];
+		}
+		if (target < texels)
+		{
+			std::nth_element(values.begin(), values.begin() + target, values.end(), descending);
+			low = values[target];
+		}
+		if (high <= 0.0f)
+			return 1.0f;
+		if (reference < low)
+			return reference / low;
+		if (reference >= high)
+			return reference / (high * 0.9999f);
+		return 1.0f;
+	}
+
+	// Writes a float level in the image format
+	void StoreRows(const float* level, uint32_t width, uint32_t first, uint32_t last, const Source& format, PixelFormat pixelFormat, float coverageScale, uint8_t* output, size_t rowPitch)
+	{
+		const int channels = format.channels;
+		const size_t count = static_cast<size_t>(width) * channels;
+		const uint8_t* linearToSrgb = GetLinearToSrgbTable();
+		const bool wide = pixelFormat == PixelFormat::R16G16B16A16_UNORM || pixelFormat == PixelFormat::R16_UNORM;
+		float scales[4];
+		bool sRGB[4];
+		for (int c = 0; c < channels; c++)
+		{
+			scales[c] = c == format.coverageChannel ? coverageScale : 1.0f;
+			sRGB[c] = format.IsSrgbChannel(c);
+		}
+
+		for (uint32_t y = first; y < last; y++)
+		{
+			const float* row = level + y * count;
+			uint8_t* out = output + y * rowPitch;
+			for (size_t i = 0; i < count; i += channels)
+			{
+				for (int c = 0; c < channels; c++)
+				{
+					float value = row[i + c] * scales[c];
+					value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+					if (wide)
+					{
+						uint16_t encoded = static_cast<uint16_t>((sRGB[c] ? LinearToSrgb(value) : value) * 65535.0f + 0.5f);
+						out[(i + c) * 2] = static_cast<uint8_t>(encoded);
+						out[(i + c) * 2 + 1] = static_cast<uint8_t>(encoded >> 8);
+					}
+					else
+					{
+						out[i + c] = sRGB[c] ? linearToSrgb[static_cast<int>(value * 65535.0f + 0.5f)] : static_cast<uint8_t>(value * 255.0f + 0.5f);
+					}
+				}
+			}
+		}
+	}
+
+	int GetChannelCount(PixelFormat format)
+	{
+		switch (format)
+		{
+		case PixelFormat::R8G8B8A8_UNORM:
+		case PixelFormat::R16G16B16A16_UNORM:
+			return 4;
+		case PixelFormat::R8_UNORM:
+		case PixelFormat::R16_UNORM:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	// Filters source down to width x height into level, as linear floats, and stores it at output in format. Both
+	// passes run in bands of rows on the pool
+	void ResampleLevel(const Source& source, const MipSettings& settings, float coverage, uint32_t width, uint32_t height, PixelFormat format,
+		ThreadPool& pool, std::vector<float>& level, uint8_t* output, size_t rowPitch)
+	{
+		Axis horizontal;
+		Axis vertical;
+		horizontal.Build(settings.filter, source.width, width);
+		vertical.Build(settings.filter, source.height, height);
+
+		level.resize(static_cast<size_t>(width) * height * source.channels);
+		const uint32_t bands = (height + RowsPerBand - 1) / RowsPerBand;
+		pool.ParallelFor(bands, [&](size_t band)
+		{
+			const uint32_t first = static_cast<uint32_t>(band) * RowsPerBand;
+			FilterBand(source, horizontal, vertical, settings.wrap, width, first, std::min(first + RowsPerBand, height), level.data());
+		});
+
+		// The scale only goes into the stored level, the next level is filtered from the unscaled values
+		float coverageScale = 1.0f;
+		if (settings.coverageChannel >= 0)
+			coverageScale = FindCoverageScale(level.data(), static_cast<size_t>(width) * height, source.channels, settings.coverageChannel, coverage, settings.coverageReference);
+
+		pool.ParallelFor(bands, [&](size_t band)
+		{
+			const uint32_t first = static_cast<uint32_t>(band) * RowsPerBand;
+			StoreRows(level.data(), width, first, std::min(first + RowsPerBand, height), source, format, coverageScale, output, rowPitch);
+		});
+	}
+}
+
+bool MipGenerator::Generate(ImageData& image, const MipSettings& settings, ThreadPool& pool)
+{
+	ImageDescription& description = image.description;
+	const int channels = GetChannelCount(description.format);
+	if (channels == 0 || description.mipLevels != 1 || description.depthOrArraySize != 1 || description.width == 0 || description.height == 0 ||
+		image.pixels.size() < description.GetLevelSize(0) || settings.coverageChannel >= channels)
+		return false;
+
+	uint32_t levels = GetLevelCount(description.width, description.height);
+	if (settings.maxLevels > 0)
+		levels = std::min(levels, settings.maxLevels);
+	if (levels == 1)
+		return true;
+
+	const float coverage = settings.coverageChannel >= 0 ? MeasureCoverage(image, 0, settings.coverageChannel, settings.coverageReference) : 0.0f;
+	description.mipLevels = static_cast<uint16_t>(levels);
+	image.pixels.resize(description.GetSize());
+
+	Source source;
+	source.image = &image;
+	source.width = description.width;
+	source.height = description.height;
+	source.channels = channels;
+	source.sRGB = settings.sRGB;
+	source.coverageChannel = settings.coverageChannel;
+
+	std::vector<float> previous;
+	std::vector<float> current;
+	for (uint32_t level = 1; level < levels; level++)
+	{
+		const uint32_t width = description.GetLevelWidth(level);
+		const uint32_t height = description.GetLevelHeight(level);
+		ResampleLevel(source, settings, coverage, width, height, description.format, pool, current,
+			image.pixels.data() + description.GetLevelOffset(level), description.GetLevelRowPitch(level));
+
+		previous.swap(current);
+		source.linear = previous.data();
+		source.width = width;
+		source.height = height;
+	}
+	return true;
+}
+
+bool MipGenerator::Generate(ImageData& image, const MipSettings& settings)
+{
+	return Generate(image, settings, ThreadPool::GetShared());
+}
+
+bool MipGenerator::Downscale(ImageData& image, uint32_t levels, const MipSettings& settings, ThreadPool& pool)
+{
+	const ImageDescription& description = image.description;
+	const int channels = GetChannelCount(description.format);
+	if (channels == 0 || description.mipLevels != 1 || description.depthOrArraySize != 1 || description.width == 0 || description.height == 0 ||
+		image.pixels.size() < description.GetLevelSize(0) || settings.coverageChannel >= channels || levels >= GetLevelCount(description.width, description.height))
+		return false;
+	if (levels == 0)
+		return true;
+
+	// Straight to the size of the level, one pass with a filter as much wider as the size drops instead of one pass
+	// per level in between
+	ImageData output;
+	output.description = description;
+	output.description.width = description.GetLevelWidth(levels);
+	output.description.height = description.GetLevelHeight(levels);
+	output.description.rowPitch = output.description.width * ImageDescription::GetBytesPerPixel(description.format);
+	output.pixels.resize(output.description.GetSize());
+
+	Source source;
+	source.image = &image;
+	source.width = description.width;
+	source.height = description.height;
+	source.channels = channels;
+	source.sRGB = settings.sRGB;
+	source.coverageChannel = settings.coverageChannel;
+	const float coverage = settings.coverageChannel >= 0 ? MeasureCoverage(image, 0, settings.coverageChannel, settings.coverageReference) : 0.0f;
+
+	std::vector<float> level;
+	ResampleLevel(source, settings, coverage, output.description.width, output.description.height, description.format, pool, level,
+		output.pixels.data(), output.description.rowPitch);
+	image = std::move(output);
+	return true;
+}
+
+bool MipGenerator::Downscale(ImageData& image, uint32_t levels, const MipSettings& settings)
+{
+	return Downscale(image, levels, settings, ThreadPool::GetShared());
+}
+
+uint32_t MipGenerator::GetLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+		levels++;
+	return levels;
+}
+
+MipSettings MipGenerator::GetSettingsForFile(const std::string& filepath)
+{
+	const std::vector<std::string> words = StringHelper::GetFileNameWords(filepath);
+	static const char* const linearMaps[] = { "normal", "roughness", "gloss", "metalness", "metallic", "ao", "cavity", "bump", "displacement", "height" };
+	static const char* const coverageMaps[] = { "opacity", "mask" };
+	MipSettings settings;
+	settings.sRGB = true;
+	for (const std::string& word : words)
+	{
+		for (const char* name : linearMaps)
+		{
+			if (word == name)
+				settings.sRGB = false;
+		}
+		for (const char* name : coverageMaps)
+		{
+			if (word == name)
+			{
+				settings.sRGB = false;
+				settings.coverageChannel = 0;
+			}
+		}
+	}
+	return settings;
+}
+
+float MipGenerator::MeasureCoverage(const ImageData& image, uint32_t level, int channel, float reference)
+{
+	const ImageDescription& description = image.description;
+	const bool wide = description.format == PixelFormat::R16G16B16A16_UNORM || description.format == PixelFormat::R16_UNORM;
+	const int channels = description.format == PixelFormat::R8_UNORM || description.format == PixelFormat::R16_UNORM ? 1 : 4;
+	const uint32_t width = description.GetLevelWidth(level);
+	const uint32_t height = description.GetLevelHeight(level);
+	if (level >= description.mipLevels || channel < 0 || channel >= channels)
+		return 0.0f;
+
+	// Compared in the stored integer form, so the count matches what the sampler sees
+	const uint32_t maximum = wide ? 65535 : 255;
+	const uint32_t threshold = static_cast<uint32_t>(reference * maximum);
+	const uint8_t* pixels = image.pixels.data() + description.GetLevelOffset(level);
+	const size_t rowPitch = description.GetLevelRowPitch(level);
+	uint64_t above = 0;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		const uint8_t* row = pixels + y * rowPitch;
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const size_t index = static_cast<size_t>(x) * channels + channel;
+			uint32_t value = wide ? static_cast<uint32_t>(row[index * 2] | row[index * 2 + 1] << 8) : row[index];
+			above += value > threshold ? 1 : 0;
+		}
+	}
+	return static_cast<float>(static_cast<double>(above) / (static_cast<double>(width) * height));
+}
+
+bool MipGenerator::IsSimdAvailable()
+{
+#ifdef MIP_GENERATOR_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+void MipGenerator::SetSimdEnabled(bool enabled)
+{
+	simdEnabled = enabled;
+}
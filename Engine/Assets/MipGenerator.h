@@ -0,0 +1,55 @@
+#pragma once
+#include "ImageData.h"
+#include <string>
+
+class ThreadPool;
+
+enum class MipFilter
+{
+	Box, // 2x2 average, the fastest and the blurriest
+	Kaiser, // Kaiser windowed sinc, three levels wide. Sharp with little ringing, the default
+	Lanczos, // Lanczos-3, the sharpest, rings a little around hard edges
+};
+
+struct MipSettings
+{
+	MipFilter filter = MipFilter::Kaiser;
+	bool sRGB = false; // RGB holds sRGB encoded color, which is filtered in linear space and encoded again
+	bool wrap = false; // Tiling texture, the filter wraps around the edges instead of clamping to them
+	int coverageChannel = -1; // Channel used for alpha testing, every level keeps the fraction of it above coverageReference. -1 for none
+	float coverageReference = 0.5f;
+	uint32_t maxLevels = 0; // 0 for the full chain down to 1x1
+};
+
+// Builds the mip chain of an image on the CPU.
+//
+// Every level is filtered from the one above it, kept in linear float so rounding does not pile up from level to
+// level. The filter is separable, each band of rows of a level filters its source rows horizontally and then combines
+// them vertically. Bands run on the pool, both passes use SSE2.
+//
+// Plain filtering makes alpha tested cutouts such as foliage thin out and vanish in the distance, as the average of
+// opaque and clear texels drops below the test threshold. With coverageChannel set, the channel is scaled in every
+// level so the same fraction of texels passes the test as in the top level (Castano, "Computing Alpha Mipmaps")
+class MipGenerator
+{
+public:
+	// image has to hold a single level. Afterwards it holds the whole chain, description.mipLevels tells how many
+	static bool Generate(ImageData& image, const MipSettings& settings, ThreadPool& pool);
+	static bool Generate(ImageData& image, const MipSettings& settings);
+	// Replaces the single level of image with what would be its mip level `levels` down, filtered in one pass from the
+	// top level with the same filter, color space and coverage handling. maxLevels is ignored
+	static bool Downscale(ImageData& image, uint32_t levels, const MipSettings& settings, ThreadPool& pool);
+	static bool Downscale(ImageData& image, uint32_t levels, const MipSettings& settings);
+
+	static uint32_t GetLevelCount(uint32_t width, uint32_t height);
+
+	// Settings from the naming conventions of Megascans and most texture libraries: normal, roughness and other data
+	// maps are linear, opacity maps keep their coverage in the red channel, everything else is sRGB color
+	static MipSettings GetSettingsForFile(const std::string& filepath);
+
+	// Fraction of the texels of level whose channel is above reference
+	static float MeasureCoverage(const ImageData& image, uint32_t level, int channel, float reference);
+
+	static bool IsSimdAvailable();
+	static void SetSimdEnabled(bool enabled); // Benchmarking only, not thread safe
+};
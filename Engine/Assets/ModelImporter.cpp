@@ -0,0 +1,365 @@
+#include "ModelImporter.h"
+#include "VertexCacheOptimizer.h"
+#include "IndexCompaction.h"
+#include "ContentHash.h"
+#include "DerivedDataCache.h"
+#include "PakArchive.h"
+#include "../FileHelper.h"
+#include "../StringHelper.h"
+#include "../ThreadPool.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	class BlobWriter
+	{
+	public:
+		explicit BlobWriter(std::vector<uint8_t>& data) : data(data) {}
+
+		void Write(const void* bytes, size_t size)
+		{
+			const uint8_t* begin = static_cast<const uint8_t*>(bytes);
+			this->data.insert(this->data.end(), begin, begin + size);
+		}
+
+		void WriteUInt(uint32_t value) { Write(&value, sizeof(value)); }
+
+		void WriteString(const std::string& text)
+		{
+			WriteUInt(static_cast<uint32_t>(text.size()));
+			Write(text.data(), text.size());
+		}
+
+		template<class T>
+		void WriteArray(const std::vector<T>& values)
+		{
+			WriteUInt(static_cast<uint32_t>(values.size()));
+			Write(values.data(), values.size() * sizeof(T));
+		}
+
+	private:
+		std::vector<uint8_t>& data;
+	};
+
+	// Every read is bounds checked, a payload that passed the cache's hash check but was written by a buggy build
+	// must still not crash the importer
+	class BlobReader
+	{
+	public:
+		explicit BlobReader(const std::vector<uint8_t>& data) : data(data) {}
+
+		bool Read(void* bytes, size_t size)
+		{
+			if (size > this->data.size() - this->offset)
+				return false;
+			if (size > 0)
+				memcpy(bytes, this->data.data() + this->offset, size);
+			this->offset += size;
+			return true;
+		}
+
+		bool ReadUInt(uint32_t& value) { return Read(&value, sizeof(value)); }
+
+		bool ReadString(std::string& text)
+		{
+			uint32_t size;
+			if (!ReadUInt(size) || size > this->data.size() - this->offset)
+				return false;
+			text.assign(reinterpret_cast<const char*>(this->data.data() + this->offset), size);
+			this->offset += size;
+			return true;
+		}
+
+		template<class T>
+		bool ReadArray(std::vector<T>& values)
+		{
+			uint32_t count;
+			if (!ReadUInt(count) || count > (this->data.size() - this->offset) / sizeof(T))
+				return false;
+			values.resize(count);
+			return Read(values.data(), count * sizeof(T));
+		}
+
+		bool IsAtEnd() const { return this->offset == this->data.size(); }
+
+	private:
+		const std::vector<uint8_t>& data;
+		size_t offset = 0;
+	};
+}
+
+std::string ImportOptions::GetKey() const
+{
+	// Include the Assimp flags and the importer version too, changing them changes what every mesh looks like and
+	// cooked files have to be cooked again
+	char key[192];
+	snprintf(key, sizeof(key), "i%u a%x w%d:%d:%g:%g:%g t%d v%d l%u:%g:%g s%d", ModelImporter::Version, ModelImporter::ImportFlags,
+		this->weldVertices ? 1 : 0, static_cast<int>(this->weld.mode), this->weld.positionEpsilon, this->weld.texCoordEpsilon, this->weld.normalEpsilon,
+		this->generateTangents ? 1 : 0, this->optimizeVertexCache ? 1 : 0, this->lods.lodCount, this->lods.triangleRatio, this->lods.maxError,
+		this->splitFor16BitIndices ? 1 : 0);
+	return key;
+}
+
+ImportOptions ImportOptions::GetEngineDefaults()
+{
+	ImportOptions options;
+	options.lods.lodCount = 3;
+	// Every index buffer can be 16 bit then. Only meshes over the limit are split, and only those lose their LODs
+	options.splitFor16BitIndices = true;
+	return options;
+}
+
+bool ModelImporter::Import(const std::string& filepath, ModelData& model, const ImportOptions& options)
+{
+	return Import(filepath, model, options, ThreadPool::GetShared());
+}
+
+bool ModelImporter::Import(const std::string& filepath, ModelData& model, const ImportOptions& options, ThreadPool& pool)
+{
+	// Loose files win over the mounted archive, so edited assets and hot reload keep working with one mounted
+	PakArchive& archive = PakArchive::GetShared();
+	if (archive.IsOpen() && !FileHelper::FileExists(filepath))
+	{
+		std::vector<uint8_t> data;
+		return archive.Read(filepath, data, pool) && ImportFromMemory(data.data(), data.size(), StringHelper::GetFileExtension(filepath), model, options, pool);
+	}
+
+	// Keyed on the contents of the model file only. Formats that pull in other files (.obj and its .mtl) do not
+	// notice those changing, which only matters for the material names and texture paths
+	std::string cacheKey;
+	uint64_t sourceHash;
+	if (options.useDerivedDataCache && ContentHash::HashFile(filepath, sourceHash))
+	{
+		cacheKey = DerivedDataCache::MakeKey("model", Version, sourceHash, options.GetKey());
+		if (GetCached(cacheKey, model))
+			return true;
+	}
+
+	Assimp::Importer importer;
+	const aiScene* pScene = importer.ReadFile(filepath, ImportFlags);
+
+	if (pScene == nullptr)
+		return false;
+
+	ConvertScene(pScene, model, options, pool);
+	PutCached(cacheKey, model);
+	return true;
+}
+
+bool ModelImporter::ImportFromMemory(const void* data, size_t size, const std::string& extension, ModelData& model, const ImportOptions& options, ThreadPool& pool)
+{
+	std::string cacheKey;
+	if (options.useDerivedDataCache)
+	{
+		cacheKey = DerivedDataCache::MakeKey("model", Version, ContentHash::Hash64(data, size), options.GetKey());
+		if (GetCached(cacheKey, model))
+			return true;
+	}
+
+	// Formats that reference other files (.obj and its .mtl) only get what is in memory
+	Assimp::Importer importer;
+	const aiScene* pScene = importer.ReadFileFromMemory(data, size, ImportFlags, extension.c_str());
+	if (pScene == nullptr)
+		return false;
+
+	ConvertScene(pScene, model, options, pool);
+	PutCached(cacheKey, model);
+	return true;
+}
+
+void ModelImporter::ConvertScene(const aiScene* scene, ModelData& model, const ImportOptions& options, ThreadPool& pool)
+{
+	model.materials.resize(scene->mNumMaterials);
+	for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+		ProcessMaterial(scene->mMaterials[i], model.materials[i]);
+
+	// Walk the node tree once up front so every mesh can be converted independently. Each job
+	// writes to its own slot so the output order does not depend on which thread finishes first
+	std::vector<MeshJob> jobs;
+	FlattenNode(scene->mRootNode, XMMatrixIdentity(), jobs);
+
+	model.meshes.clear();
+	model.meshes.resize(jobs.size());
+	pool.ParallelFor(jobs.size(), [&](size_t i)
+	{
+		ProcessMesh(scene->mMeshes[jobs[i].meshIndex], jobs[i].transform, model.meshes[i]);
+		if (options.weldVertices)
+			VertexWelder::Weld(model.meshes[i], options.weld);
+		if (options.generateTangents)
+			TangentGenerator::Generate(model.meshes[i]);
+		if (options.optimizeVertexCache)
+			VertexCacheOptimizer::Optimize(model.meshes[i]);
+		if (options.lods.lodCount > 0)
+			MeshSimplifier::GenerateLods(model.meshes[i], options.lods);
+	});
+
+	// Splitting changes the mesh count, so it runs after every slot has been filled
+	if (options.splitFor16BitIndices)
+		IndexCompaction::SplitFor16BitIndices(model);
+}
+
+void ModelImporter::FlattenNode(aiNode* node, const XMMATRIX& parentTransformMatrix, std::vector<MeshJob>& jobs)
+{
+	XMMATRIX nodeTransformMatrix = XMMatrixTranspose(XMMATRIX(&node->mTransformation.a1)) * parentTransformMatrix;
+
+	for (unsigned int i = 0; i < node->mNumMeshes; i++)
+	{
+		MeshJob job;
+		job.meshIndex = node->mMeshes[i];
+		XMStoreFloat4x4(&job.transform, nodeTransformMatrix);
+		jobs.push_back(job);
+	}
+
+	for (unsigned int i = 0; i < node->mNumChildren; i++)
+	{
+		FlattenNode(node->mChildren[i], nodeTransformMatrix, jobs);
+	}
+}
+
+void ModelImporter::ProcessMesh(aiMesh* mesh, const XMFLOAT4X4& transform, MeshData& meshData)
+{
+	meshData.transform = transform;
+	meshData.materialIndex = mesh->mMaterialIndex;
+
+	// Get verticies
+	meshData.vertices.resize(mesh->mNumVertices);
+	if (mesh->HasNormals())
+		meshData.normals.resize(mesh->mNumVertices);
+	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+	{
+		Vertex3D& vertex = meshData.vertices[i];
+
+		vertex.pos.x = mesh->mVertices[i].x;
+		vertex.pos.y = mesh->mVertices[i].y;
+		vertex.pos.z = mesh->mVertices[i].z;
+
+		if (mesh->HasNormals())
+		{
+			// Not every exporter writes unit normals, the tangent generator and the welder's epsilon assume them
+			aiVector3D normal = mesh->mNormals[i];
+			float length = normal.Length();
+			if (length > 0.0f)
+				normal /= length;
+			meshData.normals[i] = XMFLOAT3(normal.x, normal.y, normal.z);
+		}
+
+		if (mesh->mTextureCoords[0])
+		{
+			vertex.textCoord.x = (float)mesh->mTextureCoords[0][i].x;
+			vertex.textCoord.y = (float)mesh->mTextureCoords[0][i].y;
+		}
+		else
+		{
+			vertex.textCoord = XMFLOAT2(0.0f, 0.0f);
+		}
+	}
+
+	// Get indices
+	meshData.indices.reserve(mesh->mNumFaces * 3);
+	for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+	{
+		const aiFace& face = mesh->mFaces[i];
+
+		for (unsigned int j = 0; j < face.mNumIndices; j++)
+			meshData.indices.push_back(face.mIndices[j]);
+	}
+}
+
+void ModelImporter::ProcessMaterial(aiMaterial* material, MaterialData& materialData)
+{
+	aiString name;
+	if (material->Get(AI_MATKEY_NAME, name) == AI_SUCCESS)
+		materialData.name = name.C_Str();
+
+	if (material->GetTextureCount(aiTextureType_DIFFUSE) > 0)
+	{
+		aiString path;
+		material->GetTexture(aiTextureType_DIFFUSE, 0, &path);
+		materialData.diffuseTexture = path.C_Str();
+	}
+}
+
+bool ModelImporter::GetCached(const std::string& cacheKey, ModelData& model)
+{
+	std::vector<uint8_t> data;
+	ModelData cached;
+	if (cacheKey.empty() || !DerivedDataCache::GetShared().Get(cacheKey, data) || !Deserialize(data, cached))
+		return false;
+	model = std::move(cached);
+	return true;
+}
+
+void ModelImporter::PutCached(const std::string& cacheKey, const ModelData& model)
+{
+	if (cacheKey.empty())
+		return;
+	std::vector<uint8_t> data;
+	Serialize(model, data);
+	DerivedDataCache::GetShared().Put(cacheKey, data);
+}
+
+void ModelImporter::Serialize(const ModelData& model, std::vector<uint8_t>& data)
+{
+	BlobWriter writer(data);
+	writer.WriteUInt(static_cast<uint32_t>(model.materials.size()));
+	for (const MaterialData& material : model.materials)
+	{
+		writer.WriteString(material.name);
+		writer.WriteString(material.diffuseTexture);
+	}
+
+	writer.WriteUInt(static_cast<uint32_t>(model.meshes.size()));
+	for (const MeshData& mesh : model.meshes)
+	{
+		writer.Write(&mesh.transform, sizeof(mesh.transform));
+		writer.WriteUInt(mesh.materialIndex);
+		writer.WriteArray(mesh.vertices);
+		writer.WriteArray(mesh.indices);
+		writer.WriteArray(mesh.normals);
+		writer.WriteArray(mesh.tangents);
+		writer.WriteUInt(static_cast<uint32_t>(mesh.lods.size()));
+		for (const MeshLod& lod : mesh.lods)
+		{
+			writer.Write(&lod.error, sizeof(lod.error));
+			writer.WriteArray(lod.indices);
+		}
+	}
+}
+
+bool ModelImporter::Deserialize(const std::vector<uint8_t>& data, ModelData& model)
+{
+	BlobReader reader(data);
+	uint32_t materialCount;
+	if (!reader.ReadUInt(materialCount) || materialCount > data.size())
+		return false;
+	model.materials.resize(materialCount);
+	for (MaterialData& material : model.materials)
+	{
+		if (!reader.ReadString(material.name) || !reader.ReadString(material.diffuseTexture))
+			return false;
+	}
+
+	uint32_t meshCount;
+	if (!reader.ReadUInt(meshCount) || meshCount > data.size())
+		return false;
+	model.meshes.clear();
+	model.meshes.resize(meshCount);
+	for (MeshData& mesh : model.meshes)
+	{
+		uint32_t lodCount;
+		if (!reader.Read(&mesh.transform, sizeof(mesh.transform)) || !reader.ReadUInt(mesh.materialIndex) ||
+			!reader.ReadArray(mesh.vertices) || !reader.ReadArray(mesh.indices) || !reader.ReadArray(mesh.normals) || !reader.ReadArray(mesh.tangents) ||
+			!reader.ReadUInt(lodCount) || lodCount > data.size())
+			return false;
+		mesh.lods.resize(lodCount);
+		for (MeshLod& lod : mesh.lods)
+		{
+			if (!reader.Read(&lod.error, sizeof(lod.error)) || !reader.ReadArray(lod.indices))
+				return false;
+		}
+	}
+	return reader.IsAtEnd();
+}
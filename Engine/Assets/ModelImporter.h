@@ -0,0 +1,71 @@
+#pragma once
+#include "MeshData.h"
+#include "VertexWelder.h"
+#include "MeshSimplifier.h"
+#include "TangentGenerator.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+class ThreadPool;
+
+// Processing passes run on every mesh after conversion
+struct ImportOptions
+{
+	bool weldVertices = true; // Runs before the cache optimizer so it sees the shared vertices
+	WeldSettings weld;
+	bool generateTangents = true; // Needs normals, runs after welding so the tangent sums see every triangle around a vertex
+	bool optimizeVertexCache = true; // Forsyth triangle order plus vertex fetch reorder, see VertexCacheOptimizer
+	LodSettings lods; // No LODs unless lods.lodCount is set. Runs after the cache optimizer, which renumbers the vertices
+	bool splitFor16BitIndices = false; // Splits meshes over 65536 vertices so every part can use a 16 bit index buffer. Split meshes lose their LODs
+	bool useDerivedDataCache = false; // Look the result up in the DerivedDataCache before importing, and store it after. Not part of the key
+
+	// Short string that differs whenever two sets of options could produce different output, used to key caches
+	std::string GetKey() const;
+
+	// What the engine draws models with, Model::GetImportOptions and Engine.exe -cook both start from these
+	static ImportOptions GetEngineDefaults();
+};
+
+// Turns a source model file (fbx, obj, ...) into ModelData using Assimp. Does not touch the device
+// so it can run headless from the asset tool as well as from Model::LoadModel
+class ModelImporter
+{
+public:
+	// GenSmoothNormals only fills in normals for meshes that come without any
+	static const unsigned int ImportFlags = aiProcess_Triangulate | aiProcess_ConvertToLeftHanded | aiProcess_GenSmoothNormals;
+	// Bump whenever a change to the importer or its passes changes the output, so DerivedDataCache entries written by
+	// older builds are not used anymore
+	static const uint32_t Version = 3;
+
+	// Converts the meshes on the shared thread pool
+	static bool Import(const std::string& filepath, ModelData& model, const ImportOptions& options = ImportOptions());
+	static bool Import(const std::string& filepath, ModelData& model, const ImportOptions& options, ThreadPool& pool);
+	// For a model file that is already in memory, a PakArchive entry for example. extension ("fbx", "obj") tells
+	// Assimp the format
+	static bool ImportFromMemory(const void* data, size_t size, const std::string& extension, ModelData& model, const ImportOptions& options, ThreadPool& pool);
+
+	// Second half of Import, exposed so the conversion can be timed without the Assimp parse
+	static void ConvertScene(const aiScene* scene, ModelData& model, const ImportOptions& options, ThreadPool& pool);
+
+private:
+	// One entry per mesh instance in the node tree, in the same depth first order the meshes end up in
+	struct MeshJob
+	{
+		unsigned int meshIndex;
+		DirectX::XMFLOAT4X4 transform;
+	};
+
+	static void FlattenNode(aiNode* node, const DirectX::XMMATRIX& parentTransformMatrix, std::vector<MeshJob>& jobs);
+	static void ProcessMesh(aiMesh* mesh, const DirectX::XMFLOAT4X4& transform, MeshData& meshData);
+	static void ProcessMaterial(aiMaterial* material, MaterialData& materialData);
+
+	// DerivedDataCache lookup and store, cacheKey is empty when the cache is not used
+	static bool GetCached(const std::string& cacheKey, ModelData& model);
+	static void PutCached(const std::string& cacheKey, const ModelData& model);
+
+	// DerivedDataCache payload
+	static void Serialize(const ModelData& model, std::vector<uint8_t>& data);
+	static bool Deserialize(const std::vector<uint8_t>& data, ModelData& model);
+};
@@ -0,0 +1,371 @@
+#include "PakArchive.h"
+#include "Lz4.h"
+#include "ContentHash.h"
+#include "../FileHelper.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+	const uint64_t TocAlignment = 8;
+
+	bool IsSkipped(const std::string& name)
+	{
+		// Files Explorer and Finder leave behind, and archives packed into the tree earlier
+		if (name == "Thumbs.db" || name == "desktop.ini" || name == ".DS_Store")
+			return true;
+		const std::string extension = std::string(".") + Pak::Extension;
+		return name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0;
+	}
+}
+
+std::string Pak::NormalizePath(const std::string& path)
+{
+	std::string normalized = path;
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+	while (normalized.compare(0, 2, "./") == 0)
+		normalized.erase(0, 2);
+	return normalized;
+}
+
+PakWriter::PakWriter(uint32_t chunkSize)
+	: chunkSize(chunkSize > 0 ? chunkSize : Pak::DefaultChunkSize)
+{
+}
+
+void PakWriter::Add(const std::string& path, std::vector<uint8_t> data)
+{
+	this->entries[Pak::NormalizePath(path)] = std::move(data);
+}
+
+bool PakWriter::AddFile(const std::string& path, const std::string& filepath)
+{
+	std::vector<uint8_t> data;
+	if (!FileHelper::ReadFile(filepath, data))
+		return false;
+	Add(path, std::move(data));
+	return true;
+}
+
+size_t PakWriter::AddDirectory(const std::string& directory)
+{
+	size_t added = 0;
+	for (const std::string& name : FileHelper::ListFiles(directory))
+	{
+		if (!IsSkipped(name) && AddFile(directory + "/" + name, directory + "/" + name))
+			added++;
+	}
+	for (const std::string& name : FileHelper::ListDirectories(directory))
+		added += AddDirectory(directory + "/" + name);
+	return added;
+}
+
+bool PakWriter::Write(const std::string& filepath)
+{
+	return Write(filepath, ThreadPool::GetShared());
+}
+
+bool PakWriter::Write(const std::string& filepath, ThreadPool& pool)
+{
+	struct Chunk
+	{
+		const uint8_t* source;
+		size_t size;
+		std::vector<uint8_t> compressed; // Empty if the chunk is stored
+	};
+
+	this->statistics = Statistics();
+	std::vector<PakEntryRecord> entryRecords;
+	std::vector<Chunk> chunks;
+	std::string paths;
+	for (const auto& entry : this->entries)
+	{
+		const std::vector<uint8_t>& data = entry.second;
+		PakEntryRecord record = {};
+		record.size = data.size();
+		record.hash = ContentHash::Hash64(data.data(), data.size());
+		record.firstChunk = static_cast<uint32_t>(chunks.size());
+		record.chunkCount = static_cast<uint32_t>((data.size() + this->chunkSize - 1) / this->chunkSize);
+		record.pathOffset = static_cast<uint32_t>(paths.size());
+		record.pathLength = static_cast<uint32_t>(entry.first.size());
+		entryRecords.push_back(record);
+		paths += entry.first;
+
+		for (size_t offset = 0; offset < data.size(); offset += this->chunkSize)
+		{
+			Chunk chunk;
+			chunk.source = data.data() + offset;
+			chunk.size = std::min<size_t>(this->chunkSize, data.size() - offset);
+			chunks.push_back(chunk);
+		}
+	}
+
+	pool.ParallelFor(chunks.size(), [&chunks](size_t i)
+	{
+		Chunk& chunk = chunks[i];
+		chunk.compressed.resize(Lz4::GetMaxCompressedSize(chunk.size));
+		chunk.compressed.resize(Lz4::Compress(chunk.source, chunk.size, chunk.compressed.data()));
+		if (chunk.compressed.size() >= chunk.size)
+			chunk.compressed.clear();
+	});
+
+	// Chunk data straight after the header, then the table of contents
+	std::vector<PakChunkRecord> chunkRecords(chunks.size());
+	uint64_t offset = sizeof(PakHeader);
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		bool stored = chunks[i].compressed.empty();
+		chunkRecords[i].offset = offset;
+		chunkRecords[i].compressedSize = static_cast<uint32_t>(stored ? chunks[i].size : chunks[i].compressed.size());
+		chunkRecords[i].compression = static_cast<uint32_t>(stored ? PakCompression::Stored : PakCompression::Lz4);
+		offset += chunkRecords[i].compressedSize;
+		this->statistics.storedChunks += stored ? 1 : 0;
+	}
+	const uint64_t tocOffset = (offset + TocAlignment - 1) & ~(TocAlignment - 1);
+	const size_t entriesSize = entryRecords.size() * sizeof(PakEntryRecord);
+	const size_t chunksSize = chunkRecords.size() * sizeof(PakChunkRecord);
+	const uint64_t tocSize = entriesSize + chunksSize + paths.size();
+
+	std::vector<uint8_t> file(static_cast<size_t>(tocOffset + tocSize), 0);
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		const uint8_t* data = chunks[i].compressed.empty() ? chunks[i].source : chunks[i].compressed.data();
+		memcpy(file.data() + chunkRecords[i].offset, data, chunkRecords[i].compressedSize);
+	}
+	uint8_t* toc = file.data() + tocOffset;
+	if (entriesSize > 0)
+		memcpy(toc, entryRecords.data(), entriesSize);
+	if (chunksSize > 0)
+		memcpy(toc + entriesSize, chunkRecords.data(), chunksSize);
+	if (!paths.empty())
+		memcpy(toc + entriesSize + chunksSize, paths.data(), paths.size());
+
+	PakHeader header = {};
+	header.magic = Pak::Magic;
+	header.version = Pak::Version;
+	header.endianTag = Pak::EndianTag;
+	header.chunkSize = this->chunkSize;
+	header.entryCount = static_cast<uint32_t>(entryRecords.size());
+	header.chunkCount = static_cast<uint32_t>(chunkRecords.size());
+	header.tocOffset = tocOffset;
+	header.tocSize = tocSize;
+	header.tocHash = ContentHash::Hash64(toc, static_cast<size_t>(tocSize));
+	header.fileSize = file.size();
+	memcpy(file.data(), &header, sizeof(header));
+
+	this->statistics.entries = header.entryCount;
+	this->statistics.chunks = header.chunkCount;
+	for (const PakEntryRecord& record : entryRecords)
+		this->statistics.uncompressedBytes += record.size;
+	this->statistics.compressedBytes = offset - sizeof(PakHeader);
+	this->statistics.fileSize = file.size();
+	return FileHelper::WriteFileAtomic(filepath, file.data(), file.size());
+}
+
+PakArchive& PakArchive::GetShared()
+{
+	static PakArchive archive;
+	return archive;
+}
+
+bool PakArchive::Open(const std::string& filepath)
+{
+	Close();
+	if (!this->file.Open(filepath) || this->file.Size() < sizeof(PakHeader))
+	{
+		Close();
+		return false;
+	}
+
+	this->header = reinterpret_cast<const PakHeader*>(this->file.Data());
+	if (!Validate())
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void PakArchive::Close()
+{
+	this->file.Close();
+	this->header = nullptr;
+	this->entries = nullptr;
+	this->chunks = nullptr;
+	this->paths = nullptr;
+	this->pathsSize = 0;
+}
+
+bool PakArchive::Validate()
+{
+	const PakHeader& h = *this->header;
+	const uint64_t fileSize = this->file.Size();
+	if (h.magic != Pak::Magic || h.version != Pak::Version || h.endianTag != Pak::EndianTag || h.chunkSize == 0 || h.fileSize != fileSize)
+		return false;
+	if (h.tocOffset < sizeof(PakHeader) || h.tocOffset % TocAlignment != 0 || h.tocOffset > fileSize || h.tocSize != fileSize - h.tocOffset)
+		return false;
+
+	const uint64_t recordsSize = static_cast<uint64_t>(h.entryCount) * sizeof(PakEntryRecord) + static_cast<uint64_t>(h.chunkCount) * sizeof(PakChunkRecord);
+	if (recordsSize > h.tocSize)
+		return false;
+	const uint8_t* toc = this->file.Data() + h.tocOffset;
+	if (ContentHash::Hash64(toc, static_cast<size_t>(h.tocSize)) != h.tocHash)
+		return false;
+
+	this->entries = reinterpret_cast<const PakEntryRecord*>(toc);
+	this->chunks = reinterpret_cast<const PakChunkRecord*>(toc + h.entryCount * sizeof(PakEntryRecord));
+	this->paths = reinterpret_cast<const char*>(toc + recordsSize);
+	this->pathsSize = h.tocSize - recordsSize;
+
+	// Everything a read relies on, so reads themselves only have to check the LZ4 data
+	for (uint32_t i = 0; i < h.chunkCount; i++)
+	{
+		const PakChunkRecord& chunk = this->chunks[i];
+		if (chunk.offset < sizeof(PakHeader) || chunk.offset > h.tocOffset || chunk.compressedSize > h.tocOffset - chunk.offset ||
+			chunk.compression > static_cast<uint32_t>(PakCompression::Lz4))
+			return false;
+	}
+	for (uint32_t i = 0; i < h.entryCount; i++)
+	{
+		const PakEntryRecord& entry = this->entries[i];
+		if (entry.chunkCount != (entry.size + h.chunkSize - 1) / h.chunkSize || entry.firstChunk > h.chunkCount || entry.chunkCount > h.chunkCount - entry.firstChunk)
+			return false;
+		if (entry.pathOffset > this->pathsSize || entry.pathLength > this->pathsSize - entry.pathOffset)
+			return false;
+		for (uint32_t c = 0; c < entry.chunkCount; c++)
+		{
+			const PakChunkRecord& chunk = this->chunks[entry.firstChunk + c];
+			if (chunk.compression == static_cast<uint32_t>(PakCompression::Stored) && chunk.compressedSize != GetChunkSize(entry, c))
+				return false;
+		}
+		// Find does a binary search
+		if (i > 0 && !(GetPath(this->entries[i - 1]) < GetPath(entry)))
+			return false;
+	}
+	return true;
+}
+
+std::string PakArchive::GetPath(const PakEntryRecord& entry) const
+{
+	return std::string(this->paths + entry.pathOffset, entry.pathLength);
+}
+
+uint64_t PakArchive::GetCompressedSize(const PakEntryRecord& entry) const
+{
+	uint64_t size = 0;
+	for (uint32_t c = 0; c < entry.chunkCount; c++)
+		size += this->chunks[entry.firstChunk + c].compressedSize;
+	return size;
+}
+
+const PakEntryRecord* PakArchive::Find(const std::string& path) const
+{
+	if (this->header == nullptr)
+		return nullptr;
+
+	const std::string normalized = Pak::NormalizePath(path);
+	const PakEntryRecord* end = this->entries + this->header->entryCount;
+	const PakEntryRecord* entry = std::lower_bound(this->entries, end, normalized, [this](const PakEntryRecord& record, const std::string& value)
+	{
+		return value.compare(0, std::string::npos, this->paths + record.pathOffset, record.pathLength) > 0;
+	});
+	if (entry == end || normalized.compare(0, std::string::npos, this->paths + entry->pathOffset, entry->pathLength) != 0)
+		return nullptr;
+	return entry;
+}
+
+bool PakArchive::Read(const std::string& path, std::vector<uint8_t>& data) const
+{
+	return Read(path, data, ThreadPool::GetShared());
+}
+
+bool PakArchive::Read(const std::string& path, std::vector<uint8_t>& data, ThreadPool& pool) const
+{
+	const PakEntryRecord* entry = Find(path);
+	return entry != nullptr && Read(*entry, data, pool);
+}
+
+bool PakArchive::Read(const PakEntryRecord& entry, std::vector<uint8_t>& data, ThreadPool& pool) const
+{
+	data.resize(static_cast<size_t>(entry.size));
+	if (entry.chunkCount <= 1)
+		return entry.chunkCount == 0 || ReadChunk(entry, 0, data.data());
+
+	std::atomic<bool> succeeded(true);
+	pool.ParallelFor(entry.chunkCount, [&](size_t c)
+	{
+		if (!ReadChunk(entry, static_cast<uint32_t>(c), data.data() + c * this->header->chunkSize))
+			succeeded.store(false, std::memory_order_relaxed);
+	});
+	return succeeded.load();
+}
+
+bool PakArchive::ReadRange(const std::string& path, uint64_t offset, void* output, size_t size) const
+{
+	const PakEntryRecord* entry = Find(path);
+	if (entry == nullptr || offset > entry->size || size > entry->size - offset)
+		return false;
+
+	const uint64_t chunkSize = this->header->chunkSize;
+	uint8_t* destination = static_cast<uint8_t*>(output);
+	std::vector<uint8_t> scratch;
+	while (size > 0)
+	{
+		uint32_t chunk = static_cast<uint32_t>(offset / chunkSize);
+		uint64_t chunkOffset = offset - chunk * chunkSize;
+		uint64_t chunkBytes = GetChunkSize(*entry, chunk);
+		size_t count = static_cast<size_t>(std::min<uint64_t>(size, chunkBytes - chunkOffset));
+
+		// Whole chunks decode straight into the output, partial ones go through a scratch buffer
+		if (count == chunkBytes)
+		{
+			if (!ReadChunk(*entry, chunk, destination))
+				return false;
+		}
+		else
+		{
+			scratch.resize(static_cast<size_t>(chunkBytes));
+			if (!ReadChunk(*entry, chunk, scratch.data()))
+				return false;
+			memcpy(destination, scratch.data() + chunkOffset, count);
+		}
+		destination += count;
+		offset += count;
+		size -= count;
+	}
+	return true;
+}
+
+uint32_t PakArchive::Verify(ThreadPool& pool) const
+{
+	uint32_t failed = 0;
+	std::vector<uint8_t> data;
+	for (uint32_t i = 0; i < GetEntryCount(); i++)
+	{
+		const PakEntryRecord& entry = this->entries[i];
+		if (!Read(entry, data, pool) || ContentHash::Hash64(data.data(), data.size()) != entry.hash)
+			failed++;
+	}
+	return failed;
+}
+
+uint64_t PakArchive::GetChunkSize(const PakEntryRecord& entry, uint32_t chunk) const
+{
+	uint64_t offset = static_cast<uint64_t>(chunk) * this->header->chunkSize;
+	return std::min<uint64_t>(this->header->chunkSize, entry.size - offset);
+}
+
+bool PakArchive::ReadChunk(const PakEntryRecord& entry, uint32_t chunk, uint8_t* output) const
+{
+	const PakChunkRecord& record = this->chunks[entry.firstChunk + chunk];
+	const uint8_t* source = this->file.Data() + record.offset;
+	const size_t size = static_cast<size_t>(GetChunkSize(entry, chunk));
+	if (record.compression == static_cast<uint32_t>(PakCompression::Stored))
+	{
+		memcpy(output, source, size);
+		return true;
+	}
+	return Lz4::Decompress(source, record.compressedSize, output, size);
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Packed asset archive (.iepak)
+//
+// One file holding many assets, so loading a set of them is one open and reads from one place on the disk instead
+// of an open, a stat and a scattered read per loose file. Little endian, produced by the asset tool (Engine.exe -pak):
+//
+//   PakHeader
+//   chunk data                     every entry cut into chunks of chunkSize uncompressed bytes
+//   PakEntryRecord[entryCount]     sorted by path, 8 byte aligned
+//   PakChunkRecord[chunkCount]     the chunks of an entry are consecutive
+//   path strings                   not null terminated
+//
+// Every chunk is LZ4 compressed on its own, or stored as is when compressing does not make it smaller, so entries
+// stay seekable: reading a range decodes only the chunks it overlaps, and the chunks of a large entry decode on the
+// thread pool in parallel. The table of contents comes last so the data can be written first, its hash is checked
+// on open along with every offset in it.
+
+namespace Pak
+{
+	const uint32_t Magic = 0x4B504549; // "IEPK"
+	const uint16_t Version = 1;
+	const uint16_t EndianTag = 0x0102;
+	const uint32_t DefaultChunkSize = 64 * 1024;
+	const char* const Extension = "iepak";
+
+	// Archive paths use forward slashes and do not start with "./", "Resources\\Models\\a.fbx" -> "Resources/Models/a.fbx".
+	// They are case sensitive
+	std::string NormalizePath(const std::string& path);
+}
+
+enum class PakCompression : uint32_t
+{
+	Stored = 0,
+	Lz4 = 1,
+};
+
+struct PakHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t endianTag;
+	uint32_t chunkSize;
+	uint32_t entryCount;
+	uint32_t chunkCount;
+	uint32_t reserved;
+	uint64_t tocOffset;
+	uint64_t tocSize;
+	uint64_t tocHash; // ContentHash::Hash64 of the table of contents
+	uint64_t fileSize;
+};
+
+struct PakEntryRecord
+{
+	uint64_t size; // Uncompressed
+	uint64_t hash; // ContentHash::Hash64 of the uncompressed data, checked by Verify
+	uint32_t firstChunk;
+	uint32_t chunkCount;
+	uint32_t pathOffset; // Relative to the path strings
+	uint32_t pathLength;
+};
+
+struct PakChunkRecord
+{
+	uint64_t offset; // From the start of the file
+	uint32_t compressedSize; // Same as the uncompressed size for stored chunks
+	uint32_t compression; // PakCompression
+};
+
+static_assert(sizeof(PakEntryRecord) == 32, "PakEntryRecord is part of the file format");
+static_assert(sizeof(PakChunkRecord) == 16, "PakChunkRecord is part of the file format");
+
+class PakWriter
+{
+public:
+	struct Statistics
+	{
+		uint32_t entries = 0;
+		uint32_t chunks = 0;
+		uint32_t storedChunks = 0; // Chunks compression did not help
+		uint64_t uncompressedBytes = 0;
+		uint64_t compressedBytes = 0; // Chunk data only
+		uint64_t fileSize = 0;
+	};
+
+	explicit PakWriter(uint32_t chunkSize = Pak::DefaultChunkSize);
+
+	// Adding a path twice keeps the last data
+	void Add(const std::string& path, std::vector<uint8_t> data);
+	bool AddFile(const std::string& path, const std::string& filepath);
+	// Adds every file below directory as "<directory>/<relative path>", so the archive paths are the paths the engine
+	// already uses. Skips OS litter (Thumbs.db, desktop.ini, .DS_Store) and other archives. Returns the number added
+	size_t AddDirectory(const std::string& directory);
+
+	// Compresses the chunks on the pool and replaces filepath atomically
+	bool Write(const std::string& filepath);
+	bool Write(const std::string& filepath, ThreadPool& pool);
+
+	const Statistics& GetStatistics() const { return this->statistics; }
+
+private:
+	uint32_t chunkSize;
+	std::map<std::string, std::vector<uint8_t>> entries; // Sorted by path, the order the table of contents needs
+	Statistics statistics;
+};
+
+// Read side. Maps the archive, every read decodes straight from the mapping. Reads are thread safe
+class PakArchive
+{
+public:
+	PakArchive() {}
+
+	PakArchive(const PakArchive& rhs) = delete;
+	PakArchive& operator=(const PakArchive& rhs) = delete;
+
+	// The archive ModelImporter falls back to for files that are not there loose. Open it at startup, before
+	// anything loads
+	static PakArchive& GetShared();
+
+	bool Open(const std::string& filepath);
+	void Close();
+	bool IsOpen() const { return this->header != nullptr; }
+
+	uint32_t GetEntryCount() const { return this->header != nullptr ? this->header->entryCount : 0; }
+	const PakEntryRecord& GetEntry(uint32_t index) const { return this->entries[index]; }
+	std::string GetPath(const PakEntryRecord& entry) const;
+	uint64_t GetCompressedSize(const PakEntryRecord& entry) const;
+
+	// Null if there is no such entry
+	const PakEntryRecord* Find(const std::string& path) const;
+	bool Contains(const std::string& path) const { return Find(path) != nullptr; }
+
+	// Whole entry. Entries of more than one chunk decode on the pool
+	bool Read(const std::string& path, std::vector<uint8_t>& data) const;
+	bool Read(const std::string& path, std::vector<uint8_t>& data, ThreadPool& pool) const;
+	bool Read(const PakEntryRecord& entry, std::vector<uint8_t>& data, ThreadPool& pool) const;
+	// size bytes starting offset bytes into the entry, decoding only the chunks that overlap them
+	bool ReadRange(const std::string& path, uint64_t offset, void* output, size_t size) const;
+
+	// Decodes every entry and checks it against its hash. Returns the number that failed
+	uint32_t Verify(ThreadPool& pool) const;
+
+private:
+	bool Validate();
+	uint64_t GetChunkSize(const PakEntryRecord& entry, uint32_t chunk) const;
+	// Decodes chunk (relative to the entry) into output, which holds GetChunkSize bytes
+	bool ReadChunk(const PakEntryRecord& entry, uint32_t chunk, uint8_t* output) const;
+
+	MappedFile file;
+	const PakHeader* header = nullptr;
+	const PakEntryRecord* entries = nullptr;
+	const PakChunkRecord* chunks = nullptr;
+	const char* paths = nullptr;
+	uint64_t pathsSize = 0;
+};
@@ -0,0 +1,471 @@
+#include "PngDecoder.h"
+#include "Inflate.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const uint8_t Signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	const uint64_t MaxPixels = 1ull << 28;
+	const uint32_t RowsPerBand = 32;
+
+	enum ColorType
+	{
+		Gray = 0,
+		Rgb = 2,
+		Palette = 3,
+		GrayAlpha = 4,
+		Rgba = 6,
+	};
+
+	// Adam7 passes, the first pixel and the spacing of each
+	const uint32_t PassX[7] = { 0, 4, 0, 2, 0, 1, 0 };
+	const uint32_t PassY[7] = { 0, 0, 4, 0, 2, 0, 1 };
+	const uint32_t PassStepX[7] = { 8, 8, 4, 4, 2, 2, 1 };
+	const uint32_t PassStepY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+	uint32_t Read32(const uint8_t* data)
+	{
+		return static_cast<uint32_t>(data[0]) << 24 | data[1] << 16 | data[2] << 8 | data[3];
+	}
+
+	uint32_t Crc32(const uint8_t* data, size_t size)
+	{
+		static const std::vector<uint32_t> table = []()
+		{
+			std::vector<uint32_t> values(256);
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; bit++)
+					crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+				values[i] = crc;
+			}
+			return values;
+		}();
+
+		uint32_t crc = 0xFFFFFFFF;
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc ^ 0xFFFFFFFF;
+	}
+
+	struct Png
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		int bitDepth = 0;
+		int colorType = 0;
+		bool interlaced = false;
+		int channels = 0;
+
+		uint8_t palette[256][4]; // Indices past the end of PLTE are opaque black, like libpng
+		int paletteSize = 0;
+		bool hasTransparentColor = false; // Gray and RGB files, tRNS names one color that is transparent
+		uint16_t transparentColor[3] = {};
+		std::vector<uint8_t> compressed; // The IDAT chunks, joined
+
+		size_t GetRowBytes(uint32_t pixels) const { return (static_cast<size_t>(pixels) * this->channels * this->bitDepth + 7) / 8; }
+		// Distance between a byte and the one of the previous pixel it is filtered against
+		size_t GetFilterStride() const { return std::max(1, this->channels * this->bitDepth / 8); }
+	};
+
+	bool ReadHeader(const uint8_t* data, size_t length, Png& png)
+	{
+		if (length != 13)
+			return false;
+		png.width = Read32(data);
+		png.height = Read32(data + 4);
+		png.bitDepth = data[8];
+		png.colorType = data[9];
+		png.interlaced = data[12] == 1;
+		if (png.width == 0 || png.height == 0 || static_cast<uint64_t>(png.width) * png.height > MaxPixels || data[10] != 0 || data[11] != 0 || data[12] > 1)
+			return false;
+
+		const int depth = png.bitDepth;
+		switch (png.colorType)
+		{
+		case Gray:
+			png.channels = 1;
+			return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+		case Palette:
+			png.channels = 1;
+			return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+		case GrayAlpha:
+			png.channels = 2;
+			return depth == 8 || depth == 16;
+		case Rgb:
+			png.channels = 3;
+			return depth == 8 || depth == 16;
+		case Rgba:
+			png.channels = 4;
+			return depth == 8 || depth == 16;
+		default:
+			return false;
+		}
+	}
+
+	bool ReadChunks(const uint8_t* data, size_t size, Png& png, bool headerOnly)
+	{
+		if (size < 8 || memcmp(data, Signature, 8) != 0)
+			return false;
+		for (int i = 0; i < 256; i++)
+		{
+			png.palette[i][0] = png.palette[i][1] = png.palette[i][2] = 0;
+			png.palette[i][3] = 255;
+		}
+
+		size_t position = 8;
+		bool headerRead = false;
+		for (;;)
+		{
+			if (position + 12 > size)
+				return false;
+			uint32_t length = Read32(data + position);
+			const uint8_t* type = data + position + 4;
+			const uint8_t* chunk = type + 4;
+			if (length > size - position - 12)
+				return false;
+			// Everything that changes the output format comes before the image data
+			if (headerOnly && memcmp(type, "IDAT", 4) == 0)
+				return headerRead;
+			if (Crc32(type, length + 4) != Read32(chunk + length))
+				return false;
+			position += length + 12;
+
+			if (memcmp(type, "IHDR", 4) == 0)
+			{
+				if (headerRead || !ReadHeader(chunk, length, png))
+					return false;
+				headerRead = true;
+				continue;
+			}
+			if (!headerRead)
+				return false;
+
+			if (memcmp(type, "PLTE", 4) == 0)
+			{
+				if (length % 3 != 0 || length > 768)
+					return false;
+				png.paletteSize = static_cast<int>(length / 3);
+				for (int i = 0; i < png.paletteSize; i++)
+				{
+					png.palette[i][0] = chunk[i * 3];
+					png.palette[i][1] = chunk[i * 3 + 1];
+					png.palette[i][2] = chunk[i * 3 + 2];
+					png.palette[i][3] = 255;
+				}
+			}
+			else if (memcmp(type, "tRNS", 4) == 0)
+			{
+				if (png.colorType == Palette)
+				{
+					if (static_cast<int>(length) > png.paletteSize)
+						return false;
+					for (uint32_t i = 0; i < length; i++)
+						png.palette[i][3] = chunk[i];
+				}
+				else if (png.colorType == Gray || png.colorType == Rgb)
+				{
+					const uint32_t samples = png.colorType == Gray ? 1 : 3;
+					if (length != samples * 2)
+						return false;
+					for (uint32_t i = 0; i < samples; i++)
+						png.transparentColor[i] = static_cast<uint16_t>(chunk[i * 2] << 8 | chunk[i * 2 + 1]);
+					png.hasTransparentColor = true;
+				}
+			}
+			else if (memcmp(type, "IDAT", 4) == 0)
+			{
+				png.compressed.insert(png.compressed.end(), chunk, chunk + length);
+			}
+			else if (memcmp(type, "IEND", 4) == 0)
+			{
+				return !png.compressed.empty() && (png.colorType != Palette || png.paletteSize > 0);
+			}
+			else if ((type[0] & 32) == 0)
+			{
+				return false; // Unknown critical chunk, the image cannot be shown without it
+			}
+		}
+	}
+
+	void Describe(const Png& png, ImageDescription& description)
+	{
+		description = ImageDescription();
+		description.width = png.width;
+		description.height = png.height;
+		if (png.colorType == Gray && !png.hasTransparentColor)
+			description.format = png.bitDepth == 16 ? PixelFormat::R16_UNORM : PixelFormat::R8_UNORM;
+		else
+			description.format = png.bitDepth == 16 ? PixelFormat::R16G16B16A16_UNORM : PixelFormat::R8G8B8A8_UNORM;
+		description.rowPitch = description.width * ImageDescription::GetBytesPerPixel(description.format);
+	}
+
+	uint8_t Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a);
+		int pb = std::abs(p - b);
+		int pc = std::abs(p - c);
+		return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+	}
+
+	// rows holds rowCount rows of a filter type byte followed by rowBytes bytes, unfiltered in place
+	bool Unfilter(uint8_t* rows, size_t rowBytes, uint32_t rowCount, size_t stride)
+	{
+		std::vector<uint8_t> zeros(rowBytes);
+		const uint8_t* previous = zeros.data();
+		for (uint32_t y = 0; y < rowCount; y++)
+		{
+			const uint8_t filter = rows[0];
+			uint8_t* row = rows + 1;
+			switch (filter)
+			{
+			case 0:
+				break;
+			case 1: // Sub
+				for (size_t i = stride; i < rowBytes; i++)
+					row[i] = static_cast<uint8_t>(row[i] + row[i - stride]);
+				break;
+			case 2: // Up
+				for (size_t i = 0; i < rowBytes; i++)
+					row[i] = static_cast<uint8_t>(row[i] + previous[i]);
+				break;
+			case 3: // Average
+				for (size_t i = 0; i < stride && i < rowBytes; i++)
+					row[i] = static_cast<uint8_t>(row[i] + (previous[i] >> 1));
+				for (size_t i = stride; i < rowBytes; i++)
+					row[i] = static_cast<uint8_t>(row[i] + ((row[i - stride] + previous[i]) >> 1));
+				break;
+			case 4: // Paeth
+				for (size_t i = 0; i < stride && i < rowBytes; i++)
+					row[i] = static_cast<uint8_t>(row[i] + previous[i]);
+				for (size_t i = stride; i < rowBytes; i++)
+					row[i] = static_cast<uint8_t>(row[i] + Paeth(row[i - stride], previous[i], previous[i - stride]));
+				break;
+			default:
+				return false;
+			}
+			previous = row;
+			rows += rowBytes + 1;
+		}
+		return true;
+	}
+
+	// Converts count pixels of an unfiltered row, writing them step bytes apart
+	void ConvertRow(const Png& png, PixelFormat format, const uint8_t* row, uint32_t count, uint8_t* output, size_t step)
+	{
+		if (png.bitDepth < 8)
+		{
+			// Packed samples, most significant first. Grayscale is scaled to 0-255, palette indices are not
+			const int depth = png.bitDepth;
+			const int mask = (1 << depth) - 1;
+			const int scale = png.colorType == Palette ? 1 : 255 / mask;
+			for (uint32_t x = 0; x < count; x++, output += step)
+			{
+				const size_t bit = static_cast<size_t>(x) * depth;
+				const int sample = (row[bit / 8] >> (8 - depth - bit % 8)) & mask;
+				if (png.colorType == Palette)
+				{
+					memcpy(output, png.palette[sample], 4);
+					continue;
+				}
+				const uint8_t gray = static_cast<uint8_t>(sample * scale);
+				if (format == PixelFormat::R8_UNORM)
+				{
+					output[0] = gray;
+					continue;
+				}
+				output[0] = output[1] = output[2] = gray;
+				output[3] = png.hasTransparentColor && sample == png.transparentColor[0] ? 0 : 255;
+			}
+			return;
+		}
+
+		if (png.bitDepth == 8)
+		{
+			switch (png.colorType)
+			{
+			case Gray:
+				for (uint32_t x = 0; x < count; x++, output += step)
+				{
+					output[0] = row[x];
+					if (format == PixelFormat::R8_UNORM)
+						continue;
+					output[1] = output[2] = row[x];
+					output[3] = png.hasTransparentColor && row[x] == png.transparentColor[0] ? 0 : 255;
+				}
+				break;
+			case Palette:
+				for (uint32_t x = 0; x < count; x++, output += step)
+					memcpy(output, png.palette[row[x]], 4);
+				break;
+			case GrayAlpha:
+				for (uint32_t x = 0; x < count; x++, output += step)
+				{
+					output[0] = output[1] = output[2] = row[x * 2];
+					output[3] = row[x * 2 + 1];
+				}
+				break;
+			case Rgb:
+				for (uint32_t x = 0; x < count; x++, output += step)
+				{
+					const uint8_t* pixel = row + x * 3;
+					output[0] = pixel[0];
+					output[1] = pixel[1];
+					output[2] = pixel[2];
+					output[3] = png.hasTransparentColor && pixel[0] == png.transparentColor[0] && pixel[1] == png.transparentColor[1] && pixel[2] == png.transparentColor[2] ? 0 : 255;
+				}
+				break;
+			case Rgba:
+				if (step == 4)
+				{
+					memcpy(output, row, static_cast<size_t>(count) * 4);
+					break;
+				}
+				for (uint32_t x = 0; x < count; x++, output += step)
+					memcpy(output, row + x * 4, 4);
+				break;
+			}
+			return;
+		}
+
+		// 16 bit samples are big endian in the file and little endian in the texture
+		auto sample = [&](uint32_t index) { return static_cast<uint16_t>(row[index * 2] << 8 | row[index * 2 + 1]); };
+		for (uint32_t x = 0; x < count; x++, output += step)
+		{
+			uint16_t value[4];
+			switch (png.colorType)
+			{
+			case Gray:
+				value[0] = value[1] = value[2] = sample(x);
+				value[3] = png.hasTransparentColor && value[0] == png.transparentColor[0] ? 0 : 65535;
+				break;
+			case GrayAlpha:
+				value[0] = value[1] = value[2] = sample(x * 2);
+				value[3] = sample(x * 2 + 1);
+				break;
+			case Rgb:
+				value[0] = sample(x * 3);
+				value[1] = sample(x * 3 + 1);
+				value[2] = sample(x * 3 + 2);
+				value[3] = png.hasTransparentColor && value[0] == png.transparentColor[0] && value[1] == png.transparentColor[1] && value[2] == png.transparentColor[2] ? 0 : 65535;
+				break;
+			default:
+				for (uint32_t i = 0; i < 4; i++)
+					value[i] = sample(x * 4 + i);
+				break;
+			}
+			const int channels = format == PixelFormat::R16_UNORM ? 1 : 4;
+			for (int i = 0; i < channels; i++)
+			{
+				output[i * 2] = static_cast<uint8_t>(value[i]);
+				output[i * 2 + 1] = static_cast<uint8_t>(value[i] >> 8);
+			}
+		}
+	}
+
+	// Decodes into destination at rowPitch, or into the pixels of image when destination is null
+	bool DecodeRows(const uint8_t* data, size_t size, ImageData& image, uint8_t* destination, size_t rowPitch, ThreadPool& pool)
+	{
+		Png png;
+		if (!ReadChunks(data, size, png, false))
+			return false;
+
+		// Size of the filtered data, every row has a filter type byte in front. Interlaced files hold the seven passes one
+		// after the other, each a small image of its own, and passes without pixels are left out
+		uint32_t passWidths[7] = {};
+		uint32_t passHeights[7] = {};
+		size_t filteredSize = 0;
+		if (png.interlaced)
+		{
+			for (int pass = 0; pass < 7; pass++)
+			{
+				passWidths[pass] = png.width > PassX[pass] ? (png.width - PassX[pass] + PassStepX[pass] - 1) / PassStepX[pass] : 0;
+				passHeights[pass] = png.height > PassY[pass] ? (png.height - PassY[pass] + PassStepY[pass] - 1) / PassStepY[pass] : 0;
+				if (passWidths[pass] > 0 && passHeights[pass] > 0)
+					filteredSize += (png.GetRowBytes(passWidths[pass]) + 1) * passHeights[pass];
+			}
+		}
+		else
+		{
+			filteredSize = (png.GetRowBytes(png.width) + 1) * png.height;
+		}
+
+		std::vector<uint8_t> filtered(filteredSize);
+		if (!Inflate::DecompressZlib(png.compressed.data(), png.compressed.size(), filtered.data(), filtered.size()))
+			return false;
+		std::vector<uint8_t>().swap(png.compressed);
+
+		Describe(png, image.description);
+		if (destination == nullptr)
+		{
+			image.pixels.resize(image.description.GetSize());
+			destination = image.pixels.data();
+			rowPitch = image.description.rowPitch;
+		}
+		else if (rowPitch < image.description.rowPitch)
+		{
+			return false;
+		}
+		const size_t pixelSize = ImageDescription::GetBytesPerPixel(image.description.format);
+		const size_t stride = png.GetFilterStride();
+
+		if (!png.interlaced)
+		{
+			const size_t rowBytes = png.GetRowBytes(png.width);
+			if (!Unfilter(filtered.data(), rowBytes, png.height, stride))
+				return false;
+			const uint32_t bands = (png.height + RowsPerBand - 1) / RowsPerBand;
+			pool.ParallelFor(bands, [&](size_t band)
+			{
+				const uint32_t first = static_cast<uint32_t>(band) * RowsPerBand;
+				const uint32_t last = std::min(first + RowsPerBand, png.height);
+				for (uint32_t y = first; y < last; y++)
+					ConvertRow(png, image.description.format, filtered.data() + y * (rowBytes + 1) + 1, png.width, destination + y * rowPitch, pixelSize);
+			});
+			return true;
+		}
+
+		uint8_t* passData = filtered.data();
+		for (int pass = 0; pass < 7; pass++)
+		{
+			if (passWidths[pass] == 0 || passHeights[pass] == 0)
+				continue;
+			const size_t rowBytes = png.GetRowBytes(passWidths[pass]);
+			if (!Unfilter(passData, rowBytes, passHeights[pass], stride))
+				return false;
+			// Rows of a pass land on different rows of the image, so they convert in parallel too
+			pool.ParallelFor(passHeights[pass], [&](size_t y)
+			{
+				uint8_t* output = destination + (PassY[pass] + y * PassStepY[pass]) * rowPitch + PassX[pass] * pixelSize;
+				ConvertRow(png, image.description.format, passData + y * (rowBytes + 1) + 1, passWidths[pass], output, PassStepX[pass] * pixelSize);
+			});
+			passData += (rowBytes + 1) * passHeights[pass];
+		}
+		return true;
+	}
+}
+
+bool PngDecoder::ReadDescription(const uint8_t* data, size_t size, ImageDescription& description)
+{
+	Png png;
+	if (!ReadChunks(data, size, png, true))
+		return false;
+	Describe(png, description);
+	return true;
+}
+
+bool PngDecoder::Decode(const uint8_t* data, size_t size, ImageData& image, ThreadPool& pool)
+{
+	return DecodeRows(data, size, image, nullptr, 0, pool);
+}
+
+bool PngDecoder::DecodeInto(const uint8_t* data, size_t size, uint8_t* destination, size_t rowPitch, ThreadPool& pool)
+{
+	ImageData image;
+	return DecodeRows(data, size, image, destination, rowPitch, pool);
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "ImageData.h"
+#include <cstddef>
+
+class ThreadPool;
+
+// PNG (ISO 15948), every color type and bit depth, interlaced or not. Chunk CRCs and the zlib checksum are checked.
+//
+// Inflating and unfiltering are sequential by nature, each row depends on the one above. Converting the unfiltered
+// rows to the output format runs by bands of rows on the pool
+class PngDecoder
+{
+public:
+	static bool ReadDescription(const uint8_t* data, size_t size, ImageDescription& description);
+
+	// Output formats:
+	//   8 bit and lower grayscale     R8_UNORM, low bit depths scaled to the full range
+	//   16 bit grayscale              R16_UNORM
+	//   everything else               R8G8B8A8_UNORM, or R16G16B16A16_UNORM from 16 bit files. Palettes are expanded,
+	//                                 a tRNS chunk turns into alpha
+	static bool Decode(const uint8_t* data, size_t size, ImageData& image, ThreadPool& pool);
+	// See ImageDecoder::DecodeInto
+	static bool DecodeInto(const uint8_t* data, size_t size, uint8_t* destination, size_t rowPitch, ThreadPool& pool);
+};
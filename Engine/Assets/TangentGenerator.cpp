@@ -0,0 +1,465 @@
+#include "TangentGenerator.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TANGENT_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	bool simdEnabled = true;
+
+	const uint32_t NoVertex = 0xFFFFFFFF;
+
+	// The same zero test MikkTSpace uses for areas and lengths
+	bool IsNotZero(float value)
+	{
+		return fabsf(value) > FLT_MIN;
+	}
+
+	void NormalizeSafe(float& x, float& y, float& z)
+	{
+		float length = sqrtf(x * x + y * y + z * z);
+		if (IsNotZero(length))
+		{
+			x = x / length;
+			y = y / length;
+			z = z / length;
+		}
+	}
+
+	// Unit dP/du in xyz. w is +1 or -1 for the winding of the triangle in UV space, 0 if it has no UV or surface area
+	XMFLOAT4 TriangleTangent(const std::vector<Vertex3D>& vertices, const uint32_t* triangle)
+	{
+		const Vertex3D& v0 = vertices[triangle[0]];
+		const Vertex3D& v1 = vertices[triangle[1]];
+		const Vertex3D& v2 = vertices[triangle[2]];
+		float d1x = v1.pos.x - v0.pos.x;
+		float d1y = v1.pos.y - v0.pos.y;
+		float d1z = v1.pos.z - v0.pos.z;
+		float d2x = v2.pos.x - v0.pos.x;
+		float d2y = v2.pos.y - v0.pos.y;
+		float d2z = v2.pos.z - v0.pos.z;
+		float t21x = v1.textCoord.x - v0.textCoord.x;
+		float t21y = v1.textCoord.y - v0.textCoord.y;
+		float t31x = v2.textCoord.x - v0.textCoord.x;
+		float t31y = v2.textCoord.y - v0.textCoord.y;
+
+		float area = t21x * t31y - t21y * t31x;
+		float x = t31y * d1x - t21y * d2x;
+		float y = t31y * d1y - t21y * d2y;
+		float z = t31y * d1z - t21y * d2z;
+		float lengthSquared = x * x + y * y + z * z;
+		if (!IsNotZero(area) || !IsNotZero(lengthSquared))
+			return XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+		// x y z is dP/du scaled by the signed area, dividing by the sign turns it back into dP/du on mirrored triangles
+		float sign = area > 0.0f ? 1.0f : -1.0f;
+		float scale = sign / sqrtf(lengthSquared);
+		return XMFLOAT4(x * scale, y * scale, z * scale, sign);
+	}
+
+	// The triangle's tangent projected into the plane of the corner's normal, scaled by the angle of the corner
+	XMFLOAT4 CornerTangent(const MeshData& mesh, const XMFLOAT4& tangent, uint32_t vertex, uint32_t next, uint32_t previous)
+	{
+		if (tangent.w == 0.0f)
+			return XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+		const XMFLOAT3& n = mesh.normals[vertex];
+		const XMFLOAT3& p = mesh.vertices[vertex].pos;
+		const XMFLOAT3& pNext = mesh.vertices[next].pos;
+		const XMFLOAT3& pPrevious = mesh.vertices[previous].pos;
+
+		float dot = n.x * tangent.x + n.y * tangent.y + n.z * tangent.z;
+		float tx = tangent.x - n.x * dot;
+		float ty = tangent.y - n.y * dot;
+		float tz = tangent.z - n.z * dot;
+		NormalizeSafe(tx, ty, tz);
+
+		float e1x = pNext.x - p.x;
+		float e1y = pNext.y - p.y;
+		float e1z = pNext.z - p.z;
+		dot = n.x * e1x + n.y * e1y + n.z * e1z;
+		e1x = e1x - n.x * dot;
+		e1y = e1y - n.y * dot;
+		e1z = e1z - n.z * dot;
+		NormalizeSafe(e1x, e1y, e1z);
+
+		float e2x = pPrevious.x - p.x;
+		float e2y = pPrevious.y - p.y;
+		float e2z = pPrevious.z - p.z;
+		dot = n.x * e2x + n.y * e2y + n.z * e2z;
+		e2x = e2x - n.x * dot;
+		e2y = e2y - n.y * dot;
+		e2z = e2z - n.z * dot;
+		NormalizeSafe(e2x, e2y, e2z);
+
+		float cosine = std::max(-1.0f, std::min(1.0f, e1x * e2x + e1y * e2y + e1z * e2z));
+		float angle = acosf(cosine);
+		return XMFLOAT4(tx * angle, ty * angle, tz * angle, 0.0f);
+	}
+
+#ifdef TANGENT_GENERATOR_SSE2
+	// Four 3D vectors, one per lane
+	struct Vector3x4
+	{
+		__m128 x;
+		__m128 y;
+		__m128 z;
+	};
+
+	__m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	__m128 Abs(__m128 value)
+	{
+		return _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+	}
+
+	__m128 IsNotZero(__m128 value)
+	{
+		return _mm_cmpgt_ps(Abs(value), _mm_set1_ps(FLT_MIN));
+	}
+
+	__m128 Dot(const Vector3x4& a, const Vector3x4& b)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+	}
+
+	Vector3x4 Subtract(const Vector3x4& a, const Vector3x4& b)
+	{
+		Vector3x4 result = { _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) };
+		return result;
+	}
+
+	// a - b * scale, which removes the b component from a when b is a unit vector and scale is dot(a, b)
+	Vector3x4 SubtractScaled(const Vector3x4& a, const Vector3x4& b, __m128 scale)
+	{
+		Vector3x4 result = { _mm_sub_ps(a.x, _mm_mul_ps(b.x, scale)), _mm_sub_ps(a.y, _mm_mul_ps(b.y, scale)), _mm_sub_ps(a.z, _mm_mul_ps(b.z, scale)) };
+		return result;
+	}
+
+	Vector3x4 NormalizeSafe(const Vector3x4& value)
+	{
+		__m128 length = _mm_sqrt_ps(Dot(value, value));
+		__m128 valid = IsNotZero(length);
+		Vector3x4 result =
+		{
+			Select(valid, _mm_div_ps(value.x, length), value.x),
+			Select(valid, _mm_div_ps(value.y, length), value.y),
+			Select(valid, _mm_div_ps(value.z, length), value.z),
+		};
+		return result;
+	}
+
+	// Abramowitz and Stegun 4.4.46, within 2e-8 radians of acos before float rounding
+	__m128 Acos(__m128 value)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 negative = _mm_cmplt_ps(value, _mm_setzero_ps());
+		__m128 x = _mm_min_ps(Abs(value), one);
+
+		__m128 polynomial = _mm_set1_ps(-0.0012624911f);
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(0.0066700901f));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(-0.0170881256f));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(0.0308918810f));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(-0.0501743046f));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(0.0889789874f));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(-0.2145988016f));
+		polynomial = _mm_add_ps(_mm_mul_ps(polynomial, x), _mm_set1_ps(1.5707963050f));
+
+		__m128 result = _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(one, x)), polynomial);
+		return Select(negative, _mm_sub_ps(_mm_set1_ps(3.14159265f), result), result);
+	}
+
+	Vector3x4 GatherPositions(const std::vector<Vertex3D>& vertices, const uint32_t* index)
+	{
+		const XMFLOAT3& a = vertices[index[0]].pos;
+		const XMFLOAT3& b = vertices[index[1]].pos;
+		const XMFLOAT3& c = vertices[index[2]].pos;
+		const XMFLOAT3& d = vertices[index[3]].pos;
+		Vector3x4 result = { _mm_set_ps(d.x, c.x, b.x, a.x), _mm_set_ps(d.y, c.y, b.y, a.y), _mm_set_ps(d.z, c.z, b.z, a.z) };
+		return result;
+	}
+
+	Vector3x4 GatherNormals(const std::vector<XMFLOAT3>& normals, const uint32_t* index)
+	{
+		const XMFLOAT3& a = normals[index[0]];
+		const XMFLOAT3& b = normals[index[1]];
+		const XMFLOAT3& c = normals[index[2]];
+		const XMFLOAT3& d = normals[index[3]];
+		Vector3x4 result = { _mm_set_ps(d.x, c.x, b.x, a.x), _mm_set_ps(d.y, c.y, b.y, a.y), _mm_set_ps(d.z, c.z, b.z, a.z) };
+		return result;
+	}
+
+	void GatherTextCoords(const std::vector<Vertex3D>& vertices, const uint32_t* index, __m128& u, __m128& v)
+	{
+		const XMFLOAT2& a = vertices[index[0]].textCoord;
+		const XMFLOAT2& b = vertices[index[1]].textCoord;
+		const XMFLOAT2& c = vertices[index[2]].textCoord;
+		const XMFLOAT2& d = vertices[index[3]].textCoord;
+		u = _mm_set_ps(d.x, c.x, b.x, a.x);
+		v = _mm_set_ps(d.y, c.y, b.y, a.y);
+	}
+
+	// Transposes four lanes of x y z w into four XMFLOAT4
+	void Store4(__m128 x, __m128 y, __m128 z, __m128 w, XMFLOAT4* output)
+	{
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&output[0].x, x);
+		_mm_storeu_ps(&output[1].x, y);
+		_mm_storeu_ps(&output[2].x, z);
+		_mm_storeu_ps(&output[3].x, w);
+	}
+#endif
+
+	void ComputeTriangleTangents(const MeshData& mesh, size_t triangleCount, XMFLOAT4* output)
+	{
+		size_t t = 0;
+
+#ifdef TANGENT_GENERATOR_SSE2
+		if (simdEnabled)
+		{
+			// Four triangles per iteration, the same operations in the same order as TriangleTangent
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 minusOne = _mm_set1_ps(-1.0f);
+			for (; t + 4 <= triangleCount; t += 4)
+			{
+				uint32_t corners[3][4];
+				for (int j = 0; j < 4; j++)
+				{
+					corners[0][j] = mesh.indices[(t + j) * 3];
+					corners[1][j] = mesh.indices[(t + j) * 3 + 1];
+					corners[2][j] = mesh.indices[(t + j) * 3 + 2];
+				}
+
+				Vector3x4 p0 = GatherPositions(mesh.vertices, corners[0]);
+				Vector3x4 d1 = Subtract(GatherPositions(mesh.vertices, corners[1]), p0);
+				Vector3x4 d2 = Subtract(GatherPositions(mesh.vertices, corners[2]), p0);
+				__m128 u0, v0, u1, v1, u2, v2;
+				GatherTextCoords(mesh.vertices, corners[0], u0, v0);
+				GatherTextCoords(mesh.vertices, corners[1], u1, v1);
+				GatherTextCoords(mesh.vertices, corners[2], u2, v2);
+				__m128 t21x = _mm_sub_ps(u1, u0);
+				__m128 t21y = _mm_sub_ps(v1, v0);
+				__m128 t31x = _mm_sub_ps(u2, u0);
+				__m128 t31y = _mm_sub_ps(v2, v0);
+
+				__m128 area = _mm_sub_ps(_mm_mul_ps(t21x, t31y), _mm_mul_ps(t21y, t31x));
+				Vector3x4 direction =
+				{
+					_mm_sub_ps(_mm_mul_ps(t31y, d1.x), _mm_mul_ps(t21y, d2.x)),
+					_mm_sub_ps(_mm_mul_ps(t31y, d1.y), _mm_mul_ps(t21y, d2.y)),
+					_mm_sub_ps(_mm_mul_ps(t31y, d1.z), _mm_mul_ps(t21y, d2.z)),
+				};
+				__m128 valid = _mm_and_ps(IsNotZero(area), IsNotZero(Dot(direction, direction)));
+				__m128 sign = Select(_mm_cmpgt_ps(area, _mm_setzero_ps()), one, minusOne);
+				__m128 scale = _mm_and_ps(valid, _mm_div_ps(sign, _mm_sqrt_ps(Dot(direction, direction))));
+
+				Store4(_mm_mul_ps(direction.x, scale), _mm_mul_ps(direction.y, scale), _mm_mul_ps(direction.z, scale), _mm_and_ps(valid, sign), output + t);
+			}
+		}
+#endif
+
+		for (; t < triangleCount; t++)
+			output[t] = TriangleTangent(mesh.vertices, &mesh.indices[t * 3]);
+	}
+
+	void ComputeCornerTangents(const MeshData& mesh, const XMFLOAT4* triangleTangents, size_t cornerCount, XMFLOAT4* output)
+	{
+		size_t c = 0;
+
+#ifdef TANGENT_GENERATOR_SSE2
+		if (simdEnabled)
+		{
+			// Four corners per iteration, the same operations in the same order as CornerTangent apart from acos
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 minusOne = _mm_set1_ps(-1.0f);
+			for (; c + 4 <= cornerCount; c += 4)
+			{
+				uint32_t vertex[4];
+				uint32_t next[4];
+				uint32_t previous[4];
+				const XMFLOAT4* tangents[4];
+				for (int j = 0; j < 4; j++)
+				{
+					size_t triangle = (c + j) / 3;
+					size_t corner = (c + j) - triangle * 3;
+					vertex[j] = mesh.indices[triangle * 3 + corner];
+					next[j] = mesh.indices[triangle * 3 + (corner + 1) % 3];
+					previous[j] = mesh.indices[triangle * 3 + (corner + 2) % 3];
+					tangents[j] = &triangleTangents[triangle];
+				}
+
+				__m128 tx = _mm_loadu_ps(&tangents[0]->x);
+				__m128 ty = _mm_loadu_ps(&tangents[1]->x);
+				__m128 tz = _mm_loadu_ps(&tangents[2]->x);
+				__m128 tw = _mm_loadu_ps(&tangents[3]->x);
+				_MM_TRANSPOSE4_PS(tx, ty, tz, tw);
+				Vector3x4 tangent = { tx, ty, tz };
+				__m128 valid = _mm_cmpneq_ps(tw, _mm_setzero_ps());
+
+				Vector3x4 n = GatherNormals(mesh.normals, vertex);
+				Vector3x4 p = GatherPositions(mesh.vertices, vertex);
+				tangent = NormalizeSafe(SubtractScaled(tangent, n, Dot(n, tangent)));
+				Vector3x4 e1 = Subtract(GatherPositions(mesh.vertices, next), p);
+				e1 = NormalizeSafe(SubtractScaled(e1, n, Dot(n, e1)));
+				Vector3x4 e2 = Subtract(GatherPositions(mesh.vertices, previous), p);
+				e2 = NormalizeSafe(SubtractScaled(e2, n, Dot(n, e2)));
+
+				__m128 cosine = _mm_max_ps(minusOne, _mm_min_ps(one, Dot(e1, e2)));
+				__m128 angle = _mm_and_ps(valid, Acos(cosine));
+				Store4(_mm_mul_ps(tangent.x, angle), _mm_mul_ps(tangent.y, angle), _mm_mul_ps(tangent.z, angle), _mm_setzero_ps(), output + c);
+			}
+		}
+#endif
+
+		for (; c < cornerCount; c++)
+		{
+			size_t triangle = c / 3;
+			size_t corner = c - triangle * 3;
+			output[c] = CornerTangent(mesh, triangleTangents[triangle], mesh.indices[triangle * 3 + corner],
+				mesh.indices[triangle * 3 + (corner + 1) % 3], mesh.indices[triangle * 3 + (corner + 2) % 3]);
+		}
+	}
+}
+
+TangentGenerator::Statistics TangentGenerator::Generate(MeshData& mesh)
+{
+	Statistics statistics;
+	mesh.tangents.clear();
+	if (mesh.normals.size() != mesh.vertices.size() || mesh.vertices.empty())
+		return statistics;
+
+	const size_t vertexCount = mesh.vertices.size();
+	const size_t triangleCount = mesh.indices.size() / 3;
+	std::vector<XMFLOAT4> triangleTangents(triangleCount);
+	ComputeTriangleTangents(mesh, triangleCount, triangleTangents.data());
+
+	// Count the windings around every vertex. A vertex keeps the sign most of its triangles have
+	std::vector<uint32_t> positive(vertexCount, 0);
+	std::vector<uint32_t> negative(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		float sign = triangleTangents[t].w;
+		if (sign == 0.0f)
+		{
+			statistics.degenerateTriangles++;
+			continue;
+		}
+		for (int k = 0; k < 3; k++)
+			(sign > 0.0f ? positive : negative)[mesh.indices[t * 3 + k]]++;
+	}
+
+	std::vector<float> signs(vertexCount);
+	std::vector<uint32_t> copies(vertexCount, NoVertex);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		signs[v] = negative[v] > positive[v] ? -1.0f : 1.0f;
+		if (positive[v] > 0 && negative[v] > 0)
+		{
+			// Mirrored UVs meet here, the other winding gets a vertex of its own
+			Vertex3D vertex = mesh.vertices[v];
+			XMFLOAT3 normal = mesh.normals[v];
+			copies[v] = static_cast<uint32_t>(mesh.vertices.size());
+			mesh.vertices.push_back(vertex);
+			mesh.normals.push_back(normal);
+			signs.push_back(-signs[v]);
+			statistics.splitVertices++;
+		}
+	}
+
+	if (statistics.splitVertices > 0)
+	{
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			float sign = triangleTangents[t].w;
+			for (int k = 0; k < 3 && sign != 0.0f; k++)
+			{
+				uint32_t& index = mesh.indices[t * 3 + k];
+				if (copies[index] != NoVertex && sign != signs[index])
+					index = copies[index];
+			}
+		}
+
+		// LOD triangles are not the full detail ones, their winding is worked out on its own
+		for (MeshLod& lod : mesh.lods)
+		{
+			for (size_t t = 0; t + 3 <= lod.indices.size(); t += 3)
+			{
+				float sign = TriangleTangent(mesh.vertices, &lod.indices[t]).w;
+				for (int k = 0; k < 3 && sign != 0.0f; k++)
+				{
+					uint32_t& index = lod.indices[t + k];
+					if (copies[index] != NoVertex && sign != signs[index])
+						index = copies[index];
+				}
+			}
+		}
+	}
+
+	std::vector<XMFLOAT4> cornerTangents(triangleCount * 3);
+	ComputeCornerTangents(mesh, triangleTangents.data(), cornerTangents.size(), cornerTangents.data());
+
+	// Scattering into the vertices stays scalar, neighbouring corners often share a vertex
+	std::vector<XMFLOAT3> sums(mesh.vertices.size(), XMFLOAT3(0.0f, 0.0f, 0.0f));
+	for (size_t c = 0; c < cornerTangents.size(); c++)
+	{
+		XMFLOAT3& sum = sums[mesh.indices[c]];
+		sum.x += cornerTangents[c].x;
+		sum.y += cornerTangents[c].y;
+		sum.z += cornerTangents[c].z;
+	}
+
+	mesh.tangents.resize(mesh.vertices.size());
+	for (size_t v = 0; v < mesh.vertices.size(); v++)
+	{
+		const XMFLOAT3& n = mesh.normals[v];
+		const XMFLOAT3& sum = sums[v];
+		float dot = n.x * sum.x + n.y * sum.y + n.z * sum.z;
+		float x = sum.x - n.x * dot;
+		float y = sum.y - n.y * dot;
+		float z = sum.z - n.z * dot;
+		float length = sqrtf(x * x + y * y + z * z);
+		if (IsNotZero(length))
+		{
+			x /= length;
+			y /= length;
+			z /= length;
+		}
+		else
+		{
+			// Nothing to go by, any direction in the tangent plane will do. Start from the axis least aligned with the normal
+			statistics.fallbackVertices++;
+			bool useX = fabsf(n.x) < 0.9f;
+			dot = useX ? n.x : n.y;
+			x = (useX ? 1.0f : 0.0f) - n.x * dot;
+			y = (useX ? 0.0f : 1.0f) - n.y * dot;
+			z = -n.z * dot;
+			NormalizeSafe(x, y, z);
+		}
+		mesh.tangents[v] = XMFLOAT4(x, y, z, signs[v]);
+	}
+	return statistics;
+}
+
+bool TangentGenerator::IsSimdAvailable()
+{
+#ifdef TANGENT_GENERATOR_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+void TangentGenerator::SetSimdEnabled(bool enabled)
+{
+	simdEnabled = enabled;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "MeshData.h"
+
+// Per vertex tangent frames for normal mapping, computed the way MikkTSpace does so normal maps baked against it
+// (Substance, Blender, the Megascans textures) shade without seams.
+//
+// Every triangle's tangent is the direction of dP/du. At each corner it is projected into the plane of the vertex
+// normal and added to the vertex weighted by the corner angle, the sum is then normalized. w holds the bitangent sign,
+// bitangent = w * cross(normal, tangent), which comes from the UV winding of the triangles around the vertex. Where
+// mirrored UVs meet, a vertex is shared by triangles of both windings, so it is split in two and the triangles of the
+// less common winding are moved to the copy. Triangles without UV area or surface area add nothing, a vertex only
+// they touch gets any tangent perpendicular to its normal.
+//
+// MikkTSpace also merges contributions across distinct vertices with the same position, normal and UV. The importer
+// welds those into one vertex first, so that step is left out.
+//
+// The triangle and corner passes run four at a time with SSE2, SetSimdEnabled(false) forces the scalar reference.
+// Apart from the corner angle, which SSE2 gets from a polynomial, both do the same operations in the same order. On
+// real meshes the results are within a few hundredths of a degree and the bitangent signs always match
+class TangentGenerator
+{
+public:
+	struct Statistics
+	{
+		size_t splitVertices = 0; // Added for mirrored UVs
+		size_t degenerateTriangles = 0;
+		size_t fallbackVertices = 0; // Vertices no triangle contributed to
+	};
+
+	// Fills mesh.tangents, does nothing without mesh.normals. Split vertices are appended to vertices and normals, and
+	// the indices of the mirrored triangles are pointed at them, LODs included
+	static Statistics Generate(MeshData& mesh);
+
+	static bool IsSimdAvailable();
+	static void SetSimdEnabled(bool enabled); // Benchmarking only, not thread safe
+};
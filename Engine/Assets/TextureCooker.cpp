@@ -0,0 +1,228 @@
+#include "TextureCooker.h"
+#include "ContentHash.h"
+#include "DdsFile.h"
+#include "ImageDecoder.h"
+#include "JsonReader.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "../FileHelper.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+
+const char* const TextureManifest::FileName = "textures.manifest.json";
+
+namespace
+{
+	std::string JoinPath(const std::string& directory, const std::string& path)
+	{
+		return directory.empty() ? path : directory + "/" + path;
+	}
+
+	void AppendString(std::string& json, const std::string& value)
+	{
+		json += '"';
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+			{
+				json += '\\';
+				json += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escape[8];
+				snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned char>(c));
+				json += escape;
+			}
+			else
+			{
+				json += c;
+			}
+		}
+		json += '"';
+	}
+
+	bool ParseTexture(JsonReader& reader, CookedTexture& texture)
+	{
+		std::string hash;
+		uint32_t format = 0;
+		uint32_t mipLevels = 1;
+		bool parsed = reader.ForEachMember([&]()
+		{
+			if (reader.StringEquals("source"))
+				return reader.NextString(texture.source);
+			if (reader.StringEquals("cooked"))
+				return reader.NextString(texture.cooked);
+			if (reader.StringEquals("sourceHash"))
+				return reader.NextString(hash);
+			if (reader.StringEquals("settings"))
+				return reader.NextString(texture.settings);
+			if (reader.StringEquals("format"))
+				return reader.NextUInt(format);
+			if (reader.StringEquals("width"))
+				return reader.NextUInt(texture.description.width);
+			if (reader.StringEquals("height"))
+				return reader.NextUInt(texture.description.height);
+			if (reader.StringEquals("mipLevels"))
+				return reader.NextUInt(mipLevels);
+			return reader.SkipValue();
+		});
+		texture.description.format = static_cast<PixelFormat>(format);
+		texture.description.mipLevels = static_cast<uint16_t>(std::min(mipLevels, 0xffffu));
+		// An entry without a hash never matches a source, so the texture is cooked again
+		if (!ContentHash::FromHex(hash, texture.sourceHash))
+			texture.sourceHash = 0;
+		return parsed;
+	}
+}
+
+std::string TextureCookSettings::GetName() const
+{
+	return this->compress ? BlockCompressor::GetQualityName(this->quality) : "none";
+}
+
+bool TextureManifest::Read(const std::string& filepath)
+{
+	this->textures.clear();
+	if (!FileHelper::FileExists(filepath))
+		return true;
+
+	MappedFile file;
+	if (!file.Open(filepath))
+		return false;
+
+	JsonReader reader(reinterpret_cast<const char*>(file.Data()), file.Size());
+	if (reader.Next() != JsonToken::ObjectStart)
+		return false;
+
+	uint32_t version = 0;
+	bool parsed = reader.ForEachMember([&]()
+	{
+		if (reader.StringEquals("version"))
+			return reader.NextUInt(version);
+		if (!reader.StringEquals("textures"))
+			return reader.SkipValue();
+		if (reader.Next() != JsonToken::ArrayStart)
+			return false;
+		for (;;)
+		{
+			JsonToken token = reader.Next();
+			if (token == JsonToken::ArrayEnd)
+				return true;
+			if (token != JsonToken::ObjectStart)
+				return false;
+			CookedTexture texture;
+			if (!ParseTexture(reader, texture))
+				return false;
+			if (!texture.source.empty() && !texture.cooked.empty())
+				this->textures.push_back(texture);
+		}
+	});
+
+	// A manifest from another version is as good as none, every texture gets cooked again
+	if (!parsed || reader.Next() != JsonToken::End)
+	{
+		this->textures.clear();
+		return false;
+	}
+	if (version != Version)
+		this->textures.clear();
+	return true;
+}
+
+bool TextureManifest::Write(const std::string& filepath) const
+{
+	std::string json = "{\n\t\"version\": " + std::to_string(Version) + ",\n\t\"textures\": [";
+	for (size_t i = 0; i < this->textures.size(); i++)
+	{
+		const CookedTexture& texture = this->textures[i];
+		json += i == 0 ? "\n\t\t{ \"source\": " : ",\n\t\t{ \"source\": ";
+		AppendString(json, texture.source);
+		json += ", \"cooked\": ";
+		AppendString(json, texture.cooked);
+		json += ", \"sourceHash\": \"" + ContentHash::ToHex(texture.sourceHash) + "\", \"settings\": ";
+		AppendString(json, texture.settings);
+		json += ", \"format\": " + std::to_string(static_cast<uint32_t>(texture.description.format));
+		json += ", \"width\": " + std::to_string(texture.description.width);
+		json += ", \"height\": " + std::to_string(texture.description.height);
+		json += ", \"mipLevels\": " + std::to_string(texture.description.mipLevels) + " }";
+	}
+	json += this->textures.empty() ? "]\n}\n" : "\n\t]\n}\n";
+	return FileHelper::WriteFileAtomic(filepath, json.data(), json.size());
+}
+
+const CookedTexture* TextureManifest::Find(const std::string& source) const
+{
+	for (const CookedTexture& texture : this->textures)
+	{
+		if (texture.source == source)
+			return &texture;
+	}
+	return nullptr;
+}
+
+void TextureManifest::Set(const CookedTexture& texture)
+{
+	for (CookedTexture& existing : this->textures)
+	{
+		if (existing.source == texture.source)
+		{
+			existing = texture;
+			return;
+		}
+	}
+	this->textures.push_back(texture);
+}
+
+bool TextureCooker::Process(ImageData& image, const std::string& filepath, const TextureCookSettings& settings, ThreadPool& pool)
+{
+	// The format only looks at the top level, so it can be picked before the mips are there
+	const PixelFormat blockFormat = ImageDescription::GetBytesPerPixel(image.description.format) > 0 ?
+		BlockCompressor::ChooseFormat(filepath, image, settings.quality) : PixelFormat::Unknown;
+	return Process(image, MipGenerator::GetSettingsForFile(filepath), blockFormat, settings, pool);
+}
+
+bool TextureCooker::Process(ImageData& image, const MipSettings& mipSettings, PixelFormat blockFormat, const TextureCookSettings& settings, ThreadPool& pool)
+{
+	if (ImageDescription::GetBytesPerPixel(image.description.format) == 0)
+		return false;
+
+	bool changed = MipGenerator::GetLevelCount(image.description.width, image.description.height) > 1 &&
+		MipGenerator::Generate(image, mipSettings, pool);
+
+	// D3D12 wants block compressed textures a whole number of blocks across at the top level
+	ImageData compressed;
+	if (settings.compress && ImageDescription::IsBlockCompressed(blockFormat) && image.description.width % 4 == 0 && image.description.height % 4 == 0 &&
+		BlockCompressor::Compress(image, blockFormat, settings.quality, compressed, pool))
+	{
+		image = std::move(compressed);
+		changed = true;
+	}
+	return changed;
+}
+
+bool TextureCooker::Process(ImageData& image, const std::string& filepath, const TextureCookSettings& settings)
+{
+	ThreadPool singleThread(0);
+	return Process(image, filepath, settings, singleThread);
+}
+
+bool TextureCooker::Cook(const std::string& sourcePath, const std::string& cookedPath, const TextureCookSettings& settings, ThreadPool& pool, ImageDescription& description)
+{
+	std::vector<uint8_t> data;
+	ImageData image;
+	if (!FileHelper::ReadFile(sourcePath, data) || !ImageDecoder::Decode(data.data(), data.size(), image, pool))
+		return false;
+
+	Process(image, sourcePath, settings, pool);
+	if (!DdsWriter::Write(cookedPath, image))
+		return false;
+	description = image.description;
+	return true;
+}
+
+bool TextureCooker::IsUpToDate(const CookedTexture& texture, const std::string& directory, uint64_t sourceHash, const TextureCookSettings& settings)
+{
+	return texture.sourceHash == sourceHash && texture.settings == settings.GetName() && FileHelper::FileExists(JoinPath(directory, texture.cooked));
+}
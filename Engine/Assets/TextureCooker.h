@@ -0,0 +1,74 @@
+#pragma once
+#include "BlockCompressor.h"
+#include "ImageData.h"
+#include "MipGenerator.h"
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+struct TextureCookSettings
+{
+	bool compress = true; // Block compress after the mips, only for images a whole number of blocks across
+	BlockQuality quality = BlockQuality::Normal;
+
+	// "none" or the quality name. Part of the DerivedDataCache key and stored in the manifest, so a cook with other
+	// settings redoes the texture
+	std::string GetName() const;
+};
+
+// One texture of a TextureManifest
+struct CookedTexture
+{
+	std::string source; // File names relative to the manifest
+	std::string cooked;
+	uint64_t sourceHash = 0; // ContentHash of the source when it was cooked
+	std::string settings; // TextureCookSettings::GetName
+	ImageDescription description;
+};
+
+// What the asset tool cooked in one directory (textures.manifest.json next to the textures). Tools read it to skip
+// textures that are up to date and to list what a directory ships with, the runtime does not need it to load one:
+//
+//   { "version": 1, "textures": [ { "source": "Catalina.jpg", "cooked": "Catalina.dds", "sourceHash": "<16 hex digits>",
+//     "settings": "normal", "format": 71, "width": 2048, "height": 1024, "mipLevels": 12 } ] }
+//
+// format is the DXGI_FORMAT
+class TextureManifest
+{
+public:
+	static const char* const FileName;
+	static const uint32_t Version = 1;
+
+	// An empty manifest when the file does not exist
+	bool Read(const std::string& filepath);
+	bool Write(const std::string& filepath) const;
+
+	const std::vector<CookedTexture>& GetTextures() const { return this->textures; }
+	const CookedTexture* Find(const std::string& source) const;
+	// Replaces the entry with the same source, or adds one
+	void Set(const CookedTexture& texture);
+
+private:
+	std::vector<CookedTexture> textures;
+};
+
+// Turns source images into DDS files (see DdsFile.h) the runtime maps and uploads without decoding anything
+class TextureCooker
+{
+public:
+	// Mip chain and block compression in place, the steps LoadImageDataFromFile runs on a freshly decoded image.
+	// filepath picks the filtering and the block format. Images that are already block compressed are left alone, and
+	// only R8G8B8A8_UNORM and R8_UNORM ones get compressed. Returns whether image changed
+	static bool Process(ImageData& image, const std::string& filepath, const TextureCookSettings& settings, ThreadPool& pool);
+	static bool Process(ImageData& image, const std::string& filepath, const TextureCookSettings& settings);
+	// Same with the mip settings and block format given instead of picked from the file name. Unknown blockFormat
+	// only builds the mips
+	static bool Process(ImageData& image, const MipSettings& mipSettings, PixelFormat blockFormat, const TextureCookSettings& settings, ThreadPool& pool);
+
+	// Decodes sourcePath (see ImageDecoder), processes it and writes the DDS to cookedPath. description is what was written
+	static bool Cook(const std::string& sourcePath, const std::string& cookedPath, const TextureCookSettings& settings, ThreadPool& pool, ImageDescription& description);
+
+	// Whether the manifest entry still matches the source file and the settings, and the cooked file is there
+	static bool IsUpToDate(const CookedTexture& texture, const std::string& directory, uint64_t sourceHash, const TextureCookSettings& settings);
+};
@@ -0,0 +1,170 @@
+#include "TextureDownscaler.h"
+#include "MipGenerator.h"
+#include "../StringHelper.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+	const size_t CategoryCount = static_cast<size_t>(TextureCategory::Count);
+
+	bool ParseTier(const std::string& text, TextureTier& tier)
+	{
+		for (TextureTier candidate : { TextureTier::Full, TextureTier::Half, TextureTier::Quarter })
+		{
+			if (text == TextureTierSettings::GetTierName(candidate))
+			{
+				tier = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+TextureTier TextureTierSettings::GetTier(TextureCategory category) const
+{
+	const size_t index = static_cast<size_t>(category);
+	return index < CategoryCount ? std::max(this->tier, this->categoryTiers[index]) : this->tier;
+}
+
+bool TextureTierSettings::IsFull() const
+{
+	for (size_t i = 0; i < CategoryCount; i++)
+	{
+		if (GetTier(static_cast<TextureCategory>(i)) != TextureTier::Full)
+			return false;
+	}
+	return true;
+}
+
+bool TextureTierSettings::Parse(const std::string& text)
+{
+	TextureTierSettings settings;
+	size_t start = 0;
+	while (start <= text.size())
+	{
+		size_t end = text.find(',', start);
+		end = end == std::string::npos ? text.size() : end;
+		const std::string entry = text.substr(start, end - start);
+		start = end + 1;
+
+		const size_t equals = entry.find('=');
+		if (equals == std::string::npos)
+		{
+			if (!ParseTier(entry, settings.tier))
+				return false;
+			continue;
+		}
+		const std::string category = entry.substr(0, equals);
+		size_t index = 0;
+		while (index < CategoryCount && category != GetCategoryName(static_cast<TextureCategory>(index)))
+			index++;
+		if (index == CategoryCount || !ParseTier(entry.substr(equals + 1), settings.categoryTiers[index]))
+			return false;
+	}
+	*this = settings;
+	return true;
+}
+
+std::string TextureTierSettings::GetName() const
+{
+	std::string name = GetTierName(this->tier);
+	for (size_t i = 0; i < CategoryCount; i++)
+	{
+		if (this->categoryTiers[i] > this->tier)
+			name += std::string(",") + GetCategoryName(static_cast<TextureCategory>(i)) + "=" + GetTierName(this->categoryTiers[i]);
+	}
+	return name;
+}
+
+TextureCategory TextureTierSettings::GetCategoryForFile(const std::string& filepath)
+{
+	static const char* const dataMaps[] = { "roughness", "gloss", "metalness", "metallic", "ao", "cavity", "bump", "displacement", "height" };
+	static const char* const maskMaps[] = { "opacity", "mask" };
+	for (const std::string& word : StringHelper::GetFileNameWords(filepath))
+	{
+		if (word == "normal")
+			return TextureCategory::Normal;
+		for (const char* name : dataMaps)
+		{
+			if (word == name)
+				return TextureCategory::Data;
+		}
+		for (const char* name : maskMaps)
+		{
+			if (word == name)
+				return TextureCategory::Mask;
+		}
+	}
+	return TextureCategory::Color;
+}
+
+const char* TextureTierSettings::GetTierName(TextureTier tier)
+{
+	switch (tier)
+	{
+	case TextureTier::Half: return "half";
+	case TextureTier::Quarter: return "quarter";
+	default: return "full";
+	}
+}
+
+const char* TextureTierSettings::GetCategoryName(TextureCategory category)
+{
+	switch (category)
+	{
+	case TextureCategory::Normal: return "normal";
+	case TextureCategory::Data: return "data";
+	case TextureCategory::Mask: return "mask";
+	default: return "color";
+	}
+}
+
+uint32_t TextureDownscaler::GetDroppableLevels(const ImageDescription& description, uint32_t levels)
+{
+	if (description.width == 0 || description.height == 0 || description.depthOrArraySize != 1)
+		return 0;
+	const bool blockCompressed = ImageDescription::IsBlockCompressed(description.format);
+	if (description.mipLevels == 1)
+	{
+		if (blockCompressed || ImageDescription::GetBytesPerPixel(description.format) == 0)
+			return 0;
+		return std::min(levels, MipGenerator::GetLevelCount(description.width, description.height) - 1);
+	}
+
+	levels = std::min(levels, description.mipLevels - 1u);
+	if (blockCompressed)
+	{
+		while (levels > 0 && (description.GetLevelWidth(levels) % 4 != 0 || description.GetLevelHeight(levels) % 4 != 0))
+			levels--;
+	}
+	return levels;
+}
+
+uint32_t TextureDownscaler::Apply(ImageData& image, uint32_t levels, const MipSettings& settings, ThreadPool& pool)
+{
+	ImageDescription& description = image.description;
+	levels = GetDroppableLevels(description, levels);
+	if (levels == 0 || image.pixels.size() < description.GetSize())
+		return 0;
+
+	if (description.mipLevels == 1)
+		return MipGenerator::Downscale(image, levels, settings, pool) ? levels : 0;
+
+	// The levels below are there already, they move to the front
+	const size_t offset = static_cast<size_t>(description.GetLevelOffset(levels));
+	const uint32_t rowPitch = description.GetLevelRowPitch(levels);
+	image.pixels.erase(image.pixels.begin(), image.pixels.begin() + offset);
+	description.width = description.GetLevelWidth(levels);
+	description.height = description.GetLevelHeight(levels);
+	description.rowPitch = rowPitch;
+	description.mipLevels = static_cast<uint16_t>(description.mipLevels - levels);
+	image.pixels.resize(description.GetSize());
+	return levels;
+}
+
+uint32_t TextureDownscaler::Apply(ImageData& image, TextureTier tier, const std::string& filepath, ThreadPool& pool)
+{
+	return Apply(image, static_cast<uint32_t>(tier), MipGenerator::GetSettingsForFile(filepath), pool);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "ImageData.h"
+#include <string>
+
+class ThreadPool;
+struct MipSettings;
+
+// Resolution textures are loaded at, for machines with little video memory and headless runs that never look at
+// the result. Every tier halves the texture once more
+enum class TextureTier : uint32_t
+{
+	Full = 0,
+	Half = 1,
+	Quarter = 2,
+};
+
+// What a texture is for, from its file name the way MipGenerator::GetSettingsForFile reads it
+enum class TextureCategory : uint32_t
+{
+	Color = 0, // Albedo and anything else with sRGB color
+	Normal,
+	Data, // Roughness, metalness, ambient occlusion, height and other linear maps
+	Mask, // Opacity and masks used for alpha testing
+	Count,
+};
+
+// A tier for every texture and one per category on top, the lower resolution of the two wins
+struct TextureTierSettings
+{
+	TextureTier tier = TextureTier::Full;
+	TextureTier categoryTiers[static_cast<size_t>(TextureCategory::Count)] = {};
+
+	TextureTier GetTier(TextureCategory category) const;
+	TextureTier GetTier(const std::string& filepath) const { return GetTier(GetCategoryForFile(filepath)); }
+	bool IsFull() const;
+
+	// "full", "half" or "quarter" for every texture, then "<category>=<tier>" for single categories, separated by
+	// commas: "half,normal=quarter". The name is the same form, part of the DerivedDataCache key of loaded textures
+	bool Parse(const std::string& text);
+	std::string GetName() const;
+
+	static TextureCategory GetCategoryForFile(const std::string& filepath);
+	static const char* GetTierName(TextureTier tier);
+	static const char* GetCategoryName(TextureCategory category);
+};
+
+// Brings an image down to its tier right after it was decoded or mapped, before the mips, the block compression and
+// the upload, which all get cheaper by the same factor as the memory
+class TextureDownscaler
+{
+public:
+	// How many top levels description can lose, at most levels. An image with mips gives up levels it already has,
+	// block compressed ones only as long as the new top level is whole blocks across. A single level image is filtered
+	// down instead, unless it is block compressed
+	static uint32_t GetDroppableLevels(const ImageDescription& description, uint32_t levels);
+
+	// Drops the top levels of image, see GetDroppableLevels. The filtering of single level images is
+	// MipGenerator::Downscale with settings. Returns the levels dropped
+	static uint32_t Apply(ImageData& image, uint32_t levels, const MipSettings& settings, ThreadPool& pool);
+	static uint32_t Apply(ImageData& image, TextureTier tier, const std::string& filepath, ThreadPool& pool);
+};
@@ -0,0 +1,296 @@
+#include "TextureResidency.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+TextureResidency::TextureResidency(const Settings& settings, LevelLoader loader, ThreadPool& pool)
+	: settings(settings), loader(loader), pool(pool)
+{
+}
+
+TextureResidency::TextureResidency(const Settings& settings, LevelLoader loader)
+	: settings(settings), loader(loader), pool(ThreadPool::GetShared())
+{
+}
+
+TextureResidency::TextureId TextureResidency::Add(const ImageDescription& description)
+{
+	Texture texture;
+	texture.description = description;
+	texture.tailLevel = description.mipLevels > 0 ? description.mipLevels - 1u : 0u;
+	for (uint32_t level = 0; level < description.mipLevels; level++)
+	{
+		if (std::max(description.GetLevelWidth(level), description.GetLevelHeight(level)) <= this->settings.tailSize)
+		{
+			texture.tailLevel = level;
+			break;
+		}
+	}
+	// A block compressed texture has to be whole blocks across at its top level, and every level above one that is
+	// will be too
+	if (ImageDescription::IsBlockCompressed(description.format))
+	{
+		while (texture.tailLevel > 0 && (description.GetLevelWidth(texture.tailLevel) % 4 != 0 || description.GetLevelHeight(texture.tailLevel) % 4 != 0))
+			texture.tailLevel--;
+	}
+	texture.residentLevel = texture.tailLevel;
+	texture.wantedLevel = texture.tailLevel;
+
+	this->residentBytes += GetResidentSize(texture, texture.tailLevel);
+	this->textures.push_back(texture);
+	return static_cast<TextureId>(this->textures.size() - 1);
+}
+
+void TextureResidency::Touch(TextureId texture, uint32_t level)
+{
+	Texture& entry = this->textures[texture];
+	entry.touchedLevel = std::min(entry.touchedLevel, level);
+}
+
+uint32_t TextureResidency::GetDesiredLevel(const ImageDescription& description, float distance, float worldSize, const StreamingView& view)
+{
+	if (distance <= 0.0f || worldSize <= 0.0f)
+		return 0;
+
+	// Pixels the surface covers on screen against texels the texture has across it, every level halves the texels
+	const float pixels = worldSize / (2.0f * distance * std::tan(view.verticalFieldOfView * 0.5f)) * view.screenHeight;
+	const float texels = static_cast<float>(std::max(description.width, description.height));
+	const float level = std::log2(texels / std::max(pixels, 1e-6f)) + view.mipBias;
+	if (level <= 0.0f)
+		return 0;
+	const uint32_t lastLevel = description.mipLevels > 0 ? description.mipLevels - 1u : 0u;
+	return level >= static_cast<float>(lastLevel) ? lastLevel : static_cast<uint32_t>(level);
+}
+
+void TextureResidency::Update(std::vector<Change>& changes)
+{
+	changes.clear();
+	this->updateCount++;
+
+	for (Texture& texture : this->textures)
+	{
+		texture.change = -1;
+		if (texture.touchedLevel != ~0u)
+		{
+			texture.wantedLevel = std::max(std::min(texture.touchedLevel, texture.tailLevel), std::min(texture.failedLevel, texture.tailLevel));
+			texture.lastUsed = this->updateCount;
+			texture.touchedLevel = ~0u;
+		}
+		else
+		{
+			// Levels finer than the tail stay around as long as the budget has room, see MakeRoom
+			texture.wantedLevel = texture.tailLevel;
+		}
+	}
+
+	FinishLoads(changes);
+	// Evicts down to a budget that was lowered since the last Update
+	MakeRoom(0, ~0u, changes);
+	StartLoads(changes);
+
+	// A level that was loaded and evicted again in the same Update leaves nothing to do
+	changes.erase(std::remove_if(changes.begin(), changes.end(), [](const Change& change)
+	{
+		return change.residentLevel == change.previousLevel && change.loadedLevel == ~0u;
+	}), changes.end());
+}
+
+void TextureResidency::WaitForLoads()
+{
+	for (const std::shared_ptr<Load>& load : this->loads)
+	{
+		while (!load->done.load(std::memory_order_acquire))
+			std::this_thread::yield();
+	}
+}
+
+TextureResidency::Statistics TextureResidency::GetStatistics() const
+{
+	Statistics statistics = this->statistics;
+	statistics.budgetBytes = this->settings.budgetBytes;
+	statistics.residentBytes = this->residentBytes;
+	statistics.loadingBytes = this->loadingBytes;
+	statistics.textureCount = static_cast<uint32_t>(this->textures.size());
+	for (const Texture& texture : this->textures)
+	{
+		if (this->updateCount == 0 || texture.lastUsed != this->updateCount)
+			continue;
+		statistics.visibleCount++;
+		statistics.wantedBytes += GetResidentSize(texture, texture.wantedLevel);
+		if (texture.residentLevel > texture.wantedLevel)
+			statistics.missingLevels += texture.residentLevel - texture.wantedLevel;
+	}
+	return statistics;
+}
+
+uint64_t TextureResidency::GetResidentSize(const Texture& texture, uint32_t finestLevel) const
+{
+	uint64_t size = 0;
+	for (uint32_t level = finestLevel; level < texture.description.mipLevels; level++)
+		size += texture.description.GetLevelSize(level);
+	return size;
+}
+
+TextureResidency::Change& TextureResidency::GetChange(TextureId texture, std::vector<Change>& changes)
+{
+	Texture& entry = this->textures[texture];
+	if (entry.change < 0)
+	{
+		Change change;
+		change.texture = texture;
+		change.previousLevel = entry.residentLevel;
+		change.residentLevel = entry.residentLevel;
+		entry.change = static_cast<int>(changes.size());
+		changes.push_back(std::move(change));
+	}
+	return changes[entry.change];
+}
+
+bool TextureResidency::MakeRoom(uint64_t bytes, TextureId keep, std::vector<Change>& changes)
+{
+	auto fits = [&]() { return this->residentBytes + this->loadingBytes + bytes <= this->settings.budgetBytes; };
+	if (fits())
+		return true;
+
+	// Levels finer than a texture wants are a cache, the ones of the texture seen the longest ago go first and of
+	// those the texture with the most to give
+	std::vector<TextureId> candidates;
+	for (TextureId id = 0; id < this->textures.size(); id++)
+	{
+		const Texture& texture = this->textures[id];
+		if (id != keep && texture.residentLevel < texture.wantedLevel)
+			candidates.push_back(id);
+	}
+	std::sort(candidates.begin(), candidates.end(), [this](TextureId a, TextureId b)
+	{
+		const Texture& first = this->textures[a];
+		const Texture& second = this->textures[b];
+		if (first.lastUsed != second.lastUsed)
+			return first.lastUsed < second.lastUsed;
+		return first.wantedLevel - first.residentLevel > second.wantedLevel - second.residentLevel;
+	});
+
+	for (TextureId id : candidates)
+	{
+		Texture& texture = this->textures[id];
+		while (texture.residentLevel < texture.wantedLevel && !fits())
+		{
+			const uint64_t size = texture.description.GetLevelSize(texture.residentLevel);
+			Change& change = GetChange(id, changes);
+			if (change.loadedLevel == texture.residentLevel)
+			{
+				change.loadedLevel = ~0u;
+				change.data.clear();
+			}
+			texture.residentLevel++;
+			change.residentLevel = texture.residentLevel;
+			this->residentBytes -= size;
+			this->statistics.levelsEvicted++;
+			this->statistics.bytesEvicted += size;
+		}
+		if (fits())
+			return true;
+	}
+	return false;
+}
+
+void TextureResidency::FinishLoads(std::vector<Change>& changes)
+{
+	for (auto it = this->loads.begin(); it != this->loads.end();)
+	{
+		Load& load = **it;
+		if (!load.done.load(std::memory_order_acquire))
+		{
+			++it;
+			continue;
+		}
+
+		Texture& texture = this->textures[load.texture];
+		const uint64_t size = texture.description.GetLevelSize(load.level);
+		this->loadingBytes -= size;
+		texture.loading = false;
+
+		if (!load.succeeded)
+		{
+			// Stays at what it has rather than trying the same file every frame
+			this->statistics.loadsFailed++;
+			texture.failedLevel = load.level + 1;
+			texture.wantedLevel = std::max(texture.wantedLevel, std::min(texture.failedLevel, texture.tailLevel));
+		}
+		else if (load.level + 1 != texture.residentLevel || load.data.size() != size)
+		{
+			// The level below was evicted while this one loaded
+			this->statistics.loadsDiscarded++;
+		}
+		else
+		{
+			Change& change = GetChange(load.texture, changes);
+			texture.residentLevel = load.level;
+			change.residentLevel = load.level;
+			change.loadedLevel = load.level;
+			change.data = std::move(load.data);
+			this->residentBytes += size;
+			this->statistics.loadsCompleted++;
+			this->statistics.bytesLoaded += size;
+		}
+		it = this->loads.erase(it);
+	}
+}
+
+void TextureResidency::StartLoads(std::vector<Change>& changes)
+{
+	// Biggest deficit first, one level at a time so every texture sharpens coarse to fine. Textures not seen in this
+	// Update want their tail and never have a deficit
+	std::vector<TextureId> candidates;
+	for (TextureId id = 0; id < this->textures.size(); id++)
+	{
+		const Texture& texture = this->textures[id];
+		if (!texture.loading && texture.residentLevel > texture.wantedLevel)
+			candidates.push_back(id);
+	}
+	std::stable_sort(candidates.begin(), candidates.end(), [this](TextureId a, TextureId b)
+	{
+		const Texture& first = this->textures[a];
+		const Texture& second = this->textures[b];
+		return first.residentLevel - first.wantedLevel > second.residentLevel - second.wantedLevel;
+	});
+
+	bool limited = false;
+	for (TextureId id : candidates)
+	{
+		if (this->loads.size() >= this->settings.maxLoadsInFlight)
+			break;
+
+		Texture& texture = this->textures[id];
+		const uint32_t level = texture.residentLevel - 1;
+		const uint64_t size = texture.description.GetLevelSize(level);
+		// A smaller level further down the list may still fit
+		if (!MakeRoom(size, id, changes))
+		{
+			limited = true;
+			continue;
+		}
+
+		std::shared_ptr<Load> load = std::make_shared<Load>();
+		load->texture = id;
+		load->level = level;
+		texture.loading = true;
+		this->loadingBytes += size;
+		this->statistics.loadsStarted++;
+		this->loads.push_back(load);
+
+		LevelLoader loader = this->loader;
+		auto run = [load, loader]()
+		{
+			load->succeeded = loader(load->texture, load->level, load->data);
+			load->done.store(true, std::memory_order_release);
+		};
+		if (this->pool.GetWorkerCount() == 0)
+			run();
+		else
+			this->pool.Enqueue(run);
+	}
+	if (limited)
+		this->statistics.budgetLimitedUpdates++;
+}
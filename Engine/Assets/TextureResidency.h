@@ -0,0 +1,145 @@
+#pragma once
+#include "ImageData.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+
+// Where the scene is seen from, for picking the level a texture needs at some distance
+struct StreamingView
+{
+	float screenHeight = 1080.0f; // Pixels
+	float verticalFieldOfView = 0.785398f; // Radians, 45 degrees like the camera
+	float mipBias = 0.0f; // Added to every level, positive streams in less
+};
+
+// Decides which mip levels of every streamed texture are resident. Textures start out with only their tail, the
+// levels of tailSize texels and less, and whoever draws them says every frame which level they need (Touch). Update
+// then loads the finer levels one at a time on the pool, coarse to fine and biggest deficit first, and when the
+// budget runs out evicts levels nobody needs right now, least recently used texture first.
+//
+// Nothing in here touches the GPU, Update hands back what changed and the caller rebuilds its textures from that (see
+// TextureStreamer), which keeps the residency logic testable headless. A pool without workers loads inline, so a
+// simulated camera path gives the same results on every run (AssetTool -streamtextures).
+// Add, Touch and Update must be called from the same thread
+class TextureResidency
+{
+public:
+	typedef uint32_t TextureId;
+
+	// Runs on a worker thread. Fills data with one level laid out like ImageData, must be safe to call concurrently
+	typedef std::function<bool(TextureId texture, uint32_t level, std::vector<uint8_t>& data)> LevelLoader;
+
+	struct Settings
+	{
+		uint64_t budgetBytes = 256ull * 1024 * 1024; // Every resident level and the ones loading count against this
+		uint32_t tailSize = 128; // Levels no larger than this across are resident from Add on and never evicted
+		uint32_t maxLoadsInFlight = 4;
+	};
+
+	// What one Update did to a texture. Levels residentLevel and down are resident now, the GPU texture needs to be
+	// rebuilt with those and everything it had before apart from loadedLevel comes from the old one
+	struct Change
+	{
+		TextureId texture = 0;
+		uint32_t previousLevel = 0; // Finest level resident before the Update
+		uint32_t residentLevel = 0;
+		uint32_t loadedLevel = ~0u; // Level data holds, ~0u when nothing was loaded
+		std::vector<uint8_t> data;
+	};
+
+	struct Statistics
+	{
+		uint64_t budgetBytes = 0;
+		uint64_t residentBytes = 0; // Tails included
+		uint64_t loadingBytes = 0; // Levels in flight
+		uint64_t wantedBytes = 0; // What the textures visible in the last Update take at the level they want
+		uint32_t textureCount = 0;
+		uint32_t visibleCount = 0; // Touched before the last Update
+		uint32_t missingLevels = 0; // Levels visible textures want and do not have yet
+
+		// Since the start
+		uint32_t loadsStarted = 0;
+		uint32_t loadsCompleted = 0;
+		uint32_t loadsFailed = 0;
+		uint32_t loadsDiscarded = 0; // Finished after the texture stopped wanting the level
+		uint32_t levelsEvicted = 0;
+		uint32_t budgetLimitedUpdates = 0; // Updates that left a load waiting because nothing more could be evicted
+		uint64_t bytesLoaded = 0;
+		uint64_t bytesEvicted = 0;
+	};
+
+	TextureResidency(const Settings& settings, LevelLoader loader, ThreadPool& pool);
+	TextureResidency(const Settings& settings, LevelLoader loader);
+
+	const Settings& GetSettings() const { return this->settings; }
+	// Takes effect on the next Update, a smaller budget evicts down to it
+	void SetBudget(uint64_t budgetBytes) { this->settings.budgetBytes = budgetBytes; }
+
+	// The caller uploads the tail, levels GetTailLevel and down, when it creates the texture
+	TextureId Add(const ImageDescription& description);
+	uint32_t GetTailLevel(TextureId texture) const { return this->textures[texture].tailLevel; }
+	uint32_t GetResidentLevel(TextureId texture) const { return this->textures[texture].residentLevel; }
+	const ImageDescription& GetDescription(TextureId texture) const { return this->textures[texture].description; }
+	size_t GetTextureCount() const { return this->textures.size(); }
+
+	// texture is drawn this frame and needs level to look right. Several touches keep the finest level
+	void Touch(TextureId texture, uint32_t level);
+
+	// Level that keeps a texture at about one texel per pixel on a surface worldSize across (the texture covering it
+	// once) distance away
+	static uint32_t GetDesiredLevel(const ImageDescription& description, float distance, float worldSize, const StreamingView& view);
+
+	// Finishes loads, evicts and starts new loads. changes gets one entry per texture whose resident levels changed
+	void Update(std::vector<Change>& changes);
+
+	// Blocks until every load in flight has finished, they are picked up by the next Update
+	void WaitForLoads();
+
+	Statistics GetStatistics() const;
+
+private:
+	struct Load
+	{
+		TextureId texture = 0;
+		uint32_t level = 0;
+		std::vector<uint8_t> data;
+		bool succeeded = false;
+		std::atomic<bool> done;
+
+		Load() : done(false) {}
+	};
+
+	struct Texture
+	{
+		ImageDescription description;
+		uint32_t tailLevel = 0;
+		uint32_t residentLevel = 0;
+		uint32_t wantedLevel = 0; // Tail level when not visible
+		uint32_t touchedLevel = ~0u; // Finest level touched since the last Update, ~0u for none
+		uint32_t failedLevel = 0; // Levels finer than this are not loaded again after a failed load
+		uint64_t lastUsed = 0; // Update the texture was last visible in, the LRU key
+		bool loading = false;
+		int change = -1; // Index into the changes of the current Update
+	};
+
+	uint64_t GetResidentSize(const Texture& texture, uint32_t finestLevel) const;
+	Change& GetChange(TextureId texture, std::vector<Change>& changes);
+	// Evicts levels nobody wants until bytes more fit in the budget. Never evicts from keep
+	bool MakeRoom(uint64_t bytes, TextureId keep, std::vector<Change>& changes);
+	void FinishLoads(std::vector<Change>& changes);
+	void StartLoads(std::vector<Change>& changes);
+
+	Settings settings;
+	LevelLoader loader;
+	ThreadPool& pool;
+	std::vector<Texture> textures;
+	std::vector<std::shared_ptr<Load>> loads;
+	uint64_t updateCount = 0;
+	uint64_t residentBytes = 0;
+	uint64_t loadingBytes = 0;
+	Statistics statistics;
+};
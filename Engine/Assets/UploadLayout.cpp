@@ -0,0 +1,148 @@
+#include "UploadLayout.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define UPLOAD_LAYOUT_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	bool simdEnabled = true;
+
+	// Enough rows for a band to be worth a task, few enough that a 4K level splits over every worker
+	const size_t BytesPerBand = 1 << 20;
+
+	uint64_t AlignPlacement(uint64_t offset)
+	{
+		return (offset + UploadLayout::PlacementAlignment - 1) & ~static_cast<uint64_t>(UploadLayout::PlacementAlignment - 1);
+	}
+
+#ifdef UPLOAD_LAYOUT_SSE2
+	// Rows whose destination starts on 16 bytes, which the row pitch alignment makes every row of an upload buffer
+	void StreamRows(const uint8_t* source, size_t sourcePitch, uint8_t* destination, size_t destinationPitch, size_t rowSize, uint32_t rowCount)
+	{
+		const size_t wholeSize = rowSize & ~static_cast<size_t>(63);
+		for (uint32_t row = 0; row < rowCount; row++)
+		{
+			const uint8_t* from = source + row * sourcePitch;
+			uint8_t* to = destination + row * destinationPitch;
+			size_t i = 0;
+			for (; i < wholeSize; i += 64)
+			{
+				const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+				const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i + 16));
+				const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i + 32));
+				const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i + 48));
+				_mm_stream_si128(reinterpret_cast<__m128i*>(to + i), a);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(to + i + 16), b);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(to + i + 32), c);
+				_mm_stream_si128(reinterpret_cast<__m128i*>(to + i + 48), d);
+			}
+			for (; i + 16 <= rowSize; i += 16)
+				_mm_stream_si128(reinterpret_cast<__m128i*>(to + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i)));
+			if (i < rowSize)
+				memcpy(to + i, from + i, rowSize - i);
+		}
+		// Streaming stores are weakly ordered, the GPU may only be told about the buffer after they all landed
+		_mm_sfence();
+	}
+#endif
+}
+
+uint64_t UploadLayout::ComputeFootprints(const ImageDescription& description, uint32_t firstLevel, uint32_t levelCount, uint64_t baseOffset, SubresourceFootprint* footprints)
+{
+	const bool blockCompressed = ImageDescription::IsBlockCompressed(description.format);
+	uint64_t end = baseOffset;
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		const uint32_t level = firstLevel + i;
+		SubresourceFootprint& footprint = footprints[i];
+		footprint.width = description.GetLevelWidth(level);
+		footprint.height = description.GetLevelHeight(level);
+		if (blockCompressed)
+		{
+			footprint.width = (footprint.width + 3) & ~3u;
+			footprint.height = (footprint.height + 3) & ~3u;
+		}
+		footprint.rowCount = description.GetLevelRowCount(level);
+		// Computed rather than taken from GetLevelRowPitch, which is whatever the image says for the top level
+		footprint.rowSize = blockCompressed ? footprint.width / 4 * ImageDescription::GetBytesPerBlock(description.format) :
+			footprint.width * ImageDescription::GetBytesPerPixel(description.format);
+		footprint.rowPitch = AlignRowPitch(footprint.rowSize);
+		footprint.offset = i == 0 ? baseOffset : AlignPlacement(end);
+		end = footprint.offset + static_cast<uint64_t>(footprint.rowPitch) * (footprint.rowCount - 1) + footprint.rowSize;
+	}
+	return end - baseOffset;
+}
+
+void UploadLayout::CopyRows(const uint8_t* source, size_t sourcePitch, uint8_t* destination, size_t destinationPitch, size_t rowSize, uint32_t rowCount)
+{
+#ifdef UPLOAD_LAYOUT_SSE2
+	if (simdEnabled && rowSize >= 64 && (reinterpret_cast<uintptr_t>(destination) & 15) == 0 && (destinationPitch & 15) == 0)
+	{
+		StreamRows(source, sourcePitch, destination, destinationPitch, rowSize, rowCount);
+		return;
+	}
+#endif
+	if (sourcePitch == rowSize && destinationPitch == rowSize)
+	{
+		memcpy(destination, source, rowSize * rowCount);
+		return;
+	}
+	for (uint32_t row = 0; row < rowCount; row++)
+		memcpy(destination + row * destinationPitch, source + row * sourcePitch, rowSize);
+}
+
+void UploadLayout::CopyLevels(const ImageDescription& description, const uint8_t* pixels, uint32_t firstLevel, uint32_t levelCount, const SubresourceFootprint* footprints, uint8_t* upload, ThreadPool& pool)
+{
+	// Bands of every level in one list, so the small levels at the end of the chain do not each wait for the pool
+	struct Band
+	{
+		uint32_t index;
+		uint32_t firstRow;
+		uint32_t rowCount;
+	};
+	std::vector<Band> bands;
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		const SubresourceFootprint& footprint = footprints[i];
+		const uint32_t rowsPerBand = static_cast<uint32_t>(std::max<size_t>(BytesPerBand / std::max(footprint.rowPitch, 1u), 1));
+		for (uint32_t row = 0; row < footprint.rowCount; row += rowsPerBand)
+		{
+			Band band;
+			band.index = i;
+			band.firstRow = row;
+			band.rowCount = std::min(rowsPerBand, footprint.rowCount - row);
+			bands.push_back(band);
+		}
+	}
+
+	pool.ParallelFor(bands.size(), [&](size_t b)
+	{
+		const Band& band = bands[b];
+		const uint32_t level = firstLevel + band.index;
+		const SubresourceFootprint& footprint = footprints[band.index];
+		const size_t sourcePitch = description.GetLevelRowPitch(level);
+		const uint8_t* source = pixels + description.GetLevelOffset(level) + band.firstRow * sourcePitch;
+		uint8_t* destination = upload + footprint.offset + static_cast<size_t>(band.firstRow) * footprint.rowPitch;
+		CopyRows(source, sourcePitch, destination, footprint.rowPitch, std::min<size_t>(footprint.rowSize, sourcePitch), band.rowCount);
+	});
+}
+
+bool UploadLayout::IsSimdAvailable()
+{
+#ifdef UPLOAD_LAYOUT_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+void UploadLayout::SetSimdEnabled(bool enabled)
+{
+	simdEnabled = enabled;
+}
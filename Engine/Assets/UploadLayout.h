@@ -0,0 +1,47 @@
+#pragma once
+#include "ImageData.h"
+#include <cstddef>
+
+class ThreadPool;
+
+// Where one mip level of a texture goes in an upload buffer, the numbers ID3D12Device::GetCopyableFootprints gives
+// in its layouts, row counts and row sizes
+struct SubresourceFootprint
+{
+	uint64_t offset = 0; // From the start of the buffer
+	uint32_t width = 0; // Texels, whole blocks for block compressed formats
+	uint32_t height = 0;
+	uint32_t rowPitch = 0; // Bytes from one row to the next
+	uint32_t rowCount = 0; // Rows of blocks for block compressed formats
+	uint32_t rowSize = 0; // Bytes of a row that hold texels, the rest up to rowPitch is padding
+};
+
+// The layout textures are uploaded in, worked out on the CPU so headless code can fill an upload buffer without a
+// device: rows start on RowPitchAlignment bytes, levels on PlacementAlignment, and the last row of a level is not
+// padded. Images keep their rows tightly packed (see ImageDescription), and CopyLevels copies them into this layout
+// on the way to the upload heap. That is the only copy a cooked DDS makes. A decoded JPEG or PNG is copied on the CPU
+// before that, since its mips, block compression and DerivedDataCache entry all work on the packed image (see
+// Graphics::LoadImageDataFromFile). ImageDecoder::DecodeInto can write at an upload row pitch, the texture path does
+// not use it for that.
+//
+// CopyRows uses SSE2 streaming stores. Upload heaps are write combined memory the CPU never reads back, stores that
+// go around the cache fill whole lines without reading them first
+class UploadLayout
+{
+public:
+	static const uint32_t RowPitchAlignment = 256; // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+	static const uint32_t PlacementAlignment = 512; // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+	// Footprints of levelCount levels of description from firstLevel on, the first one at baseOffset. Returns the
+	// bytes the levels take from baseOffset to the end of the last row, what GetCopyableFootprints calls the total
+	static uint64_t ComputeFootprints(const ImageDescription& description, uint32_t firstLevel, uint32_t levelCount, uint64_t baseOffset, SubresourceFootprint* footprints);
+	static uint32_t AlignRowPitch(uint32_t rowSize) { return (rowSize + RowPitchAlignment - 1) & ~(RowPitchAlignment - 1); }
+
+	static void CopyRows(const uint8_t* source, size_t sourcePitch, uint8_t* destination, size_t destinationPitch, size_t rowSize, uint32_t rowCount);
+	// Levels firstLevel to firstLevel + levelCount of pixels, laid out the way description says, to their footprints
+	// in upload. Bands of rows run on the pool
+	static void CopyLevels(const ImageDescription& description, const uint8_t* pixels, uint32_t firstLevel, uint32_t levelCount, const SubresourceFootprint* footprints, uint8_t* upload, ThreadPool& pool);
+
+	static bool IsSimdAvailable();
+	static void SetSimdEnabled(bool enabled); // Benchmarking only, not thread safe
+};
@@ -0,0 +1,102 @@
+#include "UploadRing.h"
+#include <algorithm>
+#include <utility>
+
+UploadRing::UploadRing(uint64_t pageSize, CreatePageFunction createPage)
+	: pageSize(pageSize), createPage(std::move(createPage))
+{
+}
+
+void UploadRing::BeginFrame(uint64_t completedValue)
+{
+	while (!this->retiredPages.empty() && this->retiredPages.front().fenceValue <= completedValue)
+	{
+		this->freePages.push_back(this->retiredPages.front().page);
+		this->retiredPages.pop_front();
+	}
+	this->statistics.pagesInFlight = static_cast<uint32_t>(this->retiredPages.size());
+	this->statistics.frameBytes = 0;
+	this->statistics.frameAllocations = 0;
+}
+
+bool UploadRing::Allocate(uint64_t size, uint64_t alignment, UploadAllocation& allocation)
+{
+	if (size == 0 || size > this->pageSize || alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		this->statistics.failedAllocations++;
+		return false;
+	}
+
+	uint64_t offset = 0;
+	bool newPage = false;
+	for (;;)
+	{
+		if (this->hasCurrentPage)
+		{
+			// Aligned on the GPU address, that is what the alignment rules are about
+			const uint64_t base = this->pages[this->framePages.back()].gpu;
+			offset = ((base + this->currentOffset + alignment - 1) & ~(alignment - 1)) - base;
+			if (offset + size <= this->pageSize)
+				break;
+		}
+		// A page less aligned than asked for may not fit it even empty
+		if (newPage || !NextPage())
+		{
+			this->statistics.failedAllocations++;
+			return false;
+		}
+		newPage = true;
+	}
+
+	const UploadAllocation& page = this->pages[this->framePages.back()];
+	allocation.cpu = page.cpu + offset;
+	allocation.gpu = page.gpu + offset;
+	allocation.size = size;
+	this->statistics.frameBytes += offset + size - this->currentOffset;
+	this->statistics.frameAllocations++;
+	this->statistics.peakFrameBytes = std::max(this->statistics.peakFrameBytes, this->statistics.frameBytes);
+	this->currentOffset = offset + size;
+	return true;
+}
+
+void UploadRing::EndFrame(uint64_t fenceValue)
+{
+	// A value that did not grow would free the pages with the ones of an earlier frame
+	fenceValue = std::max(fenceValue, this->lastFenceValue);
+	this->lastFenceValue = fenceValue;
+	for (uint32_t page : this->framePages)
+	{
+		RetiredPage retired;
+		retired.page = page;
+		retired.fenceValue = fenceValue;
+		this->retiredPages.push_back(retired);
+	}
+	this->framePages.clear();
+	this->hasCurrentPage = false;
+	this->currentOffset = 0;
+	this->statistics.pagesInFlight = static_cast<uint32_t>(this->retiredPages.size());
+}
+
+bool UploadRing::NextPage()
+{
+	uint32_t page;
+	if (!this->freePages.empty())
+	{
+		page = this->freePages.back();
+		this->freePages.pop_back();
+	}
+	else
+	{
+		UploadAllocation created;
+		if (!this->createPage || !this->createPage(this->pageSize, created) || created.cpu == nullptr)
+			return false;
+		created.size = this->pageSize;
+		page = static_cast<uint32_t>(this->pages.size());
+		this->pages.push_back(created);
+		this->statistics.pageCount++;
+	}
+	this->framePages.push_back(page);
+	this->hasCurrentPage = true;
+	this->currentOffset = 0;
+	return true;
+}
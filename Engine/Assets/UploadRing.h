@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Memory the CPU writes and the GPU reads from, at the same offset through both addresses
+struct UploadAllocation
+{
+	uint8_t* cpu = nullptr;
+	uint64_t gpu = 0; // D3D12_GPU_VIRTUAL_ADDRESS
+	uint64_t size = 0;
+};
+
+// Sub-allocates per frame data like constant buffers out of pages of upload memory. Allocations bump through the
+// current page, a page that is full or was used when the frame ends is retired with the fence value the queue signals
+// after the frame's commands, and comes back once the fence has passed that value. When every page is still in flight
+// a new one is created, so the ring grows to what the frames in flight use and then stays there.
+//
+// Nothing in here touches the GPU, pages come from a CreatePageFunction and the fence values are passed in, which keeps
+// the retirement logic testable headless against a fake fence (AssetTool -uploadring). UploadHeapRing is the D3D12
+// side. Not thread safe
+class UploadRing
+{
+public:
+	static const uint64_t DefaultAlignment = 256; // D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+
+	// A page of size bytes, mapped for as long as the ring lives. cpu and gpu of page address its first byte
+	typedef std::function<bool(uint64_t size, UploadAllocation& page)> CreatePageFunction;
+
+	struct Statistics
+	{
+		uint32_t pageCount = 0; // Pages are kept until the ring is destroyed
+		uint32_t pagesInFlight = 0; // Retired and not passed by the fence yet
+		uint64_t frameBytes = 0; // Allocated since BeginFrame, alignment padding included
+		uint32_t frameAllocations = 0;
+
+		// Since the start
+		uint64_t peakFrameBytes = 0;
+		uint32_t failedAllocations = 0;
+	};
+
+	UploadRing(uint64_t pageSize, CreatePageFunction createPage);
+
+	uint64_t GetPageSize() const { return this->pageSize; }
+
+	// Pages retired with fence values up to completedValue are free again
+	void BeginFrame(uint64_t completedValue);
+	// size bytes at a multiple of alignment, a power of two. Fails for more than a page or when no page can be created
+	bool Allocate(uint64_t size, uint64_t alignment, UploadAllocation& allocation);
+	bool Allocate(uint64_t size, UploadAllocation& allocation) { return Allocate(size, DefaultAlignment, allocation); }
+	// Retires every page used since BeginFrame with fenceValue, which has to grow from frame to frame
+	void EndFrame(uint64_t fenceValue);
+
+	const Statistics& GetStatistics() const { return this->statistics; }
+
+private:
+	struct RetiredPage
+	{
+		uint32_t page;
+		uint64_t fenceValue;
+	};
+
+	bool NextPage();
+
+	uint64_t pageSize;
+	CreatePageFunction createPage;
+	std::vector<UploadAllocation> pages;
+	std::vector<uint32_t> freePages;
+	std::vector<uint32_t> framePages; // Used since BeginFrame, the current one last
+	std::deque<RetiredPage> retiredPages; // Oldest fence value first
+	uint64_t currentOffset = 0;
+	bool hasCurrentPage = false;
+	uint64_t lastFenceValue = 0;
+	Statistics statistics;
+};
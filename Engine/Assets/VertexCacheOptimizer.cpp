@@ -0,0 +1,268 @@
+#include "VertexCacheOptimizer.h"
+#include <cmath>
+
+namespace
+{
+	// Scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	const int MaxCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	struct ScoreTable
+	{
+		float cache[MaxCacheSize];
+		float valence[64];
+
+		ScoreTable()
+		{
+			for (int i = 0; i < MaxCacheSize; i++)
+			{
+				if (i < 3)
+				{
+					// The last triangle's vertices get a fixed score so we do not favour reusing them immediately
+					cache[i] = LastTriangleScore;
+				}
+				else
+				{
+					const float scaler = 1.0f / (MaxCacheSize - 3);
+					cache[i] = powf(1.0f - (i - 3) * scaler, CacheDecayPower);
+				}
+			}
+			for (int i = 0; i < 64; i++)
+				valence[i] = i == 0 ? 0.0f : ValenceBoostScale * powf(static_cast<float>(i), -ValenceBoostPower);
+		}
+	};
+
+	float VertexScore(const ScoreTable& table, int cachePosition, uint32_t remainingTriangles)
+	{
+		// Vertices with no triangles left will never be used again
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = cachePosition < 0 ? 0.0f : table.cache[cachePosition];
+		score += remainingTriangles < 64 ? table.valence[remainingTriangles] : ValenceBoostScale * powf(static_cast<float>(remainingTriangles), -ValenceBoostPower);
+		return score;
+	}
+}
+
+void VertexCacheOptimizer::Optimize(MeshData& mesh)
+{
+	OptimizeIndices(mesh.indices, mesh.vertices.size());
+
+	const size_t vertexCount = mesh.vertices.size();
+	std::vector<uint32_t> sourceVertices;
+	OptimizeVertexFetch(mesh.vertices, mesh.indices, &sourceVertices);
+	if (mesh.normals.size() == vertexCount)
+	{
+		std::vector<DirectX::XMFLOAT3> normals(sourceVertices.size());
+		for (size_t i = 0; i < sourceVertices.size(); i++)
+			normals[i] = mesh.normals[sourceVertices[i]];
+		mesh.normals.swap(normals);
+	}
+	if (mesh.tangents.size() == vertexCount)
+	{
+		std::vector<DirectX::XMFLOAT4> tangents(sourceVertices.size());
+		for (size_t i = 0; i < sourceVertices.size(); i++)
+			tangents[i] = mesh.tangents[sourceVertices[i]];
+		mesh.tangents.swap(tangents);
+	}
+}
+
+void VertexCacheOptimizer::OptimizeIndices(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount < 2 || vertexCount == 0)
+		return;
+
+	static const ScoreTable table;
+
+	// -- Build vertex to triangle adjacency -- //
+	std::vector<uint32_t> triangleCounts(vertexCount, 0); // Triangles still to be emitted per vertex
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		triangleCounts[indices[i]]++;
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + triangleCounts[v];
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int k = 0; k < 3; k++)
+				adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+		}
+	}
+
+	// -- Initial scores -- //
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = VertexScore(table, -1, triangleCounts[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+	size_t bestTriangle = 0;
+	for (size_t t = 1; t < triangleCount; t++)
+	{
+		if (triangleScores[t] > triangleScores[bestTriangle])
+			bestTriangle = t;
+	}
+
+	// -- Greedily emit the best scoring triangle -- //
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+
+	uint32_t cache[MaxCacheSize + 3];
+	int cacheCount = 0;
+	size_t scanCursor = 0; // Fallback search only ever moves forward, that is what keeps this linear
+
+	while (output.size() < triangleCount * 3)
+	{
+		emitted[bestTriangle] = true;
+		const uint32_t* triangle = &indices[bestTriangle * 3];
+		output.insert(output.end(), triangle, triangle + 3);
+
+		// Take the triangle out of its vertices' adjacency so valence reflects what is left
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle[k];
+			uint32_t* begin = &adjacency[adjacencyOffsets[v]];
+			uint32_t* end = begin + triangleCounts[v];
+			for (uint32_t* it = begin; it != end; ++it)
+			{
+				if (*it == bestTriangle)
+				{
+					*it = *(end - 1);
+					break;
+				}
+			}
+			triangleCounts[v]--;
+		}
+
+		// Move the triangle's vertices to the front of the LRU cache
+		uint32_t newCache[MaxCacheSize + 3];
+		int newCount = 0;
+		newCache[newCount++] = triangle[0];
+		if (triangle[1] != triangle[0])
+			newCache[newCount++] = triangle[1];
+		if (triangle[2] != triangle[0] && triangle[2] != triangle[1])
+			newCache[newCount++] = triangle[2]; // Degenerate triangles must not put a vertex in the cache twice
+		for (int i = 0; i < cacheCount; i++)
+		{
+			uint32_t v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache[newCount++] = v;
+		}
+
+		// Anything pushed past the end falls out of the cache
+		for (int i = MaxCacheSize; i < newCount; i++)
+		{
+			cachePositions[newCache[i]] = -1;
+			vertexScores[newCache[i]] = VertexScore(table, -1, triangleCounts[newCache[i]]);
+		}
+		cacheCount = newCount < MaxCacheSize ? newCount : MaxCacheSize;
+		for (int i = 0; i < cacheCount; i++)
+		{
+			cache[i] = newCache[i];
+			cachePositions[cache[i]] = i;
+			vertexScores[cache[i]] = VertexScore(table, i, triangleCounts[cache[i]]);
+		}
+
+		// Only triangles touching the cache changed score, the best next triangle is almost always among them
+		float bestScore = -1.0f;
+		bool found = false;
+		for (int i = 0; i < cacheCount; i++)
+		{
+			uint32_t v = cache[i];
+			for (uint32_t a = 0; a < triangleCounts[v]; a++)
+			{
+				uint32_t t = adjacency[adjacencyOffsets[v] + a];
+				float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				triangleScores[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+					found = true;
+				}
+			}
+		}
+
+		if (!found)
+		{
+			while (scanCursor < triangleCount && emitted[scanCursor])
+				scanCursor++;
+			if (scanCursor == triangleCount)
+				break;
+			bestTriangle = scanCursor;
+		}
+	}
+
+	// Keep any trailing indices that did not form a whole triangle
+	output.insert(output.end(), indices.begin() + triangleCount * 3, indices.end());
+	indices.swap(output);
+}
+
+void VertexCacheOptimizer::OptimizeVertexFetch(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices, std::vector<uint32_t>* sourceVertices)
+{
+	const uint32_t unused = 0xFFFFFFFF;
+	std::vector<uint32_t> remap(vertices.size(), unused);
+	std::vector<Vertex3D> reordered;
+	reordered.reserve(vertices.size());
+	if (sourceVertices != nullptr)
+	{
+		sourceVertices->clear();
+		sourceVertices->reserve(vertices.size());
+	}
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+			if (sourceVertices != nullptr)
+				sourceVertices->push_back(index);
+		}
+		index = remap[index];
+	}
+	vertices.swap(reordered);
+}
+
+VertexCacheOptimizer::Statistics VertexCacheOptimizer::Analyze(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	Statistics statistics;
+	statistics.triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	if (statistics.triangleCount == 0 || cacheSize == 0)
+		return statistics;
+
+	// Each vertex remembers when it entered the FIFO, it is still cached while fewer than cacheSize misses happened since
+	const uint32_t notCached = 0xFFFFFFFF;
+	std::vector<uint32_t> insertedAt(vertexCount, notCached);
+	uint32_t misses = 0;
+	uint32_t referenced = 0;
+	for (size_t i = 0; i < statistics.triangleCount * 3; i++)
+	{
+		uint32_t v = indices[i];
+		if (insertedAt[v] == notCached)
+			referenced++;
+		if (insertedAt[v] == notCached || misses - insertedAt[v] >= cacheSize)
+		{
+			insertedAt[v] = misses;
+			misses++;
+		}
+	}
+
+	statistics.vertexCount = referenced;
+	statistics.transformedVertices = misses;
+	statistics.acmr = static_cast<float>(misses) / statistics.triangleCount;
+	statistics.atvr = referenced > 0 ? static_cast<float>(misses) / referenced : 0.0f;
+	return statistics;
+}
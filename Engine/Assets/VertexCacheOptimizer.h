@@ -0,0 +1,27 @@
+#pragma once
+#include "MeshData.h"
+
+// Import time reordering of triangle lists so the GPU's post transform vertex cache gets as many hits as possible.
+// OptimizeIndices is Tom Forsyth's linear speed vertex cache optimisation, OptimizeVertexFetch then renumbers the
+// vertices in the order they are first referenced so vertex fetches walk memory front to back
+class VertexCacheOptimizer
+{
+public:
+	struct Statistics
+	{
+		uint32_t triangleCount = 0;
+		uint32_t vertexCount = 0; // Referenced vertices
+		uint32_t transformedVertices = 0; // Cache misses, ie. vertex shader invocations
+		float acmr = 0.0f; // Average cache miss ratio, transformed vertices per triangle. 0.5 is the best case, 3 the worst
+		float atvr = 0.0f; // Average transformed vertex ratio, transformed vertices per vertex. 1 is the best case
+	};
+
+	static void Optimize(MeshData& mesh);
+	static void OptimizeIndices(std::vector<uint32_t>& indices, size_t vertexCount);
+	// Drops vertices no triangle references. sourceVertices, if given, receives the old index of every new vertex
+	// so other per vertex streams can be reordered the same way
+	static void OptimizeVertexFetch(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices, std::vector<uint32_t>* sourceVertices = nullptr);
+
+	// Simulates a FIFO post transform cache of the given size over a triangle list
+	static Statistics Analyze(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize);
+};
@@ -0,0 +1,615 @@
+#include "VertexCompression.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define VERTEX_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	bool simdEnabled = true;
+
+	// Strides are in bytes, so every stream pointer is stepped through this
+	template <typename T>
+	T* Offset(T* pointer, size_t bytes)
+	{
+		return reinterpret_cast<T*>(reinterpret_cast<uintptr_t>(pointer) + bytes);
+	}
+
+	uint32_t AsUint(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	float AsFloat(uint32_t bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// Fabian Giesen's float to half conversion. Rounds to nearest with exact ties going away from zero instead of to even,
+	// overflow becomes infinity
+	uint16_t FloatToHalf(float value)
+	{
+		const uint32_t f32Infinity = 255 << 23;
+		const uint32_t f16Infinity = 31 << 23;
+		const float magic = AsFloat(15 << 23);
+		const uint32_t roundMask = ~0xFFFu;
+
+		uint32_t bits = AsUint(value);
+		uint32_t sign = bits & 0x80000000u;
+		bits ^= sign;
+
+		uint32_t half;
+		if (bits >= f32Infinity)
+		{
+			half = bits > f32Infinity ? 0x7E00 : 0x7C00; // NaN stays NaN
+		}
+		else
+		{
+			bits &= roundMask;
+			bits = AsUint(AsFloat(bits) * magic);
+			bits -= roundMask;
+			if (bits > f16Infinity)
+				bits = f16Infinity;
+			half = bits >> 13;
+		}
+		return static_cast<uint16_t>(half | (sign >> 16));
+	}
+
+	float HalfToFloat(uint16_t half)
+	{
+		const float magic = AsFloat((254 - 15) << 23);
+		const float infinityOrNaN = AsFloat((127 + 16) << 23);
+
+		float value = AsFloat(static_cast<uint32_t>(half & 0x7FFF) << 13) * magic;
+		uint32_t bits = AsUint(value);
+		if (value >= infinityOrNaN)
+			bits |= 255 << 23;
+		bits |= static_cast<uint32_t>(half & 0x8000) << 16;
+		return AsFloat(bits);
+	}
+
+	// The comparisons are written so NaN ends up at the low end, the same way _mm_max_ps/_mm_min_ps treat it
+	float Clamp(float value, float low, float high)
+	{
+		value = value > low ? value : low;
+		return value < high ? value : high;
+	}
+
+	float Sign(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	void OctahedralEncode(const float* direction, int16_t* output)
+	{
+		float l1 = fabsf(direction[0]) + fabsf(direction[1]) + fabsf(direction[2]);
+		float inverse = l1 > 0.0f ? 1.0f / l1 : 0.0f;
+		float u = direction[0] * inverse;
+		float v = direction[1] * inverse;
+		if (direction[2] < 0.0f)
+		{
+			// Fold the lower hemisphere over the diagonals
+			float foldedU = (1.0f - fabsf(v)) * Sign(u);
+			float foldedV = (1.0f - fabsf(u)) * Sign(v);
+			u = foldedU;
+			v = foldedV;
+		}
+		output[0] = static_cast<int16_t>(lrintf(Clamp(u, -1.0f, 1.0f) * 32767.0f));
+		output[1] = static_cast<int16_t>(lrintf(Clamp(v, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	void OctahedralDecode(const int16_t* input, float* direction)
+	{
+		float x = input[0] / 32767.0f;
+		float y = input[1] / 32767.0f;
+		x = x > -1.0f ? x : -1.0f;
+		y = y > -1.0f ? y : -1.0f;
+		float z = 1.0f - fabsf(x) - fabsf(y);
+		float t = -z > 0.0f ? -z : 0.0f;
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+		float length = sqrtf(x * x + y * y + z * z);
+		direction[0] = x / length;
+		direction[1] = y / length;
+		direction[2] = z / length;
+	}
+
+#ifdef VERTEX_COMPRESSION_SSE2
+	__m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	__m128 Abs(__m128 value)
+	{
+		return _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+	}
+
+	// Flips the sign bit like unary minus does, 0 - value would turn -0 into +0
+	__m128 Negate(__m128 value)
+	{
+		return _mm_xor_ps(value, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+	}
+
+	// Packs eight 32 bit lanes holding 0..65535 into unsigned 16 bit. SSE2 only has a signed saturating pack
+	__m128i PackUint16(__m128i a, __m128i b)
+	{
+		const __m128i bias = _mm_set1_epi32(32768);
+		return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(a, bias), _mm_sub_epi32(b, bias)), _mm_set1_epi16(static_cast<short>(0x8000)));
+	}
+
+	// Four lane version of FloatToHalf, same bits
+	__m128i FloatToHalf(__m128 value)
+	{
+		const __m128i f32Infinity = _mm_set1_epi32(255 << 23);
+		const __m128 roundMask = _mm_castsi128_ps(_mm_set1_epi32(~0xFFF));
+		const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(15 << 23));
+		const __m128 clampValue = _mm_castsi128_ps(_mm_set1_epi32((31 << 23) - 0x1000));
+
+		__m128 sign = _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+		__m128 absolute = _mm_xor_ps(value, sign);
+		__m128i absoluteBits = _mm_castps_si128(absolute);
+		__m128i isNaN = _mm_cmpgt_epi32(absoluteBits, f32Infinity);
+		__m128i isFinite = _mm_cmpgt_epi32(f32Infinity, absoluteBits);
+		__m128i infinityOrNaN = _mm_or_si128(_mm_and_si128(isNaN, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7C00));
+
+		__m128 scaled = _mm_mul_ps(_mm_and_ps(absolute, roundMask), magic);
+		__m128 clamped = _mm_min_ps(scaled, clampValue);
+		__m128i finite = _mm_srli_epi32(_mm_sub_epi32(_mm_castps_si128(clamped), _mm_castps_si128(roundMask)), 13);
+
+		__m128i half = _mm_or_si128(_mm_and_si128(isFinite, finite), _mm_andnot_si128(isFinite, infinityOrNaN));
+		return _mm_or_si128(half, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+	}
+
+	// Takes halves in the low 16 bits of each lane
+	__m128 HalfToFloat(__m128i half)
+	{
+		const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+		__m128i exponentMantissa = _mm_and_si128(half, _mm_set1_epi32(0x7FFF));
+		__m128i sign = _mm_slli_epi32(_mm_xor_si128(half, exponentMantissa), 16);
+		__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exponentMantissa, 13)), magic);
+		__m128i wasInfinityOrNaN = _mm_cmpgt_epi32(exponentMantissa, _mm_set1_epi32(0x7BFF));
+		__m128 infinityOrNaN = _mm_and_ps(_mm_castsi128_ps(wasInfinityOrNaN), _mm_castsi128_ps(_mm_set1_epi32(255 << 23)));
+		return _mm_or_ps(scaled, _mm_or_ps(_mm_castsi128_ps(sign), infinityOrNaN));
+	}
+
+	uint32_t Load32(const void* source)
+	{
+		uint32_t value;
+		memcpy(&value, source, sizeof(value));
+		return value;
+	}
+
+	void Store32(void* destination, uint32_t value)
+	{
+		memcpy(destination, &value, sizeof(value));
+	}
+#endif
+}
+
+XMMATRIX PositionQuantization::GetDequantizeMatrix() const
+{
+	return XMMatrixScaling(this->extent.x, this->extent.y, this->extent.z) * XMMatrixTranslation(this->minimum.x, this->minimum.y, this->minimum.z);
+}
+
+float PositionQuantization::GetMaxError() const
+{
+	// Half a step on every axis
+	float x = this->extent.x / 65535.0f * 0.5f;
+	float y = this->extent.y / 65535.0f * 0.5f;
+	float z = this->extent.z / 65535.0f * 0.5f;
+	return sqrtf(x * x + y * y + z * z);
+}
+
+uint32_t VertexCompression::GetStride(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Compact:
+		return sizeof(Vertex3DCompact);
+	case VertexFormat::CompactLit:
+		return sizeof(Vertex3DCompactLit);
+	default:
+		return sizeof(Vertex3D);
+	}
+}
+
+VertexFormat VertexCompression::ChooseFormat(const MeshData& mesh, bool hasNormals, float maxPositionError)
+{
+	return ChooseFormat(mesh.vertices.data(), mesh.vertices.size(), hasNormals, maxPositionError);
+}
+
+VertexFormat VertexCompression::ChooseFormat(const Vertex3D* vertices, size_t count, bool hasNormals, float maxPositionError)
+{
+	if (count == 0)
+		return VertexFormat::Float;
+
+	PositionQuantization quantization = ComputeQuantization(&vertices[0].pos.x, sizeof(Vertex3D), count);
+	if (quantization.GetMaxError() > maxPositionError)
+		return VertexFormat::Float;
+	return hasNormals ? VertexFormat::CompactLit : VertexFormat::Compact;
+}
+
+PositionQuantization VertexCompression::ComputeQuantization(const float* positions, size_t stride, size_t count)
+{
+	PositionQuantization quantization;
+	if (count == 0)
+		return quantization;
+
+	float minimum[3] = { positions[0], positions[1], positions[2] };
+	float maximum[3] = { positions[0], positions[1], positions[2] };
+	for (size_t i = 1; i < count; i++)
+	{
+		const float* position = Offset(positions, i * stride);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minimum[axis] = position[axis] < minimum[axis] ? position[axis] : minimum[axis];
+			maximum[axis] = position[axis] > maximum[axis] ? position[axis] : maximum[axis];
+		}
+	}
+	quantization.minimum = XMFLOAT3(minimum[0], minimum[1], minimum[2]);
+	quantization.extent = XMFLOAT3(maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2]);
+	return quantization;
+}
+
+void VertexCompression::Compress(const MeshData& mesh, VertexFormat format, const float* normals, const float* tangents, CompressedVertices& output)
+{
+	Compress(mesh.vertices.data(), mesh.vertices.size(), format, normals, tangents, output);
+}
+
+void VertexCompression::Compress(const Vertex3D* vertices, size_t count, VertexFormat format, const float* normals, const float* tangents, CompressedVertices& output)
+{
+	output.format = format;
+	output.stride = GetStride(format);
+	output.vertexCount = static_cast<uint32_t>(count);
+	output.data.assign(count * output.stride, 0);
+	output.quantization = PositionQuantization();
+	if (count == 0)
+		return;
+
+	if (format == VertexFormat::Float)
+	{
+		memcpy(output.data.data(), vertices, count * sizeof(Vertex3D));
+		return;
+	}
+
+	output.quantization = ComputeQuantization(&vertices[0].pos.x, sizeof(Vertex3D), count);
+
+	if (format == VertexFormat::Compact)
+	{
+		Vertex3DCompact* packed = reinterpret_cast<Vertex3DCompact*>(output.data.data());
+		EncodePositions(&vertices[0].pos.x, sizeof(Vertex3D), count, output.quantization, packed[0].position, sizeof(Vertex3DCompact));
+		EncodeHalf2(&vertices[0].textCoord.x, sizeof(Vertex3D), count, packed[0].textCoord, sizeof(Vertex3DCompact));
+		return;
+	}
+
+	Vertex3DCompactLit* packed = reinterpret_cast<Vertex3DCompactLit*>(output.data.data());
+	EncodePositions(&vertices[0].pos.x, sizeof(Vertex3D), count, output.quantization, packed[0].position, sizeof(Vertex3DCompactLit));
+	EncodeHalf2(&vertices[0].textCoord.x, sizeof(Vertex3D), count, packed[0].textCoord, sizeof(Vertex3DCompactLit));
+
+	if (normals != nullptr)
+	{
+		EncodeOctahedral(normals, 3 * sizeof(float), count, packed[0].normal, sizeof(Vertex3DCompactLit));
+	}
+	else
+	{
+		// +Z is the centre of the octahedral square
+		for (size_t i = 0; i < count; i++)
+			packed[i].normal[0] = packed[i].normal[1] = 0;
+	}
+
+	if (tangents != nullptr)
+	{
+		EncodeOctahedral(tangents, 4 * sizeof(float), count, packed[0].tangent, sizeof(Vertex3DCompactLit));
+		for (size_t i = 0; i < count; i++)
+			packed[i].position[3] = tangents[i * 4 + 3] < 0.0f ? 0 : 65535;
+	}
+	else
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			packed[i].tangent[0] = 32767;
+			packed[i].tangent[1] = 0;
+		}
+	}
+}
+
+void VertexCompression::Decompress(const CompressedVertices& input, std::vector<Vertex3D>& vertices)
+{
+	vertices.resize(input.vertexCount);
+	if (input.vertexCount == 0)
+		return;
+
+	if (input.format == VertexFormat::Float)
+	{
+		memcpy(vertices.data(), input.data.data(), input.vertexCount * sizeof(Vertex3D));
+		return;
+	}
+
+	// position and textCoord sit at the same offsets in both packed layouts
+	const uint8_t* packed = input.data.data();
+	DecodePositions(reinterpret_cast<const uint16_t*>(packed + offsetof(Vertex3DCompact, position)), input.stride, input.vertexCount, input.quantization, &vertices[0].pos.x, sizeof(Vertex3D));
+	size_t textCoordOffset = input.format == VertexFormat::Compact ? offsetof(Vertex3DCompact, textCoord) : offsetof(Vertex3DCompactLit, textCoord);
+	DecodeHalf2(reinterpret_cast<const uint16_t*>(packed + textCoordOffset), input.stride, input.vertexCount, &vertices[0].textCoord.x, sizeof(Vertex3D));
+}
+
+void VertexCompression::EncodePositions(const float* input, size_t inputStride, size_t count, const PositionQuantization& quantization, uint16_t* output, size_t outputStride)
+{
+	const float scaleX = quantization.extent.x > 0.0f ? 65535.0f / quantization.extent.x : 0.0f;
+	const float scaleY = quantization.extent.y > 0.0f ? 65535.0f / quantization.extent.y : 0.0f;
+	const float scaleZ = quantization.extent.z > 0.0f ? 65535.0f / quantization.extent.z : 0.0f;
+	size_t i = 0;
+
+#ifdef VERTEX_COMPRESSION_SSE2
+	if (simdEnabled)
+	{
+		// One vertex per register, x y z in the low lanes and w forced to 65535
+		const __m128 minimum = _mm_set_ps(0.0f, quantization.minimum.z, quantization.minimum.y, quantization.minimum.x);
+		const __m128 scale = _mm_set_ps(0.0f, scaleZ, scaleY, scaleX);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 limit = _mm_set1_ps(65535.0f);
+		const __m128i w = _mm_set_epi32(65535, 0, 0, 0);
+		for (; i < count; i++)
+		{
+			const float* position = Offset(input, i * inputStride);
+			__m128 value = _mm_set_ps(0.0f, position[2], position[1], position[0]);
+			value = _mm_mul_ps(_mm_sub_ps(value, minimum), scale);
+			value = _mm_min_ps(_mm_max_ps(value, zero), limit);
+			__m128i quantized = _mm_or_si128(_mm_cvtps_epi32(value), w);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(Offset(output, i * outputStride)), PackUint16(quantized, quantized));
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const float* position = Offset(input, i * inputStride);
+		uint16_t* quantized = Offset(output, i * outputStride);
+		quantized[0] = static_cast<uint16_t>(lrintf(Clamp((position[0] - quantization.minimum.x) * scaleX, 0.0f, 65535.0f)));
+		quantized[1] = static_cast<uint16_t>(lrintf(Clamp((position[1] - quantization.minimum.y) * scaleY, 0.0f, 65535.0f)));
+		quantized[2] = static_cast<uint16_t>(lrintf(Clamp((position[2] - quantization.minimum.z) * scaleZ, 0.0f, 65535.0f)));
+		quantized[3] = 65535;
+	}
+}
+
+void VertexCompression::DecodePositions(const uint16_t* input, size_t inputStride, size_t count, const PositionQuantization& quantization, float* output, size_t outputStride)
+{
+	const float stepX = quantization.extent.x / 65535.0f;
+	const float stepY = quantization.extent.y / 65535.0f;
+	const float stepZ = quantization.extent.z / 65535.0f;
+	size_t i = 0;
+
+#ifdef VERTEX_COMPRESSION_SSE2
+	if (simdEnabled)
+	{
+		const __m128 minimum = _mm_set_ps(0.0f, quantization.minimum.z, quantization.minimum.y, quantization.minimum.x);
+		const __m128 step = _mm_set_ps(0.0f, stepZ, stepY, stepX);
+		const __m128i zero = _mm_setzero_si128();
+		for (; i < count; i++)
+		{
+			__m128i quantized = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(Offset(input, i * inputStride)));
+			__m128 value = _mm_cvtepi32_ps(_mm_unpacklo_epi16(quantized, zero));
+			value = _mm_add_ps(_mm_mul_ps(value, step), minimum);
+
+			float lanes[4];
+			_mm_storeu_ps(lanes, value);
+			float* position = Offset(output, i * outputStride);
+			position[0] = lanes[0];
+			position[1] = lanes[1];
+			position[2] = lanes[2];
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const uint16_t* quantized = Offset(input, i * inputStride);
+		float* position = Offset(output, i * outputStride);
+		position[0] = quantized[0] * stepX + quantization.minimum.x;
+		position[1] = quantized[1] * stepY + quantization.minimum.y;
+		position[2] = quantized[2] * stepZ + quantization.minimum.z;
+	}
+}
+
+void VertexCompression::EncodeHalf2(const float* input, size_t inputStride, size_t count, uint16_t* output, size_t outputStride)
+{
+	size_t i = 0;
+
+#ifdef VERTEX_COMPRESSION_SSE2
+	if (simdEnabled)
+	{
+		// Four vertices, eight halves per iteration
+		for (; i + 4 <= count; i += 4)
+		{
+			const float* a = Offset(input, i * inputStride);
+			const float* b = Offset(input, (i + 1) * inputStride);
+			const float* c = Offset(input, (i + 2) * inputStride);
+			const float* d = Offset(input, (i + 3) * inputStride);
+			__m128i low = FloatToHalf(_mm_set_ps(b[1], b[0], a[1], a[0]));
+			__m128i high = FloatToHalf(_mm_set_ps(d[1], d[0], c[1], c[0]));
+			__m128i packed = PackUint16(low, high);
+
+			Store32(Offset(output, i * outputStride), static_cast<uint32_t>(_mm_cvtsi128_si32(packed)));
+			Store32(Offset(output, (i + 1) * outputStride), static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(packed, 4))));
+			Store32(Offset(output, (i + 2) * outputStride), static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(packed, 8))));
+			Store32(Offset(output, (i + 3) * outputStride), static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(packed, 12))));
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const float* value = Offset(input, i * inputStride);
+		uint16_t* half = Offset(output, i * outputStride);
+		half[0] = FloatToHalf(value[0]);
+		half[1] = FloatToHalf(value[1]);
+	}
+}
+
+void VertexCompression::DecodeHalf2(const uint16_t* input, size_t inputStride, size_t count, float* output, size_t outputStride)
+{
+	size_t i = 0;
+
+#ifdef VERTEX_COMPRESSION_SSE2
+	if (simdEnabled)
+	{
+		const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i pairs = _mm_set_epi32(
+				static_cast<int>(Load32(Offset(input, (i + 3) * inputStride))),
+				static_cast<int>(Load32(Offset(input, (i + 2) * inputStride))),
+				static_cast<int>(Load32(Offset(input, (i + 1) * inputStride))),
+				static_cast<int>(Load32(Offset(input, i * inputStride))));
+
+			float u[4];
+			float v[4];
+			_mm_storeu_ps(u, HalfToFloat(_mm_and_si128(pairs, lowMask)));
+			_mm_storeu_ps(v, HalfToFloat(_mm_srli_epi32(pairs, 16)));
+			for (int k = 0; k < 4; k++)
+			{
+				float* value = Offset(output, (i + k) * outputStride);
+				value[0] = u[k];
+				value[1] = v[k];
+			}
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const uint16_t* half = Offset(input, i * inputStride);
+		float* value = Offset(output, i * outputStride);
+		value[0] = HalfToFloat(half[0]);
+		value[1] = HalfToFloat(half[1]);
+	}
+}
+
+void VertexCompression::EncodeOctahedral(const float* input, size_t inputStride, size_t count, int16_t* output, size_t outputStride)
+{
+	size_t i = 0;
+
+#ifdef VERTEX_COMPRESSION_SSE2
+	if (simdEnabled)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 minusOne = _mm_set1_ps(-1.0f);
+		const __m128 snormScale = _mm_set1_ps(32767.0f);
+		for (; i + 4 <= count; i += 4)
+		{
+			// Four directions, transposed so each register holds one component
+			const float* a = Offset(input, i * inputStride);
+			const float* b = Offset(input, (i + 1) * inputStride);
+			const float* c = Offset(input, (i + 2) * inputStride);
+			const float* d = Offset(input, (i + 3) * inputStride);
+			__m128 x = _mm_set_ps(d[0], c[0], b[0], a[0]);
+			__m128 y = _mm_set_ps(d[1], c[1], b[1], a[1]);
+			__m128 z = _mm_set_ps(d[2], c[2], b[2], a[2]);
+
+			__m128 l1 = _mm_add_ps(_mm_add_ps(Abs(x), Abs(y)), Abs(z));
+			__m128 inverse = _mm_and_ps(_mm_div_ps(one, l1), _mm_cmpgt_ps(l1, zero));
+			__m128 u = _mm_mul_ps(x, inverse);
+			__m128 v = _mm_mul_ps(y, inverse);
+
+			__m128 signU = Select(_mm_cmpge_ps(u, zero), one, minusOne);
+			__m128 signV = Select(_mm_cmpge_ps(v, zero), one, minusOne);
+			__m128 foldedU = _mm_mul_ps(_mm_sub_ps(one, Abs(v)), signU);
+			__m128 foldedV = _mm_mul_ps(_mm_sub_ps(one, Abs(u)), signV);
+			__m128 lower = _mm_cmplt_ps(z, zero);
+			u = Select(lower, foldedU, u);
+			v = Select(lower, foldedV, v);
+
+			u = _mm_min_ps(_mm_max_ps(u, minusOne), one);
+			v = _mm_min_ps(_mm_max_ps(v, minusOne), one);
+			__m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(u, snormScale)), _mm_cvtps_epi32(_mm_mul_ps(v, snormScale)));
+			__m128i interleaved = _mm_unpacklo_epi16(packed, _mm_srli_si128(packed, 8));
+
+			Store32(Offset(output, i * outputStride), static_cast<uint32_t>(_mm_cvtsi128_si32(interleaved)));
+			Store32(Offset(output, (i + 1) * outputStride), static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(interleaved, 4))));
+			Store32(Offset(output, (i + 2) * outputStride), static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(interleaved, 8))));
+			Store32(Offset(output, (i + 3) * outputStride), static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(interleaved, 12))));
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+		OctahedralEncode(Offset(input, i * inputStride), Offset(output, i * outputStride));
+}
+
+void VertexCompression::DecodeOctahedral(const int16_t* input, size_t inputStride, size_t count, float* output, size_t outputStride)
+{
+	size_t i = 0;
+
+#ifdef VERTEX_COMPRESSION_SSE2
+	if (simdEnabled)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 minusOne = _mm_set1_ps(-1.0f);
+		const __m128 snormScale = _mm_set1_ps(32767.0f);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i pairs = _mm_set_epi32(
+				static_cast<int>(Load32(Offset(input, (i + 3) * inputStride))),
+				static_cast<int>(Load32(Offset(input, (i + 2) * inputStride))),
+				static_cast<int>(Load32(Offset(input, (i + 1) * inputStride))),
+				static_cast<int>(Load32(Offset(input, i * inputStride))));
+
+			// Sign extend both halves of every lane
+			__m128 x = _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(pairs, 16), 16)), snormScale);
+			__m128 y = _mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(pairs, 16)), snormScale);
+			x = _mm_max_ps(x, minusOne);
+			y = _mm_max_ps(y, minusOne);
+
+			__m128 z = _mm_sub_ps(_mm_sub_ps(one, Abs(x)), Abs(y));
+			__m128 t = _mm_max_ps(Negate(z), zero);
+			__m128 negativeT = Negate(t);
+			x = _mm_add_ps(x, Select(_mm_cmpge_ps(x, zero), negativeT, t));
+			y = _mm_add_ps(y, Select(_mm_cmpge_ps(y, zero), negativeT, t));
+
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+			float xs[4];
+			float ys[4];
+			float zs[4];
+			_mm_storeu_ps(xs, _mm_div_ps(x, length));
+			_mm_storeu_ps(ys, _mm_div_ps(y, length));
+			_mm_storeu_ps(zs, _mm_div_ps(z, length));
+			for (int k = 0; k < 4; k++)
+			{
+				float* direction = Offset(output, (i + k) * outputStride);
+				direction[0] = xs[k];
+				direction[1] = ys[k];
+				direction[2] = zs[k];
+			}
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+		OctahedralDecode(Offset(input, i * inputStride), Offset(output, i * outputStride));
+}
+
+bool VertexCompression::IsSimdAvailable()
+{
+#ifdef VERTEX_COMPRESSION_SSE2
+	return true;
+#else
+	return false;
+#endif
+}
+
+void VertexCompression::SetSimdEnabled(bool enabled)
+{
+	simdEnabled = enabled;
+}
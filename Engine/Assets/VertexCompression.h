@@ -0,0 +1,62 @@
+#pragma once
+#include "MeshData.h"
+
+// Bounds used to quantize a mesh's positions to 16 bits per axis
+struct PositionQuantization
+{
+	DirectX::XMFLOAT3 minimum = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+	DirectX::XMFLOAT3 extent = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	// Maps the 0..1 UNORM positions back into model space, multiply it in front of the mesh transform
+	DirectX::XMMATRIX GetDequantizeMatrix() const;
+	// Largest distance between a position and its quantized value, half a step on the longest axis
+	float GetMaxError() const;
+};
+
+struct CompressedVertices
+{
+	VertexFormat format = VertexFormat::Float;
+	uint32_t stride = 0;
+	uint32_t vertexCount = 0;
+	PositionQuantization quantization;
+	std::vector<uint8_t> data; // vertexCount * stride bytes, ready for a vertex buffer (Mesh uploads it as is)
+};
+
+// Encodes Vertex3D data into the packed layouts from Graphics/Vertex.h and back.
+//
+// The kernels work on strided streams so they can read and write interleaved vertices directly. Strides are in
+// bytes. With SSE2 available (every x64 build) they process several values per instruction, SetSimdEnabled(false)
+// forces the scalar versions so the two can be compared. Both produce the same bits.
+class VertexCompression
+{
+public:
+	static uint32_t GetStride(VertexFormat format);
+
+	// Picks the smallest format that keeps positions within maxPositionError (model units) and can hold the
+	// attributes the mesh has. Meshes that need normals get CompactLit
+	static VertexFormat ChooseFormat(const MeshData& mesh, bool hasNormals, float maxPositionError);
+	static VertexFormat ChooseFormat(const Vertex3D* vertices, size_t count, bool hasNormals, float maxPositionError);
+
+	static PositionQuantization ComputeQuantization(const float* positions, size_t stride, size_t count);
+
+	// normals are 3 floats per vertex, tangents 4 with the bitangent sign in w. Both may be null, they only
+	// matter for CompactLit which then gets +Z normals and +X tangents
+	static void Compress(const MeshData& mesh, VertexFormat format, const float* normals, const float* tangents, CompressedVertices& output);
+	// Same for vertices that are not in a MeshData, like the streams of a mapped cooked file
+	static void Compress(const Vertex3D* vertices, size_t count, VertexFormat format, const float* normals, const float* tangents, CompressedVertices& output);
+	static void Decompress(const CompressedVertices& input, std::vector<Vertex3D>& vertices);
+
+	// -- Kernels -- //
+	// Positions are 3 floats in, 4 uint16_t out with w set to 65535
+	static void EncodePositions(const float* input, size_t inputStride, size_t count, const PositionQuantization& quantization, uint16_t* output, size_t outputStride);
+	static void DecodePositions(const uint16_t* input, size_t inputStride, size_t count, const PositionQuantization& quantization, float* output, size_t outputStride);
+	// Two floats to two IEEE half floats, round to nearest. Out of range values become infinity
+	static void EncodeHalf2(const float* input, size_t inputStride, size_t count, uint16_t* output, size_t outputStride);
+	static void DecodeHalf2(const uint16_t* input, size_t inputStride, size_t count, float* output, size_t outputStride);
+	// Unit vectors, 3 floats in, two SNORM16 octahedral coordinates out. Decoding renormalizes
+	static void EncodeOctahedral(const float* input, size_t inputStride, size_t count, int16_t* output, size_t outputStride);
+	static void DecodeOctahedral(const int16_t* input, size_t inputStride, size_t count, float* output, size_t outputStride);
+
+	static bool IsSimdAvailable();
+	static void SetSimdEnabled(bool enabled); // Benchmarking only, not thread safe
+};
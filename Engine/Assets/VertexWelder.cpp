@@ -0,0 +1,275 @@
+#include "VertexWelder.h"
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t EmptySlot = 0xFFFFFFFF;
+
+	uint32_t FloatBits(float value)
+	{
+		// -0 and 0 compare equal so they have to hash the same too
+		if (value == 0.0f)
+			value = 0.0f;
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	uint32_t HashCombine(uint32_t hash, uint32_t value)
+	{
+		// murmur3 style mixing
+		value *= 0xCC9E2D51;
+		value = (value << 15) | (value >> 17);
+		value *= 0x1B873593;
+		hash ^= value;
+		hash = (hash << 13) | (hash >> 19);
+		return hash * 5 + 0xE6546B64;
+	}
+
+	uint32_t HashVertex(const Vertex3D& vertex)
+	{
+		uint32_t hash = 0;
+		hash = HashCombine(hash, FloatBits(vertex.pos.x));
+		hash = HashCombine(hash, FloatBits(vertex.pos.y));
+		hash = HashCombine(hash, FloatBits(vertex.pos.z));
+		hash = HashCombine(hash, FloatBits(vertex.textCoord.x));
+		hash = HashCombine(hash, FloatBits(vertex.textCoord.y));
+		return hash;
+	}
+
+	uint32_t HashCell(int64_t x, int64_t y, int64_t z)
+	{
+		uint32_t hash = 0;
+		const int64_t coordinates[3] = { x, y, z };
+		for (int64_t coordinate : coordinates)
+		{
+			hash = HashCombine(hash, static_cast<uint32_t>(static_cast<uint64_t>(coordinate)));
+			hash = HashCombine(hash, static_cast<uint32_t>(static_cast<uint64_t>(coordinate) >> 32));
+		}
+		return hash;
+	}
+
+	bool IsEqual(const Vertex3D& a, const Vertex3D& b)
+	{
+		return a.pos.x == b.pos.x && a.pos.y == b.pos.y && a.pos.z == b.pos.z &&
+			a.textCoord.x == b.textCoord.x && a.textCoord.y == b.textCoord.y;
+	}
+
+	bool IsNear(const Vertex3D& a, const Vertex3D& b, float positionEpsilon, float texCoordEpsilon)
+	{
+		return fabsf(a.pos.x - b.pos.x) <= positionEpsilon && fabsf(a.pos.y - b.pos.y) <= positionEpsilon && fabsf(a.pos.z - b.pos.z) <= positionEpsilon &&
+			fabsf(a.textCoord.x - b.textCoord.x) <= texCoordEpsilon && fabsf(a.textCoord.y - b.textCoord.y) <= texCoordEpsilon;
+	}
+
+	// The optional per vertex streams of the mesh being welded, null when it does not have them.
+	// Two vertices only merge if these match as well
+	struct Streams
+	{
+		const XMFLOAT3* normals = nullptr;
+		const XMFLOAT4* tangents = nullptr;
+
+		uint32_t Hash(uint32_t hash, size_t i) const
+		{
+			if (this->normals != nullptr)
+			{
+				hash = HashCombine(hash, FloatBits(this->normals[i].x));
+				hash = HashCombine(hash, FloatBits(this->normals[i].y));
+				hash = HashCombine(hash, FloatBits(this->normals[i].z));
+			}
+			if (this->tangents != nullptr)
+			{
+				hash = HashCombine(hash, FloatBits(this->tangents[i].x));
+				hash = HashCombine(hash, FloatBits(this->tangents[i].y));
+				hash = HashCombine(hash, FloatBits(this->tangents[i].z));
+				hash = HashCombine(hash, FloatBits(this->tangents[i].w));
+			}
+			return hash;
+		}
+
+		bool IsEqual(size_t a, size_t b) const
+		{
+			if (this->normals != nullptr && (this->normals[a].x != this->normals[b].x || this->normals[a].y != this->normals[b].y || this->normals[a].z != this->normals[b].z))
+				return false;
+			return this->tangents == nullptr || (this->tangents[a].x == this->tangents[b].x && this->tangents[a].y == this->tangents[b].y &&
+				this->tangents[a].z == this->tangents[b].z && this->tangents[a].w == this->tangents[b].w);
+		}
+
+		bool IsNear(size_t a, size_t b, float epsilon) const
+		{
+			if (this->normals != nullptr && (fabsf(this->normals[a].x - this->normals[b].x) > epsilon ||
+				fabsf(this->normals[a].y - this->normals[b].y) > epsilon || fabsf(this->normals[a].z - this->normals[b].z) > epsilon))
+				return false;
+			// Never merge across a mirrored UV seam, the bitangent sign has to match exactly
+			return this->tangents == nullptr || (fabsf(this->tangents[a].x - this->tangents[b].x) <= epsilon &&
+				fabsf(this->tangents[a].y - this->tangents[b].y) <= epsilon && fabsf(this->tangents[a].z - this->tangents[b].z) <= epsilon &&
+				this->tangents[a].w == this->tangents[b].w);
+		}
+	};
+
+	// Cells past 2^62 on either side are clamped, far enough from the int64_t limits for the neighbours to be there
+	// too. Vertices out there share their cell, IsNear still tells them apart. NaN goes to the lowest cell
+	int64_t CellCoordinate(float value, float cellSize)
+	{
+		const double limit = 4611686018427387904.0; // 2^62
+		double cell = floor(static_cast<double>(value) / cellSize);
+		if (!(cell >= -limit))
+			cell = -limit;
+		else if (cell > limit)
+			cell = limit;
+		return static_cast<int64_t>(cell);
+	}
+
+	// Chained hash table over the unique vertices. Buckets hold the first unique vertex, next links the rest,
+	// everything lives in two flat arrays so building it does one allocation per array
+	struct VertexTable
+	{
+		std::vector<uint32_t> buckets;
+		std::vector<uint32_t> next;
+		uint32_t mask;
+
+		explicit VertexTable(size_t vertexCount)
+		{
+			size_t bucketCount = 16;
+			while (bucketCount < vertexCount * 2)
+				bucketCount *= 2;
+			this->buckets.assign(bucketCount, EmptySlot);
+			this->next.reserve(vertexCount);
+			this->mask = static_cast<uint32_t>(bucketCount - 1);
+		}
+
+		void Insert(uint32_t hash, uint32_t uniqueIndex)
+		{
+			uint32_t& bucket = this->buckets[hash & this->mask];
+			this->next.push_back(bucket);
+			bucket = uniqueIndex;
+		}
+	};
+
+	// firstVertex receives the source index each unique vertex was created from
+	size_t WeldVertices(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices, const WeldSettings& settings, const Streams& streams, std::vector<uint32_t>* firstVertex)
+	{
+		if (vertices.empty())
+			return 0;
+
+		std::vector<uint32_t> remap(vertices.size());
+		std::vector<uint32_t> first;
+		first.reserve(vertices.size());
+		std::vector<Vertex3D> unique;
+		unique.reserve(vertices.size());
+		VertexTable table(vertices.size());
+
+		if (settings.mode == WeldMode::Exact)
+		{
+			for (size_t i = 0; i < vertices.size(); i++)
+			{
+				const Vertex3D& vertex = vertices[i];
+				uint32_t hash = streams.Hash(HashVertex(vertex), i);
+
+				uint32_t match = table.buckets[hash & table.mask];
+				while (match != EmptySlot && !(IsEqual(unique[match], vertex) && streams.IsEqual(first[match], i)))
+					match = table.next[match];
+
+				if (match == EmptySlot)
+				{
+					match = static_cast<uint32_t>(unique.size());
+					unique.push_back(vertex);
+					first.push_back(static_cast<uint32_t>(i));
+					table.Insert(hash, match);
+				}
+				remap[i] = match;
+			}
+		}
+		else
+		{
+			// Bucket by position cells one epsilon wide. Two vertices within epsilon of each other are at most one
+			// cell apart on every axis, so looking through the 27 surrounding cells finds every candidate
+			const float cellSize = settings.positionEpsilon > 0.0f ? settings.positionEpsilon : 1e-7f;
+			for (size_t i = 0; i < vertices.size(); i++)
+			{
+				const Vertex3D& vertex = vertices[i];
+				int64_t cx = CellCoordinate(vertex.pos.x, cellSize);
+				int64_t cy = CellCoordinate(vertex.pos.y, cellSize);
+				int64_t cz = CellCoordinate(vertex.pos.z, cellSize);
+
+				uint32_t match = EmptySlot;
+				for (int32_t dz = -1; dz <= 1 && match == EmptySlot; dz++)
+				{
+					for (int32_t dy = -1; dy <= 1 && match == EmptySlot; dy++)
+					{
+						for (int32_t dx = -1; dx <= 1 && match == EmptySlot; dx++)
+						{
+							uint32_t candidate = table.buckets[HashCell(cx + dx, cy + dy, cz + dz) & table.mask];
+							while (candidate != EmptySlot && !(IsNear(unique[candidate], vertex, settings.positionEpsilon, settings.texCoordEpsilon) &&
+								streams.IsNear(first[candidate], i, settings.normalEpsilon)))
+								candidate = table.next[candidate];
+							match = candidate;
+						}
+					}
+				}
+
+				if (match == EmptySlot)
+				{
+					match = static_cast<uint32_t>(unique.size());
+					unique.push_back(vertex);
+					first.push_back(static_cast<uint32_t>(i));
+					table.Insert(HashCell(cx, cy, cz), match);
+				}
+				remap[i] = match;
+			}
+		}
+
+		for (uint32_t& index : indices)
+			index = remap[index];
+
+		size_t removed = vertices.size() - unique.size();
+		vertices.swap(unique);
+		if (firstVertex != nullptr)
+			firstVertex->swap(first);
+		return removed;
+	}
+}
+
+size_t VertexWelder::Weld(MeshData& mesh, const WeldSettings& settings)
+{
+	Streams streams;
+	if (mesh.normals.size() == mesh.vertices.size())
+		streams.normals = mesh.normals.data();
+	if (mesh.tangents.size() == mesh.vertices.size())
+		streams.tangents = mesh.tangents.data();
+
+	std::vector<uint32_t> firstVertex;
+	size_t removed = WeldVertices(mesh.vertices, mesh.indices, settings, streams, &firstVertex);
+
+	// The streams keep the values of the vertex each cluster was created from, same as vertices
+	if (streams.normals != nullptr)
+	{
+		std::vector<XMFLOAT3> normals(firstVertex.size());
+		for (size_t i = 0; i < firstVertex.size(); i++)
+			normals[i] = mesh.normals[firstVertex[i]];
+		mesh.normals.swap(normals);
+	}
+	else
+	{
+		mesh.normals.clear();
+	}
+	if (streams.tangents != nullptr)
+	{
+		std::vector<XMFLOAT4> tangents(firstVertex.size());
+		for (size_t i = 0; i < firstVertex.size(); i++)
+			tangents[i] = mesh.tangents[firstVertex[i]];
+		mesh.tangents.swap(tangents);
+	}
+	else
+	{
+		mesh.tangents.clear();
+	}
+	return removed;
+}
+
+size_t VertexWelder::Weld(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices, const WeldSettings& settings)
+{
+	return WeldVertices(vertices, indices, settings, Streams(), nullptr);
+}
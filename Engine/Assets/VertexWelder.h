@@ -0,0 +1,30 @@
+#pragma once
+#include "MeshData.h"
+
+// Merges duplicate vertices and remaps the indices to the unique set. We import without
+// aiProcess_JoinIdenticalVertices, so FBX files come in with one vertex per face corner.
+//
+// Exact mode merges vertices whose attributes compare equal. Epsilon mode merges vertices whose position and
+// texture coordinates are each within a tolerance, the first vertex seen in a cluster is the one that is kept.
+// Normals and tangents, when the mesh has them, have to match too, so hard edges and mirrored UV seams stay split.
+enum class WeldMode
+{
+	Exact,
+	Epsilon,
+};
+
+struct WeldSettings
+{
+	WeldMode mode = WeldMode::Exact;
+	float positionEpsilon = 1e-5f; // Epsilon mode only, in model units
+	float texCoordEpsilon = 1e-5f;
+	float normalEpsilon = 1e-3f; // Epsilon mode only, per component, also used for tangents. The bitangent sign always has to match
+};
+
+class VertexWelder
+{
+public:
+	// Returns the number of vertices that were removed
+	static size_t Weld(MeshData& mesh, const WeldSettings& settings = WeldSettings());
+	static size_t Weld(std::vector<Vertex3D>& vertices, std::vector<uint32_t>& indices, const WeldSettings& settings = WeldSettings());
+};
@@ -0,0 +1,392 @@
+#include "VirtualTexture.h"
+#include "../FileHelper.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// Texels per unit the page copy moves, a block for block compressed formats and a texel for the rest
+	uint32_t GetUnitTexels(PixelFormat format)
+	{
+		return ImageDescription::IsBlockCompressed(format) ? 4 : 1;
+	}
+
+	uint32_t GetUnitBytes(PixelFormat format)
+	{
+		return ImageDescription::IsBlockCompressed(format) ? ImageDescription::GetBytesPerBlock(format) : ImageDescription::GetBytesPerPixel(format);
+	}
+}
+
+bool VirtualTextureLayout::Initialize(uint32_t width, uint32_t height, PixelFormat format, uint32_t pageSize, uint32_t border, uint32_t availableLevels)
+{
+	if (width == 0 || height == 0 || GetUnitBytes(format) == 0 || pageSize == 0 || pageSize % 4 != 0 || border % 4 != 0)
+		return false;
+
+	this->width = width;
+	this->height = height;
+	this->format = format;
+	this->pageSize = pageSize;
+	this->border = border;
+	if (GetPagesAcross(0) > VirtualPage::MaxPagesAcross || GetPagesDown(0) > VirtualPage::MaxPagesAcross)
+		return false;
+
+	// Down to the first level of a single page, which needs to be among the levels there are
+	this->levelCount = 0;
+	this->levelFirstPage[0] = 0;
+	for (uint32_t level = 0; level < std::min(availableLevels, VirtualPage::MaxLevels); level++)
+	{
+		// The indirection texture has a texel per page in a regular mip chain, a level needing more pages than the chain
+		// has texels there (3000 texels in 128 texel pages has 2 pages across at level 4, the chain 1 texel) cannot be paged
+		if (GetPagesAcross(level) != std::max(GetPagesAcross(0) >> level, 1u) || GetPagesDown(level) != std::max(GetPagesDown(0) >> level, 1u))
+			return false;
+		this->levelFirstPage[level + 1] = this->levelFirstPage[level] + GetPagesAcross(level) * GetPagesDown(level);
+		this->levelCount = level + 1;
+		if (GetPagesAcross(level) == 1 && GetPagesDown(level) == 1)
+			return true;
+	}
+	return false;
+}
+
+uint32_t VirtualTextureLayout::GetPagesAcross(uint32_t level) const
+{
+	const uint32_t levelWidth = std::max(this->width >> level, 1u);
+	return (levelWidth + this->pageSize - 1) / this->pageSize;
+}
+
+uint32_t VirtualTextureLayout::GetPagesDown(uint32_t level) const
+{
+	const uint32_t levelHeight = std::max(this->height >> level, 1u);
+	return (levelHeight + this->pageSize - 1) / this->pageSize;
+}
+
+uint32_t VirtualTextureLayout::GetPageIndex(uint32_t x, uint32_t y, uint32_t level) const
+{
+	return this->levelFirstPage[level] + y * GetPagesAcross(level) + x;
+}
+
+uint32_t VirtualTextureLayout::GetPageId(uint32_t index) const
+{
+	uint32_t level = 0;
+	while (level + 1 < this->levelCount && index >= this->levelFirstPage[level + 1])
+		level++;
+	const uint32_t offset = index - this->levelFirstPage[level];
+	const uint32_t across = GetPagesAcross(level);
+	return VirtualPage::Pack(offset % across, offset / across, level);
+}
+
+uint32_t VirtualTextureLayout::GetPageRowPitch() const
+{
+	return GetPageTexels() / GetUnitTexels(this->format) * GetUnitBytes(this->format);
+}
+
+uint32_t VirtualTextureLayout::GetPageRowCount() const
+{
+	return GetPageTexels() / GetUnitTexels(this->format);
+}
+
+bool VirtualTextureLayout::IsValidPage(uint32_t id) const
+{
+	const uint32_t level = VirtualPage::GetLevel(id);
+	return id != VirtualPage::None && level < this->levelCount && VirtualPage::GetX(id) < GetPagesAcross(level) && VirtualPage::GetY(id) < GetPagesDown(level);
+}
+
+void VirtualTextureFile::CopyPage(const ImageData& image, const VirtualTextureLayout& layout, uint32_t id, uint8_t* destination)
+{
+	// In units, texels or blocks. The border reaches past the level at its edges, those rows and columns repeat the
+	// edge like a clamp sampler would
+	const ImageDescription& description = image.description;
+	const uint32_t level = VirtualPage::GetLevel(id);
+	const int64_t unitTexels = GetUnitTexels(layout.format);
+	const size_t unitBytes = GetUnitBytes(layout.format);
+	const int64_t levelColumns = (description.GetLevelWidth(level) + unitTexels - 1) / unitTexels;
+	const int64_t levelRows = description.GetLevelRowCount(level);
+	const int64_t pageUnits = layout.GetPageTexels() / unitTexels;
+	const int64_t startColumn = (static_cast<int64_t>(VirtualPage::GetX(id)) * layout.pageSize - layout.border) / unitTexels;
+	const int64_t startRow = (static_cast<int64_t>(VirtualPage::GetY(id)) * layout.pageSize - layout.border) / unitTexels;
+
+	const uint8_t* levelData = image.pixels.data() + description.GetLevelOffset(level);
+	const size_t sourcePitch = description.GetLevelRowPitch(level);
+	const size_t pagePitch = layout.GetPageRowPitch();
+
+	// Columns before first repeat the first one, the ones from last on the last one
+	const int64_t first = std::max<int64_t>(startColumn, 0);
+	const int64_t last = std::min<int64_t>(startColumn + pageUnits, levelColumns);
+	const int64_t leftCount = first - startColumn;
+	const int64_t copyCount = std::max<int64_t>(last - first, 0);
+	for (int64_t row = 0; row < pageUnits; row++)
+	{
+		const int64_t sourceRow = std::min(std::max(startRow + row, int64_t(0)), levelRows - 1);
+		const uint8_t* source = levelData + sourceRow * sourcePitch;
+		uint8_t* target = destination + row * pagePitch;
+
+		for (int64_t column = 0; column < leftCount; column++)
+			memcpy(target + column * unitBytes, source, unitBytes);
+		memcpy(target + leftCount * unitBytes, source + first * unitBytes, static_cast<size_t>(copyCount) * unitBytes);
+		const uint8_t* edge = source + (levelColumns - 1) * unitBytes;
+		for (int64_t column = leftCount + copyCount; column < pageUnits; column++)
+			memcpy(target + column * unitBytes, edge, unitBytes);
+	}
+}
+
+bool VirtualTextureFile::Write(const std::string& filepath, const ImageData& image, uint32_t pageSize, uint32_t border, ThreadPool& pool)
+{
+	const ImageDescription& description = image.description;
+	VirtualTextureLayout layout;
+	if (!layout.Initialize(description.width, description.height, description.format, pageSize, border, description.mipLevels) ||
+		image.pixels.size() < description.GetSize())
+		return false;
+
+	VirtualTextureHeader header = {};
+	header.magic = VirtualTextureFormat::Magic;
+	header.version = VirtualTextureFormat::Version;
+	header.width = layout.width;
+	header.height = layout.height;
+	header.format = static_cast<uint32_t>(layout.format);
+	header.pageSize = layout.pageSize;
+	header.border = layout.border;
+	header.levelCount = layout.levelCount;
+	header.pageCount = layout.GetPageCount();
+	header.pageBytes = layout.GetPageBytes();
+	header.dataOffset = VirtualTextureFormat::PageAlignment;
+
+	std::vector<uint8_t> data(static_cast<size_t>(header.dataOffset) + static_cast<size_t>(header.pageCount) * header.pageBytes);
+	memcpy(data.data(), &header, sizeof(header));
+	uint8_t* pages = data.data() + header.dataOffset;
+	pool.ParallelFor(header.pageCount, [&](size_t index)
+	{
+		CopyPage(image, layout, layout.GetPageId(static_cast<uint32_t>(index)), pages + index * header.pageBytes);
+	});
+	return FileHelper::WriteFileAtomic(filepath, data.data(), data.size());
+}
+
+bool VirtualTextureFile::Open(const std::string& filepath)
+{
+	Close();
+	if (!this->file.Open(filepath) || this->file.Size() < sizeof(VirtualTextureHeader))
+	{
+		Close();
+		return false;
+	}
+
+	VirtualTextureHeader header;
+	memcpy(&header, this->file.Data(), sizeof(header));
+	const bool valid = header.magic == VirtualTextureFormat::Magic && header.version == VirtualTextureFormat::Version &&
+		this->layout.Initialize(header.width, header.height, static_cast<PixelFormat>(header.format), header.pageSize, header.border, header.levelCount) &&
+		this->layout.levelCount == header.levelCount && this->layout.GetPageCount() == header.pageCount && this->layout.GetPageBytes() == header.pageBytes &&
+		header.dataOffset <= this->file.Size() && static_cast<uint64_t>(header.pageCount) * header.pageBytes <= this->file.Size() - header.dataOffset;
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+	this->pageData = this->file.Data() + header.dataOffset;
+	return true;
+}
+
+void VirtualTextureFile::Close()
+{
+	this->file.Close();
+	this->layout = VirtualTextureLayout();
+	this->pageData = nullptr;
+}
+
+VirtualPageTable::VirtualPageTable(const VirtualTextureLayout& layout, uint32_t slotsAcross, uint32_t slotsDown)
+	: layout(layout), slotsAcross(std::min(std::max(slotsAcross, 1u), 256u)), pages(layout.GetPageCount())
+{
+	// The indirection texture has 8 bits for either slot coordinate
+	this->slots.resize(this->slotsAcross * std::min(std::max(slotsDown, 1u), 256u));
+}
+
+void VirtualPageTable::Touch(uint32_t index, uint64_t frame)
+{
+	const Page& page = this->pages[index];
+	if (page.slot != NoSlot && !page.loading)
+		this->slots[page.slot].lastUsed = frame;
+}
+
+bool VirtualPageTable::BeginLoad(uint32_t index, uint64_t frame, uint32_t& slot, uint32_t& evicted)
+{
+	// A free slot if there is one, otherwise the one used the longest ago. Slots used this frame are in the frame
+	// being drawn, and the last level stands in for every page that is not there
+	const uint32_t lastPage = this->layout.GetPageCount() - 1;
+	uint32_t best = NoSlot;
+	for (uint32_t i = 0; i < this->slots.size(); i++)
+	{
+		const Slot& candidate = this->slots[i];
+		if (candidate.page == NoSlot)
+		{
+			best = i;
+			break;
+		}
+		if (candidate.page == lastPage || this->pages[candidate.page].loading || candidate.lastUsed >= frame)
+			continue;
+		if (best == NoSlot || candidate.lastUsed < this->slots[best].lastUsed)
+			best = i;
+	}
+	if (best == NoSlot)
+		return false;
+
+	Slot& chosen = this->slots[best];
+	evicted = chosen.page;
+	if (evicted != NoSlot)
+	{
+		this->pages[evicted].slot = NoSlot;
+		this->residentCount--;
+	}
+	chosen.page = index;
+	chosen.lastUsed = frame;
+	this->pages[index].slot = best;
+	this->pages[index].loading = true;
+	slot = best;
+	return true;
+}
+
+void VirtualPageTable::EndLoad(uint32_t index, bool succeeded)
+{
+	Page& page = this->pages[index];
+	page.loading = false;
+	if (succeeded)
+	{
+		this->residentCount++;
+		return;
+	}
+	this->slots[page.slot] = Slot();
+	page.slot = NoSlot;
+}
+
+void VirtualPageTable::BuildIndirection(ImageData& indirection) const
+{
+	const VirtualTextureLayout& layout = this->layout;
+	ImageDescription& description = indirection.description;
+	description = ImageDescription();
+	description.width = layout.GetPagesAcross(0);
+	description.height = layout.GetPagesDown(0);
+	description.mipLevels = static_cast<uint16_t>(layout.levelCount);
+	description.format = PixelFormat::R8G8B8A8_UNORM;
+	description.rowPitch = description.width * 4;
+	indirection.pixels.assign(static_cast<size_t>(description.GetSize()), 0);
+
+	// Coarse to fine, so a missing page copies the texel above it that is already filled in
+	for (uint32_t level = layout.levelCount; level-- > 0;)
+	{
+		// Initialize only accepts layouts where these are the page grid of the level
+		const uint32_t levelWidth = description.GetLevelWidth(level);
+		const uint32_t levelHeight = description.GetLevelHeight(level);
+		uint8_t* texels = indirection.pixels.data() + description.GetLevelOffset(level);
+		const uint8_t* parent = level + 1 < layout.levelCount ? indirection.pixels.data() + description.GetLevelOffset(level + 1) : nullptr;
+		const uint32_t parentWidth = description.GetLevelWidth(level + 1);
+		const uint32_t parentHeight = description.GetLevelHeight(level + 1);
+
+		for (uint32_t y = 0; y < levelHeight; y++)
+		{
+			for (uint32_t x = 0; x < levelWidth; x++)
+			{
+				uint8_t* texel = texels + (static_cast<size_t>(y) * levelWidth + x) * 4;
+				const Page& page = this->pages[layout.GetPageIndex(x, y, level)];
+				if (page.slot != NoSlot && !page.loading)
+				{
+					texel[0] = static_cast<uint8_t>(page.slot % this->slotsAcross);
+					texel[1] = static_cast<uint8_t>(page.slot / this->slotsAcross);
+					texel[2] = static_cast<uint8_t>(level);
+					texel[3] = 255;
+				}
+				else if (parent != nullptr)
+				{
+					memcpy(texel, parent + (static_cast<size_t>(std::min(y / 2, parentHeight - 1)) * parentWidth + std::min(x / 2, parentWidth - 1)) * 4, 4);
+				}
+			}
+		}
+	}
+}
+
+VirtualTextureFeedback::VirtualTextureFeedback(const VirtualTextureLayout& layout)
+	: layout(layout), pixels(layout.GetPageCount(), 0)
+{
+}
+
+void VirtualTextureFeedback::Analyze(const uint32_t* feedback, size_t count, uint64_t frame, VirtualPageTable& table, std::vector<VirtualPageRequest>& requests, size_t maxRequests)
+{
+	requests.clear();
+	this->invalidCount = 0;
+
+	// Neighbouring pixels mostly ask for the same page, a run of them costs one compare per pixel
+	uint32_t previousId = VirtualPage::None;
+	uint32_t previousIndex = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint32_t id = feedback[i];
+		if (id == previousId)
+		{
+			this->pixels[previousIndex]++;
+			continue;
+		}
+		if (id == VirtualPage::None)
+			continue;
+		if (!this->layout.IsValidPage(id))
+		{
+			this->invalidCount++;
+			continue;
+		}
+		const uint32_t index = this->layout.GetPageIndex(id);
+		if (this->pixels[index]++ == 0)
+			this->requested.push_back(index);
+		previousId = id;
+		previousIndex = index;
+	}
+
+	// Every page also counts for the pages above it, which are what the shader falls back to until it is there
+	const size_t sampledCount = this->requested.size();
+	this->sampledPixels.resize(sampledCount);
+	for (size_t i = 0; i < sampledCount; i++)
+		this->sampledPixels[i] = this->pixels[this->requested[i]];
+	for (size_t i = 0; i < sampledCount; i++)
+	{
+		const uint32_t id = this->layout.GetPageId(this->requested[i]);
+		uint32_t x = VirtualPage::GetX(id);
+		uint32_t y = VirtualPage::GetY(id);
+		for (uint32_t level = VirtualPage::GetLevel(id) + 1; level < this->layout.levelCount; level++)
+		{
+			x /= 2;
+			y /= 2;
+			const uint32_t parent = this->layout.GetPageIndex(std::min(x, this->layout.GetPagesAcross(level) - 1), std::min(y, this->layout.GetPagesDown(level) - 1), level);
+			if (this->pixels[parent] == 0)
+				this->requested.push_back(parent);
+			this->pixels[parent] += this->sampledPixels[i];
+		}
+	}
+
+	for (uint32_t index : this->requested)
+	{
+		if (table.IsResident(index))
+		{
+			table.Touch(index, frame);
+		}
+		else if (!table.IsLoading(index))
+		{
+			VirtualPageRequest request;
+			request.index = index;
+			request.pixels = this->pixels[index];
+			requests.push_back(request);
+		}
+		this->pixels[index] = 0;
+	}
+	this->requested.clear();
+
+	// Ties go to the coarser page, levels further down have the higher indices
+	auto compare = [](const VirtualPageRequest& a, const VirtualPageRequest& b)
+	{
+		if (a.pixels != b.pixels)
+			return a.pixels > b.pixels;
+		return a.index > b.index;
+	};
+	if (requests.size() > maxRequests)
+	{
+		std::partial_sort(requests.begin(), requests.begin() + maxRequests, requests.end(), compare);
+		requests.resize(maxRequests);
+	}
+	else
+	{
+		std::sort(requests.begin(), requests.end(), compare);
+	}
+}
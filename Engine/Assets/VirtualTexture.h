@@ -0,0 +1,202 @@
+#pragma once
+#include "ImageData.h"
+#include "MappedFile.h"
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Virtual texturing for atlases too large to keep resident, like the 4K Dandelion maps once there are many of them.
+// The texture is cut into pages of pageSize texels square per mip level, only the pages the frame samples are kept
+// in a physical cache texture, and an indirection texture tells the shader where in the cache each page went. The
+// shader writes the page and level every pixel wants into a small feedback buffer, VirtualTextureFeedback turns that
+// into the pages to load next.
+//
+// Everything here is CPU side and headless, the GPU part only uploads pages into cache slots and the indirection
+// texture BuildIndirection makes (AssetTool -vtex runs it all on synthetic feedback).
+
+// Page ids as the feedback shader writes them, one uint per pixel. Bits 0-11 page x, 12-23 page y, 24-27 level
+namespace VirtualPage
+{
+	const uint32_t None = 0xffffffff; // Pixels that sample no virtual texture
+	const uint32_t MaxPagesAcross = 4096;
+	const uint32_t MaxLevels = 16;
+
+	inline uint32_t Pack(uint32_t x, uint32_t y, uint32_t level) { return x | y << 12 | level << 24; }
+	inline uint32_t GetX(uint32_t id) { return id & 0xfff; }
+	inline uint32_t GetY(uint32_t id) { return id >> 12 & 0xfff; }
+	inline uint32_t GetLevel(uint32_t id) { return id >> 24 & 0xf; }
+}
+
+// How a texture is cut into pages. Every page holds pageSize texels plus border texels on each side copied from its
+// neighbours (clamped at the edges), so bilinear and anisotropic filtering inside a page never reads the next slot of
+// the cache. Levels are paged down to the first one that fits a single page, the coarser ones are left out because
+// that page is always resident and stands in for them
+struct VirtualTextureLayout
+{
+	uint32_t width = 0;
+	uint32_t height = 0;
+	PixelFormat format = PixelFormat::Unknown;
+	uint32_t pageSize = 128; // Texels, a multiple of 4
+	uint32_t border = 4; // Texels, a multiple of 4 so block compressed pages stay whole blocks
+	uint32_t levelCount = 0; // Paged levels
+
+	// Fills in levelCount. False when the format or sizes cannot be paged, which includes sizes where a level has more
+	// pages across or down than half the level above, rounded down (see BuildIndirection)
+	bool Initialize(uint32_t width, uint32_t height, PixelFormat format, uint32_t pageSize, uint32_t border, uint32_t availableLevels);
+
+	uint32_t GetPagesAcross(uint32_t level) const;
+	uint32_t GetPagesDown(uint32_t level) const;
+	// Pages are numbered level by level, row by row
+	uint32_t GetPageIndex(uint32_t x, uint32_t y, uint32_t level) const;
+	uint32_t GetPageIndex(uint32_t id) const { return GetPageIndex(VirtualPage::GetX(id), VirtualPage::GetY(id), VirtualPage::GetLevel(id)); }
+	uint32_t GetPageId(uint32_t index) const;
+	uint32_t GetPageCount() const { return GetLevelFirstPage(this->levelCount); }
+	uint32_t GetLevelFirstPage(uint32_t level) const { return this->levelFirstPage[level]; }
+
+	// Texels across a page with its border, and what that takes in the format
+	uint32_t GetPageTexels() const { return this->pageSize + 2 * this->border; }
+	uint32_t GetPageRowPitch() const;
+	uint32_t GetPageRowCount() const;
+	uint32_t GetPageBytes() const { return GetPageRowPitch() * GetPageRowCount(); }
+	bool IsValidPage(uint32_t id) const;
+
+	uint32_t levelFirstPage[VirtualPage::MaxLevels + 1] = {}; // Filled in by Initialize, see GetLevelFirstPage
+};
+
+// The page file (.vtex), every page of every paged level one after the other, each the same size so a page is read
+// with one seek:
+//
+//   VirtualTextureHeader   the layout and where the pages start
+//   pages                  GetPageBytes each, in GetPageIndex order. Rows tightly packed like a level of ImageData,
+//                          rows of blocks for block compressed formats
+namespace VirtualTextureFormat
+{
+	const uint32_t Magic = 0x54564549; // "IEVT"
+	const uint32_t Version = 1;
+	const char* const Extension = "vtex";
+	const uint32_t PageAlignment = 4096; // Where the first page starts, for unbuffered reads
+}
+
+struct VirtualTextureHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t format; // PixelFormat
+	uint32_t pageSize;
+	uint32_t border;
+	uint32_t levelCount;
+	uint32_t pageCount;
+	uint32_t pageBytes;
+	uint64_t dataOffset;
+};
+
+static_assert(sizeof(VirtualTextureHeader) == 48, "VirtualTextureHeader has to match the file layout");
+
+class VirtualTextureFile
+{
+public:
+	// Cuts every paged level of image into pages. Pages run on the pool
+	static bool Write(const std::string& filepath, const ImageData& image, uint32_t pageSize, uint32_t border, ThreadPool& pool);
+	// One page of level of image with its border, the way Write stores it. destination takes layout.GetPageBytes
+	static void CopyPage(const ImageData& image, const VirtualTextureLayout& layout, uint32_t id, uint8_t* destination);
+
+	bool Open(const std::string& filepath);
+	void Close();
+
+	const VirtualTextureLayout& GetLayout() const { return this->layout; }
+	// Points into the mapping, GetPageBytes long
+	const uint8_t* GetPageData(uint32_t index) const { return this->pageData + static_cast<size_t>(index) * this->layout.GetPageBytes(); }
+
+private:
+	MappedFile file;
+	VirtualTextureLayout layout;
+	const uint8_t* pageData = nullptr;
+};
+
+// Which pages are in which slot of the physical cache texture, a grid of slotsAcross x slotsDown pages. Slots are
+// reused least recently used first. The page of the last level is never evicted, so every texel always has something
+// to fall back to
+class VirtualPageTable
+{
+public:
+	static const uint32_t NoSlot = 0xffffffff;
+
+	VirtualPageTable(const VirtualTextureLayout& layout, uint32_t slotsAcross, uint32_t slotsDown);
+
+	const VirtualTextureLayout& GetLayout() const { return this->layout; }
+	uint32_t GetSlotCount() const { return static_cast<uint32_t>(this->slots.size()); }
+	uint32_t GetSlotsAcross() const { return this->slotsAcross; }
+
+	// Slot the page is in or loading into, NoSlot for neither
+	uint32_t GetSlot(uint32_t index) const { return this->pages[index].slot; }
+	bool IsResident(uint32_t index) const { return this->pages[index].slot != NoSlot && !this->pages[index].loading; }
+	bool IsLoading(uint32_t index) const { return this->pages[index].loading; }
+
+	// Marks a resident page as used this frame
+	void Touch(uint32_t index, uint64_t frame);
+
+	// Picks the slot a page that is neither resident nor loading is loaded into, evicting the page used the longest
+	// ago, and marks the page loading. evicted is the index of the page that lost its slot or NoSlot. False when
+	// every slot was used this frame or is loading
+	bool BeginLoad(uint32_t index, uint64_t frame, uint32_t& slot, uint32_t& evicted);
+	// The page's data is in its slot now. A failed load frees the slot again
+	void EndLoad(uint32_t index, bool succeeded);
+
+	// Indirection texture, one R8G8B8A8_UNORM texel per page with mips down to the last paged level: slot x, slot y,
+	// level of the page in the slot and 255. Pages that are not resident point at the closest resident page above
+	// them, so the shader scales its uv by 2^(level asked for - level in the texel) and never samples a hole
+	void BuildIndirection(ImageData& indirection) const;
+
+	uint32_t GetResidentCount() const { return this->residentCount; }
+
+private:
+	struct Page
+	{
+		uint32_t slot = NoSlot;
+		bool loading = false;
+	};
+
+	struct Slot
+	{
+		uint32_t page = NoSlot;
+		uint64_t lastUsed = 0;
+	};
+
+	VirtualTextureLayout layout;
+	uint32_t slotsAcross;
+	std::vector<Page> pages;
+	std::vector<Slot> slots;
+	uint32_t residentCount = 0;
+};
+
+// A page the feedback asks for that is not resident yet
+struct VirtualPageRequest
+{
+	uint32_t index = 0; // See VirtualTextureLayout::GetPageIndex
+	uint32_t pixels = 0; // Feedback pixels asking for the page or a page below it
+};
+
+// Reads the feedback buffer of a frame: touches every resident page that was sampled and lists the missing ones,
+// most wanted first. A page counts the pixels of every page below it as well, so a missing page always comes before
+// the finer pages it covers and the cache fills in coarse to fine
+class VirtualTextureFeedback
+{
+public:
+	explicit VirtualTextureFeedback(const VirtualTextureLayout& layout);
+
+	// requests gets at most maxRequests pages, not counting the ones loading already
+	void Analyze(const uint32_t* feedback, size_t count, uint64_t frame, VirtualPageTable& table, std::vector<VirtualPageRequest>& requests, size_t maxRequests);
+
+	// Ids in feedback the layout has no page for, since the last Analyze
+	uint32_t GetInvalidCount() const { return this->invalidCount; }
+
+private:
+	VirtualTextureLayout layout;
+	std::vector<uint32_t> pixels; // Per page, zeroed again after every Analyze
+	std::vector<uint32_t> requested; // Pages with pixels
+	std::vector<uint32_t> sampledPixels; // Pixels of the requested pages the feedback named itself
+	uint32_t invalidCount = 0;
+};
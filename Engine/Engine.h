@@ -16,6 +16,9 @@ public:
 	void Update();
 	void RenderFrame();
 	bool SaveScene();
+	void SetStreamingStressTest(unsigned int modelCount) { gfx.SetStreamingStressTest(modelCount); }
+	void SetTextureStreamingBudget(uint64_t budgetBytes) { gfx.SetTextureStreamingBudget(budgetBytes); }
+	void SetTextureTiers(const TextureTierSettings& tiers) { gfx.SetTextureTiers(tiers); }
 
 	void Shutdown();
 
@@ -0,0 +1,251 @@
+#include "FileHelper.h"
+
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <climits>
+#include <cstdlib>
+#endif
+
+bool FileHelper::FileExists(const std::string& filepath)
+{
+#ifdef _WIN32
+	DWORD attributes = GetFileAttributesA(filepath.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	struct stat info;
+	return stat(filepath.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+#endif
+}
+
+uint64_t FileHelper::GetFileSize(const std::string& filepath)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(filepath.c_str(), GetFileExInfoStandard, &data))
+		return 0;
+	return (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+#else
+	struct stat info;
+	if (stat(filepath.c_str(), &info) != 0)
+		return 0;
+	return static_cast<uint64_t>(info.st_size);
+#endif
+}
+
+uint64_t FileHelper::GetLastWriteTime(const std::string& filepath)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(filepath.c_str(), GetFileExInfoStandard, &data))
+		return 0;
+	return (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat info;
+	if (stat(filepath.c_str(), &info) != 0)
+		return 0;
+	return static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64_t>(info.st_mtim.tv_nsec);
+#endif
+}
+
+bool FileHelper::IsFileNewer(const std::string& filepath, const std::string& otherFilepath)
+{
+	return GetLastWriteTime(filepath) >= GetLastWriteTime(otherFilepath);
+}
+
+std::string FileHelper::GetCanonicalPath(const std::string& filepath)
+{
+#ifdef _WIN32
+	char buffer[MAX_PATH];
+	DWORD length = GetFullPathNameA(filepath.c_str(), MAX_PATH, buffer, nullptr);
+	if (length == 0 || length >= MAX_PATH)
+		return filepath;
+
+	// NTFS is case insensitive, so "Var1.fbx" and "var1.FBX" are the same file
+	std::string path(buffer, length);
+	for (char& c : path)
+	{
+		if (c == '/')
+			c = '\\';
+		else if (c >= 'A' && c <= 'Z')
+			c = static_cast<char>(c - 'A' + 'a');
+	}
+	return path;
+#else
+	char buffer[PATH_MAX];
+	if (realpath(filepath.c_str(), buffer) != nullptr)
+		return std::string(buffer);
+
+	// realpath needs the file to exist, resolve the directory instead so files that are about to be created still match
+	size_t slash = filepath.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "." : filepath.substr(0, slash);
+	if (realpath(directory.c_str(), buffer) == nullptr)
+		return filepath;
+	return std::string(buffer) + "/" + filepath.substr(slash == std::string::npos ? 0 : slash + 1);
+#endif
+}
+
+bool FileHelper::ReadFile(const std::string& filepath, std::vector<uint8_t>& data)
+{
+	FILE* file = fopen(filepath.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+
+	bool succeeded = fseek(file, 0, SEEK_END) == 0;
+	long size = succeeded ? ftell(file) : -1;
+	succeeded = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+	if (succeeded)
+	{
+		data.resize(static_cast<size_t>(size));
+		succeeded = size == 0 || fread(data.data(), 1, data.size(), file) == data.size();
+	}
+	fclose(file);
+	return succeeded;
+}
+
+bool FileHelper::WriteFileAtomic(const std::string& filepath, const void* data, size_t size)
+{
+	// Unique per process and call, so two threads or two machines writing the same file never share a temporary
+	static std::atomic<uint32_t> counter(0);
+#ifdef _WIN32
+	const unsigned long processId = GetCurrentProcessId();
+#else
+	const unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+	const std::string temporaryPath = filepath + "." + std::to_string(processId) + "." + std::to_string(counter++) + ".tmp";
+
+	FILE* file = fopen(temporaryPath.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+	bool succeeded = size == 0 || fwrite(data, 1, size, file) == size;
+	succeeded = fclose(file) == 0 && succeeded;
+
+#ifdef _WIN32
+	succeeded = succeeded && MoveFileExA(temporaryPath.c_str(), filepath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	succeeded = succeeded && rename(temporaryPath.c_str(), filepath.c_str()) == 0;
+#endif
+	if (!succeeded)
+		remove(temporaryPath.c_str());
+	return succeeded;
+}
+
+bool FileHelper::RemoveFile(const std::string& filepath)
+{
+	return remove(filepath.c_str()) == 0;
+}
+
+bool FileHelper::TouchFile(const std::string& filepath)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filepath.c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	FILETIME now;
+	GetSystemTimeAsFileTime(&now);
+	BOOL succeeded = SetFileTime(file, nullptr, nullptr, &now);
+	CloseHandle(file);
+	return succeeded != 0;
+#else
+	return utimes(filepath.c_str(), nullptr) == 0;
+#endif
+}
+
+bool FileHelper::CreateDirectories(const std::string& directory)
+{
+	if (directory.empty())
+		return false;
+
+	// Parents first, then this one. Failing because another thread or process created it in between is fine
+	size_t slash = directory.find_last_of("/\\");
+	if (slash != std::string::npos && slash > 0)
+	{
+		std::string parent = directory.substr(0, slash);
+		if (parent.back() != ':')
+			CreateDirectories(parent);
+	}
+
+#ifdef _WIN32
+	CreateDirectoryA(directory.c_str(), nullptr);
+	DWORD attributes = GetFileAttributesA(directory.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	mkdir(directory.c_str(), 0755);
+	struct stat info;
+	return stat(directory.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+std::vector<std::string> FileHelper::ListFiles(const std::string& directory, const std::string& extension)
+{
+	std::vector<std::string> files;
+	auto matches = [&extension](const std::string& name)
+	{
+		return extension.empty() || (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0);
+	};
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE)
+		return files;
+	do
+	{
+		if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && matches(data.cFileName))
+			files.push_back(data.cFileName);
+	} while (FindNextFileA(find, &data));
+	FindClose(find);
+#else
+	DIR* dir = opendir(directory.c_str());
+	if (dir == nullptr)
+		return files;
+	while (struct dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		struct stat info;
+		if (matches(name) && stat((directory + "/" + name).c_str(), &info) == 0 && S_ISREG(info.st_mode))
+			files.push_back(name);
+	}
+	closedir(dir);
+#endif
+	return files;
+}
+
+std::vector<std::string> FileHelper::ListDirectories(const std::string& directory)
+{
+	std::vector<std::string> directories;
+	auto isSpecial = [](const std::string& name) { return name == "." || name == ".."; };
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &data);
+	if (find == INVALID_HANDLE_VALUE)
+		return directories;
+	do
+	{
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !isSpecial(data.cFileName))
+			directories.push_back(data.cFileName);
+	} while (FindNextFileA(find, &data));
+	FindClose(find);
+#else
+	DIR* dir = opendir(directory.c_str());
+	if (dir == nullptr)
+		return directories;
+	while (struct dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		struct stat info;
+		if (!isSpecial(name) && stat((directory + "/" + name).c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+			directories.push_back(name);
+	}
+	closedir(dir);
+#endif
+	return directories;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FileHelper
+{
+public:
+	static bool FileExists(const std::string& filepath);
+	static uint64_t GetFileSize(const std::string& filepath);
+	static uint64_t GetLastWriteTime(const std::string& filepath); // Platform dependent tick count, only useful for comparisons. 0 if the file does not exist
+	static bool IsFileNewer(const std::string& filepath, const std::string& otherFilepath);
+	// Absolute path with . and .. resolved, so two spellings of the same file compare equal. Case and slashes are
+	// normalized on Windows. Returns the path unchanged if it cannot be resolved
+	static std::string GetCanonicalPath(const std::string& filepath);
+
+	static bool ReadFile(const std::string& filepath, std::vector<uint8_t>& data);
+	// Writes to a temporary file next to filepath and renames it over the top, so readers (other processes included)
+	// either see the old file or the whole new one
+	static bool WriteFileAtomic(const std::string& filepath, const void* data, size_t size);
+	static bool RemoveFile(const std::string& filepath);
+	// Sets the last write time to now
+	static bool TouchFile(const std::string& filepath);
+	// Creates the directory and any missing parents. True if it exists afterwards
+	static bool CreateDirectories(const std::string& directory);
+	// Names (not paths) of the regular files directly inside directory, optionally only those ending in extension
+	static std::vector<std::string> ListFiles(const std::string& directory, const std::string& extension = "");
+	// Names of the directories directly inside directory, without . and ..
+	static std::vector<std::string> ListDirectories(const std::string& directory);
+};
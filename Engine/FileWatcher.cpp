@@ -0,0 +1,186 @@
+#include "FileWatcher.h"
+#include "FileHelper.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace
+{
+	// Compares last write times, at most every PollInterval so the stat calls stay cheap with many watched files
+	class PollingBackend : public FileWatcher::Backend
+	{
+	public:
+		void Watch(const std::string& filepath) override
+		{
+			this->writeTimes[filepath] = FileHelper::GetLastWriteTime(filepath);
+		}
+
+		void Poll(std::vector<std::string>& changed) override
+		{
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now - this->lastPoll < PollInterval)
+				return;
+			this->lastPoll = now;
+
+			for (auto& entry : this->writeTimes)
+			{
+				uint64_t writeTime = FileHelper::GetLastWriteTime(entry.first);
+				if (writeTime != entry.second)
+				{
+					entry.second = writeTime;
+					changed.push_back(entry.first);
+				}
+			}
+		}
+
+	private:
+		static const std::chrono::milliseconds PollInterval;
+		std::unordered_map<std::string, uint64_t> writeTimes;
+		std::chrono::steady_clock::time_point lastPoll;
+	};
+
+	const std::chrono::milliseconds PollingBackend::PollInterval(250);
+
+#ifdef __linux__
+	// Watches the directories rather than the files, so a save that writes a temporary file and renames it over the
+	// original still shows up under the original name
+	class InotifyBackend : public FileWatcher::Backend
+	{
+	public:
+		InotifyBackend()
+		{
+			this->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		}
+
+		~InotifyBackend() override
+		{
+			if (this->fd >= 0)
+				close(this->fd);
+		}
+
+		bool IsValid() const { return this->fd >= 0; }
+
+		void Watch(const std::string& filepath) override
+		{
+			size_t slash = filepath.find_last_of('/');
+			std::string directory = slash == std::string::npos ? "." : filepath.substr(0, slash);
+			if (this->directoryWatches.count(directory) == 0)
+			{
+				int wd = inotify_add_watch(this->fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+				if (wd < 0)
+					return;
+				this->directoryWatches[directory] = wd;
+				this->directories[wd] = directory;
+			}
+			this->files.insert(filepath);
+		}
+
+		void Poll(std::vector<std::string>& changed) override
+		{
+			alignas(struct inotify_event) char buffer[4096];
+			for (;;)
+			{
+				ssize_t length = read(this->fd, buffer, sizeof(buffer));
+				if (length <= 0)
+					break; // EAGAIN, nothing more queued
+
+				for (char* cursor = buffer; cursor < buffer + length;)
+				{
+					const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(cursor);
+					cursor += sizeof(struct inotify_event) + event->len;
+
+					auto directory = this->directories.find(event->wd);
+					if (directory == this->directories.end() || event->len == 0)
+						continue;
+					std::string filepath = directory->second + "/" + event->name;
+					if (this->files.count(filepath) != 0)
+						changed.push_back(filepath);
+				}
+			}
+		}
+
+	private:
+		int fd = -1;
+		std::unordered_map<std::string, int> directoryWatches;
+		std::unordered_map<int, std::string> directories;
+		std::unordered_set<std::string> files;
+	};
+#endif
+
+	std::unique_ptr<FileWatcher::Backend> CreateDefaultBackend()
+	{
+#ifdef __linux__
+		std::unique_ptr<InotifyBackend> inotify(new InotifyBackend());
+		if (inotify->IsValid())
+			return std::unique_ptr<FileWatcher::Backend>(inotify.release());
+#endif
+		return std::unique_ptr<FileWatcher::Backend>(new PollingBackend());
+	}
+}
+
+const int FileWatcher::SettleMilliseconds;
+
+FileWatcher::FileWatcher()
+	: backend(CreateDefaultBackend())
+{
+}
+
+FileWatcher::FileWatcher(std::unique_ptr<Backend> backend)
+	: backend(std::move(backend))
+{
+}
+
+void FileWatcher::Watch(const std::string& filepath)
+{
+	std::string canonicalPath = FileHelper::GetCanonicalPath(filepath);
+	if (this->watched.insert(canonicalPath).second)
+		this->backend->Watch(canonicalPath);
+}
+
+bool FileWatcher::IsWatched(const std::string& filepath) const
+{
+	return this->watched.count(FileHelper::GetCanonicalPath(filepath)) != 0;
+}
+
+std::vector<FileWatcher::Change> FileWatcher::PollChanges()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	std::vector<std::string> events;
+	this->backend->Poll(events);
+	for (const std::string& filepath : events)
+	{
+		auto it = this->pending.find(filepath);
+		if (it == this->pending.end())
+		{
+			Pending& entry = this->pending[filepath];
+			entry.first = now;
+			entry.last = now;
+		}
+		else
+		{
+			it->second.last = now;
+		}
+	}
+
+	std::vector<Change> changes;
+	for (auto it = this->pending.begin(); it != this->pending.end();)
+	{
+		if (now - it->second.last >= std::chrono::milliseconds(SettleMilliseconds))
+		{
+			Change change;
+			change.filepath = it->first;
+			change.detected = it->second.first;
+			changes.push_back(change);
+			it = this->pending.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	return changes;
+}
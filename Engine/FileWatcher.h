@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Reports watched files whose contents changed on disk. The platform part sits behind FileWatcher::Backend:
+// inotify on Linux, polling last write times everywhere else. A ReadDirectoryChangesW backend can slot in the same way
+class FileWatcher
+{
+public:
+	class Backend
+	{
+	public:
+		virtual ~Backend() {}
+		// filepath is already canonical, see FileHelper::GetCanonicalPath
+		virtual void Watch(const std::string& filepath) = 0;
+		// Appends watched files that changed since the last call. The same file may show up several times
+		virtual void Poll(std::vector<std::string>& changed) = 0;
+	};
+
+	struct Change
+	{
+		std::string filepath; // Canonical
+		std::chrono::steady_clock::time_point detected; // First event of the burst, reload latency is measured from here
+	};
+
+	// Editors tend to save in several writes, a change is only reported once the file has been quiet this long
+	static const int SettleMilliseconds = 100;
+
+	FileWatcher(); // Default backend for the platform
+	explicit FileWatcher(std::unique_ptr<Backend> backend);
+
+	// Watching a file that does not exist yet is fine, creating it counts as a change
+	void Watch(const std::string& filepath);
+	bool IsWatched(const std::string& filepath) const;
+
+	// Changes that have settled since the last call, each file at most once
+	std::vector<Change> PollChanges();
+
+private:
+	struct Pending
+	{
+		std::chrono::steady_clock::time_point first;
+		std::chrono::steady_clock::time_point last;
+	};
+
+	std::unique_ptr<Backend> backend;
+	std::unordered_set<std::string> watched;
+	std::unordered_map<std::string, Pending> pending;
+};
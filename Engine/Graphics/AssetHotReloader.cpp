@@ -0,0 +1,185 @@
+#include "AssetHotReloader.h"
+#include "../Assets/CookedMesh.h"
+#include "../FileHelper.h"
+#include "../ThreadPool.h"
+#include <cstdio>
+
+namespace
+{
+	const char* const AssetTypeNames[] = { "Mesh", "Texture", "Shader" };
+
+	double GetMillisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+AssetHotReloader::AssetHotReloader(ThreadPool& pool)
+	: pool(pool)
+{
+}
+
+AssetHotReloader::AssetHotReloader()
+	: pool(ThreadPool::GetShared())
+{
+}
+
+void AssetHotReloader::Watch(const std::string& filepath, AssetType type, ReloadFunction reload)
+{
+	Watched entry;
+	entry.type = type;
+	entry.reload = reload;
+	this->watched[FileHelper::GetCanonicalPath(filepath)].push_back(entry);
+	this->watcher.Watch(filepath);
+}
+
+void AssetHotReloader::Update()
+{
+	this->frame++;
+	while (!this->retired.empty() && this->retired.front().frame + RetireFrames <= this->frame)
+		this->retired.pop_front();
+
+	WatchResidentModels();
+
+	for (const FileWatcher::Change& change : this->watcher.PollChanges())
+	{
+		auto models = this->models.find(change.filepath);
+		if (models != this->models.end())
+		{
+			for (const ModelCache::Resident& resident : models->second)
+				StartMeshReload(resident, change.detected);
+		}
+
+		auto watched = this->watched.find(change.filepath);
+		if (watched != this->watched.end())
+		{
+			for (const Watched& entry : watched->second)
+				Record(entry.type, change.filepath, change.detected, entry.reload(change.filepath));
+		}
+	}
+}
+
+void AssetHotReloader::UploadMeshes(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UploadHeapRing& uploadRing)
+{
+	FinishMeshReloads(device, commandList, uploadRing);
+}
+
+AssetHotReloader::Statistics AssetHotReloader::GetStatistics(AssetType type) const
+{
+	return this->statistics[static_cast<size_t>(type)];
+}
+
+void AssetHotReloader::WatchResidentModels()
+{
+	uint64_t generation = ModelCache::GetShared().GetGeneration();
+	if (generation == this->modelGeneration)
+		return;
+	this->modelGeneration = generation;
+
+	// Only models imported the way Model imports them can be rebuilt by Model::LoadModelData
+	const std::string importKey = Model::GetImportOptions().GetKey();
+	this->models.clear();
+	for (const ModelCache::Resident& resident : ModelCache::GetShared().GetResidentModels())
+	{
+		if (resident.importKey != importKey)
+			continue;
+
+		// Re-cooking with the asset tool counts as a change just like editing the source
+		std::string cookedPath = StringHelper::GetFileExtension(resident.filepath) == CookedMesh::Extension ? resident.filepath : CookedMesh::GetCookedPath(resident.filepath);
+		this->models[resident.filepath].push_back(resident);
+		this->watcher.Watch(resident.filepath);
+		if (cookedPath != resident.filepath)
+		{
+			this->models[FileHelper::GetCanonicalPath(cookedPath)].push_back(resident);
+			this->watcher.Watch(cookedPath);
+		}
+	}
+}
+
+void AssetHotReloader::StartMeshReload(const ModelCache::Resident& resident, std::chrono::steady_clock::time_point detected)
+{
+	for (const std::shared_ptr<MeshReload>& reload : this->meshReloads)
+	{
+		if (reload->resident.filepath == resident.filepath && reload->resident.importKey == resident.importKey)
+		{
+			// Whatever it is importing is already out of date, it starts over once it is done
+			reload->stale = true;
+			return;
+		}
+	}
+
+	std::shared_ptr<MeshReload> reload = std::make_shared<MeshReload>();
+	reload->resident = resident;
+	reload->detected = detected;
+	this->pool.Enqueue([reload]()
+	{
+		reload->succeeded = Model::LoadModelData(reload->resident.filepath, reload->modelData);
+		reload->done.store(true, std::memory_order_release);
+	});
+	this->meshReloads.push_back(reload);
+}
+
+void AssetHotReloader::FinishMeshReloads(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UploadHeapRing& uploadRing)
+{
+	std::vector<std::shared_ptr<MeshReload>> finished;
+	for (auto it = this->meshReloads.begin(); it != this->meshReloads.end();)
+	{
+		if ((*it)->done.load(std::memory_order_acquire))
+		{
+			finished.push_back(*it);
+			it = this->meshReloads.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	for (const std::shared_ptr<MeshReload>& reload : finished)
+	{
+		if (reload->stale)
+		{
+			StartMeshReload(reload->resident, reload->detected);
+			continue;
+		}
+
+		ModelGeometry geometry;
+		bool succeeded = reload->succeeded && Model::CreateGeometry(reload->resident.filepath, reload->modelData, device, commandList, uploadRing, geometry);
+		if (succeeded && !ModelCache::GetShared().Replace(reload->resident.filepath, reload->resident.importKey, geometry))
+			continue; // Every Model of the file let go of it while it was importing, nothing to swap
+
+		if (succeeded)
+		{
+			Retired retired;
+			retired.frame = this->frame;
+			retired.meshes.swap(geometry.meshes);
+			this->retired.push_back(std::move(retired));
+		}
+		Record(AssetType::Mesh, reload->resident.filepath, reload->detected, succeeded);
+	}
+}
+
+void AssetHotReloader::Record(AssetType type, const std::string& filepath, std::chrono::steady_clock::time_point detected, bool succeeded)
+{
+	Statistics& statistics = this->statistics[static_cast<size_t>(type)];
+	char message[512];
+	if (!succeeded)
+	{
+		statistics.failures++;
+		snprintf(message, sizeof(message), "Hot reload: %s %s failed, keeping the previous version\n", AssetTypeNames[static_cast<size_t>(type)], filepath.c_str());
+		OutputDebugStringA(message);
+		return;
+	}
+
+	double milliseconds = GetMillisecondsSince(detected);
+	statistics.reloads++;
+	statistics.totalMilliseconds += milliseconds;
+	statistics.lastMilliseconds = milliseconds;
+	if (milliseconds > statistics.maxMilliseconds)
+		statistics.maxMilliseconds = milliseconds;
+
+	snprintf(message, sizeof(message), "Hot reload: %s %s in %.2f ms (%u reloads, %.2f ms average, %.2f ms max)\n",
+		AssetTypeNames[static_cast<size_t>(type)], filepath.c_str(), milliseconds,
+		statistics.reloads, statistics.GetAverageMilliseconds(), statistics.maxMilliseconds);
+	OutputDebugStringA(message);
+}
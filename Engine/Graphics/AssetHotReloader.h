@@ -0,0 +1,107 @@
+#pragma once
+#include "Model.h"
+#include "ModelCache.h"
+#include "../FileWatcher.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+// Reloads assets whose files change on disk and swaps them in between frames.
+//
+// Models in the ModelCache are watched on their own, both the source file and its cooked copy. Only the changed file
+// is imported again, on the thread pool, and UploadMeshes swaps the new meshes in under every Model holding it.
+// Textures and shaders belong to whoever created them, so they register a reload function with Watch instead.
+//
+// Latency is measured per asset type from the change being detected to the new version being in use. Update and
+// UploadMeshes must be called once per frame on the render thread
+class AssetHotReloader
+{
+public:
+	enum class AssetType
+	{
+		Mesh,
+		Texture,
+		Shader,
+		Count
+	};
+
+	// Runs from Update on the render thread, returns whether the new version is now in use
+	typedef std::function<bool(const std::string& filepath)> ReloadFunction;
+
+	struct Statistics
+	{
+		uint32_t reloads = 0;
+		uint32_t failures = 0;
+		double totalMilliseconds = 0.0;
+		double maxMilliseconds = 0.0;
+		double lastMilliseconds = 0.0;
+
+		double GetAverageMilliseconds() const { return reloads > 0 ? totalMilliseconds / reloads : 0.0; }
+	};
+
+	// Replaced meshes are kept this many frames, by then the GPU has finished every frame that drew them
+	static const uint64_t RetireFrames = 3;
+
+	explicit AssetHotReloader(ThreadPool& pool);
+	AssetHotReloader();
+
+	void Watch(const std::string& filepath, AssetType type, ReloadFunction reload);
+
+	// Polls the watched files, runs the reload functions and starts mesh imports. Reload functions may submit work of
+	// their own, so the frame's command list must not be recording yet
+	void Update();
+	// Creates the buffers of finished mesh imports and swaps them in, the uploads are recorded on commandList and
+	// their upload buffers retired to uploadRing
+	void UploadMeshes(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UploadHeapRing& uploadRing);
+
+	Statistics GetStatistics(AssetType type) const;
+	size_t GetPendingCount() const { return this->meshReloads.size(); }
+
+private:
+	struct Watched
+	{
+		AssetType type;
+		ReloadFunction reload;
+	};
+
+	// One re-import of a resident model, shared with the worker running it
+	struct MeshReload
+	{
+		ModelCache::Resident resident;
+		ModelData modelData;
+		bool succeeded = false;
+		bool stale = false; // Render thread only, the file changed again while this was importing
+		std::chrono::steady_clock::time_point detected;
+		std::atomic<bool> done;
+
+		MeshReload() : done(false) {}
+	};
+
+	struct Retired
+	{
+		uint64_t frame;
+		std::vector<Mesh> meshes;
+	};
+
+	void WatchResidentModels();
+	void StartMeshReload(const ModelCache::Resident& resident, std::chrono::steady_clock::time_point detected);
+	void FinishMeshReloads(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UploadHeapRing& uploadRing);
+	void Record(AssetType type, const std::string& filepath, std::chrono::steady_clock::time_point detected, bool succeeded);
+
+	ThreadPool& pool;
+	FileWatcher watcher;
+	std::unordered_map<std::string, std::vector<Watched>> watched; // Canonical path
+	std::unordered_map<std::string, std::vector<ModelCache::Resident>> models; // Canonical source or cooked path to the models built from it
+	uint64_t modelGeneration = ~0ull;
+	std::vector<std::shared_ptr<MeshReload>> meshReloads;
+	std::deque<Retired> retired;
+	uint64_t frame = 0;
+	Statistics statistics[static_cast<size_t>(AssetType::Count)];
+};
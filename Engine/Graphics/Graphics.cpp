@@ -1,9 +1,18 @@
 #include "Graphics.h"
+#include "VertexLayouts.h"
 #include "DXRHelpers/DXRHelper.h"
 #include "DXRHelpers/nv_helpers_dx12/BottomLevelASGenerator.h"
 #include "DXRHelpers/nv_helpers_dx12/RaytracingPipelineGenerator.h"
 #include "DXRHelpers/nv_helpers_dx12/RootSignatureGenerator.h"
 #include "DXRHelpers/nv_helpers_dx12/ShaderBindingTableGenerator.h"
+#include "../Assets/ContentHash.h"
+#include "../Assets/DerivedDataCache.h"
+#include "../Assets/ImageDecoder.h"
+#include "../Assets/MappedFile.h"
+#include "../Assets/MipGenerator.h"
+#include "../FileHelper.h"
+#include "../ThreadPool.h"
+#include <cassert>
 #include <stdexcept>
 #pragma comment(lib, "D3DCompiler.lib")
 #pragma comment(lib, "d3d11.lib")
@@ -15,6 +24,7 @@ bool Graphics::Initialize(HWND hwnd, int width, int height)
 {
 	windowWidth = width;
 	windowHeight = height;
+	startupTimer.Start();
 
 	if (!InitializeDirect3D12(hwnd))
 		return false;
@@ -29,7 +39,10 @@ bool Graphics::Initialize(HWND hwnd, int width, int height)
 	if (!InitializeScene())
 		return false;
 
-	cube.Initialize("Resources\Models\Dandelion\Var1", pDevice.Get(), pCommandList.Get(), cb_vertexShader);
+	if (streamingStressTestCount > 0)
+		StartStreamingStressTest();
+
+	WatchAssets();
 
 	return true;
 }
@@ -46,6 +59,13 @@ void Graphics::RenderFrame()
 	// Execute the array of command lists
 	pCommandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
 
+	// The constants this frame allocated are free again once the queue gets past this
+	if (!constantRing.EndFrame(pCommandQueue.Get()))
+	{
+		ErrorLogger::Log("Command queue failed to signal the constant buffer upload ring");
+		Running = false;
+	}
+
 	// This command goes in at the end of out command queue. We will know when our command queue
 	// has finished becasue the fence value will be set to "fenceValue" from the GPU since the 
 	// command queue is being executed on the GPU
@@ -63,6 +83,59 @@ void Graphics::RenderFrame()
 		ErrorLogger::Log(hr, "Swapchain failed to present");
 		Running = false;
 	}
+
+	if (timeToFirstFrame == 0.0)
+		timeToFirstFrame = startupTimer.GetMilisecondsElapsed();
+}
+
+void Graphics::StartStreamingStressTest()
+{
+	// Cycles through all twelve Dandelion files, so most requests share an import or hit the ModelCache
+	streamedModels.reserve(streamingStressTestCount);
+	for (unsigned int i = 0; i < streamingStressTestCount; i++)
+	{
+		std::string name = "Var" + std::to_string(i % 3 + 1);
+		std::string filepath = "Resources\\Models\\Dandelion\\" + name + "\\" + name + "_LOD" + std::to_string(i / 3 % 4) + ".fbx";
+		streamedModels.push_back(modelStreamer.Load(filepath, cb_vertexShader));
+	}
+
+	char message[128];
+	snprintf(message, sizeof(message), "Streaming stress test: queued %u models in %.2f ms after startup\n", streamingStressTestCount, startupTimer.GetMilisecondsElapsed());
+	OutputDebugStringA(message);
+}
+
+void Graphics::UpdateTextureStreaming()
+{
+	if (textureStreamer == nullptr)
+		return;
+
+	// Both cubes sample the texture, the first one stands in for them. It is one unit across
+	StreamingView view;
+	view.screenHeight = static_cast<float>(windowHeight);
+	const XMFLOAT3& cameraPosition = camera.GetPositionFloat3();
+	const float dx = cube1Position.x - cameraPosition.x;
+	const float dy = cube1Position.y - cameraPosition.y;
+	const float dz = cube1Position.z - cameraPosition.z;
+	textureStreamer->Touch(streamedTexture, sqrtf(dx * dx + dy * dy + dz * dz), 1.0f, view);
+}
+
+void Graphics::UpdateStreamingStressTest()
+{
+	if (streamingStressTestCount == 0 || modelStreamer.GetPendingCount() > 0)
+		return;
+
+	ModelStreamer::Statistics statistics = modelStreamer.GetStatistics();
+	ModelCache::Statistics cacheStatistics = ModelCache::GetShared().GetStatistics();
+	char message[512];
+	snprintf(message, sizeof(message),
+		"Streaming stress test: first frame after %.2f ms, %u models resident after %.2f ms\n"
+		"  %u imports (%.2f ms on the workers), %u uploaded (%.2f ms on the render thread), %u failed\n"
+		"  Model cache hit rate %.1f%%, %.2f MB of buffers shared\n",
+		timeToFirstFrame, streamingStressTestCount, startupTimer.GetMilisecondsElapsed(),
+		statistics.imported, statistics.importMilliseconds, statistics.uploaded, statistics.uploadMilliseconds, statistics.failed,
+		cacheStatistics.GetHitRate() * 100.0f, cacheStatistics.bytesSaved / (1024.0 * 1024.0));
+	OutputDebugStringA(message);
+	streamingStressTestCount = 0;
 }
 
 bool Graphics::InitializeDirect3D12(HWND hwnd)
@@ -280,116 +353,12 @@ bool Graphics::InitializeDirect3D12(HWND hwnd)
 		return false;
 	}
 
-	// -- Create vertex and pixel shaders -- //
-
-	// When debugging , we can compile the shader at runtime.
-	// But for release versions, we can compile the hlsl shaders
-	// with fxc.exe to create .cso file, which contian the shader
-	// bytecode. We can load the .cso files at runtime to get the 
-	// shader bytecode, which of course is faster than compiling 
-	// them at runtime
-
-	// Compile vertex shader
-	ID3DBlob* vertexShader; // d3d blob for holding vertex shader bytecode
-	ID3DBlob* errorBuffer; // A buffer holding the error data if any
-	hr = D3DCompileFromFile(L"VertexShader.hlsl",
-		nullptr,
-		nullptr,
-		"main",
-		"vs_5_0",
-		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION,
-		0,
-		&vertexShader,
-		&errorBuffer);
-
-	if (FAILED(hr))
-	{
-		OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
-		ErrorLogger::Log(hr, "Failed to compile Vertex shader");
-		return false;
-	}
-
-	// Fill out a shader bytecode structure, which is basically just a pointer
-	// to the shader bytecode and the size of the shader bytecode
-	D3D12_SHADER_BYTECODE vertexShaderBytecode = {};
-	vertexShaderBytecode.BytecodeLength = vertexShader->GetBufferSize();
-	vertexShaderBytecode.pShaderBytecode = vertexShader->GetBufferPointer();
-
-	// Compile shader
-	ID3DBlob* pixelShader;
-	hr = D3DCompileFromFile(L"PixelShader.hlsl",
-		nullptr,
-		nullptr,
-		"main",
-		"ps_5_0",
-		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION,
-		0,
-		&pixelShader,
-		&errorBuffer);
-	if (FAILED(hr))
-	{
-		OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
-		ErrorLogger::Log(hr, "Failed to compile Pixel shader");
-		return false;
-	}
-
-	// Fill Out shader bytecode structure for pixel shader
-	D3D12_SHADER_BYTECODE pixelShaderBytecode = {};
-	pixelShaderBytecode.BytecodeLength = pixelShader->GetBufferSize();
-	pixelShaderBytecode.pShaderBytecode = pixelShader->GetBufferPointer();
-
-	// Create Input layout
-
-	// The input layout is used by the Input Assembler so that it knows
-	// how to read the vertex data bound to it.
-
-	D3D12_INPUT_ELEMENT_DESC inputLayout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-	};
-
-	// Fill out an inpu layout description structure
-	D3D12_INPUT_LAYOUT_DESC inputLayoutDesc = {};
-
-	// We can get the number of elements in an array by "sizeof(array) / sizeof(arrayElementType)"
-
-	inputLayoutDesc.NumElements = sizeof(inputLayout) / sizeof(D3D12_INPUT_ELEMENT_DESC);
-	inputLayoutDesc.pInputElementDescs = inputLayout;
-
 	cb_vertexShader.Initialize(pDevice.Get(), pCommandList.Get());
 
-	// Create a pipleline state object (PSO)
-
-	// In a real application, you will have many pso's. For each diferent shader
-	// or in difference combinations of shaders, differenc blend states or different rasterizer states,
-	// different topology types (point, line, triangle patch), or different numberof render targets
-	// you will need a pso
-
-	// VS is the only required shader for the pso. You might be wondering whan a case would be where
-	// you only set the VS. It's possible that you have a pso that only outpus data with the stream
-	// output, and not on a render target, which means you would not need anything after the stream output
-
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {}; // A structure to define a pso
-	psoDesc.InputLayout = inputLayoutDesc; // The structure describing out input layout
-	psoDesc.pRootSignature = pRootSignature.Get(); // The root signature that describes the input data this pso needs
-	psoDesc.VS = vertexShaderBytecode; // Structure describing where to find the vertex shader bytecode and how large it is
-	psoDesc.PS = pixelShaderBytecode; // Same as VS but for the pixel shader
-	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE; // Type of topology we are drawing
-	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM; // Format of the render target
-	psoDesc.SampleDesc = sampleDesc;
-	psoDesc.SampleMask = 0xffffffff; // Sample mask has to do with multi-sampling. 0xffffffff means point sampling is done
-	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT); // A default rasterizer state
-	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT); // A default blend state
-	psoDesc.NumRenderTargets = 1; // We are only binding one render target
-	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT); // A default stencil state
-	//psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-
-	// Create the PSO
-	hr = pDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pPipelineStateObject));
-	if (FAILED(hr))
+	// -- Create vertex and pixel shaders and the pso that uses them -- //
+	if (!CreatePipelineState())
 	{
-		ErrorLogger::Log(hr, "Failed to create pipleline state object");
+		ErrorLogger::Log("Failed to create pipleline state object, see the debug output for shader errors");
 		return false;
 	}
 
@@ -596,130 +565,61 @@ bool Graphics::InitializeDirect3D12(HWND hwnd)
 
 
 
-	// Create the constant buffer resource heap
-	// We will update the constant buffer one or more times per frame, so we will use only an upload heap
-	// unlike previously we used an upload heap to upload the vertex and idndex data, and then copied over 
-	// to a default heap. If you plan to use a resource for more than a couple of frames, it is usually 
-	// more efficient to copy to a default heap where it stays on the GPU. In this case, our constant 
-	// buffer will be modified and uploaded at least once per frame so we only use an upload heap
-
-	// First we will create a resource heap (uplaoad heap) for each frame for the cubes ocntant buffers.
-	// As you can see we are allocating 64KB for each resource we create. Buffer resource heaps must 
-	// be an alignment of 64KB. We are creating 3 resources, one for each frame. Each constant buffer is
-	// only a 4x4 matrix of floats in this tutorail. So with a float being 4 bytes, we have 16 floats in one 
-	// constant buffer, and we will store 2 constant buffers in each heap, one for each cube, that sony 64x2 bits,
-	// or 128 bits we are using for each resource, and each resource must be at least 64KB (65536 bits)
-
-	for (int i = 0; i < frameBufferCount; ++i)
+	// Per object constants are written every frame, so they live in upload heaps the GPU reads from directly. The
+	// ring hands out a fresh chunk per draw and takes pages back once the frame that used them has finished
+	if (!constantRing.Initialize(pDevice.Get()))
 	{
-		// create resource for cube 1
-		hr = pDevice->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), // this heap will be used to upload the constant buffer data
-			D3D12_HEAP_FLAG_NONE, // no flags
-			&CD3DX12_RESOURCE_DESC::Buffer(1024 * 64), // size of the resource heap. Must be a multiple of 64KB for single-textures and constant buffers
-			D3D12_RESOURCE_STATE_GENERIC_READ, // will be data that is read from so we keep it in the generic read state
-			nullptr, // we do not have use an optimized clear value for constant buffers
-			IID_PPV_ARGS(&pConstantBufferUploadHeaps[i]));
-		pConstantBufferUploadHeaps[i]->SetName(L"Constant Buffer Upload Resource Heap");
-
-		ZeroMemory(&cbPerObject, sizeof(cbPerObject));
-
-		CD3DX12_RANGE readRange(0, 0);    // We do not intend to read from this resource on the CPU. (so end is less than or equal to begin)
-
-		// map the resource heap to get a gpu virtual address to the beginning of the heap
-		hr = pConstantBufferUploadHeaps[i]->Map(0, &readRange, reinterpret_cast<void**>(&pCbvGPUAddress[i]));
-
-		// Because of the constant read alignment requirements, constant buffer views must be 256 bit aligned. Our buffers are smaller than 256 bits,
-		// so we need to add spacing between the two buffers, so that the second buffer starts at 256 bits from the beginning of the resource heap.
-		memcpy(pCbvGPUAddress[i], &cbPerObject, sizeof(cbPerObject)); // cube1's constant buffer data
-		memcpy(pCbvGPUAddress[i] + ConstantBufferPerObjectAlignedSize, &cbPerObject, sizeof(cbPerObject)); // cube2's constant buffer data
-	}
-
-	D3D12_RESOURCE_DESC textureDesc;
-	int imageBytesPerRow;
-	BYTE* imageData;
-	int imageSize = LoadImageDataFromFile(&imageData, textureDesc, L"Resources\\Textures\\Catalina.jpg", imageBytesPerRow);
-	if (imageSize <= 0)
-	{
-		ErrorLogger::Log(hr, "Failed to load image from file");
-		Running = false;
+		ErrorLogger::Log("Failed to create the constant buffer upload ring");
 		return false;
 	}
 
-	hr = pDevice->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT), // A default heap
-		D3D12_HEAP_FLAG_NONE, // No flags
-		&textureDesc, // The description of our texture
-		D3D12_RESOURCE_STATE_COPY_DEST, // We will copy the texture from the upload heap to here, so we start it out in a copy dest state
-		nullptr, // Used for render targets and depth/stencil buffers
-		IID_PPV_ARGS(&pTextureBuffer)
-	);
-
+	// Create the descriptor heap that will store our srv, after it the ones a streamed texture moves through and then
+	// the material textures (see LoadMaterialTexture)
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+	heapDesc.NumDescriptors = 1 + frameBufferCount + MaxMaterialTextures;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	hr = pDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(pMainDescriptorHeap->GetAddressOf()));
 	if (FAILED(hr))
 	{
-		ErrorLogger::Log(hr, "Failed to create commited resource for texture");
-		Running = false;
+		ErrorLogger::Log(hr, "Failed to create descriptor heap for texture resource");
+		Running = true;
 		return false;
 	}
-	pTextureBuffer.Get()->SetName(L"Texture Buffer Resource Heap");
-	UINT64 textureUploadBufferSize;
-	// This function get the size an upload buffer needs to be to upload a texture to the GPU.
-	// Each row must be 256 byte aligned exeplt for the last row, which can just be the size in bytes of the row
-	// eg. textureUploadBufferSize = ((((width * numBytesPerPixel) + 255) & ~255) * (height - 1)) + (width * numBytesPerPixel);
-	// textureUploadBufferSize = (((imageBytesPerRow + 255) & ~255) * (textureDesc.Height - 1)) + imageBytesPerRow;
-	pDevice->GetCopyableFootprints(&textureDesc, 0, 1, 0, nullptr, nullptr, nullptr, &textureUploadBufferSize);
+	TextureCache::GetShared().SetLoadFunction([this](const std::string& filepath, D3D12_GPU_DESCRIPTOR_HANDLE& descriptor)
+	{
+		return LoadMaterialTexture(filepath, descriptor);
+	});
 
-	// now we create an upload heap to upload our texture to the GPU
-	hr = pDevice->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), // Upload heap
-		D3D12_HEAP_FLAG_NONE, // no flags
-		&CD3DX12_RESOURCE_DESC::Buffer(textureUploadBufferSize), // Resource description for a buffer (storeing the image data in this heap just a copy to the default heap)
-		D3D12_RESOURCE_STATE_GENERIC_READ, // We will copy the contents from this heap to the default heap above
-		nullptr,
-		IID_PPV_ARGS(&pTextureBufferUploadHeap)
-	);
-	if (FAILED(hr))
+	// Upload the texture and create its srv, the same path reloads it when the file changes
+	if (!CreateTexture(L"Resources\\Textures\\Catalina.jpg"))
 	{
-		ErrorLogger::Log(hr, "Failed to commit texture to GPU memory");
+		ErrorLogger::Log("Failed to create texture from Resources\\Textures\\Catalina.jpg");
 		Running = false;
 		return false;
 	}
-	pTextureBufferUploadHeap->SetName(L"Texture Buffer Upload Resource Heap");
-
-	// Store vertex buffer in upload heap
-	D3D12_SUBRESOURCE_DATA textureData = {};
-	textureData.pData = &imageData[0]; // Pointer to our image data
-	textureData.RowPitch = imageBytesPerRow; // Size of all our triangle vertex data
-
-	// now we can copy the upload buffer contents to the default heap
-	UpdateSubresources(pCommandList.Get(), pTextureBuffer.Get(), pTextureBufferUploadHeap, 0, 0, 1, &textureData);
 
-	// Transition the texture default heap to a pixel shader resource (we will be sampling frrom this heap in the pixel shader to get the color of pixels)
-	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(pTextureBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-
-	// Create the descriptor heap that will store our srv
-	D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-	heapDesc.NumDescriptors = 1;
-	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	hr = pDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(pMainDescriptorHeap->GetAddressOf()));
-	if (FAILED(hr))
+	// With a budget the cubes sample a streamed copy of the cooked texture instead, see UpdateTextureStreaming
+	if (textureStreamingBudget > 0)
 	{
-		ErrorLogger::Log(hr, "Failed to create descriptor heap for texture resource");
-		Running = true;
-		return false;
+		TextureResidency::Settings streamingSettings;
+		streamingSettings.budgetBytes = textureStreamingBudget;
+		textureStreamer.reset(new TextureStreamer(streamingSettings, frameBufferCount));
+		const UINT descriptorSize = pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		CD3DX12_CPU_DESCRIPTOR_HANDLE firstDescriptor(pMainDescriptorHeap->Get()->GetCPUDescriptorHandleForHeapStart(), 1, descriptorSize);
+		if (!textureStreamer->Add(pDevice.Get(), pCommandList.Get(), Dds::GetCookedPath("Resources\\Textures\\Catalina.jpg"), firstDescriptor, descriptorSize, streamedTexture))
+		{
+			OutputDebugStringA("No cooked Catalina.dds to stream, run Engine.exe -cooktextures Resources\\Textures first\n");
+			textureStreamer.reset();
+		}
 	}
 
-	// Now we create a shader resource view (descriptor that points to the texture and descripbes it)
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = textureDesc.Format;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
-	pDevice->CreateShaderResourceView(pTextureBuffer.Get(), &srvDesc, pMainDescriptorHeap->Get()->GetCPUDescriptorHandleForHeapStart());
 
 
 
+	// Recorded with the rest of the initial uploads below
+	if (!cube.Initialize("Resources\\Models\\Dandelion\\Var1\\Var1_LOD0.fbx", pDevice.Get(), pCommandList.Get(), constantRing, cb_vertexShader))
+		OutputDebugStringA("Failed to load the Dandelion model\n");
 
 #pragma region Initialize Ray Tracing
 
@@ -747,7 +647,6 @@ bool Graphics::InitializeDirect3D12(HWND hwnd)
 	{
 		ErrorLogger::Log(hr, "Failed in signal command queue");
 	}
-	delete imageData;
 
 	// Create vertex buffer view for the triangle. We get the GPU memory address to the vertex pointer using the GetGPUVertualAddress() method
 	vertexbufferView.BufferLocation = pVertexBuffer->GetGPUVirtualAddress();
@@ -756,6 +655,7 @@ bool Graphics::InitializeDirect3D12(HWND hwnd)
 
 	// Create a vertex buffer view for the triangle. We get the GPU memory address to the vertex pointer using the GetGPUVirtualAddress() method
 	indexBufferView.BufferLocation = pIndexBuffer->GetGPUVirtualAddress();
+	// The cube would fit in 16 bits, but this buffer also feeds the BLAS and the DXR helper always describes indices as R32_UINT
 	indexBufferView.Format = DXGI_FORMAT_R32_UINT; // 32-bit unsigned integer (this is what a dword is, double word, a word is 2 bytes)
 	indexBufferView.SizeInBytes = iBufferSize;
 
@@ -818,12 +718,542 @@ bool Graphics::InitializeDirect3D12(HWND hwnd)
 	return true;
 }
 
+bool Graphics::CreatePipelineState()
+{
+	// -- Create vertex and pixel shaders -- //
+
+	// When debugging , we can compile the shader at runtime.
+	// But for release versions, we can compile the hlsl shaders
+	// with fxc.exe to create .cso file, which contian the shader
+	// bytecode. We can load the .cso files at runtime to get the 
+	// shader bytecode, which of course is faster than compiling 
+	// them at runtime
+
+	// Compile vertex shader
+	ComPtr<ID3DBlob> vertexShader; // d3d blob for holding vertex shader bytecode
+	ComPtr<ID3DBlob> errorBuffer; // A buffer holding the error data if any
+	HRESULT hr = D3DCompileFromFile(L"VertexShader.hlsl",
+		nullptr,
+		nullptr,
+		"main",
+		"vs_5_0",
+		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION,
+		0,
+		&vertexShader,
+		&errorBuffer);
+
+	if (FAILED(hr))
+	{
+		// No error buffer when the file itself could not be read
+		if (errorBuffer != nullptr)
+			OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
+		OutputDebugStringA("Failed to compile Vertex shader\n");
+		return false;
+	}
+
+	// Fill out a shader bytecode structure, which is basically just a pointer
+	// to the shader bytecode and the size of the shader bytecode
+	D3D12_SHADER_BYTECODE vertexShaderBytecode = {};
+	vertexShaderBytecode.BytecodeLength = vertexShader->GetBufferSize();
+	vertexShaderBytecode.pShaderBytecode = vertexShader->GetBufferPointer();
+
+	// Compile the vertex shader for the packed vertex formats, it dequantizes through wvpMat
+	ComPtr<ID3DBlob> compactVertexShader;
+	hr = D3DCompileFromFile(L"VertexShaderCompact.hlsl",
+		nullptr,
+		nullptr,
+		"main",
+		"vs_5_0",
+		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION,
+		0,
+		&compactVertexShader,
+		&errorBuffer);
+	if (FAILED(hr))
+	{
+		if (errorBuffer != nullptr)
+			OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
+		OutputDebugStringA("Failed to compile compact Vertex shader\n");
+		return false;
+	}
+
+	D3D12_SHADER_BYTECODE compactVertexShaderBytecode = {};
+	compactVertexShaderBytecode.BytecodeLength = compactVertexShader->GetBufferSize();
+	compactVertexShaderBytecode.pShaderBytecode = compactVertexShader->GetBufferPointer();
+
+	// Compile shader
+	ComPtr<ID3DBlob> pixelShader;
+	hr = D3DCompileFromFile(L"PixelShader.hlsl",
+		nullptr,
+		nullptr,
+		"main",
+		"ps_5_0",
+		D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION,
+		0,
+		&pixelShader,
+		&errorBuffer);
+	if (FAILED(hr))
+	{
+		if (errorBuffer != nullptr)
+			OutputDebugStringA((char*)errorBuffer->GetBufferPointer());
+		OutputDebugStringA("Failed to compile Pixel shader\n");
+		return false;
+	}
+
+	// Fill Out shader bytecode structure for pixel shader
+	D3D12_SHADER_BYTECODE pixelShaderBytecode = {};
+	pixelShaderBytecode.BytecodeLength = pixelShader->GetBufferSize();
+	pixelShaderBytecode.pShaderBytecode = pixelShader->GetBufferPointer();
+
+	// Create Input layout
+
+	// The input layout is used by the Input Assembler so that it knows
+	// how to read the vertex data bound to it.
+
+	// The layouts for every vertex format live in VertexLayouts.h, next to the vertex structs they describe
+	D3D12_INPUT_LAYOUT_DESC inputLayoutDesc = VertexLayouts::Get(VertexFormat::Float);
+
+	// Create a pipleline state object (PSO)
+
+	// In a real application, you will have many pso's. For each diferent shader
+	// or in difference combinations of shaders, differenc blend states or different rasterizer states,
+	// different topology types (point, line, triangle patch), or different numberof render targets
+	// you will need a pso
+
+	// VS is the only required shader for the pso. You might be wondering whan a case would be where
+	// you only set the VS. It's possible that you have a pso that only outpus data with the stream
+	// output, and not on a render target, which means you would not need anything after the stream output
+
+	DXGI_SAMPLE_DESC sampleDesc = {};
+	sampleDesc.Count = 1; // Has to match the swap chain
+
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {}; // A structure to define a pso
+	psoDesc.InputLayout = inputLayoutDesc; // The structure describing out input layout
+	psoDesc.pRootSignature = pRootSignature.Get(); // The root signature that describes the input data this pso needs
+	psoDesc.VS = vertexShaderBytecode; // Structure describing where to find the vertex shader bytecode and how large it is
+	psoDesc.PS = pixelShaderBytecode; // Same as VS but for the pixel shader
+	psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE; // Type of topology we are drawing
+	psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM; // Format of the render target
+	psoDesc.SampleDesc = sampleDesc;
+	psoDesc.SampleMask = 0xffffffff; // Sample mask has to do with multi-sampling. 0xffffffff means point sampling is done
+	psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT); // A default rasterizer state
+	psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT); // A default blend state
+	psoDesc.NumRenderTargets = 1; // We are only binding one render target
+	psoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT); // A default stencil state
+	//psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+
+	// Create the PSO. Only replace the current one once the new one exists, a shader with errors keeps the old one running
+	ComPtr<ID3D12PipelineState> pipelineState;
+	hr = pDevice->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState));
+	if (FAILED(hr))
+	{
+		OutputDebugStringA("Failed to create pipleline state object\n");
+		return false;
+	}
+
+	// The packed formats differ from it in the vertex shader and the input layout only. CompactLit's normal and
+	// tangent are in the layout already, VertexShaderCompact just does not read them yet
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC compactPsoDesc = psoDesc;
+	compactPsoDesc.VS = compactVertexShaderBytecode;
+	compactPsoDesc.InputLayout = VertexLayouts::Get(VertexFormat::Compact);
+	ComPtr<ID3D12PipelineState> compactPipelineState;
+	hr = pDevice->CreateGraphicsPipelineState(&compactPsoDesc, IID_PPV_ARGS(&compactPipelineState));
+	if (FAILED(hr))
+	{
+		OutputDebugStringA("Failed to create compact pipleline state object\n");
+		return false;
+	}
+
+	compactPsoDesc.InputLayout = VertexLayouts::Get(VertexFormat::CompactLit);
+	ComPtr<ID3D12PipelineState> compactLitPipelineState;
+	hr = pDevice->CreateGraphicsPipelineState(&compactPsoDesc, IID_PPV_ARGS(&compactLitPipelineState));
+	if (FAILED(hr))
+	{
+		OutputDebugStringA("Failed to create compact lit pipleline state object\n");
+		return false;
+	}
+
+	pPipelineStateObject = pipelineState;
+	pCompactPipelineState = compactPipelineState;
+	pCompactLitPipelineState = compactLitPipelineState;
+	return true;
+}
+
+namespace
+{
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT ToPlacedFootprint(const SubresourceFootprint& footprint, DXGI_FORMAT format)
+	{
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout = {};
+		layout.Offset = footprint.offset;
+		layout.Footprint.Format = format;
+		layout.Footprint.Width = footprint.width;
+		layout.Footprint.Height = footprint.height;
+		layout.Footprint.Depth = 1;
+		layout.Footprint.RowPitch = footprint.rowPitch;
+		return layout;
+	}
+}
+
+bool Graphics::CreateTexture(LPCWSTR filename)
+{
+	// The texture in the first descriptor of the main heap, the one meshes without a material texture sample
+	ComPtr<ID3D12Resource> texture;
+	if (!LoadTexture(filename, texture))
+		return false;
+	pTextureBuffer = texture;
+	CreateTextureView(texture.Get(), pMainDescriptorHeap->Get()->GetCPUDescriptorHandleForHeapStart());
+	return true;
+}
+
+bool Graphics::LoadMaterialTexture(const std::string& filepath, D3D12_GPU_DESCRIPTOR_HANDLE& descriptor)
+{
+	// Material textures take the descriptors after the streamed texture's, one each for as long as Graphics lives
+	if (materialTextures.size() >= MaxMaterialTextures)
+	{
+		OutputDebugStringA("Out of descriptors for material textures\n");
+		return false;
+	}
+	ComPtr<ID3D12Resource> texture;
+	if (!LoadTexture(StringHelper::StringToWide(filepath).c_str(), texture))
+	{
+		OutputDebugStringA("Failed to load material texture\n");
+		return false;
+	}
+
+	const UINT descriptorSize = pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	const INT index = 1 + frameBufferCount + static_cast<INT>(materialTextures.size());
+	CreateTextureView(texture.Get(), CD3DX12_CPU_DESCRIPTOR_HANDLE(pMainDescriptorHeap->Get()->GetCPUDescriptorHandleForHeapStart(), index, descriptorSize));
+	descriptor = CD3DX12_GPU_DESCRIPTOR_HANDLE(pMainDescriptorHeap->Get()->GetGPUDescriptorHandleForHeapStart(), index, descriptorSize);
+	materialTextures.push_back(texture);
+	return true;
+}
+
+bool Graphics::LoadTexture(LPCWSTR filename, ComPtr<ID3D12Resource>& texture)
+{
+	// Records the upload on pCommandList, which has to be recording. Builds everything into locals first so a file
+	// that fails to load leaves texture alone
+
+	// An up to date DDS the asset tool cooked next to the image (Engine.exe -cooktextures) is used instead of the image
+	const std::string filepath = StringHelper::WideToString(filename);
+	const bool isDds = StringHelper::GetFileExtension(filepath) == Dds::Extension;
+	const std::string cookedPath = isDds ? filepath : Dds::GetCookedPath(filepath);
+	if (isDds || (FileHelper::FileExists(cookedPath) && FileHelper::IsFileNewer(cookedPath, filepath)))
+	{
+		DdsFile cookedFile;
+		if (cookedFile.Open(cookedPath))
+			return LoadTextureFromDds(cookedFile, TextureDownscaler::GetDroppableLevels(cookedFile.GetDescription(), static_cast<uint32_t>(textureTiers.GetTier(filepath))), texture);
+		if (isDds)
+		{
+			OutputDebugStringA("Failed to load DDS file\n");
+			return false;
+		}
+	}
+
+	D3D12_RESOURCE_DESC textureDesc;
+	int imageBytesPerRow;
+	BYTE* imageData;
+	int imageSize = LoadImageDataFromFile(&imageData, textureDesc, filename, imageBytesPerRow);
+	if (imageSize <= 0)
+	{
+		OutputDebugStringA("Failed to load image from file\n");
+		return false;
+	}
+
+	ComPtr<ID3D12Resource> textureBuffer;
+	HRESULT hr = pDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT), // A default heap
+		D3D12_HEAP_FLAG_NONE, // No flags
+		&textureDesc, // The description of our texture
+		D3D12_RESOURCE_STATE_COPY_DEST, // We will copy the texture from the upload heap to here, so we start it out in a copy dest state
+		nullptr, // Used for render targets and depth/stencil buffers
+		IID_PPV_ARGS(&textureBuffer)
+	);
+
+	if (FAILED(hr))
+	{
+		free(imageData);
+		OutputDebugStringA("Failed to create commited resource for texture\n");
+		return false;
+	}
+	textureBuffer->SetName(L"Texture Buffer Resource Heap");
+
+	// One subresource per mip level, the levels follow each other in imageData with tightly packed rows, or rows of
+	// blocks for block compressed formats
+	ImageDescription imageDescription;
+	imageDescription.width = static_cast<uint32_t>(textureDesc.Width);
+	imageDescription.height = textureDesc.Height;
+	imageDescription.mipLevels = textureDesc.MipLevels;
+	imageDescription.format = static_cast<PixelFormat>(textureDesc.Format);
+	imageDescription.rowPitch = static_cast<uint32_t>(imageBytesPerRow);
+
+	// Each row must be 256 byte aligned except for the last row, which can just be the size in bytes of the row
+	// eg. textureUploadBufferSize = ((((width * numBytesPerPixel) + 255) & ~255) * (height - 1)) + (width * numBytesPerPixel);
+	std::vector<SubresourceFootprint> footprints;
+	UINT64 textureUploadBufferSize = GetUploadFootprints(imageDescription, 0, textureDesc, footprints);
+
+	// now we create an upload heap to upload our texture to the GPU
+	ComPtr<ID3D12Resource> textureUploadHeap;
+	hr = pDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), // Upload heap
+		D3D12_HEAP_FLAG_NONE, // no flags
+		&CD3DX12_RESOURCE_DESC::Buffer(textureUploadBufferSize), // Resource description for a buffer (storeing the image data in this heap just a copy to the default heap)
+		D3D12_RESOURCE_STATE_GENERIC_READ, // We will copy the contents from this heap to the default heap above
+		nullptr,
+		IID_PPV_ARGS(&textureUploadHeap)
+	);
+	if (FAILED(hr))
+	{
+		free(imageData);
+		OutputDebugStringA("Failed to commit texture to GPU memory\n");
+		return false;
+	}
+	textureUploadHeap->SetName(L"Texture Buffer Upload Resource Heap");
+
+	// The rows go straight into the mapped upload heap at its pitch, then every level is copied to the default heap.
+	// The image is not needed after this
+	BYTE* uploadData = nullptr;
+	CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU
+	hr = textureUploadHeap->Map(0, &readRange, reinterpret_cast<void**>(&uploadData));
+	if (FAILED(hr))
+	{
+		free(imageData);
+		OutputDebugStringA("Failed to map texture upload heap\n");
+		return false;
+	}
+	UploadLayout::CopyLevels(imageDescription, imageData, 0, textureDesc.MipLevels, footprints.data(), uploadData, ThreadPool::GetShared());
+	textureUploadHeap->Unmap(0, nullptr);
+	free(imageData);
+
+	for (UINT level = 0; level < textureDesc.MipLevels; level++)
+	{
+		CD3DX12_TEXTURE_COPY_LOCATION destinationLocation(textureBuffer.Get(), level);
+		CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(textureUploadHeap.Get(), ToPlacedFootprint(footprints[level], textureDesc.Format));
+		pCommandList->CopyTextureRegion(&destinationLocation, 0, 0, 0, &sourceLocation, nullptr);
+	}
+
+	FinishTextureUpload(textureBuffer, textureUploadHeap);
+	texture = textureBuffer;
+	return true;
+}
+
+bool Graphics::LoadTextureFromDds(const DdsFile& file, uint32_t firstLevel, ComPtr<ID3D12Resource>& texture)
+{
+	// The levels are copied row by row from the mapping straight into the upload heap at the pitch the copy wants, so
+	// the pixels are never copied into our own heap first the way LoadImageDataFromFile does.
+	// Levels above firstLevel are left in the file, the texture tier asked for less
+	const ImageDescription& description = file.GetDescription();
+	D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(description.format), description.GetLevelWidth(firstLevel),
+		description.GetLevelHeight(firstLevel), 1, static_cast<UINT16>(description.mipLevels - firstLevel));
+
+	ComPtr<ID3D12Resource> textureBuffer;
+	HRESULT hr = pDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&textureDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&textureBuffer)
+	);
+	if (FAILED(hr))
+	{
+		OutputDebugStringA("Failed to create commited resource for texture\n");
+		return false;
+	}
+	textureBuffer->SetName(L"Texture Buffer Resource Heap");
+
+	// Where every level goes in the upload heap. Rows start on 256 bytes (D3D12_TEXTURE_DATA_PITCH_ALIGNMENT) and
+	// levels on 512 (D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT), the file has them tightly packed
+	std::vector<SubresourceFootprint> footprints;
+	UINT64 textureUploadBufferSize = GetUploadFootprints(description, firstLevel, textureDesc, footprints);
+
+	ComPtr<ID3D12Resource> textureUploadHeap;
+	hr = pDevice->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(textureUploadBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&textureUploadHeap)
+	);
+	if (FAILED(hr))
+	{
+		OutputDebugStringA("Failed to commit texture to GPU memory\n");
+		return false;
+	}
+	textureUploadHeap->SetName(L"Texture Buffer Upload Resource Heap");
+
+	BYTE* uploadData = nullptr;
+	CD3DX12_RANGE readRange(0, 0); // We do not intend to read from this resource on the CPU
+	hr = textureUploadHeap->Map(0, &readRange, reinterpret_cast<void**>(&uploadData));
+	if (FAILED(hr))
+	{
+		OutputDebugStringA("Failed to map texture upload heap\n");
+		return false;
+	}
+
+	UploadLayout::CopyLevels(description, file.GetLevelData(0), firstLevel, textureDesc.MipLevels, footprints.data(), uploadData, ThreadPool::GetShared());
+	textureUploadHeap->Unmap(0, nullptr);
+	for (UINT level = 0; level < textureDesc.MipLevels; level++)
+	{
+		CD3DX12_TEXTURE_COPY_LOCATION destinationLocation(textureBuffer.Get(), level);
+		CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(textureUploadHeap.Get(), ToPlacedFootprint(footprints[level], textureDesc.Format));
+		pCommandList->CopyTextureRegion(&destinationLocation, 0, 0, 0, &sourceLocation, nullptr);
+	}
+
+	FinishTextureUpload(textureBuffer, textureUploadHeap);
+	texture = textureBuffer;
+	return true;
+}
+
+uint64_t Graphics::GetUploadFootprints(const ImageDescription& description, uint32_t firstLevel, const D3D12_RESOURCE_DESC& textureDesc, std::vector<SubresourceFootprint>& footprints)
+{
+	footprints.resize(textureDesc.MipLevels);
+	const bool knownFormat = ImageDescription::GetBytesPerPixel(description.format) > 0 || ImageDescription::IsBlockCompressed(description.format);
+	uint64_t totalBytes = 0;
+	if (knownFormat)
+		totalBytes = UploadLayout::ComputeFootprints(description, firstLevel, textureDesc.MipLevels, 0, footprints.data());
+#ifndef _DEBUG
+	if (knownFormat)
+		return totalBytes;
+#endif
+
+	// Formats UploadLayout has no sizes for, which only WIC produces, take the device's layout. Debug builds check the
+	// CPU layout against it for every other format, the copies are recorded with it
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(textureDesc.MipLevels);
+	std::vector<UINT> rowCounts(textureDesc.MipLevels);
+	std::vector<UINT64> rowSizes(textureDesc.MipLevels);
+	UINT64 deviceTotalBytes;
+	pDevice->GetCopyableFootprints(&textureDesc, 0, textureDesc.MipLevels, 0, layouts.data(), rowCounts.data(), rowSizes.data(), &deviceTotalBytes);
+	if (!knownFormat)
+	{
+		for (UINT level = 0; level < textureDesc.MipLevels; level++)
+		{
+			SubresourceFootprint& footprint = footprints[level];
+			footprint.offset = layouts[level].Offset;
+			footprint.width = layouts[level].Footprint.Width;
+			footprint.height = layouts[level].Footprint.Height;
+			footprint.rowPitch = layouts[level].Footprint.RowPitch;
+			footprint.rowCount = rowCounts[level];
+			footprint.rowSize = static_cast<uint32_t>(rowSizes[level]);
+		}
+		return deviceTotalBytes;
+	}
+#ifdef _DEBUG
+	bool matches = deviceTotalBytes == totalBytes;
+	for (UINT level = 0; level < textureDesc.MipLevels; level++)
+	{
+		const SubresourceFootprint& footprint = footprints[level];
+		matches = matches && layouts[level].Offset == footprint.offset && layouts[level].Footprint.RowPitch == footprint.rowPitch &&
+			layouts[level].Footprint.Width == footprint.width && layouts[level].Footprint.Height == footprint.height &&
+			rowCounts[level] == footprint.rowCount && rowSizes[level] == footprint.rowSize;
+	}
+	assert(matches && "UploadLayout footprints differ from GetCopyableFootprints");
+#endif
+	return totalBytes;
+}
+
+void Graphics::FinishTextureUpload(const ComPtr<ID3D12Resource>& textureBuffer, const ComPtr<ID3D12Resource>& textureUploadHeap)
+{
+	// Transition the texture default heap to a pixel shader resource (we will be sampling frrom this heap in the pixel shader to get the color of pixels)
+	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(textureBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	constantRing.Retire(textureUploadHeap);
+}
+
+void Graphics::CreateTextureView(ID3D12Resource* texture, D3D12_CPU_DESCRIPTOR_HANDLE destination)
+{
+	// Now we create a shader resource view (descriptor that points to the texture and descripbes it)
+	D3D12_RESOURCE_DESC textureDesc = texture->GetDesc();
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = textureDesc.Format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = textureDesc.MipLevels;
+	pDevice->CreateShaderResourceView(texture, &srvDesc, destination);
+}
+
+bool Graphics::ReloadTexture(const std::string& filepath)
+{
+	// The descriptor and the texture are overwritten in place, nothing in flight may still use them
+	FlushGpu();
+
+	HRESULT hr = pCommandAllocators[frameIndex]->Reset();
+	if (FAILED(hr))
+		return false;
+	hr = pCommandList->Reset(pCommandAllocators[frameIndex].Get(), pPipelineStateObject.Get());
+	if (FAILED(hr))
+		return false;
+
+	bool created = CreateTexture(StringHelper::StringToWide(filepath).c_str());
+	pCommandList->Close();
+	ID3D12CommandList* ppCommandLists[] = { pCommandList.Get() };
+	pCommandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+
+	// Same as at the end of InitializeDirect3D12, WaitForPreviousFrame waits for this value before the allocator is reused
+	fenceValue[frameIndex]++;
+	hr = pCommandQueue->Signal(pFence[frameIndex].Get(), fenceValue[frameIndex]);
+	if (FAILED(hr))
+		return false;
+	FlushGpu();
+	return created;
+}
+
+void Graphics::FlushGpu()
+{
+	for (int i = 0; i < frameBufferCount; i++)
+	{
+		if (pFence[i]->GetCompletedValue() < fenceValue[i])
+		{
+			if (SUCCEEDED(pFence[i]->SetEventOnCompletion(fenceValue[i], fenceEvent)))
+				WaitForSingleObject(fenceEvent, INFINITE);
+		}
+	}
+}
+
+void Graphics::WatchAssets()
+{
+	// Shader and texture reloads flush the GPU once, hot reloading is a development feature and the swap stays simple.
+	// Meshes in the ModelCache are watched by the reloader itself
+	AssetHotReloader::ReloadFunction reloadPipelineState = [this](const std::string&)
+	{
+		FlushGpu();
+		return CreatePipelineState();
+	};
+	hotReloader.Watch("VertexShader.hlsl", AssetHotReloader::AssetType::Shader, reloadPipelineState);
+	hotReloader.Watch("VertexShaderCompact.hlsl", AssetHotReloader::AssetType::Shader, reloadPipelineState);
+	hotReloader.Watch("PixelShader.hlsl", AssetHotReloader::AssetType::Shader, reloadPipelineState);
+
+	AssetHotReloader::ReloadFunction reloadRaytracingPipeline = [this](const std::string&)
+	{
+		FlushGpu();
+		try
+		{
+			CreateRaytracingPipeline();
+			CreateShaderBindingTable();
+		}
+		catch (std::exception& exception)
+		{
+			OutputDebugStringA(exception.what());
+			OutputDebugStringA("\n");
+			return false;
+		}
+		return true;
+	};
+	const char* const raytracingShaders[] = { "RayGen.hlsl", "Miss.hlsl", "Hit.hlsl", "Common.hlsl" };
+	for (const char* shader : raytracingShaders)
+		hotReloader.Watch(shader, AssetHotReloader::AssetType::Shader, reloadRaytracingPipeline);
+
+	hotReloader.Watch("Resources\\Textures\\Catalina.jpg", AssetHotReloader::AssetType::Texture, [this](const std::string& filepath)
+	{
+		return ReloadTexture(filepath);
+	});
+}
+
 void Graphics::UpdatePipeline()
 {
 	HRESULT hr;
 
 	// We have to wait for the GPU to finish withtthe command allocator before we reset it
 	WaitForPreviousFrame();
+	constantRing.BeginFrame();
 	hr = pCommandAllocators[frameIndex]->Reset();
 	if (FAILED(hr))
 	{
@@ -850,6 +1280,11 @@ void Graphics::UpdatePipeline()
 
 	// Here we start recording commands into the commandList (which all the commands will be stored in the commandAllocator)
 
+	// Model buffers copy in from their upload heaps first, so they are ready by the time anything draws them. Only a
+	// few background loads finish every frame rather than stalling on all of them
+	modelStreamer.Update(pDevice.Get(), pCommandList.Get(), constantRing);
+	hotReloader.UploadMeshes(pDevice.Get(), pCommandList.Get(), constantRing);
+
 	// Transition the "frameindex" render target from the present state to the render target state so the command list draws to it starting from here
 	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(pRenderTargets[frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
@@ -870,7 +1305,22 @@ void Graphics::UpdatePipeline()
 	ID3D12DescriptorHeap* descriptorHeaps[] = { pMainDescriptorHeap->Get() };
 	pCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	pCommandList->SetGraphicsRootDescriptorTable(1, pMainDescriptorHeap->Get()->GetGPUDescriptorHandleForHeapStart());
+	// Streamed levels are copied in before anything samples the texture this frame
+	if (textureStreamer != nullptr && textureStreamer->Update(pDevice.Get(), pCommandList.Get()) > 0)
+	{
+		TextureResidency& residency = textureStreamer->GetResidency();
+		TextureResidency::Statistics statistics = residency.GetStatistics();
+		char message[256];
+		snprintf(message, sizeof(message), "Texture streaming: level %u of %u resident, %.2f MB of %.2f MB, %u loads, %u levels evicted\n",
+			residency.GetResidentLevel(streamedTexture), residency.GetDescription(streamedTexture).mipLevels,
+			statistics.residentBytes / (1024.0 * 1024.0), statistics.budgetBytes / (1024.0 * 1024.0), statistics.loadsCompleted, statistics.levelsEvicted);
+		OutputDebugStringA(message);
+	}
+
+	CD3DX12_GPU_DESCRIPTOR_HANDLE textureDescriptor(pMainDescriptorHeap->Get()->GetGPUDescriptorHandleForHeapStart());
+	if (textureStreamer != nullptr)
+		textureDescriptor.Offset(1 + textureStreamer->GetDescriptorIndex(streamedTexture), pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV));
+	pCommandList->SetGraphicsRootDescriptorTable(1, textureDescriptor);
 
 	if (m_raster)
 	{
@@ -888,21 +1338,25 @@ void Graphics::UpdatePipeline()
 
 		// First cube
 		// Set cube1's constant buffer
-		pCommandList->SetGraphicsRootConstantBufferView(0, pConstantBufferUploadHeaps[frameIndex].Get()->GetGPUVirtualAddress());
+		pCommandList->SetGraphicsRootConstantBufferView(0, UploadObjectConstants(cube1WorldMat));
 
 		// Draw first cube
 		pCommandList->DrawIndexedInstanced(numCubeIndices, 1, 0, 0, 0);
 
 		// Second cube
-		// Set cube 2's constant buffer. you can wee we are adding the size of ConstantBufferPerObject to the constant buffer
-		// resource heapsaddress. This is because cube1's constatnt buffer is stored at the beginning of the resource heap,
-		// while cube2's constant buffer data is storeed after (256 bits from the start of the heap).
-		pCommandList->SetGraphicsRootConstantBufferView(0, pConstantBufferUploadHeaps[frameIndex].Get()->GetGPUVirtualAddress() + ConstantBufferPerObjectAlignedSize);
-
-		//cube.Draw(camera.GetViewMatrix() * camera.GetProjectionMatrix(), 0, pConstantBufferUploadHeaps[frameIndex].Get()->GetGPUVirtualAddress());
+		// Every draw gets its own chunk of the ring, so cube1's constants are not overwritten while the GPU still reads them
+		pCommandList->SetGraphicsRootConstantBufferView(0, UploadObjectConstants(cube2WorldMat));
 
 		// Draw second cube
 		pCommandList->DrawIndexedInstanced(numCubeIndices, 1, 0, 0, 0);
+
+		// The Dandelion model binds its own buffers, pipeline states and textures, every mesh picks its LOD from its size
+		// on screen. Anything drawn after it has to set its pipeline state and texture again
+		MeshPipelineStates pipelineStates;
+		pipelineStates.states[static_cast<size_t>(VertexFormat::Float)] = pPipelineStateObject.Get();
+		pipelineStates.states[static_cast<size_t>(VertexFormat::Compact)] = pCompactPipelineState.Get();
+		pipelineStates.states[static_cast<size_t>(VertexFormat::CompactLit)] = pCompactLitPipelineState.Get();
+		cube.Draw(camera.GetViewMatrix() * camera.GetProjectionMatrix(), 0, 1, textureDescriptor, pipelineStates, constantRing);
 	}
 	else
 	{
@@ -1279,6 +1733,118 @@ void Graphics::CreateShaderBindingTable()
 
 int Graphics::LoadImageDataFromFile(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int& bytesPerRow)
 {
+	// Decoded pixels and their mip chain are kept in the DerivedDataCache keyed on the file contents, decoding and
+	// filtering only run for new or edited images. imageData holds every level, see ImageDescription::GetLevelOffset.
+	// A texture tier below full is applied right after decoding, so the mips, the compression, the cache entry and
+	// the upload all only see the smaller image
+	struct CachedImageHeader
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t format; // DXGI_FORMAT
+		uint32_t bytesPerRow; // Of the top level
+		uint32_t mipLevels;
+	};
+
+	const std::string filepath = StringHelper::WideToString(filename);
+	const TextureTier tier = textureTiers.GetTier(filepath);
+	std::string cacheKey;
+	uint64_t sourceHash;
+	if (ContentHash::HashFile(filepath, sourceHash))
+	{
+		std::string settingsName = GetTextureCookSettings().GetName();
+		if (tier != TextureTier::Full)
+			settingsName += std::string("-") + TextureTierSettings::GetTierName(tier);
+		cacheKey = DerivedDataCache::MakeKey("texture", DecodedImageVersion, sourceHash, settingsName);
+		std::vector<uint8_t> data;
+		CachedImageHeader header;
+		if (DerivedDataCache::GetShared().Get(cacheKey, data) && data.size() >= sizeof(header))
+		{
+			memcpy(&header, data.data(), sizeof(header));
+			ImageDescription description;
+			description.width = header.width;
+			description.height = header.height;
+			description.format = static_cast<PixelFormat>(header.format);
+			description.rowPitch = header.bytesPerRow;
+			description.mipLevels = static_cast<uint16_t>(header.mipLevels);
+			size_t imageSize = data.size() - sizeof(header);
+			const bool knownFormat = ImageDescription::GetBytesPerPixel(description.format) > 0 || ImageDescription::IsBlockCompressed(description.format);
+			if (header.width > 0 && header.height > 0 && header.mipLevels > 0 && header.mipLevels <= MipGenerator::GetLevelCount(header.width, header.height) &&
+				(header.mipLevels == 1 || knownFormat) && description.GetSize() == imageSize)
+			{
+				*imageData = (BYTE*)malloc(imageSize);
+				memcpy(*imageData, data.data() + sizeof(header), imageSize);
+				bytesPerRow = header.bytesPerRow;
+				resourceDescription = CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(header.format), header.width, header.height, 1, static_cast<UINT16>(header.mipLevels));
+				return static_cast<int>(imageSize);
+			}
+		}
+	}
+
+	int imageSize = DecodeImageFromFile(imageData, resourceDescription, filename, bytesPerRow);
+	if (imageSize <= 0)
+		return imageSize;
+
+	// Formats MipGenerator and BlockCompressor do not know, which only WIC produces, stay as they are with one level
+	ImageData image;
+	image.description.width = static_cast<uint32_t>(resourceDescription.Width);
+	image.description.height = resourceDescription.Height;
+	image.description.format = static_cast<PixelFormat>(resourceDescription.Format);
+	image.description.rowPitch = static_cast<uint32_t>(bytesPerRow);
+	if (ImageDescription::GetBytesPerPixel(image.description.format) > 0)
+	{
+		image.pixels.assign(*imageData, *imageData + imageSize);
+		const bool downscaled = TextureDownscaler::Apply(image, tier, filepath, ThreadPool::GetShared()) > 0;
+		if (TextureCooker::Process(image, filepath, GetTextureCookSettings()) || downscaled)
+		{
+			free(*imageData);
+			imageSize = static_cast<int>(image.pixels.size());
+			*imageData = (BYTE*)malloc(imageSize);
+			memcpy(*imageData, image.pixels.data(), imageSize);
+			resourceDescription.Width = image.description.width;
+			resourceDescription.Height = image.description.height;
+			resourceDescription.MipLevels = image.description.mipLevels;
+			resourceDescription.Format = static_cast<DXGI_FORMAT>(image.description.format);
+			bytesPerRow = static_cast<int>(image.description.rowPitch);
+		}
+	}
+
+	if (!cacheKey.empty())
+	{
+		CachedImageHeader header;
+		header.width = static_cast<uint32_t>(resourceDescription.Width);
+		header.height = resourceDescription.Height;
+		header.format = static_cast<uint32_t>(resourceDescription.Format);
+		header.bytesPerRow = static_cast<uint32_t>(bytesPerRow);
+		header.mipLevels = resourceDescription.MipLevels;
+		std::vector<uint8_t> data(sizeof(header) + imageSize);
+		memcpy(data.data(), &header, sizeof(header));
+		memcpy(data.data() + sizeof(header), *imageData, imageSize);
+		DerivedDataCache::GetShared().Put(cacheKey, data);
+	}
+	return imageSize;
+}
+
+int Graphics::DecodeImageFromFile(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int& bytesPerRow)
+{
+	// JPEG and PNG go through ImageDecoder, which needs no COM and is safe on any thread. WIC is kept for the rest.
+	// The decoder writes into imageData itself with packed rows, LoadImageDataFromFile copies them on from there
+	MappedFile file;
+	ImageDescription description;
+	if (file.Open(StringHelper::WideToString(filename)) && ImageDecoder::ReadDescription(file.Data(), file.Size(), description))
+	{
+		size_t imageSize = static_cast<size_t>(description.GetSize());
+		*imageData = (BYTE*)malloc(imageSize);
+		if (ImageDecoder::DecodeInto(file.Data(), file.Size(), *imageData, description.rowPitch, ThreadPool::GetShared()))
+		{
+			bytesPerRow = static_cast<int>(description.rowPitch);
+			resourceDescription = CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(description.format), description.width, description.height, description.depthOrArraySize, description.mipLevels);
+			return static_cast<int>(imageSize);
+		}
+		free(*imageData);
+		*imageData = nullptr;
+	}
+
 	HRESULT hr;
 
 	// We only ned one instance of the imageing factory to create decoders and frames
@@ -1594,6 +2160,12 @@ void Graphics::Cleanup()
 		WaitForPreviousFrame();
 	}
 
+	// Its retired resources are only safe to release now
+	textureStreamer.reset();
+	TextureCache::GetShared().Clear();
+	TextureCache::GetShared().SetLoadFunction(TextureCache::LoadFunction());
+	materialTextures.clear();
+
 	// Get swapchain out of full screen before exiting
 	BOOL fs = false;
 	if (pSwapChain->GetFullscreenState(&fs, NULL))
@@ -1618,6 +2190,10 @@ void Graphics::Cleanup()
 void Graphics::Update()
 {
 	using namespace DirectX;
+	// Picks up whatever changed on disk, between frames. Changed meshes are swapped in by UpdatePipeline
+	hotReloader.Update();
+	UpdateStreamingStressTest();
+	UpdateTextureStreaming();
 	UpdateCameraBuffer();
 	// Create rotation matricies
 	XMMATRIX rotXMat = XMMatrixRotationX(0.0001f);
@@ -1634,20 +2210,9 @@ void Graphics::Update()
 	// Create cube1's world matrix by first rotationg the cube, then positioning the rotated cube
 	XMMATRIX worldMat = rotMat * translationMat;
 
-	// Store cube1's world matrix
+	// Store cube1's world matrix, its constants are written when the cube is drawn
 	XMStoreFloat4x4(&cube1WorldMat, worldMat);
 
-	// Update Constant buffer for cube1
-	// create wvpMatrix and store it in constant buffer
-	XMMATRIX viewMat = camera.GetViewMatrix();//XMLoadFloat4x4(&cameraViewMat); // Load view matrix
-	XMMATRIX projMat = camera.GetProjectionMatrix();//XMLoadFloat4x4(&cameraProjectionMat); // load projection matrix
-	XMMATRIX wvpMat = XMLoadFloat4x4(&cube1WorldMat) * viewMat * projMat; // Create wvp Matrix
-	XMMATRIX transposed = XMMatrixTranspose(wvpMat); // Must transpose wvp Matrix for the GPU
-	XMStoreFloat4x4(&cbPerObject.wvpMat, transposed); // Store transposed wvp Matrix in constant buffer
-
-	// Copy our ConstantBuffe instance to the mapped constant buffer resource
-	memcpy(pCbvGPUAddress[frameIndex], &cbPerObject, sizeof(cbPerObject));
-
 	// Now do cube2's world matrix
 	// Create rotation matricies for cube2
 	rotXMat = XMMatrixRotationX(0.0003f);
@@ -1671,14 +2236,23 @@ void Graphics::Update()
 	// Finally we move it to cube1's position, which will cuase it to rotate around cube1
 	worldMat = scaleMat * translationOffsetMat * rotMat * translationMat;
 
-	wvpMat = XMLoadFloat4x4(&cube2WorldMat) * camera.GetViewMatrix() * camera.GetProjectionMatrix(); // Create wvp Matrix
-	transposed = XMMatrixTranspose(wvpMat); // We must store wvp Matrix for GPU
-	XMStoreFloat4x4(&cbPerObject.wvpMat, transposed); // Store transposed wvp Matrix in constant buffer
-
-	// Cpoy our constant buffer instnce to the mapped constant buffer resource
-	memcpy(pCbvGPUAddress[frameIndex] + ConstantBufferPerObjectAlignedSize, &cbPerObject, sizeof(cbPerObject));
-
 	// Store cube2's world Matrix
 	XMStoreFloat4x4(&cube2WorldMat, worldMat);
 
 }
+
+D3D12_GPU_VIRTUAL_ADDRESS Graphics::UploadObjectConstants(const DirectX::XMFLOAT4X4& worldMat)
+{
+	using namespace DirectX;
+	// Create wvp Matrix, transposed for the GPU
+	XMMATRIX wvpMat = XMLoadFloat4x4(&worldMat) * camera.GetViewMatrix() * camera.GetProjectionMatrix();
+	ConstantBufferPerObject constants;
+	XMStoreFloat4x4(&constants.wvpMat, XMMatrixTranspose(wvpMat));
+	const D3D12_GPU_VIRTUAL_ADDRESS address = constantRing.AllocateConstants(constants);
+	if (address == 0)
+	{
+		ErrorLogger::Log("Out of memory for per object constants");
+		Running = false;
+	}
+	return address;
+}
@@ -9,6 +9,15 @@
 
 #include "Objects/Camera3D.h"
 #include "RenderableGameObject.h"
+#include "ModelStreamer.h"
+#include "AssetHotReloader.h"
+#include "TextureStreamer.h"
+#include "UploadHeapRing.h"
+#include "../Assets/DdsFile.h"
+#include "../Assets/TextureCooker.h"
+#include "../Assets/TextureDownscaler.h"
+#include "../Assets/UploadLayout.h"
+#include "../Timer.h"
 
 #include <dxcapi.h>
 #include <vector>
@@ -31,10 +40,23 @@ public:
 	void SetRasterEnabled(bool enabled) { m_raster = enabled; }
 	bool GetIsRasterEnabled() { return m_raster; }
 
+	// Streams modelCount models from the Dandelion set in the background and reports time to first frame and time
+	// until everything is resident to the debug output. Call before Initialize
+	void SetStreamingStressTest(unsigned int modelCount) { streamingStressTestCount = modelCount; }
+	// Streams the cube texture from its cooked DDS (Engine.exe -cooktextures) within budgetBytes of video memory, only
+	// the levels its distance to the camera needs are resident. Statistics go to the debug output. Call before Initialize
+	void SetTextureStreamingBudget(uint64_t budgetBytes) { textureStreamingBudget = budgetBytes; }
+	// Loads textures at half or quarter resolution, for all of them or by category (see TextureTierSettings). Call
+	// before Initialize
+	void SetTextureTiers(const TextureTierSettings& tiers) { textureTiers = tiers; }
+
 	Camera3D camera;
 
 private:
 	bool InitializeDirect3D12(HWND hwnd);
+	// Compiles VertexShader.hlsl, VertexShaderCompact.hlsl and PixelShader.hlsl into pPipelineStateObject and the PSOs
+	// for the packed vertex formats. All of them are left alone if anything fails
+	bool CreatePipelineState();
 	void UpdatePipeline();
 	bool InitializeShaders();
 	bool InitializeScene();
@@ -107,6 +129,8 @@ private:
 	ComPtr<ID3D12Fence> pFence[frameBufferCount]; // An object that is locked while our command list is being executed by the GPU. We need as many
 																  // as we have allocators (more if we want to know when the gpu is finished with an asset)
 	ComPtr<ID3D12PipelineState> pPipelineStateObject; // PSO containg a pipeline state
+	ComPtr<ID3D12PipelineState> pCompactPipelineState; // VertexFormat::Compact meshes
+	ComPtr<ID3D12PipelineState> pCompactLitPipelineState; // VertexFormat::CompactLit meshes
 	ComPtr<ID3D12RootSignature> pRootSignature; // Root signature defines data shaders will access
 	
 	ComPtr<ID3D12Resource> pDepthStencilBuffer; // This is the memory for out depth buffer. It will also be used tor stencil buffer
@@ -114,14 +138,32 @@ private:
 	
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> pMainDescriptorHeap[frameBufferCount]; // This heap will store the descriptor to our contant buffer
 	
-	int ConstantBufferPerObjectAlignedSize = (sizeof(ConstantBufferPerObject) + 255) & ~255;
-	ConstantBufferPerObject cbPerObject; // This is the constant buffer data we will send to the GPU
-											// (Which will be placed in the resource we created above)
-	ComPtr<ID3D12Resource> pConstantBufferUploadHeaps[frameBufferCount]; // This is the memory on the gpu where our contant buffer will be placed
-	UINT8* pCbvGPUAddress[frameBufferCount]; // This is a pointer to each of the constant buffer resource heaps
+	// Per object constants are allocated from this every frame, one 256 byte aligned chunk per draw. The upload
+	// buffers of meshes and textures are retired to it and released once the frame that copied from them is done
+	UploadHeapRing constantRing;
+	// Writes the transposed world view projection matrix of worldMat for this frame, returns where the GPU reads it
+	D3D12_GPU_VIRTUAL_ADDRESS UploadObjectConstants(const DirectX::XMFLOAT4X4& worldMat);
 
 	RenderableGameObject cube;
 
+	ModelStreamer modelStreamer;
+	std::vector<ModelStreamer::Handle> streamedModels;
+	void StartStreamingStressTest();
+	void UpdateStreamingStressTest();
+	unsigned int streamingStressTestCount = 0;
+	Timer startupTimer;
+	double timeToFirstFrame = 0.0; // Milliseconds from the start of Initialize, 0 until the first frame was presented
+
+	std::unique_ptr<TextureStreamer> textureStreamer; // Null unless a budget was set and the cooked texture is there
+	TextureStreamer::TextureId streamedTexture = 0;
+	uint64_t textureStreamingBudget = 0;
+	void UpdateTextureStreaming();
+
+	AssetHotReloader hotReloader;
+	void WatchAssets();
+	// Waits until the GPU has finished every frame submitted so far
+	void FlushGpu();
+
 	// -- Move these to game object class -- //
 	DirectX::XMFLOAT4X4 cube1WorldMat; // our first cub's world Matrix (Transformation Matrix)
 	DirectX::XMFLOAT4X4 cube1RotMat; // This will keep track of our rotation for the first cube
@@ -133,14 +175,36 @@ private:
 
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> pTextureBuffer; // The resource heap containing our texture
+	static const UINT MaxMaterialTextures = 256;
+	std::vector<ComPtr<ID3D12Resource>> materialTextures; // In the order of their descriptors
+	// Loads the texture every mesh without a material texture samples
+	bool CreateTexture(LPCWSTR filename);
+	// Loads a material texture for the TextureCache and gives it a descriptor of its own
+	bool LoadMaterialTexture(const std::string& filepath, D3D12_GPU_DESCRIPTOR_HANDLE& descriptor);
+	// Record the upload of a texture on pCommandList, texture is only set when it loaded
+	bool LoadTexture(LPCWSTR filename, ComPtr<ID3D12Resource>& texture);
+	bool LoadTextureFromDds(const DdsFile& file, uint32_t firstLevel, ComPtr<ID3D12Resource>& texture);
+	// Where the levels of the texture go in its upload heap, from UploadLayout. Formats UploadLayout does not know
+	// take GetCopyableFootprints, debug builds assert the two agree for the rest
+	uint64_t GetUploadFootprints(const ImageDescription& description, uint32_t firstLevel, const D3D12_RESOURCE_DESC& textureDesc, std::vector<SubresourceFootprint>& footprints);
+	void FinishTextureUpload(const ComPtr<ID3D12Resource>& textureBuffer, const ComPtr<ID3D12Resource>& textureUploadHeap);
+	void CreateTextureView(ID3D12Resource* texture, D3D12_CPU_DESCRIPTOR_HANDLE destination);
+	bool ReloadTexture(const std::string& filepath);
 	int LoadImageDataFromFile(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int &bytesPerRow);
+	int DecodeImageFromFile(BYTE** imageData, D3D12_RESOURCE_DESC& resourceDescription, LPCWSTR filename, int &bytesPerRow);
+	// Bump when DecodeImageFromFile, the mip generation or the block compression starts producing different pixels for the same file
+	static const uint32_t DecodedImageVersion = 4;
+	// Block compression of loaded textures, see TextureCooker. Part of the DerivedDataCache key. A cooked DDS next to the image is used as it is
+	bool compressTextures = true;
+	BlockQuality textureQuality = BlockQuality::Normal;
+	TextureCookSettings GetTextureCookSettings() const { TextureCookSettings settings; settings.compress = compressTextures; settings.quality = textureQuality; return settings; }
+	TextureTierSettings textureTiers;
 
 	DXGI_FORMAT GetDXGIFormatFromWICFormat(WICPixelFormatGUID& wicFormatGUID);
 	WICPixelFormatGUID GetConvertToWICFormat(WICPixelFormatGUID& wicFormatGUID);
 	int GetDXGIFormatBitsPerPixel(DXGI_FORMAT& dxgiFormat);
 
 	//ID3D12DescriptorHeap* pMainDescriptorHeap;
-	ID3D12Resource* pTextureBufferUploadHeap;
 
 	ConstantBuffer<ConstantBufferPerObject> cb_vertexShader;
 
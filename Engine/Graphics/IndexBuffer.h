@@ -3,6 +3,9 @@
 #include <../d3dx12.h>
 #include <wrl/client.h>
 #include <vector>
+#include <cstdint>
+#include "UploadHeapRing.h"
+#include "../Assets/IndexCompaction.h"
 
 class IndexBuffer
 {
@@ -12,6 +15,7 @@ private:
 private:
 	Microsoft::WRL::ComPtr<ID3D12Resource> pIndexBuffer;
 	UINT indexCount = 0;
+	DXGI_FORMAT format = DXGI_FORMAT_R32_UINT;
 public:
 	IndexBuffer() {}
 
@@ -30,22 +34,73 @@ public:
 		return this->indexCount;
 	}
 
-	HRESULT Initialize(ID3D12Device* device, DWORD* data, UINT indexCount)
+	DXGI_FORMAT Format() const
+	{
+		return this->format;
+	}
+
+	UINT SizeInBytes() const
+	{
+		return this->indexCount * (this->format == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t));
+	}
+
+	D3D12_INDEX_BUFFER_VIEW GetView() const
+	{
+		D3D12_INDEX_BUFFER_VIEW view = {};
+		view.BufferLocation = pIndexBuffer->GetGPUVirtualAddress();
+		view.Format = this->format;
+		view.SizeInBytes = SizeInBytes();
+		return view;
+	}
+
+	// vertexCount is the number of vertices the indices address, meshes with up to 65536 get a 16 bit buffer. The
+	// indices are narrowed into an upload buffer and the copy is recorded on commandList, which has to be recording.
+	// uploadRing releases the upload buffer once the GPU has run the copy
+	HRESULT Initialize(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UploadHeapRing& uploadRing, const uint32_t* data, UINT indexCount, UINT vertexCount)
 	{
 		if (pIndexBuffer.Get() != nullptr)
 			pIndexBuffer.Reset();
 
-		this->indexCount = indexCount / sizeof(UINT);
+		this->indexCount = indexCount;
+		this->format = IndexCompaction::Fits16BitIndices(vertexCount) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 		//Load Index Data
 		HRESULT hr = device->CreateCommittedResource(
 			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(indexCount),
+			&CD3DX12_RESOURCE_DESC::Buffer(SizeInBytes()),
 			D3D12_RESOURCE_STATE_COPY_DEST,
 			nullptr,
 			IID_PPV_ARGS(&pIndexBuffer)
 		);
-		pIndexBuffer->SetName(L"Vertex Buffer Resource Heap");
+		if (FAILED(hr))
+			return hr;
+		pIndexBuffer->SetName(L"Index Buffer Resource Heap");
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> uploadBuffer;
+		hr = device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(SizeInBytes()),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&uploadBuffer)
+		);
+		if (FAILED(hr))
+			return hr;
+		uploadBuffer->SetName(L"Index Buffer Upload Resource Heap");
+
+		// The buffer's format decides the width, so the narrowing happens here and nowhere else
+		CD3DX12_RANGE readRange(0, 0);
+		void* upload = nullptr;
+		hr = uploadBuffer->Map(0, &readRange, &upload);
+		if (FAILED(hr))
+			return hr;
+		IndexCompaction::WriteIndexBuffer(data, indexCount, vertexCount, upload);
+		uploadBuffer->Unmap(0, nullptr);
+
+		commandList->CopyBufferRegion(pIndexBuffer.Get(), 0, uploadBuffer.Get(), 0, SizeInBytes());
+		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(pIndexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER));
+		uploadRing.Retire(uploadBuffer);
 		return hr;
 	}
 };
@@ -1,13 +1,49 @@
 #include "Mesh.h"
+#include "../Assets/VertexCompression.h"
+#include <algorithm>
 
-Mesh::Mesh(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, std::vector<Vertex3D>& verticies, std::vector<DWORD>& indicies, std::vector<Texture>& textures, const DirectX::XMMATRIX& transformMatrix)
+Mesh::Mesh(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UploadHeapRing& uploadRing, const Vertex3D* verticies, const DirectX::XMFLOAT3* normals, const DirectX::XMFLOAT4* tangents, UINT vertexCount,
+	const uint32_t* indicies, UINT indexCount, std::vector<Texture>& textures, const DirectX::XMMATRIX& transformMatrix, const std::vector<MeshLodRange>& lods)
 {
 	m_commandlist = commandList;
 	m_textures = textures;
 	m_transformMatrix = transformMatrix;
+	m_lods = lods;
+	if (m_lods.empty())
+		m_lods.push_back({ 0, indexCount });
 
-	HRESULT hr = this->m_vertexBuffer.Initialize(device, verticies.data(), (UINT)verticies.size());
+	if (vertexCount > 0)
+	{
+		DirectX::XMVECTOR minimum = DirectX::XMLoadFloat3(&verticies[0].pos);
+		DirectX::XMVECTOR maximum = minimum;
+		for (UINT i = 1; i < vertexCount; i++)
+		{
+			DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&verticies[i].pos);
+			minimum = DirectX::XMVectorMin(minimum, position);
+			maximum = DirectX::XMVectorMax(maximum, position);
+		}
+		DirectX::XMStoreFloat3(&m_boundsCenter, DirectX::XMVectorScale(DirectX::XMVectorAdd(minimum, maximum), 0.5f));
+		m_boundsDiagonal = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(maximum, minimum)));
+	}
+
+	// Float vertices go up as they are, the packed formats through one encode into a temporary
+	HRESULT hr;
+	m_vertexFormat = VertexCompression::ChooseFormat(verticies, vertexCount, normals != nullptr, MaxPositionError);
+	if (m_vertexFormat == VertexFormat::Float)
+	{
+		hr = this->m_vertexBuffer.Initialize(device, commandList, uploadRing, reinterpret_cast<const uint8_t*>(verticies), vertexCount, sizeof(Vertex3D));
+	}
+	else
+	{
+		CompressedVertices compressed;
+		VertexCompression::Compress(verticies, vertexCount, m_vertexFormat, normals != nullptr ? &normals[0].x : nullptr, tangents != nullptr ? &tangents[0].x : nullptr, compressed);
+		m_vertexTransform = compressed.quantization.GetDequantizeMatrix();
+		hr = this->m_vertexBuffer.Initialize(device, commandList, uploadRing, compressed.data.data(), vertexCount, compressed.stride);
+	}
 	COM_ERROR_IF_FAILED(hr, "Failed to initialize vertex buffer for mesh");
+
+	hr = this->m_indexBuffer.Initialize(device, commandList, uploadRing, indicies, indexCount, vertexCount);
+	COM_ERROR_IF_FAILED(hr, "Failed to initialize index buffer for mesh");
 }
 
 Mesh::Mesh(const Mesh& mesh)
@@ -17,14 +53,84 @@ Mesh::Mesh(const Mesh& mesh)
 	this->m_vertexBuffer = mesh.m_vertexBuffer;
 	this->m_textures = mesh.m_textures;
 	this->m_transformMatrix = mesh.m_transformMatrix;
+	this->m_vertexTransform = mesh.m_vertexTransform;
+	this->m_vertexFormat = mesh.m_vertexFormat;
+	this->m_lods = mesh.m_lods;
+	this->m_boundsCenter = mesh.m_boundsCenter;
+	this->m_boundsDiagonal = mesh.m_boundsDiagonal;
+}
+
+void Mesh::Draw(size_t lod) const
+{
+	D3D12_VERTEX_BUFFER_VIEW vertexBufferView = m_vertexBuffer.GetView();
+	m_commandlist->IASetVertexBuffers(0, 1, &vertexBufferView);
+	D3D12_INDEX_BUFFER_VIEW indexBufferView = m_indexBuffer.GetView();
+	m_commandlist->IASetIndexBuffer(&indexBufferView);
+	const MeshLodRange& range = m_lods[lod < m_lods.size() ? lod : m_lods.size() - 1];
+	m_commandlist->DrawIndexedInstanced(range.indexCount, 1, range.indexOffset, 0, 0);
+}
+
+size_t Mesh::SelectLod(const DirectX::XMMATRIX& worldMatrix, const DirectX::XMMATRIX& viewProjectionMatrix, float maxScreenError) const
+{
+	using namespace DirectX;
+	if (m_lods.size() < 2)
+		return 0;
+
+	// The largest axis scale makes the error and the bounds as big as they can get
+	const XMMATRIX world = m_transformMatrix * worldMatrix;
+	const float scale = std::max(XMVectorGetX(XMVector3Length(world.r[0])), std::max(XMVectorGetX(XMVector3Length(world.r[1])), XMVectorGetX(XMVector3Length(world.r[2]))));
+	const float diagonal = m_boundsDiagonal * scale;
+
+	// Clip w is the view depth, measured to the near side of the bounds
+	const XMVECTOR clip = XMVector3Transform(XMLoadFloat3(&m_boundsCenter), world * viewProjectionMatrix);
+	const float depth = XMVectorGetW(clip) - 0.5f * diagonal;
+	if (depth <= 0.0f)
+		return 0;
+
+	// The projection's y scale is the length of the second column of the view projection, clip space is 2 units high
+	const XMMATRIX transposed = XMMatrixTranspose(viewProjectionMatrix);
+	const float projectionScale = XMVectorGetX(XMVector3Length(transposed.r[1]));
+	const float screenPerUnit = 0.5f * projectionScale / depth;
+
+	for (size_t lod = m_lods.size() - 1; lod > 0; lod--)
+	{
+		if (m_lods[lod].error * diagonal * screenPerUnit <= maxScreenError)
+			return lod;
+	}
+	return 0;
+}
+
+VertexFormat Mesh::GetVertexFormat() const
+{
+	return m_vertexFormat;
+}
+
+const DirectX::XMMATRIX& Mesh::GetVertexTransform() const
+{
+	return m_vertexTransform;
+}
+
+const Texture* Mesh::FindTexture(aiTextureType type) const
+{
+	for (const Texture& texture : m_textures)
+	{
+		if (texture.GetType() == type)
+			return &texture;
+	}
+	return nullptr;
+}
+
+size_t Mesh::GetLodCount() const
+{
+	return m_lods.size();
 }
 
-void Mesh::Draw()
+uint64_t Mesh::GetSizeInBytes() const
 {
-	m_commandlist->DrawIndexedInstanced(m_indexBuffer.IndexCount(), 1, 0, 0, 0);
+	return static_cast<uint64_t>(m_vertexBuffer.VertexCount()) * m_vertexBuffer.Stride() + m_indexBuffer.SizeInBytes();
 }
 
-const DirectX::XMMATRIX& Mesh::GetTransformMatrix()
+const DirectX::XMMATRIX& Mesh::GetTransformMatrix() const
 {
 	return this->m_transformMatrix;
 }
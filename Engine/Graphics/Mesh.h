@@ -10,18 +10,60 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+// The pipeline state for each VertexFormat, all with the same root signature. Graphics::CreatePipelineState makes them
+struct MeshPipelineStates
+{
+	ID3D12PipelineState* states[3] = {}; // Indexed by VertexFormat
+
+	ID3D12PipelineState* Get(VertexFormat format) const { return states[static_cast<size_t>(format)]; }
+};
+
+// Part of a mesh's index buffer drawn for one level of detail
+struct MeshLodRange
+{
+	UINT indexOffset;
+	UINT indexCount;
+	float error = 0.0f; // MeshLod::error, relative to the mesh's bounding box diagonal
+};
+
 class Mesh
 {
 public:
-	Mesh(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, std::vector<Vertex3D>& verticies, std::vector<DWORD>& indicies, std::vector<Texture>& textures, const DirectX::XMMATRIX& transformMatrix);
+	// Largest position error packing the vertices may cause, in model units. Meshes that need more precision stay Float
+	static constexpr float MaxPositionError = 0.001f;
+
+	// lods lists the ranges of the index buffer for LOD0 onwards, leave it empty when the whole buffer is the only LOD.
+	// normals and tangents have vertexCount entries or are null. The vertices are packed into the smallest VertexFormat
+	// that keeps them within MaxPositionError, CompactLit when there are normals. The uploads are recorded on
+	// commandList and their upload buffers retired to uploadRing
+	Mesh(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UploadHeapRing& uploadRing, const Vertex3D* verticies, const DirectX::XMFLOAT3* normals, const DirectX::XMFLOAT4* tangents, UINT vertexCount,
+		const uint32_t* indicies, UINT indexCount, std::vector<Texture>& textures, const DirectX::XMMATRIX& transformMatrix, const std::vector<MeshLodRange>& lods = std::vector<MeshLodRange>());
 	Mesh(const Mesh& mesh);
-	void Draw();
-	const DirectX::XMMATRIX& GetTransformMatrix();
+	// lod is clamped to the last LOD the mesh has. The pipeline state for GetVertexFormat has to be set, and the
+	// constants have to include GetVertexTransform. Const so meshes can be shared between models, see ModelCache
+	void Draw(size_t lod = 0) const;
+	VertexFormat GetVertexFormat() const;
+	// Takes the vertex buffer's positions to mesh space, the dequantize matrix for the packed formats
+	const DirectX::XMMATRIX& GetVertexTransform() const;
+	// Coarsest LOD whose error covers at most maxScreenError of the screen height, from the mesh's bounding box as
+	// seen through worldMatrix and viewProjectionMatrix. LOD0 when the camera is inside the box
+	size_t SelectLod(const DirectX::XMMATRIX& worldMatrix, const DirectX::XMMATRIX& viewProjectionMatrix, float maxScreenError) const;
+	const DirectX::XMMATRIX& GetTransformMatrix() const;
+	// First texture of type, null when the mesh has none
+	const Texture* FindTexture(aiTextureType type) const;
+
+	size_t GetLodCount() const;
+	uint64_t GetSizeInBytes() const;
 
 private:
-	VertexBuffer<Vertex3D> m_vertexBuffer; // A mesh can have a bunch of verticies
+	VertexBuffer<uint8_t> m_vertexBuffer; // A mesh can have a bunch of verticies, in m_vertexFormat
 	IndexBuffer m_indexBuffer; // Mesh can have a bunch of Indicies
 	ID3D12GraphicsCommandList* m_commandlist;
 	std::vector<Texture> m_textures;
 	DirectX::XMMATRIX m_transformMatrix;
+	DirectX::XMMATRIX m_vertexTransform = DirectX::XMMatrixIdentity();
+	VertexFormat m_vertexFormat = VertexFormat::Float;
+	std::vector<MeshLodRange> m_lods;
+	DirectX::XMFLOAT3 m_boundsCenter = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f); // Bounding box in mesh space
+	float m_boundsDiagonal = 0.0f;
 };
\ No newline at end of file
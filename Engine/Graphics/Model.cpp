@@ -1,15 +1,27 @@
 #include "Model.h"
+#include "../Assets/ModelImporter.h"
+#include "../Assets/CookedMesh.h"
+#include "../Assets/MegascansImporter.h"
+#include "../FileHelper.h"
 
 
-bool Model::Initialize(const std::string& filepath, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader)
+bool Model::Initialize(const std::string& filepath, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, UploadHeapRing& uploadRing, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader)
 {
 	this->device = device;
 	this->commandList = deviceContext;
+	this->uploadRing = &uploadRing;
 	this->cb_vs_vertexshader = &cb_vs_vertexshader;
+	this->directory = StringHelper::GetDirectoryFromPath(filepath);
 
+	const ImportOptions options = GetImportOptions();
 	try
 	{
-		if (!this->LoadModel(filepath))
+		// Only the first Model of a file imports it and creates buffers, the rest share that geometry
+		this->geometry = ModelCache::GetShared().Acquire(filepath, options.GetKey(), [&](ModelGeometry& geometry)
+		{
+			return this->LoadModel(filepath, options, geometry.meshes);
+		});
+		if (this->geometry == nullptr)
 			return false;
 	}
 	catch (COMException& exception)
@@ -20,211 +32,235 @@ bool Model::Initialize(const std::string& filepath, ID3D12Device* device, ID3D12
 	return true;
 }
 
-void Model::Draw(const XMMATRIX& worldMatrix, const XMMATRIX& viewProjectionMatrix, int rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS & gpuAddress)
+bool Model::Initialize(const std::string& filepath, const ModelData& modelData, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, UploadHeapRing& uploadRing, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader)
 {
+	this->device = device;
+	this->commandList = deviceContext;
+	this->uploadRing = &uploadRing;
+	this->cb_vs_vertexshader = &cb_vs_vertexshader;
+	this->directory = StringHelper::GetDirectoryFromPath(filepath);
 
-	//this->deviceContext->VSSetConstantBuffers(0, 1, this->cb_vs_vertexshader->GetAddressOf());
-	commandList->SetGraphicsRootConstantBufferView(0, gpuAddress);
-	for (int i = 0; i < meshes.size(); i++)
+	try
 	{
-		// Update Constant Buffer with WVP Matrix
-		//this->cb_vs_vertexshader->data.wvpMatrix = meshes[i].GetTransformMatrix() * worldMatrix * viewProjectionMatrix; // Calculate World-ViewProjection Matrix
-		//this->cb_vs_vertexshader->data.worldMatrix = meshes[i].GetTransformMatrix() * worldMatrix; // Calculate World Matrix
-		this->cb_vs_vertexshader->ApplyChanges();
-		meshes[i].Draw();
+		this->geometry = ModelCache::GetShared().Acquire(filepath, GetImportOptions().GetKey(), [&](ModelGeometry& geometry)
+		{
+			this->CreateMeshes(filepath, modelData, geometry.meshes);
+			return !geometry.meshes.empty();
+		});
+		if (this->geometry == nullptr)
+			return false;
 	}
-}
-
-bool Model::LoadModel(const std::string& filepath)
-{
-	this->directory = StringHelper::GetDirectoryFromPath(filepath);
-	Assimp::Importer importer;
-	const aiScene* pScene = importer.ReadFile(filepath,
-		aiProcess_Triangulate |
-		aiProcess_ConvertToLeftHanded);
-
-	if (pScene == nullptr)
+	catch (COMException& exception)
+	{
+		ErrorLogger::Log(exception);
 		return false;
-
-	this->ProcessNode(pScene->mRootNode, pScene, DirectX::XMMatrixIdentity());
+	}
 	return true;
 }
 
-void Model::ProcessNode(aiNode* node, const aiScene* scene, const XMMATRIX& parentTransformMatrix)
+void Model::Draw(const XMMATRIX& worldMatrix, const XMMATRIX& viewProjectionMatrix, int rootParameterIndex, int textureParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE defaultTexture,
+	const MeshPipelineStates& pipelineStates, UploadHeapRing& constantRing)
 {
-	XMMATRIX nodeTransformMatrix = XMMatrixTranspose(XMMATRIX(&node->mTransformation.a1)) * parentTransformMatrix;
+	if (this->geometry == nullptr)
+		return;
 
-	for (UINT i = 0; i < node->mNumMeshes; i++)
+	for (size_t i = 0; i < this->geometry->meshes.size(); i++)
 	{
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(this->ProcessMesh(mesh, scene, nodeTransformMatrix));
-	}
+		const Mesh& mesh = this->geometry->meshes[i];
+		ID3D12PipelineState* pipelineState = pipelineStates.Get(mesh.GetVertexFormat());
+		if (pipelineState == nullptr)
+			continue;
 
-	for (UINT i = 0; i < node->mNumChildren; i++)
-	{
-		this->ProcessNode(node->mChildren[i], scene, nodeTransformMatrix);
+		// Every mesh has its own WVP Matrix, the packed vertex formats need their dequantize matrix in front of it
+		ConstantBufferPerObject constants;
+		XMStoreFloat4x4(&constants.wvpMat, XMMatrixTranspose(mesh.GetVertexTransform() * mesh.GetTransformMatrix() * worldMatrix * viewProjectionMatrix));
+		const D3D12_GPU_VIRTUAL_ADDRESS address = constantRing.AllocateConstants(constants);
+		if (address == 0)
+		{
+			// Same as Graphics::UploadObjectConstants, the rest of the model would not get any either
+			ErrorLogger::Log("Out of memory for per object constants");
+			return;
+		}
+		commandList->SetGraphicsRootConstantBufferView(rootParameterIndex, address);
+		commandList->SetPipelineState(pipelineState);
+		const Texture* albedo = mesh.FindTexture(aiTextureType::aiTextureType_DIFFUSE);
+		commandList->SetGraphicsRootDescriptorTable(textureParameterIndex, albedo != nullptr ? albedo->GetDescriptor() : defaultTexture);
+		mesh.Draw(this->lod == AutomaticLod ? mesh.SelectLod(worldMatrix, viewProjectionMatrix, MaxLodScreenError) : this->lod);
 	}
 }
 
-Mesh Model::ProcessMesh(aiMesh* mesh, const aiScene* scene, const XMMATRIX& transformMatrix)
+void Model::SetLod(size_t lod)
 {
-	// Data to fill
-	std::vector<Vertex3D> verticies;
-	std::vector<DWORD> indicies;
-
-	// Get verticies
-	for (UINT i = 0; i < mesh->mNumVertices; i++)
-	{
-		Vertex3D vertex;
-
-		vertex.pos.x = mesh->mVertices[i].x;
-		vertex.pos.y = mesh->mVertices[i].y;
-		vertex.pos.z = mesh->mVertices[i].z;
+	this->lod = lod;
+}
 
-		//vertex.normal.x = mesh->mNormals[i].x;
-		//vertex.normal.y = mesh->mNormals[i].y;
-		//vertex.normal.z = mesh->mNormals[i].z;
+ImportOptions Model::GetImportOptions()
+{
+	ImportOptions options = ImportOptions::GetEngineDefaults();
+	options.useDerivedDataCache = true;
+	return options;
+}
 
-		if (mesh->mTextureCoords[0])
+bool Model::LoadModelData(const std::string& filepath, ModelData& modelData)
+{
+	// Same order as LoadModel, but the cooked file is copied out since the mapping does not outlive this call
+	const bool isCooked = StringHelper::GetFileExtension(filepath) == CookedMesh::Extension;
+	std::string cookedPath = isCooked ? filepath : CookedMesh::GetCookedPath(filepath);
+	if (FileHelper::FileExists(cookedPath) && FileHelper::IsFileNewer(cookedPath, filepath))
+	{
+		CookedMeshFile cookedFile;
+		if (cookedFile.Open(cookedPath) && (isCooked || cookedFile.GetOptionsKey() == GetImportOptions().GetKey()))
 		{
-			//vertex.texCoord.x = (float)mesh->mTextureCoords[0][i].x;
-			//vertex.texCoord.y = (float)mesh->mTextureCoords[0][i].y;
+			cookedFile.ToModelData(modelData);
+			return true;
 		}
-
-		verticies.push_back(vertex);
+		if (cookedPath == filepath)
+			return false;
 	}
+	return ModelImporter::Import(filepath, modelData, GetImportOptions());
+}
 
-	// Get indices
-	for (UINT i = 0; i < mesh->mNumFaces; i++)
+bool Model::CreateGeometry(const std::string& filepath, const ModelData& modelData, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, UploadHeapRing& uploadRing, ModelGeometry& geometry)
+{
+	Model model;
+	model.device = device;
+	model.commandList = deviceContext;
+	model.uploadRing = &uploadRing;
+	model.directory = StringHelper::GetDirectoryFromPath(filepath);
+	try
 	{
-		aiFace face = mesh->mFaces[i];
+		model.CreateMeshes(filepath, modelData, geometry.meshes);
+	}
+	catch (COMException& exception)
+	{
+		ErrorLogger::Log(exception);
+		geometry.meshes.clear();
+		return false;
+	}
+	for (const Mesh& mesh : geometry.meshes)
+		geometry.sizeInBytes += mesh.GetSizeInBytes();
+	return !geometry.meshes.empty();
+}
+
+bool Model::LoadModel(const std::string& filepath, const ImportOptions& options, std::vector<Mesh>& meshes)
+{
+	if (StringHelper::GetFileExtension(filepath) == CookedMesh::Extension)
+		return this->LoadCookedModel(filepath, std::string(), meshes);
 
-		for (UINT j = 0; j < face.mNumIndices; j++)
-			indicies.push_back(face.mIndices[j]);
+	// Skip Assimp entirely if the asset tool has cooked an up to date copy of this model with the same options. One
+	// cooked with others would bring different LODs or none at all
+	std::string cookedPath = CookedMesh::GetCookedPath(filepath);
+	if (FileHelper::FileExists(cookedPath) && FileHelper::IsFileNewer(cookedPath, filepath))
+	{
+		if (this->LoadCookedModel(cookedPath, options.GetKey(), meshes))
+			return true;
 	}
-	std::vector<Texture> textures;
-	aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-	std::vector<Texture> diffuseTextures = LoadMaterialTextures(material, aiTextureType::aiTextureType_DIFFUSE, scene);
-	textures.insert(textures.end(), diffuseTextures.begin(), diffuseTextures.end());
 
-	return Mesh(this->device, this->commandList, verticies, indicies, textures, transformMatrix);
+	ModelData modelData;
+	if (!ModelImporter::Import(filepath, modelData, options))
+		return false;
+
+	CreateMeshes(filepath, modelData, meshes);
+	return true;
 }
 
-TextureStorageType Model::DetermineTextureStorageType(const aiScene* pScene, aiMaterial* pMat, unsigned int index, aiTextureType textureType)
+void Model::CreateMeshes(const std::string& filepath, const ModelData& modelData, std::vector<Mesh>& meshes)
 {
-	if (pMat->GetTextureCount(textureType) == 0)
-		return TextureStorageType::None;
-
-	aiString path;
-	pMat->GetTexture(textureType, index, &path);
-	std::string texturePath = path.C_Str();
-	//Check if texture is an embedded indexed texture by seeing if the file path is an index #
-	if (texturePath[0] == '*')
+	MegascansMaterial manifestMaterial;
+	const bool hasManifestMaterial = MegascansImporter::FindMaterial(filepath, manifestMaterial);
+
+	meshes.reserve(modelData.meshes.size());
+	std::vector<uint32_t> indices;
+	for (size_t i = 0; i < modelData.meshes.size(); i++)
 	{
-		if (pScene->mTextures[0]->mHeight == 0)
-		{
-			return TextureStorageType::EmbeddedIndexCompressed;
-		}
-		else
+		const MeshData& meshData = modelData.meshes[i];
+		std::vector<Texture> textures;
+		if (hasManifestMaterial)
+			textures = LoadMaterialTextures(manifestMaterial);
+		else if (meshData.materialIndex < modelData.materials.size())
+			textures = LoadMaterialTextures(modelData.materials[meshData.materialIndex], aiTextureType::aiTextureType_DIFFUSE);
+
+		// Every LOD indexes the same vertices, so they all go into one index buffer one after the other
+		indices = meshData.indices;
+		std::vector<MeshLodRange> lods;
+		lods.push_back({ 0, (UINT)indices.size() });
+		for (const MeshLod& lod : meshData.lods)
 		{
-			assert("SUPPORT DOES NOT EXIST YET FOR INDEXED NON COMPRESSED TEXTURES!" && 0);
-			return TextureStorageType::EmbeddedIndexNonCompressed;
+			lods.push_back({ (UINT)indices.size(), (UINT)lod.indices.size(), lod.error });
+			indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
 		}
+
+		const bool hasNormals = !meshData.normals.empty() && meshData.normals.size() == meshData.vertices.size();
+		const bool hasTangents = !meshData.tangents.empty() && meshData.tangents.size() == meshData.vertices.size();
+		meshes.push_back(Mesh(this->device, this->commandList, *this->uploadRing,
+			meshData.vertices.data(), hasNormals ? meshData.normals.data() : nullptr, hasTangents ? meshData.tangents.data() : nullptr, (UINT)meshData.vertices.size(),
+			indices.data(), (UINT)indices.size(),
+			textures, XMLoadFloat4x4(&meshData.transform), lods));
 	}
-	//Check if texture is an embedded texture but not indexed (path will be the texture's name instead of #)
-	if (auto pTex = pScene->GetEmbeddedTexture(texturePath.c_str()))
+}
+
+bool Model::LoadCookedModel(const std::string& filepath, const std::string& optionsKey, std::vector<Mesh>& meshes)
+{
+	CookedMeshFile cookedFile;
+	if (!cookedFile.Open(filepath))
+		return false;
+	if (!optionsKey.empty() && cookedFile.GetOptionsKey() != optionsKey)
+		return false;
+
+	MegascansMaterial manifestMaterial;
+	const bool hasManifestMaterial = MegascansImporter::FindMaterial(filepath, manifestMaterial);
+
+	// The streams are handed to the buffers straight out of the mapping, nothing is parsed per vertex outside of packing.
+	// Every LOD sits right behind LOD0 in the index stream, so the stream is the index buffer as it is
+	meshes.clear();
+	meshes.reserve(cookedFile.GetMeshCount());
+	for (uint32_t i = 0; i < cookedFile.GetMeshCount(); i++)
 	{
-		if (pTex->mHeight == 0)
-		{
-			return TextureStorageType::EmbeddedCompressed;
-		}
-		else
+		const CookedMeshRecord& record = cookedFile.GetMesh(i);
+		std::vector<Texture> textures;
+		if (hasManifestMaterial)
+			textures = LoadMaterialTextures(manifestMaterial);
+		else if (record.materialIndex < cookedFile.GetMaterialCount())
+			textures = LoadMaterialTextures(cookedFile.GetMaterial(record.materialIndex), aiTextureType::aiTextureType_DIFFUSE);
+
+		std::vector<MeshLodRange> lods;
+		lods.push_back({ 0, record.indexCount });
+		for (uint32_t lod = 0; lod < record.lodCount; lod++)
 		{
-			assert("SUPPORT DOES NOT EXIST YET FOR EMBEDDED NON COMPRESSED TEXTURES!" && 0);
-			return TextureStorageType::EmbeddedNonCompressed;
+			const CookedLodRecord& lodRecord = cookedFile.GetLod(record, lod);
+			lods.push_back({ lodRecord.indexStart, lodRecord.indexCount, lodRecord.error });
 		}
-	}
-	//Lastly check if texture is a filepath by checking for period before extension name
-	if (texturePath.find('.') != std::string::npos)
-	{
-		return TextureStorageType::Disk;
-	}
 
-	return TextureStorageType::None; // No texture exists
+		meshes.push_back(Mesh(this->device, this->commandList, *this->uploadRing,
+			cookedFile.GetVertices(record), cookedFile.GetNormals(record), cookedFile.GetTangents(record), record.vertexCount,
+			cookedFile.GetIndices(record), record.indexCount + record.lodIndexCount,
+			textures, XMMATRIX(record.transform), lods));
+	}
+	return true;
 }
 
-std::vector<Texture> Model::LoadMaterialTextures(aiMaterial* pMaterial, aiTextureType textureType, const aiScene* pScene)
+std::vector<Texture> Model::LoadMaterialTextures(const MaterialData& material, aiTextureType textureType)
 {
+	// Embedded textures ("*N") live in the aiScene, which is gone by now, only files next to the model load
 	std::vector<Texture> materialTextures;
-	//TextureStorageType storetype = TextureStorageType::Invalid;
-	//unsigned int textureCount = pMaterial->GetTextureCount(textureType);
-
-	//if (textureCount == 0) //If there are no textures
-	//{
-	//	storetype = TextureStorageType::None;
-	//	aiColor3D aiColor(0.0f, 0.0f, 0.0f);
-	//	switch (textureType)
-	//	{
-	//	case aiTextureType_DIFFUSE:
-	//		pMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, aiColor);
-	//		if (aiColor.IsBlack()) //If color = black, just use grey
-	//		{
-	//			materialTextures.push_back(Texture(this->device, Colors::UnloadedTextureColor, textureType));
-	//			return materialTextures;
-	//		}
-	//		materialTextures.push_back(Texture(this->device, Color((BYTE)aiColor.r * 255, (BYTE)aiColor.g * 255, (BYTE)aiColor.b * 255), textureType));
-	//		return materialTextures;
-	//	}
-	//}
-	//else
-	//{
-	//	for (UINT i = 0; i < textureCount; i++)
-	//	{
-	//		aiString path;
-	//		pMaterial->GetTexture(textureType, i, &path);
-	//		TextureStorageType storeType = DetermineTextureStorageType(pScene, pMaterial, i, textureType);
-	//		switch (storeType)
-	//		{
-	//		case TextureStorageType::EmbeddedIndexCompressed:
-	//		{
-	//			int index = GetTextureIndex(&path);
-	//			Texture embededIndexedTexture(this->device,
-	//				reinterpret_cast<uint8_t*>(pScene->mTextures[index]->pcData),
-	//				pScene->mTextures[index]->mWidth,
-	//				textureType);
-	//			materialTextures.push_back(embededIndexedTexture);
-	//			break;
-	//		}
-	//		case TextureStorageType::EmbeddedCompressed:
-	//		{
-	//			const aiTexture* pTexture = pScene->GetEmbeddedTexture(path.C_Str());
-	//			Texture embeddedTexture(this->device,
-	//				reinterpret_cast<uint8_t*>(pTexture->pcData),
-	//				pTexture->mWidth,
-	//				textureType);
-	//			materialTextures.push_back(embeddedTexture);
-	//			break;
-	//		}
-	//		case TextureStorageType::Disk:
-	//		{
-	//			std::string filename = this->directory + '\\' + path.C_Str();
-	//			Texture diskTexture(this->device, filename, textureType);
-	//			materialTextures.push_back(diskTexture);
-	//			break;
-	//		}
-	//		}
-	//	}
-	//}
-
-	//if (materialTextures.size() == 0)
-	//{
-	//	materialTextures.push_back(Texture(this->device, Colors::UnhandledTextureColor, aiTextureType::aiTextureType_DIFFUSE));
-	//}
+	if (material.diffuseTexture.empty() || material.diffuseTexture[0] == '*')
+		return materialTextures;
+
+	const std::string filepath = this->directory.empty() ? material.diffuseTexture : this->directory + '\\' + material.diffuseTexture;
+	D3D12_GPU_DESCRIPTOR_HANDLE descriptor;
+	if (TextureCache::GetShared().Acquire(filepath, descriptor))
+		materialTextures.push_back(Texture(textureType, descriptor));
 	return materialTextures;
 }
 
-int Model::GetTextureIndex(aiString* pStr)
+std::vector<Texture> Model::LoadMaterialTextures(const MegascansMaterial& material)
 {
-	assert(pStr->length >= 2);
-	return atoi(&pStr->C_Str()[1]);
+	// The pixel shaders sample one texture, so only the albedo is bound. The normal, roughness and opacity maps are
+	// left for shaders that read them
+	std::vector<Texture> materialTextures;
+	const std::string& albedo = material.GetTexture(MegascansMap::Albedo);
+	D3D12_GPU_DESCRIPTOR_HANDLE descriptor;
+	if (!albedo.empty() && TextureCache::GetShared().Acquire(albedo, descriptor))
+		materialTextures.push_back(Texture(aiTextureType::aiTextureType_DIFFUSE, descriptor));
+	return materialTextures;
 }
@@ -1,25 +1,56 @@
 #pragma once
 #include "Mesh.h"
+#include "ModelCache.h"
+#include "UploadHeapRing.h"
+#include "../Assets/MeshData.h"
+#include "../Assets/ModelImporter.h"
+#include "../Assets/MegascansImporter.h"
 
 using namespace DirectX;
 
 class Model
 {
 public:
-	bool Initialize(const std::string& filepath, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader);
-	void Draw(const XMMATRIX& worldMatrix, const XMMATRIX& viewProjectionMatrix, int rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS& gpuAddress);
+	bool Initialize(const std::string& filepath, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, UploadHeapRing& uploadRing, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader);
+	// Upload half of an asynchronous load (see ModelStreamer), modelData comes from LoadModelData on another thread.
+	// Only creates buffers if the ModelCache does not have the file already
+	bool Initialize(const std::string& filepath, const ModelData& modelData, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, UploadHeapRing& uploadRing, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader);
+	// Sets each mesh's pipeline state from pipelineStates, its constants from constantRing at rootParameterIndex and its
+	// albedo texture at textureParameterIndex. Meshes without one sample defaultTexture
+	void Draw(const XMMATRIX& worldMatrix, const XMMATRIX& viewProjectionMatrix, int rootParameterIndex, int textureParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE defaultTexture,
+		const MeshPipelineStates& pipelineStates, UploadHeapRing& constantRing);
+	// Level of detail drawn by every mesh, 0 is full detail. Meshes with fewer LODs draw their last one. AutomaticLod,
+	// the default, lets every mesh pick its own from its size on screen (Mesh::SelectLod)
+	void SetLod(size_t lod);
+
+	static const size_t AutomaticLod = static_cast<size_t>(-1);
+	// Simplification error an automatically picked LOD may show, as a fraction of the screen height. A pixel at 1080p
+	static constexpr float MaxLodScreenError = 1.0f / 1080.0f;
+
+	// Options every Model imports with, part of the ModelCache key
+	static ImportOptions GetImportOptions();
+	// CPU half of loading, does not touch the device so it can run on any thread. Reads the cooked copy when it is up to
+	// date and was cooked with GetImportOptions
+	static bool LoadModelData(const std::string& filepath, ModelData& modelData);
+	// Creates the buffers for modelData without going through the ModelCache, for replacing geometry that is already
+	// resident (see AssetHotReloader)
+	static bool CreateGeometry(const std::string& filepath, const ModelData& modelData, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, UploadHeapRing& uploadRing, ModelGeometry& geometry);
 
 private:
-	std::vector<Mesh> meshes;
-	bool LoadModel(const std::string& filepath);
-	void ProcessNode(aiNode* node, const aiScene* scene, const XMMATRIX& parentTransformMatrix);
-	Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene, const XMMATRIX& transformMatrix);
-	TextureStorageType DetermineTextureStorageType(const aiScene* pScene, aiMaterial* pMat, unsigned int index, aiTextureType textureType);
-	std::vector<Texture> LoadMaterialTextures(aiMaterial* pMaterial, aiTextureType textureType, const aiScene* pScene);
-	int GetTextureIndex(aiString* pStr);
+	std::shared_ptr<const ModelGeometry> geometry; // Shared with every other Model of the same file, see ModelCache
+	size_t lod = AutomaticLod;
+	bool LoadModel(const std::string& filepath, const ImportOptions& options, std::vector<Mesh>& meshes);
+	// Fails when optionsKey is not empty and the file was cooked with other options
+	bool LoadCookedModel(const std::string& filepath, const std::string& optionsKey, std::vector<Mesh>& meshes);
+	// Meshes of a model that comes with a Megascans manifest take their textures from it instead of from the file,
+	// whose material paths point at the artist's machine
+	void CreateMeshes(const std::string& filepath, const ModelData& modelData, std::vector<Mesh>& meshes);
+	std::vector<Texture> LoadMaterialTextures(const MaterialData& material, aiTextureType textureType);
+	std::vector<Texture> LoadMaterialTextures(const MegascansMaterial& material);
 
 	ID3D12Device* device = nullptr;
 	ID3D12GraphicsCommandList* commandList = nullptr;
+	UploadHeapRing* uploadRing = nullptr; // Releases the upload buffers of the meshes this creates
 	ConstantBuffer<ConstantBufferPerObject>* cb_vs_vertexshader = nullptr;
 	std::string directory = "";
-};
\ No newline at end of file
+};
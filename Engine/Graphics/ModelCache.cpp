@@ -0,0 +1,153 @@
+#include "ModelCache.h"
+#include "../FileHelper.h"
+
+ModelCache& ModelCache::GetShared()
+{
+	static ModelCache cache;
+	return cache;
+}
+
+std::shared_ptr<const ModelGeometry> ModelCache::Acquire(const std::string& filepath, const std::string& importKey, const LoadFunction& load)
+{
+	const std::string canonicalPath = FileHelper::GetCanonicalPath(filepath);
+	const std::string key = canonicalPath + "|" + importKey;
+
+	// Declared ahead of the locks so a reference that turns out to be the last one is dropped after unlocking,
+	// Release takes the lock as well
+	std::shared_ptr<const ModelGeometry> cached;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		auto it = this->entries.find(key);
+		if (it != this->entries.end())
+			cached = it->second.geometry.lock();
+		if (cached)
+		{
+			this->statistics.hits++;
+			this->statistics.bytesSaved += it->second.sizeInBytes;
+			return cached;
+		}
+	}
+
+	std::unique_ptr<ModelGeometry> loaded(new ModelGeometry());
+	if (!load(*loaded))
+		return nullptr;
+	for (const Mesh& mesh : loaded->meshes)
+		loaded->sizeInBytes += mesh.GetSizeInBytes();
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	Entry& entry = this->entries[key];
+	cached = entry.geometry.lock();
+	if (cached)
+	{
+		// Another thread loaded the same file while we did, keep theirs so there is only ever one copy
+		this->statistics.hits++;
+		this->statistics.bytesSaved += entry.sizeInBytes;
+		return cached;
+	}
+	if (entry.address != nullptr)
+	{
+		// Expired but its Release has not run yet. It will not find itself anymore, so account for it here
+		this->statistics.residentBytes -= entry.sizeInBytes;
+		this->statistics.residentModels--;
+		this->statistics.evictions++;
+	}
+
+	const uint64_t sizeInBytes = loaded->sizeInBytes;
+	cached = std::shared_ptr<const ModelGeometry>(loaded.release(), [this, key](const ModelGeometry* geometry) { Release(key, geometry); });
+	entry.geometry = cached;
+	entry.address = cached.get();
+	entry.sizeInBytes = sizeInBytes;
+	entry.resident.filepath = canonicalPath;
+	entry.resident.importKey = importKey;
+	this->generation++;
+
+	this->statistics.misses++;
+	this->statistics.residentBytes += sizeInBytes;
+	this->statistics.residentModels++;
+	return cached;
+}
+
+std::shared_ptr<const ModelGeometry> ModelCache::Find(const std::string& filepath, const std::string& importKey) const
+{
+	const std::string key = FileHelper::GetCanonicalPath(filepath) + "|" + importKey;
+	std::lock_guard<std::mutex> lock(this->mutex);
+	auto it = this->entries.find(key);
+	return it != this->entries.end() ? it->second.geometry.lock() : nullptr;
+}
+
+bool ModelCache::Replace(const std::string& filepath, const std::string& importKey, ModelGeometry& geometry)
+{
+	uint64_t sizeInBytes = 0;
+	for (const Mesh& mesh : geometry.meshes)
+		sizeInBytes += mesh.GetSizeInBytes();
+
+	const std::string key = FileHelper::GetCanonicalPath(filepath) + "|" + importKey;
+	std::shared_ptr<const ModelGeometry> cached;
+	std::lock_guard<std::mutex> lock(this->mutex);
+	auto it = this->entries.find(key);
+	if (it != this->entries.end())
+		cached = it->second.geometry.lock();
+	if (cached == nullptr)
+		return false;
+
+	// The cache allocated the geometry itself, it is only handed out const so Models cannot change it under each other
+	ModelGeometry& resident = const_cast<ModelGeometry&>(*cached);
+	resident.meshes.swap(geometry.meshes);
+	geometry.sizeInBytes = resident.sizeInBytes;
+	resident.sizeInBytes = sizeInBytes;
+
+	this->statistics.residentBytes += sizeInBytes;
+	this->statistics.residentBytes -= it->second.sizeInBytes;
+	it->second.sizeInBytes = sizeInBytes;
+	return true;
+}
+
+std::vector<ModelCache::Resident> ModelCache::GetResidentModels() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	std::vector<Resident> resident;
+	resident.reserve(this->entries.size());
+	for (const auto& entry : this->entries)
+		resident.push_back(entry.second.resident);
+	return resident;
+}
+
+uint64_t ModelCache::GetGeneration() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->generation;
+}
+
+void ModelCache::Release(const std::string& key, const ModelGeometry* geometry)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		auto it = this->entries.find(key);
+		if (it != this->entries.end() && it->second.address == geometry)
+		{
+			this->statistics.residentBytes -= it->second.sizeInBytes;
+			this->statistics.residentModels--;
+			this->statistics.evictions++;
+			this->entries.erase(it);
+		}
+	}
+
+	// Releasing the GPU buffers does not need the lock
+	delete geometry;
+}
+
+ModelCache::Statistics ModelCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->statistics;
+}
+
+void ModelCache::ResetStatistics()
+{
+	// Only the counters, what is resident is still resident
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->statistics.hits = 0;
+	this->statistics.misses = 0;
+	this->statistics.bytesSaved = 0;
+	this->statistics.evictions = 0;
+}
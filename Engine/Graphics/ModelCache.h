@@ -0,0 +1,78 @@
+#pragma once
+#include "Mesh.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// GPU side geometry of one model file, shared by every Model that loaded the same file with the same import options
+struct ModelGeometry
+{
+	std::vector<Mesh> meshes;
+	uint64_t sizeInBytes = 0; // Vertex and index buffers
+};
+
+// Reference counted cache of ModelGeometry keyed on canonical path plus import options. Geometry lives for as long
+// as some Model holds on to it and is evicted as soon as the last one lets go. Thread safe
+class ModelCache
+{
+public:
+	struct Statistics
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t bytesSaved = 0; // Buffer memory hits did not have to allocate again
+		uint64_t residentBytes = 0;
+		uint32_t residentModels = 0;
+		uint32_t evictions = 0;
+
+		float GetHitRate() const { return hits + misses > 0 ? static_cast<float>(hits) / (hits + misses) : 0.0f; }
+	};
+
+	struct Resident
+	{
+		std::string filepath; // Canonical
+		std::string importKey;
+	};
+
+	typedef std::function<bool(ModelGeometry& geometry)> LoadFunction;
+
+	static ModelCache& GetShared();
+
+	// Returns the cached geometry or calls load to create it. Load runs without the lock held, so different files can
+	// load in parallel. Returns null if load fails
+	std::shared_ptr<const ModelGeometry> Acquire(const std::string& filepath, const std::string& importKey, const LoadFunction& load);
+
+	// Geometry that is already resident, or null. Does not count towards the statistics
+	std::shared_ptr<const ModelGeometry> Find(const std::string& filepath, const std::string& importKey) const;
+
+	// Swaps new meshes into the resident geometry of the file, so every Model holding it draws them from the next frame.
+	// geometry gets the old meshes back, the GPU may still be reading them so the caller has to keep them alive until
+	// it is done. Returns false if the file is not resident. Render thread only, Models read the meshes while drawing
+	bool Replace(const std::string& filepath, const std::string& importKey, ModelGeometry& geometry);
+
+	std::vector<Resident> GetResidentModels() const;
+	// Changes whenever a file becomes resident, cheap to poll for whether GetResidentModels has anything new
+	uint64_t GetGeneration() const;
+
+	Statistics GetStatistics() const;
+	void ResetStatistics();
+
+private:
+	struct Entry
+	{
+		std::weak_ptr<const ModelGeometry> geometry;
+		const ModelGeometry* address = nullptr; // Tells a late Release apart from the geometry that replaced it
+		uint64_t sizeInBytes = 0;
+		Resident resident;
+	};
+
+	void Release(const std::string& key, const ModelGeometry* geometry);
+
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, Entry> entries;
+	Statistics statistics;
+	uint64_t generation = 0;
+};
@@ -0,0 +1,117 @@
+#include "ModelStreamer.h"
+#include "../FileHelper.h"
+#include "../ThreadPool.h"
+#include "../Timer.h"
+
+ModelStreamer::ModelStreamer(ThreadPool& pool)
+	: pool(pool)
+{
+}
+
+ModelStreamer::ModelStreamer()
+	: pool(ThreadPool::GetShared())
+{
+}
+
+ModelStreamer::Handle ModelStreamer::Load(const std::string& filepath, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader, Callback callback)
+{
+	Request request;
+	request.model = std::make_shared<Model>();
+	request.promise = std::make_shared<std::promise<bool>>();
+	request.cb_vs_vertexshader = &cb_vs_vertexshader;
+	request.callback = callback;
+
+	Handle handle;
+	handle.model = request.model;
+	handle.loaded = request.promise->get_future().share();
+
+	const std::string importKey = Model::GetImportOptions().GetKey();
+	const std::string key = FileHelper::GetCanonicalPath(filepath) + "|" + importKey;
+
+	auto it = this->imports.find(key);
+	if (it != this->imports.end())
+		request.import = it->second.lock();
+
+	if (request.import == nullptr)
+	{
+		std::shared_ptr<Import> import = std::make_shared<Import>();
+		import->filepath = filepath;
+		import->key = key;
+		import->cached = ModelCache::GetShared().Find(filepath, importKey);
+		if (import->cached != nullptr)
+		{
+			// Holding on to the geometry keeps it resident until Update gets to this request
+			import->succeeded = true;
+			import->done.store(true);
+		}
+		else
+		{
+			this->pool.Enqueue([import]()
+			{
+				Timer timer;
+				timer.Start();
+				import->succeeded = Model::LoadModelData(import->filepath, import->modelData);
+				import->milliseconds = timer.GetMilisecondsElapsed();
+				import->done.store(true, std::memory_order_release);
+			});
+			this->statistics.imported++;
+		}
+		this->imports[key] = import;
+		request.import = import;
+	}
+
+	this->statistics.requested++;
+	this->requests.push_back(std::move(request));
+	return handle;
+}
+
+size_t ModelStreamer::Update(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UploadHeapRing& uploadRing, size_t maxUploads)
+{
+	size_t finished = 0;
+	for (auto it = this->requests.begin(); it != this->requests.end() && finished < maxUploads;)
+	{
+		Import& import = *it->import;
+		if (!import.done.load(std::memory_order_acquire))
+		{
+			++it;
+			continue;
+		}
+
+		if (!import.counted)
+		{
+			import.counted = true;
+			this->statistics.importMilliseconds += import.milliseconds;
+
+			// Later loads of the file go through the ModelCache from here on
+			auto entry = this->imports.find(import.key);
+			if (entry != this->imports.end() && entry->second.lock() == it->import)
+				this->imports.erase(entry);
+		}
+
+		Timer timer;
+		timer.Start();
+		bool succeeded = import.succeeded && it->model->Initialize(import.filepath, import.modelData, device, commandList, uploadRing, *it->cb_vs_vertexshader);
+		this->statistics.uploadMilliseconds += timer.GetMilisecondsElapsed();
+		if (succeeded)
+			this->statistics.uploaded++;
+		else
+			this->statistics.failed++;
+
+		// Copy out what we still need, erasing the request may release the last reference to the import
+		std::shared_ptr<Model> model = it->model;
+		std::shared_ptr<std::promise<bool>> promise = it->promise;
+		Callback callback = it->callback;
+		it = this->requests.erase(it);
+
+		promise->set_value(succeeded);
+		if (callback)
+			callback(model, succeeded);
+		finished++;
+	}
+	return finished;
+}
+
+ModelStreamer::Statistics ModelStreamer::GetStatistics() const
+{
+	return this->statistics;
+}
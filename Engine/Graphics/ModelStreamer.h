@@ -0,0 +1,86 @@
+#pragma once
+#include "Model.h"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class ThreadPool;
+
+// Loads models without blocking the frame. Load queues the file read and import on the thread pool and returns at
+// once, Update runs on the render thread every frame and creates the GPU buffers for whatever has finished importing.
+// The device is only ever touched from Update.
+//
+// Several loads of the same file share one import, and files the ModelCache already holds skip the import entirely.
+// Load and Update must be called from the same thread
+class ModelStreamer
+{
+public:
+	typedef std::function<void(const std::shared_ptr<Model>& model, bool succeeded)> Callback;
+
+	struct Handle
+	{
+		std::shared_ptr<Model> model; // Safe to draw once loaded is ready and true
+		std::shared_future<bool> loaded;
+
+		bool IsReady() const { return this->loaded.valid() && this->loaded.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+	};
+
+	struct Statistics
+	{
+		uint32_t requested = 0;
+		uint32_t imported = 0; // Imports actually run, the rest were shared or already cached
+		uint32_t uploaded = 0;
+		uint32_t failed = 0;
+		double importMilliseconds = 0.0; // Summed over the worker threads
+		double uploadMilliseconds = 0.0;
+	};
+
+	static const size_t DefaultUploadsPerFrame = 16;
+
+	explicit ModelStreamer(ThreadPool& pool);
+	ModelStreamer();
+
+	// callback runs from Update once the model is ready or has failed
+	Handle Load(const std::string& filepath, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader, Callback callback = Callback());
+
+	// Finishes up to maxUploads loads whose import is done, oldest first. Their uploads are recorded on commandList,
+	// which has to be recording, and their upload buffers retired to uploadRing. Returns how many finished
+	size_t Update(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UploadHeapRing& uploadRing, size_t maxUploads = DefaultUploadsPerFrame);
+
+	size_t GetPendingCount() const { return this->requests.size(); }
+	Statistics GetStatistics() const;
+
+private:
+	// Import shared by every request for the same file
+	struct Import
+	{
+		std::string filepath;
+		std::string key;
+		ModelData modelData;
+		std::shared_ptr<const ModelGeometry> cached; // Set instead of modelData when the cache already had the file
+		bool succeeded = false;
+		double milliseconds = 0.0;
+		bool counted = false; // Render thread only, whether statistics has seen this import yet
+		std::atomic<bool> done;
+
+		Import() : done(false) {}
+	};
+
+	struct Request
+	{
+		std::shared_ptr<Import> import;
+		std::shared_ptr<Model> model;
+		std::shared_ptr<std::promise<bool>> promise;
+		ConstantBuffer<ConstantBufferPerObject>* cb_vs_vertexshader;
+		Callback callback;
+	};
+
+	ThreadPool& pool;
+	std::deque<Request> requests;
+	std::unordered_map<std::string, std::weak_ptr<Import>> imports; // In flight, keyed on the ModelCache key
+	Statistics statistics;
+};
@@ -1,8 +1,8 @@
 #include "RenderableGameObject.h"
 
-bool RenderableGameObject::Initialize(const std::string& filepath, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader)
+bool RenderableGameObject::Initialize(const std::string& filepath, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, UploadHeapRing& uploadRing, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader)
 {
-	if (!model.Initialize(filepath, device, deviceContext, cb_vs_vertexshader))
+	if (!model.Initialize(filepath, device, deviceContext, uploadRing, cb_vs_vertexshader))
 		return false;
 
 	this->SetPosition(0.0f, 0.0f, 0.0f);
@@ -16,9 +16,9 @@ bool RenderableGameObject::Initialize(const std::string& filepath, ID3D12Device*
 	return true;
 }
 
-void RenderableGameObject::Draw(const XMMATRIX& viewProjectionMatrix, int rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS gpuAddress)
+void RenderableGameObject::Draw(const XMMATRIX& viewProjectionMatrix, int rootParameterIndex, int textureParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE defaultTexture, const MeshPipelineStates& pipelineStates, UploadHeapRing& constantRing)
 {
-	model.Draw(this->worldMatrix, viewProjectionMatrix, rootParameterIndex, gpuAddress);
+	model.Draw(this->worldMatrix, viewProjectionMatrix, rootParameterIndex, textureParameterIndex, defaultTexture, pipelineStates, constantRing);
 	AdjustPosition(0.0f, 0.0f, 0.0f);
 	// TODO: Update sphere collider (Move this somewhere else)
 	sphere_position = GetPositionFloat3();
@@ -6,8 +6,8 @@ class RenderableGameObject : public GameObject3D
 {
 public:
 	RenderableGameObject() {}
-	bool Initialize(const std::string& filepath, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader); //float boundingSphere scale
-	void Draw(const XMMATRIX& viewProjectionMatrix, int rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS gpuAddress);
+	bool Initialize(const std::string& filepath, ID3D12Device* device, ID3D12GraphicsCommandList* deviceContext, UploadHeapRing& uploadRing, ConstantBuffer<ConstantBufferPerObject>& cb_vs_vertexshader); //float boundingSphere scale
+	void Draw(const XMMATRIX& viewProjectionMatrix, int rootParameterIndex, int textureParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE defaultTexture, const MeshPipelineStates& pipelineStates, UploadHeapRing& constantRing);
 
 	SimpleMath::Vector3 sphere_position;
 	float sphere_radius = 0.0f;
@@ -1,81 +1,51 @@
-//#include "Texture.h"
-//#include "../ErrorLogger.h"
-//#include <wincodec.h>
-////#include <WICTextureLoader.h>
-////#include <DDSTextureLoader.h>
-//
-//Texture::Texture(ID3D12Device* device, const Color& color, aiTextureType type)
-//{
-//	this->Initialize1x1ColorTexture(device, color, type);
-//}
-//
-//Texture::Texture(ID3D12Device* device, const Color* colorData, UINT width, UINT height, aiTextureType type)
-//{
-//	this->InitializeColorTexture(device, colorData, width, height, type);
-//}
-//
-//Texture::Texture(ID3D12Device* device, const std::string& filePath, aiTextureType type)
-//{
-//	this->type = type;
-//	if (StringHelper::GetFileExtension(filePath) == ".dds")
-//	{
-//		HRESULT hr = DirectX::CreateDDSTextureFromFile(device, StringHelper::StringToWide(filePath).c_str(), texture.GetAddressOf(), this->textureView.GetAddressOf());
-//		if (FAILED(hr))
-//		{
-//			this->Initialize1x1ColorTexture(device, Colors::UnloadedTextureColor, type);
-//		}
-//		return;
-//	}
-//	else
-//	{
-//		HRESULT hr = DirectX::CreateWICTextureFromFile(device, StringHelper::StringToWide(filePath).c_str(), texture.GetAddressOf(), this->textureView.GetAddressOf());
-//		if (FAILED(hr))
-//		{
-//			this->Initialize1x1ColorTexture(device, Colors::UnloadedTextureColor, type);
-//		}
-//		return;
-//	}
-//}
-//
-//Texture::Texture(ID3D12Device* device, const uint8_t* pData, size_t size, aiTextureType type)
-//{
-//	this->type = type;
-//	HRESULT hr = DirectX::CreateWICTextureFromMemory(device, pData, size, this->texture.GetAddressOf(), this->textureView.GetAddressOf());
-//	COM_ERROR_IF_FAILED(hr, "Failed to create Texture from memory.");
-//}
-//
-//aiTextureType Texture::GetType()
-//{
-//	return this->type;
-//}
-//
-////ID3D11ShaderResourceView* Texture::GetTextureResourceView()
-////{
-////	return this->textureView.Get();
-////}
-////
-////ID3D11ShaderResourceView** Texture::GetTextureResourceViewAddress()
-////{
-////	return this->textureView.GetAddressOf();
-////}
-//
-//void Texture::Initialize1x1ColorTexture(ID3D12Device* device, const Color& colorData, aiTextureType type)
-//{
-//	InitializeColorTexture(device, &colorData, 1, 1, type);
-//}
-//
-//void Texture::InitializeColorTexture(ID3D12Device* device, const Color* colorData, UINT width, UINT height, aiTextureType type)
-//{
-//	this->type = type;
-//	CD3D11_TEXTURE2D_DESC textureDesc(DXGI_FORMAT_R8G8B8A8_UNORM, width, height);
-//	ID3D11Texture2D* p2DTexture = nullptr;
-//	D3D11_SUBRESOURCE_DATA initialData{};
-//	initialData.pSysMem = colorData;
-//	initialData.SysMemPitch = width * sizeof(Color);
-//	HRESULT hr = device->CreateTexture2D(&textureDesc, &initialData, &p2DTexture);
-//	COM_ERROR_IF_FAILED(hr, "Failed to initialize texture from color data.");
-//	texture = static_cast<ID3D11Texture2D*>(p2DTexture);
-//	CD3D11_SHADER_RESOURCE_VIEW_DESC srvDesc(D3D11_SRV_DIMENSION_TEXTURE2D, textureDesc.Format);
-//	hr = device->CreateShaderResourceView(texture.Get(), &srvDesc, textureView.GetAddressOf());
-//	COM_ERROR_IF_FAILED(hr, "Failed to create shader resource view from texture generated from color data.");
-//}
\ No newline at end of file
+#include "Texture.h"
+#include "../FileHelper.h"
+
+Texture::Texture(aiTextureType type, D3D12_GPU_DESCRIPTOR_HANDLE descriptor)
+	: type(type), descriptor(descriptor)
+{
+}
+
+aiTextureType Texture::GetType() const
+{
+	return this->type;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE Texture::GetDescriptor() const
+{
+	return this->descriptor;
+}
+
+TextureCache& TextureCache::GetShared()
+{
+	static TextureCache cache;
+	return cache;
+}
+
+void TextureCache::SetLoadFunction(const LoadFunction& load)
+{
+	this->load = load;
+}
+
+bool TextureCache::Acquire(const std::string& filepath, D3D12_GPU_DESCRIPTOR_HANDLE& descriptor)
+{
+	if (!this->load)
+		return false;
+
+	const std::string canonicalPath = FileHelper::GetCanonicalPath(filepath);
+	auto it = this->descriptors.find(canonicalPath);
+	if (it == this->descriptors.end())
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE loaded = {};
+		if (!this->load(filepath, loaded))
+			loaded.ptr = 0;
+		it = this->descriptors.emplace(canonicalPath, loaded).first;
+	}
+	descriptor = it->second;
+	return descriptor.ptr != 0;
+}
+
+void TextureCache::Clear()
+{
+	this->descriptors.clear();
+}
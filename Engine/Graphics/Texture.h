@@ -3,6 +3,9 @@
 #include <wrl/client.h>
 #include "Color.h"
 #include <assimp/material.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
 
 enum class TextureStorageType
 {
@@ -15,22 +18,36 @@ enum class TextureStorageType
 	Disk
 };
 
+// A texture a mesh samples, bound through its SRV in Graphics' main descriptor heap. The resource belongs to
+// Graphics, see TextureCache
 class Texture
 {
 public:
-	Texture(ID3D12Device* device, const Color& color, aiTextureType type);
-	Texture(ID3D12Device* device, const Color* colorData, UINT width, UINT height, aiTextureType type);
-	Texture(ID3D12Device* device, const std::string& filePath, aiTextureType type);
-	Texture(ID3D12Device* device, const uint8_t* pData, size_t size, aiTextureType type);
+	Texture(aiTextureType type, D3D12_GPU_DESCRIPTOR_HANDLE descriptor);
 
-	aiTextureType GetType();
-	//D3D11ShaderResourceView* GetTextureResourceView();
-	//D3D11ShaderResourceView** GetTextureResourceViewAddress();
+	aiTextureType GetType() const;
+	D3D12_GPU_DESCRIPTOR_HANDLE GetDescriptor() const;
 
 private:
-	void Initialize1x1ColorTexture(ID3D12Device* device, const Color& colorData, aiTextureType type);
-	void InitializeColorTexture(ID3D12Device* device, const Color* colorData, UINT width, UINT height, aiTextureType type);
-	Microsoft::WRL::ComPtr<ID3D12Resource>texture = nullptr;
-	//Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureView = nullptr;
 	aiTextureType type = aiTextureType::aiTextureType_UNKNOWN;
-};
\ No newline at end of file
+	D3D12_GPU_DESCRIPTOR_HANDLE descriptor = {};
+};
+
+// Material textures by canonical path, so every mesh using a file shares one texture and descriptor. Graphics sets
+// the function that loads them, the uploads are recorded on the frame's command list. Render thread only
+class TextureCache
+{
+public:
+	typedef std::function<bool(const std::string& filepath, D3D12_GPU_DESCRIPTOR_HANDLE& descriptor)> LoadFunction;
+
+	static TextureCache& GetShared();
+
+	void SetLoadFunction(const LoadFunction& load);
+	// False without a load function or when the file does not load, which is not retried until Clear
+	bool Acquire(const std::string& filepath, D3D12_GPU_DESCRIPTOR_HANDLE& descriptor);
+	void Clear();
+
+private:
+	LoadFunction load;
+	std::unordered_map<std::string, D3D12_GPU_DESCRIPTOR_HANDLE> descriptors; // ptr is 0 for files that failed
+};
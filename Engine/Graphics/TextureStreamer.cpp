@@ -0,0 +1,183 @@
+#include "TextureStreamer.h"
+#include "../Assets/UploadLayout.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+
+TextureStreamer::TextureStreamer(const TextureResidency::Settings& settings, uint32_t framesInFlight, ThreadPool& pool)
+	: framesInFlight(std::max(framesInFlight, 1u)),
+	residency(settings, [this](TextureId texture, uint32_t level, std::vector<uint8_t>& data) { return ReadLevel(texture, level, data); }, pool)
+{
+}
+
+TextureStreamer::TextureStreamer(const TextureResidency::Settings& settings, uint32_t framesInFlight)
+	: TextureStreamer(settings, framesInFlight, ThreadPool::GetShared())
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// The loads read from files this owns
+	this->residency.WaitForLoads();
+}
+
+bool TextureStreamer::Add(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, const std::string& filepath, D3D12_CPU_DESCRIPTOR_HANDLE firstDescriptor, UINT descriptorSize, TextureId& texture)
+{
+	std::shared_ptr<DdsFile> file = std::make_shared<DdsFile>();
+	if (!file->Open(filepath))
+		return false;
+
+	Texture entry;
+	entry.filepath = filepath;
+	entry.file = file;
+	entry.firstDescriptor = firstDescriptor;
+	entry.descriptorSize = descriptorSize;
+
+	texture = this->residency.Add(file->GetDescription());
+	{
+		std::lock_guard<std::mutex> lock(this->filesMutex);
+		this->textures.push_back(entry);
+	}
+
+	// The tail comes straight from the mapping, it is small and the texture has nothing to show without it
+	const uint32_t tailLevel = this->residency.GetTailLevel(texture);
+	return Rebuild(device, commandList, texture, tailLevel, file->GetDescription().mipLevels, nullptr);
+}
+
+void TextureStreamer::Touch(TextureId texture, float distance, float worldSize, const StreamingView& view)
+{
+	this->residency.Touch(texture, TextureResidency::GetDesiredLevel(this->residency.GetDescription(texture), distance, worldSize, view));
+}
+
+size_t TextureStreamer::Update(ID3D12Device* device, ID3D12GraphicsCommandList* commandList)
+{
+	this->updateCount++;
+	while (!this->retired.empty() && this->updateCount - this->retired.front().update >= this->framesInFlight)
+		this->retired.pop_front();
+
+	this->residency.Update(this->changes);
+	for (const TextureResidency::Change& change : this->changes)
+	{
+		// A load adds the level above the ones the texture has, an eviction keeps a part of them
+		const uint32_t copyFrom = change.loadedLevel != ~0u ? change.loadedLevel + 1 : change.residentLevel;
+		const uint8_t* data = change.loadedLevel != ~0u ? change.data.data() : nullptr;
+		if (!Rebuild(device, commandList, change.texture, change.residentLevel, copyFrom, data))
+			OutputDebugStringA(("Failed to rebuild streamed texture " + this->textures[change.texture].filepath + "\n").c_str());
+	}
+	return this->changes.size();
+}
+
+bool TextureStreamer::ReadLevel(TextureId texture, uint32_t level, std::vector<uint8_t>& data)
+{
+	std::shared_ptr<DdsFile> file;
+	{
+		std::lock_guard<std::mutex> lock(this->filesMutex);
+		file = this->textures[texture].file;
+	}
+
+	// Touching the mapping here is what reads the level from disk, off the render thread
+	const uint8_t* levelData = file->GetLevelData(level);
+	data.assign(levelData, levelData + file->GetDescription().GetLevelSize(level));
+	return true;
+}
+
+bool TextureStreamer::Rebuild(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, TextureId texture, uint32_t topLevel, uint32_t copyFrom, const uint8_t* data)
+{
+	Texture& entry = this->textures[texture];
+	const ImageDescription& description = entry.file->GetDescription();
+	const UINT levelCount = description.mipLevels - topLevel;
+	D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(description.format),
+		description.GetLevelWidth(topLevel), description.GetLevelHeight(topLevel), 1, static_cast<UINT16>(levelCount));
+
+	ComPtr<ID3D12Resource> resource;
+	HRESULT hr = device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&textureDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&resource)
+	);
+	if (FAILED(hr))
+		return false;
+	resource->SetName(L"Streamed Texture Resource Heap");
+
+	// Levels the old resource does not have go through an upload heap, laid out the way Graphics::LoadTextureFromDds does it
+	const UINT uploadCount = std::min<UINT>(copyFrom, description.mipLevels) - topLevel;
+	if (uploadCount > 0)
+	{
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(uploadCount);
+		std::vector<UINT> rowCounts(uploadCount);
+		UINT64 uploadSize;
+		device->GetCopyableFootprints(&textureDesc, 0, uploadCount, 0, layouts.data(), rowCounts.data(), nullptr, &uploadSize);
+
+		ComPtr<ID3D12Resource> uploadHeap;
+		hr = device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(uploadSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&uploadHeap)
+		);
+		if (FAILED(hr))
+			return false;
+		uploadHeap->SetName(L"Streamed Texture Upload Resource Heap");
+
+		BYTE* uploadData = nullptr;
+		CD3DX12_RANGE readRange(0, 0);
+		hr = uploadHeap->Map(0, &readRange, reinterpret_cast<void**>(&uploadData));
+		if (FAILED(hr))
+			return false;
+
+		const uint8_t* source = data;
+		for (UINT i = 0; i < uploadCount; i++)
+		{
+			const uint32_t level = topLevel + i;
+			const uint8_t* levelData = data != nullptr ? source : entry.file->GetLevelData(level);
+			const size_t sourcePitch = description.GetLevelRowPitch(level);
+			UploadLayout::CopyRows(levelData, sourcePitch, uploadData + layouts[i].Offset, layouts[i].Footprint.RowPitch, sourcePitch, rowCounts[i]);
+			source += description.GetLevelSize(level);
+
+			CD3DX12_TEXTURE_COPY_LOCATION destinationLocation(resource.Get(), i);
+			CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(uploadHeap.Get(), layouts[i]);
+			commandList->CopyTextureRegion(&destinationLocation, 0, 0, 0, &sourceLocation, nullptr);
+		}
+		uploadHeap->Unmap(0, nullptr);
+		Retire(uploadHeap);
+	}
+
+	// The rest is already on the GPU, copied level by level from the old resource
+	if (entry.resource != nullptr)
+	{
+		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(entry.resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+		for (uint32_t level = std::max(copyFrom, topLevel); level < description.mipLevels; level++)
+		{
+			CD3DX12_TEXTURE_COPY_LOCATION destinationLocation(resource.Get(), level - topLevel);
+			CD3DX12_TEXTURE_COPY_LOCATION sourceLocation(entry.resource.Get(), level - entry.topLevel);
+			commandList->CopyTextureRegion(&destinationLocation, 0, 0, 0, &sourceLocation, nullptr);
+		}
+		Retire(entry.resource);
+		entry.descriptorIndex = (entry.descriptorIndex + 1) % this->framesInFlight;
+	}
+	commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	entry.resource = resource;
+	entry.topLevel = topLevel;
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = textureDesc.Format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = levelCount;
+	device->CreateShaderResourceView(resource.Get(), &srvDesc, CD3DX12_CPU_DESCRIPTOR_HANDLE(entry.firstDescriptor, entry.descriptorIndex, entry.descriptorSize));
+	return true;
+}
+
+void TextureStreamer::Retire(const ComPtr<ID3D12Resource>& resource)
+{
+	Retired entry;
+	entry.resource = resource;
+	entry.update = this->updateCount;
+	this->retired.push_back(entry);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "../d3dx12.h"
+#include "../Assets/DdsFile.h"
+#include "../Assets/TextureResidency.h"
+#include <wrl/client.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Streams cooked DDS textures (see TextureCooker) through a TextureResidency. Every texture is a committed resource
+// holding only its resident levels. When those change, Update builds a new resource: the levels the old one had are
+// copied over on the GPU and a freshly loaded level goes through an upload heap, so the file is only read for the level
+// that was missing. Levels are read from the mapped file on the thread pool.
+//
+// Frames still in flight may sample the old resource, so it is released framesInFlight Updates later, and every texture
+// has a ring of framesInFlight descriptors the SRV moves through instead of one that is overwritten in use. Bind the
+// one GetDescriptorIndex names. Everything but the level reads runs on the render thread
+class TextureStreamer
+{
+public:
+	typedef TextureResidency::TextureId TextureId;
+
+	TextureStreamer(const TextureResidency::Settings& settings, uint32_t framesInFlight, ThreadPool& pool);
+	TextureStreamer(const TextureResidency::Settings& settings, uint32_t framesInFlight);
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer& rhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+
+	// Descriptors Add needs from firstDescriptor on
+	uint32_t GetDescriptorsPerTexture() const { return this->framesInFlight; }
+
+	// Opens the DDS and records the upload of its tail on commandList, which has to be recording
+	bool Add(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, const std::string& filepath, D3D12_CPU_DESCRIPTOR_HANDLE firstDescriptor, UINT descriptorSize, TextureId& texture);
+
+	// texture is drawn this frame on a surface worldSize across (the texture covering it once) distance away
+	void Touch(TextureId texture, float distance, float worldSize, const StreamingView& view);
+
+	// Applies what the residency decided, recording copies on commandList which has to be recording. Call once a frame
+	// after waiting for the frame that used this frame's resources last. Returns how many textures changed
+	size_t Update(ID3D12Device* device, ID3D12GraphicsCommandList* commandList);
+
+	// Which of the texture's descriptors, counted from firstDescriptor, holds its current SRV
+	uint32_t GetDescriptorIndex(TextureId texture) const { return this->textures[texture].descriptorIndex; }
+	TextureResidency& GetResidency() { return this->residency; }
+
+private:
+	struct Texture
+	{
+		std::string filepath;
+		std::shared_ptr<DdsFile> file;
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		uint32_t topLevel = 0; // Level of the file the resource starts with
+		D3D12_CPU_DESCRIPTOR_HANDLE firstDescriptor = {};
+		UINT descriptorSize = 0;
+		uint32_t descriptorIndex = 0;
+	};
+
+	// Released once the GPU is past the Update that replaced it
+	struct Retired
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		uint64_t update = 0;
+	};
+
+	bool ReadLevel(TextureId texture, uint32_t level, std::vector<uint8_t>& data);
+	// New resource with levels topLevel and down. Those at or past copyFrom come from the current resource, the ones
+	// above from data (tightly packed levels like ImageData) or the file when data is null
+	bool Rebuild(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, TextureId texture, uint32_t topLevel, uint32_t copyFrom, const uint8_t* data);
+	void Retire(const Microsoft::WRL::ComPtr<ID3D12Resource>& resource);
+
+	uint32_t framesInFlight;
+	TextureResidency residency;
+	std::vector<Texture> textures; // Indexed by TextureId
+	std::mutex filesMutex; // textures grows on the render thread while loads read files
+	std::deque<Retired> retired;
+	std::vector<TextureResidency::Change> changes;
+	uint64_t updateCount = 0;
+};
@@ -0,0 +1,79 @@
+#include "UploadHeapRing.h"
+
+using Microsoft::WRL::ComPtr;
+
+UploadHeapRing::UploadHeapRing(uint64_t pageSize)
+	: ring(pageSize, [this](uint64_t size, UploadAllocation& page) { return CreatePage(size, page); })
+{
+}
+
+bool UploadHeapRing::Initialize(ID3D12Device* device)
+{
+	this->device = device;
+	HRESULT hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&this->fence));
+	if (FAILED(hr))
+		return false;
+	this->fence->SetName(L"Upload Ring Fence");
+	return true;
+}
+
+void UploadHeapRing::BeginFrame()
+{
+	const uint64_t completedValue = this->fence != nullptr ? this->fence->GetCompletedValue() : 0;
+	this->ring.BeginFrame(completedValue);
+	while (!this->retiredResources.empty() && this->retiredResources.front().fenceValue <= completedValue)
+		this->retiredResources.pop_front();
+}
+
+void UploadHeapRing::Retire(const ComPtr<ID3D12Resource>& resource)
+{
+	// EndFrame signals the next value after this frame's command lists, copies recorded before the first frame were
+	// executed before those
+	RetiredResource retired;
+	retired.resource = resource;
+	retired.fenceValue = this->fenceValue + 1;
+	this->retiredResources.push_back(retired);
+}
+
+bool UploadHeapRing::EndFrame(ID3D12CommandQueue* queue)
+{
+	if (this->fence == nullptr)
+		return false;
+	HRESULT hr = queue->Signal(this->fence.Get(), this->fenceValue + 1);
+	if (FAILED(hr))
+		return false;
+	this->fenceValue++;
+	this->ring.EndFrame(this->fenceValue);
+	return true;
+}
+
+bool UploadHeapRing::CreatePage(uint64_t size, UploadAllocation& page)
+{
+	if (this->device == nullptr)
+		return false;
+
+	ComPtr<ID3D12Resource> resource;
+	HRESULT hr = this->device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(size),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&resource)
+	);
+	if (FAILED(hr))
+		return false;
+	resource->SetName(L"Upload Ring Page");
+
+	// Upload heaps can stay mapped for their whole life, the CPU never reads them back
+	CD3DX12_RANGE readRange(0, 0);
+	void* data = nullptr;
+	hr = resource->Map(0, &readRange, &data);
+	if (FAILED(hr))
+		return false;
+
+	page.cpu = static_cast<uint8_t*>(data);
+	page.gpu = resource->GetGPUVirtualAddress();
+	this->pages.push_back(resource);
+	return true;
+}
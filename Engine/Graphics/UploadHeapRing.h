@@ -0,0 +1,60 @@
+#pragma once
+#include "../d3dx12.h"
+#include "../Assets/UploadRing.h"
+#include <wrl/client.h>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+// An UploadRing over D3D12 upload heaps. Every page is a committed buffer that stays mapped, and the ring has a fence
+// of its own the queue signals after each frame, so pages come back exactly when the GPU is done with them whatever
+// the swap chain does with its back buffers. The same fence releases the upload buffers Retire is given, the ones
+// vertex, index and texture copies read from. Render thread only
+class UploadHeapRing
+{
+public:
+	explicit UploadHeapRing(uint64_t pageSize = 64 * 1024);
+
+	UploadHeapRing(const UploadHeapRing& rhs) = delete;
+	UploadHeapRing& operator=(const UploadHeapRing& rhs) = delete;
+
+	bool Initialize(ID3D12Device* device);
+
+	// Call before the first Allocate of a frame
+	void BeginFrame();
+	bool Allocate(uint64_t size, UploadAllocation& allocation) { return this->ring.Allocate(size, allocation); }
+	// Copies data into a new allocation and returns its GPU address for SetGraphicsRootConstantBufferView, 0 when the
+	// ring is out of memory
+	template<typename T>
+	D3D12_GPU_VIRTUAL_ADDRESS AllocateConstants(const T& data)
+	{
+		UploadAllocation allocation;
+		if (!this->ring.Allocate(sizeof(T), allocation))
+			return 0;
+		memcpy(allocation.cpu, &data, sizeof(T));
+		return allocation.gpu;
+	}
+	// Keeps resource alive until the GPU is past the frame being recorded, for upload buffers a copy recorded this
+	// frame reads from. Released by a later BeginFrame
+	void Retire(const Microsoft::WRL::ComPtr<ID3D12Resource>& resource);
+	// Signals the ring's fence on queue, after the command lists that read this frame's allocations were executed
+	bool EndFrame(ID3D12CommandQueue* queue);
+
+	const UploadRing::Statistics& GetStatistics() const { return this->ring.GetStatistics(); }
+
+private:
+	struct RetiredResource
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		uint64_t fenceValue;
+	};
+
+	bool CreatePage(uint64_t size, UploadAllocation& page);
+
+	UploadRing ring;
+	ID3D12Device* device = nullptr;
+	Microsoft::WRL::ComPtr<ID3D12Fence> fence;
+	uint64_t fenceValue = 0; // Last value signaled
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> pages;
+	std::deque<RetiredResource> retiredResources; // Oldest fence value first
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <DirectXMath.h>
+#include <cstdint>
 
 struct Vertex3D 
 {
@@ -9,4 +10,31 @@ struct Vertex3D
 	DirectX::XMFLOAT3 pos;
 	DirectX::XMFLOAT2 textCoord;
 	//DirectX::XMFLOAT3 normal;
-};
\ No newline at end of file
+};
+
+// Packed vertex layouts, produced by VertexCompression (Assets/VertexCompression.h) and drawn with VertexShaderCompact.hlsl.
+// Positions are 16 bit fractions of the mesh bounds, PositionQuantization::GetDequantizeMatrix() undoes that
+// and gets folded into the mesh transform
+enum class VertexFormat
+{
+	Float, // Vertex3D, 20 bytes
+	Compact, // Vertex3DCompact, 12 bytes
+	CompactLit, // Vertex3DCompactLit, 20 bytes
+};
+
+struct Vertex3DCompact
+{
+	uint16_t position[4]; // R16G16B16A16_UNORM, w is always 1
+	uint16_t textCoord[2]; // R16G16_FLOAT
+};
+
+struct Vertex3DCompactLit
+{
+	uint16_t position[4]; // R16G16B16A16_UNORM, w is the bitangent sign, 0 for -1 and 1 for +1
+	int16_t normal[2]; // R16G16_SNORM, octahedral
+	int16_t tangent[2]; // R16G16_SNORM, octahedral
+	uint16_t textCoord[2]; // R16G16_FLOAT
+};
+
+static_assert(sizeof(Vertex3DCompact) == 12, "Vertex3DCompact has to match its input layout");
+static_assert(sizeof(Vertex3DCompactLit) == 20, "Vertex3DCompactLit has to match its input layout");
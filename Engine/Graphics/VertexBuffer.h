@@ -2,7 +2,9 @@
 #define VertexBuffer_h__
 #include <../d3dx12.h>
 #include <wrl/client.h>
+#include "UploadHeapRing.h"
 #include <memory>
+#include <cstring>
 
 template<class T>
 class VertexBuffer
@@ -55,13 +57,27 @@ public:
 		return &this->stride;
 	}
 
-	HRESULT Initialize(ID3D12Device* device, T* data, UINT vertexCount)
+	D3D12_VERTEX_BUFFER_VIEW GetView() const
+	{
+		D3D12_VERTEX_BUFFER_VIEW view = {};
+		view.BufferLocation = pVertexBuffer->GetGPUVirtualAddress();
+		view.StrideInBytes = this->stride;
+		view.SizeInBytes = this->stride * this->vertexCount;
+		return view;
+	}
+
+	// data is copied into an upload buffer straight away, so it only has to live for this call. The copy to the
+	// default heap is recorded on commandList, which has to be recording, and uploadRing releases the upload buffer
+	// once the GPU has run it. stride replaces sizeof(T) for VertexBuffer<uint8_t>, which holds whichever VertexFormat
+	// a mesh was packed into
+	HRESULT Initialize(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UploadHeapRing& uploadRing, const T* data, UINT vertexCount, UINT stride = sizeof(T))
 	{
 		if (pVertexBuffer.Get() != nullptr)
 		{
 			pVertexBuffer.Reset();
 		}
-		this->vertexCount = vertexCount / sizeof(UINT);
+		this->vertexCount = vertexCount;
+		this->stride = stride;
 
 		HRESULT hr = device->CreateCommittedResource(
 			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
@@ -71,7 +87,34 @@ public:
 			nullptr,
 			IID_PPV_ARGS(&pVertexBuffer)
 		);
+		if (FAILED(hr))
+			return hr;
 		pVertexBuffer->SetName(L"Vertex Buffer Resource Heap");
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> uploadBuffer;
+		hr = device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(stride * vertexCount),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&uploadBuffer)
+		);
+		if (FAILED(hr))
+			return hr;
+		uploadBuffer->SetName(L"Vertex Buffer Upload Resource Heap");
+
+		CD3DX12_RANGE readRange(0, 0);
+		void* upload = nullptr;
+		hr = uploadBuffer->Map(0, &readRange, &upload);
+		if (FAILED(hr))
+			return hr;
+		memcpy(upload, data, static_cast<size_t>(stride) * vertexCount);
+		uploadBuffer->Unmap(0, nullptr);
+
+		commandList->CopyBufferRegion(pVertexBuffer.Get(), 0, uploadBuffer.Get(), 0, static_cast<UINT64>(stride) * vertexCount);
+		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(pVertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER));
+		uploadRing.Retire(uploadBuffer);
 		return hr;
 	}
 };
@@ -0,0 +1,46 @@
+#pragma once
+#include <../d3dx12.h>
+#include "Vertex.h"
+
+// Input layouts for every VertexFormat. Float matches VertexShader.hlsl, the packed formats match VertexShaderCompact.hlsl
+namespace VertexLayouts
+{
+	inline D3D12_INPUT_LAYOUT_DESC Get(VertexFormat format)
+	{
+		static const D3D12_INPUT_ELEMENT_DESC floatLayout[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		};
+		static const D3D12_INPUT_ELEMENT_DESC compactLayout[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		};
+		static const D3D12_INPUT_ELEMENT_DESC compactLitLayout[] =
+		{
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+		};
+
+		D3D12_INPUT_LAYOUT_DESC desc = {};
+		switch (format)
+		{
+		case VertexFormat::Compact:
+			desc.pInputElementDescs = compactLayout;
+			desc.NumElements = _countof(compactLayout);
+			break;
+		case VertexFormat::CompactLit:
+			desc.pInputElementDescs = compactLitLayout;
+			desc.NumElements = _countof(compactLitLayout);
+			break;
+		default:
+			desc.pInputElementDescs = floatLayout;
+			desc.NumElements = _countof(floatLayout);
+			break;
+		}
+		return desc;
+	}
+}
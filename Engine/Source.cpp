@@ -1,6 +1,9 @@
 #include "stdafx.h"
 
 #include "Engine.h"
+#include "Tools/AssetTool.h"
+#include "Assets/DerivedDataCache.h"
+#include "Assets/PakArchive.h"
 
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN    // Exclude rarely-used stuff from Windows headers.
@@ -25,6 +28,11 @@ int WINAPI wWinMain(
 	 PWSTR pCmdLine,
 	 int nCmdShow)
 {	
+	// Asset commands (cooking, benchmarks) run headless and never create a window
+	int exitCode = 0;
+	std::vector<std::string> args = AssetTool::GetCommandLineArguments();
+	if (AssetTool::Run(args, exitCode))
+		return exitCode;
 
 	HRESULT hr = CoInitialize(NULL);
 	if (FAILED(hr))
@@ -33,6 +41,34 @@ int WINAPI wWinMain(
 	}
 
 	Engine engine;
+	// "-streamtest [count]" streams count models in while the engine runs, results go to the debug output
+	if (!args.empty() && args[0] == "-streamtest")
+		engine.SetStreamingStressTest(args.size() > 1 ? static_cast<unsigned int>(strtoul(args[1].c_str(), nullptr, 10)) : 500);
+
+	// "-ddcshared <folder>" shares imported assets with everyone pointing at the same folder, "-ddcsize <MB>" caps the
+	// local cache, "-mount <archive>" loads models that are not there loose from a .iepak, "-texturebudget <MB>" streams
+	// the cooked texture within that much video memory, "-texturetier <tiers>" loads textures at a lower resolution
+	// ("half", "quarter" or "full,normal=half", see TextureTierSettings). All of them can come after any other argument
+	for (size_t i = 0; i + 1 < args.size(); i++)
+	{
+		if (args[i] == "-ddcshared")
+			DerivedDataCache::GetShared().SetSharedDirectory(args[i + 1]);
+		else if (args[i] == "-ddcsize")
+			DerivedDataCache::GetShared().SetMaxSizeInBytes(strtoull(args[i + 1].c_str(), nullptr, 10) * 1024 * 1024);
+		else if (args[i] == "-mount" && !PakArchive::GetShared().Open(args[i + 1]))
+			ErrorLogger::Log("Failed to mount " + args[i + 1]);
+		else if (args[i] == "-texturebudget")
+			engine.SetTextureStreamingBudget(strtoull(args[i + 1].c_str(), nullptr, 10) * 1024 * 1024);
+		else if (args[i] == "-texturetier")
+		{
+			TextureTierSettings tiers;
+			if (tiers.Parse(args[i + 1]))
+				engine.SetTextureTiers(tiers);
+			else
+				ErrorLogger::Log("Unknown texture tier " + args[i + 1]);
+		}
+	}
+
 	if (engine.Initialize(hInstance, L"DX12 Engine", L"Hello World!", nCmdShow, 1600, 900))
 	{
 		while (engine.ProccessMessages() == true)
@@ -1,5 +1,6 @@
 #include "StringHelper.h"
 #include <algorithm>
+#include <cctype>
 
 std::wstring StringHelper::StringToWide(std::string str)
 {
@@ -7,6 +8,15 @@ std::wstring StringHelper::StringToWide(std::string str)
 	return wide_string;
 }
 
+std::string StringHelper::WideToString(std::wstring wide)
+{
+	std::string narrow_string;
+	narrow_string.reserve(wide.size());
+	for (wchar_t c : wide)
+		narrow_string.push_back(static_cast<char>(c));
+	return narrow_string;
+}
+
 std::string StringHelper::GetDirectoryFromPath(const std::string& filepath)
 {
 	size_t off1 = filepath.find_last_of('\\');
@@ -37,3 +47,21 @@ std::string StringHelper::GetFileExtension(const std::string& filename)
 	}
 	return std::string(filename.substr(off + 1));
 }
+
+std::vector<std::string> StringHelper::GetFileNameWords(const std::string& filepath)
+{
+	size_t start = filepath.find_last_of("/\\");
+	start = start == std::string::npos ? 0 : start + 1;
+	size_t end = filepath.find_last_of('.');
+	end = end == std::string::npos || end < start ? filepath.size() : end;
+	std::vector<std::string> words(1);
+	for (size_t i = start; i < end; i++)
+	{
+		char c = filepath[i];
+		if (c == '_' || c == '-' || c == ' ')
+			words.emplace_back();
+		else
+			words.back() += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+	}
+	return words;
+}
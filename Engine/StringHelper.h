@@ -1,10 +1,15 @@
 #pragma once
 #include <string>
+#include <vector>
 
 class StringHelper
 {
 public:
 	static std::wstring StringToWide(std::string str);
+	static std::string WideToString(std::wstring wide);
 	static std::string GetDirectoryFromPath(const std::string& filepath);
 	static std::string GetFileExtension(const std::string& filename);
+	// Lower case words of the file name without extension, split at _, - and spaces. "qlCc6_4K_Normal_LOD0.jpg" gives
+	// qlcc6, 4k, normal and lod0
+	static std::vector<std::string> GetFileNameWords(const std::string& filepath);
 };
\ No newline at end of file
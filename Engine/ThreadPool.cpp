@@ -0,0 +1,90 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int workerCount)
+{
+	for (unsigned int i = 0; i < workerCount; i++)
+		this->workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopping = true;
+	}
+	this->condition.notify_all();
+	for (std::thread& worker : this->workers)
+		worker.join();
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+	static ThreadPool pool(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1);
+	return pool;
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->tasks.push(std::move(task));
+	}
+	this->condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 0)
+		return;
+
+	struct SharedState
+	{
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> finished{ 0 };
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+	std::shared_ptr<SharedState> state = std::make_shared<SharedState>();
+
+	// Helpers may start after the caller already finished every item, so they only touch body while items are left
+	auto work = [state, count, &body]()
+	{
+		size_t index;
+		while ((index = state->next.fetch_add(1)) < count)
+		{
+			body(index);
+			if (state->finished.fetch_add(1) + 1 == count)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->condition.notify_all();
+			}
+		}
+	};
+
+	size_t helperCount = std::min(static_cast<size_t>(this->workers.size()), count - 1);
+	for (size_t i = 0; i < helperCount; i++)
+		Enqueue(work);
+
+	work();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&state, count]() { return state->finished.load() == count; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->condition.wait(lock, [this]() { return this->stopping || !this->tasks.empty(); });
+			if (this->stopping && this->tasks.empty())
+				return;
+			task = std::move(this->tasks.front());
+			this->tasks.pop();
+		}
+		task();
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling tasks off a single queue
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned int workerCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool& rhs) = delete;
+	ThreadPool& operator=(const ThreadPool& rhs) = delete;
+
+	// Pool shared by the engine and the asset pipeline, one worker per hardware thread minus the calling thread
+	static ThreadPool& GetShared();
+
+	unsigned int GetWorkerCount() const { return static_cast<unsigned int>(this->workers.size()); }
+
+	void Enqueue(std::function<void()> task);
+
+	template<class F>
+	auto Submit(F function) -> std::future<decltype(function())>
+	{
+		typedef decltype(function()) ResultType;
+		std::shared_ptr<std::packaged_task<ResultType()>> task = std::make_shared<std::packaged_task<ResultType()>>(std::move(function));
+		std::future<ResultType> result = task->get_future();
+		Enqueue([task]() { (*task)(); });
+		return result;
+	}
+
+	// Runs body(0) .. body(count - 1) across the workers and blocks until all of them are done.
+	// The calling thread takes part, so this is safe to call from inside a task as well
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping = false;
+};
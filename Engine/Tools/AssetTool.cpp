@@ -0,0 +1,2754 @@
+#include "AssetTool.h"
+#include "../Assets/ModelImporter.h"
+#include "../Assets/CookedMesh.h"
+#include "../Assets/VertexCacheOptimizer.h"
+#include "../Assets/VertexWelder.h"
+#include "../Assets/IndexCompaction.h"
+#include "../Assets/VertexCompression.h"
+#include "../Assets/MeshletBuilder.h"
+#include "../Assets/MeshSimplifier.h"
+#include "../Assets/DerivedDataCache.h"
+#include "../Assets/TangentGenerator.h"
+#include "../Assets/PakArchive.h"
+#include "../Assets/JsonReader.h"
+#include "../Assets/MegascansImporter.h"
+#include "../Assets/ImageDecoder.h"
+#include "../Assets/MipGenerator.h"
+#include "../Assets/BlockCompressor.h"
+#include "../Assets/DdsFile.h"
+#include "../Assets/TextureCooker.h"
+#include "../Assets/ChannelPacker.h"
+#include "../Assets/TextureResidency.h"
+#include "../Assets/VirtualTexture.h"
+#include "../Assets/TextureDownscaler.h"
+#include "../Assets/UploadLayout.h"
+#include "../Assets/UploadRing.h"
+#include "../Assets/ContentHash.h"
+#include "../FileHelper.h"
+#include "../StringHelper.h"
+#include "../Timer.h"
+#include "../ThreadPool.h"
+#include <cstring>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <shellapi.h>
+#pragma comment(lib, "shell32.lib")
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	volatile uint32_t benchmarkSink = 0; // Keeps benchmark read loops from being optimized away
+
+	size_t CountVertices(const ModelData& model)
+	{
+		size_t count = 0;
+		for (const MeshData& mesh : model.meshes)
+			count += mesh.vertices.size();
+		return count;
+	}
+
+	size_t CountIndices(const ModelData& model)
+	{
+		size_t count = 0;
+		for (const MeshData& mesh : model.meshes)
+			count += mesh.indices.size();
+		return count;
+	}
+
+	// Largest angle in degrees between two arrays of unit vectors, stride in floats
+	double MaxAngleError(const float* a, const float* b, size_t count, size_t strideA, size_t strideB)
+	{
+		double maxAngle = 0.0;
+		for (size_t i = 0; i < count; i++)
+		{
+			const float* va = a + i * strideA;
+			const float* vb = b + i * strideB;
+			double dot = va[0] * vb[0] + va[1] * vb[1] + va[2] * vb[2];
+			dot = std::max(-1.0, std::min(1.0, dot));
+			maxAngle = std::max(maxAngle, acos(dot) * 180.0 / 3.14159265358979);
+		}
+		return maxAngle;
+	}
+
+	bool IsSameGeometry(const ModelData& a, const ModelData& b)
+	{
+		if (a.meshes.size() != b.meshes.size())
+			return false;
+		for (size_t i = 0; i < a.meshes.size(); i++)
+		{
+			const MeshData& meshA = a.meshes[i];
+			const MeshData& meshB = b.meshes[i];
+			if (meshA.vertices.size() != meshB.vertices.size() || meshA.indices != meshB.indices)
+				return false;
+			if (!meshA.vertices.empty() && memcmp(meshA.vertices.data(), meshB.vertices.data(), meshA.vertices.size() * sizeof(Vertex3D)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	// Whole model as one world space triangle soup. lod 0 is the full detail mesh, meshes without that LOD use their last one
+	void FlattenModel(const ModelData& model, size_t lod, std::vector<XMFLOAT3>& positions, std::vector<uint32_t>& indices)
+	{
+		positions.clear();
+		indices.clear();
+		for (const MeshData& mesh : model.meshes)
+		{
+			const std::vector<uint32_t>& meshIndices = lod == 0 || mesh.lods.empty() ? mesh.indices : mesh.lods[std::min(lod, mesh.lods.size()) - 1].indices;
+			uint32_t base = static_cast<uint32_t>(positions.size());
+			XMMATRIX transform = XMLoadFloat4x4(&mesh.transform);
+			for (const Vertex3D& vertex : mesh.vertices)
+			{
+				XMFLOAT3 position;
+				XMStoreFloat3(&position, XMVector3TransformCoord(XMLoadFloat3(&vertex.pos), transform));
+				positions.push_back(position);
+			}
+			for (uint32_t index : meshIndices)
+				indices.push_back(base + index);
+		}
+	}
+
+	float GetDiagonal(const std::vector<XMFLOAT3>& positions)
+	{
+		if (positions.empty())
+			return 0.0f;
+		XMFLOAT3 minimum = positions[0];
+		XMFLOAT3 maximum = positions[0];
+		for (const XMFLOAT3& p : positions)
+		{
+			minimum = XMFLOAT3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+			maximum = XMFLOAT3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+		}
+		float x = maximum.x - minimum.x, y = maximum.y - minimum.y, z = maximum.z - minimum.z;
+		return sqrtf(x * x + y * y + z * z);
+	}
+
+	// What GetCopyableFootprints gives for a few textures that hit every rule: rows padded to 256 bytes, levels
+	// placed on 512, the last row of a level unpadded, and block compressed levels whole blocks even at 2x2 and 1x1
+	struct KnownFootprint
+	{
+		PixelFormat format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipLevels;
+		uint32_t level; // The level the footprint is of
+		uint64_t offset;
+		uint32_t footprintWidth;
+		uint32_t footprintHeight;
+		uint32_t rowPitch;
+		uint32_t rowCount;
+		uint32_t rowSize;
+		uint64_t totalBytes; // Of every level
+	};
+
+	const KnownFootprint KnownFootprints[] =
+	{
+		{ PixelFormat::R8G8B8A8_UNORM, 256, 256, 1, 0, 0, 256, 256, 1024, 256, 1024, 262144 },
+		{ PixelFormat::R8G8B8A8_UNORM, 100, 60, 1, 0, 0, 100, 60, 512, 60, 400, 30608 },
+		{ PixelFormat::R8_UNORM, 3, 3, 2, 1, 1024, 1, 1, 256, 1, 1, 1025 },
+		{ PixelFormat::R16G16B16A16_UNORM, 33, 17, 2, 1, 8704, 16, 8, 256, 8, 128, 10624 },
+		{ PixelFormat::BC1_UNORM, 4, 4, 3, 2, 1024, 4, 4, 256, 1, 8, 1032 },
+		{ PixelFormat::BC3_UNORM, 8, 8, 4, 3, 1536, 4, 4, 256, 1, 16, 1552 },
+		{ PixelFormat::BC7_UNORM, 1024, 1024, 11, 5, 1396736, 32, 32, 256, 8, 128, 1401360 },
+		{ PixelFormat::BC7_UNORM, 1024, 1024, 11, 6, 1398784, 16, 16, 256, 4, 64, 1401360 },
+		{ PixelFormat::BC7_UNORM, 1024, 1024, 11, 10, 1401344, 4, 4, 256, 1, 16, 1401360 },
+	};
+
+	// Feedback the way a virtual texture shader writes it for a ground plane tiled with the texture every
+	// tileSize units, seen from eye height through a 45 degree lens. One id per pixel of a buffer an eighth of
+	// 1920x1080 on each side, sky is VirtualPage::None. The level is picked from the texels one full resolution
+	// pixel covers, stretched along the view ray the flatter the ground is seen
+	void FillGroundFeedback(const VirtualTextureLayout& layout, uint32_t width, uint32_t height, float cameraX, float cameraZ, float tileSize, std::vector<uint32_t>& feedback)
+	{
+		const float tanHalfFieldOfView = 0.41421356f;
+		const float aspect = static_cast<float>(width) / height;
+		const float eyeHeight = 1.7f;
+		const float fullResolutionHeight = height * 8.0f;
+		feedback.assign(static_cast<size_t>(width) * height, VirtualPage::None);
+		for (uint32_t py = 0; py < height; py++)
+		{
+			const float ny = ((py + 0.5f) / height * 2.0f - 1.0f) * tanHalfFieldOfView;
+			if (ny < 0.01f)
+				continue;
+			const float depth = eyeHeight / ny;
+			const float footprint = depth * 2.0f * tanHalfFieldOfView / fullResolutionHeight / sqrtf(ny);
+			const float texels = footprint / tileSize * layout.width;
+			const uint32_t level = texels > 1.0f ? std::min(static_cast<uint32_t>(log2f(texels)), layout.levelCount - 1) : 0;
+			const uint32_t levelWidth = std::max(layout.width >> level, 1u);
+			const uint32_t levelHeight = std::max(layout.height >> level, 1u);
+			float v = (depth + cameraZ) / tileSize;
+			v -= floorf(v);
+			const uint32_t pageY = std::min(static_cast<uint32_t>(v * levelHeight) / layout.pageSize, layout.GetPagesDown(level) - 1);
+			for (uint32_t px = 0; px < width; px++)
+			{
+				const float nx = ((px + 0.5f) / width * 2.0f - 1.0f) * tanHalfFieldOfView * aspect;
+				float u = (nx * depth + cameraX) / tileSize;
+				u -= floorf(u);
+				const uint32_t pageX = std::min(static_cast<uint32_t>(u * levelWidth) / layout.pageSize, layout.GetPagesAcross(level) - 1);
+				feedback[static_cast<size_t>(py) * width + px] = VirtualPage::Pack(pageX, pageY, level);
+			}
+		}
+	}
+}
+
+std::vector<std::string> AssetTool::GetCommandLineArguments()
+{
+	std::vector<std::string> args;
+#ifdef _WIN32
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (argv == nullptr)
+		return args;
+
+	// Skip the exe path
+	for (int i = 1; i < argc; i++)
+		args.push_back(StringHelper::WideToString(argv[i]));
+	LocalFree(argv);
+#endif
+	return args;
+}
+
+bool AssetTool::Run(const std::vector<std::string>& args, int& exitCode)
+{
+	if (args.empty())
+		return false;
+
+	const std::string& command = args[0];
+	std::vector<std::string> commandArgs(args.begin() + 1, args.end());
+
+	if (command == "-cook")
+	{
+		AttachToConsole();
+		exitCode = Cook(commandArgs);
+	}
+	else if (command == "-benchload")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkLoad(commandArgs);
+	}
+	else if (command == "-benchimport")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkImport(commandArgs);
+	}
+	else if (command == "-vcache")
+	{
+		AttachToConsole();
+		exitCode = AnalyzeVertexCache(commandArgs);
+	}
+	else if (command == "-weld")
+	{
+		AttachToConsole();
+		exitCode = AnalyzeWelding(commandArgs);
+	}
+	else if (command == "-indices")
+	{
+		AttachToConsole();
+		exitCode = ReportIndexMemory(commandArgs);
+	}
+	else if (command == "-checkindices")
+	{
+		AttachToConsole();
+		exitCode = CheckIndexBuffers(commandArgs);
+	}
+	else if (command == "-vcompress")
+	{
+		AttachToConsole();
+		exitCode = AnalyzeVertexCompression(commandArgs);
+	}
+	else if (command == "-meshlets")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkMeshlets(commandArgs);
+	}
+	else if (command == "-lods")
+	{
+		AttachToConsole();
+		exitCode = CompareLods(commandArgs);
+	}
+	else if (command == "-benchddc")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkDerivedDataCache(commandArgs);
+	}
+	else if (command == "-tangents")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkTangents(commandArgs);
+	}
+	else if (command == "-pak")
+	{
+		AttachToConsole();
+		exitCode = Pack(commandArgs);
+	}
+	else if (command == "-benchpak")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkPak(commandArgs);
+	}
+	else if (command == "-megascans")
+	{
+		AttachToConsole();
+		exitCode = ListMegascans(commandArgs);
+	}
+	else if (command == "-benchjson")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkMegascans(commandArgs);
+	}
+	else if (command == "-benchimage")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkImages(commandArgs);
+	}
+	else if (command == "-mips")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkMips(commandArgs);
+	}
+	else if (command == "-texcompress")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkBlockCompression(commandArgs);
+	}
+	else if (command == "-cooktextures")
+	{
+		AttachToConsole();
+		exitCode = CookTextures(commandArgs);
+	}
+	else if (command == "-packchannels")
+	{
+		AttachToConsole();
+		exitCode = PackChannels(commandArgs);
+	}
+	else if (command == "-streamtextures")
+	{
+		AttachToConsole();
+		exitCode = SimulateTextureStreaming(commandArgs);
+	}
+	else if (command == "-uploadring")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkUploadRing(commandArgs);
+	}
+	else if (command == "-uploadcopy")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkUploadCopy(commandArgs);
+	}
+	else if (command == "-texturetier")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkTextureTiers(commandArgs);
+	}
+	else if (command == "-vtex")
+	{
+		AttachToConsole();
+		exitCode = BenchmarkVirtualTexture(commandArgs);
+	}
+	else if (command == "-help" || command == "-?")
+	{
+		AttachToConsole();
+		PrintUsage();
+		exitCode = 0;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+int AssetTool::Cook(const std::vector<std::string>& args)
+{
+	if (args.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::string& sourcePath = args[0];
+	std::string cookedPath = args.size() > 1 ? args[1] : CookedMesh::GetCookedPath(sourcePath);
+
+	// The options the engine imports with, so the cooked file holds the same meshes the import would
+	const ImportOptions options = ImportOptions::GetEngineDefaults();
+	ModelData model;
+	Timer timer;
+	timer.Start();
+	if (!ModelImporter::Import(sourcePath, model, options))
+	{
+		printf("Failed to import %s\n", sourcePath.c_str());
+		return 1;
+	}
+	double importTime = timer.GetMilisecondsElapsed();
+
+	timer.Restart();
+	if (!CookedMeshWriter::Write(cookedPath, model, options.GetKey()))
+	{
+		printf("Failed to write %s\n", cookedPath.c_str());
+		return 1;
+	}
+	double writeTime = timer.GetMilisecondsElapsed();
+
+	printf("Cooked %s -> %s\n", sourcePath.c_str(), cookedPath.c_str());
+	printf("  %zu meshes, %zu materials, %zu vertices, %zu indices\n", model.meshes.size(), model.materials.size(), CountVertices(model), CountIndices(model));
+	printf("  import %.2f ms, write %.2f ms\n", importTime, writeTime);
+	return 0;
+}
+
+int AssetTool::BenchmarkLoad(const std::vector<std::string>& args)
+{
+	const int iterations = 5;
+	std::vector<std::string> files = args.empty() ? GetDandelionSet() : args;
+
+	printf("%-50s %8s %10s %12s %12s %8s\n", "Model", "Meshes", "Vertices", "Assimp ms", "Cooked ms", "Speedup");
+	double totalAssimp = 0.0;
+	double totalCooked = 0.0;
+	for (const std::string& sourcePath : files)
+	{
+		// Time the import the way Model::LoadModel does it when there is no cooked file
+		ModelData model;
+		double assimpTime = 0.0;
+		bool imported = true;
+		for (int i = 0; i < iterations && imported; i++)
+		{
+			Timer timer;
+			timer.Start();
+			imported = ModelImporter::Import(sourcePath, model);
+			assimpTime += timer.GetMilisecondsElapsed();
+		}
+		if (!imported)
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			continue;
+		}
+		assimpTime /= iterations;
+
+		// Not the path Model::LoadModel looks for, a cooked file left there would replace every later import
+		std::string cookedPath = CookedMesh::GetCookedPath(sourcePath) + ".benchmark";
+		if (!CookedMeshWriter::Write(cookedPath, model, ImportOptions().GetKey()))
+		{
+			printf("%-50s failed to cook\n", sourcePath.c_str());
+			continue;
+		}
+
+		// Map the cooked file and read every vertex and index once. That is the same amount of
+		// memory traffic as handing the streams to the upload heap, minus the GPU side of it
+		double cookedTime = 0.0;
+		uint32_t checksum = 0;
+		for (int i = 0; i < iterations; i++)
+		{
+			Timer timer;
+			timer.Start();
+			CookedMeshFile cookedFile;
+			if (!cookedFile.Open(cookedPath))
+				break;
+			for (uint32_t m = 0; m < cookedFile.GetMeshCount(); m++)
+			{
+				const CookedMeshRecord& record = cookedFile.GetMesh(m);
+				const uint32_t* words = reinterpret_cast<const uint32_t*>(cookedFile.GetVertices(record));
+				size_t wordCount = record.vertexCount * sizeof(Vertex3D) / sizeof(uint32_t);
+				for (size_t w = 0; w < wordCount; w++)
+					checksum += words[w];
+				const uint32_t* indices = cookedFile.GetIndices(record);
+				for (uint32_t w = 0; w < record.indexCount; w++)
+					checksum += indices[w];
+			}
+			cookedTime += timer.GetMilisecondsElapsed();
+		}
+		cookedTime /= iterations;
+		FileHelper::RemoveFile(cookedPath);
+
+		totalAssimp += assimpTime;
+		totalCooked += cookedTime;
+		printf("%-50s %8zu %10zu %12.3f %12.3f %7.1fx\n", sourcePath.c_str(), model.meshes.size(), CountVertices(model), assimpTime, cookedTime, cookedTime > 0.0 ? assimpTime / cookedTime : 0.0);
+		benchmarkSink = checksum;
+	}
+	printf("%-50s %8s %10s %12.3f %12.3f %7.1fx\n", "Total", "", "", totalAssimp, totalCooked, totalCooked > 0.0 ? totalAssimp / totalCooked : 0.0);
+	return 0;
+}
+
+int AssetTool::BenchmarkImport(const std::vector<std::string>& args)
+{
+	const int iterations = 5;
+	std::vector<std::string> files = args.empty() ? GetDandelionSet() : args;
+
+	std::vector<unsigned int> threadCounts;
+	unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int threads = 1; threads < hardwareThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(hardwareThreads);
+
+	printf("%-50s %8s %10s", "Model", "Meshes", "Parse ms");
+	for (unsigned int threads : threadCounts)
+		printf(" %7uT ms", threads);
+	printf("\n");
+
+	std::vector<double> totals(threadCounts.size(), 0.0);
+	for (const std::string& sourcePath : files)
+	{
+		// Assimp's own parse is single threaded, time it once so it is clear how much of the import we can scale
+		Timer timer;
+		timer.Start();
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(sourcePath, ModelImporter::ImportFlags);
+		double parseTime = timer.GetMilisecondsElapsed();
+		if (scene == nullptr)
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			continue;
+		}
+
+		printf("%-50s %8u %10.3f", sourcePath.c_str(), scene->mNumMeshes, parseTime);
+		ModelData reference;
+		for (size_t t = 0; t < threadCounts.size(); t++)
+		{
+			// The calling thread works too, so N threads is N - 1 workers
+			ThreadPool pool(threadCounts[t] - 1);
+			ModelData model;
+			double convertTime = 0.0;
+			for (int i = 0; i < iterations; i++)
+			{
+				timer.Restart();
+				ModelImporter::ConvertScene(scene, model, ImportOptions(), pool);
+				convertTime += timer.GetMilisecondsElapsed();
+			}
+			convertTime /= iterations;
+			totals[t] += convertTime;
+
+			if (t == 0)
+				reference = model;
+			bool deterministic = IsSameGeometry(reference, model);
+			printf(" %8.3f%s", convertTime, deterministic ? "  " : " !");
+		}
+		printf("\n");
+	}
+
+	printf("%-50s %8s %10s", "Total", "", "");
+	for (double total : totals)
+		printf(" %8.3f  ", total);
+	printf("\n");
+	if (!totals.empty() && totals.back() > 0.0)
+		printf("Speedup 1 -> %u threads: %.2fx (! marks output that differs from the single threaded run)\n", threadCounts.back(), totals.front() / totals.back());
+	return 0;
+}
+
+int AssetTool::AnalyzeVertexCache(const std::vector<std::string>& args)
+{
+	// Common post transform cache sizes, 16 for older parts and 32 for anything recent
+	const unsigned int cacheSizes[] = { 16, 32 };
+	std::vector<std::string> files = args.empty() ? GetDandelionSet() : args;
+
+	ImportOptions options;
+	options.optimizeVertexCache = false;
+
+	printf("%-50s %5s %9s", "Model", "Mesh", "Triangles");
+	for (unsigned int cacheSize : cacheSizes)
+		printf("   ACMR%-2u before/after   ATVR%-2u before/after", cacheSize, cacheSize);
+	printf(" %9s\n", "Opt ms");
+
+	uint64_t totalTriangles = 0;
+	uint64_t totalBefore[2] = {};
+	uint64_t totalAfter[2] = {};
+	double totalTime = 0.0;
+	for (const std::string& sourcePath : files)
+	{
+		ModelData model;
+		if (!ModelImporter::Import(sourcePath, model, options))
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			continue;
+		}
+
+		for (size_t m = 0; m < model.meshes.size(); m++)
+		{
+			MeshData& mesh = model.meshes[m];
+			VertexCacheOptimizer::Statistics before[2];
+			for (int c = 0; c < 2; c++)
+				before[c] = VertexCacheOptimizer::Analyze(mesh.indices, mesh.vertices.size(), cacheSizes[c]);
+
+			Timer timer;
+			timer.Start();
+			VertexCacheOptimizer::Optimize(mesh);
+			double optimizeTime = timer.GetMilisecondsElapsed();
+			totalTime += optimizeTime;
+
+			printf("%-50s %5zu %9u", sourcePath.c_str(), m, before[0].triangleCount);
+			totalTriangles += before[0].triangleCount;
+			for (int c = 0; c < 2; c++)
+			{
+				VertexCacheOptimizer::Statistics after = VertexCacheOptimizer::Analyze(mesh.indices, mesh.vertices.size(), cacheSizes[c]);
+				printf("   %6.3f / %6.3f       %6.3f / %6.3f      ", before[c].acmr, after.acmr, before[c].atvr, after.atvr);
+				totalBefore[c] += before[c].transformedVertices;
+				totalAfter[c] += after.transformedVertices;
+			}
+			printf(" %9.3f\n", optimizeTime);
+		}
+	}
+
+	if (totalTriangles > 0)
+	{
+		printf("%-50s %5s %9llu", "Total", "", static_cast<unsigned long long>(totalTriangles));
+		for (int c = 0; c < 2; c++)
+			printf("   %6.3f / %6.3f       %15s      ", static_cast<double>(totalBefore[c]) / totalTriangles, static_cast<double>(totalAfter[c]) / totalTriangles, "");
+		printf(" %9.3f\n", totalTime);
+	}
+	return 0;
+}
+
+int AssetTool::AnalyzeWelding(const std::vector<std::string>& args)
+{
+	const int iterations = 5;
+	std::vector<std::string> files = args.empty() ? GetDandelionSet() : args;
+
+	// Import the raw face corner vertices so both modes start from the same data
+	ImportOptions options;
+	options.weldVertices = false;
+	options.optimizeVertexCache = false;
+
+	WeldSettings exact;
+	WeldSettings epsilon;
+	epsilon.mode = WeldMode::Epsilon;
+
+	printf("%-50s %5s %10s %10s %7s %10s %10s %7s %10s %10s\n", "Model", "Mesh", "Vertices", "Exact", "Saved", "Epsilon", "Saved", "VB MB", "Exact ms", "Eps ms");
+
+	uint64_t totalVertices = 0;
+	uint64_t totalExact = 0;
+	uint64_t totalEpsilon = 0;
+	double totalExactTime = 0.0;
+	double totalEpsilonTime = 0.0;
+	for (const std::string& sourcePath : files)
+	{
+		ModelData model;
+		if (!ModelImporter::Import(sourcePath, model, options))
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			continue;
+		}
+
+		for (size_t m = 0; m < model.meshes.size(); m++)
+		{
+			const MeshData& source = model.meshes[m];
+			MeshData exactMesh;
+			MeshData epsilonMesh;
+
+			// Welding works in place, so every iteration starts over from a copy. The copy is not timed
+			double exactTime = 0.0;
+			double epsilonTime = 0.0;
+			for (int i = 0; i < iterations; i++)
+			{
+				exactMesh = source;
+				Timer timer;
+				timer.Start();
+				VertexWelder::Weld(exactMesh, exact);
+				exactTime += timer.GetMilisecondsElapsed();
+
+				epsilonMesh = source;
+				timer.Restart();
+				VertexWelder::Weld(epsilonMesh, epsilon);
+				epsilonTime += timer.GetMilisecondsElapsed();
+			}
+			exactTime /= iterations;
+			epsilonTime /= iterations;
+
+			size_t vertexCount = source.vertices.size();
+			double exactSaved = vertexCount > 0 ? 100.0 * (vertexCount - exactMesh.vertices.size()) / vertexCount : 0.0;
+			double epsilonSaved = vertexCount > 0 ? 100.0 * (vertexCount - epsilonMesh.vertices.size()) / vertexCount : 0.0;
+			double bufferSize = vertexCount * sizeof(Vertex3D) / (1024.0 * 1024.0);
+			printf("%-50s %5zu %10zu %10zu %6.1f%% %10zu %6.1f%% %10.2f %10.3f %10.3f\n", sourcePath.c_str(), m, vertexCount,
+				exactMesh.vertices.size(), exactSaved, epsilonMesh.vertices.size(), epsilonSaved, bufferSize, exactTime, epsilonTime);
+
+			totalVertices += vertexCount;
+			totalExact += exactMesh.vertices.size();
+			totalEpsilon += epsilonMesh.vertices.size();
+			totalExactTime += exactTime;
+			totalEpsilonTime += epsilonTime;
+		}
+	}
+
+	if (totalVertices > 0)
+	{
+		printf("%-50s %5s %10llu %10llu %6.1f%% %10llu %6.1f%% %10.2f %10.3f %10.3f\n", "Total", "", static_cast<unsigned long long>(totalVertices),
+			static_cast<unsigned long long>(totalExact), 100.0 * (totalVertices - totalExact) / totalVertices,
+			static_cast<unsigned long long>(totalEpsilon), 100.0 * (totalVertices - totalEpsilon) / totalVertices,
+			totalVertices * sizeof(Vertex3D) / (1024.0 * 1024.0), totalExactTime, totalEpsilonTime);
+		if (totalExactTime > 0.0)
+			printf("Exact weld throughput: %.1f M vertices/s\n", totalVertices / (totalExactTime * 1000.0));
+	}
+	return 0;
+}
+
+int AssetTool::ReportIndexMemory(const std::vector<std::string>& args)
+{
+	std::vector<std::string> files = args.empty() ? GetDandelionSet() : args;
+
+	printf("%-50s %7s %10s %10s %12s %12s %8s %7s %12s\n", "Model", "Meshes", "Indices", "16 bit", "32 bit KB", "Auto KB", "Saved", "Split", "Split KB");
+
+	uint64_t totalIndices = 0;
+	uint64_t total32 = 0;
+	uint64_t totalAuto = 0;
+	uint64_t totalSplit = 0;
+	for (const std::string& sourcePath : files)
+	{
+		ModelData model;
+		if (!ModelImporter::Import(sourcePath, model))
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			continue;
+		}
+
+		// What the meshes take as 32 bit buffers, with the automatic format, and after splitting the oversized ones
+		uint64_t indexCount = 0;
+		uint64_t bytes32 = 0;
+		uint64_t bytesAuto = 0;
+		size_t narrowMeshes = 0;
+		for (const MeshData& mesh : model.meshes)
+		{
+			indexCount += mesh.indices.size();
+			bytes32 += mesh.indices.size() * sizeof(uint32_t);
+			bytesAuto += mesh.indices.size() * IndexCompaction::GetIndexStride(mesh.vertices.size());
+			if (IndexCompaction::Fits16BitIndices(mesh.vertices.size()))
+				narrowMeshes++;
+		}
+
+		size_t meshCount = model.meshes.size();
+		IndexCompaction::SplitFor16BitIndices(model);
+		uint64_t bytesSplit = 0;
+		for (const MeshData& mesh : model.meshes)
+			bytesSplit += mesh.indices.size() * IndexCompaction::GetIndexStride(mesh.vertices.size());
+
+		printf("%-50s %7zu %10llu %4zu of %-3zu %12.1f %12.1f %7.1f%% %7zu %12.1f\n", sourcePath.c_str(), meshCount, static_cast<unsigned long long>(indexCount),
+			narrowMeshes, meshCount, bytes32 / 1024.0, bytesAuto / 1024.0, bytes32 > 0 ? 100.0 * (bytes32 - bytesAuto) / bytes32 : 0.0,
+			model.meshes.size(), bytesSplit / 1024.0);
+
+		totalIndices += indexCount;
+		total32 += bytes32;
+		totalAuto += bytesAuto;
+		totalSplit += bytesSplit;
+	}
+
+	if (total32 > 0)
+	{
+		printf("%-50s %7s %10llu %10s %12.1f %12.1f %7.1f%% %7s %12.1f\n", "Total", "", static_cast<unsigned long long>(totalIndices), "",
+			total32 / 1024.0, totalAuto / 1024.0, 100.0 * (total32 - totalAuto) / total32, "", totalSplit / 1024.0);
+	}
+	return 0;
+}
+
+int AssetTool::CheckIndexBuffers(const std::vector<std::string>& args)
+{
+	std::vector<std::string> files = args.empty() ? GetDandelionSet() : args;
+
+	printf("%-50s %7s %10s %10s %12s %8s\n", "Model", "Meshes", "Indices", "16 bit", "Bytes", "Result");
+
+	size_t failures = 0;
+	for (const std::string& sourcePath : files)
+	{
+		ModelData model;
+		if (!ModelImporter::Import(sourcePath, model, ImportOptions::GetEngineDefaults()))
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			failures++;
+			continue;
+		}
+
+		// LOD0 and the LODs go through WriteIndexBuffer together, the way Model::CreateMeshes hands them to IndexBuffer
+		uint64_t indexCount = 0;
+		uint64_t bytes = 0;
+		size_t narrowMeshes = 0;
+		size_t badMeshes = 0;
+		std::vector<uint8_t> buffer;
+		for (const MeshData& mesh : model.meshes)
+		{
+			std::vector<uint32_t> indices = mesh.indices;
+			for (const MeshLod& lod : mesh.lods)
+				indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+
+			const size_t stride = IndexCompaction::GetIndexStride(mesh.vertices.size());
+			buffer.assign(indices.size() * stride, 0);
+			size_t written = IndexCompaction::WriteIndexBuffer(indices.data(), indices.size(), mesh.vertices.size(), buffer.data());
+
+			bool matches = written == buffer.size();
+			for (size_t i = 0; matches && i < indices.size(); i++)
+			{
+				uint32_t index;
+				if (stride == sizeof(uint16_t))
+				{
+					uint16_t narrow;
+					memcpy(&narrow, buffer.data() + i * stride, sizeof(narrow));
+					index = narrow;
+				}
+				else
+				{
+					memcpy(&index, buffer.data() + i * stride, sizeof(index));
+				}
+				matches = index == indices[i] && index < mesh.vertices.size();
+			}
+
+			indexCount += indices.size();
+			bytes += written;
+			if (stride == sizeof(uint16_t))
+				narrowMeshes++;
+			if (!matches)
+				badMeshes++;
+		}
+
+		printf("%-50s %7zu %10llu %4zu of %-3zu %12llu %8s\n", sourcePath.c_str(), model.meshes.size(), static_cast<unsigned long long>(indexCount),
+			narrowMeshes, model.meshes.size(), static_cast<unsigned long long>(bytes), badMeshes == 0 ? "ok" : "FAILED");
+		if (badMeshes > 0)
+			failures++;
+	}
+	return failures == 0 ? 0 : 1;
+}
+
+int AssetTool::AnalyzeVertexCompression(const std::vector<std::string>& args)
+{
+	const int iterations = 10;
+	std::vector<std::string> files = args.empty() ? GetDandelionSet() : args;
+
+	printf("%-50s %5s %9s %10s %10s %10s %9s %9s %12s %12s\n", "Model", "Mesh", "Vertices", "Pos err", "Pos err %", "UV err", "N deg", "T deg", "Scalar Mv/s", "SIMD Mv/s");
+
+	uint64_t totalVertices = 0;
+	uint64_t floatBytes = 0;
+	uint64_t compactBytes = 0;
+	uint64_t compactLitBytes = 0;
+	double scalarTime = 0.0;
+	double simdTime = 0.0;
+	for (const std::string& sourcePath : files)
+	{
+		// No vertex cache or LOD passes, they do not change what gets encoded
+		ImportOptions options;
+		options.optimizeVertexCache = false;
+		ModelData model;
+		if (!ModelImporter::Import(sourcePath, model, options))
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			continue;
+		}
+
+		for (unsigned int m = 0; m < model.meshes.size(); m++)
+		{
+			const MeshData& mesh = model.meshes[m];
+			const size_t count = mesh.vertices.size();
+			if (count == 0 || mesh.normals.size() != count || mesh.tangents.size() != count)
+				continue;
+			const float* normals = &mesh.normals[0].x;
+			const float* tangents = &mesh.tangents[0].x;
+
+			// Encode timing, scalar against SIMD on the largest format
+			CompressedVertices compressed;
+			double meshTime[2] = {};
+			for (int simd = 0; simd < 2; simd++)
+			{
+				VertexCompression::SetSimdEnabled(simd == 1);
+				for (int i = 0; i < iterations; i++)
+				{
+					Timer timer;
+					timer.Start();
+					VertexCompression::Compress(mesh, VertexFormat::CompactLit, normals, tangents, compressed);
+					meshTime[simd] += timer.GetMilisecondsElapsed();
+				}
+				meshTime[simd] /= iterations;
+			}
+			VertexCompression::SetSimdEnabled(true);
+			scalarTime += meshTime[0];
+			simdTime += meshTime[1];
+
+			// Decode everything back and compare against the float source
+			std::vector<Vertex3D> decoded;
+			VertexCompression::Decompress(compressed, decoded);
+			std::vector<float> decodedNormals(count * 3);
+			std::vector<float> decodedTangents(count * 3);
+			const Vertex3DCompactLit* packed = reinterpret_cast<const Vertex3DCompactLit*>(compressed.data.data());
+			VertexCompression::DecodeOctahedral(packed[0].normal, sizeof(Vertex3DCompactLit), count, decodedNormals.data(), 3 * sizeof(float));
+			VertexCompression::DecodeOctahedral(packed[0].tangent, sizeof(Vertex3DCompactLit), count, decodedTangents.data(), 3 * sizeof(float));
+
+			double positionError = 0.0;
+			double textCoordError = 0.0;
+			for (size_t i = 0; i < count; i++)
+			{
+				const Vertex3D& a = mesh.vertices[i];
+				const Vertex3D& b = decoded[i];
+				double dx = a.pos.x - b.pos.x;
+				double dy = a.pos.y - b.pos.y;
+				double dz = a.pos.z - b.pos.z;
+				positionError = std::max(positionError, sqrt(dx * dx + dy * dy + dz * dz));
+				textCoordError = std::max(textCoordError, static_cast<double>(std::max(fabsf(a.textCoord.x - b.textCoord.x), fabsf(a.textCoord.y - b.textCoord.y))));
+			}
+			const XMFLOAT3& extent = compressed.quantization.extent;
+			double diagonal = sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+			double normalError = MaxAngleError(normals, decodedNormals.data(), count, 3, 3);
+			double tangentError = MaxAngleError(tangents, decodedTangents.data(), count, 4, 3);
+
+			printf("%-50s %5u %9zu %10.6f %9.5f%% %10.6f %9.4f %9.4f %12.1f %12.1f\n", sourcePath.c_str(), m, count, positionError,
+				diagonal > 0.0 ? 100.0 * positionError / diagonal : 0.0, textCoordError, normalError, tangentError,
+				meshTime[0] > 0.0 ? count / (meshTime[0] * 1000.0) : 0.0, meshTime[1] > 0.0 ? count / (meshTime[1] * 1000.0) : 0.0);
+
+			totalVertices += count;
+			floatBytes += count * (sizeof(Vertex3D) + 7 * sizeof(float)); // Vertex3D plus a float3 normal and float4 tangent
+			compactBytes += count * sizeof(Vertex3DCompact);
+			compactLitBytes += count * sizeof(Vertex3DCompactLit);
+		}
+	}
+
+	if (totalVertices > 0)
+	{
+		printf("\n%llu vertices. Float position, uv, normal, tangent %.2f MB -> CompactLit %.2f MB (%.1fx). Float position, uv %.2f MB -> Compact %.2f MB (%.1fx)\n",
+			static_cast<unsigned long long>(totalVertices), floatBytes / (1024.0 * 1024.0), compactLitBytes / (1024.0 * 1024.0), static_cast<double>(floatBytes) / compactLitBytes,
+			totalVertices * sizeof(Vertex3D) / (1024.0 * 1024.0), compactBytes / (1024.0 * 1024.0), static_cast<double>(totalVertices * sizeof(Vertex3D)) / compactBytes);
+		printf("Encode: scalar %.3f ms, SIMD %.3f ms (%.2fx)%s\n", scalarTime, simdTime, simdTime > 0.0 ? scalarTime / simdTime : 0.0,
+			VertexCompression::IsSimdAvailable() ? "" : ", SIMD is not available in this build");
+	}
+	return 0;
+}
+
+int AssetTool::BenchmarkMeshlets(const std::vector<std::string>& args)
+{
+	const int iterations = 5;
+	std::vector<std::string> files = args;
+	if (files.empty())
+	{
+		// The full detail meshes are the ones that would go through a mesh shader path
+		for (const std::string& file : GetDandelionSet())
+		{
+			if (file.find("_LOD0") != std::string::npos)
+				files.push_back(file);
+		}
+	}
+
+	printf("%-50s %7s %10s %9s %8s %8s %8s %9s %6s %10s %10s %6s\n", "Model", "Meshes", "Triangles", "Meshlets", "V fill", "T fill", "Cone deg", "Cullable", "Dup", "Build ms", "M tris/s", "Valid");
+
+	uint64_t totalTriangles = 0;
+	double totalTime = 0.0;
+	bool allValid = true;
+	for (const std::string& sourcePath : files)
+	{
+		ModelData model;
+		if (!ModelImporter::Import(sourcePath, model))
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			continue;
+		}
+
+		std::vector<MeshletData> meshlets(model.meshes.size());
+		double buildTime = 0.0;
+		for (int i = 0; i < iterations; i++)
+		{
+			Timer timer;
+			timer.Start();
+			for (size_t m = 0; m < model.meshes.size(); m++)
+				MeshletBuilder::Build(model.meshes[m], meshlets[m]);
+			buildTime += timer.GetMilisecondsElapsed();
+		}
+		buildTime /= iterations;
+
+		// Weight the per mesh statistics by meshlet count so the row describes the model as a whole
+		uint64_t triangles = 0;
+		uint64_t meshletCount = 0;
+		double vertexFill = 0.0;
+		double triangleFill = 0.0;
+		double coneAngle = 0.0;
+		double cullable = 0.0;
+		uint64_t meshletVertices = 0;
+		uint64_t uniqueVertices = 0;
+		bool valid = true;
+		for (size_t m = 0; m < model.meshes.size(); m++)
+		{
+			valid &= MeshletBuilder::Validate(model.meshes[m], meshlets[m]);
+			MeshletBuilder::Statistics statistics = MeshletBuilder::Analyze(model.meshes[m], meshlets[m]);
+			triangles += statistics.triangleCount;
+			meshletCount += statistics.meshletCount;
+			vertexFill += statistics.vertexFill * statistics.meshletCount;
+			triangleFill += statistics.triangleFill * statistics.meshletCount;
+			cullable += statistics.cullableMeshlets * statistics.meshletCount;
+			coneAngle += statistics.averageConeAngle * statistics.cullableMeshlets * statistics.meshletCount;
+			for (const Meshlet& meshlet : meshlets[m].meshlets)
+				meshletVertices += meshlet.vertexCount;
+			uniqueVertices += model.meshes[m].vertices.size();
+		}
+		allValid &= valid;
+
+		double meshletDivisor = meshletCount > 0 ? static_cast<double>(meshletCount) : 1.0;
+		printf("%-50s %7zu %10llu %9llu %7.1f%% %7.1f%% %8.2f %8.1f%% %6.2f %10.3f %10.2f %6s\n", sourcePath.c_str(), model.meshes.size(),
+			static_cast<unsigned long long>(triangles), static_cast<unsigned long long>(meshletCount),
+			100.0 * vertexFill / meshletDivisor, 100.0 * triangleFill / meshletDivisor, cullable > 0.0 ? coneAngle / cullable : 0.0,
+			100.0 * cullable / meshletDivisor, uniqueVertices > 0 ? static_cast<double>(meshletVertices) / uniqueVertices : 0.0,
+			buildTime, buildTime > 0.0 ? triangles / (buildTime * 1000.0) : 0.0, valid ? "yes" : "NO");
+
+		totalTriangles += triangles;
+		totalTime += buildTime;
+	}
+
+	if (totalTime > 0.0)
+		printf("Total %llu triangles in %.3f ms, %.2f M triangles/s\n", static_cast<unsigned long long>(totalTriangles), totalTime, totalTriangles / (totalTime * 1000.0));
+	return allValid ? 0 : 1;
+}
+
+int AssetTool::CompareLods(const std::vector<std::string>& args)
+{
+	std::vector<std::string> files = args;
+	if (files.empty())
+	{
+		for (const std::string& file : GetDandelionSet())
+		{
+			if (file.find("_LOD0") != std::string::npos)
+				files.push_back(file);
+		}
+	}
+
+	// Each generated LOD aims for the triangle count of the hand made one next to the source, then both are measured
+	// against LOD0 the same way. Distances are in percent of LOD0's bounding box diagonal
+	printf("%-50s %4s %10s %10s %9s %9s %10s %9s %9s %9s\n", "Model", "LOD", "Shipped", "Generated", "Ship max", "Ship mean", "Gen max", "Gen mean", "Gen error", "Gen ms");
+
+	bool allImported = true;
+	for (const std::string& sourcePath : files)
+	{
+		ModelData model;
+		if (!ModelImporter::Import(sourcePath, model))
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			allImported = false;
+			continue;
+		}
+
+		std::vector<XMFLOAT3> referencePositions;
+		std::vector<uint32_t> referenceIndices;
+		FlattenModel(model, 0, referencePositions, referenceIndices);
+		float diagonal = GetDiagonal(referencePositions);
+		double scale = diagonal > 0.0f ? 100.0 / diagonal : 0.0;
+
+		size_t lodOffset = sourcePath.find("_LOD0");
+		for (size_t lod = 1; lod <= 3; lod++)
+		{
+			std::string shippedPath = sourcePath;
+			if (lodOffset != std::string::npos)
+				shippedPath.replace(lodOffset, 5, "_LOD" + std::to_string(lod));
+
+			ModelData shipped;
+			size_t shippedTriangles = 0;
+			MeshSimplifier::DistanceStatistics shippedDistance;
+			bool hasShipped = lodOffset != std::string::npos && ModelImporter::Import(shippedPath, shipped);
+			if (hasShipped)
+			{
+				std::vector<XMFLOAT3> positions;
+				std::vector<uint32_t> indices;
+				FlattenModel(shipped, 0, positions, indices);
+				shippedTriangles = indices.size() / 3;
+				shippedDistance = MeshSimplifier::MeasureDistance(referencePositions, referenceIndices, positions, indices);
+			}
+
+			// Without a hand made LOD to match, fall back to halving the triangles every level
+			double ratio = hasShipped ? static_cast<double>(shippedTriangles) / (referenceIndices.size() / 3) : pow(0.5, static_cast<double>(lod));
+
+			// Simplify from LOD0, like MeshSimplifier::GenerateLods does. The error limit is left wide open so the
+			// triangle counts line up and the distances can be compared
+			Timer timer;
+			timer.Start();
+			for (MeshData& mesh : model.meshes)
+			{
+				MeshLod result;
+				size_t target = static_cast<size_t>(mesh.indices.size() / 3 * ratio) * 3;
+				result.error = MeshSimplifier::Simplify(mesh.vertices, mesh.indices, target, 1.0f, result.indices);
+				mesh.lods.push_back(std::move(result));
+			}
+			double generateTime = timer.GetMilisecondsElapsed();
+
+			std::vector<XMFLOAT3> positions;
+			std::vector<uint32_t> indices;
+			FlattenModel(model, lod, positions, indices);
+			MeshSimplifier::DistanceStatistics generatedDistance = MeshSimplifier::MeasureDistance(referencePositions, referenceIndices, positions, indices);
+			float generatedError = 0.0f;
+			for (const MeshData& mesh : model.meshes)
+				generatedError = std::max(generatedError, mesh.lods.back().error);
+
+			char shippedColumns[64];
+			if (hasShipped)
+				snprintf(shippedColumns, sizeof(shippedColumns), "%10zu", shippedTriangles);
+			else
+				snprintf(shippedColumns, sizeof(shippedColumns), "%10s", "-");
+			printf("%-50s %4zu %s %10zu %8.3f%% %8.4f%% %9.3f%% %8.4f%% %8.4f%% %9.2f\n", sourcePath.c_str(), lod, shippedColumns, indices.size() / 3,
+				shippedDistance.maxDistance * scale, shippedDistance.meanDistance * scale,
+				generatedDistance.maxDistance * scale, generatedDistance.meanDistance * scale, generatedError * 100.0f, generateTime);
+		}
+	}
+	return allImported ? 0 : 1;
+}
+
+int AssetTool::BenchmarkDerivedDataCache(const std::vector<std::string>& args)
+{
+	std::vector<std::string> files = args.empty() ? GetDandelionSet() : args;
+
+	// A directory of its own, so the numbers do not depend on what earlier runs of the engine left behind
+	DerivedDataCache& cache = DerivedDataCache::GetShared();
+	cache.SetDirectory(std::string(DerivedDataCache::DefaultDirectory) + "Benchmark");
+	cache.Trim(0);
+	cache.ResetStatistics();
+
+	ImportOptions uncached;
+	uncached.useDerivedDataCache = false;
+	ImportOptions cached = uncached;
+	cached.useDerivedDataCache = true;
+
+	printf("%-50s %10s %12s %10s %8s\n", "Model", "Import ms", "First put ms", "Hit ms", "Speedup");
+	double totalImport = 0.0;
+	double totalHit = 0.0;
+	for (const std::string& sourcePath : files)
+	{
+		ModelData reference;
+		Timer timer;
+		timer.Start();
+		if (!ModelImporter::Import(sourcePath, reference, uncached))
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			continue;
+		}
+		double importTime = timer.GetMilisecondsElapsed();
+
+		// The first cached import misses and pays for hashing and writing the entry on top of the import
+		ModelData model;
+		timer.Restart();
+		ModelImporter::Import(sourcePath, model, cached);
+		double putTime = timer.GetMilisecondsElapsed();
+
+		timer.Restart();
+		ModelImporter::Import(sourcePath, model, cached);
+		double hitTime = timer.GetMilisecondsElapsed();
+
+		totalImport += importTime;
+		totalHit += hitTime;
+		printf("%-50s %10.3f %12.3f %10.3f %7.1fx%s\n", sourcePath.c_str(), importTime, putTime, hitTime,
+			hitTime > 0.0 ? importTime / hitTime : 0.0, IsSameGeometry(reference, model) ? "" : " (differs!)");
+	}
+	printf("%-50s %10.3f %12s %10.3f %7.1fx\n", "Total", totalImport, "", totalHit, totalHit > 0.0 ? totalImport / totalHit : 0.0);
+
+	// Damage every entry and import again, each one should be detected, deleted and imported from scratch
+	const std::string directory = std::string(DerivedDataCache::DefaultDirectory) + "Benchmark";
+	for (const std::string& name : FileHelper::ListFiles(directory, DerivedDataCache::Extension))
+	{
+		std::vector<uint8_t> data;
+		if (FileHelper::ReadFile(directory + "/" + name, data) && !data.empty())
+		{
+			data[data.size() / 2] ^= 0xFF;
+			FileHelper::WriteFileAtomic(directory + "/" + name, data.data(), data.size());
+		}
+	}
+	bool allMatch = true;
+	for (const std::string& sourcePath : files)
+	{
+		ModelData reference;
+		ModelData model;
+		if (ModelImporter::Import(sourcePath, reference, uncached))
+			allMatch = ModelImporter::Import(sourcePath, model, cached) && IsSameGeometry(reference, model) && allMatch;
+	}
+
+	DerivedDataCache::Statistics statistics = cache.GetStatistics();
+	printf("Hits %llu, misses %llu, hit rate %.1f%%, %llu corrupt entries detected, %s after corruption\n",
+		(unsigned long long)statistics.hits, (unsigned long long)statistics.misses, statistics.GetHitRate() * 100.0f,
+		(unsigned long long)statistics.corrupt, allMatch ? "all models still correct" : "SOME MODELS DIFFER");
+	printf("%u entries, %.2f MB on disk\n", statistics.localEntries, statistics.localSizeInBytes / (1024.0 * 1024.0));
+
+	cache.Trim(0);
+	return allMatch ? 0 : 1;
+}
+
+int AssetTool::Pack(const std::vector<std::string>& args)
+{
+	if (args.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::string directory = args[0];
+	while (directory.size() > 1 && (directory.back() == '/' || directory.back() == '\\'))
+		directory.pop_back();
+	std::string archivePath = args.size() > 1 ? args[1] : directory + "." + Pak::Extension;
+
+	Timer timer;
+	timer.Start();
+	PakWriter writer;
+	size_t added = writer.AddDirectory(directory);
+	if (added == 0)
+	{
+		printf("Nothing to pack in %s\n", directory.c_str());
+		return 1;
+	}
+	double readTime = timer.GetMilisecondsElapsed();
+
+	timer.Restart();
+	if (!writer.Write(archivePath))
+	{
+		printf("Failed to write %s\n", archivePath.c_str());
+		return 1;
+	}
+	double writeTime = timer.GetMilisecondsElapsed();
+
+	// Read everything back before calling it done
+	timer.Restart();
+	PakArchive archive;
+	uint32_t failed = archive.Open(archivePath) ? archive.Verify(ThreadPool::GetShared()) : static_cast<uint32_t>(added);
+	double verifyTime = timer.GetMilisecondsElapsed();
+
+	const PakWriter::Statistics& statistics = writer.GetStatistics();
+	printf("Packed %s -> %s\n", directory.c_str(), archivePath.c_str());
+	printf("  %u files, %u chunks (%u stored), %.2f MB -> %.2f MB (%.1f%%)\n", statistics.entries, statistics.chunks, statistics.storedChunks,
+		statistics.uncompressedBytes / (1024.0 * 1024.0), statistics.fileSize / (1024.0 * 1024.0),
+		statistics.uncompressedBytes > 0 ? 100.0 * statistics.fileSize / statistics.uncompressedBytes : 0.0);
+	printf("  read %.2f ms, compress and write %.2f ms, verify %.2f ms%s\n", readTime, writeTime, verifyTime, failed == 0 ? "" : ", VERIFY FAILED");
+	return failed == 0 ? 0 : 1;
+}
+
+int AssetTool::BenchmarkPak(const std::vector<std::string>& args)
+{
+	const int iterations = 5;
+	const std::string archivePath = args.empty() ? std::string("Resources.") + Pak::Extension : args[0];
+	if (!FileHelper::FileExists(archivePath))
+	{
+		printf("%s does not exist, packing Resources first\n", archivePath.c_str());
+		PakWriter writer;
+		if (writer.AddDirectory("Resources") == 0 || !writer.Write(archivePath))
+		{
+			printf("Failed to write %s\n", archivePath.c_str());
+			return 1;
+		}
+	}
+
+	std::vector<std::string> files = GetDandelionSet();
+	{
+		PakArchive archive;
+		if (!archive.Open(archivePath))
+		{
+			printf("Failed to open %s\n", archivePath.c_str());
+			return 1;
+		}
+		uint64_t looseBytes = 0;
+		uint64_t packedBytes = 0;
+		for (const std::string& file : files)
+		{
+			const PakEntryRecord* entry = archive.Find(file);
+			if (entry == nullptr)
+			{
+				printf("%s is not in %s\n", file.c_str(), archivePath.c_str());
+				return 1;
+			}
+			looseBytes += FileHelper::GetFileSize(file);
+			packedBytes += archive.GetCompressedSize(*entry);
+		}
+		printf("%zu models, %.2f MB loose, %.2f MB packed\n", files.size(), looseBytes / (1024.0 * 1024.0), packedBytes / (1024.0 * 1024.0));
+	}
+
+	// The packed side opens the archive every time, that is part of what it costs
+	auto readLoose = [&files]()
+	{
+		Timer timer;
+		timer.Start();
+		std::vector<uint8_t> data;
+		for (const std::string& file : files)
+		{
+			FileHelper::ReadFile(file, data);
+			benchmarkSink += static_cast<uint32_t>(data.size());
+		}
+		return timer.GetMilisecondsElapsed();
+	};
+	auto readPacked = [&files, &archivePath]()
+	{
+		Timer timer;
+		timer.Start();
+		PakArchive archive;
+		archive.Open(archivePath);
+		std::vector<uint8_t> data;
+		for (const std::string& file : files)
+		{
+			archive.Read(file, data);
+			benchmarkSink += static_cast<uint32_t>(data.size());
+		}
+		return timer.GetMilisecondsElapsed();
+	};
+
+	// The first pass is only cold if the OS file cache does not hold the files yet, after a reboot or after emptying
+	// the standby list (RAMMap) for example. Every later pass is warm
+	double coldLoose = readLoose();
+	double coldPacked = readPacked();
+	double warmLoose = 0.0;
+	double warmPacked = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		warmLoose += readLoose() / iterations;
+		warmPacked += readPacked() / iterations;
+	}
+
+	// Whole loads, Assimp included, without the DerivedDataCache so every load does the import
+	ImportOptions options;
+	options.useDerivedDataCache = false;
+	double loadLoose = 0.0;
+	double loadPacked = 0.0;
+	bool allMatch = true;
+	for (int i = 0; i < iterations; i++)
+	{
+		std::vector<ModelData> looseModels(files.size());
+		Timer timer;
+		timer.Start();
+		for (size_t f = 0; f < files.size(); f++)
+			ModelImporter::Import(files[f], looseModels[f], options);
+		loadLoose += timer.GetMilisecondsElapsed() / iterations;
+
+		std::vector<ModelData> packedModels(files.size());
+		timer.Restart();
+		PakArchive archive;
+		archive.Open(archivePath);
+		std::vector<uint8_t> data;
+		for (size_t f = 0; f < files.size(); f++)
+		{
+			if (archive.Read(files[f], data))
+				ModelImporter::ImportFromMemory(data.data(), data.size(), StringHelper::GetFileExtension(files[f]), packedModels[f], options, ThreadPool::GetShared());
+		}
+		loadPacked += timer.GetMilisecondsElapsed() / iterations;
+
+		for (size_t f = 0; f < files.size(); f++)
+			allMatch &= IsSameGeometry(looseModels[f], packedModels[f]);
+	}
+
+	printf("%-20s %12s %12s %8s\n", "", "Loose ms", "Packed ms", "Speedup");
+	printf("%-20s %12.3f %12.3f %7.2fx\n", "Read, first pass", coldLoose, coldPacked, coldPacked > 0.0 ? coldLoose / coldPacked : 0.0);
+	printf("%-20s %12.3f %12.3f %7.2fx\n", "Read, warm", warmLoose, warmPacked, warmPacked > 0.0 ? warmLoose / warmPacked : 0.0);
+	printf("%-20s %12.3f %12.3f %7.2fx\n", "Load, warm", loadLoose, loadPacked, loadPacked > 0.0 ? loadLoose / loadPacked : 0.0);
+	printf("%zu file opens loose, 1 packed. %s\n", files.size(), allMatch ? "Packed models match the loose ones" : "PACKED MODELS DIFFER");
+	return allMatch ? 0 : 1;
+}
+
+void AssetTool::AttachToConsole()
+{
+#ifdef _WIN32
+	// The engine is a windows subsystem exe, so borrow the console of whoever started us
+	if (!AttachConsole(ATTACH_PARENT_PROCESS))
+		AllocConsole();
+	FILE* stream = nullptr;
+	freopen_s(&stream, "CONOUT$", "w", stdout);
+	freopen_s(&stream, "CONOUT$", "w", stderr);
+#endif
+}
+
+int AssetTool::BenchmarkTangents(const std::vector<std::string>& args)
+{
+	const int iterations = 10;
+	std::vector<std::string> files = args.empty() ? GetDandelionSet() : args;
+
+	printf("%-50s %7s %10s %8s %8s %8s %10s %10s %8s %9s %6s\n", "Model", "Meshes", "Triangles", "Split", "Degen", "Fallback", "Scalar ms", "SIMD ms", "Speedup", "Max deg", "Signs");
+
+	uint64_t totalTriangles = 0;
+	double totalScalar = 0.0;
+	double totalSimd = 0.0;
+	double maxAngle = 0.0;
+	bool allMatch = true;
+	for (const std::string& sourcePath : files)
+	{
+		// Everything up to the tangents, which are generated here instead
+		ImportOptions options;
+		options.generateTangents = false;
+		ModelData model;
+		if (!ModelImporter::Import(sourcePath, model, options))
+		{
+			printf("%-50s failed to import\n", sourcePath.c_str());
+			continue;
+		}
+
+		uint64_t triangles = 0;
+		TangentGenerator::Statistics statistics;
+		double time[2] = {};
+		double modelAngle = 0.0;
+		size_t signMismatches = 0;
+		for (const MeshData& source : model.meshes)
+		{
+			if (source.normals.size() != source.vertices.size())
+				continue;
+			triangles += source.indices.size() / 3;
+
+			// Generation works in place, so every iteration starts over from a copy. The copy is not timed
+			MeshData results[2];
+			for (int simd = 0; simd < 2; simd++)
+			{
+				TangentGenerator::SetSimdEnabled(simd == 1);
+				for (int i = 0; i < iterations; i++)
+				{
+					results[simd] = source;
+					Timer timer;
+					timer.Start();
+					TangentGenerator::Statistics meshStatistics = TangentGenerator::Generate(results[simd]);
+					time[simd] += timer.GetMilisecondsElapsed() / iterations;
+					if (simd == 1 && i == 0)
+					{
+						statistics.splitVertices += meshStatistics.splitVertices;
+						statistics.degenerateTriangles += meshStatistics.degenerateTriangles;
+						statistics.fallbackVertices += meshStatistics.fallbackVertices;
+					}
+				}
+			}
+			TangentGenerator::SetSimdEnabled(true);
+
+			// The SIMD result against the scalar reference. Splitting only depends on the windings, so the vertices
+			// have to line up one to one
+			if (results[0].tangents.size() != results[1].tangents.size() || results[0].indices != results[1].indices)
+			{
+				allMatch = false;
+				signMismatches += results[1].tangents.size();
+				continue;
+			}
+			const std::vector<XMFLOAT4>& reference = results[0].tangents;
+			const std::vector<XMFLOAT4>& simd = results[1].tangents;
+			if (!reference.empty())
+				modelAngle = std::max(modelAngle, MaxAngleError(&reference[0].x, &simd[0].x, reference.size(), 4, 4));
+			for (size_t i = 0; i < reference.size(); i++)
+			{
+				if (reference[i].w != simd[i].w)
+					signMismatches++;
+			}
+		}
+
+		printf("%-50s %7zu %10llu %8zu %8zu %8zu %10.3f %10.3f %7.2fx %9.5f %6zu\n", sourcePath.c_str(), model.meshes.size(),
+			static_cast<unsigned long long>(triangles), statistics.splitVertices, statistics.degenerateTriangles, statistics.fallbackVertices,
+			time[0], time[1], time[1] > 0.0 ? time[0] / time[1] : 0.0, modelAngle, signMismatches);
+
+		totalTriangles += triangles;
+		totalScalar += time[0];
+		totalSimd += time[1];
+		maxAngle = std::max(maxAngle, modelAngle);
+		allMatch &= signMismatches == 0;
+	}
+
+	if (totalTriangles > 0)
+	{
+		printf("\n%llu triangles. Scalar %.3f ms (%.1f M tris/s), SIMD %.3f ms (%.1f M tris/s), %.2fx%s\n", static_cast<unsigned long long>(totalTriangles),
+			totalScalar, totalScalar > 0.0 ? totalTriangles / (totalScalar * 1000.0) : 0.0, totalSimd, totalSimd > 0.0 ? totalTriangles / (totalSimd * 1000.0) : 0.0,
+			totalSimd > 0.0 ? totalScalar / totalSimd : 0.0, TangentGenerator::IsSimdAvailable() ? "" : ", SIMD is not available in this build");
+		printf("Largest angle between the SIMD and scalar tangents %.5f degrees, %s\n", maxAngle, allMatch ? "every sign matches" : "SIGNS DIFFER");
+	}
+	return allMatch ? 0 : 1;
+}
+
+int AssetTool::ListMegascans(const std::vector<std::string>& args)
+{
+	std::vector<std::string> manifests;
+	for (const std::string& arg : (args.empty() ? std::vector<std::string>{ "Resources" } : args))
+	{
+		if (StringHelper::GetFileExtension(arg) == "json")
+			manifests.push_back(arg);
+		else
+			MegascansImporter::FindManifests(arg, manifests);
+	}
+
+	int failed = 0;
+	for (const std::string& manifest : manifests)
+	{
+		MegascansAsset asset;
+		if (!MegascansImporter::Load(manifest, asset))
+		{
+			printf("%s is not a manifest this importer reads\n", manifest.c_str());
+			failed++;
+			continue;
+		}
+
+		std::vector<MegascansMaterial> materials;
+		MegascansImporter::ResolveMaterials(asset, StringHelper::GetDirectoryFromPath(manifest), MegascansResolveSettings(), materials);
+		printf("%s: %s \"%s\", %zu models, %zu maps, %zu billboard maps\n", manifest.c_str(), asset.id.c_str(), asset.name.c_str(),
+			asset.models.size(), asset.maps.size(), asset.billboards.size());
+		printf("  %-24s %-10s %6s  %s\n", "Material", "Set", "Size", "Maps on disk");
+
+		// The paths of each texture set are listed once, under the first material that uses it
+		bool listed[2] = {};
+		for (const MegascansMaterial& material : materials)
+		{
+			std::string maps;
+			for (size_t m = 0; m < static_cast<size_t>(MegascansMap::Count); m++)
+			{
+				if (!material.textures[m].empty())
+					maps += std::string(maps.empty() ? "" : " ") + MegascansImporter::GetMapName(static_cast<MegascansMap>(m));
+			}
+			printf("  %-24s %-10s %6u  %s%s\n", material.name.c_str(), material.billboard ? "billboard" : "atlas", material.resolution,
+				maps.empty() ? "none" : maps.c_str(), material.roughnessFromGloss ? " (roughness from gloss)" : "");
+
+			bool& setListed = listed[material.billboard ? 1 : 0];
+			if (setListed)
+				continue;
+			setListed = true;
+			for (size_t m = 0; m < static_cast<size_t>(MegascansMap::Count); m++)
+			{
+				if (!material.textures[m].empty())
+					printf("    %-14s %s\n", MegascansImporter::GetMapName(static_cast<MegascansMap>(m)), material.textures[m].c_str());
+			}
+		}
+	}
+	if (manifests.empty())
+		printf("No manifests found\n");
+	return manifests.empty() || failed > 0 ? 1 : 0;
+}
+
+int AssetTool::BenchmarkMegascans(const std::vector<std::string>& args)
+{
+	const int iterations = 5;
+	const std::string directory = args.empty() ? "Resources" : args[0];
+	const size_t corpusSize = args.size() > 1 ? static_cast<size_t>(std::max(1, atoi(args[1].c_str()))) : 5000;
+
+	std::vector<std::string> manifests;
+	MegascansImporter::FindManifests(directory, manifests);
+	std::vector<std::vector<uint8_t>> sources;
+	for (const std::string& manifest : manifests)
+	{
+		std::vector<uint8_t> data;
+		MegascansAsset asset;
+		if (FileHelper::ReadFile(manifest, data) && MegascansImporter::Parse(reinterpret_cast<const char*>(data.data()), data.size(), asset))
+			sources.push_back(std::move(data));
+	}
+	if (sources.empty())
+	{
+		printf("No Megascans manifests below %s\n", directory.c_str());
+		return 1;
+	}
+
+	// A library has thousands of assets, a checkout a handful of them. The corpus repeats what is there, every copy
+	// in its own allocation like separately loaded files
+	std::vector<std::vector<uint8_t>> corpus;
+	corpus.reserve(corpusSize);
+	uint64_t corpusBytes = 0;
+	for (size_t i = 0; i < corpusSize; i++)
+	{
+		corpus.push_back(sources[i % sources.size()]);
+		corpusBytes += corpus.back().size();
+	}
+	printf("%zu manifests from %s, corpus of %zu (%.2f MB)\n", sources.size(), directory.c_str(), corpus.size(), corpusBytes / (1024.0 * 1024.0));
+
+	auto tokenize = [&corpus]()
+	{
+		size_t tokens = 0;
+		for (const std::vector<uint8_t>& manifest : corpus)
+		{
+			JsonReader reader(reinterpret_cast<const char*>(manifest.data()), manifest.size());
+			for (JsonToken token = reader.Next(); token != JsonToken::End && token != JsonToken::Error; token = reader.Next())
+				tokens++;
+		}
+		return tokens;
+	};
+
+	std::atomic<size_t> failures(0);
+	auto parse = [&corpus, &failures](size_t i, bool resolve)
+	{
+		MegascansAsset asset;
+		if (!MegascansImporter::Parse(reinterpret_cast<const char*>(corpus[i].data()), corpus[i].size(), asset))
+		{
+			failures++;
+			return;
+		}
+		if (resolve)
+		{
+			// Without the file checks, this measures the importer and not the file system
+			MegascansResolveSettings settings;
+			settings.requireFiles = false;
+			std::vector<MegascansMaterial> materials;
+			MegascansImporter::ResolveMaterials(asset, "Resources", settings, materials);
+			benchmarkSink += static_cast<uint32_t>(materials.size());
+		}
+		benchmarkSink += static_cast<uint32_t>(asset.maps.size());
+	};
+
+	// Best of the iterations, the first one also pays for faulting the corpus into the cache
+	auto measure = [](const std::function<void()>& body)
+	{
+		double best = 0.0;
+		for (int i = 0; i < iterations; i++)
+		{
+			Timer timer;
+			timer.Start();
+			body();
+			double time = timer.GetMilisecondsElapsed();
+			best = i == 0 ? time : std::min(best, time);
+		}
+		return best;
+	};
+
+	size_t tokens = 0;
+	double times[5] = {};
+	JsonReader::SetSimdEnabled(false);
+	times[0] = measure([&]() { tokens = tokenize(); });
+	JsonReader::SetSimdEnabled(true);
+	times[1] = measure([&]() { tokens = tokenize(); });
+	times[2] = measure([&]() { for (size_t i = 0; i < corpus.size(); i++) parse(i, false); });
+	times[3] = measure([&]() { for (size_t i = 0; i < corpus.size(); i++) parse(i, true); });
+	times[4] = measure([&]() { ThreadPool::GetShared().ParallelFor(corpus.size(), [&](size_t i) { parse(i, true); }); });
+
+	const char* names[5] = { "Tokenize, scalar", "Tokenize, SIMD", "Parse", "Parse + resolve", "Parse + resolve, pool" };
+	printf("%llu tokens per pass\n\n", static_cast<unsigned long long>(tokens));
+	printf("%-24s %10s %10s %14s\n", "", "ms", "MB/s", "Manifests/s");
+	for (int t = 0; t < 5; t++)
+	{
+		double seconds = times[t] / 1000.0;
+		printf("%-24s %10.3f %10.1f %14.0f\n", names[t], times[t], seconds > 0.0 ? corpusBytes / (1024.0 * 1024.0) / seconds : 0.0,
+			seconds > 0.0 ? corpus.size() / seconds : 0.0);
+	}
+	printf("\n%u worker threads%s. %s\n", ThreadPool::GetShared().GetWorkerCount() + 1, JsonReader::IsSimdAvailable() ? "" : ", SIMD is not available in this build",
+		failures.load() == 0 ? "Every manifest parsed" : "SOME MANIFESTS FAILED TO PARSE");
+	return failures.load() == 0 ? 0 : 1;
+}
+
+int AssetTool::BenchmarkImages(const std::vector<std::string>& args)
+{
+	const int iterations = 3;
+	std::vector<std::string> files = args;
+	if (files.empty())
+	{
+		files.push_back("Resources\\Textures\\Catalina.jpg");
+		const std::string atlas = "Resources\\Models\\Dandelion\\Textures\\Atlas";
+		for (const std::string& name : FileHelper::ListFiles(atlas, ".jpg"))
+			files.push_back(atlas + "\\" + name);
+	}
+
+	// Decoding on the calling thread alone, and on the shared pool
+	ThreadPool singleThread(0);
+	ThreadPool& pool = ThreadPool::GetShared();
+
+	auto measure = [](const std::vector<uint8_t>& data, ThreadPool& threads, ImageData& image)
+	{
+		double best = 0.0;
+		for (int i = 0; i < iterations; i++)
+		{
+			Timer timer;
+			timer.Start();
+			bool decoded = ImageDecoder::Decode(data.data(), data.size(), image, threads);
+			double time = timer.GetMilisecondsElapsed();
+			if (!decoded)
+				return -1.0;
+			best = i == 0 ? time : std::min(best, time);
+		}
+		return best;
+	};
+
+	printf("%-40s %11s %8s %12s %12s %12s %8s\n", "", "Size", "Format", "Scalar ms", "SIMD ms", "Pool ms", "MP/s");
+	bool failed = false;
+	double totals[3] = {};
+	double totalPixels = 0.0;
+	for (const std::string& file : files)
+	{
+		std::vector<uint8_t> data;
+		if (!FileHelper::ReadFile(file, data))
+		{
+			printf("Cannot read %s\n", file.c_str());
+			failed = true;
+			continue;
+		}
+
+		ImageData image;
+		double times[3];
+		ImageDecoder::SetSimdEnabled(false);
+		times[0] = measure(data, singleThread, image);
+		ImageDecoder::SetSimdEnabled(true);
+		times[1] = measure(data, singleThread, image);
+		times[2] = measure(data, pool, image);
+		if (times[0] < 0.0 || times[1] < 0.0 || times[2] < 0.0)
+		{
+			printf("%s is not an image ImageDecoder reads\n", file.c_str());
+			failed = true;
+			continue;
+		}
+
+		const ImageDescription& description = image.description;
+		const double pixels = static_cast<double>(description.width) * description.height;
+		const char* format = description.format == PixelFormat::R8_UNORM ? "R8" : (description.format == PixelFormat::R16_UNORM ? "R16" :
+			(description.format == PixelFormat::R16G16B16A16_UNORM ? "RGBA16" : "RGBA8"));
+		std::string name = file.size() > 40 ? "..." + file.substr(file.size() - 37) : file;
+		std::string size = std::to_string(description.width) + "x" + std::to_string(description.height);
+		printf("%-40s %11s %8s %12.1f %12.1f %12.1f %8.1f\n", name.c_str(), size.c_str(), format, times[0], times[1], times[2], pixels / 1000.0 / times[2]);
+		for (int t = 0; t < 3; t++)
+			totals[t] += times[t];
+		totalPixels += pixels;
+	}
+
+	if (totals[2] > 0.0)
+	{
+		printf("%-40s %11s %8s %12.1f %12.1f %12.1f %8.1f\n", "Total", "", "", totals[0], totals[1], totals[2], totalPixels / 1000.0 / totals[2]);
+		printf("\nSIMD %.2fx, pool %.2fx over one thread with %u threads%s\n", totals[0] / totals[1], totals[1] / totals[2], pool.GetWorkerCount() + 1,
+			ImageDecoder::IsSimdAvailable() ? "" : ", SIMD is not available in this build");
+	}
+	return failed ? 1 : 0;
+}
+
+int AssetTool::BenchmarkMips(const std::vector<std::string>& args)
+{
+	std::vector<std::string> files = args;
+	if (files.empty())
+	{
+		const std::string atlas = "Resources\\Models\\Dandelion\\Textures\\Atlas";
+		for (const std::string& name : FileHelper::ListFiles(atlas, ".jpg"))
+			files.push_back(atlas + "\\" + name);
+	}
+
+	ThreadPool singleThread(0);
+	ThreadPool& pool = ThreadPool::GetShared();
+	const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos };
+	const char* filterNames[] = { "Box", "Kaiser", "Lanczos" };
+
+	// Returns the chain so the coverage can be measured on it
+	auto measure = [](const ImageData& source, const MipSettings& settings, ThreadPool& threads, ImageData& chain)
+	{
+		chain = source;
+		Timer timer;
+		timer.Start();
+		if (!MipGenerator::Generate(chain, settings, threads))
+			return -1.0;
+		return timer.GetMilisecondsElapsed();
+	};
+
+	printf("%-40s %8s %6s %12s %12s %12s\n", "", "Filter", "Levels", "Scalar ms", "SIMD ms", "Pool ms");
+	bool failed = false;
+	double totals[3] = {};
+	for (const std::string& file : files)
+	{
+		ImageData image;
+		if (!ImageDecoder::DecodeFile(file, image))
+		{
+			printf("Cannot decode %s\n", file.c_str());
+			failed = true;
+			continue;
+		}
+
+		MipSettings settings = MipGenerator::GetSettingsForFile(file);
+		std::string name = file.size() > 40 ? "..." + file.substr(file.size() - 37) : file;
+		ImageData chain;
+		for (int f = 0; f < 3; f++)
+		{
+			settings.filter = filters[f];
+			double times[3];
+			MipGenerator::SetSimdEnabled(false);
+			times[0] = measure(image, settings, singleThread, chain);
+			MipGenerator::SetSimdEnabled(true);
+			times[1] = measure(image, settings, singleThread, chain);
+			times[2] = measure(image, settings, pool, chain);
+			if (times[0] < 0.0 || times[1] < 0.0 || times[2] < 0.0)
+			{
+				printf("%s is not an image MipGenerator can filter\n", file.c_str());
+				failed = true;
+				break;
+			}
+			printf("%-40s %8s %6u %12.1f %12.1f %12.1f\n", f == 0 ? name.c_str() : "", filterNames[f], chain.description.mipLevels, times[0], times[1], times[2]);
+			for (int t = 0; t < 3; t++)
+				totals[t] += times[t];
+		}
+
+		// Alpha tested maps, the fraction of texels passing the test per level with and without preservation
+		if (settings.coverageChannel >= 0 && chain.description.mipLevels > 1)
+		{
+			ImageData plain;
+			MipSettings plainSettings = settings;
+			plainSettings.coverageChannel = -1;
+			measure(image, plainSettings, pool, plain);
+			printf("  Coverage, preserved:");
+			for (uint32_t level = 0; level < chain.description.mipLevels; level++)
+				printf(" %.3f", MipGenerator::MeasureCoverage(chain, level, settings.coverageChannel, settings.coverageReference));
+			printf("\n  Coverage, plain:    ");
+			for (uint32_t level = 0; level < plain.description.mipLevels; level++)
+				printf(" %.3f", MipGenerator::MeasureCoverage(plain, level, settings.coverageChannel, settings.coverageReference));
+			printf("\n");
+		}
+	}
+
+	if (totals[2] > 0.0)
+	{
+		printf("%-40s %8s %6s %12.1f %12.1f %12.1f\n", "Total", "", "", totals[0], totals[1], totals[2]);
+		printf("\nSIMD %.2fx, pool %.2fx over one thread with %u threads%s\n", totals[0] / totals[1], totals[1] / totals[2], pool.GetWorkerCount() + 1,
+			MipGenerator::IsSimdAvailable() ? "" : ", SIMD is not available in this build");
+	}
+	return failed ? 1 : 0;
+}
+
+int AssetTool::BenchmarkBlockCompression(const std::vector<std::string>& args)
+{
+	BlockQuality quality = BlockQuality::Normal;
+	std::vector<std::string> files;
+	for (const std::string& arg : args)
+	{
+		if (arg == "-fast")
+			quality = BlockQuality::Fast;
+		else if (arg == "-normal")
+			quality = BlockQuality::Normal;
+		else if (arg == "-high")
+			quality = BlockQuality::High;
+		else
+			files.push_back(arg);
+	}
+	if (files.empty())
+	{
+		files.push_back("Resources\\Textures\\Catalina.jpg");
+		const std::string atlas = "Resources\\Models\\Dandelion\\Textures\\Atlas";
+		for (const std::string& name : FileHelper::ListFiles(atlas, ".jpg"))
+			files.push_back(atlas + "\\" + name);
+	}
+
+	// Whole mip chains, as Graphics compresses them when loading
+	ThreadPool singleThread(0);
+	ThreadPool& pool = ThreadPool::GetShared();
+	printf("%s quality\n", BlockCompressor::GetQualityName(quality));
+	printf("%-40s %11s %6s %12s %12s %9s %10s %10s\n", "", "Size", "Format", "1 thread ms", "Pool ms", "PSNR dB", "Source MB", "Blocks MB");
+	bool failed = false;
+	double totals[2] = {};
+	uint64_t totalBytes[2] = {};
+	for (const std::string& file : files)
+	{
+		ImageData image;
+		if (!ImageDecoder::DecodeFile(file, image) || !MipGenerator::Generate(image, MipGenerator::GetSettingsForFile(file)))
+		{
+			printf("Cannot decode %s\n", file.c_str());
+			failed = true;
+			continue;
+		}
+
+		const PixelFormat format = BlockCompressor::ChooseFormat(file, image, quality);
+		ImageData compressed;
+		double times[2];
+		ThreadPool* threads[2] = { &singleThread, &pool };
+		bool compressedAll = true;
+		for (int t = 0; t < 2; t++)
+		{
+			Timer timer;
+			timer.Start();
+			compressedAll = compressedAll && BlockCompressor::Compress(image, format, quality, compressed, *threads[t]);
+			times[t] = timer.GetMilisecondsElapsed();
+		}
+		if (!compressedAll)
+		{
+			printf("%s is not an image BlockCompressor takes\n", file.c_str());
+			failed = true;
+			continue;
+		}
+
+		std::string name = file.size() > 40 ? "..." + file.substr(file.size() - 37) : file;
+		std::string size = std::to_string(image.description.width) + "x" + std::to_string(image.description.height);
+		printf("%-40s %11s %6s %12.1f %12.1f %9.2f %10.2f %10.2f\n", name.c_str(), size.c_str(), BlockCompressor::GetFormatName(format), times[0], times[1],
+			BlockCompressor::ComputePsnr(image, compressed, 0), image.pixels.size() / (1024.0 * 1024.0), compressed.pixels.size() / (1024.0 * 1024.0));
+		for (int t = 0; t < 2; t++)
+			totals[t] += times[t];
+		totalBytes[0] += image.pixels.size();
+		totalBytes[1] += compressed.pixels.size();
+	}
+
+	if (totals[1] > 0.0)
+	{
+		printf("%-40s %11s %6s %12.1f %12.1f %9s %10.2f %10.2f\n", "Total", "", "", totals[0], totals[1], "", totalBytes[0] / (1024.0 * 1024.0), totalBytes[1] / (1024.0 * 1024.0));
+		printf("\nPool %.2fx over one thread with %u threads, %.1fx less memory\n", totals[0] / totals[1], pool.GetWorkerCount() + 1,
+			static_cast<double>(totalBytes[0]) / totalBytes[1]);
+	}
+	return failed ? 1 : 0;
+}
+
+int AssetTool::BenchmarkTextureTiers(const std::vector<std::string>& args)
+{
+	TextureCookSettings settings;
+	TextureTierSettings tiers;
+	tiers.tier = TextureTier::Half;
+	std::vector<std::string> files;
+	for (const std::string& arg : args)
+	{
+		if (arg == "-fast")
+			settings.quality = BlockQuality::Fast;
+		else if (arg == "-normal")
+			settings.quality = BlockQuality::Normal;
+		else if (arg == "-high")
+			settings.quality = BlockQuality::High;
+		else if (!tiers.Parse(arg))
+			files.push_back(arg);
+	}
+	if (files.empty())
+	{
+		const std::string atlas = "Resources\\Models\\Dandelion\\Textures\\Atlas";
+		for (const std::string& name : FileHelper::ListFiles(atlas, ".jpg"))
+			files.push_back(atlas + "\\" + name);
+	}
+
+	// What LoadImageDataFromFile does after decoding, once at full resolution and once at the tier of the file: the
+	// downscale (one thread without SIMD, one thread, pool), then the mips and the compression
+	ThreadPool singleThread(0);
+	ThreadPool& pool = ThreadPool::GetShared();
+	printf("Tiers %s, %s settings\n", tiers.GetName().c_str(), settings.GetName().c_str());
+	printf("%-40s %11s %8s %11s %10s %10s %10s %10s %10s %9s %9s\n", "", "Size", "Tier", "Loaded", "Scalar ms", "1 thread", "Pool ms",
+		"Full ms", "Tier ms", "Full MB", "Tier MB");
+	bool failed = false;
+	double totals[3] = {};
+	uint64_t totalBytes[2] = {};
+	for (const std::string& file : files)
+	{
+		ImageData image;
+		if (!ImageDecoder::DecodeFile(file, image))
+		{
+			printf("Cannot decode %s\n", file.c_str());
+			failed = true;
+			continue;
+		}
+
+		const TextureTier tier = tiers.GetTier(file);
+		const MipSettings mipSettings = MipGenerator::GetSettingsForFile(file);
+		ImageData reduced;
+		double downscaleTimes[3];
+		ThreadPool* threads[3] = { &singleThread, &singleThread, &pool };
+		for (int t = 0; t < 3; t++)
+		{
+			MipGenerator::SetSimdEnabled(t > 0);
+			reduced = image;
+			Timer timer;
+			timer.Start();
+			TextureDownscaler::Apply(reduced, static_cast<uint32_t>(tier), mipSettings, *threads[t]);
+			downscaleTimes[t] = timer.GetMilisecondsElapsed();
+		}
+		MipGenerator::SetSimdEnabled(true);
+
+		Timer timer;
+		timer.Start();
+		TextureCooker::Process(image, file, settings, pool);
+		const double fullTime = timer.GetMilisecondsElapsed();
+		timer.Restart();
+		TextureCooker::Process(reduced, file, settings, pool);
+		const double tierTime = timer.GetMilisecondsElapsed() + downscaleTimes[2];
+
+		std::string name = file.size() > 40 ? "..." + file.substr(file.size() - 37) : file;
+		std::string size = std::to_string(image.description.width) + "x" + std::to_string(image.description.height);
+		std::string loaded = std::to_string(reduced.description.width) + "x" + std::to_string(reduced.description.height);
+		printf("%-40s %11s %8s %11s %10.1f %10.1f %10.1f %10.1f %10.1f %9.2f %9.2f\n", name.c_str(), size.c_str(), TextureTierSettings::GetTierName(tier),
+			loaded.c_str(), downscaleTimes[0], downscaleTimes[1], downscaleTimes[2], fullTime, tierTime,
+			image.pixels.size() / (1024.0 * 1024.0), reduced.pixels.size() / (1024.0 * 1024.0));
+		totals[0] += fullTime;
+		totals[1] += tierTime;
+		totals[2] += downscaleTimes[2];
+		totalBytes[0] += image.pixels.size();
+		totalBytes[1] += reduced.pixels.size();
+	}
+
+	if (totals[1] > 0.0)
+	{
+		printf("%-40s %11s %8s %11s %10s %10s %10.1f %10.1f %10.1f %9.2f %9.2f\n", "Total", "", "", "", "", "", totals[2], totals[0], totals[1],
+			totalBytes[0] / (1024.0 * 1024.0), totalBytes[1] / (1024.0 * 1024.0));
+		printf("\nLoading at the tiers is %.1fx faster after decoding and takes %.1fx less memory, with %u threads\n", totals[0] / totals[1],
+			static_cast<double>(totalBytes[0]) / totalBytes[1], pool.GetWorkerCount() + 1);
+	}
+	return failed ? 1 : 0;
+}
+
+int AssetTool::BenchmarkUploadCopy(const std::vector<std::string>& args)
+{
+	// The CPU footprints have to be the ones the device gives, or every upload lands in the wrong place
+	int mismatches = 0;
+	for (const KnownFootprint& known : KnownFootprints)
+	{
+		ImageDescription description;
+		description.width = known.width;
+		description.height = known.height;
+		description.mipLevels = static_cast<uint16_t>(known.mipLevels);
+		description.format = known.format;
+		description.rowPitch = ImageDescription::IsBlockCompressed(known.format) ? (known.width + 3) / 4 * ImageDescription::GetBytesPerBlock(known.format) :
+			known.width * ImageDescription::GetBytesPerPixel(known.format);
+		std::vector<SubresourceFootprint> footprints(known.mipLevels);
+		const uint64_t totalBytes = UploadLayout::ComputeFootprints(description, 0, known.mipLevels, 0, footprints.data());
+		const SubresourceFootprint& footprint = footprints[known.level];
+		if (totalBytes != known.totalBytes || footprint.offset != known.offset || footprint.width != known.footprintWidth || footprint.height != known.footprintHeight ||
+			footprint.rowPitch != known.rowPitch || footprint.rowCount != known.rowCount || footprint.rowSize != known.rowSize)
+		{
+			printf("%s %ux%u level %u: offset %llu, %ux%u, pitch %u, %u rows of %u bytes, %llu in all. GetCopyableFootprints gives %llu, %ux%u, pitch %u, %u rows of %u bytes, %llu in all\n",
+				BlockCompressor::GetFormatName(known.format), known.width, known.height, known.level, static_cast<unsigned long long>(footprint.offset), footprint.width,
+				footprint.height, footprint.rowPitch, footprint.rowCount, footprint.rowSize, static_cast<unsigned long long>(totalBytes), static_cast<unsigned long long>(known.offset),
+				known.footprintWidth, known.footprintHeight, known.rowPitch, known.rowCount, known.rowSize, static_cast<unsigned long long>(known.totalBytes));
+			mismatches++;
+		}
+	}
+	const size_t knownCount = sizeof(KnownFootprints) / sizeof(KnownFootprints[0]);
+	printf("Footprints: %zu of %zu match GetCopyableFootprints\n\n", knownCount - mismatches, knownCount);
+
+	std::vector<std::string> files = args;
+	if (files.empty())
+	{
+		files.push_back("Resources\\Textures\\Catalina.jpg");
+		const std::string atlas = "Resources\\Models\\Dandelion\\Textures\\Atlas";
+		for (const std::string& name : FileHelper::ListFiles(atlas, ".jpg"))
+			files.push_back(atlas + "\\" + name);
+	}
+
+	// Decoding the top level into a packed image and copying it to the upload layout against decoding straight into
+	// the layout, then the copy of the whole mip chain row by row with memcpy, with SSE2 on one thread and on the pool.
+	// Copies run a few times each, the buffers stay the same so the numbers are bandwidth and not page faults
+	ThreadPool singleThread(0);
+	ThreadPool& pool = ThreadPool::GetShared();
+	const int repeats = 5;
+	printf("%-40s %11s %10s %10s %10s %9s %10s %10s %10s\n", "", "Size", "Decode ms", "+ copy ms", "Into ms", "Chain MB", "memcpy", "SIMD GB/s", "Pool GB/s");
+	bool failed = mismatches > 0;
+	double totalTimes[3] = {};
+	uint64_t totalBytes = 0;
+	for (const std::string& file : files)
+	{
+		std::vector<uint8_t> data;
+		ImageDescription description;
+		if (!FileHelper::ReadFile(file, data) || !ImageDecoder::ReadDescription(data.data(), data.size(), description))
+		{
+			printf("Cannot read %s\n", file.c_str());
+			failed = true;
+			continue;
+		}
+		SubresourceFootprint top;
+		std::vector<uint8_t> upload(UploadLayout::ComputeFootprints(description, 0, 1, 0, &top));
+
+		Timer timer;
+		timer.Start();
+		ImageData image;
+		ImageDecoder::Decode(data.data(), data.size(), image, pool);
+		const double decodeTime = timer.GetMilisecondsElapsed();
+		timer.Restart();
+		UploadLayout::CopyLevels(image.description, image.pixels.data(), 0, 1, &top, upload.data(), pool);
+		const double copyTime = timer.GetMilisecondsElapsed();
+
+		std::vector<uint8_t> direct(upload.size());
+		timer.Restart();
+		const bool decoded = ImageDecoder::DecodeInto(data.data(), data.size(), direct.data(), top.rowPitch, pool);
+		const double intoTime = timer.GetMilisecondsElapsed();
+		if (!decoded || direct != upload)
+		{
+			printf("%s decodes differently into the upload layout\n", file.c_str());
+			failed = true;
+			continue;
+		}
+
+		MipGenerator::Generate(image, MipGenerator::GetSettingsForFile(file), pool);
+		const uint32_t levels = image.description.mipLevels;
+		std::vector<SubresourceFootprint> footprints(levels);
+		std::vector<uint8_t> chain(UploadLayout::ComputeFootprints(image.description, 0, levels, 0, footprints.data()));
+		double times[3];
+		ThreadPool* threads[3] = { &singleThread, &singleThread, &pool };
+		for (int t = 0; t < 3; t++)
+		{
+			UploadLayout::SetSimdEnabled(t > 0);
+			UploadLayout::CopyLevels(image.description, image.pixels.data(), 0, levels, footprints.data(), chain.data(), *threads[t]);
+			timer.Restart();
+			for (int r = 0; r < repeats; r++)
+				UploadLayout::CopyLevels(image.description, image.pixels.data(), 0, levels, footprints.data(), chain.data(), *threads[t]);
+			times[t] = timer.GetMilisecondsElapsed() / repeats;
+			totalTimes[t] += times[t];
+		}
+		UploadLayout::SetSimdEnabled(true);
+		totalBytes += image.pixels.size();
+
+		const double gigabytes = image.pixels.size() / (1024.0 * 1024.0 * 1024.0);
+		std::string name = file.size() > 40 ? "..." + file.substr(file.size() - 37) : file;
+		std::string size = std::to_string(description.width) + "x" + std::to_string(description.height);
+		printf("%-40s %11s %10.1f %10.1f %10.1f %9.2f %10.2f %10.2f %10.2f\n", name.c_str(), size.c_str(), decodeTime, copyTime, intoTime,
+			image.pixels.size() / (1024.0 * 1024.0), gigabytes / (times[0] / 1000.0), gigabytes / (times[1] / 1000.0), gigabytes / (times[2] / 1000.0));
+	}
+
+	if (totalTimes[2] > 0.0)
+	{
+		const double gigabytes = totalBytes / (1024.0 * 1024.0 * 1024.0);
+		printf("\nMip chains copy at %.2f GB/s with memcpy, %.2f GB/s with SSE2 and %.2f GB/s on %u threads%s\n", gigabytes / (totalTimes[0] / 1000.0),
+			gigabytes / (totalTimes[1] / 1000.0), gigabytes / (totalTimes[2] / 1000.0), pool.GetWorkerCount() + 1,
+			UploadLayout::IsSimdAvailable() ? "" : ", SIMD is not available in this build");
+	}
+	return failed ? 1 : 0;
+}
+
+int AssetTool::BenchmarkUploadRing(const std::vector<std::string>& args)
+{
+	// The ring against a fake fence. Pages are plain memory with made up GPU addresses, and the fake GPU is between
+	// none and framesInFlight frames behind, a different number every frame. Every allocation is filled with a byte
+	// of its own and checked when the fence passes its frame, memory handed out again too early shows up as the bytes
+	// of a later frame
+	const uint32_t objectsPerFrame = args.size() > 0 ? std::max(1, atoi(args[0].c_str())) : 2000;
+	const uint32_t framesInFlight = args.size() > 1 ? std::max(1, atoi(args[1].c_str())) : 3;
+	const uint32_t frameCount = 1000;
+	const uint64_t pageSize = 64 * 1024;
+	const uint64_t fakeGpuBase = 0x100000000ull;
+	const uint64_t sizes[] = { 64, 64, 128, 256, 1024, 16 * 1024 }; // A matrix most of the time, now and then a skeleton
+	const uint64_t largestSize = 16 * 1024;
+
+	std::vector<std::unique_ptr<uint8_t[]>> pageMemory;
+	UploadRing ring(pageSize, [&pageMemory, fakeGpuBase](uint64_t size, UploadAllocation& page)
+	{
+		pageMemory.emplace_back(new uint8_t[static_cast<size_t>(size)]);
+		page.cpu = pageMemory.back().get();
+		page.gpu = fakeGpuBase + (pageMemory.size() - 1) * size; // Buffers start on 64 KB like D3D12 ones
+		return true;
+	});
+
+	struct Written
+	{
+		UploadAllocation allocation;
+		uint8_t value;
+	};
+	std::deque<std::vector<Written>> inFlight; // Frame completedValue first, frame f signals f + 1
+	uint64_t completedValue = 0;
+	uint32_t misaligned = 0;
+	uint32_t overwritten = 0;
+	uint32_t random = 1;
+	auto nextRandom = [&random]() { random = random * 1664525u + 1013904223u; return random >> 8; };
+	auto check = [&](const std::vector<Written>& frame)
+	{
+		for (const Written& written : frame)
+		{
+			const uint8_t* cpu = written.allocation.cpu;
+			for (uint64_t i = 0; i < written.allocation.size; i++)
+			{
+				if (cpu[i] != written.value)
+				{
+					overwritten++;
+					break;
+				}
+			}
+		}
+	};
+
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		const uint64_t behind = std::min<uint64_t>(nextRandom() % (framesInFlight + 1), frame);
+		for (; completedValue < frame - behind; completedValue++)
+		{
+			check(inFlight.front());
+			inFlight.pop_front();
+		}
+		ring.BeginFrame(completedValue);
+
+		std::vector<Written> written(objectsPerFrame);
+		for (uint32_t i = 0; i < objectsPerFrame; i++)
+		{
+			const uint64_t size = sizes[nextRandom() % (sizeof(sizes) / sizeof(sizes[0]))];
+			UploadAllocation& allocation = written[i].allocation;
+			if (!ring.Allocate(size, allocation))
+				break;
+			// The CPU pointer has to be the GPU address in the same page
+			const uint64_t offset = allocation.gpu - fakeGpuBase;
+			if (allocation.gpu % UploadRing::DefaultAlignment != 0 || allocation.cpu != pageMemory[static_cast<size_t>(offset / pageSize)].get() + offset % pageSize)
+				misaligned++;
+			written[i].value = static_cast<uint8_t>(frame * 31 + i);
+			memset(allocation.cpu, written[i].value, static_cast<size_t>(size));
+		}
+		inFlight.push_back(std::move(written));
+		ring.EndFrame(frame + 1);
+	}
+	for (const std::vector<Written>& frame : inFlight)
+		check(frame);
+
+	UploadAllocation tooLarge;
+	const bool rejectsLarge = !ring.Allocate(pageSize + 1, tooLarge);
+	const UploadRing::Statistics statistics = ring.GetStatistics();
+	// Pages at least this full before the next one is started, then a frame's worth for every frame in flight and the one recording
+	const uint64_t pagesPerFrame = (statistics.peakFrameBytes + pageSize - largestSize - 1) / (pageSize - largestSize) + 1;
+	const uint64_t pageLimit = pagesPerFrame * (framesInFlight + 1);
+	printf("Fake fence, %u frames of %u objects, up to %u frames behind: %u pages of %llu KB (%.2f MB), %.1f KB peak a frame\n", frameCount, objectsPerFrame,
+		framesInFlight, statistics.pageCount, static_cast<unsigned long long>(pageSize / 1024), statistics.pageCount * pageSize / (1024.0 * 1024.0), statistics.peakFrameBytes / 1024.0);
+	printf("%u misaligned, %u overwritten before the fence passed them, %u failed allocations, %s, %u pages at most\n", misaligned, overwritten,
+		statistics.failedAllocations - (rejectsLarge ? 1 : 0), rejectsLarge ? "more than a page is rejected" : "more than a page is NOT rejected", static_cast<uint32_t>(pageLimit));
+	const bool failed = misaligned > 0 || overwritten > 0 || statistics.failedAllocations != 1 || !rejectsLarge || statistics.pageCount > pageLimit;
+
+	// Throughput with the fence keeping up, one matrix per object like the engine's per object constants
+	UploadRing fastRing(pageSize, [&pageMemory](uint64_t size, UploadAllocation& page)
+	{
+		pageMemory.emplace_back(new uint8_t[static_cast<size_t>(size)]);
+		page.cpu = pageMemory.back().get();
+		page.gpu = reinterpret_cast<uintptr_t>(page.cpu);
+		return true;
+	});
+	XMFLOAT4X4 matrix;
+	XMStoreFloat4x4(&matrix, XMMatrixIdentity());
+	Timer timer;
+	timer.Start();
+	uint64_t allocations = 0;
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		fastRing.BeginFrame(frame >= framesInFlight ? frame - framesInFlight + 1 : 0);
+		for (uint32_t i = 0; i < objectsPerFrame; i++)
+		{
+			UploadAllocation allocation;
+			if (fastRing.Allocate(sizeof(matrix), allocation))
+			{
+				memcpy(allocation.cpu, &matrix, sizeof(matrix));
+				allocations++;
+			}
+		}
+		fastRing.EndFrame(frame + 1);
+	}
+	const double seconds = timer.GetMilisecondsElapsed() / 1000.0;
+	printf("\n%.1f M allocations/s of %zu byte constants, %.1f ns each, %u pages. The fixed 64 KB heap per frame held %llu objects\n",
+		allocations / seconds / 1e6, sizeof(matrix), seconds * 1e9 / std::max<uint64_t>(allocations, 1), fastRing.GetStatistics().pageCount,
+		static_cast<unsigned long long>(pageSize / UploadRing::DefaultAlignment));
+	return failed ? 1 : 0;
+}
+
+int AssetTool::CookTextures(const std::vector<std::string>& args)
+{
+	TextureCookSettings settings;
+	bool force = false;
+	std::vector<std::string> inputs;
+	for (const std::string& arg : args)
+	{
+		if (arg == "-fast")
+			settings.quality = BlockQuality::Fast;
+		else if (arg == "-normal")
+			settings.quality = BlockQuality::Normal;
+		else if (arg == "-high")
+			settings.quality = BlockQuality::High;
+		else if (arg == "-nocompress")
+			settings.compress = false;
+		else if (arg == "-force")
+			force = true;
+		else
+			inputs.push_back(arg);
+	}
+	if (inputs.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// Images by directory, every directory gets its own manifest
+	std::map<std::string, std::vector<std::string>> directories;
+	for (const std::string& input : inputs)
+	{
+		const std::string extension = StringHelper::GetFileExtension(input);
+		if (extension == "jpg" || extension == "jpeg" || extension == "png")
+		{
+			directories[StringHelper::GetDirectoryFromPath(input)].push_back(input.substr(input.find_last_of("\\/") + 1));
+			continue;
+		}
+		for (const char* imageExtension : { ".jpg", ".jpeg", ".png" })
+		{
+			for (const std::string& name : FileHelper::ListFiles(input, imageExtension))
+				directories[input].push_back(name);
+		}
+	}
+
+	ThreadPool& pool = ThreadPool::GetShared();
+	printf("%s settings\n", settings.GetName().c_str());
+	printf("%-40s %11s %6s %6s %10s %10s %10s %12s\n", "", "Size", "Format", "Levels", "Cook ms", "Source MB", "DDS MB", "DDS load ms");
+	int failed = 0;
+	int skipped = 0;
+	for (const auto& directory : directories)
+	{
+		const std::string manifestPath = directory.first.empty() ? TextureManifest::FileName : directory.first + "\\" + TextureManifest::FileName;
+		TextureManifest manifest;
+		if (!manifest.Read(manifestPath))
+			printf("%s cannot be read, every texture in it is cooked again\n", manifestPath.c_str());
+
+		for (const std::string& name : directory.second)
+		{
+			const std::string sourcePath = directory.first.empty() ? name : directory.first + "\\" + name;
+			uint64_t sourceHash;
+			if (!ContentHash::HashFile(sourcePath, sourceHash))
+			{
+				printf("Cannot read %s\n", sourcePath.c_str());
+				failed++;
+				continue;
+			}
+			const CookedTexture* existing = manifest.Find(name);
+			if (!force && existing != nullptr && TextureCooker::IsUpToDate(*existing, directory.first, sourceHash, settings))
+			{
+				skipped++;
+				continue;
+			}
+
+			CookedTexture texture;
+			texture.source = name;
+			texture.cooked = Dds::GetCookedPath(name);
+			texture.sourceHash = sourceHash;
+			texture.settings = settings.GetName();
+			const std::string cookedPath = Dds::GetCookedPath(sourcePath);
+
+			Timer timer;
+			timer.Start();
+			if (!TextureCooker::Cook(sourcePath, cookedPath, settings, pool, texture.description))
+			{
+				printf("Failed to cook %s\n", sourcePath.c_str());
+				failed++;
+				continue;
+			}
+			double cookTime = timer.GetMilisecondsElapsed();
+			manifest.Set(texture);
+
+			// What the runtime does with the file: map it and copy the levels into the upload layout
+			timer.Restart();
+			DdsFile cookedFile;
+			if (!cookedFile.Open(cookedPath))
+			{
+				printf("Cannot read back %s\n", cookedPath.c_str());
+				failed++;
+				continue;
+			}
+			const ImageDescription& cookedDescription = cookedFile.GetDescription();
+			std::vector<SubresourceFootprint> footprints(cookedDescription.mipLevels);
+			std::vector<uint8_t> upload(UploadLayout::ComputeFootprints(cookedDescription, 0, cookedDescription.mipLevels, 0, footprints.data()));
+			UploadLayout::CopyLevels(cookedDescription, cookedFile.GetLevelData(0), 0, cookedDescription.mipLevels, footprints.data(), upload.data(), pool);
+			double loadTime = timer.GetMilisecondsElapsed();
+
+			std::string shortName = sourcePath.size() > 40 ? "..." + sourcePath.substr(sourcePath.size() - 37) : sourcePath;
+			std::string size = std::to_string(texture.description.width) + "x" + std::to_string(texture.description.height);
+			printf("%-40s %11s %6s %6u %10.1f %10.2f %10.2f %12.2f\n", shortName.c_str(), size.c_str(), BlockCompressor::GetFormatName(texture.description.format),
+				static_cast<uint32_t>(texture.description.mipLevels), cookTime, FileHelper::GetFileSize(sourcePath) / (1024.0 * 1024.0), FileHelper::GetFileSize(cookedPath) / (1024.0 * 1024.0), loadTime);
+		}
+
+		if (!manifest.Write(manifestPath))
+		{
+			printf("Failed to write %s\n", manifestPath.c_str());
+			failed++;
+		}
+	}
+	if (skipped > 0)
+		printf("%d textures up to date, -force cooks them again\n", skipped);
+	return failed > 0 ? 1 : 0;
+}
+
+int AssetTool::PackChannels(const std::vector<std::string>& args)
+{
+	TextureCookSettings settings;
+	bool force = false;
+	std::string rulesPath = "Resources\\ChannelPacking.json";
+	std::vector<std::string> directories;
+	for (const std::string& arg : args)
+	{
+		if (arg == "-fast")
+			settings.quality = BlockQuality::Fast;
+		else if (arg == "-normal")
+			settings.quality = BlockQuality::Normal;
+		else if (arg == "-high")
+			settings.quality = BlockQuality::High;
+		else if (arg == "-nocompress")
+			settings.compress = false;
+		else if (arg == "-force")
+			force = true;
+		else if (StringHelper::GetFileExtension(arg) == "json")
+			rulesPath = arg;
+		else
+			directories.push_back(arg);
+	}
+	if (directories.empty())
+		directories.push_back("Resources\\Models\\Dandelion\\Textures\\Atlas");
+
+	ChannelPackingRules rules;
+	if (!rules.Read(rulesPath))
+	{
+		printf("Cannot read the rules in %s\n", rulesPath.c_str());
+		return 1;
+	}
+
+	// The swizzles only depend on the rules, so the shader header goes next to them
+	const std::string headerPath = rulesPath.substr(0, rulesPath.find_last_of('.')) + ".hlsli";
+	if (!ChannelPacker::WriteShaderHeader(headerPath, rules, rulesPath))
+	{
+		printf("Failed to write %s\n", headerPath.c_str());
+		return 1;
+	}
+	printf("%zu rules from %s, swizzles in %s, %s settings\n", rules.rules.size(), rulesPath.c_str(), headerPath.c_str(), settings.GetName().c_str());
+	printf("%-28s %-40s %11s %6s %10s %12s %10s %8s\n", "Texture", "Maps", "Size", "Format", "Cook ms", "Separate MB", "Packed MB", "Fetches");
+
+	ThreadPool& pool = ThreadPool::GetShared();
+	int failed = 0;
+	int skipped = 0;
+	for (const std::string& directory : directories)
+	{
+		for (const ChannelPackingRule& rule : rules.rules)
+		{
+			std::vector<ChannelPackingGroup> groups;
+			ChannelPacker::FindGroups(directory, rule, groups);
+			for (const ChannelPackingGroup& group : groups)
+			{
+				const std::string packedPath = directory + "\\" + group.GetPackedName(rule);
+				const std::string texturePath = packedPath + "." + Dds::Extension;
+				PackedTextureLayout layout;
+				uint64_t sourceHash;
+				if (!force && layout.Read(packedPath + "." + PackedTextureLayout::Extension) && FileHelper::FileExists(texturePath) &&
+					ChannelPacker::HashGroup(group, rule, settings, sourceHash) && sourceHash == layout.sourceHash)
+				{
+					skipped++;
+					continue;
+				}
+
+				Timer timer;
+				timer.Start();
+				if (!ChannelPacker::Cook(group, rule, settings, pool, layout))
+				{
+					printf("Failed to pack %s, the maps have to decode and be the same size\n", packedPath.c_str());
+					failed++;
+					continue;
+				}
+				double cookTime = timer.GetMilisecondsElapsed();
+
+				// What the maps would take loaded one by one the way LoadImageDataFromFile does without compression,
+				// each a whole RGBA8 texture with mips
+				DdsFile packedFile;
+				if (!packedFile.Open(texturePath))
+				{
+					printf("Cannot read back %s\n", texturePath.c_str());
+					failed++;
+					continue;
+				}
+				ImageDescription separate = packedFile.GetDescription();
+				separate.format = PixelFormat::R8G8B8A8_UNORM;
+				separate.rowPitch = separate.width * 4;
+
+				std::string maps;
+				for (int c = 0; c < 4; c++)
+				{
+					if (!layout.maps[c].empty())
+						maps += (maps.empty() ? "" : " ") + std::string(PackedTextureLayout::GetSwizzle(c) + 1) + "=" + layout.maps[c];
+				}
+				std::string size = std::to_string(separate.width) + "x" + std::to_string(separate.height);
+				std::string fetches = std::to_string(group.mapCount) + " -> 1";
+				printf("%-28s %-40s %11s %6s %10.1f %12.2f %10.2f %8s\n", group.GetPackedName(rule).c_str(), maps.c_str(), size.c_str(),
+					BlockCompressor::GetFormatName(layout.format), cookTime, group.mapCount * separate.GetSize() / (1024.0 * 1024.0),
+					FileHelper::GetFileSize(texturePath) / (1024.0 * 1024.0), fetches.c_str());
+			}
+		}
+	}
+	if (skipped > 0)
+		printf("%d packed textures up to date, -force packs them again\n", skipped);
+	return failed > 0 ? 1 : 0;
+}
+
+int AssetTool::SimulateTextureStreaming(const std::vector<std::string>& args)
+{
+	// A walk through patches of plant clumps, one patch per variant, each variant with the five 4K maps of the
+	// Dandelion atlas as BC7 with mips. The camera walks past every patch and back, so the way back finds the first
+	// patches evicted and has to stream them in again. Loads run inline, the same run gives the same numbers every time
+	const uint64_t budgetMB = args.size() > 0 ? std::max(1, atoi(args[0].c_str())) : 128;
+	const int variants = args.size() > 1 ? std::max(1, atoi(args[1].c_str())) : 3;
+	const char* const maps[] = { "Albedo", "Normal", "Opacity", "Roughness", "Translucency" };
+	const int mapCount = sizeof(maps) / sizeof(maps[0]);
+	const float patchLength = 40.0f;
+	const float patchSpacing = 100.0f;
+	const float plantSize = 2.0f; // A clump across, the atlas covers it once
+	const int framesPerWay = static_cast<int>(variants * patchSpacing);
+
+	ImageDescription description;
+	description.width = 4096;
+	description.height = 4096;
+	description.format = PixelFormat::BC7_UNORM;
+	description.mipLevels = static_cast<uint16_t>(MipGenerator::GetLevelCount(description.width, description.height));
+	description.rowPitch = description.width / 4 * ImageDescription::GetBytesPerBlock(description.format);
+
+	TextureResidency::Settings settings;
+	settings.budgetBytes = budgetMB * 1024 * 1024;
+	ThreadPool singleThread(0);
+	TextureResidency residency(settings, [&description](TextureResidency::TextureId, uint32_t level, std::vector<uint8_t>& data)
+	{
+		data.assign(static_cast<size_t>(description.GetLevelSize(level)), 0);
+		return true;
+	}, singleThread);
+
+	std::vector<TextureResidency::TextureId> textures;
+	for (int i = 0; i < variants * mapCount; i++)
+		textures.push_back(residency.Add(description));
+
+	// Clumps every two units in a patch 8 wide, the camera walks down the middle at knee height looking ahead
+	struct Plant
+	{
+		float x, z;
+		int variant;
+	};
+	std::vector<Plant> plants;
+	for (int variant = 0; variant < variants; variant++)
+	{
+		for (float z = 0.0f; z < patchLength; z += 2.0f)
+		{
+			for (float x = -4.0f; x <= 4.0f; x += 2.0f)
+				plants.push_back({ x, variant * patchSpacing + z, variant });
+		}
+	}
+
+	const double megabyte = 1024.0 * 1024.0;
+	printf("%d variants x %d maps of %ux%u %s, %.1f MB with every level, %.1f MB for the tails, budget %llu MB\n", variants, mapCount,
+		description.width, description.height, BlockCompressor::GetFormatName(description.format),
+		textures.size() * description.GetSize() / megabyte, residency.GetStatistics().residentBytes / megabyte, static_cast<unsigned long long>(budgetMB));
+	printf("%6s %8s %8s %12s %10s %8s %8s %8s\n", "Frame", "Camera z", "Visible", "Resident MB", "Wanted MB", "Missing", "Loads", "Evicted");
+
+	StreamingView view;
+	const float halfFieldOfView = view.verticalFieldOfView * 0.5f * 16.0f / 9.0f;
+	const float drawDistance = 60.0f;
+	std::vector<TextureResidency::Change> changes;
+	uint64_t peakResident = 0;
+	int framesMissing = 0;
+	Timer timer;
+	timer.Start();
+	for (int frame = 0; frame < framesPerWay * 2; frame++)
+	{
+		const bool forward = frame < framesPerWay;
+		const float cameraZ = forward ? frame - 20.0f : 2.0f * framesPerWay - frame - 20.0f;
+		const float direction = forward ? 1.0f : -1.0f;
+		for (const Plant& plant : plants)
+		{
+			const float ahead = (plant.z - cameraZ) * direction;
+			const float distance = sqrtf(plant.x * plant.x + ahead * ahead + 0.5f * 0.5f);
+			if (ahead <= 0.0f || distance > drawDistance || fabsf(plant.x) > ahead * tanf(halfFieldOfView))
+				continue;
+			for (int map = 0; map < mapCount; map++)
+			{
+				TextureResidency::TextureId texture = textures[plant.variant * mapCount + map];
+				residency.Touch(texture, TextureResidency::GetDesiredLevel(description, distance, plantSize, view));
+			}
+		}
+		residency.Update(changes);
+
+		TextureResidency::Statistics statistics = residency.GetStatistics();
+		peakResident = std::max(peakResident, statistics.residentBytes);
+		if (statistics.missingLevels > 0)
+			framesMissing++;
+		if (frame % 25 == 0 || frame == framesPerWay * 2 - 1)
+		{
+			printf("%6d %8.1f %8u %12.1f %10.1f %8u %8u %8u\n", frame, cameraZ, statistics.visibleCount, statistics.residentBytes / megabyte,
+				statistics.wantedBytes / megabyte, statistics.missingLevels, statistics.loadsCompleted, statistics.levelsEvicted);
+		}
+	}
+	double simulationTime = timer.GetMilisecondsElapsed();
+
+	TextureResidency::Statistics statistics = residency.GetStatistics();
+	printf("Peak %.1f MB resident, %.1f MB loaded in %u loads, %.1f MB evicted in %u levels, %u failed, %u discarded\n",
+		peakResident / megabyte, statistics.bytesLoaded / megabyte, statistics.loadsCompleted, statistics.bytesEvicted / megabyte,
+		statistics.levelsEvicted, statistics.loadsFailed, statistics.loadsDiscarded);
+	printf("%d of %d frames drew a texture below the level it wanted, %u updates held back by the budget, %.3f ms per frame with the loads\n",
+		framesMissing, framesPerWay * 2, statistics.budgetLimitedUpdates, simulationTime / (framesPerWay * 2));
+	return 0;
+}
+
+int AssetTool::BenchmarkVirtualTexture(const std::vector<std::string>& args)
+{
+	TextureCookSettings settings;
+	uint32_t pageSize = 128;
+	std::vector<std::string> inputs;
+	for (const std::string& arg : args)
+	{
+		if (arg == "-fast")
+			settings.quality = BlockQuality::Fast;
+		else if (arg == "-normal")
+			settings.quality = BlockQuality::Normal;
+		else if (arg == "-high")
+			settings.quality = BlockQuality::High;
+		else if (!arg.empty() && isdigit(static_cast<unsigned char>(arg[0])))
+			pageSize = static_cast<uint32_t>(std::max(4, atoi(arg.c_str())));
+		else
+			inputs.push_back(arg);
+	}
+	if (inputs.empty())
+	{
+		for (const char* map : { "Albedo", "Normal", "Opacity", "Roughness", "Translucency" })
+			inputs.push_back(std::string("Resources\\Models\\Dandelion\\Textures\\Atlas\\qlCc6_4K_") + map + ".jpg");
+	}
+
+	// Page files next to the inputs, from the cooked DDS when it is up to date so nothing is compressed twice
+	ThreadPool& pool = ThreadPool::GetShared();
+	const uint32_t border = 4;
+	printf("%u texel pages with a %u texel border, %s settings\n", pageSize, border, settings.GetName().c_str());
+	printf("%-40s %11s %6s %6s %6s %8s %10s %10s %9s\n", "", "Size", "Format", "Levels", "Pages", "Page KB", "Write ms", "File MB", "Overhead");
+	std::string benchmarkPath;
+	int failed = 0;
+	for (const std::string& input : inputs)
+	{
+		ImageData image;
+		const std::string cookedPath = StringHelper::GetFileExtension(input) == Dds::Extension ? input : Dds::GetCookedPath(input);
+		DdsFile cookedFile;
+		if (FileHelper::FileExists(cookedPath) && (cookedPath == input || FileHelper::IsFileNewer(cookedPath, input)) && cookedFile.Open(cookedPath))
+		{
+			cookedFile.ToImageData(image);
+		}
+		else
+		{
+			std::vector<uint8_t> data;
+			if (!FileHelper::ReadFile(input, data) || !ImageDecoder::Decode(data.data(), data.size(), image, pool))
+			{
+				printf("Cannot read %s\n", input.c_str());
+				failed++;
+				continue;
+			}
+			TextureCooker::Process(image, input, settings, pool);
+		}
+
+		const std::string pagePath = input.substr(0, input.find_last_of('.')) + "." + VirtualTextureFormat::Extension;
+		Timer timer;
+		timer.Start();
+		if (!VirtualTextureFile::Write(pagePath, image, pageSize, border, pool))
+		{
+			printf("Cannot page %s, it needs mips down to one page\n", input.c_str());
+			failed++;
+			continue;
+		}
+		double writeTime = timer.GetMilisecondsElapsed();
+
+		// Every page read back has to be the page cut from the image
+		VirtualTextureFile file;
+		if (!file.Open(pagePath))
+		{
+			printf("Cannot read back %s\n", pagePath.c_str());
+			failed++;
+			continue;
+		}
+		const VirtualTextureLayout& layout = file.GetLayout();
+		std::vector<uint8_t> page(layout.GetPageBytes());
+		bool matches = true;
+		for (uint32_t index = 0; index < layout.GetPageCount() && matches; index++)
+		{
+			VirtualTextureFile::CopyPage(image, layout, layout.GetPageId(index), page.data());
+			matches = memcmp(page.data(), file.GetPageData(index), page.size()) == 0;
+		}
+		if (!matches)
+		{
+			printf("%s does not read back the pages written\n", pagePath.c_str());
+			failed++;
+			continue;
+		}
+
+		std::string name = input.size() > 40 ? "..." + input.substr(input.size() - 37) : input;
+		std::string size = std::to_string(layout.width) + "x" + std::to_string(layout.height);
+		const uint64_t fileSize = FileHelper::GetFileSize(pagePath);
+		printf("%-40s %11s %6s %6u %6u %8.1f %10.1f %10.2f %8.1f%%\n", name.c_str(), size.c_str(), BlockCompressor::GetFormatName(layout.format),
+			layout.levelCount, layout.GetPageCount(), layout.GetPageBytes() / 1024.0, writeTime, fileSize / (1024.0 * 1024.0),
+			(static_cast<double>(fileSize) / image.description.GetSize() - 1.0) * 100.0);
+		if (benchmarkPath.empty())
+			benchmarkPath = pagePath;
+	}
+	if (benchmarkPath.empty())
+		return 1;
+
+	// A walk over a ground plane tiled with the first texture every 8 units, the page table and a 16x16 slot cache
+	// fed from the synthetic feedback of every frame. Loads finish within the frame, up to 32 of them
+	VirtualTextureFile file;
+	file.Open(benchmarkPath);
+	const VirtualTextureLayout& layout = file.GetLayout();
+	VirtualPageTable table(layout, 16, 16);
+	VirtualTextureFeedback analyzer(layout);
+	std::vector<uint8_t> cache(static_cast<size_t>(table.GetSlotCount()) * layout.GetPageBytes());
+	const uint32_t feedbackWidth = 240;
+	const uint32_t feedbackHeight = 135;
+	const int frames = 600;
+	const size_t maxUploads = 32;
+
+	printf("\nFeedback %ux%u over %s, %u slots of %u pages\n", feedbackWidth, feedbackHeight, benchmarkPath.c_str(), table.GetSlotCount(), layout.GetPageCount());
+	printf("%6s %9s %7s %7s %9s %8s\n", "Frame", "Requests", "Loads", "Evicted", "Resident", "Exact %");
+	std::vector<uint32_t> feedback;
+	std::vector<VirtualPageRequest> requests;
+	ImageData indirection;
+	double analyzeTime = 0.0;
+	double uploadTime = 0.0;
+	double indirectionTime = 0.0;
+	size_t totalRequests = 0;
+	size_t totalLoads = 0;
+	size_t totalEvicted = 0;
+	double exactSum = 0.0;
+	Timer timer;
+	for (int frame = 1; frame <= frames; frame++)
+	{
+		FillGroundFeedback(layout, feedbackWidth, feedbackHeight, 3.0f * sinf(frame * 0.01f), frame * 0.05f, 8.0f, feedback);
+
+		timer.Start();
+		analyzer.Analyze(feedback.data(), feedback.size(), frame, table, requests, maxUploads);
+		analyzeTime += timer.GetMilisecondsElapsed();
+		totalRequests += requests.size();
+
+		// Pixels whose page was there at the level they asked for, before this frame's loads
+		size_t sampled = 0;
+		size_t exact = 0;
+		for (uint32_t id : feedback)
+		{
+			if (id == VirtualPage::None)
+				continue;
+			sampled++;
+			if (table.IsResident(layout.GetPageIndex(id)))
+				exact++;
+		}
+		const double exactPercent = sampled > 0 ? exact * 100.0 / sampled : 100.0;
+		exactSum += exactPercent;
+
+		timer.Restart();
+		size_t loads = 0;
+		size_t evictions = 0;
+		for (const VirtualPageRequest& request : requests)
+		{
+			uint32_t slot, evicted;
+			if (!table.BeginLoad(request.index, frame, slot, evicted))
+				break;
+			memcpy(cache.data() + static_cast<size_t>(slot) * layout.GetPageBytes(), file.GetPageData(request.index), layout.GetPageBytes());
+			table.EndLoad(request.index, true);
+			loads++;
+			if (evicted != VirtualPageTable::NoSlot)
+				evictions++;
+		}
+		uploadTime += timer.GetMilisecondsElapsed();
+		totalLoads += loads;
+		totalEvicted += evictions;
+
+		timer.Restart();
+		table.BuildIndirection(indirection);
+		indirectionTime += timer.GetMilisecondsElapsed();
+
+		if (frame == 1 || frame % 50 == 0)
+			printf("%6d %9zu %7zu %7zu %9u %7.1f%%\n", frame, requests.size(), loads, evictions, table.GetResidentCount(), exactPercent);
+	}
+
+	// The same number of ids with no runs of the same page, the worst case for the analyzer
+	std::vector<uint32_t> scattered(feedback.size());
+	uint32_t seed = 12345;
+	for (uint32_t& id : scattered)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		id = layout.GetPageId(seed % layout.GetPageCount());
+	}
+	timer.Start();
+	for (int frame = 0; frame < frames; frame++)
+		analyzer.Analyze(scattered.data(), scattered.size(), frames + frame, table, requests, maxUploads);
+	double scatteredTime = timer.GetMilisecondsElapsed();
+
+	const double pixels = static_cast<double>(feedback.size()) * frames;
+	printf("Analyze %.3f ms per frame (%.1f Mpixels/s), %.1f Mpixels/s with no two neighbours on the same page\n",
+		analyzeTime / frames, pixels / (analyzeTime * 1000.0), pixels / (scatteredTime * 1000.0));
+	printf("%.1f requests and %.1f loads per frame, %zu evictions, page copies %.3f ms and indirection %.3f ms per frame\n",
+		static_cast<double>(totalRequests) / frames, static_cast<double>(totalLoads) / frames, totalEvicted, uploadTime / frames, indirectionTime / frames);
+	printf("%.1f%% of the pixels had their exact page on average\n", exactSum / frames);
+	return failed > 0 ? 1 : 0;
+}
+
+void AssetTool::PrintUsage()
+{
+	printf("Usage:\n");
+	printf("  Engine.exe -cook <source model> [<output .%s>]\n", CookedMesh::Extension);
+	printf("  Engine.exe -benchload [<source model>...]\n");
+	printf("  Engine.exe -benchimport [<source model>...]\n");
+	printf("  Engine.exe -vcache [<source model>...]\n");
+	printf("  Engine.exe -weld [<source model>...]\n");
+	printf("  Engine.exe -indices [<source model>...]\n");
+	printf("  Engine.exe -checkindices [<source model>...]\n");
+	printf("  Engine.exe -vcompress [<source model>...]\n");
+	printf("  Engine.exe -meshlets [<source model>...]\n");
+	printf("  Engine.exe -lods [<LOD0 source model>...]\n");
+	printf("  Engine.exe -benchddc [<source model>...]\n");
+	printf("  Engine.exe -tangents [<source model>...]\n");
+	printf("  Engine.exe -pak <folder> [<output .%s>]\n", Pak::Extension);
+	printf("  Engine.exe -benchpak [<.%s>]\n", Pak::Extension);
+	printf("  Engine.exe -megascans [<manifest or folder>...]\n");
+	printf("  Engine.exe -benchjson [<folder>] [<corpus size>]\n");
+	printf("  Engine.exe -benchimage [<image>...]\n");
+	printf("  Engine.exe -mips [<image>...]\n");
+	printf("  Engine.exe -texcompress [-fast|-normal|-high] [<image>...]\n");
+	printf("  Engine.exe -cooktextures [-fast|-normal|-high] [-nocompress] [-force] <image or folder>...\n");
+	printf("  Engine.exe -packchannels [-fast|-normal|-high] [-nocompress] [-force] [<rules .json>] [<folder>...]\n");
+	printf("  Engine.exe -streamtextures [<budget MB>] [<variants>]\n");
+	printf("  Engine.exe -vtex [-fast|-normal|-high] [<page size>] [<image or .dds>...]\n");
+	printf("  Engine.exe -texturetier [-fast|-normal|-high] [<tiers>] [<image>...]\n");
+	printf("  Engine.exe -uploadcopy [<image>...]\n");
+	printf("  Engine.exe -uploadring [<objects per frame>] [<frames in flight>]\n");
+}
+
+std::vector<std::string> AssetTool::GetDandelionSet()
+{
+	std::vector<std::string> files;
+	for (int variation = 1; variation <= 3; variation++)
+	{
+		for (int lod = 0; lod <= 3; lod++)
+		{
+			std::string name = "Var" + std::to_string(variation);
+			files.push_back("Resources\\Models\\Dandelion\\" + name + "\\" + name + "_LOD" + std::to_string(lod) + ".fbx");
+		}
+	}
+	return files;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Headless asset commands that run instead of the engine when Engine.exe is started with one of them.
+// Output goes to the console the exe was started from.
+//
+//   Engine.exe -cook <source model> [<output .iemesh>]
+//   Engine.exe -benchload [<source model>...]       Assimp vs cooked load times, defaults to the Dandelion set
+//   Engine.exe -benchimport [<source model>...]     Mesh conversion scaling from 1 to N threads
+//   Engine.exe -vcache [<source model>...]          Per mesh ACMR/ATVR before and after vertex cache optimization
+//   Engine.exe -weld [<source model>...]            Per mesh vertex reduction and timing of exact and epsilon welding
+//   Engine.exe -indices [<source model>...]         Index buffer memory with 32 bit, automatic 16 bit and split meshes
+//   Engine.exe -checkindices [<source model>...]    Writes every index buffer the way IndexBuffer uploads it and reads it back
+//   Engine.exe -vcompress [<source model>...]       Packed vertex format error against the float source and encode speed
+//   Engine.exe -meshlets [<source model>...]        Meshlet statistics and build throughput, defaults to the Dandelion LOD0s
+//   Engine.exe -lods [<LOD0 source model>...]       Generated LODs against the hand made _LOD1-3 files, triangle counts and distance to LOD0
+//   Engine.exe -benchddc [<source model>...]        Import times with and without the DerivedDataCache, and corruption detection
+//   Engine.exe -tangents [<source model>...]        Tangent generation, SIMD against the scalar reference, mirrored UV splits
+//   Engine.exe -pak <folder> [<output .iepak>]      Packs every file below folder into one archive, see Assets/PakArchive.h
+//   Engine.exe -benchpak [<.iepak>]                 Dandelion set read and load times, loose files against the archive
+//   Engine.exe -megascans [<manifest or folder>...] Materials resolved from Megascans manifests, defaults to Resources
+//   Engine.exe -benchjson [<folder>] [<corpus size>] Manifest tokenize and parse throughput over a corpus built from the manifests in folder
+//   Engine.exe -benchimage [<image>...]             JPEG/PNG decode times, scalar, SIMD and pooled, defaults to Catalina.jpg and the Dandelion 4K atlas
+//   Engine.exe -mips [<image>...]                   Mip chain times per filter, scalar, SIMD and pooled, and alpha coverage per level
+//   Engine.exe -texcompress [-fast|-normal|-high] [<image>...] Block compression of whole mip chains, format, time, PSNR and memory
+//   Engine.exe -cooktextures [-fast|-normal|-high] [-nocompress] [-force] <image or folder>...
+//                                                   Mip mapped, block compressed DDS next to each image and a manifest per folder
+//   Engine.exe -packchannels [-fast|-normal|-high] [-nocompress] [-force] [<rules .json>] [<folder>...]
+//                                                   Merges single channel maps into one texture per Resources\ChannelPacking.json rule
+//   Engine.exe -streamtextures [<budget MB>] [<variants>] Texture residency over a simulated walk through the plants, headless
+//   Engine.exe -vtex [-fast|-normal|-high] [<page size>] [<image or .dds>...]
+//                                                   Virtual texture page files, then page table and feedback analysis on synthetic feedback
+//   Engine.exe -texturetier [-fast|-normal|-high] [<tiers>] [<image>...]
+//                                                   Load time downscaling to a texture tier ("half" by default), against loading at full resolution
+//   Engine.exe -uploadcopy [<image>...]             Upload footprints against known GetCopyableFootprints values, then copies into them in GB/s
+//   Engine.exe -uploadring [<objects per frame>] [<frames in flight>]
+//                                                   Per frame constant ring against a fake fence, memory reuse checked, then allocations/s
+class AssetTool
+{
+public:
+	static std::vector<std::string> GetCommandLineArguments();
+
+	// Returns false if args does not contain a tool command, in which case the engine should start as usual
+	static bool Run(const std::vector<std::string>& args, int& exitCode);
+
+private:
+	static int Cook(const std::vector<std::string>& args);
+	static int BenchmarkLoad(const std::vector<std::string>& args);
+	static int BenchmarkImport(const std::vector<std::string>& args);
+	static int AnalyzeVertexCache(const std::vector<std::string>& args);
+	static int AnalyzeWelding(const std::vector<std::string>& args);
+	static int ReportIndexMemory(const std::vector<std::string>& args);
+	static int CheckIndexBuffers(const std::vector<std::string>& args);
+	static int AnalyzeVertexCompression(const std::vector<std::string>& args);
+	static int BenchmarkMeshlets(const std::vector<std::string>& args);
+	static int CompareLods(const std::vector<std::string>& args);
+	static int BenchmarkDerivedDataCache(const std::vector<std::string>& args);
+	static int BenchmarkTangents(const std::vector<std::string>& args);
+	static int Pack(const std::vector<std::string>& args);
+	static int BenchmarkPak(const std::vector<std::string>& args);
+	static int ListMegascans(const std::vector<std::string>& args);
+	static int BenchmarkMegascans(const std::vector<std::string>& args);
+	static int BenchmarkImages(const std::vector<std::string>& args);
+	static int BenchmarkMips(const std::vector<std::string>& args);
+	static int BenchmarkBlockCompression(const std::vector<std::string>& args);
+	static int CookTextures(const std::vector<std::string>& args);
+	static int PackChannels(const std::vector<std::string>& args);
+	static int SimulateTextureStreaming(const std::vector<std::string>& args);
+	static int BenchmarkVirtualTexture(const std::vector<std::string>& args);
+	static int BenchmarkTextureTiers(const std::vector<std::string>& args);
+	static int BenchmarkUploadCopy(const std::vector<std::string>& args);
+	static int BenchmarkUploadRing(const std::vector<std::string>& args);
+
+	static void AttachToConsole();
+	static void PrintUsage();
+	static std::vector<std::string> GetDandelionSet();
+};
@@ -0,0 +1,37 @@
+// Vertex shader for the packed vertex formats (VertexFormat::Compact and CompactLit, see Graphics/Vertex.h), both
+// PSOs in Graphics::CreatePipelineState use it. wvpMat has to include the mesh's dequantize matrix
+// (Mesh::GetVertexTransform), that is what turns the 0..1 positions back into model space
+
+struct VS_INPUT
+{
+	float4 pos : POSITION; // UNORM, w carries the bitangent sign in CompactLit
+	float2 texCoord : TEXCOORD; // Half floats, the input assembler expands them
+};
+
+struct VS_OUTPUT
+{
+	float4 pos : SV_POSITION;
+	float2 texCoord : TEXCOORD;
+};
+
+cbuffer ConstantBuffer : register(b0)
+{
+	float4x4 wvpMat;
+};
+
+// For CompactLit's NORMAL and TANGENT once the pixel shader does lighting
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+VS_OUTPUT main(VS_INPUT input)
+{
+	VS_OUTPUT output;
+	output.pos = mul(float4(input.pos.xyz, 1.0f), wvpMat);
+	output.texCoord = input.texCoord;
+	return output;
+}